@@ -34,6 +34,7 @@
  */
 #include "scopeexports.h"
 #include "VCDExportWizard.h"
+#include "../scopehal/ValueChangeWriter.h"
 
 using namespace std;
 
@@ -79,9 +80,14 @@ VCDExportChannelSelectionPage::VCDExportChannelSelectionPage(const vector<Oscill
 		{
 			StreamDescriptor stream(c, s);
 
-			//Can't export anything but digital data
-			if(stream.GetType() != Stream::STREAM_TYPE_DIGITAL)
+			//Can export digital, digital bus, and analog (as real) data
+			auto type = stream.GetType();
+			if( (type != Stream::STREAM_TYPE_DIGITAL) &&
+				(type != Stream::STREAM_TYPE_DIGITAL_BUS) &&
+				(type != Stream::STREAM_TYPE_ANALOG) )
+			{
 				continue;
+			}
 
 			//Must actually have data
 			if(stream.GetData() == nullptr)
@@ -142,6 +148,14 @@ VCDExportFinalPage::VCDExportFinalPage()
 	filter->set_name("Value Change Dump (*.vcd)");
 	m_chooser.add_filter(filter);
 
+	if(ValueChangeWriter::IsFormatSupported(ValueChangeWriter::FORMAT_FST))
+	{
+		auto fstfilter = Gtk::FileFilter::create();
+		fstfilter->add_pattern("*.fst");
+		fstfilter->set_name("Fast Signal Trace (*.fst)");
+		m_chooser.add_filter(fstfilter);
+	}
+
 	m_grid.attach(m_chooser, 0, 0, 1, 1);
 
 	m_grid.show_all();
@@ -194,136 +208,24 @@ void VCDExportWizard::on_apply()
 		auto name = m_channelSelectionPage.m_selectedChannels.get_text(i);
 		streams.push_back(m_channelSelectionPage.m_targets[name]);
 	}
-	Unit fs(Unit::UNIT_FS);
 
-	//Get waveforms for each stream
-	vector<SparseDigitalWaveform*> sparsewaveforms;
-	vector<UniformDigitalWaveform*> uniformwaveforms;
-	vector<size_t> indexes;
-	vector<size_t> lens;
+	ValueChangeWriter writer;
+	writer.SetVersionString(string("glscopeclient (build date ") + __DATE__ + " " + __TIME__ + ")");	//TODO: add git sha etc
 	for(auto s : streams)
-	{
-		auto data = s.GetData();
-
-		auto swfm = dynamic_cast<SparseDigitalWaveform*>(data);
-		sparsewaveforms.push_back(swfm);
-
-		auto uwfm = dynamic_cast<UniformDigitalWaveform*>(data);
-		uniformwaveforms.push_back(uwfm);
-
-		indexes.push_back(0);
-		lens.push_back(data->size());
-	}
+		writer.AddSignal(s);
 
-	//Write header section
+	//Write FST if the user asked for it and we can, otherwise VCD
 	auto fname = m_finalPage.m_chooser.get_filename();
-	FILE* fp = fopen(fname.c_str(), "w");
-	if(!fp)
+	auto format = ValueChangeWriter::FORMAT_VCD;
+	if( (fname.length() > 4) && (fname.substr(fname.length() - 4) == ".fst") &&
+		ValueChangeWriter::IsFormatSupported(ValueChangeWriter::FORMAT_FST) )
 	{
-		LogError("Failed to open output file\n");
-		return;
+		format = ValueChangeWriter::FORMAT_FST;
 	}
 
-	auto tnow = time(nullptr);
-	auto local = localtime(&tnow);
-	char timebuf[128] = {0};
-	strftime(timebuf, sizeof(timebuf), "%F %T", local);
-	fprintf(fp, "$date\n");
-	fprintf(fp, "    %s\n", timebuf);
-	fprintf(fp, "$end\n");
-	fprintf(fp, "$version\n");
-	fprintf(fp, "    glscopeclient (build date %s %s)\n", __DATE__, __TIME__);	//TODO: add git sha etc
-	fprintf(fp, "$end\n");
-	fprintf(fp, "$timescale 1fs\n");
-
-	//Dump the list of variables (for now, all a single module)
-	std::map<size_t, string> ids;
-	fprintf(fp, "$scope module export $end\n");
-	for(size_t i=0; i<streams.size(); i++)
-	{
-		string id = "";
-		size_t j = i;
-		while(true)
-		{
-			//Prepend the new ID digit (base 52)
-			size_t digit = j % 52;
-			char c;
-			if(digit < 26)
-				c = 'a' + digit;
-			else
-				c = 'A' + digit - 26;
-			id = string(1, c) + id;
-
-			//Move on
-			j /= 52;
-			if(j == 0)
-				break;
-		}
-		ids[i] = id;
-
-		//Convert string to be fully alphanumeric
-		string name = streams[i].GetName();
-		for(size_t k=0; k<name.length(); k++)
-		{
-			if(!isalnum(name[k]))
-				name[k] = '_';
-		}
-
-		//TODO: support digital vectors
-		fprintf(fp, "    $var wire 1 %3s %s $end\n",
-			id.c_str(),
-			name.c_str());
-	}
-	fprintf(fp, "$upscope $end\n");
-	fprintf(fp, "$enddefinitions $end\n");
-	fprintf(fp, "$dumpvars\n");
-
-	//Print the actual waveform
-	//TODO: more efficient, don't export every signal if only one has changed
-	int64_t timestamp = 0;
-	while(true)
-	{
-		//Print signal values
-		fprintf(fp, "#%ld\n", timestamp);
-		for(size_t i=0; i<streams.size(); i++)
-		{
-			if(sparsewaveforms[i])
-				fprintf(fp,"%d%s\n", sparsewaveforms[i]->m_samples[indexes[i]], ids[i].c_str());
-			else
-				fprintf(fp,"%d%s\n", uniformwaveforms[i]->m_samples[indexes[i]], ids[i].c_str());
-		}
-
-		//Get timestamp of next event on any channel
-		int64_t next = timestamp;
-		for(size_t i=0; i<streams.size(); i++)
-		{
-			int64_t t;
-			if(sparsewaveforms[i])
-				t = Filter::GetNextEventTimestampScaled(sparsewaveforms[i], indexes[i], lens[i], timestamp);
-			else
-				t = Filter::GetNextEventTimestampScaled(uniformwaveforms[i], indexes[i], lens[i], timestamp);
-			if(i == 0)
-				next = t;
-			else
-				next = min(next, t);
-		}
-
-		//If we can't move forward, stop
-		if(next == timestamp)
-			break;
-
-		//Move on
-		timestamp = next;
-		for(size_t i=0; i<streams.size(); i++)
-		{
-			if(sparsewaveforms[i])
-				Filter::AdvanceToTimestampScaled(sparsewaveforms[i], indexes[i], lens[i], timestamp);
-			else
-				Filter::AdvanceToTimestampScaled(uniformwaveforms[i], indexes[i], lens[i], timestamp);
-		}
-	}
+	if(!writer.Write(fname, format))
+		return;
 
-	fclose(fp);
 	hide();
 }
 
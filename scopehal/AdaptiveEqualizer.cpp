@@ -0,0 +1,510 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Implementation of AdaptiveEqualizer
+ */
+#include "scopehal.h"
+#include "AdaptiveEqualizer.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+AdaptiveEqualizer::AdaptiveEqualizer()
+	: m_precursors(0)
+	, m_algorithm(ALGORITHM_SIGN_SIGN_LMS)
+	, m_stepSize(1e-3)
+	, m_targetAmplitude(0)
+	, m_threshold(0)
+{
+	Configure(0, 0, 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Configuration
+
+/**
+	@brief Sets the number of taps and resets them to a pass-through response
+
+	@param precursors	Number of FFE taps before the main cursor
+	@param postcursors	Number of FFE taps after the main cursor
+	@param dfeTaps		Number of DFE taps
+ */
+void AdaptiveEqualizer::Configure(size_t precursors, size_t postcursors, size_t dfeTaps)
+{
+	m_precursors = precursors;
+	m_ffe.assign(precursors + postcursors + 1, 0.0f);
+	m_ffe[precursors] = 1;
+	m_dfe.assign(dfeTaps, 0.0f);
+}
+
+/**
+	@brief Sets the FFE taps (the tap count must match the current configuration)
+ */
+void AdaptiveEqualizer::SetFFETaps(const vector<float>& taps)
+{
+	if(taps.size() != m_ffe.size())
+	{
+		LogError("AdaptiveEqualizer::SetFFETaps: expected %zu taps, got %zu\n", m_ffe.size(), taps.size());
+		return;
+	}
+	m_ffe = taps;
+}
+
+/**
+	@brief Sets the DFE taps (the tap count must match the current configuration)
+ */
+void AdaptiveEqualizer::SetDFETaps(const vector<float>& taps)
+{
+	if(taps.size() != m_dfe.size())
+	{
+		LogError("AdaptiveEqualizer::SetDFETaps: expected %zu taps, got %zu\n", m_dfe.size(), taps.size());
+		return;
+	}
+	m_dfe = taps;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Adaptation
+
+/**
+	@brief Adapts the FFE and DFE taps to a block of UI-spaced samples
+
+	@param samples	One sample per UI, taken at the recovered clock edges
+	@param len		Number of samples
+	@param passes	Number of times to run over the block
+ */
+void AdaptiveEqualizer::Train(const float* samples, size_t len, size_t passes)
+{
+	size_t ntaps = m_ffe.size();
+	size_t post = ntaps - 1 - m_precursors;
+	size_t ndfe = m_dfe.size();
+	if(len < ntaps)
+		return;
+
+	//Initial amplitude estimate if we're tracking automatically
+	float amplitude = m_targetAmplitude;
+	bool autoAmplitude = (amplitude <= 0);
+	if(autoAmplitude)
+	{
+		double sum = 0;
+		for(size_t i=0; i<len; i++)
+			sum += fabs(samples[i] - m_threshold);
+		amplitude = sum / len;
+	}
+
+	vector<float> x(ntaps);
+	vector<float> history(ndfe, 0.0f);
+	float mu = m_stepSize;
+	for(size_t pass=0; pass<passes; pass++)
+	{
+		for(size_t n=post; n+m_precursors < len; n++)
+		{
+			//FFE, relative to the slicer threshold
+			float y = 0;
+			for(size_t i=0; i<ntaps; i++)
+			{
+				x[i] = samples[n + m_precursors - i] - m_threshold;
+				y += m_ffe[i] * x[i];
+			}
+
+			//DFE
+			float z = y;
+			for(size_t j=0; j<ndfe; j++)
+				z -= m_dfe[j] * history[j];
+
+			//Slice
+			float d = (z > 0) ? amplitude : -amplitude;
+			float e = d - z;
+
+			//Update taps
+			if(m_algorithm == ALGORITHM_LMS)
+			{
+				for(size_t i=0; i<ntaps; i++)
+				{
+					if(!autoAmplitude || (i != m_precursors))
+						m_ffe[i] += mu * e * x[i];
+				}
+				for(size_t j=0; j<ndfe; j++)
+					m_dfe[j] -= mu * e * history[j];
+			}
+			else
+			{
+				float se = (e > 0) ? mu : -mu;
+				for(size_t i=0; i<ntaps; i++)
+				{
+					if(!autoAmplitude || (i != m_precursors))
+						m_ffe[i] += (x[i] > 0) ? se : -se;
+				}
+				for(size_t j=0; j<ndfe; j++)
+					m_dfe[j] -= (history[j] > 0) ? se : -se;
+			}
+
+			if(autoAmplitude)
+				amplitude += 1e-3f * (fabs(z) - amplitude);
+
+			//Shift decision history (normalized, so DFE taps are in signal units)
+			for(size_t j=ndfe; j>1; j--)
+				history[j-1] = history[j-2];
+			if(ndfe)
+				history[0] = (z > 0) ? 1 : -1;
+		}
+	}
+}
+
+/**
+	@brief Equalizes a block of UI-spaced samples with the current taps
+
+	Samples too close to either end for the full FFE span are equalized with the edge samples replicated.
+
+	@param samples	Input samples, one per UI
+	@param out		Equalized samples (must not overlap samples)
+	@param len		Number of samples
+ */
+void AdaptiveEqualizer::Apply(const float* samples, float* out, size_t len) const
+{
+	size_t ntaps = m_ffe.size();
+	size_t ndfe = m_dfe.size();
+	int64_t last = (int64_t)len - 1;
+
+	vector<float> history(ndfe, 0.0f);
+	for(size_t n=0; n<len; n++)
+	{
+		float y = 0;
+		for(size_t i=0; i<ntaps; i++)
+		{
+			int64_t pos = (int64_t)(n + m_precursors) - (int64_t)i;
+			pos = min(max(pos, (int64_t)0), last);
+			y += m_ffe[i] * (samples[pos] - m_threshold);
+		}
+
+		float z = y;
+		for(size_t j=0; j<ndfe; j++)
+			z -= m_dfe[j] * history[j];
+
+		out[n] = z + m_threshold;
+
+		for(size_t j=ndfe; j>1; j--)
+			history[j-1] = history[j-2];
+		if(ndfe)
+			history[0] = (z > 0) ? 1 : -1;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Eye analysis
+
+/**
+	@brief Measures eye opening and estimates BER of UI-spaced NRZ samples
+
+	@param samples		One sample per UI
+	@param len			Number of samples
+	@param threshold	Slicer threshold
+ */
+AdaptiveEqualizer::EyeStatistics AdaptiveEqualizer::MeasureNRZ(const float* samples, size_t len, float threshold)
+{
+	double sum[2] = {0, 0};
+	double sumsq[2] = {0, 0};
+	size_t count[2] = {0, 0};
+	for(size_t i=0; i<len; i++)
+	{
+		float v = samples[i];
+		int bit = (v > threshold) ? 1 : 0;
+		sum[bit] += v;
+		sumsq[bit] += v*v;
+		count[bit] ++;
+	}
+
+	EyeStatistics stats;
+	if(!count[0] || !count[1])
+	{
+		stats.m_mean0 = stats.m_mean1 = threshold;
+		stats.m_sigma0 = stats.m_sigma1 = 0;
+		stats.m_eyeHeight = 0;
+		stats.m_ber = 0.5;
+		return stats;
+	}
+
+	stats.m_mean0 = sum[0] / count[0];
+	stats.m_mean1 = sum[1] / count[1];
+	stats.m_sigma0 = sqrt(max(0.0, sumsq[0] / count[0] - stats.m_mean0*stats.m_mean0));
+	stats.m_sigma1 = sqrt(max(0.0, sumsq[1] / count[1] - stats.m_mean1*stats.m_mean1));
+	stats.m_eyeHeight = (stats.m_mean1 - 3*stats.m_sigma1) - (stats.m_mean0 + 3*stats.m_sigma0);
+
+	float sigma = stats.m_sigma0 + stats.m_sigma1;
+	if(sigma > 0)
+		stats.m_ber = 0.5 * erfc( (stats.m_mean1 - stats.m_mean0) / sigma / M_SQRT2);
+	else
+		stats.m_ber = 0;
+
+	return stats;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Optimization
+
+/**
+	@brief Finds the CTLE setting and FFE taps which maximize eye height for a channel
+
+	For each CTLE candidate, the single bit (pulse) response of the channel is filtered by the CTLE and sampled at UI
+	spacing around its peak. The FFE taps minimizing the mean squared ISI plus noise (MMSE) are found by solving the
+	normal equations. The candidate is scored by the peak distortion eye height: main cursor, less the sum of the
+	magnitudes of all residual ISI cursors, less 3 sigma of noise after the CTLE and FFE.
+
+	@param pulse		Single bit response of the channel, uniformly sampled
+	@param fsPerSample	Sample period of pulse
+	@param uiWidth		Unit interval, in fs
+	@param ctles		CTLE settings to try. If empty, only the FFE is optimized.
+	@param precursors	Number of FFE precursor taps
+	@param postcursors	Number of FFE postcursor taps
+	@param noiseSigma	RMS noise at the receiver input, in signal units (0 for pure zero-forcing)
+ */
+AdaptiveEqualizer::OptimizerResult AdaptiveEqualizer::Optimize(
+	const vector<float>& pulse,
+	int64_t fsPerSample,
+	int64_t uiWidth,
+	const vector<CTLEModel>& ctles,
+	size_t precursors,
+	size_t postcursors,
+	float noiseSigma)
+{
+	vector<CTLEModel> candidates = ctles;
+	if(candidates.empty())
+		candidates.push_back(CTLEModel());
+
+	size_t ncand = candidates.size();
+	double spu = (double)uiWidth / fsPerSample;
+
+	OptimizerResult result;
+	result.m_ctleIndex = 0;
+	result.m_eyeHeights.resize(ncand);
+	result.m_bers.resize(ncand);
+	vector< vector<float> > taps(ncand);
+
+	ThreadPool::GetDefault().ParallelFor(0, ncand, [&](size_t i)
+	{
+		vector<float> filtered(pulse.size());
+		if(!candidates[i].Apply(pulse.data(), filtered.data(), pulse.size(), fsPerSample))
+		{
+			result.m_eyeHeights[i] = -FLT_MAX;
+			result.m_bers[i] = 0.5;
+			return;
+		}
+
+		//Noise at the FFE input is the receiver noise shaped by the CTLE, assumed white up to baud rate Nyquist
+		const int nfreqs = 64;
+		double power = 0;
+		for(int k=0; k<nfreqs; k++)
+			power += norm(candidates[i].GetResponse( (k + 0.5) / nfreqs * 0.5 * FS_PER_SECOND / uiWidth));
+		float sigma = noiseSigma * sqrt(power / nfreqs);
+
+		float ber;
+		result.m_eyeHeights[i] = EvaluateLinear(filtered, spu, precursors, postcursors, sigma, taps[i], ber);
+		result.m_bers[i] = ber;
+	});
+
+	for(size_t i=1; i<ncand; i++)
+	{
+		if(result.m_eyeHeights[i] > result.m_eyeHeights[result.m_ctleIndex])
+			result.m_ctleIndex = i;
+	}
+	result.m_ffeTaps = taps[result.m_ctleIndex];
+
+	return result;
+}
+
+/**
+	@brief Finds MMSE FFE taps for a pulse response and returns the resulting eye height
+
+	@param pulse		Pulse response (after any CTLE)
+	@param samplesPerUI	Samples per UI in the pulse response
+	@param precursors	Number of FFE precursor taps
+	@param postcursors	Number of FFE postcursor taps
+	@param noiseSigma	RMS noise at the FFE input
+	@param taps			Output FFE taps
+	@param ber			Output BER estimate at the worst case ISI pattern
+ */
+float AdaptiveEqualizer::EvaluateLinear(
+	const vector<float>& pulse,
+	double samplesPerUI,
+	size_t precursors,
+	size_t postcursors,
+	float noiseSigma,
+	vector<float>& taps,
+	float& ber)
+{
+	size_t ntaps = precursors + postcursors + 1;
+	taps.assign(ntaps, 0.0f);
+	taps[precursors] = 1;
+	ber = 0.5;
+	if(pulse.empty() || (samplesPerUI < 1))
+		return -FLT_MAX;
+
+	//Main cursor is at the peak of the pulse
+	size_t peak = 0;
+	for(size_t i=1; i<pulse.size(); i++)
+	{
+		if(pulse[i] > pulse[peak])
+			peak = i;
+	}
+
+	//Sample the cursors at UI spacing (linear interpolation between samples)
+	int64_t before = floor(peak / samplesPerUI);
+	int64_t after = floor( (pulse.size() - 1 - peak) / samplesPerUI);
+	vector<double> h(before + after + 1);
+	for(int64_t k=-before; k<=after; k++)
+	{
+		double pos = peak + k*samplesPerUI;
+		size_t ipos = floor(pos);
+		double frac = pos - ipos;
+		double v = pulse[ipos];
+		if( (frac > 0) && (ipos + 1 < pulse.size()) )
+			v += frac * (pulse[ipos+1] - pulse[ipos]);
+		h[k + before] = v;
+	}
+	double main = h[before];
+
+	//Autocorrelation of the cursors
+	size_t ncursors = h.size();
+	vector<double> r(ntaps, 0.0);
+	for(size_t lag=0; lag<ntaps; lag++)
+	{
+		for(size_t n=0; n+lag<ncursors; n++)
+			r[lag] += h[n] * h[n+lag];
+	}
+
+	//Normal equations: (R + sigma^2 I) c = main * h[-k_i], Toeplitz R
+	vector<double> a(ntaps * ntaps);
+	vector<double> b(ntaps);
+	for(size_t i=0; i<ntaps; i++)
+	{
+		for(size_t j=0; j<ntaps; j++)
+			a[i*ntaps + j] = r[(i > j) ? (i - j) : (j - i)];
+		a[i*ntaps + i] += noiseSigma * noiseSigma;
+
+		//Tap i has offset k = i - precursors, and sees cursor -k at the main sampling instant
+		int64_t idx = before - ((int64_t)i - (int64_t)precursors);
+		b[i] = ( (idx >= 0) && (idx < (int64_t)ncursors) ) ? main * h[idx] : 0;
+	}
+	if(Solve(a, b, ntaps))
+	{
+		for(size_t i=0; i<ntaps; i++)
+			taps[i] = b[i];
+	}
+
+	//Equalized cursors: g[m] = sum_i c_i h[m - k_i]
+	double gmain = 0;
+	double isi = 0;
+	int64_t mlo = -before - (int64_t)postcursors;
+	int64_t mhi = after + (int64_t)precursors;
+	for(int64_t m=mlo; m<=mhi; m++)
+	{
+		double g = 0;
+		for(size_t i=0; i<ntaps; i++)
+		{
+			int64_t idx = m - ((int64_t)i - (int64_t)precursors) + before;
+			if( (idx >= 0) && (idx < (int64_t)ncursors) )
+				g += taps[i] * h[idx];
+		}
+		if(m == 0)
+			gmain = g;
+		else
+			isi += fabs(g);
+	}
+
+	//Noise gain of the FFE
+	double norm = 0;
+	for(auto c : taps)
+		norm += c*c;
+	double noise = noiseSigma * sqrt(norm);
+
+	double opening = gmain - isi;
+	if(noise > 0)
+		ber = 0.5 * erfc(max(opening, 0.0) / noise / M_SQRT2);
+	else
+		ber = (opening > 0) ? 0 : 0.5;
+
+	return opening - 3*noise;
+}
+
+/**
+	@brief Solves a small dense linear system in place by Gaussian elimination with partial pivoting
+
+	@param a	n x n matrix, row major (destroyed)
+	@param b	Right hand side, replaced by the solution
+	@param n	Size of the system
+
+	@return False if the matrix is singular
+ */
+bool AdaptiveEqualizer::Solve(vector<double>& a, vector<double>& b, size_t n)
+{
+	for(size_t col=0; col<n; col++)
+	{
+		//Find pivot
+		size_t pivot = col;
+		for(size_t row=col+1; row<n; row++)
+		{
+			if(fabs(a[row*n + col]) > fabs(a[pivot*n + col]))
+				pivot = row;
+		}
+		if(fabs(a[pivot*n + col]) < 1e-30)
+			return false;
+
+		if(pivot != col)
+		{
+			for(size_t k=0; k<n; k++)
+				swap(a[col*n + k], a[pivot*n + k]);
+			swap(b[col], b[pivot]);
+		}
+
+		//Eliminate below
+		for(size_t row=col+1; row<n; row++)
+		{
+			double f = a[row*n + col] / a[col*n + col];
+			for(size_t k=col; k<n; k++)
+				a[row*n + k] -= f * a[col*n + k];
+			b[row] -= f * b[col];
+		}
+	}
+
+	//Back substitute
+	for(size_t i=n; i>0; i--)
+	{
+		size_t row = i-1;
+		double v = b[row];
+		for(size_t k=row+1; k<n; k++)
+			v -= a[row*n + k] * b[k];
+		b[row] = v / a[row*n + row];
+	}
+
+	return true;
+}
@@ -0,0 +1,194 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Declaration of AdaptiveEqualizer
+ */
+
+#ifndef AdaptiveEqualizer_h
+#define AdaptiveEqualizer_h
+
+#include "CTLEModel.h"
+
+/**
+	@brief Decision-directed feed-forward / decision feedback equalizer for NRZ data
+
+	Operates on one sample per UI, as produced by sampling the line at the edges of a recovered clock. For each UI
+	the FFE output is
+
+		y[n] = sum(k = -pre...post) c[k] * x[n-k]
+
+	and the DFE subtracts the contribution of the previous decisions,
+
+		z[n] = y[n] - sum(j = 1...D) b[j] * d[n-j]
+
+	where d[n] = +/-1 is the slicer decision, so DFE taps are the ISI contribution of each previous bit in signal
+	units. Taps are adapted with either LMS or sign-sign LMS on the slicer error e[n] = A*d[n] - z[n].
+
+	If no target amplitude is set, A tracks the mean magnitude of z and the FFE main cursor is held at 1, so the
+	adaptation can't converge to the trivial all-zero solution.
+ */
+class AdaptiveEqualizer
+{
+public:
+	AdaptiveEqualizer();
+
+	///@brief Tap adaptation algorithms
+	enum Algorithm
+	{
+		///@brief Least mean squares
+		ALGORITHM_LMS,
+
+		///@brief Sign-sign LMS (sign of error times sign of data), as used in most SerDes hardware
+		ALGORITHM_SIGN_SIGN_LMS
+	};
+
+	void Configure(size_t precursors, size_t postcursors, size_t dfeTaps);
+
+	///@brief Sets the adaptation algorithm
+	void SetAlgorithm(Algorithm alg)
+	{ m_algorithm = alg; }
+
+	///@brief Sets the adaptation step size
+	void SetStepSize(float mu)
+	{ m_stepSize = mu; }
+
+	///@brief Sets the decision target amplitude (0 to track the signal amplitude automatically)
+	void SetTargetAmplitude(float amplitude)
+	{ m_targetAmplitude = amplitude; }
+
+	///@brief Sets the slicer threshold
+	void SetThreshold(float threshold)
+	{ m_threshold = threshold; }
+
+	///@brief Gets the FFE taps, from the earliest precursor to the last postcursor
+	const std::vector<float>& GetFFETaps() const
+	{ return m_ffe; }
+
+	///@brief Gets the DFE taps, starting with the first postcursor
+	const std::vector<float>& GetDFETaps() const
+	{ return m_dfe; }
+
+	void SetFFETaps(const std::vector<float>& taps);
+	void SetDFETaps(const std::vector<float>& taps);
+
+	///@brief Gets the index of the FFE main cursor
+	size_t GetMainCursor() const
+	{ return m_precursors; }
+
+	void Train(const float* samples, size_t len, size_t passes = 1);
+	void Apply(const float* samples, float* out, size_t len) const;
+
+	///@brief Statistics of a sliced NRZ signal
+	class EyeStatistics
+	{
+	public:
+		///@brief Mean of samples decided as 0
+		float m_mean0;
+
+		///@brief Mean of samples decided as 1
+		float m_mean1;
+
+		///@brief Standard deviation of samples decided as 0
+		float m_sigma0;
+
+		///@brief Standard deviation of samples decided as 1
+		float m_sigma1;
+
+		///@brief Vertical eye opening, (mean1 - 3*sigma1) - (mean0 + 3*sigma0)
+		float m_eyeHeight;
+
+		///@brief Q-factor based bit error rate estimate
+		float m_ber;
+	};
+
+	static EyeStatistics MeasureNRZ(const float* samples, size_t len, float threshold);
+
+	///@brief Result of a pulse response based equalizer optimization
+	class OptimizerResult
+	{
+	public:
+		///@brief Index of the best CTLE candidate
+		size_t m_ctleIndex;
+
+		///@brief Optimal FFE taps for that candidate
+		std::vector<float> m_ffeTaps;
+
+		///@brief Eye height (main cursor minus worst case ISI, less 3 sigma of noise) of each candidate
+		std::vector<float> m_eyeHeights;
+
+		///@brief Bit error rate estimate of each candidate (only meaningful if a noise level was given)
+		std::vector<float> m_bers;
+	};
+
+	static OptimizerResult Optimize(
+		const std::vector<float>& pulse,
+		int64_t fsPerSample,
+		int64_t uiWidth,
+		const std::vector<CTLEModel>& ctles,
+		size_t precursors,
+		size_t postcursors,
+		float noiseSigma);
+
+protected:
+	static float EvaluateLinear(
+		const std::vector<float>& pulse,
+		double samplesPerUI,
+		size_t precursors,
+		size_t postcursors,
+		float noiseSigma,
+		std::vector<float>& taps,
+		float& ber);
+
+	static bool Solve(std::vector<double>& a, std::vector<double>& b, size_t n);
+
+	///@brief Number of FFE precursor taps
+	size_t m_precursors;
+
+	///@brief FFE taps
+	std::vector<float> m_ffe;
+
+	///@brief DFE taps
+	std::vector<float> m_dfe;
+
+	///@brief Adaptation algorithm
+	Algorithm m_algorithm;
+
+	///@brief Adaptation step size
+	float m_stepSize;
+
+	///@brief Decision target amplitude, or 0 for automatic
+	float m_targetAmplitude;
+
+	///@brief Slicer threshold
+	float m_threshold;
+};
+
+#endif
@@ -41,6 +41,8 @@
 #include <windows.h>
 #endif
 
+#include "HostMemory.h"
+
 /**
 	@brief Aligned memory allocator for STL containers
 
@@ -165,17 +167,18 @@ public:
 			throw std::length_error("AlignedAllocator<T>::allocate(): requested size is too large, integer overflow?");
 
 		//Round size up to multiple of alignment
-		if( (n % alignment) != 0)
-		{
-			n |= (alignment - 1);
-			n ++;
-		}
+		n = RoundSize(n);
+
+		//Large buffers are mapped directly so they can use huge pages and NUMA placement
+		T* ret = static_cast<T*>(HostMemory::AllocateLarge(n*sizeof(T), alignment));
+		if(ret)
+			return ret;
 
 		//Do the actual allocation
 #ifdef _WIN32
-		T* ret = static_cast<T*>(_aligned_malloc(n*sizeof(T), alignment));
+		ret = static_cast<T*>(_aligned_malloc(n*sizeof(T), alignment));
 #else
-		T* ret = static_cast<T*>(aligned_alloc(alignment, n*sizeof(T)));
+		ret = static_cast<T*>(aligned_alloc(alignment, n*sizeof(T)));
 #endif
 
 		//Error check
@@ -189,10 +192,13 @@ public:
 		@brief	Free a block of memory
 
 		@param p		Block to free
-		@param unused	Size of block (ignored)
+		@param n		Size of block, as passed to allocate()
 	 */
-	void deallocate(T* const p, [[maybe_unused]] const size_t unused) const
+	void deallocate(T* const p, const size_t n) const
 	{
+		if(HostMemory::FreeLarge(p, RoundSize(n)*sizeof(T)))
+			return;
+
 #ifdef _WIN32
 		_aligned_free(p);
 #else
@@ -221,6 +227,23 @@ public:
 
 	//Disallow assignment
 	AlignedAllocator& operator=(const AlignedAllocator&) = delete;
+
+protected:
+
+	/**
+		@brief Rounds an allocation size up to a multiple of our alignment
+
+		@param n	Size in elements
+	 */
+	static size_t RoundSize(size_t n)
+	{
+		if( (n % alignment) != 0)
+		{
+			n |= (alignment - 1);
+			n ++;
+		}
+		return n;
+	}
 };
 
 #endif
@@ -430,7 +430,7 @@ bool AntikernelLabsOscilloscope::AcquireData()
 			if(IsChannelEnabled(j))
 				s[GetOscilloscopeChannel(j)] = pending_waveforms[j][i];
 		}
-		m_pendingWaveforms.push_back(s);
+		PushPendingWaveform(s);
 	}
 	m_pendingWaveformsMutex.unlock();
 
@@ -58,6 +58,7 @@ AseqSpectrometer::AseqSpectrometer(SCPITransport* transport)
 	, SCPIInstrument(transport)
 	, m_triggerArmed(false)
 	, m_triggerOneShot(false)
+	, m_rejectedDarkFrameSize(SIZE_MAX)
 {
 	//Create the output channel
 	auto chan = new AseqSpectrometerChannel(
@@ -122,6 +123,10 @@ AseqSpectrometer::AseqSpectrometer(SCPITransport* transport)
 	for(size_t i=0; i<npoints; i++)
 		m_flatcal.push_back(stof(flatcal[i]));
 
+	//Corrections are applied after flipping, so the flatness data needs to be flipped too
+	vector<float> flatDisplayOrder(m_flatcal.rbegin(), m_flatcal.rend());
+	m_frameProcessor.SetFlatField(flatDisplayOrder.data(), npoints);
+
 	//Absolute irradiance cal
 	m_irrcoeff = stof(m_transport->SendCommandQueuedWithReply("IRRCOEFF?"));
 	auto irrcal = explode(m_transport->SendCommandQueuedWithReply("IRRCAL?"), ',');
@@ -305,6 +310,21 @@ bool AseqSpectrometer::AcquireData()
 	//(make sure to invert the ordering as well)
 	auto darkframe = m_darkframe->GetInput(0);
 	auto darkcap = dynamic_cast<SparseAnalogWaveform*>(darkframe.GetData());
+
+	//A dark frame of the wrong size can't be subtracted. Don't output uncorrected data labeled as corrected.
+	if(darkcap && (darkcap->size() != npoints) )
+	{
+		if(darkcap->size() != m_rejectedDarkFrameSize)
+		{
+			LogWarning("AseqSpectrometer: dark frame has %zu points but spectrum has %zu, "
+				"not outputting corrected spectrum\n", darkcap->size(), npoints);
+			m_rejectedDarkFrameSize = darkcap->size();
+		}
+		darkcap = nullptr;
+	}
+	else
+		m_rejectedDarkFrameSize = SIZE_MAX;
+
 	if(darkcap)
 	{
 		auto flatcap = new SparseAnalogWaveform;
@@ -314,13 +334,9 @@ bool AseqSpectrometer::AcquireData()
 		flatcap->m_startFemtoseconds = fs;
 		flatcap->Resize(npoints);
 
-		for(size_t i=0; i<npoints; i++)
-		{
-			flatcap->m_samples[i] = (rawcap->m_samples[i] - darkcap->m_samples[i]) / m_flatcal[last - i];
-
-			flatcap->m_durations[i] = rawcap->m_durations[i];
-			flatcap->m_offsets[i] = rawcap->m_offsets[i];
-		}
+		flatcap->CopyTimestamps(rawcap);
+		UpdateDarkFrame(darkcap);
+		ProcessFrame(rawcap->m_samples.GetCpuPointer(), flatcap->m_samples.GetCpuPointer(), npoints);
 		flatcap->MarkModifiedFromCpu();
 
 		s[StreamDescriptor(GetOscilloscopeChannel(CHAN_SPECTRUM),
@@ -359,7 +375,7 @@ bool AseqSpectrometer::AcquireData()
 
 	//Save the waveforms to our queue
 	m_pendingWaveformsMutex.lock();
-	m_pendingWaveforms.push_back(s);
+	PushPendingWaveform(s);
 	m_pendingWaveformsMutex.unlock();
 
 	//Done, clean up
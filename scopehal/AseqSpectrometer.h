@@ -162,6 +162,9 @@ protected:
 	///@brief Dark frame input
 	SpectrometerDarkFrameChannel* m_darkframe;
 
+	///@brief Length of the last dark frame rejected for not matching the spectrum (so we only warn once per size)
+	size_t m_rejectedDarkFrameSize;
+
 	///@brief Integration time, in femtoseconds
 	int64_t m_integrationTime;
 
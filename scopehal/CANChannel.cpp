@@ -58,61 +58,73 @@ CANChannel::~CANChannel()
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // CANWaveform
 
-string CANWaveform::GetColor(size_t i)
+uint16_t CANWaveform::GetColorIndex(size_t i)
 {
 	const CANSymbol& s = m_samples[i];
 
 	switch(s.m_stype)
 	{
 		case CANSymbol::TYPE_SOF:
-			return StandardColors::colors[StandardColors::COLOR_PREAMBLE];
+			return ProtocolPalette::GetStandardColor(StandardColors::COLOR_PREAMBLE);
 
 		case CANSymbol::TYPE_R0:
 			if(!s.m_data)
-				return StandardColors::colors[StandardColors::COLOR_PREAMBLE];
+				return ProtocolPalette::GetStandardColor(StandardColors::COLOR_PREAMBLE);
 			else
-				return StandardColors::colors[StandardColors::COLOR_ERROR];
+				return ProtocolPalette::GetStandardColor(StandardColors::COLOR_ERROR);
 
 		case CANSymbol::TYPE_ID:
-			return StandardColors::colors[StandardColors::COLOR_ADDRESS];
+			return ProtocolPalette::GetStandardColor(StandardColors::COLOR_ADDRESS);
 
 		case CANSymbol::TYPE_RTR:
 		case CANSymbol::TYPE_FD:
-			return StandardColors::colors[StandardColors::COLOR_CONTROL];
+		case CANSymbol::TYPE_BRS:
+			return ProtocolPalette::GetStandardColor(StandardColors::COLOR_CONTROL);
+
+		case CANSymbol::TYPE_ESI:
+			if(!s.m_data)
+				return ProtocolPalette::GetStandardColor(StandardColors::COLOR_CONTROL);
+			else
+				return ProtocolPalette::GetStandardColor(StandardColors::COLOR_ERROR);
 
+		//CAN FD frames carry up to 64 bytes
 		case CANSymbol::TYPE_DLC:
-			if(s.m_data > 8)
-				return StandardColors::colors[StandardColors::COLOR_ERROR];
+			if(s.m_data > 64)
+				return ProtocolPalette::GetStandardColor(StandardColors::COLOR_ERROR);
 			else
-				return StandardColors::colors[StandardColors::COLOR_CONTROL];
+				return ProtocolPalette::GetStandardColor(StandardColors::COLOR_CONTROL);
 
 		case CANSymbol::TYPE_DATA:
-			return StandardColors::colors[StandardColors::COLOR_DATA];
+			return ProtocolPalette::GetStandardColor(StandardColors::COLOR_DATA);
 
 		case CANSymbol::TYPE_CRC_OK:
-			return StandardColors::colors[StandardColors::COLOR_CHECKSUM_OK];
+		case CANSymbol::TYPE_STUFF_COUNT_OK:
+			return ProtocolPalette::GetStandardColor(StandardColors::COLOR_CHECKSUM_OK);
+
+		case CANSymbol::TYPE_STUFF_COUNT_BAD:
+			return ProtocolPalette::GetStandardColor(StandardColors::COLOR_CHECKSUM_BAD);
 
 		case CANSymbol::TYPE_CRC_DELIM:
 		case CANSymbol::TYPE_ACK_DELIM:
 		case CANSymbol::TYPE_EOF:
 			if(s.m_data)
-				return StandardColors::colors[StandardColors::COLOR_PREAMBLE];
+				return ProtocolPalette::GetStandardColor(StandardColors::COLOR_PREAMBLE);
 			else
-				return StandardColors::colors[StandardColors::COLOR_ERROR];
+				return ProtocolPalette::GetStandardColor(StandardColors::COLOR_ERROR);
 
 		case CANSymbol::TYPE_ACK:
 			if(!s.m_data)
-				return StandardColors::colors[StandardColors::COLOR_CHECKSUM_OK];
+				return ProtocolPalette::GetStandardColor(StandardColors::COLOR_CHECKSUM_OK);
 			else
-				return StandardColors::colors[StandardColors::COLOR_CHECKSUM_BAD];
+				return ProtocolPalette::GetStandardColor(StandardColors::COLOR_CHECKSUM_BAD);
 
 		case CANSymbol::TYPE_CRC_BAD:
 		default:
-			return StandardColors::colors[StandardColors::COLOR_ERROR];
+			return ProtocolPalette::GetStandardColor(StandardColors::COLOR_ERROR);
 	}
 }
 
-string CANWaveform::GetText(size_t i)
+void CANWaveform::FormatText(size_t i, string& out)
 {
 	const CANSymbol& s = m_samples[i];
 
@@ -120,7 +132,8 @@ string CANWaveform::GetText(size_t i)
 	switch(s.m_stype)
 	{
 		case CANSymbol::TYPE_SOF:
-			return "SOF";
+			out = "SOF";
+			return;
 
 		case CANSymbol::TYPE_ID:
 			if(s.m_data & 0x80000000)
@@ -130,19 +143,16 @@ string CANWaveform::GetText(size_t i)
 			break;
 
 		case CANSymbol::TYPE_FD:
-			if(s.m_data)
-				return "FD";
-			else
-				return "STD";
+			out = s.m_data ? "FD" : "STD";
+			return;
 
 		case CANSymbol::TYPE_RTR:
-			if(s.m_data)
-				return "REQ";
-			else
-				return "DATA";
+			out = s.m_data ? "REQ" : "DATA";
+			return;
 
 		case CANSymbol::TYPE_R0:
-			return "RSVD";
+			out = "RSVD";
+			return;
 
 		case CANSymbol::TYPE_DLC:
 			snprintf(tmp, sizeof(tmp), "Len %u", s.m_data);
@@ -157,23 +167,58 @@ string CANWaveform::GetText(size_t i)
 			snprintf(tmp, sizeof(tmp), "CRC: %04x", s.m_data);
 			break;
 
+		case CANSymbol::TYPE_BRS:
+			out = s.m_data ? "BRS" : "NO BRS";
+			return;
+
+		case CANSymbol::TYPE_ESI:
+			out = s.m_data ? "ERR PASSIVE" : "ERR ACTIVE";
+			return;
+
+		case CANSymbol::TYPE_STUFF_COUNT_OK:
+		case CANSymbol::TYPE_STUFF_COUNT_BAD:
+			snprintf(tmp, sizeof(tmp), "Stuff: %u", s.m_data);
+			break;
+
+		case CANSymbol::TYPE_ERROR_FRAME:
+			out = s.m_data ? "ACTIVE ERROR" : "PASSIVE ERROR";
+			return;
+
+		case CANSymbol::TYPE_OVERLOAD_FRAME:
+			out = "OVERLOAD";
+			return;
+
 		case CANSymbol::TYPE_CRC_DELIM:
-			return "CRC DELIM";
+			out = "CRC DELIM";
+			return;
 
 		case CANSymbol::TYPE_ACK:
-			if(!s.m_data)
-				return "ACK";
-			else
-				return "NAK";
+			out = s.m_data ? "NAK" : "ACK";
+			return;
 
 		case CANSymbol::TYPE_ACK_DELIM:
-			return "ACK DELIM";
+			out = "ACK DELIM";
+			return;
 
 		case CANSymbol::TYPE_EOF:
-			return "EOF";
+			out = "EOF";
+			return;
 
 		default:
-			return "ERROR";
+			out = "ERROR";
+			return;
 	}
-	return string(tmp);
+	out = tmp;
+}
+
+string CANWaveform::GetText(size_t i)
+{
+	string ret;
+	FormatText(i, ret);
+	return ret;
+}
+
+string CANWaveform::GetColor(size_t i)
+{
+	return ProtocolPalette::GetString(GetColorIndex(i));
 }
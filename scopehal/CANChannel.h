@@ -59,10 +59,10 @@ public:
 		///@brief Reserved bit
 		TYPE_R0,
 
-		///@brief Full-duplex bit
+		///@brief FD format (FDF) bit
 		TYPE_FD,
 
-		///@brief Data length code
+		///@brief Data length code (decoded to a byte count)
 		TYPE_DLC,
 
 		///@brief A data byte
@@ -84,7 +84,25 @@ public:
 		TYPE_ACK_DELIM,
 
 		///@brief End of frame
-		TYPE_EOF
+		TYPE_EOF,
+
+		///@brief CAN FD bit rate switch
+		TYPE_BRS,
+
+		///@brief CAN FD error state indicator
+		TYPE_ESI,
+
+		///@brief CAN FD stuff count with a correct value and parity
+		TYPE_STUFF_COUNT_OK,
+
+		///@brief CAN FD stuff count with an incorrect value or parity
+		TYPE_STUFF_COUNT_BAD,
+
+		///@brief Error flag and delimiter (data is nonzero for an active error flag)
+		TYPE_ERROR_FRAME,
+
+		///@brief Overload flag and delimiter
+		TYPE_OVERLOAD_FRAME
 	};
 
 	///@brief Default constructor, performs no initialization
@@ -132,6 +150,8 @@ public:
 	CANWaveform () : SparseWaveform<CANSymbol>() {};
 	virtual std::string GetText(size_t) override;
 	virtual std::string GetColor(size_t) override;
+	virtual void FormatText(size_t i, std::string& out) override;
+	virtual uint16_t GetColorIndex(size_t i) override;
 };
 
 /**
@@ -0,0 +1,182 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Implementation of CTLEModel
+ */
+#include "scopehal.h"
+#include "CTLEModel.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+CTLEModel::CTLEModel()
+	: m_dcGain(1)
+{
+}
+
+/**
+	@brief Creates a CTLE model
+
+	@param dcGainDB		DC gain, in dB
+	@param zeros		Zero frequencies, in Hz
+	@param poles		Pole frequencies, in Hz
+ */
+CTLEModel::CTLEModel(float dcGainDB, const vector<float>& zeros, const vector<float>& poles)
+	: m_zeros(zeros)
+	, m_poles(poles)
+{
+	SetDCGain(dcGainDB);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Frequency domain
+
+/**
+	@brief Evaluates the complex transfer function at a given frequency
+
+	Phase follows the usual convention for S-parameters: a causal delay has negative, decreasing phase.
+ */
+complex<float> CTLEModel::GetResponse(float hz) const
+{
+	complex<float> h(m_dcGain, 0);
+	for(auto z : m_zeros)
+		h *= complex<float>(1, hz / z);
+	for(auto p : m_poles)
+		h /= complex<float>(1, hz / p);
+	return h;
+}
+
+/**
+	@brief Gets the maximum gain relative to DC, in dB
+
+	Evaluated on a log frequency grid spanning a decade beyond the lowest and highest pole or zero.
+ */
+float CTLEModel::GetPeakingGain() const
+{
+	float fmin = FLT_MAX;
+	float fmax = 0;
+	for(auto z : m_zeros)
+	{
+		fmin = min(fmin, z);
+		fmax = max(fmax, z);
+	}
+	for(auto p : m_poles)
+	{
+		fmin = min(fmin, p);
+		fmax = max(fmax, p);
+	}
+	if(fmax == 0)
+		return 0;
+
+	float lmin = log10(fmin) - 1;
+	float lmax = log10(fmax) + 1;
+	const int steps = 256;
+	float peak = 0;
+	for(int i=0; i<=steps; i++)
+	{
+		float f = pow(10, lmin + (lmax - lmin) * i / steps);
+		peak = max(peak, abs(GetResponse(f)));
+	}
+
+	return 20 * log10(peak / m_dcGain);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Time domain
+
+/**
+	@brief Applies the equalizer to a uniformly sampled waveform
+
+	Each zero is paired with a pole into a first order section (1 + s/wz) / (1 + s/wp); remaining poles get their own
+	single pole sections. Each section is discretized with the bilinear transform, prewarped at the section's
+	corner frequency. The filter state starts at the steady state for the first input sample, so there is no
+	startup transient from a nonzero DC level.
+
+	@param in			Input samples
+	@param out			Output samples (may be the same as in)
+	@param len			Number of samples
+	@param fsPerSample	Sample period
+
+	@return False if the model has more zeros than poles and can't be realized
+ */
+bool CTLEModel::Apply(const float* in, float* out, size_t len, int64_t fsPerSample) const
+{
+	if(m_zeros.size() > m_poles.size())
+		return false;
+	if(len == 0)
+		return true;
+
+	double t = fsPerSample * SECONDS_PER_FS;
+	double k = 2 / t;
+	double nyquist = 0.5 / t;
+
+	//First copy with DC gain applied
+	for(size_t i=0; i<len; i++)
+		out[i] = in[i] * m_dcGain;
+
+	for(size_t n=0; n<m_poles.size(); n++)
+	{
+		//Prewarp the corner frequencies (clamped below Nyquist) and convert to rad/s
+		double fp = min((double)m_poles[n], nyquist * 0.99);
+		double wp = k * tan(M_PI * fp * t);
+
+		//H(s) = (b1*s + b0) / (a1*s + 1), with b0 = 1, b1 = 1/wz (or 0), a1 = 1/wp
+		double b1 = 0;
+		if(n < m_zeros.size())
+		{
+			double fz = min((double)m_zeros[n], nyquist * 0.99);
+			b1 = 1 / (k * tan(M_PI * fz * t));
+		}
+		double a1 = 1 / wp;
+
+		//Bilinear: s = k * (1 - z^-1) / (1 + z^-1)
+		double norm = a1*k + 1;
+		double c0 = (b1*k + 1) / norm;
+		double c1 = (1 - b1*k) / norm;
+		double d1 = (1 - a1*k) / norm;
+
+		//Direct form I, starting at steady state (unity DC gain per section)
+		double xprev = out[0];
+		double yprev = out[0];
+		for(size_t i=0; i<len; i++)
+		{
+			double x = out[i];
+			double y = c0*x + c1*xprev - d1*yprev;
+			out[i] = y;
+			xprev = x;
+			yprev = y;
+		}
+	}
+
+	return true;
+}
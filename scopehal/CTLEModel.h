@@ -0,0 +1,100 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Declaration of CTLEModel
+ */
+
+#ifndef CTLEModel_h
+#define CTLEModel_h
+
+#include <complex>
+
+/**
+	@brief Continuous time linear equalizer with an arbitrary set of real poles and zeros
+
+	The transfer function is
+
+		H(s) = G * prod(1 + s/wz) / prod(1 + s/wp)
+
+	where wz and wp are the zero and pole frequencies in rad/s and G is the DC gain. All poles and zeros are in the
+	left half plane, so the response is causal and minimum phase.
+
+	The model can be evaluated in the frequency domain with GetResponse(), or applied directly to a uniformly sampled
+	waveform with Apply(), which uses a cascade of bilinear transform (frequency prewarped) first order sections.
+	The time domain path requires no more zeros than poles.
+ */
+class CTLEModel
+{
+public:
+	CTLEModel();
+	CTLEModel(float dcGainDB, const std::vector<float>& zeros, const std::vector<float>& poles);
+
+	void SetDCGain(float db)
+	{ m_dcGain = pow(10, db / 20); }
+
+	///@brief Sets the zero frequencies, in Hz
+	void SetZeros(const std::vector<float>& zeros)
+	{ m_zeros = zeros; }
+
+	///@brief Sets the pole frequencies, in Hz
+	void SetPoles(const std::vector<float>& poles)
+	{ m_poles = poles; }
+
+	///@brief Gets the zero frequencies, in Hz
+	const std::vector<float>& GetZeros() const
+	{ return m_zeros; }
+
+	///@brief Gets the pole frequencies, in Hz
+	const std::vector<float>& GetPoles() const
+	{ return m_poles; }
+
+	///@brief Gets the DC gain, in dB
+	float GetDCGain() const
+	{ return 20 * log10(m_dcGain); }
+
+	std::complex<float> GetResponse(float hz) const;
+	float GetPeakingGain() const;
+
+	bool Apply(const float* in, float* out, size_t len, int64_t fsPerSample) const;
+
+protected:
+
+	///@brief DC gain, in V/V
+	float m_dcGain;
+
+	///@brief Zero frequencies, in Hz
+	std::vector<float> m_zeros;
+
+	///@brief Pole frequencies, in Hz
+	std::vector<float> m_poles;
+};
+
+#endif
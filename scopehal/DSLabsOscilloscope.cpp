@@ -67,6 +67,9 @@ DSLabsOscilloscope::DSLabsOscilloscope(SCPITransport* transport)
 	, m_diag_droppedWFMs(FilterParameter::TYPE_INT, Unit(Unit::UNIT_COUNTS))
 	, m_diag_droppedPercent(FilterParameter::TYPE_FLOAT, Unit(Unit::UNIT_PERCENT))
 {
+	//Never queue more than two waveforms, drop the oldest if the consumer falls behind
+	SetPendingQueueLimits(2, 0, QUEUE_DROP_OLDEST);
+
 	//Set up initial cache configuration as "not valid" and let it populate as we go
 	IdentifyHardware();
 
@@ -480,8 +483,7 @@ bool DSLabsOscilloscope::AcquireData()
 	}
 
 	//Process analog captures in parallel
-	#pragma omp parallel for
-	for(size_t i=0; i<awfms.size(); i++)
+	ThreadPool::GetDefault().ParallelFor(0, awfms.size(), [&](size_t i)
 	{
 		auto cap = awfms[i];
 		cap->PrepareForCpuAccess();
@@ -493,7 +495,7 @@ bool DSLabsOscilloscope::AcquireData()
 			cap->size());
 		cap->MarkSamplesModifiedFromCpu();
 		delete[] abufs[i];
-	}
+	});
 
 	FilterParameter* param = &m_diag_totalWFMs;
 	int total = param->GetIntVal() + 1;
@@ -504,18 +506,8 @@ bool DSLabsOscilloscope::AcquireData()
 
 	//Save the waveforms to our queue
 	m_pendingWaveformsMutex.lock();
-	m_pendingWaveforms.push_back(s);
-
-	while (m_pendingWaveforms.size() > 2)
-	{
-		SequenceSet set = *m_pendingWaveforms.begin();
-		for(auto it : set)
-			delete it.second;
-		m_pendingWaveforms.pop_front();
-
-		dropped++;
-	}
-
+	//Queue depth is limited to two waveforms, if we get backed up the oldest ones are dropped
+	dropped += PushPendingWaveform(s);
 	m_pendingWaveformsMutex.unlock();
 
 	param->SetIntVal(dropped);
@@ -0,0 +1,442 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Implementation of Decimator
+ */
+#include "scopehal.h"
+#include "Decimator.h"
+
+using namespace std;
+
+mutex Decimator::m_cacheMutex;
+map<size_t, shared_ptr<const Decimator::Design> > Decimator::m_cache;
+
+///@brief Order of the CIC stage
+#define CIC_ORDER 4
+
+///@brief Number of taps on each side of the center of the CIC compensation filter
+#define COMPENSATION_HALF_LENGTH 8
+
+///@brief Number of nonzero taps on each side of the center of the half-band filter
+#define HALFBAND_HALF_TAPS 14
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+Decimator::Decimator()
+	: m_factor(1)
+	, m_design(GetDesign(1))
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Configuration
+
+/**
+	@brief Sets the decimation factor, looking up (or creating) the matching design
+ */
+void Decimator::SetFactor(size_t factor)
+{
+	if(factor < 1)
+		factor = 1;
+	if( (factor == m_factor) && m_design)
+		return;
+
+	m_factor = factor;
+	m_design = GetDesign(factor);
+}
+
+/**
+	@brief Returns the group delay of the output relative to input sample i*N, in input samples
+ */
+float Decimator::GetDelay() const
+{
+	if(!m_design)
+		return 0;
+	return m_design->m_delay;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Filter design
+
+/**
+	@brief Gets the design for a given decimation factor, from the cache if possible
+ */
+shared_ptr<const Decimator::Design> Decimator::GetDesign(size_t factor)
+{
+	lock_guard<mutex> lock(m_cacheMutex);
+
+	auto it = m_cache.find(factor);
+	if(it != m_cache.end())
+		return it->second;
+
+	auto design = CreateDesign(factor);
+	m_cache[factor] = design;
+	return design;
+}
+
+/**
+	@brief Frees all cached designs (decimators already configured keep their own reference)
+ */
+void Decimator::ClearDesignCache()
+{
+	lock_guard<mutex> lock(m_cacheMutex);
+	m_cache.clear();
+}
+
+/**
+	@brief Creates the stage list for a given decimation factor
+ */
+shared_ptr<const Decimator::Design> Decimator::CreateDesign(size_t factor)
+{
+	auto design = make_shared<Design>();
+	design->m_delay = 0;
+
+	if(factor <= 1)
+		return design;
+
+	//Split into odd part and power of two
+	size_t halfbands = 0;
+	size_t cicfactor = factor;
+	while( (cicfactor % 2) == 0)
+	{
+		cicfactor /= 2;
+		halfbands ++;
+	}
+
+	//Odd part goes to the CIC
+	if(cicfactor > 1)
+	{
+		Stage cic;
+		cic.m_type = STAGE_CIC;
+		cic.m_factor = cicfactor;
+		cic.m_taps = DesignCIC(cicfactor, CIC_ORDER);
+		design->m_stages.push_back(cic);
+
+		//Compensate CIC droop up to 80% of the final Nyquist frequency, if it's significant there.
+		//With several half-band stages after the CIC the final passband is narrow and the droop negligible.
+		float fpass = min(0.25f, 0.4f / (1 << halfbands));
+		if(GetCICResponse(cicfactor, CIC_ORDER, fpass) < pow(10, -0.1 / 20))
+		{
+			Stage comp;
+			comp.m_type = STAGE_COMPENSATION;
+			comp.m_factor = 1;
+			comp.m_taps = DesignCompensation(cicfactor, CIC_ORDER, fpass);
+			design->m_stages.push_back(comp);
+		}
+	}
+
+	//Powers of two go to half-band stages
+	if(halfbands)
+	{
+		Stage hb;
+		hb.m_type = STAGE_HALFBAND;
+		hb.m_factor = 2;
+		hb.m_taps = DesignHalfband();
+		for(size_t i=0; i<halfbands; i++)
+			design->m_stages.push_back(hb);
+	}
+
+	//Even-length kernels have half a sample of delay at their own input rate
+	size_t rate = 1;
+	for(auto& s : design->m_stages)
+	{
+		if(s.m_type != STAGE_HALFBAND)
+		{
+			size_t len = s.m_taps.size();
+			design->m_delay += ( (len - 1) * 0.5f - (len - 1) / 2) * rate;
+		}
+		rate *= s.m_factor;
+	}
+
+	return design;
+}
+
+/**
+	@brief Creates the equivalent FIR kernel of a CIC decimator (a boxcar of width factor convolved with itself)
+
+	@param factor	Decimation factor
+	@param order	Number of integrator / comb pairs
+
+	@return Kernel of length order*(factor-1) + 1, normalized to unity DC gain
+ */
+vector<float> Decimator::DesignCIC(size_t factor, size_t order)
+{
+	vector<double> kernel(1, 1.0);
+	for(size_t n=0; n<order; n++)
+	{
+		vector<double> next(kernel.size() + factor - 1, 0.0);
+		for(size_t i=0; i<kernel.size(); i++)
+		{
+			for(size_t j=0; j<factor; j++)
+				next[i+j] += kernel[i];
+		}
+		kernel.swap(next);
+	}
+
+	double scale = 1.0 / pow(factor, order);
+	vector<float> ret(kernel.size());
+	for(size_t i=0; i<kernel.size(); i++)
+		ret[i] = kernel[i] * scale;
+	return ret;
+}
+
+/**
+	@brief Gets the magnitude response of a CIC decimator
+
+	@param factor	CIC decimation factor
+	@param order	CIC order
+	@param f		Frequency, in cycles per CIC output sample
+ */
+double Decimator::GetCICResponse(size_t factor, size_t order, double f)
+{
+	if(f <= 0)
+		return 1;
+
+	double num = sin(M_PI * f);
+	double den = factor * sin(M_PI * f / factor);
+	return pow(fabs(num / den), order);
+}
+
+/**
+	@brief Designs an FIR which flattens the passband of a CIC decimator
+
+	Frequency sampling design, Kaiser windowed. The target response is the inverse of the CIC response up to the
+	passband edge, tapering linearly to zero at the CIC output Nyquist frequency.
+
+	@param factor	CIC decimation factor
+	@param order	CIC order
+	@param fpass	Passband edge, in cycles per CIC output sample
+ */
+vector<float> Decimator::DesignCompensation(size_t factor, size_t order, float fpass)
+{
+	const size_t npoints = 512;
+	const int half = COMPENSATION_HALF_LENGTH;
+
+	//Sample the desired response
+	vector<double> desired(npoints);
+	vector<double> freqs(npoints);
+	double edgegain = 1;
+	for(size_t k=0; k<npoints; k++)
+	{
+		double f = (k + 0.5) / (2 * npoints);
+		freqs[k] = f;
+
+		if(f <= fpass)
+		{
+			desired[k] = 1.0 / GetCICResponse(factor, order, f);
+			edgegain = desired[k];
+		}
+		else
+			desired[k] = edgegain * (0.5 - f) / (0.5 - fpass);
+	}
+
+	//Inverse transform (real, even response) and window
+	float alpha = 0.1102 * (60 - 8.7);
+	float ia = Filter::Bessel(alpha);
+	vector<float> taps(2*half + 1);
+	double sum = 0;
+	for(int n=0; n<=half; n++)
+	{
+		double acc = 0;
+		for(size_t k=0; k<npoints; k++)
+			acc += desired[k] * cos(2 * M_PI * freqs[k] * n);
+		acc /= npoints;
+
+		float window = Filter::Bessel(alpha * sqrt(1 - (n*n*1.0f) / (half*half))) / ia;
+		taps[half + n] = acc * window;
+		taps[half - n] = acc * window;
+	}
+	for(auto t : taps)
+		sum += t;
+
+	//Unity DC gain
+	for(auto& t : taps)
+		t /= sum;
+	return taps;
+}
+
+/**
+	@brief Designs the half-band lowpass used for each decimate-by-2 stage
+
+	Kaiser windowed sinc with cutoff at a quarter of the input sample rate and 80 dB stopband attenuation.
+
+	@return The nonzero taps at odd offsets from the center, normalized so the full kernel has unity DC gain
+ */
+vector<float> Decimator::DesignHalfband()
+{
+	//4K-1 taps puts a nonzero tap at each end
+	size_t len = 4*HALFBAND_HALF_TAPS - 1;
+	size_t center = (len - 1) / 2;
+
+	AcceleratorBuffer<float> coeffs;
+	coeffs.resize(len);
+	Filter::CalculateFIRCoefficients(0, 0.5, 80, Filter::FILTER_TYPE_LOWPASS, coeffs);
+	coeffs.PrepareForCpuAccess();
+
+	//Keep only the odd taps (even ones are zero apart from rounding), normalized so each side sums to 0.25
+	vector<float> taps(HALFBAND_HALF_TAPS);
+	float sum = 0;
+	for(size_t k=0; k<HALFBAND_HALF_TAPS; k++)
+	{
+		taps[k] = coeffs[center + 2*k + 1];
+		sum += taps[k];
+	}
+	for(auto& t : taps)
+		t *= 0.25f / sum;
+
+	return taps;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Decimation
+
+/**
+	@brief Decimates a block of samples
+
+	@param in	Input samples
+	@param out	Output buffer, must have space for GetOutputLength(len) samples
+	@param len	Number of input samples
+ */
+void Decimator::Process(const float* in, float* out, size_t len)
+{
+	auto& stages = m_design->m_stages;
+	if(stages.empty())
+	{
+		memcpy(out, in, len * sizeof(float));
+		return;
+	}
+
+	const float* src = in;
+	size_t srclen = len;
+	for(size_t i=0; i<stages.size(); i++)
+	{
+		auto& stage = stages[i];
+		size_t dstlen = srclen / stage.m_factor;
+
+		//Last stage goes straight to the output, others ping-pong between scratch buffers
+		float* dst;
+		if(i+1 == stages.size())
+			dst = out;
+		else
+		{
+			auto& scratch = m_scratch[i % 2];
+			scratch.resize(dstlen);
+			dst = scratch.data();
+		}
+
+		if(stage.m_type == STAGE_HALFBAND)
+			ProcessHalfband(stage, src, dst, srclen);
+		else
+			ProcessFIR(stage, src, dst, srclen);
+
+		src = dst;
+		srclen = dstlen;
+	}
+}
+
+/**
+	@brief Runs a symmetric FIR (CIC or compensation) stage, computing only the retained output samples
+ */
+void Decimator::ProcessFIR(const Stage& stage, const float* in, float* out, size_t len)
+{
+	size_t factor = stage.m_factor;
+	size_t outlen = len / factor;
+	size_t ntaps = stage.m_taps.size();
+	int64_t center = (ntaps - 1) / 2;
+	const float* taps = stage.m_taps.data();
+	int64_t last = len - 1;
+
+	ThreadPool::GetDefault().ParallelFor(0, outlen, [&](size_t i)
+	{
+		int64_t base = (int64_t)(i * factor) - center;
+		float acc = 0;
+
+		//Fast path: entire kernel is within the input
+		if( (base >= 0) && (base + (int64_t)ntaps <= (int64_t)len) )
+		{
+			const float* p = in + base;
+			for(size_t k=0; k<ntaps; k++)
+				acc += taps[k] * p[k];
+		}
+
+		//Near the ends: replicate the edge samples
+		else
+		{
+			for(size_t k=0; k<ntaps; k++)
+			{
+				int64_t pos = min(max(base + (int64_t)k, (int64_t)0), last);
+				acc += taps[k] * in[pos];
+			}
+		}
+
+		out[i] = acc;
+	}, outlen > 10000);
+}
+
+/**
+	@brief Runs a half-band decimate-by-2 stage
+ */
+void Decimator::ProcessHalfband(const Stage& stage, const float* in, float* out, size_t len)
+{
+	size_t outlen = len / 2;
+	size_t ntaps = stage.m_taps.size();
+	int64_t reach = 2*ntaps - 1;
+	const float* taps = stage.m_taps.data();
+	int64_t last = len - 1;
+
+	ThreadPool::GetDefault().ParallelFor(0, outlen, [&](size_t i)
+	{
+		int64_t c = 2*i;
+		float acc = 0.5f * in[c];
+
+		//Fast path: entire kernel is within the input
+		if( (c >= reach) && (c + reach <= last) )
+		{
+			for(size_t k=0; k<ntaps; k++)
+				acc += taps[k] * (in[c - 2*k - 1] + in[c + 2*k + 1]);
+		}
+
+		//Near the ends: replicate the edge samples
+		else
+		{
+			for(size_t k=0; k<ntaps; k++)
+			{
+				int64_t off = 2*k + 1;
+				int64_t lo = max(c - off, (int64_t)0);
+				int64_t hi = min(c + off, last);
+				acc += taps[k] * (in[lo] + in[hi]);
+			}
+		}
+
+		out[i] = acc;
+	}, outlen > 10000);
+}
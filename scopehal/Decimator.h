@@ -0,0 +1,151 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Declaration of Decimator
+ */
+
+#ifndef Decimator_h
+#define Decimator_h
+
+#include <mutex>
+
+/**
+	@brief Multirate anti-aliased decimation of uniformly sampled analog data
+
+	A decimation factor N = R * 2^h is split into up to three kinds of stage:
+	* If R > 1, a 4th order CIC (cascaded integrator-comb) stage decimating by R, followed (if the droop in the final
+	  passband is significant) by a short FIR which compensates for it
+	* h half-band stages, each decimating by 2
+
+	The CIC is evaluated as its equivalent (boxcar^4) FIR kernel in polyphase form, computing only the retained output
+	samples. This costs four multiply-accumulates per input sample regardless of R, and avoids the unbounded growth of
+	floating point integrators on long records. Half-band stages exploit the zero-valued even taps, so only every other
+	tap is evaluated.
+
+	All stages are linear phase and centered on the retained input sample, so output sample i lines up with input
+	sample i*N (plus GetDelay(), which is zero for the current designs). Samples near the ends of the record are
+	computed by replicating the first / last input sample.
+
+	Designs depend only on the decimation factor and are cached globally, so changing factor back and forth or
+	creating many decimators with the same factor does not redesign the filters.
+ */
+class Decimator
+{
+public:
+	Decimator();
+
+	void SetFactor(size_t factor);
+
+	///@brief Returns the overall decimation factor
+	size_t GetFactor() const
+	{ return m_factor; }
+
+	///@brief Returns the number of output samples produced from a given number of input samples
+	size_t GetOutputLength(size_t inlen) const
+	{ return inlen / m_factor; }
+
+	float GetDelay() const;
+
+	void Process(const float* in, float* out, size_t len);
+
+	///@brief Types of decimation stage
+	enum StageType
+	{
+		///@brief CIC decimator, evaluated as a polyphase FIR
+		STAGE_CIC,
+
+		///@brief Non-decimating compensation FIR
+		STAGE_COMPENSATION,
+
+		///@brief Half-band decimate-by-2 FIR
+		STAGE_HALFBAND
+	};
+
+	///@brief A single stage of the decimation chain
+	class Stage
+	{
+	public:
+		///@brief Type of the stage
+		StageType m_type;
+
+		///@brief Decimation factor of this stage
+		size_t m_factor;
+
+		/**
+			@brief Filter taps
+
+			For CIC and compensation stages this is the full symmetric kernel. For half-band stages it's only the
+			nonzero taps at odd offsets 1, 3, 5... from the center (the center tap is always 0.5).
+		 */
+		std::vector<float> m_taps;
+	};
+
+	///@brief A complete decimation chain for one factor
+	class Design
+	{
+	public:
+		///@brief Stages, in order of execution
+		std::vector<Stage> m_stages;
+
+		///@brief Group delay of the chain relative to sample i*N, in input samples
+		float m_delay;
+	};
+
+	static std::shared_ptr<const Design> GetDesign(size_t factor);
+	static void ClearDesignCache();
+
+protected:
+	static std::shared_ptr<const Design> CreateDesign(size_t factor);
+	static std::vector<float> DesignCIC(size_t factor, size_t order);
+	static double GetCICResponse(size_t factor, size_t order, double f);
+	static std::vector<float> DesignCompensation(size_t factor, size_t order, float fpass);
+	static std::vector<float> DesignHalfband();
+
+	static void ProcessFIR(const Stage& stage, const float* in, float* out, size_t len);
+	static void ProcessHalfband(const Stage& stage, const float* in, float* out, size_t len);
+
+	///@brief The overall decimation factor
+	size_t m_factor;
+
+	///@brief The design for the current factor
+	std::shared_ptr<const Design> m_design;
+
+	///@brief Intermediate results between stages
+	std::vector<float, AlignedAllocator<float, 64> > m_scratch[2];
+
+	///@brief Mutex protecting the design cache
+	static std::mutex m_cacheMutex;
+
+	///@brief Designs already created, indexed by decimation factor
+	static std::map<size_t, std::shared_ptr<const Design> > m_cache;
+};
+
+#endif
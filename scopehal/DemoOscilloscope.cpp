@@ -613,7 +613,7 @@ bool DemoOscilloscope::AcquireData()
 	}
 
 	m_pendingWaveformsMutex.lock();
-	m_pendingWaveforms.push_back(s);
+	PushPendingWaveform(s);
 	m_pendingWaveformsMutex.unlock();
 
 	if(m_triggerOneShot)
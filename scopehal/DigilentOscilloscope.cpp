@@ -360,8 +360,7 @@ bool DigilentOscilloscope::AcquireData()
 			}
 
 			//Now that we have the waveform data, unpack it into individual channels
-			#pragma omp parallel for
-			for(size_t j=0; j<8; j++)
+			ThreadPool::GetDefault().ParallelFor(0, 8, [&](size_t j)
 			{
 				//Bitmask for this digital channel
 				int16_t mask = (1 << j);
@@ -412,7 +411,7 @@ bool DigilentOscilloscope::AcquireData()
 				cap->m_offsets.shrink_to_fit();
 				cap->m_durations.shrink_to_fit();
 				cap->m_samples.shrink_to_fit();
-			}
+			});
 
 			delete[] buf;
 		}
@@ -420,8 +419,7 @@ bool DigilentOscilloscope::AcquireData()
 	}
 
 	//Process analog captures in parallel
-	#pragma omp parallel for
-	for(size_t i=0; i<awfms.size(); i++)
+	ThreadPool::GetDefault().ParallelFor(0, awfms.size(), [&](size_t i)
 	{
 		auto cap = awfms[i];
 
@@ -432,11 +430,11 @@ bool DigilentOscilloscope::AcquireData()
 		cap->MarkSamplesModifiedFromCpu();
 
 		delete[] abufs[i];
-	}
+	});
 
 	//Save the waveforms to our queue
 	m_pendingWaveformsMutex.lock();
-	m_pendingWaveforms.push_back(s);
+	PushPendingWaveform(s);
 	m_pendingWaveformsMutex.unlock();
 
 	//If this was a one-shot trigger we're no longer armed
@@ -43,11 +43,19 @@
 using namespace std;
 
 Filter::CreateMapType Filter::m_createprocs;
+map<string, Filter::DescribeProcType> Filter::m_describeprocs;
+map<string, shared_ptr<const FilterDescriptor> > Filter::m_descriptors;
+mutex Filter::m_descriptorMutex;
 set<Filter*> Filter::m_filters;
 
 mutex Filter::m_cacheMutex;
 map<pair<WaveformBase*, float>, vector<int64_t> > Filter::m_zeroCrossingCache;
 
+WaveformPool Filter::m_uniformAnalogPool;
+WaveformPool Filter::m_sparseAnalogPool;
+WaveformPool Filter::m_uniformDigitalPool;
+WaveformPool Filter::m_sparseDigitalPool;
+
 map<string, unsigned int> Filter::m_instanceCount;
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -97,9 +105,23 @@ void Filter::Release()
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Enumeration
 
-void Filter::DoAddDecoderClass(const string& name, CreateProcType proc)
+/**
+	@brief Registers a filter class
+
+	@param name		Display name of the filter
+	@param proc		Factory method for creating an instance of the filter
+	@param describe	Optional method returning a descriptor for the filter without creating an instance
+ */
+void Filter::DoAddDecoderClass(const string& name, CreateProcType proc, DescribeProcType describe)
 {
 	m_createprocs[name] = proc;
+
+	lock_guard<mutex> lock(m_descriptorMutex);
+	if(describe)
+		m_describeprocs[name] = describe;
+	else
+		m_describeprocs.erase(name);
+	m_descriptors.erase(name);
 }
 
 void Filter::EnumProtocols(vector<string>& names)
@@ -121,6 +143,113 @@ Filter* Filter::CreateFilter(const string& protocol, const string& color)
 	return NULL;
 }
 
+/**
+	@brief Gets the descriptor for a filter type
+
+	Filters registered with AddDecoderClassWithDescriptor() are described without being constructed. Any other filter
+	is constructed once, as a hidden instance, the first time its descriptor is requested. Descriptors are cached so
+	repeated queries (e.g. for building menus) are cheap.
+
+	@param protocol	Display name of the filter
+
+	@return The descriptor, or nullptr if no such filter is registered
+ */
+shared_ptr<const FilterDescriptor> Filter::GetFilterDescriptor(const string& protocol)
+{
+	CreateProcType create;
+	DescribeProcType describe = nullptr;
+	{
+		lock_guard<mutex> lock(m_descriptorMutex);
+
+		auto it = m_descriptors.find(protocol);
+		if(it != m_descriptors.end())
+			return it->second;
+
+		auto cit = m_createprocs.find(protocol);
+		if(cit == m_createprocs.end())
+		{
+			LogError("Invalid filter name: %s\n", protocol.c_str());
+			return nullptr;
+		}
+		create = cit->second;
+
+		auto dit = m_describeprocs.find(protocol);
+		if(dit != m_describeprocs.end())
+			describe = dit->second;
+	}
+
+	//Build the descriptor without holding the lock, since constructing a filter can be slow and must not block
+	//queries for other filter types
+	shared_ptr<const FilterDescriptor> desc;
+	if(describe)
+		desc = make_shared<FilterDescriptor>(describe());
+
+	//No static descriptor, fall back to reading back a throwaway instance
+	else
+	{
+		auto f = create("#ffffff");
+		desc = make_shared<FilterDescriptor>(FilterDescriptor::FromInstance(f));
+		delete f;
+	}
+
+	//If another thread described the same filter in the meantime, keep the first result so callers all share it
+	lock_guard<mutex> lock(m_descriptorMutex);
+	return m_descriptors.emplace(protocol, desc).first->second;
+}
+
+/**
+	@brief Sets up a newly constructed filter's inputs, outputs, and parameters from its descriptor
+
+	Filters which provide a static Describe() method call this from their constructor with its result, so the
+	descriptor is the only place their interface is defined and can't drift out of sync with the constructor.
+
+	@param desc	Descriptor to apply
+ */
+void Filter::ApplyDescriptor(const FilterDescriptor& desc)
+{
+	m_category = desc.m_category;
+	SetXAxisUnits(desc.m_xAxisUnit);
+
+	for(auto& name : desc.m_inputs)
+		CreateInput(name);
+
+	for(auto& out : desc.m_outputs)
+		AddStream(out.m_yAxisUnit, out.m_name, out.m_type, out.m_flags);
+
+	for(auto& it : desc.m_parameters)
+		m_parameters[it.first] = it.second;
+}
+
+/**
+	@brief Checks the descriptor of every registered filter against a newly constructed instance
+
+	This catches static descriptors which have drifted out of sync with their filter's constructor.
+
+	@param errors	One line is appended for each mismatch found, prefixed with the filter name
+
+	@return True if every descriptor matched
+ */
+bool Filter::VerifyFilterDescriptors(vector<string>& errors)
+{
+	size_t count = errors.size();
+
+	for(auto it : m_createprocs)
+	{
+		auto desc = GetFilterDescriptor(it.first);
+
+		auto f = it.second("#ffffff");
+		auto live = FilterDescriptor::FromInstance(f);
+		delete f;
+
+		vector<string> differences;
+		desc->Compare(live, differences);
+		for(auto& d : differences)
+			errors.push_back(it.first + ": " + d);
+	}
+
+	return (errors.size() == count);
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Input verification helpers
 
@@ -312,6 +441,178 @@ void Filter::FillDurationsAVX2(SparseWaveformBase& wfm)
 }
 #endif /* __x86_64__ */
 
+/**
+	@brief Samples several signals on the same clock edges in a single pass
+
+	This is equivalent to calling SampleOnRisingEdgesBase() (or the falling / any edge variants) once per input, but
+	walks the clock once and produces a single timestamp array. Each output sample packs the value of every input at
+	that edge into one word, in the order the inputs were given:
+
+	* Digital inputs (uniform or sparse) take one bit
+	* Digital bus inputs take one bit per lane, lane 0 first
+	* Analog inputs (uniform or sparse) take one bit, set if the value is above the threshold
+
+	As with the single signal helpers, each input is sampled at the last point strictly before the clock edge.
+
+	@param inputs		Signals to sample
+	@param clock		The clock signal to use. Must be sparse or uniform digital.
+	@param samples		Output waveform, with a time scale in femtoseconds
+	@param edge			Which clock edges to sample on
+	@param threshold	Decision threshold for analog inputs
+
+	@return Number of bits used in each output word, or zero if the inputs don't fit in 64 bits
+ */
+size_t Filter::SampleMultipleOnEdges(
+	const vector<WaveformBase*>& inputs,
+	WaveformBase* clock,
+	SparseWaveform<uint64_t>& samples,
+	ClockEdge edge,
+	float threshold)
+{
+	samples.clear();
+	samples.SetGpuAccessHint(AcceleratorBuffer<uint64_t>::HINT_NEVER);
+
+	//Figure out what each input is and where its bits go
+	struct Input
+	{
+		WaveformBase* wfm;
+		UniformWaveformBase* uniform;
+		SparseWaveformBase* sparse;
+		UniformDigitalWaveform* udigital;
+		SparseDigitalWaveform* sdigital;
+		SparseDigitalBusWaveform* sbus;
+		UniformAnalogWaveform* uanalog;
+		SparseAnalogWaveform* sanalog;
+		size_t len;
+		size_t shift;
+		size_t width;
+		size_t cursor;
+	};
+	vector<Input> in;
+	size_t nbits = 0;
+	for(auto w : inputs)
+	{
+		w->PrepareForCpuAccess();
+
+		Input i;
+		i.wfm = w;
+		i.uniform = dynamic_cast<UniformWaveformBase*>(w);
+		i.sparse = dynamic_cast<SparseWaveformBase*>(w);
+		i.udigital = dynamic_cast<UniformDigitalWaveform*>(w);
+		i.sdigital = dynamic_cast<SparseDigitalWaveform*>(w);
+		i.sbus = dynamic_cast<SparseDigitalBusWaveform*>(w);
+		i.uanalog = dynamic_cast<UniformAnalogWaveform*>(w);
+		i.sanalog = dynamic_cast<SparseAnalogWaveform*>(w);
+		i.len = w->size();
+		i.shift = nbits;
+		i.width = 1;
+		i.cursor = 0;
+		if(i.sbus)
+			i.width = i.len ? i.sbus->m_samples[0].size() : 0;
+		else if(!i.udigital && !i.sdigital && !i.uanalog && !i.sanalog)
+		{
+			LogError("SampleMultipleOnEdges: unsupported input waveform type\n");
+			return 0;
+		}
+
+		//Nothing to sample against
+		if(i.len == 0)
+			return 0;
+
+		nbits += i.width;
+		in.push_back(i);
+	}
+	if(nbits > 64)
+	{
+		LogError("SampleMultipleOnEdges: %zu bits don't fit in a 64-bit word\n", nbits);
+		return 0;
+	}
+
+	clock->PrepareForCpuAccess();
+	auto uclock = dynamic_cast<UniformDigitalWaveform*>(clock);
+	auto sclock = dynamic_cast<SparseDigitalWaveform*>(clock);
+	if(!uclock && !sclock)
+		return 0;
+
+	size_t len = clock->size();
+	samples.Reserve(len / 2);
+
+	bool last = (len > 0) ? GetValue(sclock, uclock, 0) : false;
+	for(size_t i=1; i<len; i++)
+	{
+		bool cur = GetValue(sclock, uclock, i);
+		bool rising = cur && !last;
+		bool falling = !cur && last;
+		last = cur;
+
+		if(edge == CLOCK_EDGE_RISING)
+		{
+			if(!rising)
+				continue;
+		}
+		else if(edge == CLOCK_EDGE_FALLING)
+		{
+			if(!falling)
+				continue;
+		}
+		else if(!rising && !falling)
+			continue;
+
+		int64_t clkstart = GetOffsetScaled(sclock, uclock, i);
+
+		uint64_t word = 0;
+		for(auto& d : in)
+		{
+			//Find the last data sample before the clock edge.
+			//Uniform inputs can be indexed directly, sparse ones need to be walked.
+			if(d.uniform)
+			{
+				int64_t delta = clkstart - d.wfm->m_triggerPhase;
+				size_t n = 0;
+				if(delta > 0)
+					n = (delta - 1) / d.wfm->m_timescale;
+				d.cursor = min(n, d.len - 1);
+			}
+			else
+			{
+				while( (d.cursor+1 < d.len) && (GetOffsetScaled(d.sparse, d.cursor+1) < clkstart) )
+					d.cursor ++;
+			}
+
+			size_t n = d.cursor;
+			if(d.udigital)
+				word |= (uint64_t)d.udigital->m_samples[n] << d.shift;
+			else if(d.sdigital)
+				word |= (uint64_t)d.sdigital->m_samples[n] << d.shift;
+			else if(d.uanalog)
+				word |= (uint64_t)(d.uanalog->m_samples[n] > threshold) << d.shift;
+			else if(d.sanalog)
+				word |= (uint64_t)(d.sanalog->m_samples[n] > threshold) << d.shift;
+			else
+			{
+				auto& v = d.sbus->m_samples[n];
+				size_t w = min(d.width, v.size());
+				for(size_t b=0; b<w; b++)
+					word |= (uint64_t)v[b] << (d.shift + b);
+			}
+		}
+
+		samples.m_offsets.push_back(clkstart);
+		samples.m_samples.push_back(word);
+	}
+
+	//Compute sample durations
+	#ifdef __x86_64__
+	if(g_hasAvx2)
+		FillDurationsAVX2(samples);
+	else
+	#endif
+		FillDurationsGeneric(samples);
+
+	samples.MarkModifiedFromCpu();
+	return nbits;
+}
+
 /**
 	@brief Find rising edges in a waveform, interpolating to sub-sample resolution as necessary
  */
@@ -1045,6 +1346,86 @@ void Filter::ClearAnalysisCache()
 	m_zeroCrossingCache.clear();
 }
 
+/**
+	@brief Forgets cached analysis results for a single waveform, e.g. because it's about to be reused for new data
+ */
+void Filter::ClearAnalysisCache(WaveformBase* w)
+{
+	lock_guard<mutex> lock(m_cacheMutex);
+	auto it = m_zeroCrossingCache.lower_bound(pair<WaveformBase*, float>(w, -numeric_limits<float>::infinity()));
+	while( (it != m_zeroCrossingCache.end()) && (it->first.first == w) )
+		it = m_zeroCrossingCache.erase(it);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Output recycling
+
+/**
+	@brief Checks if a waveform is of one of the types the SetupEmpty*Waveform() helpers can reuse
+ */
+bool Filter::IsRecyclableWaveform(WaveformBase* w)
+{
+	auto& type = typeid(*w);
+	return (type == typeid(UniformAnalogWaveform)) ||
+		(type == typeid(SparseAnalogWaveform)) ||
+		(type == typeid(UniformDigitalWaveform)) ||
+		(type == typeid(SparseDigitalWaveform));
+}
+
+/**
+	@brief Takes ownership of a waveform nobody needs any more, so a filter creating a new output can reuse its buffers
+
+	Waveforms of types that can't be reused (protocol decodes etc) are deleted.
+ */
+void Filter::RecycleWaveform(WaveformBase* w)
+{
+	ClearAnalysisCache(w);
+
+	auto& type = typeid(*w);
+	if(type == typeid(UniformAnalogWaveform))
+		m_uniformAnalogPool.Add(w);
+	else if(type == typeid(SparseAnalogWaveform))
+		m_sparseAnalogPool.Add(w);
+	else if(type == typeid(UniformDigitalWaveform))
+		m_uniformDigitalPool.Add(w);
+	else if(type == typeid(SparseDigitalWaveform))
+		m_sparseDigitalPool.Add(w);
+	else
+		delete w;
+}
+
+/**
+	@brief Gets a recycled waveform of the requested type, if one is available
+
+	@return The waveform, or nullptr if there are none of that type
+ */
+WaveformBase* Filter::GetRecycledWaveform(const type_info& type)
+{
+	if(type == typeid(UniformAnalogWaveform))
+		return m_uniformAnalogPool.Get();
+	else if(type == typeid(SparseAnalogWaveform))
+		return m_sparseAnalogPool.Get();
+	else if(type == typeid(UniformDigitalWaveform))
+		return m_uniformDigitalPool.Get();
+	else if(type == typeid(SparseDigitalWaveform))
+		return m_sparseDigitalPool.Get();
+	return nullptr;
+}
+
+/**
+	@brief Frees all recycled waveforms to reclaim memory
+
+	@return True if memory was freed, false if the pools were already empty
+ */
+bool Filter::FreeRecycledWaveforms()
+{
+	bool freed = m_uniformAnalogPool.clear();
+	freed |= m_sparseAnalogPool.clear();
+	freed |= m_uniformDigitalPool.clear();
+	freed |= m_sparseDigitalPool.clear();
+	return freed;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Helpers for various common boilerplate operations
 
@@ -1065,7 +1446,9 @@ UniformAnalogWaveform* Filter::SetupEmptyUniformAnalogOutputWaveform(WaveformBas
 	auto cap = dynamic_cast<UniformAnalogWaveform*>(GetData(stream));
 	if(cap == NULL)
 	{
-		cap = new UniformAnalogWaveform;
+		cap = static_cast<UniformAnalogWaveform*>(m_uniformAnalogPool.Get());
+		if(cap == NULL)
+			cap = new UniformAnalogWaveform;
 		SetData(cap, stream);
 	}
 
@@ -1102,7 +1485,9 @@ SparseAnalogWaveform* Filter::SetupEmptySparseAnalogOutputWaveform(WaveformBase*
 	auto cap = dynamic_cast<SparseAnalogWaveform*>(GetData(stream));
 	if(cap == NULL)
 	{
-		cap = new SparseAnalogWaveform;
+		cap = static_cast<SparseAnalogWaveform*>(m_sparseAnalogPool.Get());
+		if(cap == NULL)
+			cap = new SparseAnalogWaveform;
 		SetData(cap, stream);
 	}
 
@@ -1138,7 +1523,9 @@ UniformDigitalWaveform* Filter::SetupEmptyUniformDigitalOutputWaveform(WaveformB
 	auto cap = dynamic_cast<UniformDigitalWaveform*>(GetData(stream));
 	if(cap == NULL)
 	{
-		cap = new UniformDigitalWaveform;
+		cap = static_cast<UniformDigitalWaveform*>(m_uniformDigitalPool.Get());
+		if(cap == NULL)
+			cap = new UniformDigitalWaveform;
 		SetData(cap, stream);
 	}
 
@@ -1173,7 +1560,9 @@ SparseDigitalWaveform* Filter::SetupEmptySparseDigitalOutputWaveform(WaveformBas
 	auto cap = dynamic_cast<SparseDigitalWaveform*>(GetData(stream));
 	if(cap == NULL)
 	{
-		cap = new SparseDigitalWaveform;
+		cap = static_cast<SparseDigitalWaveform*>(m_sparseDigitalPool.Get());
+		if(cap == NULL)
+			cap = new SparseDigitalWaveform;
 		SetData(cap, stream);
 	}
 
@@ -1245,7 +1634,9 @@ SparseDigitalWaveform* Filter::SetupSparseDigitalOutputWaveform(SparseWaveformBa
 	auto cap = dynamic_cast<SparseDigitalWaveform*>(GetData(stream));
 	if(cap == NULL)
 	{
-		cap = new SparseDigitalWaveform;
+		cap = static_cast<SparseDigitalWaveform*>(m_sparseDigitalPool.Get());
+		if(cap == NULL)
+			cap = new SparseDigitalWaveform;
 		SetData(cap, stream);
 	}
 
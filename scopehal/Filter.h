@@ -41,6 +41,7 @@
 #include "FlowGraphNode.h"
 
 class QueueHandle;
+class FilterDescriptor;
 
 /**
 	@brief Describes a particular revision of a waveform
@@ -55,6 +56,7 @@ public:
 	///@brief Create an empty cache key for a null waveform
 	WaveformCacheKey()
 	: m_wfm(nullptr)
+	, m_id(0)
 	, m_rev(0)
 	{}
 
@@ -65,24 +67,28 @@ public:
 	 */
 	WaveformCacheKey(WaveformBase* wfm)
 	: m_wfm(wfm)
+	, m_id(wfm->m_instanceID)
 	, m_rev(wfm->m_revision)
 	{}
 
 	bool operator==(WaveformBase* wfm)
-	{ return (m_wfm == wfm) && (m_rev == wfm->m_revision); }
+	{ return (m_wfm == wfm) && ( !wfm || ( (m_id == wfm->m_instanceID) && (m_rev == wfm->m_revision) ) ); }
 
 	bool operator==(WaveformCacheKey wfm)
-	{ return (m_wfm == wfm.m_wfm) && (m_rev == wfm.m_rev); }
+	{ return (m_wfm == wfm.m_wfm) && (m_id == wfm.m_id) && (m_rev == wfm.m_rev); }
 
 	bool operator!=(WaveformBase* wfm)
-	{ return (m_wfm != wfm) || (m_rev != wfm->m_revision); }
+	{ return !(*this == wfm); }
 
 	bool operator!=(WaveformCacheKey wfm)
-	{ return (m_wfm != wfm.m_wfm) || (m_rev != wfm.m_rev); }
+	{ return !(*this == wfm); }
 
 	///@brief Pointer to the waveform object
 	WaveformBase* m_wfm;
 
+	///@brief Instance ID of the waveform object, in case a new waveform is allocated at the same address
+	uint64_t m_id;
+
 	///@param Version of the waveform
 	uint64_t m_rev;
 };
@@ -353,7 +359,9 @@ protected:
 		auto cap = dynamic_cast<T*>(GetData(stream));
 		if(cap == NULL)
 		{
-			cap = new T;
+			cap = dynamic_cast<T*>(GetRecycledWaveform(typeid(T)));
+			if(cap == NULL)
+				cap = new T;
 			SetData(cap, stream);
 		}
 
@@ -1014,6 +1022,21 @@ public:
 		samples.MarkModifiedFromCpu();
 	}
 
+	///@brief Clock edges to sample on
+	enum ClockEdge
+	{
+		CLOCK_EDGE_RISING,
+		CLOCK_EDGE_FALLING,
+		CLOCK_EDGE_ANY
+	};
+
+	static size_t SampleMultipleOnEdges(
+		const std::vector<WaveformBase*>& inputs,
+		WaveformBase* clock,
+		SparseWaveform<uint64_t>& samples,
+		ClockEdge edge,
+		float threshold = 0);
+
 	/**
 		@brief Samples an analog waveform on all edges of a clock, interpolating linearly to get sub-sample accuracy.
 
@@ -1209,6 +1232,14 @@ public:
 	}
 
 	static void ClearAnalysisCache();
+	static void ClearAnalysisCache(WaveformBase* w);
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Output recycling
+
+	static bool IsRecyclableWaveform(WaveformBase* w);
+	static void RecycleWaveform(WaveformBase* w);
+	static bool FreeRecycledWaveforms();
 
 	enum FIRFilterType
 	{
@@ -1250,16 +1281,27 @@ protected:
 
 public:
 	typedef Filter* (*CreateProcType)(const std::string&);
-	static void DoAddDecoderClass(const std::string& name, CreateProcType proc);
+	typedef FilterDescriptor (*DescribeProcType)();
+	static void DoAddDecoderClass(const std::string& name, CreateProcType proc, DescribeProcType describe = nullptr);
 
 	static void EnumProtocols(std::vector<std::string>& names);
 	static Filter* CreateFilter(const std::string& protocol, const std::string& color = "#ffffff");
 
+	static std::shared_ptr<const FilterDescriptor> GetFilterDescriptor(const std::string& protocol);
+	static bool VerifyFilterDescriptors(std::vector<std::string>& errors);
+
 protected:
+	void ApplyDescriptor(const FilterDescriptor& desc);
+
 	//Class enumeration
 	typedef std::map< std::string, CreateProcType > CreateMapType;
 	static CreateMapType m_createprocs;
 
+	//Class descriptors
+	static std::map<std::string, DescribeProcType> m_describeprocs;
+	static std::map<std::string, std::shared_ptr<const FilterDescriptor> > m_descriptors;
+	static std::mutex m_descriptorMutex;
+
 	//Object enumeration
 	static std::set<Filter*> m_filters;
 
@@ -1269,6 +1311,14 @@ protected:
 	//Caching
 	static std::mutex m_cacheMutex;
 	static std::map<std::pair<WaveformBase*, float>, std::vector<int64_t> > m_zeroCrossingCache;
+
+	static WaveformBase* GetRecycledWaveform(const std::type_info& type);
+
+	//Dead filter outputs, for reuse by the SetupEmpty*Waveform() helpers
+	static WaveformPool m_uniformAnalogPool;
+	static WaveformPool m_sparseAnalogPool;
+	static WaveformPool m_uniformDigitalPool;
+	static WaveformPool m_sparseDigitalPool;
 };
 
 #define PROTOCOL_DECODER_INITPROC(T) \
@@ -1281,4 +1331,12 @@ protected:
 
 #define AddDecoderClass(T) Filter::DoAddDecoderClass(T::GetProtocolName(), T::CreateInstance)
 
+/**
+	@brief Registers a filter class which provides a static FilterDescriptor Describe() method
+
+	The descriptor is returned by Filter::GetFilterDescriptor() without ever constructing the filter.
+ */
+#define AddDecoderClassWithDescriptor(T) \
+	Filter::DoAddDecoderClass(T::GetProtocolName(), T::CreateInstance, T::Describe)
+
 #endif
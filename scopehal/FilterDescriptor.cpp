@@ -0,0 +1,220 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of FilterDescriptor
+	@ingroup core
+ */
+
+#include "scopehal.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+/**
+	@brief Creates an empty descriptor
+
+	@param name		Display name of the filter type
+	@param cat		Category the filter is shown under
+	@param xunit	X axis unit of the filter's outputs
+ */
+FilterDescriptor::FilterDescriptor(const string& name, Filter::Category cat, Unit xunit)
+	: m_name(name)
+	, m_category(cat)
+	, m_xAxisUnit(xunit)
+	, m_capabilities(CAP_CPU_INPUT)
+{
+}
+
+/**
+	@brief Describes a filter by reading back the configuration of an existing instance
+
+	@param f	The filter to describe. Should be freshly constructed if the result is to be used as a type descriptor.
+ */
+FilterDescriptor FilterDescriptor::FromInstance(Filter* f)
+{
+	FilterDescriptor desc(f->GetProtocolDisplayName(), f->GetCategory(), f->GetXAxisUnits());
+
+	for(size_t i=0; i<f->GetInputCount(); i++)
+		desc.AddInput(f->GetInputName(i));
+
+	for(size_t i=0; i<f->GetStreamCount(); i++)
+		desc.AddOutput(f->GetStreamName(i), f->GetType(i), f->GetYAxisUnits(i), f->GetStreamFlags(i));
+
+	for(auto it = f->GetParamBegin(); it != f->GetParamEnd(); it++)
+		desc.AddParameter(it->first, it->second);
+
+	switch(f->GetInputLocation())
+	{
+		case FlowGraphNode::LOC_CPU:
+			desc.SetCapabilities(CAP_CPU_INPUT);
+			break;
+
+		case FlowGraphNode::LOC_GPU:
+			desc.SetCapabilities(CAP_GPU_INPUT);
+			break;
+
+		case FlowGraphNode::LOC_DONTCARE:
+		default:
+			desc.SetCapabilities(CAP_CPU_INPUT | CAP_GPU_INPUT);
+			break;
+	}
+
+	return desc;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Accessors
+
+/**
+	@brief Adds an output stream to the descriptor
+
+	@param name		Name of the stream
+	@param stype	Type of the stream
+	@param yunit	Y axis unit of the stream
+	@param flags	Stream flags
+ */
+void FilterDescriptor::AddOutput(const string& name, Stream::StreamType stype, Unit yunit, uint8_t flags)
+{
+	OutputDesc out;
+	out.m_name = name;
+	out.m_type = stype;
+	out.m_yAxisUnit = yunit;
+	out.m_flags = flags;
+	m_outputs.push_back(out);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Verification
+
+/**
+	@brief Checks whether two descriptors describe the same filter interface
+
+	@param rhs			The descriptor to compare against
+	@param differences	One human readable line is appended for each mismatch found
+
+	@return True if the descriptors match
+ */
+bool FilterDescriptor::Compare(const FilterDescriptor& rhs, vector<string>& differences) const
+{
+	size_t count = differences.size();
+
+	if(m_name != rhs.m_name)
+		differences.push_back("name: \"" + m_name + "\" vs \"" + rhs.m_name + "\"");
+	if(m_category != rhs.m_category)
+		differences.push_back("category: " + to_string(m_category) + " vs " + to_string(rhs.m_category));
+	if(m_xAxisUnit.ToString() != rhs.m_xAxisUnit.ToString())
+		differences.push_back("x axis unit: " + m_xAxisUnit.ToString() + " vs " + rhs.m_xAxisUnit.ToString());
+	if(m_capabilities != rhs.m_capabilities)
+	{
+		differences.push_back(
+			"capabilities: " + to_string(m_capabilities) + " vs " + to_string(rhs.m_capabilities));
+	}
+
+	//Inputs
+	if(m_inputs.size() != rhs.m_inputs.size())
+		differences.push_back("input count: " + to_string(m_inputs.size()) + " vs " + to_string(rhs.m_inputs.size()));
+	for(size_t i=0; i<min(m_inputs.size(), rhs.m_inputs.size()); i++)
+	{
+		if(m_inputs[i] != rhs.m_inputs[i])
+			differences.push_back("input " + to_string(i) + ": \"" + m_inputs[i] + "\" vs \"" + rhs.m_inputs[i] + "\"");
+	}
+
+	//Outputs
+	if(m_outputs.size() != rhs.m_outputs.size())
+	{
+		differences.push_back(
+			"output count: " + to_string(m_outputs.size()) + " vs " + to_string(rhs.m_outputs.size()));
+	}
+	for(size_t i=0; i<min(m_outputs.size(), rhs.m_outputs.size()); i++)
+	{
+		auto& a = m_outputs[i];
+		auto& b = rhs.m_outputs[i];
+		auto prefix = "output " + to_string(i) + " (" + a.m_name + "): ";
+
+		if(a.m_name != b.m_name)
+			differences.push_back(prefix + "name \"" + a.m_name + "\" vs \"" + b.m_name + "\"");
+		if(a.m_type != b.m_type)
+			differences.push_back(prefix + "type " + to_string(a.m_type) + " vs " + to_string(b.m_type));
+		if(a.m_yAxisUnit.ToString() != b.m_yAxisUnit.ToString())
+			differences.push_back(prefix + "unit " + a.m_yAxisUnit.ToString() + " vs " + b.m_yAxisUnit.ToString());
+		if(a.m_flags != b.m_flags)
+			differences.push_back(prefix + "flags " + to_string(a.m_flags) + " vs " + to_string(b.m_flags));
+	}
+
+	//Parameters
+	for(auto& it : m_parameters)
+	{
+		auto jt = rhs.m_parameters.find(it.first);
+		if(jt == rhs.m_parameters.end())
+		{
+			differences.push_back("parameter \"" + it.first + "\" missing from second descriptor");
+			continue;
+		}
+
+		auto& a = it.second;
+		auto& b = jt->second;
+		auto prefix = "parameter \"" + it.first + "\": ";
+
+		if(a.GetType() != b.GetType())
+			differences.push_back(prefix + "type " + to_string(a.GetType()) + " vs " + to_string(b.GetType()));
+		if(a.GetUnit().ToString() != b.GetUnit().ToString())
+			differences.push_back(prefix + "unit " + a.GetUnit().ToString() + " vs " + b.GetUnit().ToString());
+
+		//Compare defaults in the C locale so the result doesn't depend on the user's settings
+		auto adef = a.ToString(false);
+		auto bdef = b.ToString(false);
+		if(adef != bdef)
+			differences.push_back(prefix + "default \"" + adef + "\" vs \"" + bdef + "\"");
+
+		vector<string> aenums;
+		vector<string> benums;
+		a.GetEnumValues(aenums);
+		b.GetEnumValues(benums);
+		if(aenums != benums)
+			differences.push_back(prefix + "enum values differ");
+
+		if(a.IsHidden() != b.IsHidden())
+			differences.push_back(prefix + "hidden flag differs");
+		if(a.IsReadOnly() != b.IsReadOnly())
+			differences.push_back(prefix + "read-only flag differs");
+	}
+	for(auto& it : rhs.m_parameters)
+	{
+		if(m_parameters.find(it.first) == m_parameters.end())
+			differences.push_back("parameter \"" + it.first + "\" missing from first descriptor");
+	}
+
+	return differences.size() == count;
+}
@@ -0,0 +1,139 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of FilterDescriptor
+	@ingroup core
+ */
+
+#ifndef FilterDescriptor_h
+#define FilterDescriptor_h
+
+/**
+	@brief Static description of a filter type: its category, inputs, outputs, and parameter schema
+
+	A descriptor lets front ends build menus and property sheets for a filter type without creating an instance of it.
+
+	Filter classes may supply their own descriptor through a static Describe() method, registered with
+	AddDecoderClassWithDescriptor(), and set themselves up from it in their constructor with
+	Filter::ApplyDescriptor(). Any other filter type is described once, on first query, by creating a hidden
+	instance and reading its configuration back (see FromInstance()).
+
+	Descriptors record the state of a freshly constructed filter. Filters which add streams or parameters later
+	(for example, when an input is connected or a file is loaded) will have more of them than the descriptor shows.
+
+	@ingroup core
+ */
+class FilterDescriptor
+{
+public:
+	FilterDescriptor(
+		const std::string& name = "",
+		Filter::Category cat = Filter::CAT_MISC,
+		Unit xunit = Unit(Unit::UNIT_FS));
+
+	static FilterDescriptor FromInstance(Filter* f);
+
+	///@brief Capability flags
+	enum Capabilities
+	{
+		///@brief Filter accepts input waveforms resident in CPU memory
+		CAP_CPU_INPUT = 1,
+
+		///@brief Filter accepts input waveforms resident in GPU memory
+		CAP_GPU_INPUT = 2
+	};
+
+	///@brief Description of one output stream
+	struct OutputDesc
+	{
+		///@brief Name of the stream
+		std::string m_name;
+
+		///@brief Type of the stream
+		Stream::StreamType m_type;
+
+		///@brief Y axis unit of the stream
+		Unit m_yAxisUnit;
+
+		///@brief Stream flags (see Stream::StreamFlags)
+		uint8_t m_flags;
+	};
+
+	/**
+		@brief Adds an input to the descriptor
+
+		@param name	Name of the input, as passed to CreateInput()
+	 */
+	void AddInput(const std::string& name)
+	{ m_inputs.push_back(name); }
+
+	void AddOutput(const std::string& name, Stream::StreamType stype, Unit yunit, uint8_t flags = 0);
+
+	/**
+		@brief Adds a parameter to the descriptor
+
+		@param name		Name of the parameter
+		@param param	Parameter with the type, unit, enum values, and default value a new instance of the filter has
+	 */
+	void AddParameter(const std::string& name, const FilterParameter& param)
+	{ m_parameters[name] = param; }
+
+	///@brief Sets the capability flags (a bitmask of Capabilities)
+	void SetCapabilities(uint32_t caps)
+	{ m_capabilities = caps; }
+
+	bool Compare(const FilterDescriptor& rhs, std::vector<std::string>& differences) const;
+
+	///@brief Display name of the filter type
+	std::string m_name;
+
+	///@brief Category the filter is shown under in menus
+	Filter::Category m_category;
+
+	///@brief X axis unit of the filter's outputs
+	Unit m_xAxisUnit;
+
+	///@brief Names of the filter's inputs
+	std::vector<std::string> m_inputs;
+
+	///@brief The filter's output streams
+	std::vector<OutputDesc> m_outputs;
+
+	///@brief The filter's parameters, holding their default values
+	FlowGraphNode::ParameterMapType m_parameters;
+
+	///@brief Bitmask of Capabilities
+	uint32_t m_capabilities;
+};
+
+#endif
@@ -0,0 +1,387 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of FilterGraphBufferPlanner
+	@ingroup core
+ */
+
+#include "scopehal.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+FilterGraphBufferPlanner::FilterGraphBufferPlanner()
+	: m_enabled(false)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Configuration
+
+/**
+	@brief Turns on planning, and sets the streams which must still have data after each run
+
+	@param streams	Every stream which will be read from outside the graph (displayed, exported, measured, etc)
+ */
+void FilterGraphBufferPlanner::SetObservedStreams(const set<StreamDescriptor>& streams)
+{
+	m_observedStreams = streams;
+	m_enabled = true;
+}
+
+/**
+	@brief Turns off planning, so every filter keeps its outputs
+ */
+void FilterGraphBufferPlanner::Disable()
+{
+	m_enabled = false;
+	m_observedStreams.clear();
+	m_pendingConsumers.clear();
+	m_inPlaceSources.clear();
+}
+
+bool FilterGraphBufferPlanner::IsObserved(const StreamDescriptor& stream)
+{
+	return m_observedStreams.find(stream) != m_observedStreams.end();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Liveness analysis
+
+/**
+	@brief Counts the nodes consuming each output stream of the filters in the graph
+
+	Every stream of every filter in the graph gets an entry, even if nothing consumes it. Streams from outside the
+	graph (e.g. hardware channels) are not tracked.
+ */
+void FilterGraphBufferPlanner::CountConsumers(const set<FlowGraphNode*>& nodes, map<StreamDescriptor, size_t>& consumers)
+{
+	consumers.clear();
+
+	for(auto n : nodes)
+	{
+		auto f = dynamic_cast<Filter*>(n);
+		if(!f)
+			continue;
+		for(size_t i=0; i<f->GetStreamCount(); i++)
+			consumers[StreamDescriptor(f, i)] = 0;
+	}
+
+	for(auto n : nodes)
+	{
+		for(size_t i=0; i<n->GetInputCount(); i++)
+		{
+			auto it = consumers.find(n->GetInput(i));
+			if(it != consumers.end())
+				it->second ++;
+		}
+	}
+}
+
+/**
+	@brief Checks if a node can take over the waveform on its first input as its first output
+
+	This requires the node to support it, and the input to be a filter output that nobody else needs afterwards.
+
+	@param f		The node
+	@param pending	Number of consumers of each stream yet to run, including f
+ */
+bool FilterGraphBufferPlanner::IsInPlaceCandidate(FlowGraphNode* f, const map<StreamDescriptor, size_t>& pending)
+{
+	if( (f->GetInputCount() == 0) || !f->CanRefreshInPlace() )
+		return false;
+
+	auto chan = dynamic_cast<InstrumentChannel*>(f);
+	if(!chan || (chan->GetStreamCount() == 0) )
+		return false;
+
+	auto in = f->GetInput(0);
+	if( (in.m_channel == chan) || IsObserved(in) )
+		return false;
+
+	auto it = pending.find(in);
+	return (it != pending.end()) && (it->second == 1);
+}
+
+/**
+	@brief Projects the memory usage of evaluating a graph, with and without planning
+
+	The projection is computed even if planning is disabled, so callers can see what it would save.
+ */
+FilterGraphMemoryPlan FilterGraphBufferPlanner::Plan(const set<FlowGraphNode*>& nodes)
+{
+	FilterGraphMemoryPlan plan;
+
+	map<StreamDescriptor, size_t> pending;
+	CountConsumers(nodes, pending);
+
+	//Size of each output as of the last run
+	map<StreamDescriptor, StreamSize> sizes;
+	for(auto& it : pending)
+	{
+		auto size = GetStreamSize(it.first);
+		sizes[it.first] = size;
+		plan.m_unplannedBytes += size.m_bytes;
+	}
+
+	//Put the nodes in dependency order
+	map<FlowGraphNode*, size_t> blockers;
+	map<FlowGraphNode*, vector<FlowGraphNode*> > dependents;
+	for(auto n : nodes)
+	{
+		blockers[n];
+		for(size_t i=0; i<n->GetInputCount(); i++)
+		{
+			auto src = n->GetInput(i).m_channel;
+			if( (src != n) && (nodes.find(src) != nodes.end()) )
+			{
+				blockers[n] ++;
+				dependents[src].push_back(n);
+			}
+		}
+	}
+	vector<FlowGraphNode*> order;
+	for(auto& it : blockers)
+	{
+		if(it.second == 0)
+			order.push_back(it.first);
+	}
+	for(size_t i=0; i<order.size(); i++)
+	{
+		for(auto d : dependents[order[i]])
+		{
+			if(--blockers[d] == 0)
+				order.push_back(d);
+		}
+	}
+
+	//Walk the graph in that order.
+	//Freed waveforms of the standard types go to the recycle pool and stay resident until reused,
+	//anything else is deleted.
+	size_t resident = 0;
+	size_t pooled = 0;
+	set<StreamDescriptor> released;
+	auto release = [&](const StreamDescriptor& s)
+	{
+		if(!released.emplace(s).second)
+			return;
+		plan.m_recycledStreams ++;
+
+		auto& size = sizes[s];
+		if(size.m_recyclable)
+			pooled += size.m_bytes;
+		else
+			resident -= min(resident, size.m_bytes);
+	};
+
+	for(auto n : order)
+	{
+		bool inPlace = IsInPlaceCandidate(n, pending);
+		if(inPlace)
+			plan.m_inPlaceNodes ++;
+
+		//Allocate outputs, reusing pooled memory where possible
+		auto chan = dynamic_cast<Filter*>(n);
+		size_t nstreams = chan ? chan->GetStreamCount() : 0;
+		for(size_t i=0; i<nstreams; i++)
+		{
+			if(inPlace && (i == 0) )
+				continue;
+
+			size_t len = sizes[StreamDescriptor(chan, i)].m_bytes;
+			size_t reuse = min(len, pooled);
+			pooled -= reuse;
+			resident += len - reuse;
+		}
+		plan.m_plannedPeakBytes = max(plan.m_plannedPeakBytes, resident);
+
+		//Release inputs this node was the last consumer of.
+		//An in-place input becomes our output rather than being freed.
+		for(size_t i=0; i<n->GetInputCount(); i++)
+		{
+			auto in = n->GetInput(i);
+			auto it = pending.find(in);
+			if( (it == pending.end()) || (it->second == 0) )
+				continue;
+			it->second --;
+
+			if(inPlace && (i == 0) )
+				released.emplace(in);
+			else if( (it->second == 0) && !IsObserved(in) )
+				release(in);
+		}
+
+		//Release outputs nobody needs
+		for(size_t i=0; i<nstreams; i++)
+		{
+			StreamDescriptor s(chan, i);
+			if( (pending[s] == 0) && !IsObserved(s) )
+				release(s);
+		}
+	}
+
+	return plan;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Execution
+
+/**
+	@brief Starts tracking a new run of the graph
+ */
+void FilterGraphBufferPlanner::Begin(const set<FlowGraphNode*>& nodes)
+{
+	m_inPlaceSources.clear();
+
+	//Forget sizes of nodes that are no longer part of the graph
+	for(auto it = m_streamSizes.begin(); it != m_streamSizes.end(); )
+	{
+		if(nodes.find(it->first.m_channel) == nodes.end())
+			it = m_streamSizes.erase(it);
+		else
+			++it;
+	}
+
+	if(m_enabled)
+		CountConsumers(nodes, m_pendingConsumers);
+	else
+		m_pendingConsumers.clear();
+}
+
+/**
+	@brief Called right before a node runs. Hands it its input's waveform as its output, if it can run in place
+
+	The producer keeps its pointer to the waveform (so the node can still read its input) until OnNodeComplete().
+
+	@return True if the node is running in place
+ */
+bool FilterGraphBufferPlanner::PrepareInPlace(FlowGraphNode* f)
+{
+	if(!m_enabled || !IsInPlaceCandidate(f, m_pendingConsumers))
+		return false;
+
+	auto chan = dynamic_cast<InstrumentChannel*>(f);
+	auto in = f->GetInput(0);
+	auto data = in.GetData();
+	if(!data)
+		return false;
+
+	//Recycle our old output and adopt the input
+	auto old = chan->DetachData(0);
+	if(old)
+		Filter::RecycleWaveform(old);
+	Filter::ClearAnalysisCache(data);
+	chan->SetData(data, 0);
+
+	m_inPlaceSources[f] = in;
+	return true;
+}
+
+/**
+	@brief Called after a node has run (or been skipped). Releases any outputs which are now dead
+ */
+void FilterGraphBufferPlanner::OnNodeComplete(FlowGraphNode* f)
+{
+	if(!m_enabled)
+		return;
+
+	//If we ran in place, the waveform now belongs to us alone.
+	//(If the node replaced it, it was deleted already and the producer's pointer is stale, so just drop it.)
+	auto ip = m_inPlaceSources.find(f);
+	if(ip != m_inPlaceSources.end())
+	{
+		ip->second.m_channel->DetachData(ip->second.m_stream);
+		m_inPlaceSources.erase(ip);
+	}
+
+	//Release inputs we were the last consumer of
+	for(size_t i=0; i<f->GetInputCount(); i++)
+	{
+		auto in = f->GetInput(i);
+		auto it = m_pendingConsumers.find(in);
+		if( (it == m_pendingConsumers.end()) || (it->second == 0) )
+			continue;
+
+		it->second --;
+		if( (it->second == 0) && !IsObserved(in) )
+			ReleaseStream(in);
+	}
+
+	//Remember how big our outputs were, then release any that nobody consumes
+	auto chan = dynamic_cast<Filter*>(f);
+	if(chan)
+	{
+		for(size_t i=0; i<chan->GetStreamCount(); i++)
+		{
+			StreamDescriptor s(chan, i);
+			GetStreamSize(s);
+
+			auto it = m_pendingConsumers.find(s);
+			if( (it != m_pendingConsumers.end()) && (it->second == 0) && !IsObserved(s) )
+				ReleaseStream(s);
+		}
+	}
+}
+
+/**
+	@brief Detaches a dead stream's waveform from its filter and recycles it
+ */
+void FilterGraphBufferPlanner::ReleaseStream(const StreamDescriptor& stream)
+{
+	auto data = stream.m_channel->DetachData(stream.m_stream);
+	if(data)
+		Filter::RecycleWaveform(data);
+}
+
+/**
+	@brief Gets the size of a stream, from its current waveform if it has one or else from the last one we saw
+ */
+FilterGraphBufferPlanner::StreamSize FilterGraphBufferPlanner::GetStreamSize(const StreamDescriptor& stream)
+{
+	auto data = stream.GetData();
+	if(data)
+	{
+		StreamSize size;
+		size.m_bytes = data->GetCpuMemoryBytes();
+		size.m_recyclable = Filter::IsRecyclableWaveform(data);
+		m_streamSizes[stream] = size;
+		return size;
+	}
+
+	auto it = m_streamSizes.find(stream);
+	if(it != m_streamSizes.end())
+		return it->second;
+	return StreamSize{0, false};
+}
@@ -0,0 +1,140 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of FilterGraphBufferPlanner
+	@ingroup core
+ */
+
+#ifndef FilterGraphBufferPlanner_h
+#define FilterGraphBufferPlanner_h
+
+/**
+	@brief Projected memory usage of one filter graph evaluation
+	@ingroup core
+ */
+class FilterGraphMemoryPlan
+{
+public:
+	FilterGraphMemoryPlan()
+		: m_unplannedBytes(0)
+		, m_plannedPeakBytes(0)
+		, m_recycledStreams(0)
+		, m_inPlaceNodes(0)
+	{}
+
+	///@brief Memory held by filter outputs at the end of a run without planning (every output stays resident)
+	size_t m_unplannedBytes;
+
+	///@brief Projected peak memory held by filter outputs and recycled buffers with planning
+	size_t m_plannedPeakBytes;
+
+	///@brief Number of output streams which will be released once their last consumer has run
+	size_t m_recycledStreams;
+
+	///@brief Number of nodes which will write their output into their input's buffer
+	size_t m_inPlaceNodes;
+};
+
+/**
+	@brief Liveness based buffer planning for the filter graph
+	@ingroup core
+
+	Normally each filter keeps its output waveforms for as long as the filter exists, so peak memory is the sum of
+	every intermediate result in the graph. When the set of streams observed from outside the graph (displayed,
+	exported, measured, etc) is known, any other filter output is dead once the last node consuming it has run. Dead
+	outputs are detached from their filter and recycled into Filter's waveform pools, where later nodes pick them up
+	instead of allocating new buffers. A node which declares CanRefreshInPlace() and is the last consumer of its first
+	input is handed that input's waveform as its output, and overwrites it.
+
+	Planning is off until SetObservedStreams() is called. The caller must list every stream it will read after the
+	run: anything else may have no data afterwards. Recycled intermediates also defeat CanSkipRefreshWhenUnchanged(),
+	since there is no cached output left to keep.
+
+	Sizes used for the projection are those of the outputs from the previous run (zero for nodes that haven't run yet,
+	or last ran before planning was enabled and have no output), and the projection assumes nodes run one at a time in
+	dependency order.
+
+	This class is not thread safe. FilterGraphExecutor calls it with its own mutex held.
+ */
+class FilterGraphBufferPlanner
+{
+public:
+	FilterGraphBufferPlanner();
+
+	void SetObservedStreams(const std::set<StreamDescriptor>& streams);
+	void Disable();
+
+	///@brief Returns true if outputs are being recycled
+	bool IsEnabled()
+	{ return m_enabled; }
+
+	FilterGraphMemoryPlan Plan(const std::set<FlowGraphNode*>& nodes);
+
+	void Begin(const std::set<FlowGraphNode*>& nodes);
+	bool PrepareInPlace(FlowGraphNode* f);
+	void OnNodeComplete(FlowGraphNode* f);
+
+protected:
+	///@brief Size of a filter output as of its most recent run
+	struct StreamSize
+	{
+		///@brief CPU memory used by the waveform
+		size_t m_bytes;
+
+		///@brief True if the waveform goes to a recycle pool when released, rather than being deleted
+		bool m_recyclable;
+	};
+
+	void CountConsumers(const std::set<FlowGraphNode*>& nodes, std::map<StreamDescriptor, size_t>& consumers);
+	bool IsObserved(const StreamDescriptor& stream);
+	bool IsInPlaceCandidate(FlowGraphNode* f, const std::map<StreamDescriptor, size_t>& pending);
+	void ReleaseStream(const StreamDescriptor& stream);
+	StreamSize GetStreamSize(const StreamDescriptor& stream);
+
+	///@brief True if planning is active
+	bool m_enabled;
+
+	///@brief Streams which must keep their data after a run
+	std::set<StreamDescriptor> m_observedStreams;
+
+	///@brief Number of nodes which have yet to consume each tracked stream during the current run
+	std::map<StreamDescriptor, size_t> m_pendingConsumers;
+
+	///@brief Input stream whose waveform each in-place node is currently sharing with its producer
+	std::map<FlowGraphNode*, StreamDescriptor> m_inPlaceSources;
+
+	///@brief Sizes of outputs as of their last run, since recycled outputs have no data left to measure
+	std::map<StreamDescriptor, StreamSize> m_streamSizes;
+};
+
+#endif
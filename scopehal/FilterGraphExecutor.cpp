@@ -42,22 +42,18 @@ using namespace std;
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Construction / destruction
 
-FilterGraphExecutor::FilterGraphExecutor(size_t numThreads)
-	: m_allWorkersComplete(true)
-	, m_terminating(false)
+FilterGraphExecutor::FilterGraphExecutor(size_t numThreads, ThreadPool& pool)
+	: m_pool(pool)
+	, m_maxRunners(max(numThreads, (size_t)1))
+	, m_activeRunners(0)
+	, m_allWorkersComplete(true)
 {
-	//Create our thread pool
-	for(size_t i=0; i<numThreads; i++)
-		m_threads.push_back(make_unique<thread>(&FilterGraphExecutor::ExecutorThread, this, i));
 }
 
 FilterGraphExecutor::~FilterGraphExecutor()
 {
-	//Terminate worker threads
-	m_terminating = true;
-	m_workerCvar.notify_all();
-	for(auto& t : m_threads)
-		t->join();
+	//RunBlocking() doesn't return until every runner has exited, so nothing on the pool still references us
+	m_workerContexts.clear();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -65,6 +61,9 @@ FilterGraphExecutor::~FilterGraphExecutor()
 
 /**
 	@brief Evaluates the filter graph, blocking until execution has completed
+
+	If a node throws, no further nodes are started. Once the nodes already running have finished, the first exception
+	is rethrown here.
  */
 void FilterGraphExecutor::RunBlocking(const set<FlowGraphNode*>& nodes)
 {
@@ -77,6 +76,18 @@ void FilterGraphExecutor::RunBlocking(const set<FlowGraphNode*>& nodes)
 		m_currentExecutionTime.clear();
 	}
 
+	//Forget about nodes that are no longer part of the graph
+	{
+		lock_guard<mutex> lock(m_runStateMutex);
+		for(auto it = m_lastRunState.begin(); it != m_lastRunState.end(); )
+		{
+			if(nodes.find(it->first) == nodes.end())
+				it = m_lastRunState.erase(it);
+			else
+				++it;
+		}
+	}
+
 	{
 		lock_guard<mutex> lock(m_mutex);
 
@@ -87,24 +98,58 @@ void FilterGraphExecutor::RunBlocking(const set<FlowGraphNode*>& nodes)
 		m_incompleteNodes.erase(nullptr);	//don't crash if a null filter somehow ended up in the list
 
 		m_runnableNodes.clear();
-		m_allWorkersComplete = false;
+		m_error = nullptr;
+		{
+			lock_guard<mutex> lock2(m_completionCvarMutex);
+			m_allWorkersComplete = false;
+		}
 
 		Filter::ClearAnalysisCache();
-	}
 
-	//Wake up our workers
-	m_workerCvar.notify_all();
+		//Work out which outputs can be recycled during this run
+		if(m_bufferPlanner.IsEnabled())
+		{
+			m_lastMemoryPlan = m_bufferPlanner.Plan(m_incompleteNodes);
+			LogTrace("Buffer plan: %zu bytes unplanned, %zu bytes projected peak, %zu streams recycled, %zu in place\n",
+				m_lastMemoryPlan.m_unplannedBytes,
+				m_lastMemoryPlan.m_plannedPeakBytes,
+				m_lastMemoryPlan.m_recycledStreams,
+				m_lastMemoryPlan.m_inPlaceNodes);
+		}
+		m_bufferPlanner.Begin(m_incompleteNodes);
 
-	//Block until they're finished
-	while(true)
+		//Start evaluating everything that doesn't depend on anything else
+		m_activeRunners = 0;
+		LaunchRunners();
+		if(m_activeRunners == 0)
+		{
+			lock_guard<mutex> lock2(m_completionCvarMutex);
+			m_allWorkersComplete = true;
+		}
+	}
+
+	//Block until the runners are finished
 	{
 		unique_lock<mutex> lock(m_completionCvarMutex);
 		m_completionCvar.wait(lock, [this]{return m_allWorkersComplete;});
+	}
 
-		lock_guard<mutex> lock2(m_mutex);
-		if(m_runnableNodes.empty())
-			break;
+	//Tell every instrument feeding the graph that the waveforms it delivered have been consumed.
+	//Do this even if a node failed, so instruments waiting on the notification don't stall.
+	set<Oscilloscope*> scopes;
+	for(auto f : nodes)
+	{
+		if(!f)
+			continue;
+		for(size_t i=0; i<f->GetInputCount(); i++)
+		{
+			auto chan = dynamic_cast<OscilloscopeChannel*>(f->GetInput(i).m_channel);
+			if(chan && chan->GetScope())
+				scopes.emplace(chan->GetScope());
+		}
 	}
+	for(auto scope : scopes)
+		scope->NotifyWaveformProcessed();
 
 	//Update global performance stats
 	{
@@ -120,45 +165,64 @@ void FilterGraphExecutor::RunBlocking(const set<FlowGraphNode*>& nodes)
 		for(auto& it : m_currentExecutionTime)
 			m_lastExecutionTime[it.first] = (m_lastExecutionTime[it.first] * decay) + (it.second * (1-decay));
 	}
+
+	//Pass on any failure to the caller, now that instruments have been notified and stats are up to date
+	exception_ptr error;
+	{
+		lock_guard<mutex> lock(m_mutex);
+		swap(error, m_error);
+	}
+	if(error)
+		rethrow_exception(error);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Scheduling
 
 /**
-	@brief Returns the next filter available to run, blocking if none are ready.
+	@brief Returns the next filter available to run
 
-	Returns null if there are no remaining filters to evaluate.
+	Returns null if no filters are ready to run right now (either because everything is done, or because everything
+	left is waiting on filters that are still running).
  */
 FlowGraphNode* FilterGraphExecutor::GetNextRunnableNode()
 {
-	while(true)
-	{
-		//Check for stuff
-		{
-			lock_guard<mutex> lock(m_mutex);
+	lock_guard<mutex> lock(m_mutex);
 
-			//Nothing left to run? Stop
-			if(m_incompleteNodes.empty())
-				return nullptr;
+	//Nothing left to run? Stop
+	if(m_incompleteNodes.empty())
+		return nullptr;
 
-			//Nothing ready to run? Update the run queue
-			if(m_runnableNodes.empty())
-				UpdateRunnable();
+	//Nothing ready to run? Update the run queue
+	if(m_runnableNodes.empty())
+		UpdateRunnable();
 
-			//If there is something ready to run, grab it
-			if(!m_runnableNodes.empty())
-			{
-				auto f = *m_runnableNodes.begin();
-				m_runnableNodes.erase(f);
-				m_runningNodes.emplace(f);
-				return f;
-			}
-		}
+	//If there is something ready to run, grab it
+	if(m_runnableNodes.empty())
+		return nullptr;
+
+	auto f = *m_runnableNodes.begin();
+	m_runnableNodes.erase(f);
+	m_runningNodes.emplace(f);
+	return f;
+}
+
+/**
+	@brief Queues more runner tasks on the pool if there are runnable nodes nobody is going to pick up
+
+	Assumes m_mutex is locked
+ */
+void FilterGraphExecutor::LaunchRunners()
+{
+	UpdateRunnable();
 
-		//Still nothing to run? Block
-		unique_lock<mutex> lock(m_workerCvarMutex);
-		m_workerCvar.wait(lock);
+	//Runners not currently evaluating a node will grab the next runnable one themselves
+	size_t idle = m_activeRunners - m_runningNodes.size();
+	while( (m_activeRunners < m_maxRunners) && (idle < m_runnableNodes.size()) )
+	{
+		m_activeRunners ++;
+		idle ++;
+		m_pool.Submit([this]{ RunNodes(); });
 	}
 }
 
@@ -169,10 +233,6 @@ FlowGraphNode* FilterGraphExecutor::GetNextRunnableNode()
  */
 void FilterGraphExecutor::UpdateRunnable()
 {
-	//Do nothing if we already have other filters marked runnable
-	if(!m_runnableNodes.empty())
-		return;
-
 	//Look for new filters that are eligible to run
 	for(auto f : m_incompleteNodes)
 	{
@@ -199,135 +259,255 @@ void FilterGraphExecutor::UpdateRunnable()
 	}
 }
 
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// 	Main parallel execution logic
+/**
+	@brief Checks if a node can be skipped because nothing it depends on has changed since its last run
+
+	Only nodes which opt in via CanSkipRefreshWhenUnchanged() are ever skipped. Nodes with no inputs, null inputs, or
+	missing output data are always run.
+ */
+bool FilterGraphExecutor::CanSkipNode(FlowGraphNode* f)
+{
+	if(!f->CanSkipRefreshWhenUnchanged())
+		return false;
+
+	size_t nin = f->GetInputCount();
+	if(nin == 0)
+		return false;
+
+	//If our output was cleared by someone else, we need to regenerate it
+	auto chan = dynamic_cast<InstrumentChannel*>(f);
+	if(chan)
+	{
+		for(size_t i=0; i<chan->GetStreamCount(); i++)
+		{
+			if(chan->GetData(i) == nullptr)
+				return false;
+		}
+	}
+
+	lock_guard<mutex> lock(m_runStateMutex);
+	auto it = m_lastRunState.find(f);
+	if(it == m_lastRunState.end())
+		return false;
+	auto& state = it->second;
+
+	if(f->ParametersChangedSince(state.m_paramRevision))
+		return false;
+
+	if(state.m_inputs.size() != nin)
+		return false;
+	for(size_t i=0; i<nin; i++)
+	{
+		auto data = f->GetInput(i).GetData();
+		if(!data || (state.m_inputs[i] != data))
+			return false;
+	}
+
+	return true;
+}
 
 /**
-	@brief Thread function to handle filter graph execution
+	@brief Records the inputs and parameters a node was just run with
  */
-void FilterGraphExecutor::ExecutorThread(FilterGraphExecutor* pThis, size_t i)
+void FilterGraphExecutor::SaveNodeState(FlowGraphNode* f)
 {
-	#ifdef __linux__
-	pthread_setname_np(pthread_self(), "FilterGraph");
-	#endif
+	if(!f->CanSkipRefreshWhenUnchanged())
+		return;
 
-	//Make locale handling thread safe on Windows
-	#ifdef _WIN32
-	_configthreadlocale(_ENABLE_PER_THREAD_LOCALE);
-	Unit::SetDefaultLocale();
-	#endif
+	NodeRunState state;
+	state.m_paramRevision = f->GetParametersRevision();
+	for(size_t i=0; i<f->GetInputCount(); i++)
+	{
+		auto data = f->GetInput(i).GetData();
+		state.m_inputs.push_back(data ? WaveformCacheKey(data) : WaveformCacheKey());
+	}
 
-	pThis->DoExecutorThread(i);
+	lock_guard<mutex> lock(m_runStateMutex);
+	m_lastRunState[f] = state;
 }
 
-void FilterGraphExecutor::DoExecutorThread(size_t i)
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// 	Main parallel execution logic
+
+/**
+	@brief Gets the Vulkan state for the calling pool thread, creating it on first use
+ */
+FilterGraphExecutor::WorkerContext& FilterGraphExecutor::GetWorkerContext()
 {
+	lock_guard<mutex> lock(m_workerContextMutex);
+	auto& ctx = m_workerContexts[this_thread::get_id()];
+	if(ctx)
+		return *ctx;
+
 	//Create a queue and command buffer for this thread's accelerated processing
-	std::shared_ptr<QueueHandle> queue(g_vkQueueManager->GetComputeQueue("FilterGraphExecutor[" + to_string(i) + "].queue"));
+	string prefix = string("FilterGraphExecutor[") + to_string(m_workerContexts.size() - 1) + "]";
+	ctx = make_unique<WorkerContext>();
+	ctx->m_queue = g_vkQueueManager->GetComputeQueue(prefix + ".queue");
 	vk::CommandPoolCreateInfo poolInfo(
 		vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
-		queue->m_family );
-	vk::raii::CommandPool pool(*g_vkComputeDevice, poolInfo);
+		ctx->m_queue->m_family );
+	ctx->m_pool = make_unique<vk::raii::CommandPool>(*g_vkComputeDevice, poolInfo);
 
-	vk::CommandBufferAllocateInfo bufinfo(*pool, vk::CommandBufferLevel::ePrimary, 1);
-	vk::raii::CommandBuffer cmdbuf(std::move(vk::raii::CommandBuffers(*g_vkComputeDevice, bufinfo).front()));
+	vk::CommandBufferAllocateInfo bufinfo(**ctx->m_pool, vk::CommandBufferLevel::ePrimary, 1);
+	ctx->m_cmdbuf = make_unique<vk::raii::CommandBuffer>(
+		std::move(vk::raii::CommandBuffers(*g_vkComputeDevice, bufinfo).front()));
 
 	if(g_hasDebugUtils)
 	{
-		string prefix = string("FilterGraphExecutor[") + to_string(i) + "]";
-
 		string poolname = prefix + ".pool";
 		string bufname = prefix + ".cmdbuf";
 
 		g_vkComputeDevice->setDebugUtilsObjectNameEXT(
 			vk::DebugUtilsObjectNameInfoEXT(
 				vk::ObjectType::eCommandPool,
-				reinterpret_cast<uint64_t>(static_cast<VkCommandPool>(*pool)),
+				reinterpret_cast<uint64_t>(static_cast<VkCommandPool>(**ctx->m_pool)),
 				poolname.c_str()));
 
 		g_vkComputeDevice->setDebugUtilsObjectNameEXT(
 			vk::DebugUtilsObjectNameInfoEXT(
 				vk::ObjectType::eCommandBuffer,
-				reinterpret_cast<uint64_t>(static_cast<VkCommandBuffer>(*cmdbuf)),
+				reinterpret_cast<uint64_t>(static_cast<VkCommandBuffer>(**ctx->m_cmdbuf)),
 				bufname.c_str()));
 	}
 
-	//Main loop
+	return *ctx;
+}
+
+/**
+	@brief Runner task: evaluates nodes as they become available, then exits when there's nothing left to do
+ */
+void FilterGraphExecutor::RunNodes()
+{
+	WorkerContext* ctx = nullptr;
+
 	while(true)
 	{
+		auto f = GetNextRunnableNode();
+		if(f)
 		{
-			//Wait until the main thread starts a new round of execution, or the timeout elapses
-			//When we time out, check if we're shutting down
-			unique_lock<mutex> lock(m_workerCvarMutex);
-			m_workerCvar.wait_for(lock, chrono::milliseconds(50));
+			//Don't let an exception escape, or we'd never decrement m_activeRunners and RunBlocking() would hang
+			try
+			{
+				if(!ctx)
+					ctx = &GetWorkerContext();
+				RunNode(f, *ctx);
+			}
+			catch(...)
+			{
+				AbortRun(f, current_exception());
+			}
+			continue;
 		}
 
-		//If they woke us up because the context is being destroyed, we're done
-		if(m_terminating)
-			break;
+		//Nothing to run. Check again under the lock, since a node may have finished since we looked, and
+		//LaunchRunners() counted on us to pick up what it unblocked
+		{
+			lock_guard<mutex> lock(m_mutex);
+			UpdateRunnable();
+			if(!m_runnableNodes.empty())
+				continue;
 
-		//If we're already done, nothing to do
-		if(m_allWorkersComplete)
-			continue;
+			m_activeRunners --;
+			if(m_activeRunners != 0)
+				return;
 
-		//Evaluate nodes as they become available, then stop when there's nothing left to do
-		FlowGraphNode* f;
-		while( (f = GetNextRunnableNode()) != nullptr)
-		{
-			shared_lock<shared_mutex> lock(g_vulkanActivityMutex);
+			//We were the last runner. If this was the last filter (nothing left incomplete), we're done.
+			//If not, nothing can ever become runnable, so give up rather than hanging.
+			if(!m_incompleteNodes.empty())
+				LogWarning("Filter graph evaluation stalled with %zu nodes incomplete\n", m_incompleteNodes.size());
+		}
 
-			//Make sure the filter's inputs are where we need them
-			auto loc = f->GetInputLocation();
-			if(loc != Filter::LOC_DONTCARE)
-			{
-				bool expectGpuInput = (loc == Filter::LOC_GPU);
-				bool expectCpuInput = (loc == Filter::LOC_CPU);
-				for(size_t j=0; j<f->GetInputCount(); j++)
-				{
-					auto data = f->GetInput(j).GetData();
-					if(data)
-					{
-						if(expectGpuInput)
-							data->PrepareForGpuAccess();
-						else if(expectCpuInput)
-							data->PrepareForCpuAccess();
-					}
-				}
-			}
+		//Wake up the main thread. Notify with the mutex held, since we may be destroyed as soon as it wakes up.
+		lock_guard<mutex> lock(m_completionCvarMutex);
+		m_allWorkersComplete = true;
+		m_completionCvar.notify_all();
+		return;
+	}
+}
 
-			//Actually execute the filter
-			double start = GetTime();
-			f->Refresh(cmdbuf, queue);
-			double dt = GetTime() - start;
-			{
-				lock_guard<mutex> slock(m_perfStatsMutex);
-				m_currentExecutionTime[f] = dt * FS_PER_SECOND;
-			}
+/**
+	@brief Stops the current run after a node failed
 
-			//Filter execution has completed, remove it from the running list and mark as completed
-			lock_guard<mutex> lock2(m_mutex);
-			m_runningNodes.erase(f);
-			m_incompleteNodes.erase(f);
+	Nodes which are already running are allowed to finish, but nothing else is started. The first error is saved for
+	RunBlocking() to rethrow.
 
-			//Wake up all threads that might have been waiting on this filter to complete
-			m_workerCvar.notify_all();
-		}
+	@param f		The node that failed
+	@param error	The exception it threw
+ */
+void FilterGraphExecutor::AbortRun(FlowGraphNode* f, exception_ptr error)
+{
+	lock_guard<mutex> lock(m_mutex);
+
+	if(!m_error)
+		m_error = error;
 
-		//We have no more filters to run.
-		//If this was the last filter (nothing left incomplete), we're done - wake up the main thread
-		bool empty = false;
+	m_runningNodes.erase(f);
+	m_runnableNodes.clear();
+	m_incompleteNodes.clear();
+}
+
+/**
+	@brief Evaluates a single node
+ */
+void FilterGraphExecutor::RunNode(FlowGraphNode* f, WorkerContext& ctx)
+{
+	//Nothing changed since the last run? Keep the existing output
+	if(CanSkipNode(f))
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_bufferPlanner.OnNodeComplete(f);
+		m_runningNodes.erase(f);
+		m_incompleteNodes.erase(f);
+		LaunchRunners();
+		return;
+	}
+
+	{
+		shared_lock<shared_mutex> lock(g_vulkanActivityMutex);
+
+		//If this node is the last consumer of its input, it may be able to write its output over it
 		{
 			lock_guard<mutex> lock2(m_mutex);
-			empty = m_incompleteNodes.empty();
+			m_bufferPlanner.PrepareInPlace(f);
 		}
-		if(empty)
+
+		//Make sure the filter's inputs are where we need them
+		auto loc = f->GetInputLocation();
+		if(loc != Filter::LOC_DONTCARE)
 		{
+			bool expectGpuInput = (loc == Filter::LOC_GPU);
+			bool expectCpuInput = (loc == Filter::LOC_CPU);
+			for(size_t j=0; j<f->GetInputCount(); j++)
 			{
-				lock_guard<mutex> lock3(m_completionCvarMutex);
-				m_allWorkersComplete = true;
+				auto data = f->GetInput(j).GetData();
+				if(data)
+				{
+					if(expectGpuInput)
+						data->PrepareForGpuAccess();
+					else if(expectCpuInput)
+						data->PrepareForCpuAccess();
+				}
 			}
+		}
 
-			m_completionCvar.notify_all();
+		//Actually execute the filter
+		double start = GetTime();
+		f->Refresh(*ctx.m_cmdbuf, ctx.m_queue);
+		double dt = GetTime() - start;
+		{
+			lock_guard<mutex> slock(m_perfStatsMutex);
+			m_currentExecutionTime[f] = dt * FS_PER_SECOND;
 		}
+		SaveNodeState(f);
 	}
+
+	//Filter execution has completed, remove it from the running list and mark as completed.
+	//Any outputs nobody else needs can now be recycled.
+	lock_guard<mutex> lock(m_mutex);
+	m_bufferPlanner.OnNodeComplete(f);
+	m_runningNodes.erase(f);
+	m_incompleteNodes.erase(f);
+
+	//Start runners for anything this unblocked
+	LaunchRunners();
 }
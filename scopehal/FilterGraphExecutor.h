@@ -39,15 +39,20 @@
 
 #include <condition_variable>
 #include <atomic>
+#include <exception>
 
 /**
 	@brief Execution manager / scheduler for the filter graph
+
+	Nodes are evaluated as top level tasks on a ThreadPool, so parallel loops inside filters share the same worker
+	threads as graph evaluation rather than each starting their own.
+
 	@ingroup core
  */
 class FilterGraphExecutor
 {
 public:
-	FilterGraphExecutor(size_t numThreads = 8);
+	FilterGraphExecutor(size_t numThreads = 8, ThreadPool& pool = ThreadPool::GetDefault());
 	~FilterGraphExecutor();
 
 	void RunBlocking(const std::set<FlowGraphNode*>& nodes);
@@ -61,12 +66,64 @@ public:
 		return m_lastExecutionTime;
 	}
 
+	/**
+		@brief Turns on buffer planning, recycling filter outputs that aren't observed once nothing else needs them
+
+		@param streams	Every stream which will be read after each run (see FilterGraphBufferPlanner)
+	 */
+	void SetObservedStreams(const std::set<StreamDescriptor>& streams)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bufferPlanner.SetObservedStreams(streams);
+	}
+
+	///@brief Turns off buffer planning, so every filter keeps its outputs
+	void DisableBufferPlanning()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bufferPlanner.Disable();
+	}
+
+	///@brief Projects the memory usage of evaluating a set of nodes, without running anything
+	FilterGraphMemoryPlan PlanMemory(const std::set<FlowGraphNode*>& nodes)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_bufferPlanner.Plan(nodes);
+	}
+
+	///@brief Get the memory projection made at the start of the most recent planned evaluation
+	FilterGraphMemoryPlan GetLastMemoryPlan()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_lastMemoryPlan;
+	}
+
 protected:
-	static void ExecutorThread(FilterGraphExecutor* pThis, size_t i);
-	void DoExecutorThread(size_t i);
+
+	///@brief Vulkan state for evaluating nodes on one pool thread
+	struct WorkerContext
+	{
+		///@brief Queue for the thread's accelerated processing
+		std::shared_ptr<QueueHandle> m_queue;
+
+		///@brief Command pool for m_cmdbuf
+		std::unique_ptr<vk::raii::CommandPool> m_pool;
+
+		///@brief Command buffer for the thread's accelerated processing
+		std::unique_ptr<vk::raii::CommandBuffer> m_cmdbuf;
+	};
+
+	WorkerContext& GetWorkerContext();
+	void RunNodes();
+	void RunNode(FlowGraphNode* f, WorkerContext& ctx);
+	void AbortRun(FlowGraphNode* f, std::exception_ptr error);
+	void LaunchRunners();
 
 	void UpdateRunnable();
 
+	bool CanSkipNode(FlowGraphNode* f);
+	void SaveNodeState(FlowGraphNode* f);
+
 	///@brief Mutex for access to shared state
 	std::mutex m_mutex;
 
@@ -79,14 +136,23 @@ protected:
 	///@brief Nodes that are actively being run
 	std::set<FlowGraphNode*> m_runningNodes;
 
-	///@brief Set of thread contexts
-	std::vector<std::unique_ptr<std::thread>> m_threads;
+	///@brief The pool nodes are evaluated on
+	ThreadPool& m_pool;
+
+	///@brief Maximum number of nodes to evaluate at once
+	size_t m_maxRunners;
+
+	///@brief Number of runner tasks currently queued or running on the pool (protected by m_mutex)
+	size_t m_activeRunners;
+
+	///@brief First exception thrown by a node during the current run (protected by m_mutex)
+	std::exception_ptr m_error;
 
-	///@brief Condition variable for waking up worker threads when work arrives
-	std::condition_variable m_workerCvar;
+	///@brief Vulkan state for each pool thread that has evaluated a node
+	std::map<std::thread::id, std::unique_ptr<WorkerContext>> m_workerContexts;
 
-	///@brief Mutex for access to m_workerCvar
-	std::mutex m_workerCvarMutex;
+	///@brief Mutex for access to m_workerContexts
+	std::mutex m_workerContextMutex;
 
 	///@brief Condition variable for waking up main thread when work is complete
 	std::condition_variable m_completionCvar;
@@ -97,9 +163,6 @@ protected:
 	///@brief Indicates that all worker threads have finished executing this pass
 	bool m_allWorkersComplete;
 
-	///@brief Shutdown flag
-	bool m_terminating;
-
 	///@brief Performance statistics from previous execution
 	std::map<FlowGraphNode*, int64_t> m_lastExecutionTime;
 
@@ -108,6 +171,28 @@ protected:
 
 	///@brief Mutex for updating performance statistics
 	std::mutex m_perfStatsMutex;
+
+	///@brief Inputs and parameters a node saw the last time it was run
+	struct NodeRunState
+	{
+		///@brief Revision of every input waveform
+		std::vector<WaveformCacheKey> m_inputs;
+
+		///@brief Newest parameter revision
+		uint64_t m_paramRevision;
+	};
+
+	///@brief State of each node as of its most recent run, for skipping nodes whose inputs haven't changed
+	std::map<FlowGraphNode*, NodeRunState> m_lastRunState;
+
+	///@brief Mutex for access to m_lastRunState
+	std::mutex m_runStateMutex;
+
+	///@brief Liveness tracking for recycling dead filter outputs (protected by m_mutex)
+	FilterGraphBufferPlanner m_bufferPlanner;
+
+	///@brief Memory projection for the most recent planned evaluation
+	FilterGraphMemoryPlan m_lastMemoryPlan;
 };
 
 #endif
@@ -39,6 +39,8 @@
 
 using namespace std;
 
+atomic<uint64_t> FilterParameter::m_nextRevision(0);
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // FilterParameter
 
@@ -57,6 +59,7 @@ FilterParameter::FilterParameter(ParameterTypes type, Unit unit)
 	, m_string("")
 	, m_hidden(false)
 	, m_readOnly(false)
+	, m_revision(++m_nextRevision)
 {
 
 }
@@ -94,6 +97,15 @@ FilterParameter FilterParameter::UnitSelector()
 	return ret;
 }
 
+/**
+	@brief Assigns a new revision to the parameter and notifies anyone listening for changes
+ */
+void FilterParameter::MarkChanged()
+{
+	m_revision = ++m_nextRevision;
+	m_changeSignal.emit();
+}
+
 /**
 	@brief Reinterprets our string representation (in case our type or enums changed)
  */
@@ -216,7 +228,7 @@ void FilterParameter::ParseString(const string& str, bool useDisplayLocale)
 			break;
 	}
 
-	m_changeSignal.emit();
+	MarkChanged();
 }
 
 /**
@@ -298,7 +310,7 @@ void FilterParameter::SetBoolVal(bool b)
 	m_string = b ? "1" : "0";
 	m_8b10bPattern.clear();
 
-	m_changeSignal.emit();
+	MarkChanged();
 }
 
 /**
@@ -314,7 +326,7 @@ void FilterParameter::SetIntVal(int64_t i)
 	if(m_reverseEnumMap.find(i) != m_reverseEnumMap.end())
 		m_string = m_reverseEnumMap[i];
 
-	m_changeSignal.emit();
+	MarkChanged();
 }
 
 /**
@@ -327,7 +339,7 @@ void FilterParameter::SetFloatVal(float f)
 	m_string = "";
 	m_8b10bPattern.clear();
 
-	m_changeSignal.emit();
+	MarkChanged();
 }
 
 /**
@@ -348,7 +360,7 @@ void FilterParameter::SetFileName(const string& f)
 	m_string = f;
 	m_8b10bPattern.clear();
 
-	m_changeSignal.emit();
+	MarkChanged();
 }
 
 void FilterParameter::Set8B10BPattern(const vector<T8B10BSymbol>& pattern)
@@ -358,5 +370,5 @@ void FilterParameter::Set8B10BPattern(const vector<T8B10BSymbol>& pattern)
 	m_8b10bPattern = pattern;
 	m_string = ToString();
 
-	m_changeSignal.emit();
+	MarkChanged();
 }
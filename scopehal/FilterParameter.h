@@ -37,6 +37,9 @@
 #ifndef FilterParameter_h
 #define FilterParameter_h
 
+#include <atomic>
+#include <type_traits>
+
 /**
 	@brief An 8B/10B symbol within a pattern, used for trigger matching
 	@ingroup core
@@ -160,7 +163,26 @@ public:
 		@brief Change the units of the parameter
 	 */
 	void SetUnit(Unit u)
-	{ m_unit = u; }
+	{
+		m_unit = u;
+		m_revision = ++m_nextRevision;
+	}
+
+	/**
+		@brief Returns the revision of the parameter
+
+		Revisions are drawn from a single global counter, so every change to any parameter gets a revision number
+		greater than every change which came before it. This allows a filter to check whether any of its parameters
+		changed since a given point in time by comparing against a single saved value.
+	 */
+	uint64_t GetRevision() const
+	{ return m_revision; }
+
+	/**
+		@brief Returns the most recently issued parameter revision
+	 */
+	static uint64_t GetLatestRevision()
+	{ return m_nextRevision; }
 
 	//File filters for TYPE_FILENAME (otherwise ignored)
 	std::string m_fileFilterMask;
@@ -182,7 +204,7 @@ public:
 	/**
 		@brief Gets a list of valid enumerated parameter names for a TYPE_ENUM parameter.
 	 */
-	void GetEnumValues(std::vector<std::string>& values)
+	void GetEnumValues(std::vector<std::string>& values) const
 	{
 		for(auto it : m_forwardEnumMap)
 			values.push_back(it.first);
@@ -225,7 +247,7 @@ public:
 	/**
 		@brief Checks if this parameter should be hidden in the GUI.
 	 */
-	bool IsHidden()
+	bool IsHidden() const
 	{ return m_hidden; }
 
 	/**
@@ -240,10 +262,12 @@ public:
 	/**
 		@brief Checks if this parameter should be read-only in the GUI.
 	 */
-	bool IsReadOnly()
+	bool IsReadOnly() const
 	{ return m_readOnly; }
 
 protected:
+	void MarkChanged();
+
 	ParameterTypes				m_type;
 
 	sigc::signal<void()>		m_changeSignal;
@@ -262,6 +286,102 @@ protected:
 
 	bool						m_hidden;
 	bool						m_readOnly;
+
+	///@brief Revision of the current value (see GetRevision())
+	uint64_t					m_revision;
+
+	///@brief Global revision counter shared by all parameters
+	static std::atomic<uint64_t> m_nextRevision;
+};
+
+/**
+	@brief Typed handle to a FilterParameter, resolved once when the owning node is constructed
+
+	Reading a parameter through m_parameters[name] costs a string-keyed map lookup every time. A handle holds a pointer
+	straight to the map entry (std::map nodes never move) so values can be read in O(1) from Refresh() or per-packet
+	code, and carries the revision of the value last seen so filters can detect changes without keeping their own copy
+	of every setting.
+
+	T selects the accessor used by Get(): bool, any integer or enum type, float/double, or std::string (file names and
+	strings).
+
+	A handle must not outlive the parameter it refers to, so filters which erase parameters (e.g. CTLEFilter clearing
+	the parameters of its base class) must only take handles to the ones they create afterwards.
+
+	@ingroup core
+ */
+template<class T>
+class FilterParameterHandle
+{
+public:
+	FilterParameterHandle(FilterParameter* param = nullptr)
+	: m_param(param)
+	, m_seenRevision(0)
+	{}
+
+	///@brief Returns the current value of the parameter
+	T Get() const
+	{
+		if constexpr(std::is_same_v<T, bool>)
+			return m_param->GetBoolVal();
+		else if constexpr(std::is_enum_v<T> || std::is_integral_v<T>)
+			return static_cast<T>(m_param->GetIntVal());
+		else if constexpr(std::is_floating_point_v<T>)
+			return static_cast<T>(m_param->GetFloatVal());
+		else
+			return m_param->GetFileName();
+	}
+
+	///@brief Shorthand for Get()
+	operator T() const
+	{ return Get(); }
+
+	///@brief Sets the value of the parameter
+	void Set(T value)
+	{
+		if constexpr(std::is_same_v<T, bool>)
+			m_param->SetBoolVal(value);
+		else if constexpr(std::is_enum_v<T> || std::is_integral_v<T>)
+			m_param->SetIntVal(static_cast<int64_t>(value));
+		else if constexpr(std::is_floating_point_v<T>)
+			m_param->SetFloatVal(value);
+		else
+			m_param->SetStringVal(value);
+	}
+
+	///@brief Returns the underlying parameter
+	FilterParameter& operator*() const
+	{ return *m_param; }
+
+	///@brief Returns the underlying parameter
+	FilterParameter* operator->() const
+	{ return m_param; }
+
+	///@brief Returns the revision of the parameter
+	uint64_t GetRevision() const
+	{ return m_param->GetRevision(); }
+
+	/**
+		@brief Checks if the parameter has changed since the last call to this function
+
+		Always returns true on the first call.
+	 */
+	bool CheckChanged()
+	{
+		auto rev = m_param->GetRevision();
+		if(rev == m_seenRevision)
+			return false;
+		m_seenRevision = rev;
+		return true;
+	}
+
+protected:
+
+	///@brief The parameter we refer to
+	FilterParameter* m_param;
+
+	///@brief Revision of the parameter as of the last CheckChanged() call
+	uint64_t m_seenRevision;
 };
 
 #endif
@@ -123,6 +123,20 @@ FilterParameter& FlowGraphNode::GetParameter(string s)
 	return m_parameters[s];
 }
 
+/**
+	@brief Returns the newest revision of any of our parameters
+
+	Since parameter revisions come from a single global counter, the value can be saved and later passed to
+	ParametersChangedSince() to see if anything was modified in between.
+ */
+uint64_t FlowGraphNode::GetParametersRevision()
+{
+	uint64_t rev = 0;
+	for(auto& it : m_parameters)
+		rev = max(rev, it.second.GetRevision());
+	return rev;
+}
+
 size_t FlowGraphNode::GetInputCount()
 {
 	return m_signalNames.size();
@@ -102,6 +102,57 @@ public:
 	size_t GetParamCount()
 	{ return m_parameters.size(); }
 
+	/**
+		@brief Gets a typed handle to a parameter, for O(1) access without a map lookup
+
+		Handles are normally resolved once in the constructor, right after the parameter is created.
+
+		Unlike GetParameter(), this does not create the parameter if it doesn't exist: a misspelled name is a bug in
+		the filter, so it's reported and thrown rather than silently handing back a default-constructed parameter.
+
+		@param s	Name of the parameter
+	 */
+	template<class T>
+	FilterParameterHandle<T> GetParameterHandle(const std::string& s)
+	{
+		auto it = m_parameters.find(s);
+		if(it == m_parameters.end())
+		{
+			LogError("GetParameterHandle: no parameter named \"%s\"\n", s.c_str());
+			throw std::invalid_argument("GetParameterHandle: no parameter named \"" + s + "\"");
+		}
+		return FilterParameterHandle<T>(&it->second);
+	}
+
+	uint64_t GetParametersRevision();
+
+	/**
+		@brief Checks if any of our parameters changed since a given revision
+
+		@param rev	Revision from a previous call to GetParametersRevision()
+	 */
+	bool ParametersChangedSince(uint64_t rev)
+	{ return GetParametersRevision() > rev; }
+
+	/**
+		@brief Checks if Refresh() may be skipped when no inputs or parameters have changed since the last run
+
+		Returns false by default. Nodes should only override this if their output depends on nothing other than their
+		input waveforms and parameters (no files, timers, hardware or other external state).
+	 */
+	virtual bool CanSkipRefreshWhenUnchanged()
+	{ return false; }
+
+	/**
+		@brief Checks if Refresh() works when output stream 0 is the same waveform object as input 0
+
+		Returns false by default. A node overriding this must detect the aliasing (GetData(0) == input waveform) and
+		overwrite the samples in place, without clearing or resizing the waveform first. FilterGraphExecutor uses this
+		to recycle an input's buffer into the output when nothing else needs the input afterwards.
+	 */
+	virtual bool CanRefreshInPlace()
+	{ return false; }
+
 	/**
 		@brief Serializes this trigger's configuration to a YAML string.
 
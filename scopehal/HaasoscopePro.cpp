@@ -63,6 +63,9 @@ HaasoscopePro::HaasoscopePro(SCPITransport* transport)
 	, m_diag_droppedWFMs(FilterParameter::TYPE_INT, Unit(Unit::UNIT_COUNTS))
 	, m_diag_droppedPercent(FilterParameter::TYPE_FLOAT, Unit(Unit::UNIT_PERCENT))
 {
+	//Never queue more than two waveforms, drop the oldest if the consumer falls behind
+	SetPendingQueueLimits(2, 0, QUEUE_DROP_OLDEST);
+
 	m_analogChannelCount = 4;
 
 	//Add analog channel objects
@@ -452,8 +455,8 @@ bool HaasoscopePro::AcquireData()
 	else
 	{
 		LogTrace("HaasoscopePro doing GPU path \n");
-		#pragma omp parallel for  //Process analog captures in parallel
-		for(size_t i=0; i<awfms.size(); i++)
+		//Process analog captures in parallel
+		ThreadPool::GetDefault().ParallelFor(0, awfms.size(), [&](size_t i)
 		{
 			auto cap = awfms[i];
 			cap->PrepareForCpuAccess();
@@ -464,7 +467,7 @@ bool HaasoscopePro::AcquireData()
 				offsets[i],
 				cap->m_samples.size());
 			cap->MarkModifiedFromCpu();
-		}
+		});
 	}
 
 	FilterParameter* param = &m_diag_totalWFMs;
@@ -476,18 +479,8 @@ bool HaasoscopePro::AcquireData()
 
 	//Save the waveforms to our queue
 	m_pendingWaveformsMutex.lock();
-	m_pendingWaveforms.push_back(s);
-
-	while (m_pendingWaveforms.size() > 2)
-	{
-		SequenceSet set = *m_pendingWaveforms.begin();
-		for(auto it : set)
-			delete it.second;
-		m_pendingWaveforms.pop_front();
-
-		dropped++;
-	}
-
+	//Queue depth is limited to two waveforms, if we get backed up the oldest ones are dropped
+	dropped += PushPendingWaveform(s);
 	m_pendingWaveformsMutex.unlock();
 
 	param->SetIntVal(dropped);
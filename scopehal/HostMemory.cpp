@@ -0,0 +1,426 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of HostMemory
+	@ingroup core
+ */
+
+#include "scopehal.h"
+#include <atomic>
+#include <fstream>
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifdef HAS_NUMA
+#include <numa.h>
+#endif
+
+using namespace std;
+
+///@brief A large buffer mapped directly from the OS
+struct HostMapping
+{
+	///@brief Length of the mapping, rounded up to the page size it was mapped with
+	size_t m_length;
+
+	///@brief True if the mapping came from the explicit huge page pool
+	bool m_hugetlb;
+};
+
+static atomic<HostMemory::HugePageMode> g_hugePageMode(HostMemory::HUGEPAGE_TRANSPARENT);
+static atomic<HostMemory::NumaPolicy> g_numaPolicy(HostMemory::NUMA_DEFAULT);
+static atomic<size_t> g_largeAllocationThreshold(16 * 1024 * 1024);
+static atomic<bool> g_threadPinning(false);
+
+///@brief Mutex protecting g_hostMappings and g_hostMemoryStats
+static mutex g_hostMappingMutex;
+
+///@brief All large buffers currently mapped, indexed by start address
+static map<void*, HostMapping> g_hostMappings;
+
+static HostMemory::Stats g_hostMemoryStats = {0, 0, 0, 0};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Configuration
+
+/**
+	@brief Selects how large buffers are backed
+
+	Only affects buffers allocated after the call.
+ */
+void HostMemory::SetHugePageMode(HugePageMode mode)
+{
+	g_hugePageMode = mode;
+}
+
+HostMemory::HugePageMode HostMemory::GetHugePageMode()
+{
+	return g_hugePageMode;
+}
+
+/**
+	@brief Selects how large buffers are placed across NUMA nodes
+
+	Only affects buffers allocated after the call. NUMA_INTERLEAVE falls back to NUMA_DEFAULT if libscopehal was
+	built without libnuma or the kernel has no NUMA support.
+ */
+void HostMemory::SetNumaPolicy(NumaPolicy policy)
+{
+	if( (policy == NUMA_INTERLEAVE) && !HasNuma())
+	{
+		LogWarning("NUMA interleaving requested but libnuma is not available, using default placement\n");
+		policy = NUMA_DEFAULT;
+	}
+	g_numaPolicy = policy;
+}
+
+HostMemory::NumaPolicy HostMemory::GetNumaPolicy()
+{
+	return g_numaPolicy;
+}
+
+/**
+	@brief Sets the size above which buffers are mapped directly from the OS
+
+	Values below MIN_LARGE_ALLOCATION are clamped to it.
+ */
+void HostMemory::SetLargeAllocationThreshold(size_t bytes)
+{
+	g_largeAllocationThreshold = max(bytes, MIN_LARGE_ALLOCATION);
+}
+
+size_t HostMemory::GetLargeAllocationThreshold()
+{
+	return g_largeAllocationThreshold;
+}
+
+/**
+	@brief Returns true if NUMA placement is available
+ */
+bool HostMemory::HasNuma()
+{
+	#ifdef HAS_NUMA
+		static bool available = (numa_available() >= 0);
+		return available;
+	#else
+		return false;
+	#endif
+}
+
+/**
+	@brief Returns the number of NUMA nodes in the system (1 if NUMA placement is unavailable)
+ */
+size_t HostMemory::GetNumaNodeCount()
+{
+	#ifdef HAS_NUMA
+		if(HasNuma())
+			return numa_max_node() + 1;
+	#endif
+	return 1;
+}
+
+HostMemory::Stats HostMemory::GetStats()
+{
+	lock_guard<mutex> lock(g_hostMappingMutex);
+	return g_hostMemoryStats;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Allocation
+
+#ifdef __linux__
+/**
+	@brief Gets the size of the default explicit huge page
+ */
+static size_t GetHugePageSize()
+{
+	static size_t size = []()
+	{
+		ifstream meminfo("/proc/meminfo");
+		string line;
+		while(getline(meminfo, line))
+		{
+			size_t kb;
+			if(1 == sscanf(line.c_str(), "Hugepagesize: %zu kB", &kb))
+				return kb * 1024;
+		}
+		return HostMemory::MIN_LARGE_ALLOCATION;
+	}();
+	return size;
+}
+#endif
+
+/**
+	@brief Maps a large buffer directly from the OS according to the current huge page and NUMA settings
+
+	@param bytes		Size of the buffer
+	@param alignment	Required alignment (must not exceed the huge page size)
+
+	@return The buffer, or nullptr if it should come from the heap instead (too small, large buffer handling
+			disabled, unsupported platform, or the mapping failed)
+ */
+void* HostMemory::AllocateLarge(size_t bytes, size_t alignment)
+{
+	#ifdef __linux__
+
+		if(bytes < g_largeAllocationThreshold)
+			return nullptr;
+
+		auto mode = g_hugePageMode.load();
+		auto policy = g_numaPolicy.load();
+		if( (mode == HUGEPAGE_NONE) && (policy == NUMA_DEFAULT) )
+			return nullptr;
+
+		size_t thpSize = MIN_LARGE_ALLOCATION;
+		if(alignment > thpSize)
+			return nullptr;
+
+		void* ptr = nullptr;
+		HostMapping mapping = {0, false};
+
+		//Try the explicit huge page pool first if requested
+		//(this fails immediately with ENOMEM if not enough huge pages are reserved)
+		bool fallback = false;
+		if(mode == HUGEPAGE_EXPLICIT)
+		{
+			size_t hugeSize = GetHugePageSize();
+			size_t len = (bytes + hugeSize - 1) / hugeSize * hugeSize;
+			ptr = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+			if(ptr == MAP_FAILED)
+			{
+				ptr = nullptr;
+				fallback = true;
+				mode = HUGEPAGE_TRANSPARENT;
+			}
+			else
+				mapping = {len, true};
+		}
+
+		//Normal anonymous mapping
+		if(!ptr)
+		{
+			size_t pageSize = sysconf(_SC_PAGESIZE);
+			size_t len = (bytes + pageSize - 1) / pageSize * pageSize;
+
+			//Transparent huge pages can only back 2 MB aligned regions, so over-map then trim to alignment
+			size_t slack = (mode == HUGEPAGE_TRANSPARENT) ? thpSize : 0;
+			auto base = reinterpret_cast<uint8_t*>(
+				mmap(nullptr, len + slack, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+			if(base == MAP_FAILED)
+				return nullptr;
+
+			auto start = base;
+			if(slack)
+			{
+				start = reinterpret_cast<uint8_t*>((reinterpret_cast<uintptr_t>(base) + thpSize - 1) & ~(thpSize - 1));
+				size_t head = start - base;
+				size_t tail = slack - head;
+				if(head)
+					munmap(base, head);
+				if(tail)
+					munmap(start + len, tail);
+
+				madvise(start, len, MADV_HUGEPAGE);
+			}
+
+			ptr = start;
+			mapping = {len, false};
+		}
+
+		//Set placement before anything touches the pages
+		#ifdef HAS_NUMA
+			if( (policy == NUMA_INTERLEAVE) && HasNuma())
+				numa_interleave_memory(ptr, mapping.m_length, numa_all_nodes_ptr);
+		#endif
+		if(policy == NUMA_FIRST_TOUCH)
+			FirstTouch(ptr, mapping.m_length);
+
+		lock_guard<mutex> lock(g_hostMappingMutex);
+		g_hostMappings[ptr] = mapping;
+		g_hostMemoryStats.m_liveBuffers ++;
+		g_hostMemoryStats.m_liveBytes += mapping.m_length;
+		if(mapping.m_hugetlb)
+			g_hostMemoryStats.m_hugetlbAllocations ++;
+		if(fallback)
+			g_hostMemoryStats.m_hugetlbFallbacks ++;
+		return ptr;
+
+	#else
+		(void)bytes;
+		(void)alignment;
+		return nullptr;
+	#endif
+}
+
+/**
+	@brief Frees a buffer if it was allocated by AllocateLarge()
+
+	@param ptr		The buffer
+	@param bytes	Size of the buffer, as passed to AllocateLarge()
+
+	@return True if the buffer was ours and has been freed, false if it came from the heap
+ */
+bool HostMemory::FreeLarge(void* ptr, size_t bytes)
+{
+	#ifdef __linux__
+		if( (ptr == nullptr) || (bytes < MIN_LARGE_ALLOCATION) )
+			return false;
+
+		lock_guard<mutex> lock(g_hostMappingMutex);
+		auto it = g_hostMappings.find(ptr);
+		if(it == g_hostMappings.end())
+			return false;
+
+		munmap(ptr, it->second.m_length);
+		g_hostMemoryStats.m_liveBuffers --;
+		g_hostMemoryStats.m_liveBytes -= it->second.m_length;
+		g_hostMappings.erase(it);
+		return true;
+	#else
+		(void)ptr;
+		(void)bytes;
+		return false;
+	#endif
+}
+
+/**
+	@brief Zeroes a new buffer from the thread pool so its pages are spread across the workers' NUMA nodes
+
+	The split matches the one used by the parallel sample conversion loops (one block per pool thread).
+ */
+void HostMemory::FirstTouch(void* ptr, size_t bytes)
+{
+	auto p = reinterpret_cast<uint8_t*>(ptr);
+	auto& pool = ThreadPool::GetDefault();
+	size_t numblocks = pool.GetConcurrency();
+	size_t blocksize = bytes / numblocks;
+
+	pool.ParallelFor(0, numblocks, [&](size_t i)
+	{
+		size_t off = i*blocksize;
+		size_t len = (i == numblocks-1) ? (bytes - off) : blocksize;
+		memset(p + off, 0, len);
+	});
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Thread pinning
+
+/**
+	@brief Enables pinning of ThreadPool workers to CPUs
+
+	Only affects pools created after the call, so call it before the default pool is first used.
+ */
+void HostMemory::SetThreadPinning(bool enable)
+{
+	g_threadPinning = enable;
+}
+
+bool HostMemory::IsThreadPinningEnabled()
+{
+	return g_threadPinning;
+}
+
+#ifdef __linux__
+/**
+	@brief Gets the CPUs we're allowed to run on, ordered round robin across NUMA nodes
+
+	This way consecutive thread indexes are spread evenly across sockets rather than filling up one socket first.
+ */
+static const vector<int>& GetPinningOrder()
+{
+	static vector<int> order = []()
+	{
+		//Use the affinity mask from before anything was pinned
+		vector<int> ret;
+		cpu_set_t allowed;
+		CPU_ZERO(&allowed);
+		if(0 != sched_getaffinity(0, sizeof(allowed), &allowed))
+			return ret;
+
+		map<int, vector<int>> byNode;
+		for(int cpu=0; cpu<CPU_SETSIZE; cpu++)
+		{
+			if(!CPU_ISSET(cpu, &allowed))
+				continue;
+
+			int node = 0;
+			#ifdef HAS_NUMA
+				if(HostMemory::HasNuma())
+					node = max(numa_node_of_cpu(cpu), 0);
+			#endif
+			byNode[node].push_back(cpu);
+		}
+
+		for(size_t i=0; ret.size() < (size_t)CPU_COUNT(&allowed); i++)
+		{
+			for(auto& it : byNode)
+			{
+				if(i < it.second.size())
+					ret.push_back(it.second[i]);
+			}
+		}
+		return ret;
+	}();
+	return order;
+}
+#endif
+
+/**
+	@brief Pins the calling thread to a single CPU
+
+	@param index	Thread index. Consecutive indexes go to CPUs on alternating NUMA nodes, wrapping around if there are
+					more threads than CPUs.
+
+	@return True if the thread was pinned
+ */
+bool HostMemory::PinCurrentThread(size_t index)
+{
+	#ifdef __linux__
+		auto& order = GetPinningOrder();
+		if(order.empty())
+			return false;
+
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(order[index % order.size()], &set);
+		return 0 == pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+	#else
+		(void)index;
+		return false;
+	#endif
+}
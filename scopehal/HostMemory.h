@@ -0,0 +1,137 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of HostMemory
+	@ingroup core
+ */
+
+#ifndef HostMemory_h
+#define HostMemory_h
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+	@brief Placement policy for large host-side sample buffers
+
+	Buffers at or above the large allocation threshold are mapped directly from the OS rather than coming from the
+	heap, so that they can be backed by huge pages and placed across NUMA nodes. Smaller allocations are not affected.
+
+	Multi-GB waveforms otherwise need hundreds of thousands of 4 KB TLB entries, and on multi-socket machines they
+	end up entirely on the node the driver thread happened to be running on, while the pool threads processing them
+	are spread across every socket.
+
+	Huge page modes:
+	- HUGEPAGE_NONE: large buffers come from the heap as usual
+	- HUGEPAGE_TRANSPARENT: 2 MB aligned anonymous mapping with madvise(MADV_HUGEPAGE)
+	- HUGEPAGE_EXPLICIT: MAP_HUGETLB from the preallocated hugetlbfs pool, falling back to transparent if the pool
+	  is exhausted
+
+	NUMA policies:
+	- NUMA_DEFAULT: pages land on whichever node first writes to them
+	- NUMA_FIRST_TOUCH: new buffers are zeroed in parallel by the ThreadPool, so their pages are spread across the
+	  nodes the pool's workers run on
+	- NUMA_INTERLEAVE: pages are interleaved round robin across all nodes (requires libnuma)
+
+	Huge pages and NUMA placement are only available on Linux. On other platforms all allocations go to the heap.
+
+	@ingroup core
+ */
+class HostMemory
+{
+public:
+
+	enum HugePageMode
+	{
+		HUGEPAGE_NONE,
+		HUGEPAGE_TRANSPARENT,
+		HUGEPAGE_EXPLICIT
+	};
+
+	enum NumaPolicy
+	{
+		NUMA_DEFAULT,
+		NUMA_FIRST_TOUCH,
+		NUMA_INTERLEAVE
+	};
+
+	///@brief Allocation statistics, for benchmarking
+	struct Stats
+	{
+		///@brief Number of large buffers currently mapped
+		size_t m_liveBuffers;
+
+		///@brief Total size of large buffers currently mapped
+		size_t m_liveBytes;
+
+		///@brief Number of large buffers allocated from the explicit huge page pool since startup
+		size_t m_hugetlbAllocations;
+
+		///@brief Number of explicit huge page requests which fell back to transparent huge pages
+		size_t m_hugetlbFallbacks;
+	};
+
+	static void SetHugePageMode(HugePageMode mode);
+	static HugePageMode GetHugePageMode();
+
+	static void SetNumaPolicy(NumaPolicy policy);
+	static NumaPolicy GetNumaPolicy();
+
+	static void SetLargeAllocationThreshold(size_t bytes);
+	static size_t GetLargeAllocationThreshold();
+
+	static bool HasNuma();
+	static size_t GetNumaNodeCount();
+
+	static void* AllocateLarge(size_t bytes, size_t alignment);
+	static bool FreeLarge(void* ptr, size_t bytes);
+
+	static Stats GetStats();
+
+	static void SetThreadPinning(bool enable);
+	static bool IsThreadPinningEnabled();
+	static bool PinCurrentThread(size_t index);
+
+	/**
+		@brief Smallest size which can ever be a large allocation
+
+		Anything below this always comes from the heap regardless of the threshold setting, which lets FreeLarge()
+		skip the lookup for small blocks.
+	 */
+	static const size_t MIN_LARGE_ALLOCATION = 2 * 1024 * 1024;
+
+protected:
+	static void FirstTouch(void* ptr, size_t bytes);
+};
+
+#endif
@@ -188,6 +188,20 @@ public:
 		return m_streams[stream].m_waveform;
 	}
 
+	/**
+		@brief Removes the waveform from a stream without deleting it
+
+		@return The waveform (which the caller now owns), or nullptr if there was none
+	 */
+	WaveformBase* DetachData(size_t stream)
+	{
+		if(stream >= m_streams.size())
+			return nullptr;
+		auto ret = m_streams[stream].m_waveform;
+		m_streams[stream].m_waveform = nullptr;
+		return ret;
+	}
+
 	///@brief Get the flags of a data stream
 	uint8_t GetStreamFlags(size_t stream)
 	{
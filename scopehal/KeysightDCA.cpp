@@ -526,7 +526,7 @@ bool KeysightDCA::AcquireData()
 		for (size_t j = 0; j < m_channels.size(); j++)
 			if(IsChannelEnabled(j) && pending_waveforms.find(j) != pending_waveforms.end())
 				s[GetOscilloscopeChannel(j)] = pending_waveforms[j][i];
-		m_pendingWaveforms.push_back(s);
+		PushPendingWaveform(s);
 	}
 	m_pendingWaveformsMutex.unlock();
 
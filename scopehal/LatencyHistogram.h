@@ -0,0 +1,140 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief  Declaration of LatencyHistogram
+	@ingroup datamodel
+ */
+#ifndef LatencyHistogram_h
+#define LatencyHistogram_h
+
+/**
+	@brief Log-scale histogram of latencies
+
+	Bin 0 counts latencies under one microsecond, bin N counts latencies in [2^(N-1), 2^N) microseconds. The last bin
+	also counts everything longer. Not thread safe, callers are expected to hold a lock.
+ */
+class LatencyHistogram
+{
+public:
+	LatencyHistogram()
+	{ Clear(); }
+
+	///@brief Number of bins (the last bin covers about 35 minutes and up)
+	static const size_t NUM_BINS = 32;
+
+	///@brief Removes all samples
+	void Clear()
+	{
+		for(size_t i=0; i<NUM_BINS; i++)
+			m_bins[i] = 0;
+		m_count = 0;
+		m_sum = 0;
+		m_max = 0;
+	}
+
+	/**
+		@brief Adds a sample
+
+		@param seconds	Latency in seconds. Negative values (clock skew between instrument and host) count as zero.
+	 */
+	void Add(double seconds)
+	{
+		if(seconds < 0)
+			seconds = 0;
+
+		uint64_t us = static_cast<uint64_t>(seconds * 1e6);
+		size_t bin = 0;
+		while( (us != 0) && (bin+1 < NUM_BINS) )
+		{
+			us >>= 1;
+			bin ++;
+		}
+
+		m_bins[bin] ++;
+		m_count ++;
+		m_sum += seconds;
+		if(seconds > m_max)
+			m_max = seconds;
+	}
+
+	///@brief Number of samples in a bin
+	uint64_t GetBin(size_t i) const
+	{ return m_bins[i]; }
+
+	///@brief Upper edge of a bin, in seconds
+	static double GetBinUpperBound(size_t i)
+	{ return (1ULL << i) * 1e-6; }
+
+	///@brief Total number of samples
+	uint64_t GetCount() const
+	{ return m_count; }
+
+	///@brief Mean latency, in seconds
+	double GetMean() const
+	{ return m_count ? (m_sum / m_count) : 0; }
+
+	///@brief Largest latency seen, in seconds
+	double GetMax() const
+	{ return m_max; }
+
+	/**
+		@brief Estimates a percentile, rounded up to the upper edge of the bin containing it
+
+		@param fraction	Percentile as a fraction (0.99 for the 99th percentile)
+	 */
+	double GetPercentile(double fraction) const
+	{
+		uint64_t target = static_cast<uint64_t>(ceil(fraction * m_count));
+		uint64_t total = 0;
+		for(size_t i=0; i<NUM_BINS; i++)
+		{
+			total += m_bins[i];
+			if( (total >= target) && (total > 0) )
+				return std::min(GetBinUpperBound(i), m_max);
+		}
+		return m_max;
+	}
+
+protected:
+	///@brief Sample count in each bin
+	uint64_t m_bins[NUM_BINS];
+
+	///@brief Total number of samples
+	uint64_t m_count;
+
+	///@brief Sum of all samples, in seconds
+	double m_sum;
+
+	///@brief Largest sample, in seconds
+	double m_max;
+};
+
+#endif
@@ -42,6 +42,7 @@
 
 #include "scopehal.h"
 #include "NanoVNA.h"
+#include "SpectrumTraceProcessor.h"
 #include "EdgeTrigger.h"
 
 using namespace std;
@@ -357,11 +358,15 @@ bool NanoVNA::AcquireData()
 
 	}
 
-	size_t read = 0;
+	//Each page is pageSize lines of "re0 im0 re1 im1" followed by the command prompt.
+	//Adjacent pages share their boundary point, which is averaged when the pages are stitched together.
 	int64_t pageStart;
 	int64_t pageStop;
 	std::vector<string> values;
-	values.reserve(npoints);
+	values.reserve(pageSize + 1);
+	std::vector<float> page(pageSize * 4);
+	std::vector<float> data;
+	data.reserve(npoints * 4);
 	for(size_t currentPage = 0 ; currentPage < pages ; currentPage++)
 	{
 		pageStart = start + currentPage * pageSpan;
@@ -373,39 +378,31 @@ bool NanoVNA::AcquireData()
 			ChannelsDownloadStatusUpdate(0, InstrumentChannel::DownloadState::DOWNLOAD_IN_PROGRESS, linear_progress);
 			ChannelsDownloadStatusUpdate(1, InstrumentChannel::DownloadState::DOWNLOAD_IN_PROGRESS, linear_progress);
 		};
-		read += ConverseMultiple(command,values,true,progress,pageSize+1);
-		if(currentPage < (pages-1))
+		values.clear();
+		size_t read = ConverseMultiple(command,values,true,progress,pageSize+1);
+		if(read != (pageSize+1))
 		{
-			// Not last page => remove last point that will be overlapping with next page + remove command prompt
-			values.pop_back();
-			values.pop_back();
-			read-=2;
-		}
-	}
-	if(read != (npoints+1))
-	{
-		LogError("Invalid number of acquired bytes: %zu, expected %zu. Ingoring capture.\n",read,npoints+1);
-		return false;
-	}
-
-	std::vector<std::vector<float>> data;
-	// Parse data
-	for(size_t i=0; i<npoints; i++)
-	{
-		// Split sample line into strings
-		auto value = explode(values[i],' ');
-		if(value.size()!=4)
-		{
-			LogError("Could not find 4 values in data line '%s', aborting capture.\n",values[i].c_str());
+			LogError("Invalid number of acquired lines on page %zu: %zu, expected %zu. Ignoring capture.\n",
+				currentPage, read, pageSize+1);
 			return false;
 		}
-		std::vector<float> points;
-		for(size_t j = 0; j < 4 ; j++)
+
+		for(size_t i=0; i<pageSize; i++)
 		{
-			points.push_back(stof(value[j]));
+			auto& line = values[i];
+			size_t n = SpectrumTraceProcessor::ParseASCIIValues(line.data(), line.data() + line.size(), &page[i*4], 4);
+			if(n != 4)
+			{
+				LogError("Could not find 4 values in data line '%s', aborting capture.\n",line.c_str());
+				return false;
+			}
 		}
-		data.push_back(points);
-		//LogTrace("Pushing back data: %.9f,%.9f,%.9f,%.9f.\n",data[i][0],data[i][1],data[i][2],data[i][3]);
+		SpectrumTraceProcessor::StitchPage(data, page.data(), page.size(), 4);
+	}
+	if(data.size() != (npoints*4))
+	{
+		LogError("Invalid number of acquired points: %zu, expected %zu. Ignoring capture.\n", data.size()/4, npoints);
+		return false;
 	}
 
 	SequenceSet s;
@@ -436,8 +433,8 @@ bool NanoVNA::AcquireData()
 		acap->Resize(npoints);
 		for(size_t i=0; i<npoints; i++)
 		{
-			float real = data[i][(dest*2)];
-			float imag = data[i][(dest*2)+1];
+			float real = data[i*4 + (dest*2)];
+			float imag = data[i*4 + (dest*2) + 1];
 
 			float mag = sqrt(real*real + imag*imag);
 			float angle = atan2(imag, real);
@@ -456,7 +453,7 @@ bool NanoVNA::AcquireData()
 
 	//Save the waveforms to our queue
 	m_pendingWaveformsMutex.lock();
-	m_pendingWaveforms.push_back(s);
+	PushPendingWaveform(s);
 	m_pendingWaveformsMutex.unlock();
 
 	//If this was a one-shot trigger we're no longer armed
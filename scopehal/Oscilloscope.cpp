@@ -41,7 +41,6 @@
 #ifdef __x86_64__
 #include <immintrin.h>
 #endif
-#include <omp.h>
 
 #include "EdgeTrigger.h"
 
@@ -53,9 +52,18 @@ Oscilloscope::CreateMapType Oscilloscope::m_createprocs;
 // Construction / destruction
 
 Oscilloscope::Oscilloscope()
+	: m_pendingQueueMaxDepth(0)
+	, m_pendingQueueMaxBytes(0)
+	, m_pendingQueuePolicy(QUEUE_DROP_OLDEST)
+	, m_pendingQueueBlockTimeout(1)
+	, m_lastPoppedTriggerTime(0)
+	, m_lastPoppedUnprocessed(false)
 {
 	m_trigger = NULL;
 
+	m_pendingQueueStats.m_bytes = 0;
+	ResetPendingQueueStatistics();
+
 	m_serializers.push_back(sigc::mem_fun(*this, &Oscilloscope::DoSerializeConfiguration));
 	m_loaders.push_back(sigc::mem_fun(*this, &Oscilloscope::DoLoadConfiguration));
 	m_preloaders.push_back(sigc::mem_fun(*this, &Oscilloscope::DoPreLoadConfiguration));
@@ -76,6 +84,7 @@ Oscilloscope::~Oscilloscope()
 			delete it.second;
 	}
 	m_pendingWaveforms.clear();
+	m_pendingWaveformInfo.clear();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -164,10 +173,8 @@ void Oscilloscope::ClearPendingWaveforms()
 	lock_guard<mutex> lock(m_pendingWaveformsMutex);
 	while(!m_pendingWaveforms.empty())
 	{
-		SequenceSet set = *m_pendingWaveforms.begin();
-		for(auto it : set)
-			delete it.second;
-		m_pendingWaveforms.pop_front();
+		DiscardPendingWaveform(*m_pendingWaveforms.begin());
+		DropPendingWaveformHead();
 	}
 }
 
@@ -182,12 +189,193 @@ bool Oscilloscope::PopPendingWaveform()
 		SequenceSet set = *m_pendingWaveforms.begin();
 		for(auto it : set)
 			it.first.m_channel->SetData(it.second, it.first.m_stream);
-		m_pendingWaveforms.pop_front();
+		RemovePendingWaveformHead();
 		return true;
 	}
 	return false;
 }
 
+/**
+	@brief Adds a set of waveforms to the pending waveform queue, enforcing the configured queue limits
+
+	The caller must hold m_pendingWaveformsMutex. With QUEUE_BLOCK the mutex is released while waiting for space.
+
+	@param s	The waveforms to queue. Ownership passes to the queue; if the set is dropped it is discarded.
+
+	@return Number of waveform sets discarded to enforce the limits (including s itself, if it was dropped)
+ */
+size_t Oscilloscope::PushPendingWaveform(const SequenceSet& s)
+{
+	PendingWaveformInfo info;
+	info.m_queueTime = GetTime();
+	info.m_triggerTime = info.m_queueTime;
+	info.m_bytes = 0;
+	for(auto it : s)
+		info.m_bytes += it.second->GetCpuMemoryBytes();
+	if(!s.empty())
+	{
+		auto first = s.begin()->second;
+		info.m_triggerTime = first->m_startTimestamp + first->m_startFemtoseconds * SECONDS_PER_FS;
+	}
+
+	auto full = [&]()
+	{
+		if(m_pendingWaveforms.empty())
+			return false;
+		if( (m_pendingQueueMaxDepth != 0) && (m_pendingWaveforms.size() + 1 > m_pendingQueueMaxDepth) )
+			return true;
+		if( (m_pendingQueueMaxBytes != 0) && (m_pendingQueueStats.m_bytes + info.m_bytes > m_pendingQueueMaxBytes) )
+			return true;
+		return false;
+	};
+
+	size_t dropped = 0;
+	if(full())
+	{
+		switch(m_pendingQueuePolicy)
+		{
+			case QUEUE_DROP_OLDEST:
+				while(full())
+				{
+					DiscardPendingWaveform(*m_pendingWaveforms.begin());
+					DropPendingWaveformHead();
+					dropped ++;
+				}
+				break;
+
+			case QUEUE_BLOCK:
+				{
+					auto timeout = chrono::duration<double>(m_pendingQueueBlockTimeout);
+					if(m_pendingQueueSpaceAvailable.wait_for(m_pendingWaveformsMutex, timeout, [&]{ return !full(); }))
+						break;
+				}
+				//Timed out, fall through and drop the new waveform
+
+				[[fallthrough]];
+
+			case QUEUE_DROP_NEWEST:
+			default:
+				{
+					SequenceSet tmp = s;
+					DiscardPendingWaveform(tmp);
+				}
+				m_pendingQueueStats.m_dropped ++;
+				return dropped + 1;
+		}
+	}
+
+	m_pendingWaveforms.push_back(s);
+	m_pendingWaveformInfo.push_back(info);
+
+	m_pendingQueueStats.m_accepted ++;
+	m_pendingQueueStats.m_dropped += dropped;
+	m_pendingQueueStats.m_depth = m_pendingWaveforms.size();
+	m_pendingQueueStats.m_bytes += info.m_bytes;
+	m_pendingQueueStats.m_peakDepth = max(m_pendingQueueStats.m_peakDepth, m_pendingQueueStats.m_depth);
+	m_pendingQueueStats.m_peakBytes = max(m_pendingQueueStats.m_peakBytes, m_pendingQueueStats.m_bytes);
+	m_pendingQueueStats.m_acquireLatency.Add(info.m_queueTime - info.m_triggerTime);
+
+	return dropped;
+}
+
+/**
+	@brief Removes the head of the pending waveform queue without freeing it, after delivering it to the channels
+
+	Records the time it spent queued, and remembers its trigger time for NotifyWaveformProcessed().
+	The caller must hold m_pendingWaveformsMutex.
+ */
+void Oscilloscope::RemovePendingWaveformHead()
+{
+	if(m_pendingWaveforms.empty())
+		return;
+
+	if(!m_pendingWaveformInfo.empty())
+	{
+		auto& info = *m_pendingWaveformInfo.begin();
+		m_pendingQueueStats.m_queueLatency.Add(GetTime() - info.m_queueTime);
+		m_lastPoppedTriggerTime = info.m_triggerTime;
+		m_lastPoppedUnprocessed = true;
+	}
+
+	DropPendingWaveformHead();
+}
+
+/**
+	@brief Removes the head of the pending waveform queue without freeing it or recording any latency
+
+	Used for sets which are discarded rather than delivered. Only the queue depth and memory usage are updated.
+	The caller must hold m_pendingWaveformsMutex.
+ */
+void Oscilloscope::DropPendingWaveformHead()
+{
+	if(m_pendingWaveforms.empty())
+		return;
+	m_pendingWaveforms.pop_front();
+
+	if(!m_pendingWaveformInfo.empty())
+	{
+		auto& info = *m_pendingWaveformInfo.begin();
+		m_pendingQueueStats.m_bytes -= min(info.m_bytes, m_pendingQueueStats.m_bytes);
+		m_pendingWaveformInfo.pop_front();
+	}
+	m_pendingQueueStats.m_depth = m_pendingWaveforms.size();
+
+	m_pendingQueueSpaceAvailable.notify_all();
+}
+
+/**
+	@brief Frees a set of waveforms which are being dropped from (or were never added to) the pending queue
+
+	Drivers which recycle waveforms through a WaveformPool may override this to return them to the pool.
+ */
+void Oscilloscope::DiscardPendingWaveform(SequenceSet& set)
+{
+	for(auto it : set)
+		delete it.second;
+	set.clear();
+}
+
+/**
+	@brief Returns a snapshot of the pending waveform queue counters and latency histograms
+ */
+Oscilloscope::PendingQueueStatistics Oscilloscope::GetPendingQueueStatistics()
+{
+	lock_guard<mutex> lock(m_pendingWaveformsMutex);
+	return m_pendingQueueStats;
+}
+
+/**
+	@brief Resets the pending waveform queue counters and latency histograms
+ */
+void Oscilloscope::ResetPendingQueueStatistics()
+{
+	lock_guard<mutex> lock(m_pendingWaveformsMutex);
+	m_pendingQueueStats.m_accepted = 0;
+	m_pendingQueueStats.m_dropped = 0;
+	m_pendingQueueStats.m_depth = m_pendingWaveforms.size();
+	m_pendingQueueStats.m_peakDepth = m_pendingQueueStats.m_depth;
+	m_pendingQueueStats.m_peakBytes = m_pendingQueueStats.m_bytes;
+	m_pendingQueueStats.m_acquireLatency.Clear();
+	m_pendingQueueStats.m_queueLatency.Clear();
+	m_pendingQueueStats.m_totalLatency.Clear();
+}
+
+/**
+	@brief Records that the most recently popped waveform has been fully processed
+
+	Called by FilterGraphExecutor once a graph run fed by this instrument completes, to measure the end-to-end
+	latency from trigger to completion. Each popped set is only counted once, so reprocessing the same data (for
+	example after a filter parameter change) doesn't skew the histogram.
+ */
+void Oscilloscope::NotifyWaveformProcessed()
+{
+	lock_guard<mutex> lock(m_pendingWaveformsMutex);
+	if(!m_lastPoppedUnprocessed)
+		return;
+	m_pendingQueueStats.m_totalLatency.Add(GetTime() - m_lastPoppedTriggerTime);
+	m_lastPoppedUnprocessed = false;
+}
+
 /**
 	@brief Checks if we are appending to the existing waveform or creating a new one
  */
@@ -961,13 +1149,12 @@ void Oscilloscope::Convert8BitSamples(float* pout, const int8_t* pin, float gain
 	if(count > 1000000)
 	{
 		//Round blocks to multiples of 32 samples for clean vectorization
-		size_t numblocks = omp_get_max_threads();
+		size_t numblocks = ThreadPool::GetDefault().GetConcurrency();
 		size_t lastblock = numblocks - 1;
 		size_t blocksize = count / numblocks;
 		blocksize = blocksize - (blocksize % 32);
 
-		#pragma omp parallel for
-		for(size_t i=0; i<numblocks; i++)
+		ThreadPool::GetDefault().ParallelFor(0, numblocks, [&](size_t i)
 		{
 			//Last block gets any extra that didn't divide evenly
 			size_t nsamp = blocksize;
@@ -995,7 +1182,7 @@ void Oscilloscope::Convert8BitSamples(float* pout, const int8_t* pin, float gain
 					offset,
 					nsamp);
 			}
-		}
+		});
 	}
 
 	//Small waveforms get done single threaded to avoid overhead
@@ -1093,13 +1280,12 @@ void Oscilloscope::ConvertUnsigned8BitSamples(float* pout, const uint8_t* pin, f
 	if(count > 1000000)
 	{
 		//Round blocks to multiples of 32 samples for clean vectorization
-		size_t numblocks = omp_get_max_threads();
+		size_t numblocks = ThreadPool::GetDefault().GetConcurrency();
 		size_t lastblock = numblocks - 1;
 		size_t blocksize = count / numblocks;
 		blocksize = blocksize - (blocksize % 32);
 
-		#pragma omp parallel for
-		for(size_t i=0; i<numblocks; i++)
+		ThreadPool::GetDefault().ParallelFor(0, numblocks, [&](size_t i)
 		{
 			//Last block gets any extra that didn't divide evenly
 			size_t nsamp = blocksize;
@@ -1127,7 +1313,7 @@ void Oscilloscope::ConvertUnsigned8BitSamples(float* pout, const uint8_t* pin, f
 					offset,
 					nsamp);
 			}
-		}
+		});
 	}
 
 	//Small waveforms get done single threaded to avoid overhead
@@ -1228,13 +1414,12 @@ void Oscilloscope::Convert16BitSamples(float* pout, const int16_t* pin, float ga
 	if(count > 1000000)
 	{
 		//Round blocks to multiples of 64 samples for clean vectorization
-		size_t numblocks = omp_get_max_threads();
+		size_t numblocks = ThreadPool::GetDefault().GetConcurrency();
 		size_t lastblock = numblocks - 1;
 		size_t blocksize = count / numblocks;
 		blocksize = blocksize - (blocksize % 64);
 
-		#pragma omp parallel for
-		for(size_t i=0; i<numblocks; i++)
+		ThreadPool::GetDefault().ParallelFor(0, numblocks, [&](size_t i)
 		{
 			//Last block gets any extra that didn't divide evenly
 			size_t nsamp = blocksize;
@@ -1283,7 +1468,7 @@ void Oscilloscope::Convert16BitSamples(float* pout, const int16_t* pin, float ga
 					offset,
 					nsamp);
 			}
-		}
+		});
 	}
 
 	//Small waveforms get done single threaded to avoid overhead
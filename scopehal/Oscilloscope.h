@@ -40,6 +40,8 @@ class Instrument;
 
 #include "SCPITransport.h"
 #include "WaveformPool.h"
+#include "LatencyHistogram.h"
+#include <condition_variable>
 
 /**
 	@brief Generic representation of an oscilloscope, logic analyzer, or spectrum analyzer.
@@ -882,12 +884,137 @@ public:
 	virtual bool PopPendingWaveform();
 	virtual bool IsAppendingToWaveform();
 
+	///@brief What to do when a driver pushes a waveform into a full pending waveform queue
+	enum PendingQueuePolicy
+	{
+		///@brief Discard the oldest queued waveforms to make room
+		QUEUE_DROP_OLDEST,
+
+		///@brief Discard the incoming waveform
+		QUEUE_DROP_NEWEST,
+
+		///@brief Block the driver thread until the consumer makes room (or the block timeout expires)
+		QUEUE_BLOCK
+	};
+
+	/**
+		@brief Configures the bounds of the pending waveform queue
+
+		@param maxDepth		Maximum number of queued waveform sets, or zero for no limit
+		@param maxBytes		Maximum CPU memory used by queued waveforms, or zero for no limit
+		@param policy		What to do when a new waveform does not fit
+	 */
+	void SetPendingQueueLimits(size_t maxDepth, size_t maxBytes, PendingQueuePolicy policy)
+	{
+		std::lock_guard<std::mutex> lock(m_pendingWaveformsMutex);
+		m_pendingQueueMaxDepth = maxDepth;
+		m_pendingQueueMaxBytes = maxBytes;
+		m_pendingQueuePolicy = policy;
+		m_pendingQueueSpaceAvailable.notify_all();
+	}
+
+	size_t GetPendingQueueMaxDepth()
+	{ return m_pendingQueueMaxDepth; }
+
+	size_t GetPendingQueueMaxBytes()
+	{ return m_pendingQueueMaxBytes; }
+
+	PendingQueuePolicy GetPendingQueuePolicy()
+	{ return m_pendingQueuePolicy; }
+
+	///@brief Sets the longest time QUEUE_BLOCK will stall the driver before dropping the new waveform
+	void SetPendingQueueBlockTimeout(double seconds)
+	{ m_pendingQueueBlockTimeout = seconds; }
+
+	double GetPendingQueueBlockTimeout()
+	{ return m_pendingQueueBlockTimeout; }
+
+	///@brief Snapshot of acquisition pipeline counters
+	struct PendingQueueStatistics
+	{
+		///@brief Number of waveform sets accepted into the queue
+		uint64_t m_accepted;
+
+		///@brief Number of waveform sets discarded because the queue was full
+		uint64_t m_dropped;
+
+		///@brief Number of waveform sets currently queued
+		size_t m_depth;
+
+		///@brief CPU memory used by currently queued waveforms
+		size_t m_bytes;
+
+		///@brief Largest queue depth seen
+		size_t m_peakDepth;
+
+		///@brief Largest queue memory usage seen
+		size_t m_peakBytes;
+
+		///@brief Time from trigger (waveform start timestamp) to the driver queueing the waveform
+		LatencyHistogram m_acquireLatency;
+
+		///@brief Time delivered sets spent waiting in the queue (dropped sets aren't counted)
+		LatencyHistogram m_queueLatency;
+
+		///@brief Time from trigger to NotifyWaveformProcessed() (typically filter graph completion)
+		LatencyHistogram m_totalLatency;
+	};
+
+	PendingQueueStatistics GetPendingQueueStatistics();
+	void ResetPendingQueueStatistics();
+	void NotifyWaveformProcessed();
+
 protected:
 	typedef std::map<StreamDescriptor, WaveformBase*> SequenceSet;
 	std::list<SequenceSet> m_pendingWaveforms;
 	std::mutex m_pendingWaveformsMutex;
 	std::recursive_mutex m_mutex;
 
+	size_t PushPendingWaveform(const SequenceSet& s);
+	void RemovePendingWaveformHead();
+	void DropPendingWaveformHead();
+	virtual void DiscardPendingWaveform(SequenceSet& set);
+
+	///@brief Bookkeeping for one entry in m_pendingWaveforms
+	struct PendingWaveformInfo
+	{
+		///@brief Host time the set was queued
+		double m_queueTime;
+
+		///@brief Trigger time of the set (start timestamp of its first waveform)
+		double m_triggerTime;
+
+		///@brief CPU memory used by the set
+		size_t m_bytes;
+	};
+
+	///@brief Metadata for each set in m_pendingWaveforms, in the same order
+	std::list<PendingWaveformInfo> m_pendingWaveformInfo;
+
+	///@brief Signaled when space is freed in the pending waveform queue
+	std::condition_variable_any m_pendingQueueSpaceAvailable;
+
+	///@brief Maximum number of queued sets (zero for unlimited)
+	size_t m_pendingQueueMaxDepth;
+
+	///@brief Maximum memory used by queued sets (zero for unlimited)
+	size_t m_pendingQueueMaxBytes;
+
+	///@brief Overflow policy
+	PendingQueuePolicy m_pendingQueuePolicy;
+
+	///@brief Maximum time, in seconds, QUEUE_BLOCK waits for space
+	double m_pendingQueueBlockTimeout;
+
+	///@brief Counters and latency histograms (protected by m_pendingWaveformsMutex)
+	PendingQueueStatistics m_pendingQueueStats;
+
+	///@brief Trigger time of the most recently popped set, for NotifyWaveformProcessed()
+	double m_lastPoppedTriggerTime;
+
+	///@brief True if a set has been popped but NotifyWaveformProcessed() hasn't been called for it yet
+	bool m_lastPoppedUnprocessed;
+
 	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	// Diagnostics Access
 protected:
@@ -30,6 +30,8 @@
 #include "scopehal.h"
 #include "PacketDecoder.h"
 
+using namespace std;
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Color schemes
 
@@ -47,10 +49,18 @@ std::string PacketDecoder::m_backgroundColors[PROTO_STANDARD_COLOR_COUNT] =
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Packet
 
+bool Packet::m_mirrorLegacyHeaders = false;
+
+static const PaletteColor& GetDefaultForegroundColor()
+{
+	static PaletteColor color("#ffffff");
+	return color;
+}
+
 Packet::Packet()
 	: m_offset(0)
 	, m_len(0)
-	, m_displayForegroundColor("#ffffff")
+	, m_displayForegroundColor(GetDefaultForegroundColor())
 	, m_displayBackgroundColor(PacketDecoder::m_backgroundColors[PacketDecoder::PROTO_COLOR_DEFAULT])
 	, m_packedColorsValid(false)
 {
@@ -60,6 +70,176 @@ Packet::~Packet()
 {
 }
 
+/**
+	@brief Sets a header to an interned string value
+
+	Intended for values drawn from a small vocabulary ("Read", "Write", "ACK", etc). Free-form text should go in
+	m_headers instead, since interned strings are never freed.
+ */
+void Packet::SetHeader(string_view name, string_view value)
+{
+	SetTypedHeader(name, HeaderValue::FORMAT_STRING, 0, SymbolStringTable::Intern(value));
+}
+
+/**
+	@brief Sets a header to a decimal integer value
+ */
+void Packet::SetHeaderDecimal(string_view name, int64_t value)
+{
+	SetTypedHeader(name, HeaderValue::FORMAT_DECIMAL, 0, value);
+}
+
+/**
+	@brief Sets a header to a hexadecimal integer value
+
+	@param name		Header name
+	@param value	Header value
+	@param digits	Minimum number of digits to display
+ */
+void Packet::SetHeaderHex(string_view name, uint64_t value, unsigned int digits)
+{
+	SetTypedHeader(name, HeaderValue::FORMAT_HEX, digits, static_cast<int64_t>(value));
+}
+
+/**
+	@brief Sets a header to a short byte string (such as a MAC address), displayed as colon separated hex
+
+	@param name		Header name
+	@param data		Bytes to store
+	@param len		Number of bytes to store, at most 8
+ */
+void Packet::SetHeaderBytes(string_view name, const uint8_t* data, size_t len)
+{
+	len = min(len, sizeof(uint64_t));
+	uint64_t packed = 0;
+	for(size_t i=0; i<len; i++)
+		packed |= static_cast<uint64_t>(data[i]) << (i*8);
+	SetTypedHeader(name, HeaderValue::FORMAT_BYTES, len, static_cast<int64_t>(packed));
+}
+
+void Packet::SetTypedHeader(string_view name, HeaderValue::ValueFormat format, uint8_t width, int64_t value)
+{
+	auto id = SymbolStringTable::Intern(name);
+	HeaderValue v(id, format, width, value);
+
+	auto h = FindTypedHeader(id);
+	if(h)
+		*h = v;
+	else
+		m_typedHeaders.push_back(v);
+
+	//Keep m_headers in sync if an application still reads it directly.
+	//Otherwise typed headers take precedence, but don't leave a stale legacy value around.
+	if(m_mirrorLegacyHeaders)
+		v.FormatTo(m_headers[string(name)]);
+	else if(!m_headers.empty())
+		m_headers.erase(string(name));
+}
+
+Packet::HeaderValue* Packet::FindTypedHeader(uint32_t name)
+{
+	for(auto& h : m_typedHeaders)
+	{
+		if(h.m_name == name)
+			return &h;
+	}
+	return nullptr;
+}
+
+/**
+	@brief Returns the text of a header, whether stored as a string or as a typed value
+
+	@param name		Header name
+
+	@return Header text, or an empty string if there is no such header
+ */
+string Packet::GetHeader(const string& name) const
+{
+	uint32_t id;
+	if(!m_typedHeaders.empty() && SymbolStringTable::Find(name, id))
+	{
+		for(auto& h : m_typedHeaders)
+		{
+			if(h.m_name == id)
+			{
+				string ret;
+				h.FormatTo(ret);
+				return ret;
+			}
+		}
+	}
+
+	auto it = m_headers.find(name);
+	if(it != m_headers.end())
+		return it->second;
+	return "";
+}
+
+/**
+	@brief Checks if a header is present, whether stored as a string or as a typed value
+ */
+bool Packet::HasHeader(const string& name) const
+{
+	if(m_headers.find(name) != m_headers.end())
+		return true;
+
+	uint32_t id;
+	if(m_typedHeaders.empty() || !SymbolStringTable::Find(name, id))
+		return false;
+	for(auto& h : m_typedHeaders)
+	{
+		if(h.m_name == id)
+			return true;
+	}
+	return false;
+}
+
+/**
+	@brief Removes all string and typed headers
+ */
+void Packet::ClearHeaders()
+{
+	m_headers.clear();
+	m_typedHeaders.clear();
+}
+
+/**
+	@brief Converts the value to text
+
+	@param out	String to overwrite with the formatted value
+ */
+void Packet::HeaderValue::FormatTo(string& out) const
+{
+	char tmp[32];
+	switch(m_format)
+	{
+		case FORMAT_STRING:
+			out = SymbolStringTable::Get(static_cast<uint32_t>(m_value));
+			break;
+
+		case FORMAT_DECIMAL:
+			snprintf(tmp, sizeof(tmp), "%" PRId64, m_value);
+			out = tmp;
+			break;
+
+		case FORMAT_HEX:
+			snprintf(tmp, sizeof(tmp), "%0*" PRIx64, m_width, static_cast<uint64_t>(m_value));
+			out = tmp;
+			break;
+
+		case FORMAT_BYTES:
+			out.clear();
+			for(size_t i=0; i<m_width; i++)
+			{
+				if(i > 0)
+					out += ':';
+				snprintf(tmp, sizeof(tmp), "%02x", static_cast<unsigned int>((static_cast<uint64_t>(m_value) >> (i*8)) & 0xff));
+				out += tmp;
+			}
+			break;
+	}
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Construction / destruction
 
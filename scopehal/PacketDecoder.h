@@ -48,17 +48,86 @@ public:
 	///Duration time of the packet (femtoseconds)
 	int64_t m_len;
 
-	//Arbitrary header properties (human readable)
+	//Arbitrary header properties (human readable).
+	//Values repeated across many packets should use the typed SetHeader*() functions instead.
+	//Use GetHeader() to read headers, since it covers both. Typed headers are only copied here as text
+	//if SetLegacyHeaderMirroring(true) has been called.
 	std::map<std::string, std::string> m_headers;
 
+	/**
+		@brief A header value stored in compact form, and only converted to text when displayed
+	 */
+	class HeaderValue
+	{
+	public:
+		enum ValueFormat : uint8_t
+		{
+			FORMAT_STRING,		//Interned string, m_value is a SymbolStringTable ID
+			FORMAT_DECIMAL,		//Signed decimal integer
+			FORMAT_HEX,			//Zero padded lowercase hex, m_width digits
+			FORMAT_BYTES		//m_width bytes packed into m_value (first byte in the LSB), colon separated hex
+		};
+
+		HeaderValue(uint32_t name, ValueFormat format, uint8_t width, int64_t value)
+		: m_name(name)
+		, m_format(format)
+		, m_width(width)
+		, m_value(value)
+		{}
+
+		void FormatTo(std::string& out) const;
+
+		bool operator==(const HeaderValue& rhs) const
+		{
+			return (m_name == rhs.m_name) && (m_format == rhs.m_format) &&
+				(m_width == rhs.m_width) && (m_value == rhs.m_value);
+		}
+
+		///@brief SymbolStringTable ID of the header name
+		uint32_t m_name;
+
+		///@brief How to format m_value
+		ValueFormat m_format;
+
+		///@brief Digit or byte count, depending on m_format
+		uint8_t m_width;
+
+		///@brief The value
+		int64_t m_value;
+	};
+
+	///Typed header properties
+	std::vector<HeaderValue> m_typedHeaders;
+
+	void SetHeader(std::string_view name, std::string_view value);
+	void SetHeaderDecimal(std::string_view name, int64_t value);
+	void SetHeaderHex(std::string_view name, uint64_t value, unsigned int digits);
+	void SetHeaderBytes(std::string_view name, const uint8_t* data, size_t len);
+
+	std::string GetHeader(const std::string& name) const;
+	bool HasHeader(const std::string& name) const;
+	void ClearHeaders();
+
+	/**
+		@brief Controls whether the typed SetHeader*() functions also write the formatted text to m_headers
+
+		Off by default, since the copy would cost the memory typed headers are meant to save. Applications which
+		still read m_headers directly can turn it on at startup until they are moved over to GetHeader().
+	 */
+	static void SetLegacyHeaderMirroring(bool mirror)
+	{ m_mirrorLegacyHeaders = mirror; }
+
+	static bool GetLegacyHeaderMirroring()
+	{ return m_mirrorLegacyHeaders; }
+
 	//Packet bytes
 	std::vector<uint8_t> m_data;
 
 	//Text color of the packet
-	std::string m_displayForegroundColor;
+	PaletteColor m_displayForegroundColor;
 
 	//Background color of the packet
-	std::string m_displayBackgroundColor;
+	PaletteColor m_displayBackgroundColor;
 
 	//Packed colors
 	uint32_t m_displayForegroundColorPacked;
@@ -72,9 +141,16 @@ public:
 			return;
 		m_packedColorsValid = true;
 
-		m_displayForegroundColorPacked = ColorFromString(m_displayForegroundColor);
-		m_displayBackgroundColorPacked = ColorFromString(m_displayBackgroundColor);
+		m_displayForegroundColorPacked = m_displayForegroundColor.GetPacked();
+		m_displayBackgroundColorPacked = m_displayBackgroundColor.GetPacked();
 	}
+
+protected:
+	HeaderValue* FindTypedHeader(uint32_t name);
+	void SetTypedHeader(std::string_view name, HeaderValue::ValueFormat format, uint8_t width, int64_t value);
+
+	///@brief True to copy typed headers into m_headers as text
+	static bool m_mirrorLegacyHeaders;
 };
 
 /**
@@ -601,8 +601,7 @@ bool PicoOscilloscope::AcquireData()
 			}
 
 			//Now that we have the waveform data, unpack it into individual channels
-			#pragma omp parallel for
-			for(size_t j=0; j<8; j++)
+			ThreadPool::GetDefault().ParallelFor(0, 8, [&](size_t j)
 			{
 				//Bitmask for this digital channel
 				int16_t mask = (1 << j);
@@ -655,7 +654,7 @@ bool PicoOscilloscope::AcquireData()
 				cap->m_samples.shrink_to_fit();
 				cap->MarkSamplesModifiedFromCpu();
 				cap->MarkTimestampsModifiedFromCpu();
-			}
+			});
 
 			delete[] buf;
 		}
@@ -700,8 +699,7 @@ bool PicoOscilloscope::AcquireData()
 	{
 		//Fallback path
 		//Process analog captures in parallel
-		#pragma omp parallel for
-		for(size_t i=0; i<awfms.size(); i++)
+		ThreadPool::GetDefault().ParallelFor(0, awfms.size(), [&](size_t i)
 		{
 			auto cap = awfms[i];
 			cap->PrepareForCpuAccess();
@@ -713,12 +711,12 @@ bool PicoOscilloscope::AcquireData()
 				cap->size());
 
 			cap->MarkSamplesModifiedFromCpu();
-		}
+		});
 	}
 
 	//Save the waveforms to our queue
 	m_pendingWaveformsMutex.lock();
-	m_pendingWaveforms.push_back(s);
+	PushPendingWaveform(s);
 	m_pendingWaveformsMutex.unlock();
 
 	//If this was a one-shot trigger we're no longer armed
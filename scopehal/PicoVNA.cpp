@@ -375,7 +375,7 @@ bool PicoVNA::AcquireData()
 
 		//Save the waveforms to our queue
 		m_pendingWaveformsMutex.lock();
-		m_pendingWaveforms.push_back(s);
+		PushPendingWaveform(s);
 		m_pendingWaveformsMutex.unlock();
 	}
 
@@ -0,0 +1,205 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of SymbolStringTable and ProtocolPalette
+	@ingroup datamodel
+ */
+
+#include "scopehal.h"
+#include "ProtocolText.h"
+
+#include <mutex>
+#include <unordered_map>
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// SymbolStringTable
+
+atomic<string*> SymbolStringTable::m_blocks[SymbolStringTable::MAX_BLOCKS];
+atomic<uint32_t> SymbolStringTable::m_count(0);
+
+/**
+	@brief Reverse index of the string table, keyed by views into the table's own (never moving) storage
+ */
+struct SymbolStringIndex
+{
+	SymbolStringIndex()
+	{
+		//Reserve ID 0 for the empty string
+		auto block = new string[SymbolStringTable::BLOCK_SIZE];
+		SymbolStringTable::m_blocks[0].store(block, memory_order_release);
+		SymbolStringTable::m_count.store(1, memory_order_release);
+		m_ids[string_view(block[0])] = SymbolStringTable::EMPTY;
+	}
+
+	mutex m_mutex;
+	unordered_map<string_view, uint32_t> m_ids;
+};
+
+static SymbolStringIndex& GetSymbolStringIndex()
+{
+	static SymbolStringIndex index;
+	return index;
+}
+
+/**
+	@brief Returns the ID of a string, adding it to the table if it's not already present
+
+	@param str	The string to intern
+ */
+uint32_t SymbolStringTable::Intern(string_view str)
+{
+	auto& index = GetSymbolStringIndex();
+	lock_guard<mutex> lock(index.m_mutex);
+
+	auto it = index.m_ids.find(str);
+	if(it != index.m_ids.end())
+		return it->second;
+
+	uint32_t id = m_count.load(memory_order_relaxed);
+	size_t nblock = id >> BLOCK_BITS;
+	if(nblock >= MAX_BLOCKS)
+	{
+		LogError("SymbolStringTable is full, dropping \"%.*s\"\n", (int)str.length(), str.data());
+		return EMPTY;
+	}
+
+	auto block = m_blocks[nblock].load(memory_order_relaxed);
+	if(!block)
+	{
+		block = new string[BLOCK_SIZE];
+		m_blocks[nblock].store(block, memory_order_release);
+	}
+
+	auto& entry = block[id & BLOCK_MASK];
+	entry = str;
+	index.m_ids[string_view(entry)] = id;
+	m_count.store(id + 1, memory_order_release);
+	return id;
+}
+
+/**
+	@brief Looks up the ID of a string without adding it to the table
+
+	@param str	The string to look up
+	@param id	ID of the string, if found
+
+	@return True if the string is in the table
+ */
+bool SymbolStringTable::Find(string_view str, uint32_t& id)
+{
+	auto& index = GetSymbolStringIndex();
+	lock_guard<mutex> lock(index.m_mutex);
+
+	auto it = index.m_ids.find(str);
+	if(it == index.m_ids.end())
+		return false;
+	id = it->second;
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// ProtocolPalette
+
+uint32_t ProtocolPalette::m_packed[ProtocolPalette::MAX_COLORS];
+uint32_t ProtocolPalette::m_names[ProtocolPalette::MAX_COLORS];
+atomic<uint16_t> ProtocolPalette::m_standardColors[StandardColors::STANDARD_COLOR_COUNT];
+atomic<bool> ProtocolPalette::m_standardColorsValid(false);
+
+/**
+	@brief Reverse index of the palette, keyed by views into SymbolStringTable storage
+ */
+struct ProtocolPaletteIndex
+{
+	mutex m_mutex;
+	unordered_map<string_view, uint16_t> m_indexes;
+	uint16_t m_count = 0;
+};
+
+static ProtocolPaletteIndex& GetProtocolPaletteIndex()
+{
+	static ProtocolPaletteIndex index;
+	return index;
+}
+
+/**
+	@brief Returns the palette index of a color, adding it to the palette if it's not already present
+
+	@param color	Color in HTML #rrggbb, #rrggbbaa, or legacy GTK #rrrrggggbbbb notation
+ */
+uint16_t ProtocolPalette::Intern(string_view color)
+{
+	auto& index = GetProtocolPaletteIndex();
+	lock_guard<mutex> lock(index.m_mutex);
+
+	auto it = index.m_indexes.find(color);
+	if(it != index.m_indexes.end())
+		return it->second;
+
+	if(index.m_count >= MAX_COLORS)
+	{
+		LogError("ProtocolPalette is full, dropping \"%.*s\"\n", (int)color.length(), color.data());
+		return 0;
+	}
+
+	uint16_t i = index.m_count ++;
+	auto id = SymbolStringTable::Intern(color);
+	auto& name = SymbolStringTable::Get(id);
+	m_names[i] = id;
+	m_packed[i] = ColorFromString(name, 0xff);
+	index.m_indexes[string_view(name)] = i;
+	return i;
+}
+
+/**
+	@brief Returns the palette index of one of the StandardColors
+ */
+uint16_t ProtocolPalette::GetStandardColor(StandardColors::FilterColor color)
+{
+	if(!m_standardColorsValid.load(memory_order_acquire))
+		RefreshStandardColors();
+	return m_standardColors[color].load(memory_order_relaxed);
+}
+
+/**
+	@brief Re-reads StandardColors::colors into the palette
+
+	Must be called after changing StandardColors::colors so decoders using palette indexes see the new colors.
+ */
+void ProtocolPalette::RefreshStandardColors()
+{
+	for(size_t i=0; i<StandardColors::STANDARD_COLOR_COUNT; i++)
+		m_standardColors[i].store(Intern(StandardColors::colors[i]), memory_order_relaxed);
+	m_standardColorsValid.store(true, memory_order_release);
+}
@@ -0,0 +1,214 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of SymbolStringTable, ProtocolPalette and PaletteColor
+	@ingroup datamodel
+ */
+
+#ifndef ProtocolText_h
+#define ProtocolText_h
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "StandardColors.h"
+
+/**
+	@brief Process-wide table of interned strings used for protocol decode text and packet header values
+	@ingroup datamodel
+
+	Protocol decoders emit the same small vocabulary ("Read", "ACK", "CAN-FD", ...) for millions of symbols or packets.
+	Interning stores each distinct string once and lets the packet or symbol carry a 32-bit ID instead.
+
+	Entries are never freed, so only strings from a bounded vocabulary should be interned. Free-form text such as
+	payload dumps should stay in ordinary strings.
+
+	Interning takes a lock; looking up an ID does not.
+ */
+class SymbolStringTable
+{
+public:
+
+	///@brief ID of the empty string, which is always present
+	static const uint32_t EMPTY = 0;
+
+	static uint32_t Intern(std::string_view str);
+	static bool Find(std::string_view str, uint32_t& id);
+
+	/**
+		@brief Looks up the text of an interned string
+
+		@param id	ID returned by Intern()
+	 */
+	static const std::string& Get(uint32_t id)
+	{ return m_blocks[id >> BLOCK_BITS].load(std::memory_order_acquire)[id & BLOCK_MASK]; }
+
+	///@brief Returns the number of distinct strings interned so far
+	static size_t size()
+	{ return m_count.load(std::memory_order_acquire); }
+
+protected:
+	friend struct SymbolStringIndex;
+
+	enum
+	{
+		BLOCK_BITS	= 12,
+		BLOCK_SIZE	= 1 << BLOCK_BITS,
+		BLOCK_MASK	= BLOCK_SIZE - 1,
+		MAX_BLOCKS	= 4096
+	};
+
+	///@brief Fixed-size blocks of string storage, allocated on demand so existing entries never move
+	static std::atomic<std::string*> m_blocks[MAX_BLOCKS];
+
+	///@brief Number of strings in the table
+	static std::atomic<uint32_t> m_count;
+};
+
+/**
+	@brief Table of colors used by protocol decodes, indexed by a 16-bit palette index
+	@ingroup datamodel
+
+	Each entry keeps the HTML color string along with the packed RGBA32 form used for rendering, so per-sample color
+	lookups need neither string copies nor parsing.
+ */
+class ProtocolPalette
+{
+public:
+
+	///@brief Maximum number of distinct colors
+	static const size_t MAX_COLORS = 4096;
+
+	static uint16_t Intern(std::string_view color);
+	static uint16_t GetStandardColor(StandardColors::FilterColor color);
+	static void RefreshStandardColors();
+
+	///@brief Returns the packed RGBA32 value of a palette entry
+	static uint32_t GetPacked(uint16_t index)
+	{ return m_packed[index]; }
+
+	///@brief Returns the HTML color string of a palette entry
+	static const std::string& GetString(uint16_t index)
+	{ return SymbolStringTable::Get(m_names[index]); }
+
+protected:
+
+	///@brief Packed RGBA32 values of each entry
+	static uint32_t m_packed[MAX_COLORS];
+
+	///@brief SymbolStringTable ID of each entry's color string
+	static uint32_t m_names[MAX_COLORS];
+
+	///@brief Palette indexes of StandardColors::colors
+	static std::atomic<uint16_t> m_standardColors[StandardColors::STANDARD_COLOR_COUNT];
+
+	///@brief Set once m_standardColors has been populated
+	static std::atomic<bool> m_standardColorsValid;
+};
+
+/**
+	@brief A color stored as a ProtocolPalette index
+
+	Drop-in replacement for a std::string color member: it can be assigned from and converted to an HTML color string,
+	and provides the read-only std::string accessors client code commonly uses (c_str(), empty(), size()), but only
+	occupies two bytes. Code which modified the string in place must assign a new color instead.
+ */
+class PaletteColor
+{
+public:
+	PaletteColor(const std::string& color)
+	: m_index(ProtocolPalette::Intern(color))
+	{}
+
+	PaletteColor(const char* color)
+	: m_index(ProtocolPalette::Intern(color))
+	{}
+
+	PaletteColor(StandardColors::FilterColor color)
+	: m_index(ProtocolPalette::GetStandardColor(color))
+	{}
+
+	PaletteColor& operator=(const std::string& color)
+	{
+		m_index = ProtocolPalette::Intern(color);
+		return *this;
+	}
+
+	PaletteColor& operator=(const char* color)
+	{
+		m_index = ProtocolPalette::Intern(color);
+		return *this;
+	}
+
+	operator const std::string&() const
+	{ return ProtocolPalette::GetString(m_index); }
+
+	///@brief Returns the HTML color string
+	const std::string& str() const
+	{ return ProtocolPalette::GetString(m_index); }
+
+	///@brief Returns the HTML color string as a C string, for code written against a std::string member
+	const char* c_str() const
+	{ return str().c_str(); }
+
+	///@brief Returns true if the HTML color string is empty
+	bool empty() const
+	{ return str().empty(); }
+
+	///@brief Returns the length of the HTML color string
+	size_t size() const
+	{ return str().size(); }
+
+	///@brief Returns the packed RGBA32 color
+	uint32_t GetPacked() const
+	{ return ProtocolPalette::GetPacked(m_index); }
+
+	///@brief Returns the palette index
+	uint16_t GetIndex() const
+	{ return m_index; }
+
+	bool operator==(const PaletteColor& rhs) const
+	{ return m_index == rhs.m_index; }
+
+	bool operator!=(const PaletteColor& rhs) const
+	{ return m_index != rhs.m_index; }
+
+protected:
+
+	///@brief Index into ProtocolPalette
+	uint16_t m_index;
+};
+
+#endif
@@ -976,7 +976,7 @@ bool RSRTO6Oscilloscope::AcquireData()
 				if(IsChannelEnabled(j))
 					s[m_channels[j]] = pending_waveforms[j][i];
 			}
-			m_pendingWaveforms.push_back(s);
+			PushPendingWaveform(s);
 		}
 		m_pendingWaveformsMutex.unlock();
 	}
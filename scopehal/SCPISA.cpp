@@ -38,7 +38,15 @@ using namespace std;
 // Construction / destruction
 
 SCPISA::SCPISA()
+	: m_detectorMode(SpectrumTraceProcessor::DETECTOR_SAMPLE)
+	, m_traceStart(0)
+	, m_traceStep(1)
+	, m_peakExcursion(6)
+	, m_peakThreshold(-200)
+	, m_maxPeaks(10)
 {
+	m_serializers.push_back(sigc::mem_fun(*this, &SCPISA::DoSerializeConfiguration));
+	m_loaders.push_back(sigc::mem_fun(*this, &SCPISA::DoLoadConfiguration));
 }
 
 SCPISA::~SCPISA()
@@ -296,6 +304,7 @@ uint64_t SCPISA::GetSampleDepth()
 void SCPISA::SetSampleDepth(uint64_t depth)
 {
 	m_sampleDepth = depth;
+	OnSweepChanged();
 }
 
 // RBW management
@@ -307,5 +316,300 @@ int64_t SCPISA::GetResolutionBandwidth()
 void SCPISA::SetResolutionBandwidth(int64_t rbw)
 {	
 	m_rbw = rbw;
+	OnSweepChanged();
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Host-side trace processing
+
+/**
+	@brief Sets the detector used to combine raw sweep points into display bins
+
+	Drivers sweep more points than the sample depth when a detector other than DETECTOR_SAMPLE is selected, so the
+	detector has several points per bin to work with.
+ */
+void SCPISA::SetDetectorMode(SpectrumTraceProcessor::DetectorMode mode)
+{
+	lock_guard<recursive_mutex> lock(m_cacheMutex);
+	m_detectorMode = mode;
+	m_traceProcessor.Reset();
+}
+
+SpectrumTraceProcessor::DetectorMode SCPISA::GetDetectorMode()
+{
+	lock_guard<recursive_mutex> lock(m_cacheMutex);
+	return m_detectorMode;
+}
+
+/**
+	@brief Sets how successive sweeps are combined (clear/write, min/max hold, log or power averaging)
+ */
+void SCPISA::SetTraceMode(SpectrumTraceProcessor::TraceMode mode)
+{
+	lock_guard<recursive_mutex> lock(m_cacheMutex);
+	m_traceProcessor.SetTraceMode(mode);
+}
+
+SpectrumTraceProcessor::TraceMode SCPISA::GetTraceMode()
+{
+	lock_guard<recursive_mutex> lock(m_cacheMutex);
+	return m_traceProcessor.GetTraceMode();
+}
+
+/**
+	@brief Sets the number of sweeps the log and power averages converge over
+ */
+void SCPISA::SetTraceAverageCount(size_t count)
+{
+	lock_guard<recursive_mutex> lock(m_cacheMutex);
+	m_traceProcessor.SetAverageCount(count);
+}
+
+size_t SCPISA::GetTraceAverageCount()
+{
+	lock_guard<recursive_mutex> lock(m_cacheMutex);
+	return m_traceProcessor.GetAverageCount();
+}
+
+/**
+	@brief Discards held or averaged sweeps, so the next sweep starts a new hold or average
+ */
+void SCPISA::ResetTrace()
+{
+	lock_guard<recursive_mutex> lock(m_cacheMutex);
+	m_traceProcessor.Reset();
+}
+
+/**
+	@brief Stores the last sweep as the normalization reference
+
+	Subsequent sweeps have the reference subtracted before averaging, so a through-path or tracking generator response
+	can be calibrated out. The reference is dropped when the sweep settings change.
+ */
+void SCPISA::StoreNormalizationReference()
+{
+	lock_guard<recursive_mutex> lock(m_cacheMutex);
+	if(m_detectedTrace.empty())
+	{
+		LogWarning("%s: no sweep to use as normalization reference\n", m_nickname.c_str());
+		return;
+	}
+	m_normalizationReference = m_detectedTrace;
+	m_traceProcessor.Reset();
+}
+
+void SCPISA::ClearNormalizationReference()
+{
+	lock_guard<recursive_mutex> lock(m_cacheMutex);
+	m_normalizationReference.clear();
+	m_traceProcessor.Reset();
+}
+
+bool SCPISA::IsNormalizationActive()
+{
+	lock_guard<recursive_mutex> lock(m_cacheMutex);
+	return !m_normalizationReference.empty();
+}
+
+/**
+	@brief Resets all state tied to the current sweep settings
+
+	Drivers call this when the start, stop, resolution bandwidth or number of points change.
+ */
+void SCPISA::OnSweepChanged()
+{
+	lock_guard<recursive_mutex> lock(m_cacheMutex);
+	m_traceProcessor.Reset();
+	m_normalizationReference.clear();
+}
+
+/**
+	@brief Runs a raw sweep through the detector, normalization and trace averaging, then updates the peak table
+
+	@param raw		Raw sweep, in dBm
+	@param nraw		Number of raw points
+	@param out		Processed trace, must hold nout values
+	@param nout		Number of display bins
+	@param start	Frequency of the first display bin, in Hz
+	@param step		Display bin spacing, in Hz
+ */
+void SCPISA::ProcessTrace(const float* raw, size_t nraw, float* out, size_t nout, int64_t start, int64_t step)
+{
+	lock_guard<recursive_mutex> lock(m_cacheMutex);
+
+	m_detectedTrace.resize(nout);
+	SpectrumTraceProcessor::ApplyDetector(raw, nraw, &m_detectedTrace[0], nout, m_detectorMode);
+	memcpy(out, &m_detectedTrace[0], nout * sizeof(float));
+
+	if(!m_normalizationReference.empty())
+	{
+		if(m_normalizationReference.size() == nout)
+			SpectrumTraceProcessor::Normalize(out, &m_normalizationReference[0], nout);
+		else
+		{
+			LogWarning("%s: sweep length changed, normalization turned off\n", m_nickname.c_str());
+			m_normalizationReference.clear();
+		}
+	}
+
+	m_traceProcessor.Accumulate(out, nout);
+
+	m_processedTrace.assign(out, out + nout);
+	m_traceStart = start;
+	m_traceStep = max(step, (int64_t)1);
+	SpectrumTraceProcessor::FindPeaks(out, nout, m_peakThreshold, m_peakExcursion, m_maxPeaks, m_peaks);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Peaks and markers
+
+/**
+	@brief Sets how far the trace must fall on each side of a peak for it to enter the peak table
+ */
+void SCPISA::SetPeakExcursion(float db)
+{
+	lock_guard<recursive_mutex> lock(m_cacheMutex);
+	m_peakExcursion = max(db, 0.0f);
+}
+
+float SCPISA::GetPeakExcursion()
+{
+	lock_guard<recursive_mutex> lock(m_cacheMutex);
+	return m_peakExcursion;
+}
+
+/**
+	@brief Sets the minimum level of a peak table entry
+ */
+void SCPISA::SetPeakThreshold(float dbm)
+{
+	lock_guard<recursive_mutex> lock(m_cacheMutex);
+	m_peakThreshold = dbm;
+}
+
+float SCPISA::GetPeakThreshold()
+{
+	lock_guard<recursive_mutex> lock(m_cacheMutex);
+	return m_peakThreshold;
+}
+
+/**
+	@brief Returns the peak table of the last sweep, sorted by decreasing level
+ */
+vector<SCPISA::PeakTableEntry> SCPISA::GetPeakTable()
+{
+	lock_guard<recursive_mutex> lock(m_cacheMutex);
+	vector<PeakTableEntry> ret;
+	for(auto& p : m_peaks)
+		ret.push_back(PeakTableEntry{m_traceStart + (int64_t)p.m_bin * m_traceStep, p.m_value});
+	return ret;
+}
+
+/**
+	@brief Returns the level of the last sweep at a given frequency, interpolated between bins
+ */
+float SCPISA::GetMarkerLevel(int64_t freq)
+{
+	lock_guard<recursive_mutex> lock(m_cacheMutex);
+	if(m_processedTrace.empty())
+		return 0;
+	double bin = (freq - m_traceStart) * 1.0 / m_traceStep;
+	return SpectrumTraceProcessor::InterpolateMarker(&m_processedTrace[0], m_processedTrace.size(), bin);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Serialization
+
+void SCPISA::DoSerializeConfiguration(YAML::Node& node, IDTable& /*table*/)
+{
+	switch(GetDetectorMode())
+	{
+		case SpectrumTraceProcessor::DETECTOR_PEAK:
+			node["detector"] = "peak";
+			break;
+
+		case SpectrumTraceProcessor::DETECTOR_NEGATIVE_PEAK:
+			node["detector"] = "negpeak";
+			break;
+
+		case SpectrumTraceProcessor::DETECTOR_RMS:
+			node["detector"] = "rms";
+			break;
+
+		case SpectrumTraceProcessor::DETECTOR_AVERAGE:
+			node["detector"] = "average";
+			break;
+
+		case SpectrumTraceProcessor::DETECTOR_SAMPLE:
+		default:
+			node["detector"] = "sample";
+			break;
+	}
+
+	switch(GetTraceMode())
+	{
+		case SpectrumTraceProcessor::TRACE_MAX_HOLD:
+			node["tracemode"] = "maxhold";
+			break;
+
+		case SpectrumTraceProcessor::TRACE_MIN_HOLD:
+			node["tracemode"] = "minhold";
+			break;
+
+		case SpectrumTraceProcessor::TRACE_LOG_AVERAGE:
+			node["tracemode"] = "logaverage";
+			break;
+
+		case SpectrumTraceProcessor::TRACE_POWER_AVERAGE:
+			node["tracemode"] = "poweraverage";
+			break;
+
+		case SpectrumTraceProcessor::TRACE_CLEAR_WRITE:
+		default:
+			node["tracemode"] = "clearwrite";
+			break;
+	}
+	node["traceaverages"] = GetTraceAverageCount();
+	node["peakexcursion"] = GetPeakExcursion();
+	node["peakthreshold"] = GetPeakThreshold();
+}
+
+void SCPISA::DoLoadConfiguration(int /*version*/, const YAML::Node& node, IDTable& /*idmap*/)
+{
+	if(node["detector"])
+	{
+		auto mode = node["detector"].as<string>();
+		if(mode == "peak")
+			SetDetectorMode(SpectrumTraceProcessor::DETECTOR_PEAK);
+		else if(mode == "negpeak")
+			SetDetectorMode(SpectrumTraceProcessor::DETECTOR_NEGATIVE_PEAK);
+		else if(mode == "rms")
+			SetDetectorMode(SpectrumTraceProcessor::DETECTOR_RMS);
+		else if(mode == "average")
+			SetDetectorMode(SpectrumTraceProcessor::DETECTOR_AVERAGE);
+		else
+			SetDetectorMode(SpectrumTraceProcessor::DETECTOR_SAMPLE);
+	}
+
+	if(node["traceaverages"])
+		SetTraceAverageCount(node["traceaverages"].as<size_t>());
+	if(node["tracemode"])
+	{
+		auto mode = node["tracemode"].as<string>();
+		if(mode == "maxhold")
+			SetTraceMode(SpectrumTraceProcessor::TRACE_MAX_HOLD);
+		else if(mode == "minhold")
+			SetTraceMode(SpectrumTraceProcessor::TRACE_MIN_HOLD);
+		else if(mode == "logaverage")
+			SetTraceMode(SpectrumTraceProcessor::TRACE_LOG_AVERAGE);
+		else if(mode == "poweraverage")
+			SetTraceMode(SpectrumTraceProcessor::TRACE_POWER_AVERAGE);
+		else
+			SetTraceMode(SpectrumTraceProcessor::TRACE_CLEAR_WRITE);
+	}
+
+	if(node["peakexcursion"])
+		SetPeakExcursion(node["peakexcursion"].as<float>());
+	if(node["peakthreshold"])
+		SetPeakThreshold(node["peakthreshold"].as<float>());
+}
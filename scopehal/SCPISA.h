@@ -96,7 +96,88 @@ public:
 	virtual void SetResolutionBandwidth(int64_t rbw) override;
 	virtual int64_t GetResolutionBandwidth() override;
 
+	//Host-side trace processing
+	virtual void SetDetectorMode(SpectrumTraceProcessor::DetectorMode mode);
+	virtual SpectrumTraceProcessor::DetectorMode GetDetectorMode();
+	virtual void SetTraceMode(SpectrumTraceProcessor::TraceMode mode);
+	virtual SpectrumTraceProcessor::TraceMode GetTraceMode();
+	virtual void SetTraceAverageCount(size_t count);
+	virtual size_t GetTraceAverageCount();
+	virtual void ResetTrace();
+	virtual void StoreNormalizationReference();
+	virtual void ClearNormalizationReference();
+	virtual bool IsNormalizationActive();
+
+	//Peaks and markers
+	virtual void SetPeakExcursion(float db);
+	virtual float GetPeakExcursion();
+	virtual void SetPeakThreshold(float dbm);
+	virtual float GetPeakThreshold();
+
+	///@brief One entry of the peak table
+	struct PeakTableEntry
+	{
+		///@brief Frequency of the peak, in Hz
+		int64_t m_frequency;
+
+		///@brief Level of the peak, in dBm (or dB when normalized)
+		float m_level;
+	};
+
+	std::vector<PeakTableEntry> GetPeakTable();
+	float GetMarkerLevel(int64_t freq);
+
+	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+	// Configuration storage
+
 protected:
+	/**
+		@brief Serializes this spectrum analyzer's configuration to a YAML node.
+	 */
+	void DoSerializeConfiguration(YAML::Node& node, IDTable& table);
+
+	/**
+		@brief Load instrument and channel configuration from a save file
+	 */
+	void DoLoadConfiguration(int version, const YAML::Node& node, IDTable& idmap);
+
+protected:
+	void OnSweepChanged();
+	void ProcessTrace(const float* raw, size_t nraw, float* out, size_t nout, int64_t start, int64_t step);
+
+	///@brief Trace averaging and hold state
+	SpectrumTraceProcessor m_traceProcessor;
+
+	///@brief Detector used to reduce raw sweep points into display bins
+	SpectrumTraceProcessor::DetectorMode m_detectorMode;
+
+	///@brief Normalization reference, in dBm per display bin (empty if normalization is off)
+	std::vector<float> m_normalizationReference;
+
+	///@brief Last trace after the detector, before normalization and averaging
+	std::vector<float> m_detectedTrace;
+
+	///@brief Last fully processed trace, used for markers and the peak table
+	std::vector<float> m_processedTrace;
+
+	///@brief Frequency of the first bin of m_processedTrace
+	int64_t m_traceStart;
+
+	///@brief Bin spacing of m_processedTrace
+	int64_t m_traceStep;
+
+	///@brief Minimum drop on each side of a peak table entry, in dB
+	float m_peakExcursion;
+
+	///@brief Minimum level of a peak table entry
+	float m_peakThreshold;
+
+	///@brief Maximum number of entries in the peak table
+	size_t m_maxPeaks;
+
+	///@brief Peak table of the last processed trace
+	std::vector<SpectrumTraceProcessor::Peak> m_peaks;
+
 	std::map<std::pair<size_t, size_t>, float> m_channelVoltageRange;
 	std::map<std::pair<size_t, size_t>, float> m_channelOffset;
 
@@ -38,6 +38,9 @@ SCPISpectrometer::SpectrometerCreateMapType SCPISpectrometer::m_spectrometercrea
 // Construction / destruction
 
 SCPISpectrometer::SCPISpectrometer()
+	: m_hotPixelThreshold(0)
+	, m_darkFrameID(0)
+	, m_darkFrameRevision(0)
 {
 	m_serializers.push_back(sigc::mem_fun(*this, &SCPISpectrometer::DoSerializeConfiguration));
 	m_loaders.push_back(sigc::mem_fun(*this, &SCPISpectrometer::DoLoadConfiguration));
@@ -233,18 +236,156 @@ void SCPISpectrometer::SetChannelOffset(size_t i, size_t stream, float offset)
 	m_channelOffset[pair<size_t, size_t>(i, stream)] = offset;
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Host-side frame processing
+
+/**
+	@brief Sets how successive corrected frames are combined
+ */
+void SCPISpectrometer::SetStackMode(SpectrometerFrameProcessor::StackMode mode)
+{
+	lock_guard<recursive_mutex> lock(m_cacheMutex);
+	m_frameProcessor.SetStackMode(mode);
+}
+
+SpectrometerFrameProcessor::StackMode SCPISpectrometer::GetStackMode()
+{
+	lock_guard<recursive_mutex> lock(m_cacheMutex);
+	return m_frameProcessor.GetStackMode();
+}
+
+/**
+	@brief Sets the number of frames averaged in rolling stack mode
+ */
+void SCPISpectrometer::SetStackDepth(size_t depth)
+{
+	lock_guard<recursive_mutex> lock(m_cacheMutex);
+	m_frameProcessor.SetStackDepth(depth);
+}
+
+size_t SCPISpectrometer::GetStackDepth()
+{
+	lock_guard<recursive_mutex> lock(m_cacheMutex);
+	return m_frameProcessor.GetStackDepth();
+}
+
+/**
+	@brief Sets the hot pixel detection threshold
+
+	Pixels whose dark count is more than this many (robust) standard deviations above the median are replaced by the
+	mean of their neighbors. Hot pixels are found again whenever the dark frame changes.
+
+	@param sigma	Threshold in standard deviations, or 0 to disable hot pixel correction
+ */
+void SCPISpectrometer::SetHotPixelThreshold(float sigma)
+{
+	lock_guard<recursive_mutex> lock(m_cacheMutex);
+	m_hotPixelThreshold = max(sigma, 0.0f);
+
+	//Force the hot pixel list to be rebuilt on the next frame
+	m_darkFrameID = 0;
+	m_darkFrameRevision = 0;
+}
+
+float SCPISpectrometer::GetHotPixelThreshold()
+{
+	lock_guard<recursive_mutex> lock(m_cacheMutex);
+	return m_hotPixelThreshold;
+}
+
+/**
+	@brief Discards all stacked frames, so the next frame starts a new stack
+ */
+void SCPISpectrometer::ResetStack()
+{
+	lock_guard<recursive_mutex> lock(m_cacheMutex);
+	m_frameProcessor.ResetStack();
+}
+
+/**
+	@brief Loads a new dark frame into the frame processor, if it has changed since the last call
+
+	@param dark	Dark frame, in display order, which must be the same length as the frames being processed
+ */
+void SCPISpectrometer::UpdateDarkFrame(SparseAnalogWaveform* dark)
+{
+	lock_guard<recursive_mutex> lock(m_cacheMutex);
+	if( (dark->m_instanceID == m_darkFrameID) && (dark->m_revision == m_darkFrameRevision) )
+		return;
+	m_darkFrameID = dark->m_instanceID;
+	m_darkFrameRevision = dark->m_revision;
+
+	dark->PrepareForCpuAccess();
+	m_frameProcessor.SetDarkFrame(dark->m_samples.GetCpuPointer(), dark->size());
+
+	if(m_hotPixelThreshold > 0)
+	{
+		auto nhot = m_frameProcessor.FindHotPixels(m_hotPixelThreshold);
+		LogTrace("%s: %zu hot pixels found in dark frame\n", m_nickname.c_str(), nhot);
+	}
+	else
+		m_frameProcessor.ClearHotPixels();
+}
+
+/**
+	@brief Corrects a raw frame and adds it to the stack
+
+	@param raw	Raw counts, in display order
+	@param out	Corrected and stacked counts (may be the same buffer as raw)
+	@param len	Number of pixels
+ */
+void SCPISpectrometer::ProcessFrame(const float* raw, float* out, size_t len)
+{
+	lock_guard<recursive_mutex> lock(m_cacheMutex);
+	m_frameProcessor.Correct(raw, out, len);
+	m_frameProcessor.Stack(out, out, len);
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Serialization
 
 void SCPISpectrometer::DoSerializeConfiguration(YAML::Node& node, IDTable& /*table*/)
 {
 	node["integration"] = GetIntegrationTime();
+
+	switch(GetStackMode())
+	{
+		case SpectrometerFrameProcessor::STACK_ROLLING:
+			node["stackmode"] = "rolling";
+			break;
+
+		case SpectrometerFrameProcessor::STACK_ACCUMULATE:
+			node["stackmode"] = "accumulate";
+			break;
+
+		case SpectrometerFrameProcessor::STACK_NONE:
+		default:
+			node["stackmode"] = "none";
+			break;
+	}
+	node["stackdepth"] = GetStackDepth();
+	node["hotpixelthreshold"] = GetHotPixelThreshold();
 }
 
 void SCPISpectrometer::DoLoadConfiguration(int /*version*/, const YAML::Node& node, IDTable& /*idmap*/)
 {
 	if(node["integration"])
 		SetIntegrationTime(node["integration"].as<int64_t>());
+
+	if(node["stackdepth"])
+		SetStackDepth(node["stackdepth"].as<size_t>());
+	if(node["stackmode"])
+	{
+		auto mode = node["stackmode"].as<string>();
+		if(mode == "rolling")
+			SetStackMode(SpectrometerFrameProcessor::STACK_ROLLING);
+		else if(mode == "accumulate")
+			SetStackMode(SpectrometerFrameProcessor::STACK_ACCUMULATE);
+		else
+			SetStackMode(SpectrometerFrameProcessor::STACK_NONE);
+	}
+	if(node["hotpixelthreshold"])
+		SetHotPixelThreshold(node["hotpixelthreshold"].as<float>());
 }
 
 void SCPISpectrometer::DoPreLoadConfiguration(
@@ -83,6 +83,14 @@ public:
 	virtual int64_t GetIntegrationTime() =0;
 	virtual void SetIntegrationTime(int64_t t) =0;
 
+	//Host-side frame processing
+	virtual void SetStackMode(SpectrometerFrameProcessor::StackMode mode);
+	virtual SpectrometerFrameProcessor::StackMode GetStackMode();
+	virtual void SetStackDepth(size_t depth);
+	virtual size_t GetStackDepth();
+	virtual void SetHotPixelThreshold(float sigma);
+	virtual float GetHotPixelThreshold();
+	virtual void ResetStack();
 
 	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	// Configuration storage
@@ -104,9 +112,24 @@ protected:
 	void DoPreLoadConfiguration(int version, const YAML::Node& node, IDTable& idmap, ConfigWarningList& list);
 
 protected:
+	void UpdateDarkFrame(SparseAnalogWaveform* dark);
+	void ProcessFrame(const float* raw, float* out, size_t len);
+
 	std::map<std::pair<size_t, size_t>, float> m_channelVoltageRange;
 	std::map<std::pair<size_t, size_t>, float> m_channelOffset;
 
+	///@brief Dark frame, flat field, hot pixel correction and stacking (in display order, lowest wavelength first)
+	SpectrometerFrameProcessor m_frameProcessor;
+
+	///@brief Hot pixel detection threshold, in standard deviations of the dark frame (0 to disable)
+	float m_hotPixelThreshold;
+
+	///@brief Instance ID of the dark frame currently loaded into m_frameProcessor
+	uint64_t m_darkFrameID;
+
+	///@brief Revision of the dark frame currently loaded into m_frameProcessor
+	uint64_t m_darkFrameRevision;
+
 	////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 	// Dynamic creation
 public:
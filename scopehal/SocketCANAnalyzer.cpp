@@ -223,7 +223,7 @@ bool SocketCANAnalyzer::PopPendingWaveform()
 			else
 				chan->SetData(data, nstream);
 		}
-		m_pendingWaveforms.pop_front();
+		RemovePendingWaveformHead();
 
 		m_appendingNext = true;
 		return true;
@@ -349,7 +349,7 @@ bool SocketCANAnalyzer::AcquireData()
 	m_pendingWaveformsMutex.lock();
 		SequenceSet s;
 		s[m_channels[0]] = cap;
-		m_pendingWaveforms.push_back(s);
+		PushPendingWaveform(s);
 	m_pendingWaveformsMutex.unlock();
 
 	if(m_triggerOneShot)
@@ -0,0 +1,323 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Implementation of SpectrometerFrameProcessor
+	@ingroup spectrometerdrivers
+ */
+#include "scopehal.h"
+#include "SpectrometerFrameProcessor.h"
+#include <algorithm>
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+SpectrometerFrameProcessor::SpectrometerFrameProcessor()
+	: m_stackMode(STACK_NONE)
+	, m_stackDepth(8)
+	, m_clipSigma(3)
+	, m_stackCount(0)
+	, m_rejectedCount(0)
+	, m_frameLen(0)
+{
+}
+
+SpectrometerFrameProcessor::~SpectrometerFrameProcessor()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Calibration helpers
+
+/**
+	@brief Sets the dark frame subtracted from every raw frame
+ */
+void SpectrometerFrameProcessor::SetDarkFrame(const float* dark, size_t len)
+{
+	m_dark.assign(dark, dark + len);
+}
+
+/**
+	@brief Sets the flat field (relative sensor response) each frame is divided by
+ */
+void SpectrometerFrameProcessor::SetFlatField(const float* flat, size_t len)
+{
+	//Store reciprocals so the per-frame loop is a multiply
+	m_flat.resize(len);
+	for(size_t i=0; i<len; i++)
+		m_flat[i] = (flat[i] != 0) ? (1.0f / flat[i]) : 0;
+}
+
+/**
+	@brief Finds hot pixels in the current dark frame
+
+	A pixel is hot if its dark count exceeds the median by more than threshold times the robust standard deviation
+	(1.4826 * median absolute deviation).
+
+	@return Number of hot pixels found
+ */
+size_t SpectrometerFrameProcessor::FindHotPixels(float threshold)
+{
+	m_hotPixels.clear();
+	size_t len = m_dark.size();
+	if(len < 3)
+		return 0;
+
+	vector<float> tmp(m_dark.begin(), m_dark.end());
+	nth_element(tmp.begin(), tmp.begin() + len/2, tmp.end());
+	float median = tmp[len/2];
+
+	for(size_t i=0; i<len; i++)
+		tmp[i] = fabs(m_dark[i] - median);
+	nth_element(tmp.begin(), tmp.begin() + len/2, tmp.end());
+	float sigma = 1.4826f * tmp[len/2];
+
+	float limit = median + threshold * sigma;
+	for(size_t i=0; i<len; i++)
+	{
+		if(m_dark[i] > limit)
+			m_hotPixels.push_back(i);
+	}
+
+	return m_hotPixels.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Per-frame correction
+
+/**
+	@brief Applies dark, flat field and hot pixel correction to a frame
+
+	Corrections which have not been configured (or whose size does not match the frame) are skipped.
+
+	@param raw	Raw counts
+	@param out	Corrected counts (may be the same buffer as raw)
+	@param len	Number of pixels
+ */
+void SpectrometerFrameProcessor::Correct(const float* raw, float* out, size_t len)
+{
+	if(m_dark.size() == len)
+	{
+		const float* dark = &m_dark[0];
+		for(size_t i=0; i<len; i++)
+			out[i] = raw[i] - dark[i];
+	}
+	else if(out != raw)
+		memcpy(out, raw, len * sizeof(float));
+
+	if(m_flat.size() == len)
+	{
+		const float* flat = &m_flat[0];
+		for(size_t i=0; i<len; i++)
+			out[i] *= flat[i];
+	}
+
+	//Replace hot pixels with the mean of the closest good neighbor on each side
+	size_t nhot = m_hotPixels.size();
+	for(size_t h=0; h<nhot; h++)
+	{
+		size_t i = m_hotPixels[h];
+		if(i >= len)
+			break;
+
+		//Walk left past adjacent hot pixels
+		ssize_t left = i - 1;
+		for(ssize_t hl = (ssize_t)h - 1; (hl >= 0) && (left >= 0) && (m_hotPixels[hl] == (size_t)left); hl--)
+			left --;
+
+		//and right
+		size_t right = i + 1;
+		for(size_t hr = h + 1; (hr < nhot) && (m_hotPixels[hr] == right); hr++)
+			right ++;
+
+		if( (left >= 0) && (right < len) )
+			out[i] = (out[left] + out[right]) * 0.5f;
+		else if(left >= 0)
+			out[i] = out[left];
+		else if(right < len)
+			out[i] = out[right];
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Stacking
+
+/**
+	@brief Discards all stacked frames
+ */
+void SpectrometerFrameProcessor::ResetStack()
+{
+	m_stackCount = 0;
+	m_rejectedCount = 0;
+	m_frameLen = 0;
+	m_ring.clear();
+	m_mean.clear();
+	m_m2.clear();
+	m_count.clear();
+}
+
+/**
+	@brief Adds a frame to the stack and outputs the stacked result
+
+	The stack is reset automatically if the frame size changes.
+
+	@param frame	New (typically already corrected) frame
+	@param out		Stacked output
+	@param len		Number of pixels
+ */
+void SpectrometerFrameProcessor::Stack(const float* frame, float* out, size_t len)
+{
+	if(m_frameLen != len)
+		ResetStack();
+	m_frameLen = len;
+
+	switch(m_stackMode)
+	{
+		case STACK_ROLLING:
+			StackRolling(frame, out, len);
+			break;
+
+		case STACK_ACCUMULATE:
+			StackAccumulate(frame, out, len);
+			break;
+
+		case STACK_NONE:
+		default:
+			if(out != frame)
+				memcpy(out, frame, len * sizeof(float));
+			m_stackCount ++;
+			break;
+	}
+}
+
+void SpectrometerFrameProcessor::StackRolling(const float* frame, float* out, size_t len)
+{
+	if(m_ring.size() != len * m_stackDepth)
+		m_ring.resize(len * m_stackDepth);
+
+	//Overwrite the oldest frame
+	size_t slot = m_stackCount % m_stackDepth;
+	memcpy(&m_ring[slot * len], frame, len * sizeof(float));
+	m_stackCount ++;
+
+	size_t nframes = min(m_stackCount, m_stackDepth);
+	float clip = m_clipSigma;
+	const float* ring = &m_ring[0];
+	atomic<size_t> rejected(0);
+	size_t grain = (len * nframes > 65536) ? 1 : len;
+	ThreadPool::GetDefault().ParallelForRange(0, len, [&](size_t begin, size_t end)
+	{
+		size_t chunkRejected = 0;
+		for(size_t i=begin; i<end; i++)
+		{
+			double sum = 0;
+			double sumsq = 0;
+			for(size_t j=0; j<nframes; j++)
+			{
+				double v = ring[j*len + i];
+				sum += v;
+				sumsq += v*v;
+			}
+			double mean = sum / nframes;
+
+			//Need at least three samples for clipping to make sense
+			if(nframes < 3)
+			{
+				out[i] = mean;
+				continue;
+			}
+
+			double sigma = sqrt(max(0.0, sumsq / nframes - mean*mean));
+			double limit = clip * sigma;
+
+			double csum = 0;
+			size_t n = 0;
+			for(size_t j=0; j<nframes; j++)
+			{
+				double v = ring[j*len + i];
+				if(fabs(v - mean) <= limit)
+				{
+					csum += v;
+					n ++;
+				}
+			}
+
+			chunkRejected += nframes - n;
+			out[i] = n ? (csum / n) : mean;
+		}
+		rejected += chunkRejected;
+	}, grain);
+
+	m_rejectedCount += rejected;
+}
+
+void SpectrometerFrameProcessor::StackAccumulate(const float* frame, float* out, size_t len)
+{
+	if(m_mean.size() != len)
+	{
+		m_mean.assign(len, 0);
+		m_m2.assign(len, 0);
+		m_count.assign(len, 0);
+	}
+	m_stackCount ++;
+
+	double clip = m_clipSigma;
+	size_t rejected = 0;
+	for(size_t i=0; i<len; i++)
+	{
+		double v = frame[i];
+		uint32_t n = m_count[i];
+
+		//Reject outliers against the statistics so far
+		if(n >= 3)
+		{
+			double sigma = sqrt(m_m2[i] / (n - 1));
+			if( (sigma > 0) && (fabs(v - m_mean[i]) > clip * sigma) )
+			{
+				rejected ++;
+				out[i] = m_mean[i];
+				continue;
+			}
+		}
+
+		//Welford update
+		n ++;
+		double delta = v - m_mean[i];
+		m_mean[i] += delta / n;
+		m_m2[i] += delta * (v - m_mean[i]);
+		m_count[i] = n;
+
+		out[i] = m_mean[i];
+	}
+
+	m_rejectedCount += rejected;
+}
@@ -0,0 +1,167 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Declaration of SpectrometerFrameProcessor
+	@ingroup spectrometerdrivers
+ */
+
+#ifndef SpectrometerFrameProcessor_h
+#define SpectrometerFrameProcessor_h
+
+/**
+	@brief Host-side correction and stacking of spectrometer frames
+
+	Frames are arrays of raw counts, one per sensor pixel, in pixel order. Correction is applied in the order:
+
+	1. Dark frame subtraction
+	2. Flat field (sensor response) correction
+	3. Hot pixel replacement with the mean of the nearest good neighbors
+
+	Stacking combines several frames into one with outlier rejection, either over a rolling window of the most recent
+	frames or accumulating every frame since the last reset.
+
+	@ingroup spectrometerdrivers
+ */
+class SpectrometerFrameProcessor
+{
+public:
+	SpectrometerFrameProcessor();
+	virtual ~SpectrometerFrameProcessor();
+
+	///@brief How frames are combined
+	enum StackMode
+	{
+		///@brief No stacking, output is the latest frame
+		STACK_NONE,
+
+		///@brief Sigma-clipped mean of the last N frames
+		STACK_ROLLING,
+
+		///@brief Running mean of all frames since the last reset, rejecting outliers against the running statistics
+		STACK_ACCUMULATE
+	};
+
+	//Correction configuration
+	void SetDarkFrame(const float* dark, size_t len);
+	void ClearDarkFrame()
+	{ m_dark.clear(); }
+
+	void SetFlatField(const float* flat, size_t len);
+	void ClearFlatField()
+	{ m_flat.clear(); }
+
+	size_t FindHotPixels(float threshold = 8);
+	void ClearHotPixels()
+	{ m_hotPixels.clear(); }
+
+	const std::vector<size_t>& GetHotPixels()
+	{ return m_hotPixels; }
+
+	void Correct(const float* raw, float* out, size_t len);
+
+	//Stacking configuration
+	void SetStackMode(StackMode mode)
+	{
+		m_stackMode = mode;
+		ResetStack();
+	}
+
+	StackMode GetStackMode()
+	{ return m_stackMode; }
+
+	///@brief Sets the number of frames in a rolling stack
+	void SetStackDepth(size_t depth)
+	{
+		m_stackDepth = std::max(depth, (size_t)1);
+		ResetStack();
+	}
+
+	size_t GetStackDepth()
+	{ return m_stackDepth; }
+
+	///@brief Sets the outlier rejection threshold, in standard deviations
+	void SetClipSigma(float sigma)
+	{ m_clipSigma = sigma; }
+
+	float GetClipSigma()
+	{ return m_clipSigma; }
+
+	///@brief Returns the number of frames which have been added to the stack since the last reset
+	size_t GetStackCount()
+	{ return m_stackCount; }
+
+	///@brief Returns the number of pixel samples rejected as outliers since the last reset
+	size_t GetRejectedCount()
+	{ return m_rejectedCount; }
+
+	void ResetStack();
+	void Stack(const float* frame, float* out, size_t len);
+
+protected:
+	void StackRolling(const float* frame, float* out, size_t len);
+	void StackAccumulate(const float* frame, float* out, size_t len);
+
+	///@brief Dark frame, in counts
+	std::vector<float, AlignedAllocator<float, 64> > m_dark;
+
+	///@brief Reciprocal of the flat field response
+	std::vector<float, AlignedAllocator<float, 64> > m_flat;
+
+	///@brief Sorted indexes of pixels which are replaced by interpolation
+	std::vector<size_t> m_hotPixels;
+
+	StackMode m_stackMode;
+	size_t m_stackDepth;
+	float m_clipSigma;
+
+	///@brief Number of frames stacked since the last reset
+	size_t m_stackCount;
+
+	///@brief Number of samples rejected since the last reset
+	size_t m_rejectedCount;
+
+	///@brief Ring buffer of frames for rolling stacks, m_stackDepth frames of m_frameLen pixels
+	std::vector<float, AlignedAllocator<float, 64> > m_ring;
+
+	///@brief Per-pixel running mean for accumulating stacks
+	std::vector<double> m_mean;
+
+	///@brief Per-pixel running sum of squared deviations for accumulating stacks
+	std::vector<double> m_m2;
+
+	///@brief Per-pixel count of accepted samples for accumulating stacks
+	std::vector<uint32_t> m_count;
+
+	///@brief Frame size the stack state was allocated for
+	size_t m_frameLen;
+};
+
+#endif
@@ -0,0 +1,511 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Implementation of SpectrumTraceProcessor
+ */
+#include "scopehal.h"
+#include "SpectrumTraceProcessor.h"
+#include <charconv>
+
+using namespace std;
+
+///@brief Scale factor converting dB to the natural log of the linear power ratio, so that 10^(x/10) = exp(x * k)
+static const float c_dbToLn = 0.230258509f;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+SpectrumTraceProcessor::SpectrumTraceProcessor()
+	: m_mode(TRACE_CLEAR_WRITE)
+	, m_averageCount(16)
+	, m_sweepCount(0)
+{
+}
+
+SpectrumTraceProcessor::~SpectrumTraceProcessor()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Parsers
+
+/**
+	@brief Parses a TinySA "scanraw" response
+
+	Format is '{' ('x' LSB MSB)*npoints '}', values are in 1/32 dB steps above -dbmOffset.
+
+	@param data			Raw response, including the braces
+	@param len			Length of the response
+	@param npoints		Number of points expected
+	@param dbmOffset	Model specific offset subtracted from each value
+	@param out			Output buffer, must hold npoints values
+
+	@return	True if the framing was valid, false if the response was truncated or malformed
+ */
+bool SpectrumTraceProcessor::ParseTinySAScanRaw(
+	const uint8_t* data,
+	size_t len,
+	size_t npoints,
+	float dbmOffset,
+	float* out)
+{
+	if(len < npoints*3 + 2)
+		return false;
+
+	bool ok = (data[0] == '{') && (data[npoints*3 + 1] == '}');
+
+	const uint8_t* p = data + 1;
+	for(size_t i=0; i<npoints; i++)
+	{
+		ok &= (p[3*i] == 'x');
+		uint16_t raw = p[3*i + 1] | (p[3*i + 2] << 8);
+		out[i] = (raw / 32.0f) - dbmOffset;
+	}
+
+	return ok;
+}
+
+/**
+	@brief Parses whitespace or comma separated floating point values
+
+	@param start		Start of the text
+	@param end			End of the text
+	@param out			Output buffer
+	@param maxValues	Size of the output buffer
+
+	@return	Number of values parsed. Parsing stops at the first token which is not a number.
+ */
+size_t SpectrumTraceProcessor::ParseASCIIValues(const char* start, const char* end, float* out, size_t maxValues)
+{
+	size_t n = 0;
+	const char* p = start;
+	while(n < maxValues)
+	{
+		//Skip separators
+		while( (p < end) && ( (*p == ' ') || (*p == ',') || (*p == '\t') || (*p == '\r') || (*p == '\n') ) )
+			p++;
+		if(p >= end)
+			break;
+
+		//from_chars does not accept a leading '+'
+		if(*p == '+')
+			p++;
+
+		#ifdef __APPLE__
+			char* tend;
+			float tmp = strtof(p, &tend);
+			if(tend == p)
+				break;
+			p = tend;
+		#else
+			float tmp;
+			auto res = from_chars(p, end, tmp, std::chars_format::general);
+			if(res.ec != std::errc())
+				break;
+			p = res.ptr;
+		#endif
+
+		out[n++] = tmp;
+	}
+
+	return n;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Stateless kernels
+
+/**
+	@brief Reduces a raw trace of nin points into nout display bins using the selected detector
+
+	If nin <= nout each output bin takes the nearest input point.
+
+	When nin is a multiple of nout (the usual case, drivers oversample by an integer factor) every bin holds the same
+	number of points. The k-th point of all bins is then processed in one pass, so the inner loop runs across bins with
+	no dependency between iterations. Other ratios fall back to reducing one bin at a time.
+
+	@param in		Raw trace, in dB
+	@param nin		Number of raw points
+	@param out		Output trace, must hold nout values
+	@param nout		Number of display bins
+	@param mode		Detector used to combine the points of each bin
+ */
+void SpectrumTraceProcessor::ApplyDetector(const float* in, size_t nin, float* out, size_t nout, DetectorMode mode)
+{
+	if( (nin == 0) || (nout == 0) )
+		return;
+
+	if(nin <= nout)
+	{
+		for(size_t i=0; i<nout; i++)
+			out[i] = in[(i * nin) / nout];
+		return;
+	}
+
+	//Integer ratio: walk the points of all bins in lockstep
+	if( (nin % nout) == 0)
+	{
+		size_t k = nin / nout;
+		float scale = 1.0f / k;
+		ThreadPool::GetDefault().ParallelForRange(0, nout, [&](size_t begin, size_t end)
+		{
+			switch(mode)
+			{
+				case DETECTOR_PEAK:
+					for(size_t i=begin; i<end; i++)
+						out[i] = in[i*k];
+					for(size_t j=1; j<k; j++)
+					{
+						for(size_t i=begin; i<end; i++)
+							out[i] = max(out[i], in[i*k + j]);
+					}
+					break;
+
+				case DETECTOR_NEGATIVE_PEAK:
+					for(size_t i=begin; i<end; i++)
+						out[i] = in[i*k];
+					for(size_t j=1; j<k; j++)
+					{
+						for(size_t i=begin; i<end; i++)
+							out[i] = min(out[i], in[i*k + j]);
+					}
+					break;
+
+				case DETECTOR_RMS:
+					for(size_t i=begin; i<end; i++)
+						out[i] = 0;
+					for(size_t j=0; j<k; j++)
+					{
+						for(size_t i=begin; i<end; i++)
+							out[i] += expf(in[i*k + j] * c_dbToLn);
+					}
+					for(size_t i=begin; i<end; i++)
+						out[i] = 10 * log10f(out[i] * scale);
+					break;
+
+				case DETECTOR_AVERAGE:
+					for(size_t i=begin; i<end; i++)
+						out[i] = 0;
+					for(size_t j=0; j<k; j++)
+					{
+						for(size_t i=begin; i<end; i++)
+							out[i] += in[i*k + j];
+					}
+					for(size_t i=begin; i<end; i++)
+						out[i] *= scale;
+					break;
+
+				case DETECTOR_SAMPLE:
+				default:
+					for(size_t i=begin; i<end; i++)
+						out[i] = in[i*k];
+					break;
+			}
+		}, 4096);
+		return;
+	}
+
+	//Uneven bins, reduce one at a time
+	ThreadPool::GetDefault().ParallelFor(0, nout, [&](size_t i)
+	{
+		size_t istart = (i * nin) / nout;
+		size_t iend = ((i+1) * nin) / nout;
+		size_t n = iend - istart;
+		const float* bin = in + istart;
+
+		float v = bin[0];
+		switch(mode)
+		{
+			case DETECTOR_PEAK:
+				for(size_t j=1; j<n; j++)
+					v = max(v, bin[j]);
+				break;
+
+			case DETECTOR_NEGATIVE_PEAK:
+				for(size_t j=1; j<n; j++)
+					v = min(v, bin[j]);
+				break;
+
+			case DETECTOR_RMS:
+				{
+					float sum = 0;
+					for(size_t j=0; j<n; j++)
+						sum += expf(bin[j] * c_dbToLn);
+					v = 10 * log10f(sum / n);
+				}
+				break;
+
+			case DETECTOR_AVERAGE:
+				{
+					float sum = 0;
+					for(size_t j=0; j<n; j++)
+						sum += bin[j];
+					v = sum / n;
+				}
+				break;
+
+			case DETECTOR_SAMPLE:
+			default:
+				break;
+		}
+
+		out[i] = v;
+	}, nout > 65536);
+}
+
+/**
+	@brief Subtracts a reference trace (e.g. a stored through-path sweep) from a trace, in dB
+ */
+void SpectrumTraceProcessor::Normalize(float* trace, const float* reference, size_t len)
+{
+	for(size_t i=0; i<len; i++)
+		trace[i] -= reference[i];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Peak and marker extraction
+
+/**
+	@brief Builds a peak table for a trace
+
+	A local maximum is reported as a peak if it is at or above the threshold and the trace falls at least excursion dB
+	below it on both sides before rising above it again. This rejects the ripple of the noise floor and the shoulders of
+	a larger signal, the same way the peak excursion setting of a bench spectrum analyzer does.
+
+	@param trace		Trace, in dB
+	@param len			Number of bins
+	@param threshold	Minimum level of a peak
+	@param excursion	Minimum drop on each side of a peak, in dB
+	@param maxPeaks		Maximum number of peaks to report
+	@param peaks		Output peak table, sorted by decreasing level
+
+	@return	Number of peaks found
+ */
+size_t SpectrumTraceProcessor::FindPeaks(
+	const float* trace,
+	size_t len,
+	float threshold,
+	float excursion,
+	size_t maxPeaks,
+	vector<Peak>& peaks)
+{
+	peaks.clear();
+	if(len < 3)
+		return 0;
+
+	for(size_t i=1; i+1<len; i++)
+	{
+		//Must be a local maximum (first point of a plateau) above the threshold
+		float v = trace[i];
+		if( (v < threshold) || (v <= trace[i-1]) || (v < trace[i+1]) )
+			continue;
+		float limit = v - excursion;
+
+		//Walk left until the trace drops far enough, or rises above us
+		bool left = false;
+		for(size_t j=i; j>0; j--)
+		{
+			float w = trace[j-1];
+			if(w > v)
+				break;
+			if(w <= limit)
+			{
+				left = true;
+				break;
+			}
+		}
+		if(!left)
+			continue;
+
+		//Same thing on the right
+		bool right = false;
+		for(size_t j=i+1; j<len; j++)
+		{
+			float w = trace[j];
+			if(w > v)
+				break;
+			if(w <= limit)
+			{
+				right = true;
+				break;
+			}
+		}
+		if(!right)
+			continue;
+
+		peaks.push_back(Peak{i, v});
+	}
+
+	sort(peaks.begin(), peaks.end(), [](const Peak& a, const Peak& b)
+		{ return a.m_value > b.m_value; });
+	if(peaks.size() > maxPeaks)
+		peaks.resize(maxPeaks);
+
+	return peaks.size();
+}
+
+/**
+	@brief Reads a marker value at a fractional bin position
+
+	@param trace	Trace, in dB
+	@param len		Number of bins
+	@param bin		Marker position, in bins. Positions outside the trace are clamped to the first or last bin.
+
+	@return	Trace value at the marker, linearly interpolated between the two nearest bins
+ */
+float SpectrumTraceProcessor::InterpolateMarker(const float* trace, size_t len, double bin)
+{
+	if(len == 0)
+		return 0;
+	if(bin <= 0)
+		return trace[0];
+	if(bin >= len - 1)
+		return trace[len - 1];
+
+	size_t i = floor(bin);
+	float frac = bin - i;
+	return trace[i] + (trace[i+1] - trace[i]) * frac;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Paginated sweeps
+
+/**
+	@brief Appends one page of a paginated sweep to a trace
+
+	Adjacent pages share their boundary points. The first overlap points of every page after the first duplicate the
+	last points of the previous page and are averaged with them instead of being appended.
+
+	@param trace	Trace being assembled
+	@param page		Points of the new page
+	@param len		Number of points in the page
+	@param overlap	Number of points shared with the previous page
+ */
+void SpectrumTraceProcessor::StitchPage(vector<float>& trace, const float* page, size_t len, size_t overlap)
+{
+	if(trace.empty())
+		overlap = 0;
+	overlap = min(overlap, min(len, trace.size()));
+
+	size_t base = trace.size() - overlap;
+	for(size_t i=0; i<overlap; i++)
+		trace[base + i] = (trace[base + i] + page[i]) * 0.5f;
+
+	trace.insert(trace.end(), page + overlap, page + len);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Trace averaging
+
+/**
+	@brief Discards accumulated state, the next sweep starts a new average or hold
+ */
+void SpectrumTraceProcessor::Reset()
+{
+	m_sweepCount = 0;
+	m_state.clear();
+}
+
+/**
+	@brief Adds a new sweep to the accumulated state and replaces it with the processed trace
+
+	The state is reset automatically if the number of points changes.
+
+	@param trace	Sweep in dB, overwritten with the processed trace
+	@param len		Number of points in the sweep
+ */
+void SpectrumTraceProcessor::Accumulate(float* trace, size_t len)
+{
+	if(m_mode == TRACE_CLEAR_WRITE)
+		return;
+
+	if(m_state.size() != len)
+		Reset();
+
+	//First sweep initializes the state
+	if(m_sweepCount == 0)
+	{
+		m_state.resize(len);
+		if(m_mode == TRACE_POWER_AVERAGE)
+		{
+			for(size_t i=0; i<len; i++)
+				m_state[i] = expf(trace[i] * c_dbToLn);
+		}
+		else
+			memcpy(&m_state[0], trace, len * sizeof(float));
+
+		m_sweepCount = 1;
+		return;
+	}
+
+	m_sweepCount ++;
+
+	//Running mean until we have enough sweeps, then exponential average
+	float alpha = 1.0f / min(m_sweepCount, m_averageCount);
+	float* state = &m_state[0];
+
+	switch(m_mode)
+	{
+		case TRACE_MAX_HOLD:
+			for(size_t i=0; i<len; i++)
+			{
+				state[i] = max(state[i], trace[i]);
+				trace[i] = state[i];
+			}
+			break;
+
+		case TRACE_MIN_HOLD:
+			for(size_t i=0; i<len; i++)
+			{
+				state[i] = min(state[i], trace[i]);
+				trace[i] = state[i];
+			}
+			break;
+
+		case TRACE_LOG_AVERAGE:
+			for(size_t i=0; i<len; i++)
+			{
+				state[i] += (trace[i] - state[i]) * alpha;
+				trace[i] = state[i];
+			}
+			break;
+
+		case TRACE_POWER_AVERAGE:
+			for(size_t i=0; i<len; i++)
+			{
+				state[i] += (expf(trace[i] * c_dbToLn) - state[i]) * alpha;
+				trace[i] = 10 * log10f(state[i]);
+			}
+			break;
+
+		default:
+			break;
+	}
+}
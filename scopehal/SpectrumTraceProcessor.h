@@ -0,0 +1,155 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Declaration of SpectrumTraceProcessor
+ */
+
+#ifndef SpectrumTraceProcessor_h
+#define SpectrumTraceProcessor_h
+
+/**
+	@brief Shared trace parsing, detector and trace math helpers for spectrum analyzer style drivers
+
+	All traces are in dBm (or dB) per bin unless otherwise noted. The stateful part of the class implements trace
+	averaging across sweeps, the static helpers are stateless kernels usable from any driver.
+
+	The kernels loop over bins in their innermost loop, with the mode selection hoisted out, so each bin is an
+	independent lane the compiler can vectorize.
+ */
+class SpectrumTraceProcessor
+{
+public:
+	SpectrumTraceProcessor();
+	virtual ~SpectrumTraceProcessor();
+
+	///@brief Detector modes used when reducing several raw points into one display bin
+	enum DetectorMode
+	{
+		///@brief Largest value in the bin
+		DETECTOR_PEAK,
+
+		///@brief Smallest value in the bin
+		DETECTOR_NEGATIVE_PEAK,
+
+		///@brief First point of the bin
+		DETECTOR_SAMPLE,
+
+		///@brief Root mean square of the bin, computed in the linear power domain
+		DETECTOR_RMS,
+
+		///@brief Mean of the bin, computed in the log domain (video average)
+		DETECTOR_AVERAGE
+	};
+
+	///@brief Trace math applied across successive sweeps
+	enum TraceMode
+	{
+		///@brief No processing, output is the latest sweep
+		TRACE_CLEAR_WRITE,
+
+		///@brief Largest value seen in each bin
+		TRACE_MAX_HOLD,
+
+		///@brief Smallest value seen in each bin
+		TRACE_MIN_HOLD,
+
+		///@brief Exponential average of the log (dB) values
+		TRACE_LOG_AVERAGE,
+
+		///@brief Exponential average of the linear power values
+		TRACE_POWER_AVERAGE
+	};
+
+	///@brief A peak found in a trace
+	struct Peak
+	{
+		///@brief Bin index of the peak
+		size_t m_bin;
+
+		///@brief Value of the peak, in dB
+		float m_value;
+	};
+
+	//Parsers
+	static bool ParseTinySAScanRaw(const uint8_t* data, size_t len, size_t npoints, float dbmOffset, float* out);
+	static size_t ParseASCIIValues(const char* start, const char* end, float* out, size_t maxValues);
+
+	//Stateless kernels
+	static void ApplyDetector(const float* in, size_t nin, float* out, size_t nout, DetectorMode mode);
+	static void Normalize(float* trace, const float* reference, size_t len);
+
+	//Peak and marker extraction
+	static size_t FindPeaks(
+		const float* trace,
+		size_t len,
+		float threshold,
+		float excursion,
+		size_t maxPeaks,
+		std::vector<Peak>& peaks);
+	static float InterpolateMarker(const float* trace, size_t len, double bin);
+
+	//Paginated sweeps
+	static void StitchPage(std::vector<float>& trace, const float* page, size_t len, size_t overlap);
+
+	//Trace averaging
+	void SetTraceMode(TraceMode mode)
+	{
+		m_mode = mode;
+		Reset();
+	}
+
+	TraceMode GetTraceMode()
+	{ return m_mode; }
+
+	///@brief Sets the number of sweeps the exponential averages converge over
+	void SetAverageCount(size_t count)
+	{ m_averageCount = std::max(count, (size_t)1); }
+
+	size_t GetAverageCount()
+	{ return m_averageCount; }
+
+	///@brief Returns the number of sweeps accumulated since the last reset
+	size_t GetSweepCount()
+	{ return m_sweepCount; }
+
+	void Reset();
+	void Accumulate(float* trace, size_t len);
+
+protected:
+	TraceMode m_mode;
+	size_t m_averageCount;
+	size_t m_sweepCount;
+
+	///@brief Accumulated trace state (dB for log/hold modes, linear mW for power averaging)
+	std::vector<float, AlignedAllocator<float, 64> > m_state;
+};
+
+#endif
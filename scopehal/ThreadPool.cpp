@@ -0,0 +1,459 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of ThreadPool
+	@ingroup core
+ */
+
+#include "scopehal.h"
+
+using namespace std;
+
+///@brief The pool the current thread is a worker of, if any
+static thread_local ThreadPool* t_currentPool = nullptr;
+
+///@brief Index of the current thread within t_currentPool
+static thread_local size_t t_workerIndex = 0;
+
+///@brief Requested size of the default pool (zero for one thread per CPU)
+static size_t g_defaultPoolSize = 0;
+
+///@brief The default pool, created on first use
+static unique_ptr<ThreadPool> g_defaultPool;
+
+///@brief Fast path pointer to g_defaultPool
+static atomic<ThreadPool*> g_defaultPoolPtr(nullptr);
+
+///@brief Mutex for creating g_defaultPool
+static mutex g_defaultPoolMutex;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// TaskGroup
+
+/**
+	@brief Creates a task group which runs tasks on a specific pool
+ */
+TaskGroup::TaskGroup(ThreadPool& pool)
+	: m_pool(pool)
+	, m_pending(0)
+{
+}
+
+/**
+	@brief Creates a task group which runs tasks on the default pool
+ */
+TaskGroup::TaskGroup()
+	: m_pool(ThreadPool::GetDefault())
+	, m_pending(0)
+{
+}
+
+TaskGroup::~TaskGroup()
+{
+	WaitWithoutRethrow();
+}
+
+/**
+	@brief Queues a task to run on the pool
+ */
+void TaskGroup::Run(function<void()> task)
+{
+	m_pending ++;
+	m_pool.Enqueue({std::move(task), this});
+	m_pool.Wake(false);
+}
+
+/**
+	@brief Blocks until every task in the group has completed, running queued tasks while we wait
+
+	If any task threw an exception, the first one is rethrown here.
+ */
+void TaskGroup::Wait()
+{
+	WaitWithoutRethrow();
+
+	lock_guard<mutex> lock(m_errorMutex);
+	if(m_error)
+	{
+		auto err = m_error;
+		m_error = nullptr;
+		rethrow_exception(err);
+	}
+}
+
+void TaskGroup::WaitWithoutRethrow()
+{
+	while(m_pending > 0)
+	{
+		if(m_pool.TryRunGroupTask())
+			continue;
+
+		unique_lock<mutex> lock(m_pool.m_wakeMutex);
+		m_pool.m_wakeCvar.wait(lock, [this]{ return (m_pending == 0) || (m_pool.m_queuedGroupTasks > 0); });
+	}
+}
+
+/**
+	@brief Marks one of our tasks as complete
+ */
+void TaskGroup::OnTaskComplete(exception_ptr error)
+{
+	if(error)
+	{
+		lock_guard<mutex> lock(m_errorMutex);
+		if(!m_error)
+			m_error = error;
+	}
+
+	//Once the count hits zero the waiting thread may destroy us at any moment, so don't touch members afterwards
+	auto& pool = m_pool;
+	if(m_pending.fetch_sub(1) == 1)
+		pool.Wake(true);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+/**
+	@brief Creates a pool
+
+	@param numThreads	Number of worker threads
+ */
+ThreadPool::ThreadPool(size_t numThreads)
+	: m_queuedGroupTasks(0)
+	, m_terminating(false)
+{
+	numThreads = max(numThreads, (size_t)1);
+
+	//One deque per worker plus the injection deque
+	for(size_t i=0; i<=numThreads; i++)
+		m_queues.push_back(make_unique<WorkQueue>());
+
+	for(size_t i=0; i<numThreads; i++)
+		m_threads.push_back(make_unique<thread>(&ThreadPool::WorkerThread, this, i));
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		lock_guard<mutex> lock(m_wakeMutex);
+		m_terminating = true;
+	}
+	m_wakeCvar.notify_all();
+
+	for(auto& t : m_threads)
+		t->join();
+}
+
+/**
+	@brief Gets the process-wide pool, creating it if necessary
+ */
+ThreadPool& ThreadPool::GetDefault()
+{
+	auto pool = g_defaultPoolPtr.load(memory_order_acquire);
+	if(pool)
+		return *pool;
+
+	lock_guard<mutex> lock(g_defaultPoolMutex);
+	if(!g_defaultPool)
+	{
+		g_defaultPool = make_unique<ThreadPool>(GetDefaultConcurrency());
+		g_defaultPoolPtr.store(g_defaultPool.get(), memory_order_release);
+	}
+	return *g_defaultPool;
+}
+
+/**
+	@brief Caps the number of worker threads in the default pool
+
+	This is the limit on total concurrency across filter graph evaluation and all parallel loops. It must be called
+	before the default pool is first used.
+
+	@param numThreads	Number of workers, or zero for one per CPU
+ */
+void ThreadPool::SetDefaultConcurrency(size_t numThreads)
+{
+	lock_guard<mutex> lock(g_defaultPoolMutex);
+	if(g_defaultPool)
+	{
+		LogWarning("ThreadPool::SetDefaultConcurrency() called after the default pool was created, ignoring\n");
+		return;
+	}
+	g_defaultPoolSize = numThreads;
+}
+
+/**
+	@brief Gets the number of worker threads the default pool has (or will have once created)
+ */
+size_t ThreadPool::GetDefaultConcurrency()
+{
+	if(g_defaultPoolSize)
+		return g_defaultPoolSize;
+	return max(thread::hardware_concurrency(), 1U);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Task submission
+
+/**
+	@brief Queues a top level task
+
+	Top level tasks are only run by idle workers, never by a thread waiting on a TaskGroup.
+ */
+void ThreadPool::Submit(function<void()> task)
+{
+	{
+		lock_guard<mutex> lock(m_wakeMutex);
+		m_topLevelTasks.push_back(std::move(task));
+	}
+
+	//Wake everyone, since a single wakeup might go to a thread in TaskGroup::Wait() which won't take this task
+	m_wakeCvar.notify_all();
+}
+
+/**
+	@brief Splits [begin, end) into chunks and runs body(chunkBegin, chunkEnd) on each, spread across the pool
+
+	The calling thread runs the first chunk itself and then helps with the rest.
+
+	@param begin	First index
+	@param end		One past the last index
+	@param body		Function to call for each chunk
+	@param grain	Minimum number of indexes per chunk
+ */
+void ThreadPool::ParallelForRange(
+	size_t begin,
+	size_t end,
+	const function<void(size_t, size_t)>& body,
+	size_t grain)
+{
+	if(end <= begin)
+		return;
+
+	//A few chunks per thread so stealing can even out imbalanced loops
+	size_t count = end - begin;
+	size_t nchunks = min(count / max(grain, (size_t)1), 4 * (GetConcurrency() + 1));
+	if(nchunks <= 1)
+	{
+		body(begin, end);
+		return;
+	}
+
+	size_t chunksize = count / nchunks;
+	size_t extra = count % nchunks;
+	auto chunkStart = [&](size_t i)
+		{ return begin + i*chunksize + min(i, extra); };
+
+	TaskGroup group(*this);
+	group.m_pending = nchunks - 1;
+	for(size_t i=1; i<nchunks; i++)
+	{
+		size_t b = chunkStart(i);
+		size_t e = chunkStart(i+1);
+		Enqueue({ [&body, b, e]{ body(b, e); }, &group });
+	}
+	Wake(true);
+
+	exception_ptr error;
+	try
+	{
+		body(begin, chunkStart(1));
+	}
+	catch(...)
+	{
+		error = current_exception();
+	}
+
+	group.WaitWithoutRethrow();
+	if(error)
+		rethrow_exception(error);
+	group.Wait();
+}
+
+/**
+	@brief Gets the deque the current thread should push group tasks to
+ */
+ThreadPool::WorkQueue& ThreadPool::GetLocalQueue()
+{
+	if(t_currentPool == this)
+		return *m_queues[t_workerIndex];
+	return *m_queues[m_threads.size()];
+}
+
+/**
+	@brief Pushes a group task onto the current thread's deque, without waking anyone
+ */
+void ThreadPool::Enqueue(GroupTask&& task)
+{
+	auto& q = GetLocalQueue();
+	lock_guard<mutex> lock(q.m_mutex);
+	q.m_tasks.push_back(std::move(task));
+	m_queuedGroupTasks ++;
+}
+
+/**
+	@brief Wakes up sleeping workers and waiting threads
+
+	@param all	True to wake every thread (needed when a group completes, since only its owner cares),
+				false to wake a single thread to pick up one new task
+ */
+void ThreadPool::Wake(bool all)
+{
+	//Lock and unlock the mutex so nobody can miss the wakeup between checking their predicate and sleeping
+	{
+		lock_guard<mutex> lock(m_wakeMutex);
+	}
+
+	if(all)
+		m_wakeCvar.notify_all();
+	else
+		m_wakeCvar.notify_one();
+}
+
+/**
+	@brief Runs one group task: the newest from our own deque, or else the oldest from someone else's
+
+	@return True if a task was run
+ */
+bool ThreadPool::TryRunGroupTask()
+{
+	if(m_queuedGroupTasks == 0)
+		return false;
+
+	size_t self = (t_currentPool == this) ? t_workerIndex : m_threads.size();
+	size_t nqueues = m_queues.size();
+
+	GroupTask task;
+	bool found = false;
+	for(size_t i=0; i<nqueues && !found; i++)
+	{
+		auto& q = *m_queues[(self + i) % nqueues];
+		lock_guard<mutex> lock(q.m_mutex);
+		if(q.m_tasks.empty())
+			continue;
+
+		if(i == 0)
+		{
+			task = std::move(q.m_tasks.back());
+			q.m_tasks.pop_back();
+		}
+		else
+		{
+			task = std::move(q.m_tasks.front());
+			q.m_tasks.pop_front();
+		}
+		m_queuedGroupTasks --;
+		found = true;
+	}
+	if(!found)
+		return false;
+
+	exception_ptr error;
+	try
+	{
+		task.m_func();
+	}
+	catch(...)
+	{
+		error = current_exception();
+	}
+	task.m_group->OnTaskComplete(error);
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Worker threads
+
+/**
+	@brief Thread function for pool workers
+ */
+void ThreadPool::WorkerThread(ThreadPool* pThis, size_t i)
+{
+	#ifdef __linux__
+	pthread_setname_np(pthread_self(), "ThreadPool");
+	#endif
+
+	//Make locale handling thread safe on Windows
+	#ifdef _WIN32
+	_configthreadlocale(_ENABLE_PER_THREAD_LOCALE);
+	Unit::SetDefaultLocale();
+	#endif
+
+	if(HostMemory::IsThreadPinningEnabled())
+		HostMemory::PinCurrentThread(i);
+
+	t_currentPool = pThis;
+	t_workerIndex = i;
+	pThis->DoWorkerThread();
+}
+
+void ThreadPool::DoWorkerThread()
+{
+	while(true)
+	{
+		//Finish work that's already in progress before starting anything new
+		if(TryRunGroupTask())
+			continue;
+
+		function<void()> task;
+		{
+			unique_lock<mutex> lock(m_wakeMutex);
+			m_wakeCvar.wait(lock, [this]
+				{ return m_terminating || (m_queuedGroupTasks > 0) || !m_topLevelTasks.empty(); });
+
+			if(m_queuedGroupTasks > 0)
+				continue;
+
+			if(!m_topLevelTasks.empty())
+			{
+				task = std::move(m_topLevelTasks.front());
+				m_topLevelTasks.pop_front();
+			}
+			else if(m_terminating)
+				break;
+		}
+
+		try
+		{
+			task();
+		}
+		catch(const exception& e)
+		{
+			LogError("Unhandled exception in thread pool task: %s\n", e.what());
+		}
+		catch(...)
+		{
+			LogError("Unhandled exception of unknown type in thread pool task\n");
+		}
+	}
+}
@@ -0,0 +1,211 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of ThreadPool
+	@ingroup core
+ */
+
+#ifndef ThreadPool_h
+#define ThreadPool_h
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool;
+
+/**
+	@brief A set of tasks which can be waited on together
+
+	Tasks run on the pool's worker threads. A thread blocked in Wait() runs queued tasks (from this group or any other)
+	while it waits, so nested parallelism never needs more threads than the pool has.
+
+	@ingroup core
+ */
+class TaskGroup
+{
+public:
+	TaskGroup(ThreadPool& pool);
+	TaskGroup();
+	~TaskGroup();
+
+	void Run(std::function<void()> task);
+	void Wait();
+
+	TaskGroup(const TaskGroup&) = delete;
+	TaskGroup& operator=(const TaskGroup&) = delete;
+
+protected:
+	friend class ThreadPool;
+
+	void OnTaskComplete(std::exception_ptr error);
+	void WaitWithoutRethrow();
+
+	///@brief The pool our tasks run on
+	ThreadPool& m_pool;
+
+	///@brief Number of tasks which have been queued but not yet completed
+	std::atomic<size_t> m_pending;
+
+	///@brief First exception thrown by any of our tasks
+	std::exception_ptr m_error;
+
+	///@brief Mutex for access to m_error
+	std::mutex m_errorMutex;
+};
+
+/**
+	@brief Work-stealing thread pool shared by filter graph evaluation and data-parallel loops
+
+	The pool runs two kinds of work:
+	- Top level tasks, queued with Submit(). FilterGraphExecutor uses these to evaluate filter graph nodes. An idle
+	  worker runs them one at a time.
+	- Group tasks, queued with TaskGroup::Run() or ParallelFor(). Each worker keeps its own deque of these, runs them
+	  newest first, and steals the oldest tasks from other workers when its own deque is empty. Threads outside the
+	  pool put their tasks on a shared injection deque.
+
+	A thread waiting on a TaskGroup only helps with group tasks, never top level tasks. A filter which is waiting on
+	its own parallel loop (while holding locks for its node) therefore never starts running a second node on the same
+	stack.
+
+	ParallelFor() replaces "#pragma omp parallel for". Unlike OpenMP, calling it from inside another parallel region
+	or from a filter graph worker does not start a new team of threads, so the total number of busy threads is capped
+	by the size of the pool. The only extra threads are outside callers that are blocked waiting on their own loop.
+
+	@ingroup core
+ */
+class ThreadPool
+{
+public:
+	ThreadPool(size_t numThreads);
+	virtual ~ThreadPool();
+
+	static ThreadPool& GetDefault();
+	static void SetDefaultConcurrency(size_t numThreads);
+	static size_t GetDefaultConcurrency();
+
+	///@brief Returns the number of worker threads
+	size_t GetConcurrency()
+	{ return m_threads.size(); }
+
+	void Submit(std::function<void()> task);
+
+	void ParallelForRange(
+		size_t begin,
+		size_t end,
+		const std::function<void(size_t, size_t)>& body,
+		size_t grain = 1);
+
+	/**
+		@brief Runs body(i) for each i in [begin, end), spreading the iterations across the pool
+
+		Returns once every iteration has completed.
+
+		@param begin	First index
+		@param end		One past the last index
+		@param body		Function to call for each index
+		@param parallel	If false, run serially on the calling thread (equivalent to an OpenMP "if" clause)
+	 */
+	template<class F>
+	void ParallelFor(size_t begin, size_t end, F&& body, bool parallel = true)
+	{
+		if(!parallel || (end - begin) < 2)
+		{
+			for(size_t i=begin; i<end; i++)
+				body(i);
+			return;
+		}
+
+		ParallelForRange(begin, end, [&body](size_t b, size_t e)
+			{
+				for(size_t i=b; i<e; i++)
+					body(i);
+			});
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+protected:
+	friend class TaskGroup;
+
+	///@brief A task belonging to a TaskGroup
+	struct GroupTask
+	{
+		std::function<void()> m_func;
+		TaskGroup* m_group;
+	};
+
+	///@brief Deque of group tasks owned by one thread
+	struct WorkQueue
+	{
+		std::mutex m_mutex;
+		std::deque<GroupTask> m_tasks;
+	};
+
+	static void WorkerThread(ThreadPool* pThis, size_t i);
+	void DoWorkerThread();
+
+	WorkQueue& GetLocalQueue();
+	void Enqueue(GroupTask&& task);
+	bool TryRunGroupTask();
+	void Wake(bool all);
+
+	///@brief Worker threads
+	std::vector<std::unique_ptr<std::thread>> m_threads;
+
+	///@brief Per-worker task deques, followed by the injection deque used by threads outside the pool
+	std::vector<std::unique_ptr<WorkQueue>> m_queues;
+
+	///@brief Total number of tasks in m_queues
+	std::atomic<size_t> m_queuedGroupTasks;
+
+	///@brief Top level tasks (protected by m_wakeMutex)
+	std::deque<std::function<void()>> m_topLevelTasks;
+
+	///@brief Condition variable for waking up idle workers and waiting threads when work arrives or a group finishes
+	std::condition_variable m_wakeCvar;
+
+	///@brief Mutex for access to m_wakeCvar
+	std::mutex m_wakeMutex;
+
+	///@brief Shutdown flag
+	bool m_terminating;
+};
+
+#endif
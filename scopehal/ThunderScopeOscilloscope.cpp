@@ -63,6 +63,9 @@ ThunderScopeOscilloscope::ThunderScopeOscilloscope(SCPITransport* transport)
 	, m_diag_droppedWFMs(FilterParameter::TYPE_INT, Unit(Unit::UNIT_COUNTS))
 	, m_diag_droppedPercent(FilterParameter::TYPE_FLOAT, Unit(Unit::UNIT_PERCENT))
 {
+	//Never queue more than two waveforms, drop the oldest if the consumer falls behind
+	SetPendingQueueLimits(2, 0, QUEUE_DROP_OLDEST);
+
 	m_analogChannelCount = 4;
 
 	//Add analog channel objects
@@ -313,6 +316,16 @@ Oscilloscope::TriggerMode ThunderScopeOscilloscope::PollTrigger()
 	return TRIGGER_MODE_TRIGGERED;
 }
 
+/**
+	@brief Returns dropped waveforms to the analog pool rather than freeing them
+ */
+void ThunderScopeOscilloscope::DiscardPendingWaveform(SequenceSet& set)
+{
+	for(auto it : set)
+		AddWaveformToAnalogPool(it.second);
+	set.clear();
+}
+
 bool ThunderScopeOscilloscope::AcquireData()
 {
 	const uint8_t r = 'K';
@@ -465,8 +478,7 @@ bool ThunderScopeOscilloscope::AcquireData()
 	else
 	{
 		//Process analog captures in parallel
-		#pragma omp parallel for
-		for(size_t i=0; i<awfms.size(); i++)
+		ThreadPool::GetDefault().ParallelFor(0, awfms.size(), [&](size_t i)
 		{
 			auto cap = awfms[i];
 			cap->PrepareForCpuAccess();
@@ -477,7 +489,7 @@ bool ThunderScopeOscilloscope::AcquireData()
 				offsets[i],
 				cap->m_samples.size());
 			cap->MarkModifiedFromCpu();
-		}
+		});
 	}
 
 	FilterParameter* param = &m_diag_totalWFMs;
@@ -489,19 +501,8 @@ bool ThunderScopeOscilloscope::AcquireData()
 
 	//Save the waveforms to our queue
 	m_pendingWaveformsMutex.lock();
-	m_pendingWaveforms.push_back(s);
-
-	//If we get backed up, drop the extra waveforms
-	while (m_pendingWaveforms.size() > 2)
-	{
-		SequenceSet set = *m_pendingWaveforms.begin();
-		for(auto it : set)
-			AddWaveformToAnalogPool(it.second);
-		m_pendingWaveforms.pop_front();
-
-		dropped++;
-	}
-
+	//Queue depth is limited to two waveforms, if we get backed up the oldest ones are dropped
+	dropped += PushPendingWaveform(s);
 	m_pendingWaveformsMutex.unlock();
 
 	param->SetIntVal(dropped);
@@ -100,6 +100,8 @@ protected:
 	void ResetPerCaptureDiagnostics();
 	void RefreshSampleRate();
 
+	virtual void DiscardPendingWaveform(SequenceSet& set) override;
+
 	std::string GetChannelColor(size_t i);
 
 	///@brief Number of analog channels (always 4 at the moment)
@@ -37,6 +37,7 @@
 
 #include "scopehal.h"
 #include "TinySA.h"
+#include "SpectrumTraceProcessor.h"
 #include <cinttypes>
 
 using namespace std;
@@ -302,10 +303,19 @@ bool TinySA::AcquireData()
 
 	// Store sample depth value
 	size_t nsamples = m_sampleDepth;
-	string command = "scanraw " + std::to_string(m_sweepStart) + " " + std::to_string(m_sweepStop) + " " + std::to_string(nsamples);
+
+	//Detectors other than sample need several raw points per display bin
+	size_t nraw = nsamples;
+	if(GetDetectorMode() != SpectrumTraceProcessor::DETECTOR_SAMPLE)
+	{
+		size_t maxPoints = GetSampleDepthsNonInterleaved().back();
+		nraw = nsamples * max((size_t)1, min(DETECTOR_OVERSAMPLE, maxPoints / nsamples));
+	}
+
+	string command = "scanraw " + std::to_string(m_sweepStart) + " " + std::to_string(m_sweepStop) + " " + std::to_string(nraw);
 	std::vector<uint8_t> data;
 	// Data format is  '{' ('x' MSB LSB)*points '}'
-	size_t toRead = nsamples * 3 + 2;
+	size_t toRead = nraw * 3 + 2;
 	size_t read = ConverseBinary(command,data,toRead);
 	if(read != toRead)
 	{
@@ -329,25 +339,13 @@ bool TinySA::AcquireData()
 	cap->Resize(nsamples);
 	cap->PrepareForCpuAccess();
 
-	// Check data opening and closing brackets
-	if(data[0] != '{')
-		LogWarning("Invalid opening byte '%02x'.\n",data[0]);
-	if(data[toRead-1] != '}')
-		LogWarning("Invalid closing byte '%02x'.\n",data[toRead-1]);
+	//We get dBm from the instrument (in 1/32 dB steps), so just have to apply the model offset
+	vector<float> raw(nraw);
+	if(!SpectrumTraceProcessor::ParseTinySAScanRaw(data.data(), toRead, nraw, m_modelDbmOffset, raw.data()))
+		LogWarning("Invalid framing in scanraw response.\n");
 
-	//We get dBm from the instrument, so just have to convert double to single precision
-	for(size_t j=0; j<nsamples; j++)
-	{
-		// Read content (3 bytes per point, skipping first byte)
-		uint8_t data0 = data[1+3*j];
-		uint16_t data1 = (uint16_t)data[2+3*j];
-		uint16_t data2 = (uint16_t)data[3+3*j];
-		if(data0 != 'x')
-			LogWarning("Invalid point header byte '%02x'.\n",data0);
-		float value = (((float)((data2 << 8) + data1))/32)-m_modelDbmOffset;
-		//LogDebug("Value[%zu] = %02x%02x = %f\n",j,data1,data2,value);
-		cap->m_samples[j] = value;
-	}
+	//Detector, normalization and trace averaging
+	ProcessTrace(raw.data(), nraw, cap->m_samples.GetCpuPointer(), nsamples, m_sweepStart, stepsize);
 
 	//Done, update the data
 	cap->MarkSamplesModifiedFromCpu();
@@ -374,7 +372,7 @@ bool TinySA::AcquireData()
 			if(IsChannelEnabled(j))
 				s[GetOscilloscopeChannel(j)] = pending_waveforms[j][i];
 		}
-		m_pendingWaveforms.push_back(s);
+		PushPendingWaveform(s);
 	}
 	m_pendingWaveformsMutex.unlock();
 
@@ -411,6 +409,7 @@ void TinySA::SetResolutionBandwidth(int64_t rbw)
 	m_rbw = min(m_rbwMax, m_rbw);
 	// Send rbw and read actual return
 	m_rbw = ConverseRbwValue(true, m_rbw);
+	OnSweepChanged();
 }
 
 void TinySA::SetSpan(int64_t span)
@@ -426,6 +425,7 @@ void TinySA::SetSpan(int64_t span)
 
 	// Send and read back the values to/from the devices to check boundaries
 	ConverseSweep(m_sweepStart,m_sweepStop,true);
+	OnSweepChanged();
 }
 
 int64_t TinySA::GetSpan()
@@ -446,6 +446,7 @@ void TinySA::SetCenterFrequency([[maybe_unused]] size_t channel, int64_t freq)
 
 	// Send and read back the values to/from the devices to check boundaries
 	ConverseSweep(m_sweepStart,m_sweepStop,true);
+	OnSweepChanged();
 }
 
 int64_t TinySA::GetCenterFrequency([[maybe_unused]] size_t channel)
@@ -102,6 +102,9 @@ protected:
 	// dbm offset to apply on values received from the device (model depedant)
 	int64_t m_modelDbmOffset;
 
+	///@brief Raw points swept per display bin when a detector other than sample is selected
+	static constexpr size_t DETECTOR_OVERSAMPLE = 4;
+
 	//Vulkan peak detection
 	std::shared_ptr<QueueHandle> m_queue;
 	std::unique_ptr<vk::raii::CommandPool> m_pool;
@@ -37,6 +37,8 @@
 #include "scopehal.h"
 
 #include <cinttypes>
+#include <array>
+#include <charconv>
 
 using namespace std;
 
@@ -239,359 +241,457 @@ string Unit::ToString() const
 	}
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Scaling tables
+
 /**
-	@brief Gets the appropriate SI scaling factor for a number.
+	@brief One step of a prefix ladder
+
+	Values with a magnitude at or above the threshold are multiplied by the scale factor and printed with the prefix.
  */
-void Unit::GetSIScalingFactor(double num, double& scaleFactor, string& prefix) const
+struct UnitPrefixStep
 {
-	scaleFactor = 1;
-	prefix = "";
-	num = fabs(num);
+	double threshold;
+	double scale;
+	const char* prefix;
+};
 
-	//Bytes: use binary rather than decimal scaling factors
-	if(m_type == UNIT_BYTES)
-	{
-		if(num >= 1024)
-		{
-			scaleFactor = 1.0 / 1024;
-			prefix = "k";
-		}
-		if(num >= 1024*1024)
-		{
-			scaleFactor = 1.0 / (1024*1024);
-			prefix = "M";
-		}
-		if(num >= 1024*1024*1024)
-		{
-			scaleFactor = 1.0 / (1024*1024*1024);
-			prefix = "G";
-		}
-		return;
-	}
+/**
+	@brief SI prefixes for values of 1000 and up
 
-	if(num >= 1e12f)
-	{
-		scaleFactor = 1e-12;
-		prefix = "T";
-	}
-	else if(num >= 1e9f)
-	{
-		scaleFactor = 1e-9;
-		prefix = "G";
-	}
-	else if(num >= 1e6)
-	{
-		scaleFactor = 1e-6;
-		prefix = "M";
-	}
-	else if(num >= 1e3)
-	{
-		scaleFactor = 1e-3;
-		prefix = "k";
-	}
-	else if(num < 1)
-	{
-		scaleFactor = 1e3;
-		prefix = "m";
-	}
-	else if(num < 1e-6)
-	{
-		scaleFactor = 1e6;
-		prefix = "μ";
-	}
-	else if(num < 1e-9)
-	{
-		scaleFactor = 1e9;
-		prefix = "n";
-	}
-	else if(num < 1e-12)
-	{
-		scaleFactor = 1e12;
-		prefix = "p";
-	}
-	else if(num < 1e-15)
-	{
-		scaleFactor = 1e15;
-		prefix = "f";
-	}
-}
+	Values below 1 get a "m" prefix and everything else is printed unscaled (see GetScaling()).
+	The T and G thresholds are single precision constants.
+ */
+static const UnitPrefixStep g_siPrefixes[] =
+{
+	{ 1e12f,	1e-12,	"T" },
+	{ 1e9f,		1e-9,	"G" },
+	{ 1e6,		1e-6,	"M" },
+	{ 1e3,		1e-3,	"k" }
+};
+
+///@brief Binary prefixes for UNIT_BYTES
+static const UnitPrefixStep g_binaryPrefixes[] =
+{
+	{ 1024*1024*1024,	1.0 / (1024*1024*1024),	"G" },
+	{ 1024*1024,		1.0 / (1024*1024),		"M" },
+	{ 1024,				1.0 / 1024,				"k" }
+};
+
+///@brief Prefixes for UNIT_FS (values are in femtoseconds, printed as seconds)
+static const UnitPrefixStep g_fsPrefixes[] =
+{
+	{ 1e15,	1e-15,	"" },
+	{ 1e12,	1e-12,	"m" },
+	{ 1e9,	1e-9,	"μ" },
+	{ 1e6,	1e-6,	"n" },
+	{ 1e3,	1e-3,	"p" }
+};
+
+///@brief Prefixes for UNIT_PM (values are in picometers, printed as meters)
+static const UnitPrefixStep g_pmPrefixes[] =
+{
+	{ 1e15,	1e-15,	"k" },
+	{ 1e12,	1e-12,	"" },
+	{ 1e9,	1e-9,	"m" },
+	{ 1e6,	1e-6,	"μ" },
+	{ 1e3,	1e-3,	"n" }
+};
+
+///@brief Prefixes for UNIT_MICROVOLTS and UNIT_MICROAMPS
+static const UnitPrefixStep g_microPrefixes[] =
+{
+	{ 1e12,	1e-12,	"M" },
+	{ 1e9,	1e-9,	"k" },
+	{ 1e6,	1e-6,	"" },
+	{ 1e3,	1e-3,	"m" }
+};
 
 /**
-	@brief Gets the suffix for a unit.
+	@brief How a unit picks its scale factor and prefix
+ */
+enum UnitScaling
+{
+	SCALING_SI,			//SI prefixes
+	SCALING_FIXED,		//Constant scale factor, no prefix
+	SCALING_LADDER		//Unit-specific prefix ladder
+};
 
-	Note that this function may modify the SI scale factor and prefix
+/**
+	@brief Formatting configuration for a single unit
  */
-void Unit::GetUnitSuffix(UnitType type, double num, double& scaleFactor, string& prefix, string& numprefix, string& suffix) const
+struct UnitFormat
 {
-	numprefix = "";
+	UnitScaling scaling;
 
-	switch(type)
-	{
-		//Special handling needed around prefixes, since it's not a SI base unit
-		case UNIT_FS:
-			suffix = "s";
+	///@brief Scale factor for SCALING_FIXED
+	double fixedScale;
 
-			if(fabs(num) >= 1e15)
-			{
-				scaleFactor = 1e-15;
-				prefix = "";
-			}
-			else if(fabs(num) >= 1e12)
-			{
-				scaleFactor = 1e-12;
-				prefix = "m";
-			}
-			else if(fabs(num) >= 1e9)
-			{
-				scaleFactor = 1e-9;
-				prefix = "μ";
-			}
-			else if(fabs(num) >= 1e6)
-			{
-				scaleFactor = 1e-6;
-				prefix = "n";
-			}
-			else if(fabs(num) >= 1e3)
-			{
-				scaleFactor = 1e-3;
-				prefix = "p";
-			}
-			else
-			{
-				scaleFactor = 1;
-				prefix = "f";
-			}
-			break;
+	///@brief Prefix ladder for SCALING_LADDER
+	const UnitPrefixStep* ladder;
+	size_t ladderLen;
 
-		//Also not a SI base unit
-		case UNIT_PM:
-			suffix = "m";
+	///@brief Prefix used (with a scale of 1) for values below the bottom of the ladder
+	const char* ladderFallback;
 
-			if(fabs(num) >= 1e15)
-			{
-				scaleFactor = 1e-15;
-				prefix = "k";
-			}
-			else if(fabs(num) >= 1e12)
-			{
-				scaleFactor = 1e-12;
-				prefix = "";
-			}
-			else if(fabs(num) >= 1e9)
-			{
-				scaleFactor = 1e-9;
-				prefix = "m";
-			}
-			else if(fabs(num) >= 1e6)
-			{
-				scaleFactor = 1e-6;
-				prefix = "μ";
-			}
-			else if(fabs(num) >= 1e3)
-			{
-				scaleFactor = 1e-3;
-				prefix = "n";
-			}
-			else
-			{
-				scaleFactor = 1;
-				prefix = "p";
-			}
-			break;
+	///@brief Printed before the number
+	const char* numprefix;
 
-		//uA is not a SI base unit either
-		case UNIT_MICROAMPS:
-			suffix = "A";
+	///@brief Printed after the SI prefix
+	const char* suffix;
 
-			if(fabs(num) >= 1e12)
-			{
-				scaleFactor = 1e-12;
-				prefix = "M";
-			}
-			else if(fabs(num) >= 1e9)
-			{
-				scaleFactor = 1e-9;
-				prefix = "k";
-			}
-			else if(fabs(num) >= 1e6)
-			{
-				scaleFactor = 1e-6;
-				prefix = "";
-			}
-			else if(fabs(num) >= 1e3)
-			{
-				scaleFactor = 1e-3;
-				prefix = "m";
-			}
-			else
-			{
-				scaleFactor = 1;
-				prefix = "μ";
-			}
+	///@brief True to put a space between the number and the prefix
+	bool spaceAfterNumber;
+};
 
-			break;
+/**
+	@brief Creates the formatting configuration for a unit
+ */
+static UnitFormat MakeUnitFormat(Unit::UnitType type)
+{
+	UnitFormat f;
+	f.scaling = SCALING_SI;
+	f.fixedScale = 1;
+	f.ladder = nullptr;
+	f.ladderLen = 0;
+	f.ladderFallback = "";
+	f.numprefix = "";
+	f.suffix = "";
+	f.spaceAfterNumber = true;
 
-		//uV is not a SI base unit either
-		case UNIT_MICROVOLTS:
-			suffix = "V";
+	switch(type)
+	{
+		//Special handling needed around prefixes, since it's not a SI base unit
+		case Unit::UNIT_FS:
+			f.scaling = SCALING_LADDER;
+			f.ladder = g_fsPrefixes;
+			f.ladderLen = sizeof(g_fsPrefixes) / sizeof(g_fsPrefixes[0]);
+			f.ladderFallback = "f";
+			f.suffix = "s";
+			break;
 
-			if(fabs(num) >= 1e12)
-			{
-				scaleFactor = 1e-12;
-				prefix = "M";
-			}
-			else if(fabs(num) >= 1e9)
-			{
-				scaleFactor = 1e-9;
-				prefix = "k";
-			}
-			else if(fabs(num) >= 1e6)
-			{
-				scaleFactor = 1e-6;
-				prefix = "";
-			}
-			else if(fabs(num) >= 1e3)
-			{
-				scaleFactor = 1e-3;
-				prefix = "m";
-			}
-			else
-			{
-				scaleFactor = 1;
-				prefix = "μ";
-			}
+		//Also not a SI base unit
+		case Unit::UNIT_PM:
+			f.scaling = SCALING_LADDER;
+			f.ladder = g_pmPrefixes;
+			f.ladderLen = sizeof(g_pmPrefixes) / sizeof(g_pmPrefixes[0]);
+			f.ladderFallback = "p";
+			f.suffix = "m";
+			break;
 
+		//uA and uV are not SI base units either
+		case Unit::UNIT_MICROAMPS:
+		case Unit::UNIT_MICROVOLTS:
+			f.scaling = SCALING_LADDER;
+			f.ladder = g_microPrefixes;
+			f.ladderLen = sizeof(g_microPrefixes) / sizeof(g_microPrefixes[0]);
+			f.ladderFallback = "μ";
+			f.suffix = (type == Unit::UNIT_MICROAMPS) ? "A" : "V";
 			break;
 
-		case UNIT_HZ:
-			suffix = "Hz";
+		case Unit::UNIT_HZ:
+			f.suffix = "Hz";
 			break;
 
-		case UNIT_SAMPLERATE:
-			suffix = "S/s";
+		case Unit::UNIT_SAMPLERATE:
+			f.suffix = "S/s";
 			break;
 
-		case UNIT_SAMPLEDEPTH:
-			suffix = "S";
+		case Unit::UNIT_SAMPLEDEPTH:
+			f.suffix = "S";
 			break;
 
-		case UNIT_VOLTS:
-			suffix = "V";
+		case Unit::UNIT_VOLTS:
+			f.suffix = "V";
 			break;
 
 		//No scaling applied, forced to mV (special case)
-		case UNIT_MILLIVOLTS:
-			suffix = "mV";
-			scaleFactor = 1;
-			prefix = "";
+		case Unit::UNIT_MILLIVOLTS:
+			f.scaling = SCALING_FIXED;
+			f.suffix = "mV";
 			break;
 
-		case UNIT_AMPS:
-			suffix = "A";
+		case Unit::UNIT_AMPS:
+			f.suffix = "A";
 			break;
 
-		case UNIT_OHMS:
-			suffix = "Ω";
+		case Unit::UNIT_OHMS:
+			f.suffix = "Ω";
 			break;
 
-		case UNIT_WATTS:
-			suffix = "W";
+		case Unit::UNIT_WATTS:
+			f.suffix = "W";
 			break;
 
-		case UNIT_RHO:
-			suffix = "ρ";
+		case Unit::UNIT_RHO:
+			f.suffix = "ρ";
 			break;
 
-		case UNIT_BITRATE:
-			suffix = "bps";
+		case Unit::UNIT_BITRATE:
+			f.suffix = "bps";
 			break;
-		case UNIT_UI:
-			suffix = " UI";	//move the space next to the number
+
+		case Unit::UNIT_UI:
+			f.suffix = " UI";	//move the space next to the number
+			f.spaceAfterNumber = false;
 			break;
-		case UNIT_RPM:
-			suffix = "RPM";
+
+		case Unit::UNIT_RPM:
+			f.suffix = "RPM";
 			break;
 
-		case UNIT_FARADS:
-			suffix = "F";
+		case Unit::UNIT_FARADS:
+			f.suffix = "F";
 			break;
 
 		//Angular degrees do not use SI prefixes
-		case UNIT_DEGREES:
-			suffix = "°";
-			prefix = "";
-			scaleFactor = 1;
+		case Unit::UNIT_DEGREES:
+			f.scaling = SCALING_FIXED;
+			f.suffix = "°";
 			break;
 
 		//Neither do thermal degrees
-		case UNIT_CELSIUS:
-			suffix = "°C";
-			prefix = "";
-			scaleFactor = 1;
+		case Unit::UNIT_CELSIUS:
+			f.scaling = SCALING_FIXED;
+			f.suffix = "°C";
 			break;
 
 		//No rescaling for pointers
-		case UNIT_HEXNUM:
-			suffix = "";
-			prefix = "";
-			numprefix = "0x";
-			scaleFactor = 1;
+		case Unit::UNIT_HEXNUM:
+			f.scaling = SCALING_FIXED;
+			f.numprefix = "0x";
+			f.spaceAfterNumber = false;
 			break;
 
 		//dBm are always reported as is, with no SI prefixes
-		case UNIT_DBM:
-			suffix = "dBm";
-			prefix = "";
-			scaleFactor = 1;
+		case Unit::UNIT_DBM:
+			f.scaling = SCALING_FIXED;
+			f.suffix = "dBm";
 			break;
 
 		//Convert fractional num to percentage
-		case UNIT_PERCENT:
-			suffix = "%";
-			prefix = "";
-			scaleFactor = 100;
+		case Unit::UNIT_PERCENT:
+			f.scaling = SCALING_FIXED;
+			f.fixedScale = 100;
+			f.suffix = "%";
 			break;
 
-		case UNIT_COUNTS_SCI:
-			suffix = "#";
-			break;
-
-		case UNIT_RATIO_SCI:
-			suffix = "";
+		case Unit::UNIT_COUNTS_SCI:
+			f.suffix = "#";
 			break;
 
 		//Dimensionless unit, no scaling applied
-		case UNIT_DB:
-			suffix = "dB";
-			prefix = "";
-			scaleFactor = 1;
+		case Unit::UNIT_DB:
+			f.scaling = SCALING_FIXED;
+			f.suffix = "dB";
 			break;
-		case UNIT_COUNTS:
-		case UNIT_LOG_BER:
-			suffix = "";
-			prefix = "";
-			scaleFactor = 1;
+
+		case Unit::UNIT_COUNTS:
+		case Unit::UNIT_LOG_BER:
+			f.scaling = SCALING_FIXED;
 			break;
-		case UNIT_VOLT_SEC:
-			suffix = "Vs";
+
+		case Unit::UNIT_VOLT_SEC:
+			f.suffix = "Vs";
 			break;
 
 		//Bytes: use binary rather than decimal scaling factors
-		case UNIT_BYTES:
-			suffix = "B";
-			if(scaleFactor <= 1e-9)
-				scaleFactor = 1.0 / (1024 * 1024 * 1024);
-			else if(scaleFactor <= 1e-6)
-				scaleFactor = 1.0 / (1024 * 1024);
-			else if(scaleFactor <= 1e-3)
-				scaleFactor = 1.0 / 1024;
+		case Unit::UNIT_BYTES:
+			f.scaling = SCALING_LADDER;
+			f.ladder = g_binaryPrefixes;
+			f.ladderLen = sizeof(g_binaryPrefixes) / sizeof(g_binaryPrefixes[0]);
+			f.suffix = "B";
 			break;
 
+		//Everything else gets SI prefixes and no suffix
 		default:
 			break;
 	}
+
+	return f;
+}
+
+/**
+	@brief Looks up the formatting configuration for a unit
+
+	The table is built once on first use, so formatting a value never has to re-derive it.
+ */
+static const UnitFormat& GetUnitFormat(Unit::UnitType type)
+{
+	static const size_t count = Unit::UNIT_FARADS + 1;
+	static const auto formats = []
+	{
+		array<UnitFormat, count> ret;
+		for(size_t i=0; i<count; i++)
+			ret[i] = MakeUnitFormat(static_cast<Unit::UnitType>(i));
+		return ret;
+	}();
+	static const UnitFormat fallback = MakeUnitFormat(Unit::UNIT_COUNTS_SCI);
+
+	if(static_cast<size_t>(type) < count)
+		return formats[type];
+	return fallback;
 }
 
+/**
+	@brief Gets the scale factor, SI prefix, number prefix and suffix to use for printing a value in this unit
+ */
+void Unit::GetScaling(double num, double& scaleFactor, const char*& prefix, const char*& numprefix, const char*& suffix)
+	const
+{
+	auto& f = GetUnitFormat(m_type);
+	numprefix = f.numprefix;
+	suffix = f.suffix;
+
+	num = fabs(num);
+	switch(f.scaling)
+	{
+		case SCALING_FIXED:
+			scaleFactor = f.fixedScale;
+			prefix = "";
+			return;
+
+		case SCALING_LADDER:
+			for(size_t i=0; i<f.ladderLen; i++)
+			{
+				if(num >= f.ladder[i].threshold)
+				{
+					scaleFactor = f.ladder[i].scale;
+					prefix = f.ladder[i].prefix;
+					return;
+				}
+			}
+			scaleFactor = 1;
+			prefix = f.ladderFallback;
+			return;
+
+		case SCALING_SI:
+		default:
+			for(auto& step : g_siPrefixes)
+			{
+				if(num >= step.threshold)
+				{
+					scaleFactor = step.scale;
+					prefix = step.prefix;
+					return;
+				}
+			}
+			if(num < 1)
+			{
+				scaleFactor = 1e3;
+				prefix = "m";
+			}
+			else
+			{
+				scaleFactor = 1;
+				prefix = "";
+			}
+			return;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Formatting
+
+/**
+	@brief Append-only writer for building formatted values in a fixed size buffer
+
+	Matches snprintf() truncation semantics: anything past the end of the buffer is dropped, and the buffer is always
+	null terminated.
+ */
+class UnitTextBuffer
+{
+public:
+	UnitTextBuffer(char* buf, size_t len)
+	: m_buf(buf)
+	, m_len(len)
+	, m_pos(0)
+	{
+		if(m_len)
+			m_buf[0] = '\0';
+	}
+
+	void Append(const char* s, size_t n)
+	{
+		if(m_len == 0)
+			return;
+		n = min(n, m_len - 1 - m_pos);
+		memcpy(m_buf + m_pos, s, n);
+		m_pos += n;
+		m_buf[m_pos] = '\0';
+	}
+
+	void Append(const char* s)
+	{ Append(s, strlen(s)); }
+
+	void Append(char c)
+	{ Append(&c, 1); }
+
+	/**
+		@brief Appends a number as if by printf("%.*f") or printf("%.*e"), with a custom decimal separator
+	 */
+	void AppendFloat(double v, int precision, bool scientific, char separator)
+	{
+		char tmp[512];
+		size_t n = 0;
+
+		#ifdef __cpp_lib_to_chars
+			auto res = to_chars(tmp, tmp + sizeof(tmp), v, scientific ? chars_format::scientific : chars_format::fixed,
+				precision);
+			if(res.ec == errc())
+				n = res.ptr - tmp;
+		#endif
+
+		//Fall back to the C library if to_chars isn't available (we're always in the "C" locale here)
+		if(n == 0)
+			n = min<int>(snprintf(tmp, sizeof(tmp), scientific ? "%.*e" : "%.*f", precision, v), sizeof(tmp) - 1);
+
+		if(separator != '.')
+		{
+			for(size_t i=0; i<n; i++)
+			{
+				if(tmp[i] == '.')
+					tmp[i] = separator;
+			}
+		}
+		Append(tmp, n);
+	}
+
+	/**
+		@brief Appends an integer as if by printf("%0*" PRId64)
+	 */
+	void AppendInt(int64_t v, int width = 0)
+	{
+		char tmp[32];
+		auto res = to_chars(tmp, tmp + sizeof(tmp), v);
+		size_t n = res.ptr - tmp;
+
+		//Zero padding goes after the sign
+		size_t sign = (v < 0) ? 1 : 0;
+		if(sign)
+			Append('-');
+		for(int i = n; i < width; i++)
+			Append('0');
+		Append(tmp + sign, n - sign);
+	}
+
+	///@brief Appends an integer in lowercase hex, as if by printf("%" PRIx64)
+	void AppendHex(uint64_t v)
+	{
+		char tmp[32];
+		auto res = to_chars(tmp, tmp + sizeof(tmp), v, 16);
+		Append(tmp, res.ptr - tmp);
+	}
+
+	size_t size()
+	{ return m_pos; }
+
+protected:
+	char* m_buf;
+	size_t m_len;
+	size_t m_pos;
+};
+
 /**
 	@brief Prints a value with SI scaling factors
 
@@ -602,43 +702,57 @@ void Unit::GetUnitSuffix(UnitType type, double num, double& scaleFactor, string&
  */
 string Unit::PrettyPrint(double value, int sigfigs, bool useDisplayLocale) const
 {
-	if(useDisplayLocale)
-		SetPrintingLocale();
+	char tmp[192];
+	size_t len = PrettyPrint(tmp, sizeof(tmp), value, sigfigs, useDisplayLocale);
+	return string(tmp, len);
+}
+
+/**
+	@brief Prints a value with SI scaling factors into a caller supplied buffer, without allocating memory
+
+	The output is identical to the std::string version, truncated if it does not fit in the buffer.
+
+	@param buf					Output buffer (always null terminated if len is nonzero)
+	@param len					Size of the output buffer
+	@param value				The value
+	@param digits				Number of significant digits to display
+	@param useDisplayLocale		True if the string is formatted for display (user's locale)
+								False if the string is formatted for serialization ("C" locale regardless of user pref)
+
+	@return Number of characters written, not including the null terminator
+ */
+size_t Unit::PrettyPrint(char* buf, size_t len, double value, int sigfigs, bool useDisplayLocale) const
+{
+	char separator = useDisplayLocale ? m_decimalSeparator : '.';
 
 	//Figure out scaling, prefix, and suffix
 	double scaleFactor;
-	string prefix;
-	string numprefix;
-	string suffix;
-	GetSIScalingFactor(value, scaleFactor, prefix);
-	GetUnitSuffix(m_type, value, scaleFactor, prefix, numprefix, suffix);
+	const char* prefix;
+	const char* numprefix;
+	const char* suffix;
+	GetScaling(value, scaleFactor, prefix, numprefix, suffix);
 
 	double value_rescaled = value * scaleFactor;
-	bool space_after_number = (m_type != Unit::UNIT_UI) && (m_type != Unit::UNIT_HEXNUM);
 
 	char tmp[128];
+	UnitTextBuffer body(tmp, sizeof(tmp));
 	switch(m_type)
 	{
 		case UNIT_LOG_BER:		//special formatting for BER since it's already logarithmic
-			snprintf(tmp, sizeof(tmp), "%.2e", pow(10, value));
-			//snprintf(tmp, sizeof(tmp), "1e%.2f", value);
+			body.AppendFloat(pow(10, value), 2, true, separator);
 			break;
 
 		case UNIT_RATIO_SCI:
-			snprintf(tmp, sizeof(tmp), "%.2e", value);
+			body.AppendFloat(value, 2, true, separator);
 			break;
 
 		//NOTE: only works for 32 bit values or smaller
 		case UNIT_HEXNUM:
-			snprintf(tmp, sizeof(tmp), "%x", static_cast<uint32_t>(value));
+			body.AppendHex(static_cast<uint32_t>(value));
 			break;
 
 		default:
 			{
-				const char* space = " ";
-				if(!space_after_number)
-					space = "";
-
 				if(sigfigs > 0)
 				{
 					int leftdigits = 0;
@@ -652,32 +766,54 @@ string Unit::PrettyPrint(double value, int sigfigs, bool useDisplayLocale) const
 						leftdigits = 1;
 					int rightdigits = sigfigs - leftdigits;
 
-					string format = string("%") + to_string(leftdigits) + "." + to_string(rightdigits) + "f%s%s%s";
-					snprintf(tmp, sizeof(tmp), format.c_str(), value_rescaled, space, prefix.c_str(), suffix.c_str());
+					//For finite values the field width is never wider than the integer part, so it has no effect and
+					//to_chars can do the work. Padded inf/nan and negative precisions are left to the C library.
+					if( (rightdigits < 0) || !isfinite(value_rescaled) )
+					{
+						if(useDisplayLocale)
+							SetPrintingLocale();
+						const char* space = GetUnitFormat(m_type).spaceAfterNumber ? " " : "";
+						string format = string("%") + to_string(leftdigits) + "." + to_string(rightdigits) + "f%s%s%s";
+						snprintf(tmp, sizeof(tmp), format.c_str(), value_rescaled, space, prefix, suffix);
+						SetDefaultLocale();
+
+						UnitTextBuffer out(buf, len);
+						out.Append(numprefix);
+						out.Append(tmp);
+						return out.size();
+					}
+					body.AppendFloat(value_rescaled, rightdigits, false, separator);
 				}
 
 				//If not a round number, add more digits (up to 5)
 				else
 				{
-					if( fabs(round(value_rescaled) - value_rescaled) < 0.001 )
-						snprintf(tmp, sizeof(tmp), "%.0f%s%s%s", value_rescaled, space, prefix.c_str(), suffix.c_str());
-					else if(fabs(round(value_rescaled*10) - value_rescaled*10) < 0.001)
-						snprintf(tmp, sizeof(tmp), "%.1f%s%s%s", value_rescaled, space, prefix.c_str(), suffix.c_str());
-					else if(fabs(round(value_rescaled*100) - value_rescaled*100) < 0.001 )
-						snprintf(tmp, sizeof(tmp), "%.2f%s%s%s", value_rescaled, space, prefix.c_str(), suffix.c_str());
-					else if(fabs(round(value_rescaled*1000) - value_rescaled*1000) < 0.001 )
-						snprintf(tmp, sizeof(tmp), "%.3f%s%s%s", value_rescaled, space, prefix.c_str(), suffix.c_str());
-					else if(fabs(round(value_rescaled*10000) - value_rescaled*10000) < 0.001 )
-						snprintf(tmp, sizeof(tmp), "%.4f%s%s%s", value_rescaled, space, prefix.c_str(), suffix.c_str());
-					else
-						snprintf(tmp, sizeof(tmp), "%.5f%s%s%s", value_rescaled, space, prefix.c_str(), suffix.c_str());
+					int precision = 5;
+					double scale = 1;
+					for(int i=0; i<5; i++)
+					{
+						if(fabs(round(value_rescaled*scale) - value_rescaled*scale) < 0.001)
+						{
+							precision = i;
+							break;
+						}
+						scale *= 10;
+					}
+					body.AppendFloat(value_rescaled, precision, false, separator);
 				}
+
+				if(GetUnitFormat(m_type).spaceAfterNumber)
+					body.Append(' ');
+				body.Append(prefix);
+				body.Append(suffix);
 			}
 			break;
 	}
 
-	SetDefaultLocale();
-	return numprefix + string(tmp);
+	UnitTextBuffer out(buf, len);
+	out.Append(numprefix);
+	out.Append(tmp, body.size());
+	return out.size();
 }
 
 /**
@@ -688,18 +824,37 @@ string Unit::PrettyPrint(double value, int sigfigs, bool useDisplayLocale) const
 	@param useDisplayLocale		True if the string is formatted for display (user's locale)
 								False if the string is formatted for serialization ("C" locale regardless of user pref)
  */
-string Unit::PrettyPrintInt64(int64_t value, int /*sigfigs*/, bool useDisplayLocale) const
+string Unit::PrettyPrintInt64(int64_t value, int sigfigs, bool useDisplayLocale) const
 {
-	if(useDisplayLocale)
-		SetPrintingLocale();
+	char tmp[192];
+	size_t len = PrettyPrintInt64(tmp, sizeof(tmp), value, sigfigs, useDisplayLocale);
+	return string(tmp, len);
+}
+
+/**
+	@brief Prints a value with SI scaling factors into a caller supplied buffer, without allocating memory
+
+	The output is identical to the std::string version, truncated if it does not fit in the buffer.
+
+	@param buf					Output buffer (always null terminated if len is nonzero)
+	@param len					Size of the output buffer
+	@param value				The value
+	@param digits				Number of significant digits to display
+	@param useDisplayLocale		True if the string is formatted for display (user's locale)
+								False if the string is formatted for serialization ("C" locale regardless of user pref)
+
+	@return Number of characters written, not including the null terminator
+ */
+size_t Unit::PrettyPrintInt64(char* buf, size_t len, int64_t value, int /*sigfigs*/, bool useDisplayLocale) const
+{
+	char separator = useDisplayLocale ? m_decimalSeparator : '.';
 
 	//Figure out scaling, prefix, and suffix
 	double scaleFactor;
-	string prefix;
-	string numprefix;
-	string suffix;
-	GetSIScalingFactor(value, scaleFactor, prefix);
-	GetUnitSuffix(m_type, value, scaleFactor, prefix, numprefix, suffix);
+	const char* prefix;
+	const char* numprefix;
+	const char* suffix;
+	GetScaling(value, scaleFactor, prefix, numprefix, suffix);
 
 	//Apply the rescaling in the integer domain
 	int64_t mulFactor = scaleFactor;
@@ -711,22 +866,20 @@ string Unit::PrettyPrintInt64(int64_t value, int /*sigfigs*/, bool useDisplayLoc
 	else
 		value_rescaled = value / divFactor;
 
-	bool space_after_number = (m_type != Unit::UNIT_UI) && (m_type != Unit::UNIT_HEXNUM);
-
 	char tmp[128];
+	UnitTextBuffer body(tmp, sizeof(tmp));
 	switch(m_type)
 	{
 		case UNIT_LOG_BER:		//special formatting for BER since it's already logarithmic
-			snprintf(tmp, sizeof(tmp), "%.2e", pow(10, value_rescaled));
-			//snprintf(tmp, sizeof(tmp), "1e%.2f", value);
+			body.AppendFloat(pow(10, value_rescaled), 2, true, separator);
 			break;
 
 		case UNIT_RATIO_SCI:
-			snprintf(tmp, sizeof(tmp), "%.2e", (float)value_rescaled);
+			body.AppendFloat((float)value_rescaled, 2, true, separator);
 			break;
 
 		case UNIT_HEXNUM:
-			snprintf(tmp, sizeof(tmp), "%" PRIx64, value_rescaled);
+			body.AppendHex(value_rescaled);
 			break;
 
 		default:
@@ -754,14 +907,12 @@ string Unit::PrettyPrintInt64(int64_t value, int /*sigfigs*/, bool useDisplayLoc
 					value1 /= 10000;
 				}
 
-				//Use correct decimal separator for user's locale if needed
-				if(useDisplayLocale)
-					snprintf(tmp, sizeof(tmp), "%" PRId64 "%c%04" PRId64, value1, m_decimalSeparator, value2);
-				else
-					snprintf(tmp, sizeof(tmp), "%" PRId64 ".%04" PRId64, value1, value2);
+				body.AppendInt(value1);
+				body.Append(separator);
+				body.AppendInt(value2, 4);
 
 				//Trim zeroes at right
-				ssize_t n = strlen(tmp) - 1;
+				ssize_t n = body.size() - 1;
 				for(; n > 0; n--)
 				{
 					if(tmp[n] == '0')
@@ -777,10 +928,79 @@ string Unit::PrettyPrintInt64(int64_t value, int /*sigfigs*/, bool useDisplayLoc
 			break;
 	}
 
-	SetDefaultLocale();
-	return numprefix + string(tmp) + (space_after_number ? " " : "") + prefix + suffix;
+	UnitTextBuffer out(buf, len);
+	out.Append(numprefix);
+	out.Append(tmp);
+	if(GetUnitFormat(m_type).spaceAfterNumber)
+		out.Append(' ');
+	out.Append(prefix);
+	out.Append(suffix);
+	return out.size();
+}
+
+/**
+	@brief Pretty-prints an array of values in one call
+
+	The strings are packed back to back, each with a null terminator, into a single character buffer. Reusing the same
+	output vectors across calls avoids any per-value memory allocation.
+
+	@param values				Values to print
+	@param count				Number of values
+	@param text					Output buffer
+	@param offsets				Output offset of each value's string within text
+	@param digits				Number of significant digits to display
+	@param useDisplayLocale		True if the string is formatted for display (user's locale)
+								False if the string is formatted for serialization ("C" locale regardless of user pref)
+ */
+template<class T>
+static void PrettyPrintArrayImpl(
+	const Unit& unit,
+	const T* values,
+	size_t count,
+	vector<char>& text,
+	vector<size_t>& offsets,
+	int sigfigs,
+	bool useDisplayLocale)
+{
+	text.clear();
+	offsets.resize(count);
+
+	char tmp[192];
+	for(size_t i=0; i<count; i++)
+	{
+		size_t len = unit.PrettyPrint(tmp, sizeof(tmp), values[i], sigfigs, useDisplayLocale);
+		offsets[i] = text.size();
+		text.insert(text.end(), tmp, tmp + len + 1);
+	}
+}
+
+/**
+	@brief Pretty-prints an array of values in one call (see PrettyPrintArrayImpl)
+ */
+void Unit::PrettyPrintArray(
+	const float* values,
+	size_t count,
+	vector<char>& text,
+	vector<size_t>& offsets,
+	int sigfigs,
+	bool useDisplayLocale) const
+{
+	PrettyPrintArrayImpl(*this, values, count, text, offsets, sigfigs, useDisplayLocale);
 }
 
+/**
+	@brief Pretty-prints an array of values in one call (see PrettyPrintArrayImpl)
+ */
+void Unit::PrettyPrintArray(
+	const double* values,
+	size_t count,
+	vector<char>& text,
+	vector<size_t>& offsets,
+	int sigfigs,
+	bool useDisplayLocale) const
+{
+	PrettyPrintArrayImpl(*this, values, count, text, offsets, sigfigs, useDisplayLocale);
+}
 
 /**
 	@brief Prints a value with SI scaling factors and unnecessarily significant sub-pixel digits removed
@@ -804,12 +1024,11 @@ string Unit::PrettyPrintRange(double pixelMin, double pixelMax, double rangeMin,
 
 	//Figure out the scale factor to use. Use the full-scale range to select the factor even if we're small here
 	double scaleFactor;
-	string prefix;
-	string numprefix;
-	string suffix;
+	const char* prefix;
+	const char* numprefix;
+	const char* suffix;
 	double extremeValue = max(fabs(rangeMin), fabs(rangeMax));
-	GetSIScalingFactor(extremeValue, scaleFactor, prefix);
-	GetUnitSuffix(m_type, extremeValue, scaleFactor, prefix, numprefix, suffix);
+	GetScaling(extremeValue, scaleFactor, prefix, numprefix, suffix);
 
 	//Swap values if they're reversed
 	if(fabs(pixelMin) > fabs(pixelMax))
@@ -972,36 +1191,174 @@ string Unit::PrettyPrintRange(double pixelMin, double pixelMax, double rangeMin,
 	return out;
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Parsing
+
+/**
+	@brief Skips leading whitespace
+ */
+static size_t SkipWhitespace(string_view str, size_t i = 0)
+{
+	while( (i < str.size()) && isspace(static_cast<unsigned char>(str[i])) )
+		i++;
+	return i;
+}
+
+/**
+	@brief Parses a hex number the way sscanf("0x%x") does, saturating instead of overflowing
+
+	@return True if a number was found
+ */
+static bool ParseHex(string_view str, uint64_t& ret)
+{
+	//Literal "0x" prefix
+	if( (str.size() < 2) || (str[0] != '0') || (str[1] != 'x') )
+		return false;
+
+	//%x skips whitespace and accepts an optional sign and second 0x prefix
+	size_t i = SkipWhitespace(str, 2);
+	bool negative = false;
+	if( (i < str.size()) && ( (str[i] == '-') || (str[i] == '+') ) )
+	{
+		negative = (str[i] == '-');
+		i++;
+	}
+	if( (i + 2 < str.size()) && (str[i] == '0') && ( (str[i+1] == 'x') || (str[i+1] == 'X') ) &&
+		isxdigit(static_cast<unsigned char>(str[i+2])) )
+	{
+		i += 2;
+	}
+
+	uint64_t value;
+	auto res = from_chars(str.data() + i, str.data() + str.size(), value, 16);
+	if(res.ec == errc::invalid_argument)
+		return false;
+	if(res.ec == errc::result_out_of_range)
+		value = UINT64_MAX;
+
+	ret = negative ? (0 - value) : value;
+	return true;
+}
+
+/**
+	@brief Parses a floating point number the way sscanf("%20lf") does
+
+	@param str			String to parse
+	@param separator	Decimal separator to accept
+	@param ret			Parsed value
+
+	@return True if a number was found
+ */
+static bool ParseDouble(string_view str, char separator, double& ret)
+{
+	//Skip whitespace, then consider at most 20 characters
+	size_t start = SkipWhitespace(str);
+	str = str.substr(start, 20);
+
+	//Copy to a null terminated buffer, converting the decimal separator to '.' if needed
+	char tmp[24];
+	size_t len = 0;
+	for(char c : str)
+	{
+		if(separator != '.')
+		{
+			if(c == '.')
+				break;
+			if(c == separator)
+				c = '.';
+		}
+		tmp[len++] = c;
+	}
+	tmp[len] = '\0';
+
+	//from_chars doesn't accept a leading '+'
+	const char* p = tmp;
+	const char* end = tmp + len;
+	bool negative = false;
+	if( (p < end) && ( (*p == '+') || (*p == '-') ) )
+	{
+		negative = (*p == '-');
+		p++;
+	}
+
+	//Hex floats
+	auto format = chars_format::general;
+	if( (end - p >= 2) && (p[0] == '0') && ( (p[1] == 'x') || (p[1] == 'X') ) )
+	{
+		format = chars_format::hex;
+		p += 2;
+	}
+
+	//Reject anything from_chars would take that strtod wouldn't (a second sign)
+	if( (p < end) && ( (*p == '+') || (*p == '-') ) )
+		return false;
+
+	double value = 0;
+	#ifdef __cpp_lib_to_chars
+		auto res = from_chars(p, end, value, format);
+		bool ok = (res.ec == errc());
+		bool fallback = (res.ec == errc::result_out_of_range);
+	#else
+		bool ok = false;
+		bool fallback = true;
+	#endif
+
+	//Let the C library deal with overflow, underflow, and platforms without floating point from_chars
+	if(fallback)
+	{
+		char* pend;
+		value = strtod(tmp, &pend);
+		if(pend == tmp)
+			return false;
+		ret = value;
+		return true;
+	}
+
+	if(!ok)
+	{
+		//"0x" with no digits after it is just zero
+		if(format == chars_format::hex)
+			value = 0;
+		else
+			return false;
+	}
+
+	ret = negative ? -value : value;
+	return true;
+}
+
 /**
 	@brief Parses a string based on the supplied unit
 
+	Does not allocate memory.
+
 	@param str					The string to parse
 	@param useDisplayLocale		True if the string is formatted for display (user's locale)
 								False if the string is formatted for serialization ("C" locale regardless of user pref)
  */
-double Unit::ParseString(const string& str, bool useDisplayLocale)
+double Unit::ParseString(string_view str, bool useDisplayLocale)
 {
-	if(useDisplayLocale)
-		SetPrintingLocale();
-
-	double ret;
+	double ret = 0;
 
 	if(m_type == UNIT_HEXNUM)
 	{
-		unsigned int temp = 0;
-		sscanf(str.c_str(), "0x%x", &temp);
-		ret = temp;
+		uint64_t temp = 0;
+		ParseHex(str, temp);
+		ret = static_cast<unsigned int>(temp);
 	}
 
 	else
 	{
-		//Find the first non-numeric character in the strnig
+		//Find the first non-numeric character in the string
 		double scale = 1;
 		for(size_t i=0; i<str.size(); i++)
 		{
 			char c = str[i];
-			if(isspace(c) || isdigit(c) || (c == '.') || (c == ',') || (c == '-') )
+			if(isspace(static_cast<unsigned char>(c)) || isdigit(static_cast<unsigned char>(c)) ||
+				(c == '.') || (c == ',') || (c == '-') )
+			{
 				continue;
+			}
 
 			if(c == 'T')
 			{
@@ -1029,7 +1386,7 @@ double Unit::ParseString(const string& str, bool useDisplayLocale)
 			}
 			else if(c == 'm')
 				scale = 1e-3;
-			else if( (c == 'u') || (str.find("μ", i) == i) )
+			else if( (c == 'u') || (str.substr(i, 2) == "μ") )
 				scale = 1e-6;
 			else if(c == 'n')
 				scale = 1e-9;
@@ -1042,7 +1399,7 @@ double Unit::ParseString(const string& str, bool useDisplayLocale)
 		}
 
 		//Parse the base value
-		sscanf(str.c_str(), "%20lf", &ret);
+		ParseDouble(str, useDisplayLocale ? m_decimalSeparator : '.', ret);
 
 		//Apply a unit-specific scaling factor
 		switch(m_type)
@@ -1070,28 +1427,26 @@ double Unit::ParseString(const string& str, bool useDisplayLocale)
 		ret *= scale;
 	}
 
-	SetDefaultLocale();
 	return ret;
 }
 
 /**
 	@brief Parses a string based on the supplied unit
 
+	Does not allocate memory.
+
 	@param str					The string to parse
 	@param useDisplayLocale		True if the string is formatted for display (user's locale)
 								False if the string is formatted for serialization ("C" locale regardless of user pref)
  */
-int64_t Unit::ParseStringInt64(const string& str, bool useDisplayLocale)
+int64_t Unit::ParseStringInt64(string_view str, bool /*useDisplayLocale*/)
 {
-	if(useDisplayLocale)
-		SetPrintingLocale();
-
-	int64_t ret;
+	int64_t ret = 0;
 
 	if(m_type == UNIT_HEXNUM)
 	{
 		uint64_t temp = 0;
-		sscanf(str.c_str(), "0x%" SCNx64, &temp);
+		ParseHex(str, temp);
 		ret = temp;
 	}
 
@@ -1124,26 +1479,45 @@ int64_t Unit::ParseStringInt64(const string& str, bool useDisplayLocale)
 				break;
 		}
 
-
-		//Remove decimal separators  and find suffixes
-		string sbase;
+		//Skip decimal separators and find suffixes.
+		//The digits and minus signs form the base value, which is parsed as it goes by: an optional leading minus
+		//sign followed by digits, stopping at the first character which doesn't fit that pattern.
 		bool foundDecimal = false;
+		bool negative = false;
+		bool anyDigits = false;
+		bool baseDone = false;
+		bool overflow = false;
+		size_t nbase = 0;
+		uint64_t magnitude = 0;
 		for(size_t i=0; i<str.size(); i++)
 		{
 			char c = str[i];
 
-			if(isspace(c))
+			if(isspace(static_cast<unsigned char>(c)))
 				continue;
-			else if(isdigit(c))
+			else if(isdigit(static_cast<unsigned char>(c)))
 			{
-				sbase += c;
+				if(!baseDone)
+				{
+					uint64_t digit = c - '0';
+					if(magnitude > (UINT64_MAX - digit) / 10)
+						overflow = true;
+					else
+						magnitude = magnitude*10 + digit;
+					anyDigits = true;
+				}
+				nbase ++;
 				if(foundDecimal)
 					divscale *= 10;
 				continue;
 			}
 			else if(c == '-')
 			{
-				sbase += c;
+				if(nbase == 0)
+					negative = true;
+				else
+					baseDone = true;
+				nbase ++;
 				continue;
 			}
 			else if( (c == '.') || (c == ',') )
@@ -1181,7 +1555,7 @@ int64_t Unit::ParseStringInt64(const string& str, bool useDisplayLocale)
 			}
 			else if(c == 'm')
 				divscale *= 1e3;
-			else if( (c == 'u') || (str.find("μ", i) == i) )
+			else if( (c == 'u') || (str.substr(i, 2) == "μ") )
 				divscale = 1e6;
 			else if(c == 'n')
 				divscale *= 1e9;
@@ -1193,14 +1567,29 @@ int64_t Unit::ParseStringInt64(const string& str, bool useDisplayLocale)
 			break;
 		}
 
-		//Parse the base value
-		sscanf(sbase.c_str(), "%" SCNd64, &ret);
+		//Convert the base value, saturating on overflow
+		if(anyDigits)
+		{
+			if(negative)
+			{
+				if(overflow || (magnitude > static_cast<uint64_t>(INT64_MAX) + 1))
+					ret = INT64_MIN;
+				else
+					ret = 0 - magnitude;
+			}
+			else
+			{
+				if(overflow || (magnitude > static_cast<uint64_t>(INT64_MAX)))
+					ret = INT64_MAX;
+				else
+					ret = magnitude;
+			}
+		}
+
 		ret *= mulscale;
 		ret /= divscale;
 	}
 
-	SetDefaultLocale();
-
 	return ret;
 }
 
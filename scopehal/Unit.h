@@ -37,6 +37,8 @@
 #ifndef Unit_h
 #define Unit_h
 
+#include <string_view>
+
 #ifndef _WIN32
 #include <locale.h>
 
@@ -117,10 +119,28 @@ public:
 	std::string PrettyPrint(double value, int sigfigs = -1, bool useDisplayLocale = true) const;
 	std::string PrettyPrintInt64(int64_t value, int sigfigs = -1, bool useDisplayLocale = true) const;
 
+	size_t PrettyPrint(char* buf, size_t len, double value, int sigfigs = -1, bool useDisplayLocale = true) const;
+	size_t PrettyPrintInt64(char* buf, size_t len, int64_t value, int sigfigs = -1, bool useDisplayLocale = true) const;
+
+	void PrettyPrintArray(
+		const float* values,
+		size_t count,
+		std::vector<char>& text,
+		std::vector<size_t>& offsets,
+		int sigfigs = -1,
+		bool useDisplayLocale = true) const;
+	void PrettyPrintArray(
+		const double* values,
+		size_t count,
+		std::vector<char>& text,
+		std::vector<size_t>& offsets,
+		int sigfigs = -1,
+		bool useDisplayLocale = true) const;
+
 	std::string PrettyPrintRange(double pixelMin, double pixelMax, double rangeMin, double rangeMax) const;
 
-	double ParseString(const std::string& str, bool useDisplayLocale = true);
-	int64_t ParseStringInt64(const std::string& str, bool useDisplayLocale = true);
+	double ParseString(std::string_view str, bool useDisplayLocale = true);
+	int64_t ParseStringInt64(std::string_view str, bool useDisplayLocale = true);
 
 	UnitType GetType()
 	{ return m_type; }
@@ -144,8 +164,8 @@ public:
 protected:
 	UnitType m_type;
 
-	void GetSIScalingFactor(double num, double& scaleFactor, std::string& prefix) const;
-	void GetUnitSuffix(UnitType type, double num, double& scaleFactor, std::string& prefix, std::string& numprefix, std::string& suffix) const;
+	void GetScaling(double num, double& scaleFactor, const char*& prefix, const char*& numprefix, const char*& suffix)
+		const;
 
 #ifdef _WIN32
 	/**
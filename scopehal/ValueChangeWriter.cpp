@@ -0,0 +1,695 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Implementation of ValueChangeWriter
+ */
+#include "scopehal.h"
+#include "ValueChangeWriter.h"
+#include <charconv>
+#include <queue>
+
+#ifdef HAS_FST
+#include <fstapi.h>
+#endif
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+ValueChangeWriter::ValueChangeWriter()
+	: m_scopeName("export")
+	, m_version("libscopehal")
+	, m_fp(nullptr)
+	, m_bufferSize(4 * 1024 * 1024)
+	, m_writeError(false)
+	, m_fstContext(nullptr)
+	, m_timestepCount(0)
+	, m_valueChangeCount(0)
+{
+}
+
+ValueChangeWriter::~ValueChangeWriter()
+{
+	if(m_fp)
+		fclose(m_fp);
+
+#ifdef HAS_FST
+	if(m_fstContext)
+		fstWriterClose(m_fstContext);
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Signal list
+
+/**
+	@brief Checks if this build of the library can write a given file format
+ */
+bool ValueChangeWriter::IsFormatSupported(Format format)
+{
+	switch(format)
+	{
+		case FORMAT_VCD:
+			return true;
+
+		case FORMAT_FST:
+#ifdef HAS_FST
+			return true;
+#else
+			return false;
+#endif
+
+		default:
+			return false;
+	}
+}
+
+/**
+	@brief Adds a signal to the export list
+
+	@param stream	The stream to export. Must have time domain digital, digital bus, or analog data.
+	@param name		Name of the variable in the output file. If empty, the stream name is used.
+
+	@return True if the signal was added, false if the stream has no data or the data type can't be exported
+ */
+bool ValueChangeWriter::AddSignal(StreamDescriptor stream, const string& name)
+{
+	auto data = stream.GetData();
+	if(!data)
+	{
+		LogWarning("Stream %s has no data, not exporting\n", stream.GetName().c_str());
+		return false;
+	}
+	if(stream.GetXAxisUnits() != Unit(Unit::UNIT_FS))
+	{
+		LogWarning("Stream %s is not a time domain waveform, not exporting\n", stream.GetName().c_str());
+		return false;
+	}
+
+	Signal sig;
+	sig.m_name = SanitizeName(name.empty() ? stream.GetName() : name);
+	sig.m_id = MakeIdentifier(m_signals.size());
+	sig.m_width = 1;
+	sig.m_data = data;
+	sig.m_sparse = dynamic_cast<SparseWaveformBase*>(data);
+	sig.m_uniform = dynamic_cast<UniformWaveformBase*>(data);
+	sig.m_len = 0;
+	sig.m_bits = nullptr;
+	sig.m_vectors = nullptr;
+	sig.m_reals = nullptr;
+	sig.m_current = 0;
+	sig.m_next = 0;
+	sig.m_fstHandle = 0;
+
+	if(dynamic_cast<SparseDigitalWaveform*>(data) || dynamic_cast<UniformDigitalWaveform*>(data))
+		sig.m_type = SIGNAL_BIT;
+	else if(dynamic_cast<SparseAnalogWaveform*>(data) || dynamic_cast<UniformAnalogWaveform*>(data))
+	{
+		sig.m_type = SIGNAL_REAL;
+		sig.m_width = 64;
+	}
+	else if(auto bus = dynamic_cast<SparseDigitalBusWaveform*>(data))
+	{
+		//Bus width is the widest sample we have
+		sig.m_type = SIGNAL_VECTOR;
+		bus->PrepareForCpuAccess();
+		for(auto& s : bus->m_samples)
+			sig.m_width = max(sig.m_width, s.size());
+	}
+	else
+	{
+		LogWarning("Stream %s has unsupported data type, not exporting\n", stream.GetName().c_str());
+		return false;
+	}
+
+	m_signals.push_back(sig);
+	return true;
+}
+
+/**
+	@brief Removes all signals from the export list
+ */
+void ValueChangeWriter::Clear()
+{
+	m_signals.clear();
+}
+
+/**
+	@brief Converts a stream name to a legal VCD identifier
+ */
+string ValueChangeWriter::SanitizeName(const string& name)
+{
+	string ret = name;
+	for(auto& c : ret)
+	{
+		if(!isalnum(c))
+			c = '_';
+	}
+	if(ret.empty())
+		ret = "_";
+	return ret;
+}
+
+/**
+	@brief Generates the short VCD identifier code for a signal
+
+	Identifiers are base-94 numbers using the printable ASCII characters '!' through '~'.
+ */
+string ValueChangeWriter::MakeIdentifier(size_t index)
+{
+	string id;
+	do
+	{
+		id = string(1, (char)('!' + (index % 94))) + id;
+		index /= 94;
+	} while(index != 0);
+
+	return id;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Sample access
+
+/**
+	@brief Checks if two samples of a signal have the same value
+ */
+bool ValueChangeWriter::IsSameValue(const Signal& sig, size_t a, size_t b) const
+{
+	switch(sig.m_type)
+	{
+		case SIGNAL_BIT:
+			return sig.m_bits[a] == sig.m_bits[b];
+
+		case SIGNAL_VECTOR:
+			return sig.m_vectors[a] == sig.m_vectors[b];
+
+		case SIGNAL_REAL:
+		default:
+			return sig.m_reals[a] == sig.m_reals[b];
+	}
+}
+
+/**
+	@brief Finds the next sample after i whose value differs from sample i
+
+	@return Index of the changed sample, or the waveform length if the value never changes again
+ */
+size_t ValueChangeWriter::FindNextChange(const Signal& sig, size_t i) const
+{
+	size_t j = i + 1;
+	while( (j < sig.m_len) && IsSameValue(sig, i, j) )
+		j++;
+	return j;
+}
+
+/**
+	@brief Formats a bit or vector sample as a full width, MSB-first string of '0' and '1' characters
+ */
+string ValueChangeWriter::FormatBits(const Signal& sig, size_t i) const
+{
+	if(sig.m_type == SIGNAL_BIT)
+		return sig.m_bits[i] ? "1" : "0";
+
+	auto& sample = sig.m_vectors[i];
+	string ret(sig.m_width, '0');
+	for(size_t b=0; b<sample.size(); b++)
+	{
+		if(sample[b])
+			ret[sig.m_width - 1 - b] = '1';
+	}
+	return ret;
+}
+
+/**
+	@brief Gets the value of a real sample
+ */
+double ValueChangeWriter::GetRealValue(const Signal& sig, size_t i) const
+{
+	return sig.m_reals[i];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Top level export
+
+/**
+	@brief Writes all signals to a file
+
+	@param path		Path of the output file
+	@param format	File format to write
+
+	@return True on success, false on failure
+ */
+bool ValueChangeWriter::Write(const string& path, Format format)
+{
+	m_timestepCount = 0;
+	m_valueChangeCount = 0;
+
+	if(!IsFormatSupported(format))
+	{
+		LogError("ValueChangeWriter: requested file format is not supported by this build\n");
+		return false;
+	}
+
+	//Get CPU side pointers to all of the sample data
+	for(auto& sig : m_signals)
+	{
+		sig.m_data->PrepareForCpuAccess();
+		sig.m_len = sig.m_data->size();
+		sig.m_current = 0;
+		sig.m_next = 0;
+
+		if(auto sd = dynamic_cast<SparseDigitalWaveform*>(sig.m_data))
+			sig.m_bits = sd->m_samples.GetCpuPointer();
+		else if(auto ud = dynamic_cast<UniformDigitalWaveform*>(sig.m_data))
+			sig.m_bits = ud->m_samples.GetCpuPointer();
+		else if(auto sa = dynamic_cast<SparseAnalogWaveform*>(sig.m_data))
+			sig.m_reals = sa->m_samples.GetCpuPointer();
+		else if(auto ua = dynamic_cast<UniformAnalogWaveform*>(sig.m_data))
+			sig.m_reals = ua->m_samples.GetCpuPointer();
+		else if(auto sb = dynamic_cast<SparseDigitalBusWaveform*>(sig.m_data))
+			sig.m_vectors = sb->m_samples.GetCpuPointer();
+	}
+
+	//Find the start of the earliest signal, and shift everything so we never write negative times
+	int64_t tstart = INT64_MAX;
+	for(auto& sig : m_signals)
+	{
+		if(sig.m_len)
+			tstart = min(tstart, GetOffsetScaled(sig.m_sparse, sig.m_uniform, 0));
+	}
+	if(tstart == INT64_MAX)
+		tstart = 0;
+	int64_t shift = (tstart < 0) ? -tstart : 0;
+
+	//Write the header
+	bool ok;
+	if(format == FORMAT_VCD)
+		ok = BeginVCD(path);
+#ifdef HAS_FST
+	else
+		ok = BeginFST(path);
+#else
+	else
+		ok = false;
+#endif
+	if(!ok)
+		return false;
+
+	//Merged edge list: min-heap of (next change time, signal index)
+	typedef pair<int64_t, size_t> event;
+	priority_queue<event, vector<event>, greater<event> > events;
+
+	//Initial values at the start time. Signals starting later are unknown until their first sample.
+	if(format == FORMAT_VCD)
+	{
+		EmitVCDTime(tstart + shift);
+		Append("$dumpvars\n");
+	}
+#ifdef HAS_FST
+	else
+		fstWriterEmitTimeChange(m_fstContext, tstart + shift);
+#endif
+	m_timestepCount ++;
+
+	for(size_t i=0; i<m_signals.size(); i++)
+	{
+		auto& sig = m_signals[i];
+
+		if( (sig.m_len == 0) || (GetOffsetScaled(sig.m_sparse, sig.m_uniform, 0) != tstart) )
+		{
+			if(format == FORMAT_VCD)
+				EmitVCDUnknown(sig);
+#ifdef HAS_FST
+			else
+				EmitFSTUnknown(sig);
+#endif
+			if(sig.m_len)
+				events.push(event(GetOffsetScaled(sig.m_sparse, sig.m_uniform, 0), i));
+			continue;
+		}
+
+		if(format == FORMAT_VCD)
+			EmitVCDValue(sig, 0);
+#ifdef HAS_FST
+		else
+			EmitFSTValue(sig, 0);
+#endif
+
+		sig.m_next = FindNextChange(sig, 0);
+		if(sig.m_next < sig.m_len)
+			events.push(event(GetOffsetScaled(sig.m_sparse, sig.m_uniform, sig.m_next), i));
+	}
+
+	if(format == FORMAT_VCD)
+		Append("$end\n");
+
+	//Main loop: pop every signal changing at the earliest pending time, emit it, and schedule its next change
+	int64_t tlast = tstart;
+	while(!events.empty())
+	{
+		int64_t t = events.top().first;
+
+		if(format == FORMAT_VCD)
+			EmitVCDTime(t + shift);
+#ifdef HAS_FST
+		else
+			fstWriterEmitTimeChange(m_fstContext, t + shift);
+#endif
+		m_timestepCount ++;
+		tlast = t;
+
+		while(!events.empty() && (events.top().first == t) )
+		{
+			size_t i = events.top().second;
+			auto& sig = m_signals[i];
+			events.pop();
+
+			sig.m_current = sig.m_next;
+			if(format == FORMAT_VCD)
+				EmitVCDValue(sig, sig.m_current);
+#ifdef HAS_FST
+			else
+				EmitFSTValue(sig, sig.m_current);
+#endif
+
+			sig.m_next = FindNextChange(sig, sig.m_current);
+			if(sig.m_next < sig.m_len)
+				events.push(event(GetOffsetScaled(sig.m_sparse, sig.m_uniform, sig.m_next), i));
+		}
+	}
+
+	//Final timestamp at the end of the longest signal, so viewers show the full capture
+	int64_t tend = tlast;
+	for(auto& sig : m_signals)
+	{
+		if(sig.m_len)
+		{
+			size_t last = sig.m_len - 1;
+			tend = max(tend,
+				GetOffsetScaled(sig.m_sparse, sig.m_uniform, last) + GetDurationScaled(sig.m_sparse, sig.m_uniform, last));
+		}
+	}
+	if(tend > tlast)
+	{
+		if(format == FORMAT_VCD)
+			EmitVCDTime(tend + shift);
+#ifdef HAS_FST
+		else
+			fstWriterEmitTimeChange(m_fstContext, tend + shift);
+#endif
+		m_timestepCount ++;
+	}
+
+	if(format == FORMAT_VCD)
+		return EndVCD();
+
+#ifdef HAS_FST
+	fstWriterClose(m_fstContext);
+	m_fstContext = nullptr;
+#endif
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// VCD output
+
+/**
+	@brief Opens a VCD file and writes the header and variable definitions
+ */
+bool ValueChangeWriter::BeginVCD(const string& path)
+{
+	m_fp = fopen(path.c_str(), "wb");
+	if(!m_fp)
+	{
+		LogError("Failed to open output file %s\n", path.c_str());
+		return false;
+	}
+	m_writeError = false;
+	m_buffer.clear();
+	m_buffer.reserve(m_bufferSize);
+
+	//Same date format as asctime(), which is what VCDImportFilter expects
+	auto tnow = time(nullptr);
+	auto local = localtime(&tnow);
+	char timebuf[128] = {0};
+	strftime(timebuf, sizeof(timebuf), "%a %b %d %H:%M:%S %Y", local);
+
+	Append("$date\n\t");
+	Append(timebuf);
+	Append("\n$end\n");
+	Append("$version\n\t");
+	Append(m_version);
+	Append("\n$end\n");
+	Append("$timescale\n\t1fs\n$end\n");
+
+	Append("$scope module ");
+	Append(SanitizeName(m_scopeName));
+	Append(" $end\n");
+	for(auto& sig : m_signals)
+	{
+		if(sig.m_type == SIGNAL_REAL)
+			Append("\t$var real ");
+		else
+			Append("\t$var wire ");
+		AppendInt(sig.m_width);
+		Append(' ');
+		Append(sig.m_id);
+		Append(' ');
+		Append(sig.m_name);
+		Append(" $end\n");
+	}
+	Append("$upscope $end\n");
+	Append("$enddefinitions $end\n");
+
+	return true;
+}
+
+/**
+	@brief Writes a timestamp
+ */
+void ValueChangeWriter::EmitVCDTime(int64_t t)
+{
+	Append('#');
+	AppendInt(t);
+	Append('\n');
+}
+
+/**
+	@brief Writes the value of one sample of a signal
+ */
+void ValueChangeWriter::EmitVCDValue(const Signal& sig, size_t i)
+{
+	switch(sig.m_type)
+	{
+		case SIGNAL_BIT:
+			Append(sig.m_bits[i] ? '1' : '0');
+			break;
+
+		case SIGNAL_VECTOR:
+			{
+				//Leading zeroes are implied in VCD, so skip them (but always write at least one bit)
+				auto bits = FormatBits(sig, i);
+				size_t first = bits.find('1');
+				if(first == string::npos)
+					first = bits.length() - 1;
+				Append('b');
+				Append(bits.c_str() + first, bits.length() - first);
+				Append(' ');
+			}
+			break;
+
+		case SIGNAL_REAL:
+			{
+				char tmp[32];
+				int len = snprintf(tmp, sizeof(tmp), "r%.9g ", GetRealValue(sig, i));
+				Append(tmp, len);
+			}
+			break;
+	}
+
+	Append(sig.m_id);
+	Append('\n');
+	m_valueChangeCount ++;
+}
+
+/**
+	@brief Writes an unknown value for a signal which has no data at the current time
+ */
+void ValueChangeWriter::EmitVCDUnknown(const Signal& sig)
+{
+	switch(sig.m_type)
+	{
+		case SIGNAL_BIT:
+			Append('x');
+			break;
+
+		case SIGNAL_VECTOR:
+			Append("bx ");
+			break;
+
+		//VCD has no unknown value for reals, use NaN
+		case SIGNAL_REAL:
+			Append("rnan ");
+			break;
+	}
+
+	Append(sig.m_id);
+	Append('\n');
+	m_valueChangeCount ++;
+}
+
+/**
+	@brief Flushes remaining output and closes the VCD file
+ */
+bool ValueChangeWriter::EndVCD()
+{
+	Flush();
+	if(0 != fclose(m_fp))
+		m_writeError = true;
+	m_fp = nullptr;
+
+	if(m_writeError)
+	{
+		LogError("ValueChangeWriter: failed to write output file\n");
+		return false;
+	}
+	return true;
+}
+
+/**
+	@brief Appends raw bytes to the output buffer, flushing to disk if it's full
+ */
+void ValueChangeWriter::Append(const char* p, size_t len)
+{
+	if(m_buffer.size() + len > m_bufferSize)
+		Flush();
+	m_buffer.insert(m_buffer.end(), p, p + len);
+}
+
+/**
+	@brief Appends a decimal integer to the output buffer
+ */
+void ValueChangeWriter::AppendInt(int64_t value)
+{
+	char tmp[24];
+	auto res = to_chars(tmp, tmp + sizeof(tmp), value);
+	Append(tmp, res.ptr - tmp);
+}
+
+/**
+	@brief Writes all buffered output to the file
+ */
+void ValueChangeWriter::Flush()
+{
+	if(m_buffer.empty() || !m_fp)
+		return;
+
+	if(m_buffer.size() != fwrite(&m_buffer[0], 1, m_buffer.size(), m_fp))
+		m_writeError = true;
+	m_buffer.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// FST output
+
+#ifdef HAS_FST
+
+/**
+	@brief Creates an FST file and writes the variable definitions
+ */
+bool ValueChangeWriter::BeginFST(const string& path)
+{
+	m_fstContext = fstWriterCreate(path.c_str(), 1);
+	if(!m_fstContext)
+	{
+		LogError("Failed to open output file %s\n", path.c_str());
+		return false;
+	}
+
+	auto tnow = time(nullptr);
+	auto local = localtime(&tnow);
+	char timebuf[128] = {0};
+	strftime(timebuf, sizeof(timebuf), "%a %b %d %H:%M:%S %Y", local);
+
+	fstWriterSetDate(m_fstContext, timebuf);
+	fstWriterSetVersion(m_fstContext, m_version.c_str());
+	fstWriterSetTimescale(m_fstContext, -15);
+
+	fstWriterSetScope(m_fstContext, FST_ST_VCD_MODULE, SanitizeName(m_scopeName).c_str(), nullptr);
+	for(auto& sig : m_signals)
+	{
+		sig.m_fstHandle = fstWriterCreateVar(
+			m_fstContext,
+			(sig.m_type == SIGNAL_REAL) ? FST_VT_VCD_REAL : FST_VT_VCD_WIRE,
+			FST_VD_IMPLICIT,
+			sig.m_width,
+			sig.m_name.c_str(),
+			0);
+	}
+	fstWriterSetUpscope(m_fstContext);
+
+	return true;
+}
+
+/**
+	@brief Writes the value of one sample of a signal
+ */
+void ValueChangeWriter::EmitFSTValue(const Signal& sig, size_t i)
+{
+	if(sig.m_type == SIGNAL_REAL)
+	{
+		double v = GetRealValue(sig, i);
+		fstWriterEmitValueChange(m_fstContext, sig.m_fstHandle, &v);
+	}
+	else
+		fstWriterEmitValueChange(m_fstContext, sig.m_fstHandle, FormatBits(sig, i).c_str());
+
+	m_valueChangeCount ++;
+}
+
+/**
+	@brief Writes an unknown value for a signal which has no data at the current time
+ */
+void ValueChangeWriter::EmitFSTUnknown(const Signal& sig)
+{
+	if(sig.m_type == SIGNAL_REAL)
+	{
+		double v = NAN;
+		fstWriterEmitValueChange(m_fstContext, sig.m_fstHandle, &v);
+	}
+	else
+		fstWriterEmitValueChange(m_fstContext, sig.m_fstHandle, string(sig.m_width, 'x').c_str());
+
+	m_valueChangeCount ++;
+}
+
+#endif
@@ -0,0 +1,229 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Declaration of ValueChangeWriter
+ */
+
+#ifndef ValueChangeWriter_h
+#define ValueChangeWriter_h
+
+#include <algorithm>
+
+/**
+	@brief Headless exporter for Value Change Dump (VCD) and, if available, FST waveform files
+
+	Signals are added with AddSignal() and written with Write(). Only values which actually change are emitted: each
+	signal is scanned once to find its next change, and a min-heap of per-signal next-change times produces the merged
+	edge list, so the cost is proportional to the number of changes rather than (number of timesteps * signals).
+
+	Supported signal types:
+	* Digital (sparse or uniform): VCD "wire 1"
+	* Digital bus (sparse): VCD "wire N" vector
+	* Analog (sparse or uniform): VCD "real 64"
+
+	All times are written in femtoseconds. If any signal starts before t=0, all times are shifted so the earliest
+	sample is at t=0.
+
+	FST output requires libfst (fstapi.h) at build time and is compiled in only if HAS_FST is defined.
+ */
+class ValueChangeWriter
+{
+public:
+	ValueChangeWriter();
+	virtual ~ValueChangeWriter();
+
+	///@brief Output file formats
+	enum Format
+	{
+		///@brief Plain text Value Change Dump (IEEE 1364)
+		FORMAT_VCD,
+
+		///@brief GTKWave compressed, seekable Fast Signal Trace
+		FORMAT_FST
+	};
+
+	static bool IsFormatSupported(Format format);
+
+	bool AddSignal(StreamDescriptor stream, const std::string& name = "");
+	void Clear();
+
+	///@brief Returns the number of signals which will be exported
+	size_t GetSignalCount() const
+	{ return m_signals.size(); }
+
+	///@brief Sets the name of the top level module the signals are placed in
+	void SetScopeName(const std::string& name)
+	{ m_scopeName = name; }
+
+	///@brief Sets the tool name written to the $version block
+	void SetVersionString(const std::string& version)
+	{ m_version = version; }
+
+	///@brief Sets the size of the VCD output buffer, in bytes
+	void SetBufferSize(size_t bytes)
+	{ m_bufferSize = std::max(bytes, (size_t)4096); }
+
+	bool Write(const std::string& path, Format format = FORMAT_VCD);
+
+	///@brief Returns the number of distinct timestamps written by the last Write() call
+	size_t GetTimestepCount() const
+	{ return m_timestepCount; }
+
+	///@brief Returns the number of value changes (including initial values) written by the last Write() call
+	size_t GetValueChangeCount() const
+	{ return m_valueChangeCount; }
+
+protected:
+
+	///@brief Type of a single exported variable
+	enum SignalType
+	{
+		SIGNAL_BIT,
+		SIGNAL_VECTOR,
+		SIGNAL_REAL
+	};
+
+	///@brief State for a single exported variable
+	class Signal
+	{
+	public:
+		///@brief Name of the variable in the output file
+		std::string m_name;
+
+		///@brief VCD identifier code
+		std::string m_id;
+
+		///@brief Type of the variable
+		SignalType m_type;
+
+		///@brief Width of the variable, in bits
+		size_t m_width;
+
+		///@brief The waveform being exported
+		WaveformBase* m_data;
+
+		///@brief m_data if it's sparse, otherwise null
+		SparseWaveformBase* m_sparse;
+
+		///@brief m_data if it's uniform, otherwise null
+		UniformWaveformBase* m_uniform;
+
+		///@brief Number of samples in m_data
+		size_t m_len;
+
+		///@brief Sample data for SIGNAL_BIT variables
+		const bool* m_bits;
+
+		///@brief Sample data for SIGNAL_VECTOR variables
+		const std::vector<bool>* m_vectors;
+
+		///@brief Sample data for SIGNAL_REAL variables
+		const float* m_reals;
+
+		///@brief Index of the sample most recently written
+		size_t m_current;
+
+		///@brief Index of the next sample with a different value, or m_len if none
+		size_t m_next;
+
+		///@brief Handle of the variable in the FST file
+		uint32_t m_fstHandle;
+	};
+
+	static std::string SanitizeName(const std::string& name);
+	static std::string MakeIdentifier(size_t index);
+
+	bool IsSameValue(const Signal& sig, size_t a, size_t b) const;
+	size_t FindNextChange(const Signal& sig, size_t i) const;
+	std::string FormatBits(const Signal& sig, size_t i) const;
+	double GetRealValue(const Signal& sig, size_t i) const;
+
+	bool BeginVCD(const std::string& path);
+	void EmitVCDTime(int64_t t);
+	void EmitVCDValue(const Signal& sig, size_t i);
+	void EmitVCDUnknown(const Signal& sig);
+	bool EndVCD();
+
+	void Append(const char* p, size_t len);
+
+	///@brief Appends a string to the output buffer
+	void Append(const std::string& s)
+	{ Append(s.c_str(), s.length()); }
+
+	///@brief Appends a single character to the output buffer
+	void Append(char c)
+	{
+		if(m_buffer.size() >= m_bufferSize)
+			Flush();
+		m_buffer.push_back(c);
+	}
+
+	void AppendInt(int64_t value);
+	void Flush();
+
+#ifdef HAS_FST
+	bool BeginFST(const std::string& path);
+	void EmitFSTValue(const Signal& sig, size_t i);
+	void EmitFSTUnknown(const Signal& sig);
+#endif
+
+	///@brief The signals being exported
+	std::vector<Signal> m_signals;
+
+	///@brief Name of the top level module
+	std::string m_scopeName;
+
+	///@brief Tool name for the $version block
+	std::string m_version;
+
+	///@brief Output file handle (VCD mode)
+	FILE* m_fp;
+
+	///@brief Pending output data not yet written to m_fp
+	std::vector<char> m_buffer;
+
+	///@brief Size at which m_buffer is flushed
+	size_t m_bufferSize;
+
+	///@brief True if a write to m_fp failed
+	bool m_writeError;
+
+	///@brief FST writer context (FST mode)
+	void* m_fstContext;
+
+	///@brief Number of timestamps written
+	size_t m_timestepCount;
+
+	///@brief Number of value changes written
+	size_t m_valueChangeCount;
+};
+
+#endif
@@ -40,6 +40,8 @@
 
 using namespace std;
 
+atomic<uint64_t> WaveformBase::m_nextInstanceID(1);
+
 template<class T>
 size_t BinarySearchForGequal(T* buf, size_t len, T value)
 {
@@ -322,7 +324,82 @@ void WaveformBase::CacheColors()
 	m_protocolColors.PrepareForCpuAccess();
 
 	for(size_t i=0; i<s; i++)
-		m_protocolColors[i] = ColorFromString(GetColor(i), 0xff);
+		m_protocolColors[i] = ProtocolPalette::GetPacked(GetColorIndex(i));
 
 	m_protocolColors.MarkModifiedFromCpu();
 }
+
+/**
+	@brief Generates text for protocol samples [first, last), typically the ones in the visible window
+
+	Only the requested window is kept. Samples carried over from the previous window are not regenerated unless the
+	waveform has changed, so scrolling only formats the newly exposed samples.
+
+	@param first	Index of the first sample to cache
+	@param last		Index one past the last sample to cache
+ */
+void WaveformBase::CacheText(size_t first, size_t last)
+{
+	last = min(last, size());
+	if(first >= last)
+	{
+		m_cachedText.clear();
+		m_cachedTextStart = 0;
+		return;
+	}
+	size_t count = last - first;
+
+	//Figure out how much of the old window is still valid
+	size_t keepStart = 0;
+	size_t keepEnd = 0;
+	if(m_cachedTextRevision == m_revision)
+	{
+		keepStart = max(first, m_cachedTextStart);
+		keepEnd = min(last, m_cachedTextStart + m_cachedText.size());
+	}
+
+	//Slide the surviving entries into place. Rotating moves strings around rather than copying them,
+	//so every slot keeps its allocated capacity for reuse.
+	if(keepStart < keepEnd)
+	{
+		size_t from = keepStart - m_cachedTextStart;
+		size_t to = keepStart - first;
+		if(from > to)
+			rotate(m_cachedText.begin(), m_cachedText.begin() + (from - to), m_cachedText.end());
+		else if(to > from)
+		{
+			m_cachedText.resize(max(m_cachedText.size(), count));
+			rotate(m_cachedText.begin(), m_cachedText.end() - (to - from), m_cachedText.end());
+		}
+	}
+	else
+	{
+		keepStart = first;
+		keepEnd = first;
+	}
+	m_cachedText.resize(count);
+	m_cachedTextStart = first;
+	m_cachedTextRevision = m_revision;
+
+	//Format everything that's newly exposed
+	for(size_t i=first; i<keepStart; i++)
+		FormatText(i, m_cachedText[i - first]);
+	for(size_t i=keepEnd; i<last; i++)
+		FormatText(i, m_cachedText[i - first]);
+}
+
+/**
+	@brief Returns the text of a protocol sample, from the CacheText() window if possible
+
+	Samples outside the window are formatted on the fly. The returned reference is only valid until the next call.
+
+	@param i	Sample index
+ */
+const string& WaveformBase::GetTextCached(size_t i)
+{
+	if( (m_cachedTextRevision == m_revision) && (i >= m_cachedTextStart) && (i - m_cachedTextStart < m_cachedText.size()) )
+		return m_cachedText[i - m_cachedTextStart];
+
+	FormatText(i, m_textScratch);
+	return m_textScratch;
+}
@@ -39,9 +39,11 @@
 
 #include <vector>
 #include <optional>
+#include <atomic>
 #include <AlignedAllocator.h>
 
 #include "StandardColors.h"
+#include "ProtocolText.h"
 #include "AcceleratorBuffer.h"
 
 /**
@@ -69,7 +71,10 @@ public:
 		, m_triggerPhase(0)
 		, m_flags(0)
 		, m_revision(0)
+		, m_instanceID(m_nextInstanceID ++)
 		, m_cachedColorRevision(0)
+		, m_cachedTextStart(0)
+		, m_cachedTextRevision(0)
 	{
 	}
 
@@ -83,6 +88,9 @@ public:
 		, m_triggerPhase(rhs.m_triggerPhase)
 		, m_flags(rhs.m_flags)
 		, m_revision(rhs.m_revision)
+		, m_instanceID(m_nextInstanceID ++)
+		, m_cachedTextStart(0)
+		, m_cachedTextRevision(0)
 	{}
 
 	//empty virtual destructor in case any derived classes need one
@@ -138,6 +146,14 @@ public:
 	 */
 	uint64_t m_revision;
 
+	/**
+		@brief Identifier unique to this waveform object, never reused for the lifetime of the process
+
+		Revision numbers start from zero in every new waveform, so pointer plus revision alone can't tell apart a
+		waveform from a later one allocated at the same address. WaveformCacheKey compares this as well.
+	 */
+	uint64_t m_instanceID;
+
 	///@brief Flags which may apply to m_flags
 	enum WaveformFlags_t
 	{
@@ -194,6 +210,33 @@ public:
 		return StandardColors::colors[StandardColors::COLOR_ERROR];
 	}
 
+	/**
+		@brief Writes the text representation of a given protocol sample into a caller-supplied string.
+
+		The default implementation calls GetText(). Waveforms with many samples should override this and build the
+		text in place, so the string's existing capacity is reused from one call to the next (see CacheText()).
+
+		Not used for non-protocol waveforms.
+
+		@param i	Sample index
+		@param out	String to overwrite with the sample's text
+	 */
+	virtual void FormatText(size_t i, std::string& out)
+	{ out = GetText(i); }
+
+	/**
+		@brief Returns the ProtocolPalette index of the displayed color of a given protocol sample.
+
+		The default implementation interns the result of GetColor(). Waveforms with many samples should override this
+		to return a precomputed index (e.g. from ProtocolPalette::GetStandardColor()) without touching any strings.
+
+		Not used for non-protocol waveforms.
+
+		@param i	Sample index
+	 */
+	virtual uint16_t GetColorIndex(size_t i)
+	{ return ProtocolPalette::Intern(GetColor(i)); }
+
 	/**
 		@brief Returns the packed RGBA32 color of a given protocol sample calculated by CacheColors()
 
@@ -240,19 +283,41 @@ public:
 
 	virtual void CacheColors();
 
+	void CacheText(size_t first, size_t last);
+	const std::string& GetTextCached(size_t i);
+
 	///@brief Free GPU-side memory if we are short on VRAM or do not anticipate using this waveform for a while
 	virtual void FreeGpuMemory() =0;
 
 	///@brief Returns true if we have at least one buffer resident on the GPU
 	virtual bool HasGpuBuffer() =0;
 
+	///@brief Returns the CPU-side memory allocated for sample (and timestamp) buffers, in bytes
+	virtual size_t GetCpuMemoryBytes() const
+	{ return 0; }
+
 protected:
 
+	///@brief Next value of m_instanceID to hand out
+	static std::atomic<uint64_t> m_nextInstanceID;
+
 	///@brief Cache of packed RGBA32 data with colors for each protocol decode event. Empty for non-protocol waveforms.
 	AcceleratorBuffer<uint32_t> m_protocolColors;
 
 	///@brief Revision we last cached colors of
 	uint64_t m_cachedColorRevision;
+
+	///@brief Text of samples m_cachedTextStart onwards, generated by CacheText()
+	std::vector<std::string> m_cachedText;
+
+	///@brief Index of the first sample in m_cachedText
+	size_t m_cachedTextStart;
+
+	///@brief Revision we last cached text of
+	uint64_t m_cachedTextRevision;
+
+	///@brief Scratch buffer for GetTextCached() requests outside the cached window
+	std::string m_textScratch;
 };
 
 template<class S> class SparseWaveform;
@@ -433,6 +498,9 @@ public:
 	virtual bool HasGpuBuffer() override
 	{ return m_samples.HasGpuBuffer(); }
 
+	virtual size_t GetCpuMemoryBytes() const override
+	{ return m_samples.GetCpuMemoryBytes(); }
+
 	virtual void Resize(size_t size) override
 	{ m_samples.resize(size); }
 
@@ -565,6 +633,9 @@ public:
 	virtual bool HasGpuBuffer() override
 	{ return m_samples.HasGpuBuffer() || m_offsets.HasGpuBuffer() || m_durations.HasGpuBuffer(); }
 
+	virtual size_t GetCpuMemoryBytes() const override
+	{ return m_samples.GetCpuMemoryBytes() + m_offsets.GetCpuMemoryBytes() + m_durations.GetCpuMemoryBytes(); }
+
 	virtual void Resize(size_t size) override
 	{
 		m_offsets.resize(size);
@@ -0,0 +1,514 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Implementation of WaveformSearch
+ */
+#include "scopehal.h"
+#include "WaveformSearch.h"
+#include <algorithm>
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+WaveformSearch::WaveformSearch()
+	: m_type(SEARCH_EDGE)
+	, m_edgeType(EDGE_RISING)
+	, m_level(0)
+	, m_lowerLevel(0)
+	, m_condition(Trigger::CONDITION_ANY)
+	, m_lowerInterval(0)
+	, m_upperInterval(0)
+	, m_configRevision(0)
+	, m_waveformsSearched(0)
+{
+}
+
+WaveformSearch::~WaveformSearch()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Cache management
+
+void WaveformSearch::InvalidateMarks()
+{
+	m_configRevision ++;
+}
+
+/**
+	@brief Discards all cached crossings and marks
+ */
+void WaveformSearch::ClearCache()
+{
+	lock_guard<mutex> lock(m_cacheMutex);
+	m_crossingCache.clear();
+	m_markCache.clear();
+	m_marks.clear();
+}
+
+/**
+	@brief Discards cached state for any waveform not present in the given history
+
+	The caches are keyed by instance ID, so stale entries are never returned for a different waveform, but they are
+	kept until pruned. Call this whenever waveforms are removed from the history to bound memory usage.
+ */
+void WaveformSearch::Prune(const vector<WaveformBase*>& history)
+{
+	set<uint64_t> live;
+	for(auto wfm : history)
+	{
+		if(wfm)
+			live.emplace(wfm->m_instanceID);
+	}
+
+	lock_guard<mutex> lock(m_cacheMutex);
+	for(auto it = m_crossingCache.begin(); it != m_crossingCache.end(); )
+	{
+		if(live.find(it->first.first) == live.end())
+			it = m_crossingCache.erase(it);
+		else
+			it ++;
+	}
+	for(auto it = m_markCache.begin(); it != m_markCache.end(); )
+	{
+		if(live.find(it->first) == live.end())
+			it = m_markCache.erase(it);
+		else
+			it ++;
+	}
+}
+
+/**
+	@brief Gets the level crossings of a waveform, computing them if they are not already cached
+ */
+const WaveformSearch::CrossingList& WaveformSearch::GetCrossings(WaveformBase* wfm, float threshold)
+{
+	pair<uint64_t, float> key(wfm->m_instanceID, threshold);
+
+	{
+		lock_guard<mutex> lock(m_cacheMutex);
+		auto it = m_crossingCache.find(key);
+		if( (it != m_crossingCache.end()) && (it->second.m_revision == wfm->m_revision) )
+			return it->second;
+	}
+
+	//Compute outside the lock so other waveforms can proceed in parallel
+	CrossingList list;
+	FindCrossings(wfm, threshold, list);
+
+	//std::map references stay valid across later insertions
+	lock_guard<mutex> lock(m_cacheMutex);
+	auto& entry = m_crossingCache[key];
+	entry = std::move(list);
+	return entry;
+}
+
+/**
+	@brief Finds all crossings of a threshold in an analog or digital waveform
+
+	Analog crossings are linearly interpolated between samples. Digital waveforms ignore the threshold.
+ */
+void WaveformSearch::FindCrossings(WaveformBase* wfm, float threshold, CrossingList& list)
+{
+	list.m_revision = wfm->m_revision;
+	list.m_initialHigh = false;
+	list.m_crossings.clear();
+
+	size_t len = wfm->size();
+	if(len == 0)
+		return;
+	wfm->PrepareForCpuAccess();
+
+	int64_t timescale = wfm->m_timescale;
+	int64_t phase = wfm->m_triggerPhase;
+
+	auto ua = dynamic_cast<UniformAnalogWaveform*>(wfm);
+	auto sa = dynamic_cast<SparseAnalogWaveform*>(wfm);
+	auto ud = dynamic_cast<UniformDigitalWaveform*>(wfm);
+	auto sd = dynamic_cast<SparseDigitalWaveform*>(wfm);
+
+	if(ua)
+	{
+		float* samples = ua->m_samples.GetCpuPointer();
+		bool last = samples[0] > threshold;
+		list.m_initialHigh = last;
+		for(size_t i=1; i<len; i++)
+		{
+			bool value = samples[i] > threshold;
+			if(value == last)
+				continue;
+
+			float frac = (threshold - samples[i-1]) / (samples[i] - samples[i-1]);
+			list.m_crossings.push_back(phase + (i-1)*timescale + static_cast<int64_t>(frac * timescale));
+			last = value;
+		}
+	}
+
+	else if(sa)
+	{
+		float* samples = sa->m_samples.GetCpuPointer();
+		int64_t* offsets = sa->m_offsets.GetCpuPointer();
+		bool last = samples[0] > threshold;
+		list.m_initialHigh = last;
+		for(size_t i=1; i<len; i++)
+		{
+			bool value = samples[i] > threshold;
+			if(value == last)
+				continue;
+
+			float frac = (threshold - samples[i-1]) / (samples[i] - samples[i-1]);
+			int64_t dt = (offsets[i] - offsets[i-1]) * timescale;
+			list.m_crossings.push_back(phase + offsets[i-1]*timescale + static_cast<int64_t>(frac * dt));
+			last = value;
+		}
+	}
+
+	else if(ud)
+	{
+		bool last = ud->m_samples[0];
+		list.m_initialHigh = last;
+		for(size_t i=1; i<len; i++)
+		{
+			bool value = ud->m_samples[i];
+			if(value == last)
+				continue;
+
+			list.m_crossings.push_back(phase + i*timescale);
+			last = value;
+		}
+	}
+
+	else if(sd)
+	{
+		bool last = sd->m_samples[0];
+		list.m_initialHigh = last;
+		for(size_t i=1; i<len; i++)
+		{
+			bool value = sd->m_samples[i];
+			if(value == last)
+				continue;
+
+			list.m_crossings.push_back(phase + sd->m_offsets[i]*timescale);
+			last = value;
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Searching
+
+/**
+	@brief Runs the current search over a set of waveforms
+
+	Waveforms are searched in parallel. Waveforms whose revision and the search configuration are unchanged since the
+	previous call reuse their cached marks.
+
+	@param history	Waveforms to search, typically oldest first. Null entries are skipped.
+
+	@return Total number of marks found
+ */
+size_t WaveformSearch::Search(const vector<WaveformBase*>& history)
+{
+	size_t n = history.size();
+	vector< vector<Mark> > results(n);
+
+	ThreadPool::GetDefault().ParallelFor(0, n, [&](size_t i)
+	{
+		auto wfm = history[i];
+		if(wfm == nullptr)
+			return;
+
+		//Reuse cached results if nothing has changed
+		{
+			lock_guard<mutex> lock(m_cacheMutex);
+			auto it = m_markCache.find(wfm->m_instanceID);
+			if( (it != m_markCache.end()) &&
+				(it->second.m_revision == wfm->m_revision) &&
+				(it->second.m_configRevision == m_configRevision) )
+			{
+				results[i] = it->second.m_marks;
+				for(auto& m : results[i])
+					m.m_waveform = i;
+				return;
+			}
+		}
+
+		switch(m_type)
+		{
+			case SEARCH_EDGE:
+				SearchEdges(wfm, i, results[i]);
+				break;
+
+			case SEARCH_PULSE_WIDTH:
+				SearchPulseWidth(wfm, i, results[i]);
+				break;
+
+			case SEARCH_RUNT:
+				SearchRunt(wfm, i, results[i]);
+				break;
+
+			case SEARCH_PROTOCOL:
+				SearchProtocol(wfm, i, results[i]);
+				break;
+		}
+
+		lock_guard<mutex> lock(m_cacheMutex);
+		auto& entry = m_markCache[wfm->m_instanceID];
+		entry.m_revision = wfm->m_revision;
+		entry.m_configRevision = m_configRevision;
+		entry.m_marks = results[i];
+	});
+
+	//Merge (each per-waveform list is already sorted by time)
+	size_t total = 0;
+	for(auto& r : results)
+		total += r.size();
+
+	m_marks.clear();
+	m_marks.reserve(total);
+	for(auto& r : results)
+		m_marks.insert(m_marks.end(), r.begin(), r.end());
+	m_waveformsSearched = n;
+
+	return total;
+}
+
+/**
+	@brief Checks a pulse width against the configured condition
+ */
+bool WaveformSearch::MatchWidth(int64_t width)
+{
+	switch(m_condition)
+	{
+		case Trigger::CONDITION_EQUAL:
+			return width == m_lowerInterval;
+
+		case Trigger::CONDITION_NOT_EQUAL:
+			return width != m_lowerInterval;
+
+		case Trigger::CONDITION_LESS:
+			return width < m_upperInterval;
+
+		case Trigger::CONDITION_LESS_OR_EQUAL:
+			return width <= m_upperInterval;
+
+		case Trigger::CONDITION_GREATER:
+			return width > m_lowerInterval;
+
+		case Trigger::CONDITION_GREATER_OR_EQUAL:
+			return width >= m_lowerInterval;
+
+		case Trigger::CONDITION_BETWEEN:
+			return (width >= m_lowerInterval) && (width <= m_upperInterval);
+
+		case Trigger::CONDITION_NOT_BETWEEN:
+			return (width < m_lowerInterval) || (width > m_upperInterval);
+
+		case Trigger::CONDITION_ANY:
+		default:
+			return true;
+	}
+}
+
+void WaveformSearch::SearchEdges(WaveformBase* wfm, size_t index, vector<Mark>& marks)
+{
+	auto& list = GetCrossings(wfm, m_level);
+
+	//Even-numbered crossings go away from the initial state
+	for(size_t i=0; i<list.m_crossings.size(); i++)
+	{
+		bool rising = list.m_initialHigh ? (i & 1) : !(i & 1);
+		if( (m_edgeType == EDGE_RISING) && !rising )
+			continue;
+		if( (m_edgeType == EDGE_FALLING) && rising )
+			continue;
+
+		marks.push_back(Mark{index, list.m_crossings[i], 0, 0});
+	}
+}
+
+void WaveformSearch::SearchPulseWidth(WaveformBase* wfm, size_t index, vector<Mark>& marks)
+{
+	auto& list = GetCrossings(wfm, m_level);
+
+	//A pulse runs from one crossing to the next
+	for(size_t i=0; i+1 < list.m_crossings.size(); i++)
+	{
+		bool positive = list.m_initialHigh ? (i & 1) : !(i & 1);
+		if( (m_edgeType == EDGE_RISING) && !positive )
+			continue;
+		if( (m_edgeType == EDGE_FALLING) && positive )
+			continue;
+
+		int64_t start = list.m_crossings[i];
+		int64_t width = list.m_crossings[i+1] - start;
+		if(MatchWidth(width))
+			marks.push_back(Mark{index, start, width, 0});
+	}
+}
+
+void WaveformSearch::SearchRunt(WaveformBase* wfm, size_t index, vector<Mark>& marks)
+{
+	auto& low = GetCrossings(wfm, m_lowerLevel);
+	auto& high = GetCrossings(wfm, m_level);
+
+	//Positive runts: rising then falling through the lower level with no upper crossing in between
+	if(m_edgeType != EDGE_FALLING)
+	{
+		for(size_t i=0; i+1 < low.m_crossings.size(); i++)
+		{
+			bool rising = low.m_initialHigh ? (i & 1) : !(i & 1);
+			if(!rising)
+				continue;
+
+			int64_t start = low.m_crossings[i];
+			int64_t end = low.m_crossings[i+1];
+			auto it = lower_bound(high.m_crossings.begin(), high.m_crossings.end(), start);
+			if( (it != high.m_crossings.end()) && (*it <= end) )
+				continue;
+
+			if(MatchWidth(end - start))
+				marks.push_back(Mark{index, start, end - start, 0});
+		}
+	}
+
+	//Negative runts: falling then rising through the upper level with no lower crossing in between
+	if(m_edgeType != EDGE_RISING)
+	{
+		for(size_t i=0; i+1 < high.m_crossings.size(); i++)
+		{
+			bool rising = high.m_initialHigh ? (i & 1) : !(i & 1);
+			if(rising)
+				continue;
+
+			int64_t start = high.m_crossings[i];
+			int64_t end = high.m_crossings[i+1];
+			auto it = lower_bound(low.m_crossings.begin(), low.m_crossings.end(), start);
+			if( (it != low.m_crossings.end()) && (*it <= end) )
+				continue;
+
+			if(MatchWidth(end - start))
+				marks.push_back(Mark{index, start, end - start, 0});
+		}
+
+		//Merge the two polarities back into time order
+		if(m_edgeType == EDGE_ANY)
+			sort(marks.begin(), marks.end());
+	}
+}
+
+void WaveformSearch::SearchProtocol(WaveformBase* wfm, size_t index, vector<Mark>& marks)
+{
+	auto swfm = dynamic_cast<SparseWaveformBase*>(wfm);
+	if(!swfm)
+		return;
+
+	swfm->PrepareForCpuAccess();
+	size_t len = swfm->size();
+	for(size_t i=0; i<len; i++)
+	{
+		if(swfm->GetText(i).find(m_pattern) == string::npos)
+			continue;
+
+		marks.push_back(Mark{
+			index,
+			swfm->m_offsets[i] * swfm->m_timescale + swfm->m_triggerPhase,
+			swfm->m_durations[i] * swfm->m_timescale,
+			i});
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Navigation and statistics
+
+/**
+	@brief Returns the first mark strictly after the given position, or null if there is none
+ */
+const WaveformSearch::Mark* WaveformSearch::GetNextMark(size_t waveform, int64_t time)
+{
+	Mark key{waveform, time, 0, 0};
+	auto it = upper_bound(m_marks.begin(), m_marks.end(), key);
+	if(it == m_marks.end())
+		return nullptr;
+	return &*it;
+}
+
+/**
+	@brief Returns the last mark strictly before the given position, or null if there is none
+ */
+const WaveformSearch::Mark* WaveformSearch::GetPrevMark(size_t waveform, int64_t time)
+{
+	Mark key{waveform, time, 0, 0};
+	auto it = lower_bound(m_marks.begin(), m_marks.end(), key);
+	if(it == m_marks.begin())
+		return nullptr;
+	it --;
+	return &*it;
+}
+
+/**
+	@brief Calculates summary statistics over the marks from the last search
+ */
+WaveformSearch::Statistics WaveformSearch::GetStatistics()
+{
+	Statistics stats;
+	stats.m_count = m_marks.size();
+	stats.m_waveformsSearched = m_waveformsSearched;
+	stats.m_waveformsWithMarks = 0;
+	stats.m_minDuration = 0;
+	stats.m_maxDuration = 0;
+	stats.m_meanDuration = 0;
+
+	if(m_marks.empty())
+		return stats;
+
+	stats.m_minDuration = INT64_MAX;
+	stats.m_maxDuration = INT64_MIN;
+	double sum = 0;
+	size_t lastWaveform = SIZE_MAX;
+	for(auto& m : m_marks)
+	{
+		stats.m_minDuration = min(stats.m_minDuration, m.m_duration);
+		stats.m_maxDuration = max(stats.m_maxDuration, m.m_duration);
+		sum += m.m_duration;
+
+		if(m.m_waveform != lastWaveform)
+		{
+			stats.m_waveformsWithMarks ++;
+			lastWaveform = m.m_waveform;
+		}
+	}
+	stats.m_meanDuration = sum / m_marks.size();
+
+	return stats;
+}
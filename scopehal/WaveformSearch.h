@@ -0,0 +1,286 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopehal                                                                                                          *
+*                                                                                                                      *
+* Copyright (c) 2012-2025 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Declaration of WaveformSearch
+ */
+
+#ifndef WaveformSearch_h
+#define WaveformSearch_h
+
+#include <mutex>
+
+/**
+	@brief Search-and-mark engine for finding events across a set of stored waveforms
+
+	Applies trigger-style analog event predicates (edge, pulse width / glitch, runt) or protocol symbol text
+	predicates to every waveform in a history, and returns a time-indexed list of marks.
+
+	Level crossings are cached per (instance ID, revision, threshold) and marks per (instance ID, revision), so
+	re-running a search after new waveforms are appended to the history only processes the new waveforms. Changing a
+	predicate which does not affect the thresholds (e.g. pulse width limits) reuses the cached crossings.
+
+	Entries for deleted waveforms are never reused, but are only freed by Prune() or ClearCache().
+ */
+class WaveformSearch
+{
+public:
+	WaveformSearch();
+	virtual ~WaveformSearch();
+
+	///@brief Types of event to search for
+	enum SearchType
+	{
+		///@brief Threshold crossings of the primary level
+		SEARCH_EDGE,
+
+		///@brief Pulses between two crossings of the primary level whose width meets the condition
+		SEARCH_PULSE_WIDTH,
+
+		///@brief Pulses which cross the lower level but not the upper, or vice versa
+		SEARCH_RUNT,
+
+		///@brief Protocol symbols whose text contains the search pattern
+		SEARCH_PROTOCOL
+	};
+
+	///@brief Edge / pulse polarity selection
+	enum EdgeType
+	{
+		///@brief Rising edges, or positive pulses
+		EDGE_RISING,
+
+		///@brief Falling edges, or negative pulses
+		EDGE_FALLING,
+
+		///@brief Either polarity
+		EDGE_ANY
+	};
+
+	///@brief A single search hit
+	struct Mark
+	{
+		///@brief Index of the waveform within the history passed to Search()
+		size_t m_waveform;
+
+		///@brief Start time of the event, in femtoseconds from the waveform's trigger
+		int64_t m_start;
+
+		///@brief Duration of the event, in femtoseconds (zero for edges)
+		int64_t m_duration;
+
+		///@brief Sample index of the matching symbol (protocol searches only)
+		size_t m_sample;
+
+		bool operator<(const Mark& rhs) const
+		{
+			if(m_waveform != rhs.m_waveform)
+				return m_waveform < rhs.m_waveform;
+			return m_start < rhs.m_start;
+		}
+	};
+
+	///@brief Summary statistics over the current set of marks
+	struct Statistics
+	{
+		size_t m_count;
+		size_t m_waveformsSearched;
+		size_t m_waveformsWithMarks;
+		int64_t m_minDuration;
+		int64_t m_maxDuration;
+		double m_meanDuration;
+	};
+
+	//Predicate configuration. Any change invalidates cached marks (but not cached crossings)
+	void SetSearchType(SearchType type)
+	{
+		m_type = type;
+		InvalidateMarks();
+	}
+
+	SearchType GetSearchType()
+	{ return m_type; }
+
+	void SetEdgeType(EdgeType type)
+	{
+		m_edgeType = type;
+		InvalidateMarks();
+	}
+
+	EdgeType GetEdgeType()
+	{ return m_edgeType; }
+
+	///@brief Sets the primary (edge, pulse width) or upper (runt) threshold level
+	void SetLevel(float level)
+	{
+		m_level = level;
+		InvalidateMarks();
+	}
+
+	float GetLevel()
+	{ return m_level; }
+
+	///@brief Sets the lower threshold level (runt only)
+	void SetLowerLevel(float level)
+	{
+		m_lowerLevel = level;
+		InvalidateMarks();
+	}
+
+	float GetLowerLevel()
+	{ return m_lowerLevel; }
+
+	/**
+		@brief Sets the pulse width condition
+
+		LESS / LESS_OR_EQUAL compare against the upper interval, GREATER / GREATER_OR_EQUAL / EQUAL / NOT_EQUAL
+		against the lower interval, and BETWEEN / NOT_BETWEEN against both.
+	 */
+	void SetCondition(Trigger::Condition cond)
+	{
+		m_condition = cond;
+		InvalidateMarks();
+	}
+
+	Trigger::Condition GetCondition()
+	{ return m_condition; }
+
+	///@brief Sets the lower pulse width bound, in femtoseconds
+	void SetLowerInterval(int64_t interval)
+	{
+		m_lowerInterval = interval;
+		InvalidateMarks();
+	}
+
+	int64_t GetLowerInterval()
+	{ return m_lowerInterval; }
+
+	///@brief Sets the upper pulse width bound, in femtoseconds
+	void SetUpperInterval(int64_t interval)
+	{
+		m_upperInterval = interval;
+		InvalidateMarks();
+	}
+
+	int64_t GetUpperInterval()
+	{ return m_upperInterval; }
+
+	///@brief Sets the substring to look for in protocol symbol text
+	void SetPattern(const std::string& pattern)
+	{
+		m_pattern = pattern;
+		InvalidateMarks();
+	}
+
+	const std::string& GetPattern()
+	{ return m_pattern; }
+
+	size_t Search(const std::vector<WaveformBase*>& history);
+
+	///@brief Returns all marks from the last Search(), sorted by waveform index then time
+	const std::vector<Mark>& GetMarks()
+	{ return m_marks; }
+
+	const Mark* GetNextMark(size_t waveform, int64_t time);
+	const Mark* GetPrevMark(size_t waveform, int64_t time);
+
+	Statistics GetStatistics();
+
+	void Prune(const std::vector<WaveformBase*>& history);
+	void ClearCache();
+
+protected:
+	void InvalidateMarks();
+
+	///@brief Cached level crossings of one waveform at one threshold
+	struct CrossingList
+	{
+		///@brief Waveform revision the crossings were computed from
+		uint64_t m_revision;
+
+		///@brief True if the waveform started above the threshold
+		bool m_initialHigh;
+
+		///@brief Crossing timestamps in femtoseconds. Direction alternates, starting with !m_initialHigh
+		std::vector<int64_t> m_crossings;
+	};
+
+	///@brief Cached search results for one waveform
+	struct MarkList
+	{
+		uint64_t m_revision;
+		uint64_t m_configRevision;
+		std::vector<Mark> m_marks;
+	};
+
+	const CrossingList& GetCrossings(WaveformBase* wfm, float threshold);
+	static void FindCrossings(WaveformBase* wfm, float threshold, CrossingList& list);
+
+	void SearchEdges(WaveformBase* wfm, size_t index, std::vector<Mark>& marks);
+	void SearchPulseWidth(WaveformBase* wfm, size_t index, std::vector<Mark>& marks);
+	void SearchRunt(WaveformBase* wfm, size_t index, std::vector<Mark>& marks);
+	void SearchProtocol(WaveformBase* wfm, size_t index, std::vector<Mark>& marks);
+
+	bool MatchWidth(int64_t width);
+
+	SearchType m_type;
+	EdgeType m_edgeType;
+	float m_level;
+	float m_lowerLevel;
+	Trigger::Condition m_condition;
+	int64_t m_lowerInterval;
+	int64_t m_upperInterval;
+	std::string m_pattern;
+
+	///@brief Bumped every time the predicate changes
+	uint64_t m_configRevision;
+
+	///@brief Mutex protecting the caches during parallel searches
+	std::mutex m_cacheMutex;
+
+	/**
+		@brief Cached crossings, keyed by waveform instance ID and threshold
+
+		Keyed by WaveformBase::m_instanceID rather than by pointer, so a new waveform allocated at the address of a
+		deleted one can never pick up its stale results.
+	 */
+	std::map<std::pair<uint64_t, float>, CrossingList> m_crossingCache;
+
+	///@brief Cached search results, keyed by waveform instance ID
+	std::map<uint64_t, MarkList> m_markCache;
+
+	///@brief Marks from the most recent search
+	std::vector<Mark> m_marks;
+
+	///@brief Number of waveforms in the most recent search
+	size_t m_waveformsSearched;
+};
+
+#endif
@@ -54,6 +54,7 @@
 #include <climits>
 #include <cinttypes>
 #include <set>
+#include <typeinfo>
 #include <float.h>
 #include <shared_mutex>
 
@@ -114,6 +115,8 @@ uint32_t GetComputeBlockCount(size_t numGlobal, size_t blockSize);
 #include "Bijection.h"
 #include "IDTable.h"
 
+#include "HostMemory.h"
+#include "ThreadPool.h"
 #include "AcceleratorBuffer.h"
 #include "ComputePipeline.h"
 
@@ -175,6 +178,8 @@ uint32_t GetComputeBlockCount(size_t numGlobal, size_t blockSize);
 #include "SCPIPowerSupply.h"
 #include "SCPIRFSignalGenerator.h"
 #include "SpectrometerDarkFrameChannel.h"
+#include "SpectrometerFrameProcessor.h"
+#include "SpectrumTraceProcessor.h"
 #include "SCPISA.h"
 #include "SCPISDR.h"
 #include "SCPISpectrometer.h"
@@ -187,12 +192,14 @@ uint32_t GetComputeBlockCount(size_t numGlobal, size_t blockSize);
 
 #include "FilterParameter.h"
 #include "Filter.h"
+#include "FilterDescriptor.h"
 #include "ImportFilter.h"
 #include "PeakDetectionFilter.h"
 #include "SpectrumChannel.h"
 #include "SParameterSourceFilter.h"
 #include "SParameterFilter.h"
 
+#include "FilterGraphBufferPlanner.h"
 #include "FilterGraphExecutor.h"
 
 #include "QueueManager.h"
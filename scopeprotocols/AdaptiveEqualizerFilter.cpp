@@ -0,0 +1,159 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+#include "../scopehal/scopehal.h"
+#include "AdaptiveEqualizerFilter.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+AdaptiveEqualizerFilter::AdaptiveEqualizerFilter(const string& color)
+	: Filter(color, CAT_ANALYSIS)
+	, m_precursorName("FFE Precursor Taps")
+	, m_postcursorName("FFE Postcursor Taps")
+	, m_dfeTapsName("DFE Taps")
+	, m_algorithmName("Algorithm")
+	, m_stepSizeName("Step Size")
+	, m_thresholdName("Threshold")
+	, m_adaptName("Adapt")
+{
+	AddStream(Unit(Unit::UNIT_VOLTS), "data", Stream::STREAM_TYPE_ANALOG);
+	CreateInput("data");
+	CreateInput("clk");
+
+	m_parameters[m_precursorName] = FilterParameter(FilterParameter::TYPE_INT, Unit(Unit::UNIT_COUNTS));
+	m_parameters[m_precursorName].SetIntVal(1);
+	m_parameters[m_precursorName].signal_changed().connect(
+		sigc::mem_fun(*this, &AdaptiveEqualizerFilter::OnConfigChanged));
+
+	m_parameters[m_postcursorName] = FilterParameter(FilterParameter::TYPE_INT, Unit(Unit::UNIT_COUNTS));
+	m_parameters[m_postcursorName].SetIntVal(3);
+	m_parameters[m_postcursorName].signal_changed().connect(
+		sigc::mem_fun(*this, &AdaptiveEqualizerFilter::OnConfigChanged));
+
+	m_parameters[m_dfeTapsName] = FilterParameter(FilterParameter::TYPE_INT, Unit(Unit::UNIT_COUNTS));
+	m_parameters[m_dfeTapsName].SetIntVal(2);
+	m_parameters[m_dfeTapsName].signal_changed().connect(
+		sigc::mem_fun(*this, &AdaptiveEqualizerFilter::OnConfigChanged));
+
+	m_parameters[m_algorithmName] = FilterParameter(FilterParameter::TYPE_ENUM, Unit(Unit::UNIT_COUNTS));
+	m_parameters[m_algorithmName].AddEnumValue("LMS", AdaptiveEqualizer::ALGORITHM_LMS);
+	m_parameters[m_algorithmName].AddEnumValue("Sign-sign LMS", AdaptiveEqualizer::ALGORITHM_SIGN_SIGN_LMS);
+	m_parameters[m_algorithmName].SetIntVal(AdaptiveEqualizer::ALGORITHM_SIGN_SIGN_LMS);
+
+	m_parameters[m_stepSizeName] = FilterParameter(FilterParameter::TYPE_FLOAT, Unit(Unit::UNIT_COUNTS));
+	m_parameters[m_stepSizeName].SetFloatVal(1e-3);
+
+	m_parameters[m_thresholdName] = FilterParameter(FilterParameter::TYPE_FLOAT, Unit(Unit::UNIT_VOLTS));
+	m_parameters[m_thresholdName].SetFloatVal(0);
+
+	m_parameters[m_adaptName] = FilterParameter(FilterParameter::TYPE_BOOL, Unit(Unit::UNIT_COUNTS));
+	m_parameters[m_adaptName].SetBoolVal(true);
+
+	OnConfigChanged();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Factory methods
+
+bool AdaptiveEqualizerFilter::ValidateChannel(size_t i, StreamDescriptor stream)
+{
+	if(stream.m_channel == NULL)
+		return false;
+
+	if( (i == 0) && (stream.GetType() == Stream::STREAM_TYPE_ANALOG) )
+		return true;
+	if( (i == 1) && (stream.GetType() == Stream::STREAM_TYPE_DIGITAL) )
+		return true;
+
+	return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Accessors
+
+string AdaptiveEqualizerFilter::GetProtocolName()
+{
+	return "Adaptive Equalizer";
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Actual decoder logic
+
+/**
+	@brief Resets the taps when the tap counts change
+ */
+void AdaptiveEqualizerFilter::OnConfigChanged()
+{
+	auto pre = max((int64_t)0, m_parameters[m_precursorName].GetIntVal());
+	auto post = max((int64_t)0, m_parameters[m_postcursorName].GetIntVal());
+	auto dfe = max((int64_t)0, m_parameters[m_dfeTapsName].GetIntVal());
+	m_equalizer.Configure(pre, post, dfe);
+}
+
+void AdaptiveEqualizerFilter::Refresh()
+{
+	if(!VerifyAllInputsOK())
+	{
+		SetData(NULL, 0);
+		return;
+	}
+
+	//Sample the input data
+	auto din = GetInputWaveform(0);
+	auto clk = GetInputWaveform(1);
+	din->PrepareForCpuAccess();
+	clk->PrepareForCpuAccess();
+
+	SparseAnalogWaveform samples;
+	SampleOnAnyEdgesBaseWithInterpolation(din, clk, samples);
+	samples.PrepareForCpuAccess();
+	size_t len = samples.m_samples.size();
+
+	m_streams[0].m_yAxisUnit = GetInput(0).GetYAxisUnits();
+
+	//Adapt, then equalize with the new taps
+	m_equalizer.SetAlgorithm(static_cast<AdaptiveEqualizer::Algorithm>(m_parameters[m_algorithmName].GetIntVal()));
+	m_equalizer.SetStepSize(m_parameters[m_stepSizeName].GetFloatVal());
+	m_equalizer.SetThreshold(m_parameters[m_thresholdName].GetFloatVal());
+	if(m_parameters[m_adaptName].GetBoolVal())
+		m_equalizer.Train(samples.m_samples.GetCpuPointer(), len);
+
+	auto cap = SetupEmptySparseAnalogOutputWaveform(din, 0);
+	cap->m_timescale = 1;
+	cap->m_triggerPhase = 0;
+	cap->Resize(len);
+	cap->PrepareForCpuAccess();
+	cap->m_offsets.CopyFrom(samples.m_offsets);
+	cap->m_durations.CopyFrom(samples.m_durations);
+	m_equalizer.Apply(samples.m_samples.GetCpuPointer(), cap->m_samples.GetCpuPointer(), len);
+	cap->MarkModifiedFromCpu();
+}
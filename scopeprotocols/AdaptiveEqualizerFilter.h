@@ -0,0 +1,74 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@brief Declaration of AdaptiveEqualizerFilter
+ */
+#ifndef AdaptiveEqualizerFilter_h
+#define AdaptiveEqualizerFilter_h
+
+#include "../scopehal/AdaptiveEqualizer.h"
+
+/**
+	@brief Adaptive FFE / DFE for NRZ serial data
+
+	Samples the data signal at each edge of a recovered clock, adapts the FFE and DFE taps with LMS or sign-sign LMS
+	using decisions from the sampled stream, and outputs the equalized samples (one per UI). Taps carry over between
+	waveforms, so adaptation continues as new data arrives.
+ */
+class AdaptiveEqualizerFilter : public Filter
+{
+public:
+	AdaptiveEqualizerFilter(const std::string& color);
+
+	virtual void Refresh() override;
+
+	static std::string GetProtocolName();
+
+	virtual bool ValidateChannel(size_t i, StreamDescriptor stream) override;
+
+	PROTOCOL_DECODER_INITPROC(AdaptiveEqualizerFilter)
+
+protected:
+	void OnConfigChanged();
+
+	std::string m_precursorName;
+	std::string m_postcursorName;
+	std::string m_dfeTapsName;
+	std::string m_algorithmName;
+	std::string m_stepSizeName;
+	std::string m_thresholdName;
+	std::string m_adaptName;
+
+	///@brief The equalizer, retaining taps between waveforms
+	AdaptiveEqualizer m_equalizer;
+};
+
+#endif
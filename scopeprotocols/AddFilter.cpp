@@ -39,9 +39,7 @@ AddFilter::AddFilter(const string& color)
 	: Filter(color, CAT_MATH)
 	, m_computePipeline("shaders/AddFilter.spv", 3, sizeof(uint32_t))
 {
-	AddStream(Unit(Unit::UNIT_VOLTS), "data", Stream::STREAM_TYPE_ANALOG);
-	CreateInput("a");
-	CreateInput("b");
+	ApplyDescriptor(Describe());
 }
 
 AddFilter::~AddFilter()
@@ -73,6 +71,19 @@ string AddFilter::GetProtocolName()
 	return "Add";
 }
 
+/**
+	@brief Describes the filter's interface without constructing it. The constructor applies the same descriptor.
+ */
+FilterDescriptor AddFilter::Describe()
+{
+	FilterDescriptor desc(GetProtocolName(), CAT_MATH);
+	desc.AddInput("a");
+	desc.AddInput("b");
+	desc.AddOutput("data", Stream::STREAM_TYPE_ANALOG, Unit(Unit::UNIT_VOLTS));
+	desc.SetCapabilities(FilterDescriptor::CAP_CPU_INPUT | FilterDescriptor::CAP_GPU_INPUT);
+	return desc;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Actual decoder logic
 
@@ -175,7 +175,8 @@ void BusHeatmapFilter::Refresh(vk::raii::CommandBuffer& /*cmdBuf*/, shared_ptr<Q
 
 		//Get X/Y histogram bins
 		auto xbin = din->m_offsets[i] * din->m_timescale / xscale;
-		size_t ybin = s.m_data / yscale;
+		//Strip the extended ID flag
+		size_t ybin = (s.m_data & 0x1fffffff) / yscale;
 
 		//Discard any off scale pixels
 		if(ybin >= ysize)
@@ -145,6 +145,23 @@ void CANAnalyzerFilter::Refresh(vk::raii::CommandBuffer& /*cmdBuf*/, std::shared
 
 				}
 
+				if( (s.m_stype == CANSymbol::TYPE_RTR) && pack && s.m_data)
+				{
+					pack->m_headers["Type"] = "RTR";
+					pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_DATA_READ];
+				}
+
+				//FD frames reuse the RTR position as the reserved RRS bit
+				if( (s.m_stype == CANSymbol::TYPE_FD) && pack && s.m_data)
+				{
+					pack->m_headers["Mode"] = "CAN-FD";
+					pack->m_headers["Type"] = "Data";
+					pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_DATA_WRITE];
+				}
+
+				if( (s.m_stype == CANSymbol::TYPE_BRS) && pack && s.m_data)
+					pack->m_headers["Mode"] = "CAN-FD+BRS";
+
 				if( (s.m_stype == CANSymbol::TYPE_DLC) && pack)
 				{
 					pack->m_headers["Len"] = to_string(s.m_data);
@@ -180,10 +197,31 @@ void CANAnalyzerFilter::Refresh(vk::raii::CommandBuffer& /*cmdBuf*/, std::shared
 			pack->m_offset = din->m_triggerPhase + din->m_timescale * din->m_offsets[i];
 			m_packets.push_back(pack);
 
-			//TODO: FD / RTR support etc?
 			pack->m_headers["Mode"] = "CAN";
+			pack->m_headers["Type"] = "Data";
 
 			state = STATE_IDLE;
 		}
+
+		//Error and overload frames stand alone
+		else if( (s.m_stype == CANSymbol::TYPE_ERROR_FRAME) || (s.m_stype == CANSymbol::TYPE_OVERLOAD_FRAME) )
+		{
+			pack = new Packet;
+			pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_ERROR];
+			pack->m_offset = din->m_triggerPhase + din->m_timescale * din->m_offsets[i];
+			pack->m_len = din->m_timescale * din->m_durations[i];
+			pack->m_headers["Mode"] = "CAN";
+			if(s.m_stype == CANSymbol::TYPE_ERROR_FRAME)
+				pack->m_headers["Type"] = "Error";
+			else
+				pack->m_headers["Type"] = "Overload";
+			m_packets.push_back(pack);
+
+			state = STATE_GARBAGE;
+		}
+
+		//Bad checksums flag the whole frame
+		else if( (s.m_stype == CANSymbol::TYPE_CRC_BAD) && pack)
+			pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_ERROR];
 	}
 }
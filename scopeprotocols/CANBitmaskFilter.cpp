@@ -131,8 +131,8 @@ void CANBitmaskFilter::Refresh()
 			case STATE_IDLE:
 				if(s.m_stype == CANSymbol::TYPE_ID)
 				{
-					//ID match?
-					if(targetaddr == s.m_data)
+					//ID match? (ignore the extended-format flag)
+					if(targetaddr == (s.m_data & 0x1fffffff) )
 					{
 						framestart = din->m_offsets[i] * din->m_timescale;
 						payload = 0;
@@ -39,517 +39,885 @@
 using namespace std;
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// Construction / destruction
-
-CANDecoder::CANDecoder(const string& color)
-	: PacketDecoder(color, CAT_BUS)
-	, m_baudrateName("Bit Rate")
-{
-	CreateInput("CANH");
+// CANBitReader
 
-	m_parameters[m_baudrateName] = FilterParameter(FilterParameter::TYPE_INT, Unit(Unit::UNIT_BITRATE));
-	m_parameters[m_baudrateName].SetIntVal(250000);
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// Factory methods
+/**
+	@brief Recovers logical CAN bits from a list of bus transitions
 
-bool CANDecoder::ValidateChannel(size_t i, StreamDescriptor stream)
+	Each call to ReadBit() jumps straight to the next sample point rather than visiting every sample in between.
+	Edges from recessive to dominant resynchronize the bit clock (with an unlimited resynchronization jump width), and
+	stuff bits are removed and checked according to the current stuffing mode.
+ */
+class CANBitReader
 {
-	if(stream.m_channel == NULL)
-		return false;
+public:
+	CANBitReader(const vector<int64_t>& edges, bool dominant, int64_t tstart, int64_t tend)
+		: m_edges(edges)
+		, m_nextEdge(0)
+		, m_dominant(dominant)
+		, m_tend(tend)
+		, m_tbit(tstart)
+		, m_bitStart(tstart)
+		, m_lastSample(tstart)
+		, m_ui(1)
+		, m_samplePoint(0.75)
+	{
+		StartFrame(true);
+	}
 
-	if( (i == 0) && (stream.GetType() == Stream::STREAM_TYPE_DIGITAL) )
-		return true;
+	enum Status
+	{
+		BIT_OK,
+		BIT_END,
+		BIT_STUFF_ERROR
+	};
 
-	return false;
-}
+	enum StuffMode
+	{
+		STUFF_NONE,
+		STUFF_DYNAMIC,
+		STUFF_FIXED
+	};
 
-string CANDecoder::GetProtocolName()
-{
-	return "CAN";
-}
+	///@brief Sets the bit time without changing the current bit boundary
+	void SetTiming(int64_t ui, float samplePoint)
+	{
+		m_ui = ui;
+		m_samplePoint = samplePoint;
+	}
 
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// Actual decoder logic
+	/**
+		@brief Switches bit timing at the sample point of the most recent bit
 
-void CANDecoder::Refresh()
-{
-	ClearPackets();
-
-	//Make sure we've got valid inputs
-	if(!VerifyAllInputsOK())
+		The remainder of that bit (phase segment 2) and everything after it use the new timing.
+	 */
+	void SwitchTiming(int64_t ui, float samplePoint)
 	{
-		SetData(NULL, 0);
-		return;
+		SetTiming(ui, samplePoint);
+		m_tbit = m_lastSample + static_cast<int64_t>(ui * (1 - samplePoint));
 	}
 
-	//Get the input data
-	auto din = GetInputWaveform(0);
-	din->PrepareForCpuAccess();
-	auto udiff = dynamic_cast<UniformDigitalWaveform*>(din);
-	auto sdiff = dynamic_cast<SparseDigitalWaveform*>(din);
+	/**
+		@brief Hard synchronizes to the first recessive-to-dominant edge after at least minIdle fs of recessive bus
 
-	//Create the capture
-	auto cap = new CANWaveform;
-	cap->m_timescale = din->m_timescale;
-	cap->m_startTimestamp = din->m_startTimestamp;
-	cap->m_startFemtoseconds = din->m_startFemtoseconds;
-	cap->m_triggerPhase = din->m_triggerPhase;
-	cap->PrepareForCpuAccess();
+		@return False if the end of the waveform was reached
+	 */
+	bool SyncToIdle(int64_t minIdle)
+	{
+		bool idle = !m_dominant;
+		int64_t idleStart = m_lastSample;
+		while(m_nextEdge < m_edges.size())
+		{
+			auto e = m_edges[m_nextEdge ++];
+			m_dominant = !m_dominant;
 
-	//Calculate some time scale values
-	//Sample point is 3/4 of the way through the UI
-	auto bitrate = m_parameters[m_baudrateName].GetIntVal();
-	int64_t fs_per_ui = FS_PER_SECOND / bitrate;
-	int64_t samples_per_ui = fs_per_ui / din->m_timescale;
+			if(!m_dominant)
+			{
+				idle = true;
+				idleStart = e;
+			}
+			else if(idle && ( (e - idleStart) >= minIdle) )
+			{
+				m_tbit = e;
+				m_bitStart = e;
+				m_lastSample = e;
+				return true;
+			}
+		}
+		return false;
+	}
 
-	enum
+	///@brief Resets stuffing and CRC state at the start of a frame
+	void StartFrame(bool iso)
 	{
-		STATE_WAIT_FOR_IDLE,
-		STATE_IDLE,
-		STATE_SOF,
-		STATE_ID,
-		STATE_EXT_ID,
-		STATE_RTR,
-		STATE_IDE,
-		STATE_FD,
-		STATE_R0,
-		STATE_DLC,
-		STATE_DATA,
-		STATE_CRC,
-
-		STATE_CRC_DELIM,
-		STATE_ACK,
-		STATE_ACK_DELIM,
-		STATE_EOF
-	} state = STATE_WAIT_FOR_IDLE;
-
-	//LogDebug("Starting CAN decode\n");
-	//LogIndenter li;
-
-	Packet* pack = NULL;
+		m_stuffMode = STUFF_DYNAMIC;
+		m_runLength = 0;
+		m_lastBit = true;
+		m_fixedCount = 0;
+		m_stuffCount = 0;
+		m_rawBits = 0;
+		m_crcEnabled = true;
+		m_crc15 = 0;
+		m_crc17 = iso ? (1 << 16) : 0;
+		m_crc21 = iso ? (1 << 20) : 0;
+	}
 
-	size_t len = din->size();
-	int64_t tbitstart = 0;
-	int64_t tblockstart = 0;
-	bool vlast = true;
-	int nbit = 0;
-	bool sampled = false;
-	bool sampled_value = false;
-	bool last_sampled_value = false;
-	int bits_since_toggle = 0;
-	uint32_t current_field = 0;
-	bool frame_is_rtr = false;
-	bool extended_id = false;
-	bool fd_mode = false;
-	int frame_bytes_left = 0;
-	int32_t frame_id = 0;
-	char tmp[128];
-
-	// CRC (http://esd.cs.ucr.edu/webres/can20.pdf page 13)
-	const uint16_t crc_poly = 0x4599;
-	uint16_t crc = 0;
-
-	for(size_t i = 0; i < len; i++)
-	{
-		bool v = GetValue(sdiff, udiff, i);
-		bool toggle = (v != vlast);
-		vlast = v;
+	/**
+		@brief Changes the stuffing rule for subsequent bits
 
-		auto off = ::GetOffset(sdiff, udiff, i);
-		auto end = ::GetDuration(sdiff, udiff, i) + off;
+		Entering fixed stuffing starts with a fixed stuff bit, as at the start of the CAN FD CRC field.
+	 */
+	void SetStuffMode(StuffMode mode)
+	{
+		m_stuffMode = mode;
+		m_fixedCount = 4;
+	}
 
-		auto current_bitlen = off - tbitstart;
+	///@brief Enables or disables CRC accumulation of subsequent bits
+	void EnableCRC(bool enable)
+	{ m_crcEnabled = enable; }
 
-		//When starting up, wait until we have at least 7 UIs idle in a row
-		if(state == STATE_WAIT_FOR_IDLE)
+	///@brief Samples the next bit on the wire with no destuffing (true = recessive)
+	Status ReadRawBit(bool& bit)
+	{
+		int64_t tsample = m_tbit + static_cast<int64_t>(m_ui * m_samplePoint);
+		while( (m_nextEdge < m_edges.size()) && (m_edges[m_nextEdge] <= tsample) )
 		{
-			if(v)
-				tblockstart = off;
-			else
-			{
-				if( (off - tblockstart) >= (7 * samples_per_ui) )
-					state = STATE_IDLE;
-			}
-		}
+			auto e = m_edges[m_nextEdge ++];
+			m_dominant = !m_dominant;
 
-		//If we're idle, begin the SOF as soon as we hit a dominant state
-		if(state == STATE_IDLE)
-		{
-			if(v)
+			//Resynchronize on recessive-to-dominant edges
+			if(m_dominant)
 			{
-				tblockstart = off;
-				tbitstart = off;
-				nbit = 0;
-				bits_since_toggle = 0;
-				state = STATE_SOF;
+				m_tbit = e;
+				tsample = m_tbit + static_cast<int64_t>(m_ui * m_samplePoint);
 			}
-			continue;
 		}
 
-		//Ignore all transitions for the first half of the unit interval
-		//TODO: resync if we get one in the very early period
-		if(current_bitlen < samples_per_ui/2)
-			continue;
+		if(tsample > m_tend)
+			return BIT_END;
 
-		//When we hit 3/4 of a UI, sample the bit value.
-		//Invert the sampled value since CAN uses negative logic
-		if( (current_bitlen >= 3 * samples_per_ui / 4) && !sampled )
-		{
-			last_sampled_value = sampled_value;
-			sampled = true;
-			sampled_value = !v;
-		}
+		m_bitStart = m_tbit;
+		m_lastSample = tsample;
+		m_tbit += m_ui;
+		m_rawBits ++;
 
-		//Lock in a bit when either the UI ends, or we see a transition
-		if(toggle || (current_bitlen >= samples_per_ui) )
+		bit = !m_dominant;
+		return BIT_OK;
+	}
+
+	///@brief Reads the next logical bit, removing and checking stuff bits
+	Status ReadBit(bool& bit)
+	{
+		while(true)
 		{
-			/*
-			LogDebug("Bit ended at %s (bits_since_toggle = %d, sampled_value = %d, last_sampled_value = %d)\n",
-				Unit(Unit::UNIT_FS).PrettyPrint(off * diff->m_timescale).c_str(), bits_since_toggle,
-				sampled_value, last_sampled_value);
-			*/
+			auto status = ReadRawBit(bit);
+			if(status != BIT_OK)
+				return status;
 
-			if(sampled_value == last_sampled_value)
-				bits_since_toggle ++;
+			//Dynamic stuff bit after five identical bits
+			if( (m_stuffMode == STUFF_DYNAMIC) && (m_runLength == 5) )
+			{
+				if(bit == m_lastBit)
+					return BIT_STUFF_ERROR;
 
-			//Don't look for stuff bits at the end of the frame
-			else if(state >= STATE_ACK)
-			{}
+				m_stuffCount ++;
+				m_lastBit = bit;
+				m_runLength = 1;
 
-			//Discard stuff bits
-			else
-			{
-				if(bits_since_toggle == 5)
+				//Dynamic stuff bits are covered by the FD CRCs but not CRC-15
+				if(m_crcEnabled)
 				{
-					//LogDebug("Discarding stuff bit at %s (bits_since_toggle = %d)\n",
-					//	Unit(Unit::UNIT_FS).PrettyPrint(off * diff->m_timescale).c_str(), bits_since_toggle);
-
-					tbitstart = off;
-					sampled = false;
-					bits_since_toggle = 1;
-					continue;
+					m_crc17 = UpdateCRC(m_crc17, bit, 0x1685b, 17);
+					m_crc21 = UpdateCRC(m_crc21, bit, 0x102899, 21);
 				}
-				else
-					bits_since_toggle = 1;
+				continue;
 			}
 
-			//TODO: Detect and report an error if we see six consecutive bits with the same polarity
+			//Fixed stuff bit (complement of the previous bit) every four bits
+			if( (m_stuffMode == STUFF_FIXED) && (m_fixedCount == 4) )
+			{
+				if(bit == m_lastBit)
+					return BIT_STUFF_ERROR;
 
-			//Read data bits
-			current_field <<= 1;
-			if(sampled_value)
-				current_field |= 1;
-			nbit ++;
+				m_lastBit = bit;
+				m_fixedCount = 0;
+				continue;
+			}
 
-			if (state != STATE_CRC){
-				uint16_t crc_bit_14 = (crc >> 14) & 0x1;
-				uint16_t crc_nxt = sampled_value ^ crc_bit_14;
-				crc = crc << 1;
+			AddBit(bit);
+			return BIT_OK;
+		}
+	}
 
-				if (crc_nxt){
-					crc = crc ^ crc_poly;
-				}
-			}
+	/**
+		@brief Accounts for a bit already returned by ReadRawBit() as a logical bit
 
-			switch(state)
-			{
-				//Wait for at least 7 bit times low
-				case STATE_WAIT_FOR_IDLE:
-					break;
+		Used when the SOF was sampled as the last bit of an intermission.
+	 */
+	void AddBit(bool bit)
+	{
+		if(bit == m_lastBit)
+			m_runLength ++;
+		else
+		{
+			m_runLength = 1;
+			m_lastBit = bit;
+		}
+		m_fixedCount ++;
 
-				case STATE_IDLE:
-					break;
+		if(m_crcEnabled)
+		{
+			m_crc15 = UpdateCRC(m_crc15, bit, 0x4599, 15);
+			m_crc17 = UpdateCRC(m_crc17, bit, 0x1685b, 17);
+			m_crc21 = UpdateCRC(m_crc21, bit, 0x102899, 21);
+		}
+	}
 
-				//SOF bit is over
-				case STATE_SOF:
+	///@brief Reads a field of up to 32 logical bits, MSB first
+	Status ReadField(int nbits, uint32_t& value)
+	{
+		value = 0;
+		for(int i=0; i<nbits; i++)
+		{
+			bool bit;
+			auto status = ReadBit(bit);
+			if(status != BIT_OK)
+				return status;
+			value = (value << 1) | bit;
+		}
+		return BIT_OK;
+	}
 
-					//Start a new packet
-					pack = new Packet;
-					pack->m_offset = off * din->m_timescale;
-					pack->m_len = 0;
-					m_packets.push_back(pack);
+	///@brief Start of the most recently sampled bit, in fs
+	int64_t GetBitStart() const
+	{ return m_bitStart; }
 
-					cap->m_offsets.push_back(tblockstart);
-					cap->m_durations.push_back(off - tblockstart);
-					cap->m_samples.push_back(CANSymbol(CANSymbol::TYPE_SOF, 0));
+	///@brief Expected end of the most recently sampled bit, in fs
+	int64_t GetBitEnd() const
+	{ return m_tbit; }
 
-					extended_id = false;
-					fd_mode = false;
+	uint32_t GetCRC15() const
+	{ return m_crc15; }
 
-					tblockstart = off;
-					nbit = 0;
-					crc = 0;
-					current_field = 0;
-					state = STATE_ID;
-					break;
+	uint32_t GetCRC17() const
+	{ return m_crc17; }
 
-				//Read the ID (MSB first)
-				case STATE_ID:
+	uint32_t GetCRC21() const
+	{ return m_crc21; }
 
-					//When we've read 11 bits, the ID is over
-					if(nbit == 11)
-					{
-						cap->m_offsets.push_back(tblockstart);
-						cap->m_durations.push_back(end - tblockstart);
-						cap->m_samples.push_back(CANSymbol(CANSymbol::TYPE_ID, current_field));
+	///@brief Number of dynamic stuff bits since the start of the frame
+	size_t GetStuffCount() const
+	{ return m_stuffCount; }
 
-						state = STATE_RTR;
+	///@brief Number of bits on the wire, including stuff bits, since the start of the frame
+	size_t GetRawBitCount() const
+	{ return m_rawBits; }
 
-						frame_id = current_field;
+protected:
+	static uint32_t UpdateCRC(uint32_t crc, bool bit, uint32_t poly, int width)
+	{
+		bool crcnext = bit ^ ((crc >> (width - 1)) & 1);
+		crc = (crc << 1) & ((1 << width) - 1);
+		if(crcnext)
+			crc ^= poly;
+		return crc;
+	}
 
-						snprintf(tmp, sizeof(tmp), "%03x", frame_id);
-						pack->m_headers["ID"] = tmp;
-						pack->m_headers["Format"] = "Base";
-						pack->m_headers["Mode"] = "CAN";
-						pack->m_headers["Type"] = "Data";
-					}
+	const vector<int64_t>& m_edges;
+	size_t m_nextEdge;
+	bool m_dominant;
+	int64_t m_tend;
 
-					break;
+	///@brief Nominal start of the next bit
+	int64_t m_tbit;
+	int64_t m_bitStart;
+	int64_t m_lastSample;
 
-				//Remote transmission request
-				case STATE_RTR:
-					frame_is_rtr = sampled_value;
+	int64_t m_ui;
+	float m_samplePoint;
 
-					cap->m_offsets.push_back(tbitstart);
-					cap->m_durations.push_back(end - tbitstart);
-					cap->m_samples.push_back(CANSymbol(CANSymbol::TYPE_RTR, frame_is_rtr));
+	StuffMode m_stuffMode;
+	int m_runLength;
+	bool m_lastBit;
+	int m_fixedCount;
+	size_t m_stuffCount;
+	size_t m_rawBits;
 
-					if(frame_is_rtr)
-					{
-						pack->m_headers["Type"] = "RTR";
-						pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_DATA_READ];
-					}
-					else
-						pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_DATA_WRITE];
+	bool m_crcEnabled;
+	uint32_t m_crc15;
+	uint32_t m_crc17;
+	uint32_t m_crc21;
+};
 
-					if(extended_id)
-						state = STATE_FD;
-					else
-						state = STATE_IDE;
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
 
-					break;
+CANDecoder::CANDecoder(const string& color)
+	: PacketDecoder(color, CAT_BUS)
+	, m_nominalUI(1)
+	, m_nominalSamplePoint(0.75)
+	, m_dataUI(1)
+	, m_dataSamplePoint(0.75)
+	, m_busTime(0)
+	, m_captureDuration(0)
+	, m_errorFrames(0)
+	, m_overloadFrames(0)
+	, m_baudrateName("Bit Rate")
+	, m_samplePointName("Sample Point")
+	, m_dataBaudrateName("Data Bit Rate")
+	, m_dataSamplePointName("Data Sample Point")
+	, m_fdStandardName("FD Standard")
+{
+	CreateInput("CANH");
 
-				//Identifier extension
-				case STATE_IDE:
-					extended_id = sampled_value;
+	m_parameters[m_baudrateName] = FilterParameter(FilterParameter::TYPE_INT, Unit(Unit::UNIT_BITRATE));
+	m_parameters[m_baudrateName].SetIntVal(250000);
 
-					if(extended_id)
-					{
-						//Delete the old ID and SRR
-						for(int n=0; n<2; n++)
-						{
-							cap->m_offsets.pop_back();
-							cap->m_durations.pop_back();
-							cap->m_samples.pop_back();
-						}
-
-						nbit = 0;
-						current_field = 0;
-						state = STATE_EXT_ID;
-					}
+	m_parameters[m_samplePointName] = FilterParameter(FilterParameter::TYPE_FLOAT, Unit(Unit::UNIT_PERCENT));
+	m_parameters[m_samplePointName].SetFloatVal(0.75);
 
-					else
-						state = STATE_R0;
+	m_parameters[m_dataBaudrateName] = FilterParameter(FilterParameter::TYPE_INT, Unit(Unit::UNIT_BITRATE));
+	m_parameters[m_dataBaudrateName].SetIntVal(2000000);
 
-					break;
+	m_parameters[m_dataSamplePointName] = FilterParameter(FilterParameter::TYPE_FLOAT, Unit(Unit::UNIT_PERCENT));
+	m_parameters[m_dataSamplePointName].SetFloatVal(0.75);
 
-				//Full ID
-				case STATE_EXT_ID:
+	m_parameters[m_fdStandardName] = FilterParameter(FilterParameter::TYPE_ENUM, Unit(Unit::UNIT_COUNTS));
+	m_parameters[m_fdStandardName].AddEnumValue("ISO 11898-1:2015", FD_ISO);
+	m_parameters[m_fdStandardName].AddEnumValue("Bosch (non-ISO)", FD_NON_ISO);
+	m_parameters[m_fdStandardName].SetIntVal(FD_ISO);
 
-					//Read the other 18 bits of the ID
-					if(nbit == 18)
-					{
-						frame_id = (frame_id << 18) | current_field;
+	m_baudrate = GetParameterHandle<int64_t>(m_baudrateName);
+	m_samplePointParam = GetParameterHandle<float>(m_samplePointName);
+	m_dataBaudrate = GetParameterHandle<int64_t>(m_dataBaudrateName);
+	m_dataSamplePointParam = GetParameterHandle<float>(m_dataSamplePointName);
+	m_fdStandard = GetParameterHandle<FDStandard>(m_fdStandardName);
+}
 
-						cap->m_offsets.push_back(tblockstart);
-						cap->m_durations.push_back(end - tblockstart);
-						cap->m_samples.push_back(CANSymbol(CANSymbol::TYPE_ID, frame_id));
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Factory methods
 
-						snprintf(tmp, sizeof(tmp), "%08x", frame_id);
-						pack->m_headers["ID"] = tmp;
-						pack->m_headers["Format"] = "Ext";
+bool CANDecoder::ValidateChannel(size_t i, StreamDescriptor stream)
+{
+	if(stream.m_channel == NULL)
+		return false;
 
-						state = STATE_RTR;
-					}
+	if( (i == 0) && (stream.GetType() == Stream::STREAM_TYPE_DIGITAL) )
+		return true;
 
-					break;
+	return false;
+}
 
-				//Reserved bit (should always be zero)
-				case STATE_R0:
-					cap->m_offsets.push_back(tbitstart);
-					cap->m_durations.push_back(end - tbitstart);
-					cap->m_samples.push_back(CANSymbol(CANSymbol::TYPE_R0, sampled_value));
+string CANDecoder::GetProtocolName()
+{
+	return "CAN";
+}
 
-					state = STATE_DLC;
-					tblockstart = off;
-					nbit = 0;
-					current_field = 0;
-					break;
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Accessors
 
-				//FD mode (currently ignored)
-				case STATE_FD:
-					cap->m_offsets.push_back(tbitstart);
-					cap->m_durations.push_back(end - tbitstart);
-					cap->m_samples.push_back(CANSymbol(CANSymbol::TYPE_FD, sampled_value));
+float CANDecoder::GetBusLoad(uint32_t id) const
+{
+	auto it = m_idStats.find(id);
+	if( (it == m_idStats.end()) || (m_captureDuration <= 0) )
+		return 0;
+	return (float)it->second.m_busTime / m_captureDuration;
+}
 
-					fd_mode = sampled_value;
-					if(fd_mode)
-						pack->m_headers["Mode"] = "CAN-FD";
+vector<string> CANDecoder::GetHeaders()
+{
+	vector<string> ret;
+	ret.push_back("ID");
+	ret.push_back("Mode");
+	ret.push_back("Format");
+	ret.push_back("Type");
+	ret.push_back("Ack");
+	ret.push_back("Len");
+	return ret;
+}
 
-					state = STATE_R0;
-					break;
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Actual decoder logic
 
-				//Data length code (4 bits)
-				case STATE_DLC:
+void CANDecoder::Refresh()
+{
+	ClearPackets();
+	m_idStats.clear();
+	m_busTime = 0;
+	m_captureDuration = 0;
+	m_errorFrames = 0;
+	m_overloadFrames = 0;
 
-					//When we've read 4 bits, the DLC is over
-					if(nbit == 4)
-					{
-						cap->m_offsets.push_back(tblockstart);
-						cap->m_durations.push_back(end - tblockstart);
-						cap->m_samples.push_back(CANSymbol(CANSymbol::TYPE_DLC, current_field));
+	//Make sure we've got valid inputs
+	if(!VerifyAllInputsOK())
+	{
+		SetData(NULL, 0);
+		return;
+	}
 
-						frame_bytes_left = current_field;
+	//Get the input data
+	auto din = GetInputWaveform(0);
+	din->PrepareForCpuAccess();
+	auto udiff = dynamic_cast<UniformDigitalWaveform*>(din);
+	auto sdiff = dynamic_cast<SparseDigitalWaveform*>(din);
+	size_t len = din->size();
 
-						//Skip data if DLC=0, or if this is a read request
-						if( (frame_bytes_left == 0) || frame_is_rtr)
-							state = STATE_CRC;
-						else
-							state = STATE_DATA;
+	auto bitrate = m_baudrate.Get();
+	auto databitrate = m_dataBaudrate.Get();
+	if( (len == 0) || (bitrate <= 0) || (databitrate <= 0) )
+	{
+		SetData(NULL, 0);
+		return;
+	}
 
-						tblockstart = end;
-						nbit = 0;
-						current_field = 0;
-					}
+	m_nominalUI = FS_PER_SECOND / bitrate;
+	m_dataUI = FS_PER_SECOND / databitrate;
+	m_nominalSamplePoint = min(max(m_samplePointParam.Get(), 0.05f), 0.95f);
+	m_dataSamplePoint = min(max(m_dataSamplePointParam.Get(), 0.05f), 0.95f);
 
-					break;
+	//Create the capture. Symbols are timestamped in fs since bit boundaries don't fall on sample boundaries.
+	auto cap = new CANWaveform;
+	cap->m_timescale = 1;
+	cap->m_startTimestamp = din->m_startTimestamp;
+	cap->m_startFemtoseconds = din->m_startFemtoseconds;
+	cap->m_triggerPhase = 0;
+	cap->PrepareForCpuAccess();
 
-				//Read frame data
-				case STATE_DATA:
+	//Find all of the bus transitions (input is high when dominant)
+	vector<int64_t> edges;
+	bool vfirst = GetValue(sdiff, udiff, 0);
+	bool vlast = vfirst;
+	for(size_t i=1; i<len; i++)
+	{
+		bool v = GetValue(sdiff, udiff, i);
+		if(v != vlast)
+			edges.push_back(GetOffsetScaled(sdiff, udiff, i));
+		vlast = v;
+	}
 
-					//Data is in 8-bit bytes
-					if(nbit == 8)
-					{
-						cap->m_offsets.push_back(tblockstart);
-						cap->m_durations.push_back(end - tblockstart);
-						cap->m_samples.push_back(CANSymbol(CANSymbol::TYPE_DATA, current_field));
+	int64_t tstart = GetOffsetScaled(sdiff, udiff, 0);
+	int64_t tend = GetOffsetScaled(sdiff, udiff, len-1) + GetDurationScaled(sdiff, udiff, len-1);
+	m_captureDuration = tend - tstart;
 
-						pack->m_data.push_back(current_field);
+	CANBitReader reader(edges, vfirst, tstart, tend);
+	reader.SetTiming(m_nominalUI, m_nominalSamplePoint);
 
-						//Go to CRC after we've read all the data
-						frame_bytes_left --;
-						if(frame_bytes_left == 0)
-							state = STATE_CRC;
+	//When starting up, wait until we have at least 7 UIs idle in a row
+	if(!reader.SyncToIdle(7 * m_nominalUI))
+	{
+		SetData(cap, 0);
+		cap->MarkModifiedFromCpu();
+		return;
+	}
 
-						//Reset for the next byte
-						tblockstart = end;
-						nbit = 0;
-						current_field = 0;
-					}
+	bool sofSampled = false;
+	while(true)
+	{
+		auto status = DecodeFrame(reader, cap, sofSampled);
+		sofSampled = false;
 
+		//Handle error and overload flags, then the intermission after each frame
+		bool flagSampled = false;
+		while(status != FRAME_END)
+		{
+			if( (status == FRAME_ERROR) || (status == FRAME_OVERLOAD) )
+			{
+				bool bit = false;
+				if(!flagSampled && (reader.ReadRawBit(bit) != CANBitReader::BIT_OK) )
+				{
+					status = FRAME_END;
 					break;
+				}
+				flagSampled = false;
 
-				//Read CRC value
-				case STATE_CRC:
+				status = DecodeErrorFrame(reader, cap, status, reader.GetBitStart(), !bit);
+				if(status == FRAME_END)
+					break;
+			}
 
-					//CRC is 15 bits long
-					if(nbit == 15)
+			//Intermission: dominant in the first two bits starts an overload flag, in the third a new frame
+			for(int i=0; i<3; i++)
+			{
+				bool bit;
+				if(reader.ReadRawBit(bit) != CANBitReader::BIT_OK)
+				{
+					status = FRAME_END;
+					break;
+				}
+				if(!bit)
+				{
+					if(i < 2)
 					{
-						bool crc_ok = (current_field == (crc & 0x7fff));
-						auto type = crc_ok ? CANSymbol::TYPE_CRC_OK : CANSymbol::TYPE_CRC_BAD;
+						status = FRAME_OVERLOAD;
+						flagSampled = true;
+					}
+					else
+						sofSampled = true;
+					break;
+				}
+			}
 
-						cap->m_offsets.push_back(tblockstart);
-						cap->m_durations.push_back(end - tblockstart);
-						cap->m_samples.push_back(CANSymbol(type, current_field));
+			if(status != FRAME_OVERLOAD)
+				break;
+		}
+		if(status == FRAME_END)
+			break;
 
-						state = STATE_CRC_DELIM;
-					}
+		//Back to bus idle, wait for the next SOF
+		if(!sofSampled && !reader.SyncToIdle(0))
+			break;
+	}
 
-					break;
+	SetData(cap, 0);
 
-				//CRC delimiter
-				case STATE_CRC_DELIM:
-					cap->m_offsets.push_back(tbitstart);
-					cap->m_durations.push_back(end - tbitstart);
-					cap->m_samples.push_back(CANSymbol(CANSymbol::TYPE_CRC_DELIM, sampled_value));
+	cap->MarkModifiedFromCpu();
+}
 
-					state = STATE_ACK;
-					break;
+/**
+	@brief Decodes a single data or remote frame, starting at the SOF bit
 
-				//ACK bit
-				case STATE_ACK:
-					cap->m_offsets.push_back(tbitstart);
-					cap->m_durations.push_back(end - tbitstart);
-					cap->m_samples.push_back(CANSymbol(CANSymbol::TYPE_ACK, sampled_value));
+	On return the reader is positioned either at the last bit of EOF or, for FRAME_ERROR and FRAME_OVERLOAD, at the
+	bit where the problem was detected. Note that the overload case does not consume the overload flag.
 
-					if(sampled_value)
-						pack->m_headers["Ack"] = "NAK";
-					else
-						pack->m_headers["Ack"] = "ACK";
+	@param reader		Bit reader, hard synchronized to the SOF edge
+	@param cap			Output waveform
+	@param sofSampled	True if the SOF bit was already sampled as the last bit of the previous intermission
+ */
+CANDecoder::FrameStatus CANDecoder::DecodeFrame(CANBitReader& reader, CANWaveform* cap, bool sofSampled)
+{
+	bool iso = (m_fdStandard.Get() == FD_ISO);
+
+	//SOF bit (always dominant)
+	reader.StartFrame(iso);
+	auto bstatus = CANBitReader::BIT_OK;
+	if(sofSampled)
+		reader.AddBit(false);
+	else
+	{
+		bool sof;
+		bstatus = reader.ReadBit(sof);
+		if(bstatus != CANBitReader::BIT_OK)
+			return FRAME_END;
+	}
+	int64_t tsof = reader.GetBitStart();
 
-					state = STATE_ACK_DELIM;
-					break;
+	auto emit = [&](CANSymbol::stype type, uint32_t data, int64_t start, int64_t end)
+	{
+		cap->m_offsets.push_back(start);
+		cap->m_durations.push_back(end - start);
+		cap->m_samples.push_back(CANSymbol(type, data));
+	};
+	emit(CANSymbol::TYPE_SOF, 0, tsof, reader.GetBitEnd());
+
+	//Start a new packet
+	auto pack = new Packet;
+	pack->m_offset = tsof;
+	pack->m_len = 0;
+	pack->SetHeader("Mode", "CAN");
+	pack->SetHeader("Format", "Base");
+	pack->SetHeader("Type", "Data");
+	pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_DATA_WRITE];
+	m_packets.push_back(pack);
+
+	bool idValid = false;
+	uint32_t id = 0;
+	bool crcOK = true;
+	auto status = FRAME_OK;
+
+	//Close out the packet and update bus statistics, however the frame ended
+	auto finish = [&](FrameStatus s)
+	{
+		//Errors in the data phase end the bit rate switch
+		reader.SetTiming(m_nominalUI, m_nominalSamplePoint);
 
-				//ACK delimiter
-				case STATE_ACK_DELIM:
-					cap->m_offsets.push_back(tbitstart);
-					cap->m_durations.push_back(end - tbitstart);
-					cap->m_samples.push_back(CANSymbol(CANSymbol::TYPE_ACK_DELIM, sampled_value));
+		pack->m_len = reader.GetBitEnd() - tsof;
+		if(s != FRAME_OK)
+			pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_ERROR];
 
-					state = STATE_EOF;
-					tblockstart = end;
-					nbit = 0;
-					current_field = 0;
-					break;
+		m_busTime += pack->m_len;
+		if(idValid)
+		{
+			auto& stats = m_idStats[id];
+			stats.m_frames ++;
+			stats.m_bits += reader.GetRawBitCount();
+			stats.m_busTime += pack->m_len;
+			if( (s == FRAME_ERROR) || !crcOK)
+				stats.m_errors ++;
+		}
+		return s;
+	};
 
-				//Read EOF
-				case STATE_EOF:
+	//Map a bit reader status onto a frame status
+	auto fail = [&](CANBitReader::Status s)
+	{
+		if(s == CANBitReader::BIT_END)
+		{
+			finish(FRAME_END);
+			return FRAME_END;
+		}
+		return finish(FRAME_ERROR);
+	};
+
+	//Base ID
+	uint32_t field;
+	int64_t tstart = reader.GetBitEnd();
+	if( (bstatus = reader.ReadField(11, field)) != CANBitReader::BIT_OK)
+		return fail(bstatus);
+	id = field;
+	int64_t tend = reader.GetBitEnd();
+
+	//RTR in base frames, SRR in extended frames
+	bool rtr;
+	if( (bstatus = reader.ReadBit(rtr)) != CANBitReader::BIT_OK)
+		return fail(bstatus);
+	int64_t trtr = reader.GetBitStart();
+	int64_t trtrEnd = reader.GetBitEnd();
+
+	//Identifier extension
+	bool ide;
+	if( (bstatus = reader.ReadBit(ide)) != CANBitReader::BIT_OK)
+		return fail(bstatus);
+
+	if(ide)
+	{
+		if( (bstatus = reader.ReadField(18, field)) != CANBitReader::BIT_OK)
+			return fail(bstatus);
+		id = (id << 18) | field | 0x80000000;
+		tend = reader.GetBitEnd();
+
+		//RTR in classic frames, RRS in FD frames
+		if( (bstatus = reader.ReadBit(rtr)) != CANBitReader::BIT_OK)
+			return fail(bstatus);
+		trtr = reader.GetBitStart();
+		trtrEnd = reader.GetBitEnd();
+
+		pack->SetHeaderHex("ID", id & 0x1fffffff, 8);
+		pack->SetHeader("Format", "Ext");
+	}
+	else
+		pack->SetHeaderHex("ID", id, 3);
+	idValid = true;
+
+	emit(CANSymbol::TYPE_ID, id, tstart, tend);
+	emit(CANSymbol::TYPE_RTR, rtr, trtr, trtrEnd);
+
+	//FDF (r1 in classic extended frames, r0 in classic base frames)
+	bool fdf;
+	if( (bstatus = reader.ReadBit(fdf)) != CANBitReader::BIT_OK)
+		return fail(bstatus);
+	emit(CANSymbol::TYPE_FD, fdf, reader.GetBitStart(), reader.GetBitEnd());
+
+	//Remaining reserved bit (r0 in extended classic frames, res in FD frames)
+	bool brs = false;
+	if(fdf || ide)
+	{
+		bool r0;
+		if( (bstatus = reader.ReadBit(r0)) != CANBitReader::BIT_OK)
+			return fail(bstatus);
+		emit(CANSymbol::TYPE_R0, r0, reader.GetBitStart(), reader.GetBitEnd());
+	}
 
-					//EOF is 7 bits long
-					if(nbit == 7)
-					{
-						if(frame_is_rtr)
-							snprintf(tmp, sizeof(tmp), "%d", (int)frame_bytes_left);
-						else
-							snprintf(tmp, sizeof(tmp), "%d", (int)pack->m_data.size());
-						pack->m_headers["Len"] = tmp;
+	if(fdf)
+	{
+		//FD frames have no remote request
+		rtr = false;
+		pack->SetHeader("Mode", "CAN-FD");
+
+		//Bit rate switch: phase segment 2 of BRS already uses the data phase timing
+		if( (bstatus = reader.ReadBit(brs)) != CANBitReader::BIT_OK)
+			return fail(bstatus);
+		tstart = reader.GetBitStart();
+		if(brs)
+		{
+			reader.SwitchTiming(m_dataUI, m_dataSamplePoint);
+			pack->SetHeader("Mode", "CAN-FD+BRS");
+		}
+		emit(CANSymbol::TYPE_BRS, brs, tstart, reader.GetBitEnd());
 
-						cap->m_offsets.push_back(tblockstart);
-						cap->m_durations.push_back(end - tblockstart);
-						cap->m_samples.push_back(CANSymbol(CANSymbol::TYPE_EOF, current_field));
+		//Error state indicator
+		bool esi;
+		if( (bstatus = reader.ReadBit(esi)) != CANBitReader::BIT_OK)
+			return fail(bstatus);
+		emit(CANSymbol::TYPE_ESI, esi, reader.GetBitStart(), reader.GetBitEnd());
+	}
+	else if(rtr)
+	{
+		pack->SetHeader("Type", "RTR");
+		pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_DATA_READ];
+	}
 
-						pack->m_len = pack->m_offset - (end * din->m_timescale);
+	//Data length code
+	tstart = reader.GetBitEnd();
+	if( (bstatus = reader.ReadField(4, field)) != CANBitReader::BIT_OK)
+		return fail(bstatus);
+	static const uint8_t fdlengths[16] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64};
+	size_t nbytes = fdf ? fdlengths[field] : min(field, 8u);
+	emit(CANSymbol::TYPE_DLC, nbytes, tstart, reader.GetBitEnd());
+	pack->SetHeaderDecimal("Len", nbytes);
+
+	//Data field (remote frames have none, but the DLC still reports the requested length)
+	if(rtr)
+		nbytes = 0;
+	for(size_t i=0; i<nbytes; i++)
+	{
+		tstart = reader.GetBitEnd();
+		if( (bstatus = reader.ReadField(8, field)) != CANBitReader::BIT_OK)
+			return fail(bstatus);
+		emit(CANSymbol::TYPE_DATA, field, tstart, reader.GetBitEnd());
+		pack->m_data.push_back(field);
+	}
 
-						state = STATE_IDLE;
-					}
+	//CRC field
+	uint32_t crcExpected;
+	int crcLen;
+	if(fdf)
+	{
+		//Fixed stuff bits from here through the end of the CRC
+		reader.SetStuffMode(CANBitReader::STUFF_FIXED);
 
-					break;
+		//ISO CAN FD: gray coded stuff count plus even parity, covered by the CRC
+		if(iso)
+		{
+			tstart = reader.GetBitEnd();
+			unsigned int expected = reader.GetStuffCount() % 8;
+			if( (bstatus = reader.ReadField(4, field)) != CANBitReader::BIT_OK)
+				return fail(bstatus);
+
+			unsigned int gray = field >> 1;
+			unsigned int count = gray ^ (gray >> 1) ^ (gray >> 2);
+			bool parityOK = ( (field ^ (field >> 1) ^ (field >> 2) ^ (field >> 3)) & 1) == 0;
+			bool countOK = parityOK && (count == expected);
+			if(!countOK)
+				crcOK = false;
+			emit(countOK ? CANSymbol::TYPE_STUFF_COUNT_OK : CANSymbol::TYPE_STUFF_COUNT_BAD,
+				count, tstart, reader.GetBitEnd());
+		}
 
-				default:
-					break;
-			}
+		if(nbytes <= 16)
+		{
+			crcExpected = reader.GetCRC17();
+			crcLen = 17;
+		}
+		else
+		{
+			crcExpected = reader.GetCRC21();
+			crcLen = 21;
+		}
+	}
+	else
+	{
+		crcExpected = reader.GetCRC15();
+		crcLen = 15;
+	}
 
-			//Start the next bit
-			tbitstart = off;
-			sampled = false;
+	reader.EnableCRC(false);
+	tstart = reader.GetBitEnd();
+	if( (bstatus = reader.ReadField(crcLen, field)) != CANBitReader::BIT_OK)
+		return fail(bstatus);
+	bool crcMatch = (field == crcExpected);
+	if(!crcMatch)
+		crcOK = false;
+	emit(crcMatch ? CANSymbol::TYPE_CRC_OK : CANSymbol::TYPE_CRC_BAD, field, tstart, reader.GetBitEnd());
+
+	//CRC delimiter. Classic frames may still have a stuff bit after the last CRC bit.
+	if(fdf)
+		reader.SetStuffMode(CANBitReader::STUFF_NONE);
+	bool delim;
+	if( (bstatus = reader.ReadBit(delim)) != CANBitReader::BIT_OK)
+		return fail(bstatus);
+	reader.SetStuffMode(CANBitReader::STUFF_NONE);
+	tstart = reader.GetBitStart();
+
+	//Return to nominal bit timing at the CRC delimiter sample point
+	if(brs)
+		reader.SwitchTiming(m_nominalUI, m_nominalSamplePoint);
+	emit(CANSymbol::TYPE_CRC_DELIM, delim, tstart, reader.GetBitEnd());
+	if(!delim)
+		return finish(FRAME_ERROR);
+
+	//ACK slot
+	bool ack;
+	if( (bstatus = reader.ReadBit(ack)) != CANBitReader::BIT_OK)
+		return fail(bstatus);
+	emit(CANSymbol::TYPE_ACK, ack, reader.GetBitStart(), reader.GetBitEnd());
+	pack->SetHeader("Ack", ack ? "NAK" : "ACK");
+
+	//ACK delimiter
+	if( (bstatus = reader.ReadBit(delim)) != CANBitReader::BIT_OK)
+		return fail(bstatus);
+	emit(CANSymbol::TYPE_ACK_DELIM, delim, reader.GetBitStart(), reader.GetBitEnd());
+	if(!delim)
+		return finish(FRAME_ERROR);
+
+	//End of frame: seven recessive bits. A dominant last bit is an overload condition, anything earlier is an error.
+	tstart = reader.GetBitEnd();
+	for(int i=0; i<7; i++)
+	{
+		bool eof;
+		if( (bstatus = reader.ReadBit(eof)) != CANBitReader::BIT_OK)
+			return fail(bstatus);
+		if(!eof)
+		{
+			emit(CANSymbol::TYPE_EOF, 0, tstart, reader.GetBitStart());
+			if(i == 6)
+				status = FRAME_OVERLOAD;
+			else
+				return finish(FRAME_ERROR);
+			break;
 		}
 	}
+	if(status == FRAME_OK)
+		emit(CANSymbol::TYPE_EOF, 1, tstart, reader.GetBitEnd());
 
-	SetData(cap, 0);
+	if(!crcOK)
+		pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_ERROR];
 
-	cap->MarkModifiedFromCpu();
+	//Overload flag is its own frame, so don't count it against this one
+	finish(FRAME_OK);
+	return status;
 }
 
-vector<string> CANDecoder::GetHeaders()
+/**
+	@brief Decodes an error or overload flag and the following delimiter
+
+	@param reader	Bit reader, positioned at the first bit of the flag
+	@param cap		Output waveform
+	@param type		FRAME_ERROR or FRAME_OVERLOAD
+	@param tstart	Start time of the flag
+	@param active	True if the first bit of the flag was dominant
+
+	@return FRAME_OK once eight recessive delimiter bits have been seen, or FRAME_END
+ */
+CANDecoder::FrameStatus CANDecoder::DecodeErrorFrame(
+	CANBitReader& reader,
+	CANWaveform* cap,
+	FrameStatus type,
+	int64_t tstart,
+	bool active)
 {
-	vector<string> ret;
-	ret.push_back("ID");
-	ret.push_back("Mode");
-	ret.push_back("Format");
-	ret.push_back("Type");
-	ret.push_back("Ack");
-	ret.push_back("Len");
-	return ret;
+	//Flags from several nodes may overlap, so wait for the 8-bit recessive delimiter rather than counting flag bits
+	int nrecessive = active ? 0 : 1;
+	auto status = FRAME_OK;
+	while(nrecessive < 8)
+	{
+		bool bit;
+		if(reader.ReadRawBit(bit) != CANBitReader::BIT_OK)
+		{
+			status = FRAME_END;
+			break;
+		}
+
+		if(bit)
+			nrecessive ++;
+		else
+		{
+			active = true;
+			nrecessive = 0;
+		}
+	}
+
+	int64_t tend = reader.GetBitEnd();
+	bool overload = (type == FRAME_OVERLOAD);
+	cap->m_offsets.push_back(tstart);
+	cap->m_durations.push_back(tend - tstart);
+	cap->m_samples.push_back(CANSymbol(
+		overload ? CANSymbol::TYPE_OVERLOAD_FRAME : CANSymbol::TYPE_ERROR_FRAME,
+		active));
+
+	auto pack = new Packet;
+	pack->m_offset = tstart;
+	pack->m_len = tend - tstart;
+	pack->SetHeader("Mode", "CAN");
+	pack->SetHeader("Type", overload ? "Overload" : "Error");
+	pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_ERROR];
+	m_packets.push_back(pack);
+
+	m_busTime += pack->m_len;
+	if(overload)
+		m_overloadFrames ++;
+	else
+		m_errorFrames ++;
+
+	return status;
 }
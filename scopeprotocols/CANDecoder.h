@@ -38,6 +38,15 @@
 
 #include "PacketDecoder.h"
 
+class CANBitReader;
+
+/**
+	@brief Decoder for classical CAN and CAN FD frames
+
+	Bits are recovered from the list of bus transitions rather than by walking every sample: the decoder hard
+	synchronizes on the start of frame, resynchronizes on each recessive-to-dominant edge, and switches to the data
+	phase bit timing between the BRS sample point and the CRC delimiter sample point of CAN FD frames.
+ */
 class CANDecoder : public PacketDecoder
 {
 public:
@@ -51,10 +60,109 @@ public:
 
 	virtual bool ValidateChannel(size_t i, StreamDescriptor stream) override;
 
+	virtual bool CanSkipRefreshWhenUnchanged() override
+	{ return true; }
+
+	///@brief Bus utilization of a single CAN ID over the current waveform
+	struct IDStatistics
+	{
+		///@brief Number of frames seen with this ID
+		size_t m_frames;
+
+		///@brief Number of frames with this ID which were malformed or failed the CRC check
+		size_t m_errors;
+
+		///@brief Number of bit times on the bus, including stuff bits
+		size_t m_bits;
+
+		///@brief Total time on the bus from SOF to end of EOF, in fs
+		int64_t m_busTime;
+	};
+
+	/**
+		@brief Gets per-ID statistics from the most recent decode
+
+		Extended IDs have bit 31 set, matching the TYPE_ID symbol value.
+	 */
+	const std::map<uint32_t, IDStatistics>& GetIDStatistics() const
+	{ return m_idStats; }
+
+	///@brief Gets the fraction of the waveform during which the bus was occupied by frames of the given ID
+	float GetBusLoad(uint32_t id) const;
+
+	///@brief Gets the fraction of the waveform during which the bus was occupied by any frame
+	float GetBusLoad() const
+	{ return (m_captureDuration > 0) ? (float)m_busTime / m_captureDuration : 0; }
+
+	///@brief Gets the number of error frames seen in the most recent decode
+	size_t GetErrorFrameCount() const
+	{ return m_errorFrames; }
+
+	///@brief Gets the number of overload frames seen in the most recent decode
+	size_t GetOverloadFrameCount() const
+	{ return m_overloadFrames; }
+
+	///@brief Revision of the CAN FD CRC and stuff count format
+	enum FDStandard
+	{
+		FD_ISO,
+		FD_NON_ISO
+	};
+
 	PROTOCOL_DECODER_INITPROC(CANDecoder)
 
 protected:
+
+	///@brief Result of decoding a single frame
+	enum FrameStatus
+	{
+		FRAME_OK,
+		FRAME_ERROR,
+		FRAME_OVERLOAD,
+		FRAME_END
+	};
+
+	FrameStatus DecodeFrame(CANBitReader& reader, CANWaveform* cap, bool sofSampled);
+	FrameStatus DecodeErrorFrame(CANBitReader& reader, CANWaveform* cap, FrameStatus type, int64_t tstart, bool active);
+
+	///@brief Nominal (arbitration phase) bit time, in fs
+	int64_t m_nominalUI;
+
+	///@brief Nominal sample point, as a fraction of the bit time
+	float m_nominalSamplePoint;
+
+	///@brief Data phase bit time, in fs
+	int64_t m_dataUI;
+
+	///@brief Data phase sample point, as a fraction of the bit time
+	float m_dataSamplePoint;
+
+	///@brief Per-ID statistics from the last decode
+	std::map<uint32_t, IDStatistics> m_idStats;
+
+	///@brief Total time the bus was occupied by frames, error frames, and overload frames
+	int64_t m_busTime;
+
+	///@brief Length of the decoded waveform, in fs
+	int64_t m_captureDuration;
+
+	///@brief Number of error frames in the last decode
+	size_t m_errorFrames;
+
+	///@brief Number of overload frames in the last decode
+	size_t m_overloadFrames;
+
 	std::string m_baudrateName;
+	std::string m_samplePointName;
+	std::string m_dataBaudrateName;
+	std::string m_dataSamplePointName;
+	std::string m_fdStandardName;
+
+	FilterParameterHandle<int64_t> m_baudrate;
+	FilterParameterHandle<float> m_samplePointParam;
+	FilterParameterHandle<int64_t> m_dataBaudrate;
+	FilterParameterHandle<float> m_dataSamplePointParam;
+	FilterParameterHandle<FDStandard> m_fdStandard;
 };
 
 #endif
@@ -29,7 +29,6 @@
 
 #include "../scopehal/scopehal.h"
 #include "CTLEFilter.h"
-#include <complex>
 
 using namespace std;
 
@@ -58,10 +57,11 @@ CTLEFilter::CTLEFilter(const string& color)
 	m_parameters[m_poleFreq2Name] = FilterParameter(FilterParameter::TYPE_FLOAT, Unit(Unit::UNIT_HZ));
 	m_parameters[m_poleFreq2Name].SetFloatVal(2e9);
 
-	m_cachedDcGain = 1;
-	m_cachedZeroFreq = 1;
-	m_cachedPole1Freq = 1;
-	m_cachedPole2Freq = 1;
+	m_dcGain = GetParameterHandle<float>(m_dcGainName);
+	m_zeroFreq = GetParameterHandle<float>(m_zeroFreqName);
+	m_poleFreq1 = GetParameterHandle<float>(m_poleFreq1Name);
+	m_poleFreq2 = GetParameterHandle<float>(m_poleFreq2Name);
+	m_cachedParamRevision = 0;
 
 	//delete s-param inputs
 	m_signalNames.resize(1);
@@ -89,26 +89,13 @@ void CTLEFilter::InterpolateSparameters(float bin_hz, bool /*invert*/, size_t no
 {
 	m_cachedBinSize = bin_hz;
 
-	typedef complex<float> fcpx;
-
-	fcpx p0(0, -FreqToPhase(m_cachedPole1Freq));
-	fcpx p1(0, -FreqToPhase(m_cachedPole2Freq));
-	fcpx zero(0, -FreqToPhase(m_cachedZeroFreq));
-
-	//Calculate the prescaler to null out the filter gain
-	float prescale = 1.0f / abs(zero / (p0*p1) );
-
-	//Multiply by our gain (in dB, so we have to convert to V/V)
-	prescale *= pow(10, m_cachedDcGain/20);
+	//One zero and two poles, all real and in the left half plane
+	CTLEModel model(m_dcGain.Get(), {m_zeroFreq.Get()}, {m_poleFreq1.Get(), m_poleFreq2.Get()});
 
 	for(size_t i=0; i<nouts; i++)
 	{
-		fcpx s(0, FreqToPhase(bin_hz * i));
-		fcpx h = prescale * (s - zero) / ( (s-p0) * (s-p1) );
-
-		//Phase correction seems unnecessary because this transfer function should be constant rotation?
-		//We get weird results when we do this, too.
-		float phase = 0;//arg(h);
+		auto h = model.GetResponse(bin_hz * i);
+		float phase = arg(h);
 		m_resampledSparamSines.push_back(sin(phase) * abs(h));
 		m_resampledSparamCosines.push_back(cos(phase) * abs(h));
 	}
@@ -116,25 +103,11 @@ void CTLEFilter::InterpolateSparameters(float bin_hz, bool /*invert*/, size_t no
 
 void CTLEFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueHandle> queue)
 {
-	//Pull out our settings
-	float dcgain_db = m_parameters[m_dcGainName].GetFloatVal();
-	float zfreq = m_parameters[m_zeroFreqName].GetFloatVal();
-	float pole1 = m_parameters[m_poleFreq1Name].GetFloatVal();
-	float pole2 = m_parameters[m_poleFreq2Name].GetFloatVal();
-
-	 if(
-		(dcgain_db != m_cachedDcGain) ||
-		(zfreq != m_cachedZeroFreq) ||
-		(pole1 != m_cachedPole1Freq) ||
-		(pole2 != m_cachedPole2Freq) )
+	//Force re-interpolation of S-parameters if any setting changed
+	if(ParametersChangedSince(m_cachedParamRevision))
 	{
-		//force re-interpolation of S-parameters
 		m_cachedBinSize = 0;
-
-		m_cachedDcGain = dcgain_db;
-		m_cachedZeroFreq = zfreq;
-		m_cachedPole1Freq = pole1;
-		m_cachedPole2Freq = pole2;
+		m_cachedParamRevision = GetParametersRevision();
 	}
 
 	//Do the actual refresh operation
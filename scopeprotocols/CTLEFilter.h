@@ -36,6 +36,7 @@
 #define CTLEFilter_h
 
 #include "DeEmbedFilter.h"
+#include "../scopehal/CTLEModel.h"
 
 class CTLEFilter : public DeEmbedFilter
 {
@@ -46,6 +47,9 @@ public:
 
 	static std::string GetProtocolName();
 
+	virtual bool CanSkipRefreshWhenUnchanged() override
+	{ return true; }
+
 	PROTOCOL_DECODER_INITPROC(CTLEFilter)
 
 protected:
@@ -57,10 +61,13 @@ protected:
 	std::string m_poleFreq1Name;
 	std::string m_poleFreq2Name;
 
-	float m_cachedDcGain;
-	float m_cachedZeroFreq;
-	float m_cachedPole1Freq;
-	float m_cachedPole2Freq;
+	FilterParameterHandle<float> m_dcGain;
+	FilterParameterHandle<float> m_zeroFreq;
+	FilterParameterHandle<float> m_poleFreq1;
+	FilterParameterHandle<float> m_poleFreq2;
+
+	///@brief Parameter revision the current S-parameters were interpolated with
+	uint64_t m_cachedParamRevision;
 };
 
 #endif
@@ -137,7 +137,7 @@ void ComplexSpectrogramFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_p
 	//Figure out how many FFTs to do
 	//For now, consecutive blocks and not a sliding window
 	size_t inlen = min(din_i->size(), din_q->size());
-	size_t fftlen = m_parameters[m_fftLengthName].GetIntVal();
+	size_t fftlen = m_fftLength.Get();
 	size_t nblocks = floor(inlen * 1.0 / fftlen);
 
 	if( (fftlen != m_cachedFFTLength) || (nblocks != m_cachedFFTNumBlocks) )
@@ -194,7 +194,7 @@ void ComplexSpectrogramFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_p
 	SetData(cap, 0);
 
 	//We also need to adjust the scale by the coherent power gain of the window function
-	auto window = static_cast<FFTFilter::WindowFunction>(m_parameters[m_windowName].GetIntVal());
+	auto window = static_cast<FFTFilter::WindowFunction>(m_window.Get());
 	switch(window)
 	{
 		case FFTFilter::WINDOW_HAMMING:
@@ -260,8 +260,8 @@ void ComplexSpectrogramFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_p
 	m_rdoutbuf.resize(nblocks * (nouts * 2) );
 
 	//Cache a bunch of configuration
-	float minscale = m_parameters[m_rangeMinName].GetFloatVal();
-	float fullscale = m_parameters[m_rangeMaxName].GetFloatVal();
+	float minscale = m_rangeMin.Get();
+	float fullscale = m_rangeMax.Get();
 	float range = fullscale - minscale;
 
 	//Prepare to do all of our compute stuff in one dispatch call to reduce overhead
@@ -91,18 +91,18 @@ void DDR1Decoder::Refresh()
 		caps[i]->PrepareForCpuAccess();
 	}
 
-	//Sample all of the inputs
+	//Sample all of the inputs in one pass.
+	//WE/CAS/RAS land in the low three bits so the command can be decoded with a single switch.
 	auto cclk = caps[0];
-	SparseDigitalWaveform we;
-	SparseDigitalWaveform ras;
-	SparseDigitalWaveform cas;
-	SparseDigitalWaveform cs;
-	SparseDigitalWaveform a10;
-	SampleOnRisingEdgesBase(caps[1], cclk, we);
-	SampleOnRisingEdgesBase(caps[2], cclk, ras);
-	SampleOnRisingEdgesBase(caps[3], cclk, cas);
-	SampleOnRisingEdgesBase(caps[4], cclk, cs);
-	SampleOnRisingEdgesBase(caps[5], cclk, a10);
+	SparseWaveform<uint64_t> samples;
+	if(!SampleMultipleOnEdges({caps[1], caps[3], caps[2], caps[4], caps[5]}, cclk, samples, CLOCK_EDGE_RISING))
+	{
+		SetData(NULL, 0);
+		return;
+	}
+	const uint64_t cmdmask = 0x7;
+	const uint64_t csbit = 0x8;
+	const uint64_t a10bit = 0x10;
 
 	//Create the capture
 	auto cap = new SDRAMWaveform;
@@ -112,64 +112,60 @@ void DDR1Decoder::Refresh()
 	cap->PrepareForCpuAccess();
 
 	//Loop over the data and look for events on clock edges
-	size_t len = we.size();
-	len = min(len, ras.size());
-	len = min(len, cas.size());
-	len = min(len, cs.size());
-	len = min(len, a10.size());
+	size_t len = samples.size();
 	for(size_t i=0; i<len; i++)
 	{
-		bool swe = we.m_samples[i];
-		bool sras = ras.m_samples[i];
-		bool scas = cas.m_samples[i];
-		bool scs = cs.m_samples[i];
-		bool sa10 = a10.m_samples[i];
+		uint64_t w = samples.m_samples[i];
+		if(w & csbit)
+			continue;
 
-		if(!scs)
+		bool sa10 = (w & a10bit) != 0;
+
+		SDRAMSymbol sym(SDRAMSymbol::TYPE_ERROR);
+
+		//RAS/CAS/WE
+		switch(w & cmdmask)
 		{
 			//NOP
-			if(sras && scas && swe)
+			case 7:
 				continue;
 
-			SDRAMSymbol sym(SDRAMSymbol::TYPE_ERROR);
-
-			if(!sras && scas && swe)
+			case 3:
 				sym.m_stype = SDRAMSymbol::TYPE_ACT;
-			else if(!sras && scas && !swe && !sa10)
-				sym.m_stype = SDRAMSymbol::TYPE_PRE;
-			else if(!sras && scas && !swe && sa10)
-				sym.m_stype = SDRAMSymbol::TYPE_PREA;
-			else if(sras && !scas && !swe)
-			{
-				if(!sa10)
-					sym.m_stype = SDRAMSymbol::TYPE_WR;
-				else
-					sym.m_stype = SDRAMSymbol::TYPE_WRA;
-			}
-			else if(sras && !scas && swe)
-			{
-				if(!sa10)
-					sym.m_stype = SDRAMSymbol::TYPE_RD;
-				else
-					sym.m_stype = SDRAMSymbol::TYPE_RDA;
-			}
-			else if(!sras && !scas && !swe)
+				break;
+
+			case 2:
+				sym.m_stype = sa10 ? SDRAMSymbol::TYPE_PREA : SDRAMSymbol::TYPE_PRE;
+				break;
+
+			case 4:
+				sym.m_stype = sa10 ? SDRAMSymbol::TYPE_WRA : SDRAMSymbol::TYPE_WR;
+				break;
+
+			case 5:
+				sym.m_stype = sa10 ? SDRAMSymbol::TYPE_RDA : SDRAMSymbol::TYPE_RD;
+				break;
+
+			case 0:
 				sym.m_stype = SDRAMSymbol::TYPE_MRS;		//TODO: MRS / EMRS depending on BA0
-			else if(sras && scas && !swe)
+				break;
+
+			case 6:
 				sym.m_stype = SDRAMSymbol::TYPE_STOP;
-			else if(!sras && !scas && swe)
+				break;
+
+			case 1:
+			default:
 				sym.m_stype = SDRAMSymbol::TYPE_REF;
+				break;
 
-			//Unknown
 			//TODO: self refresh entry/exit (we don't have CKE in the current test data source so can't use it)
-			else
-				LogDebug("[%zu] Unknown command (RAS=%d, CAS=%d, WE=%d, A10=%d)\n", i, sras, scas, swe, sa10);
-
-			//Create the symbol
-			cap->m_offsets.push_back(we.m_offsets[i]);
-			cap->m_durations.push_back(we.m_durations[i]);
-			cap->m_samples.push_back(sym);
 		}
+
+		//Create the symbol
+		cap->m_offsets.push_back(samples.m_offsets[i]);
+		cap->m_durations.push_back(samples.m_durations[i]);
+		cap->m_samples.push_back(sym);
 	}
 	SetData(cap, 0);
 
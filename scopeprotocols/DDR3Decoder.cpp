@@ -92,20 +92,19 @@ void DDR3Decoder::Refresh()
 		caps[i]->PrepareForCpuAccess();
 	}
 
-	//Sample all of the inputs
+	//Sample all of the inputs in one pass.
+	//WE/CAS/RAS land in the low three bits so the command can be decoded with a single switch.
 	auto cclk = caps[0];
-	SparseDigitalWaveform we;
-	SparseDigitalWaveform ras;
-	SparseDigitalWaveform cas;
-	SparseDigitalWaveform cs;
-	SparseDigitalWaveform a12;
-	SparseDigitalWaveform a10;
-	SampleOnRisingEdgesBase(caps[1], cclk, we);
-	SampleOnRisingEdgesBase(caps[2], cclk, ras);
-	SampleOnRisingEdgesBase(caps[3], cclk, cas);
-	SampleOnRisingEdgesBase(caps[4], cclk, cs);
-	SampleOnRisingEdgesBase(caps[5], cclk, a12);
-	SampleOnRisingEdgesBase(caps[6], cclk, a10);
+	SparseWaveform<uint64_t> samples;
+	if(!SampleMultipleOnEdges({caps[1], caps[3], caps[2], caps[4], caps[5], caps[6]}, cclk, samples, CLOCK_EDGE_RISING))
+	{
+		SetData(NULL, 0);
+		return;
+	}
+	const uint64_t cmdmask = 0x7;
+	const uint64_t csbit = 0x8;
+	const uint64_t a12bit = 0x10;
+	const uint64_t a10bit = 0x20;
 
 	//Create the capture
 	auto cap = new SDRAMWaveform;
@@ -115,64 +114,65 @@ void DDR3Decoder::Refresh()
 	cap->PrepareForCpuAccess();
 
 	//Loop over the data and look for events on clock edges
-	size_t len = we.size();
-	len = min(len, ras.size());
-	len = min(len, cas.size());
-	len = min(len, cs.size());
-	len = min(len, a12.size());
-	len = min(len, a10.size());
+	size_t len = samples.size();
 	for(size_t i=0; i<len; i++)
 	{
-		bool swe = we.m_samples[i];
-		bool sras = ras.m_samples[i];
-		bool scas = cas.m_samples[i];
-		bool scs = cs.m_samples[i];
-		bool sa12 = a12.m_samples[i];
-		bool sa10 = a10.m_samples[i];
-
-		if(!scs)
+		uint64_t w = samples.m_samples[i];
+		if(w & csbit)
+			continue;
+
+		bool sa10 = (w & a10bit) != 0;
+
+		SDRAMSymbol sym(SDRAMSymbol::TYPE_ERROR);
+
+		//RAS/CAS/WE
+		switch(w & cmdmask)
 		{
 			//NOP
-			if(sras && scas && swe)
+			case 7:
 				continue;
 
-			SDRAMSymbol sym(SDRAMSymbol::TYPE_ERROR);
-
-			if(!sras && !scas && !swe)
+			case 0:
 				sym.m_stype = SDRAMSymbol::TYPE_MRS;
-			else if(!sras && !scas && swe)
+				break;
+
+			case 1:
 				sym.m_stype = SDRAMSymbol::TYPE_REF;
-			else if(!sras && scas && !swe && !sa10)
-				sym.m_stype = SDRAMSymbol::TYPE_PRE;
-			else if(!sras && scas && !swe && sa10)
-				sym.m_stype = SDRAMSymbol::TYPE_PREA;
-			else if(!sras && scas && swe)
+				break;
+
+			case 2:
+				sym.m_stype = sa10 ? SDRAMSymbol::TYPE_PREA : SDRAMSymbol::TYPE_PRE;
+				break;
+
+			case 3:
 				sym.m_stype = SDRAMSymbol::TYPE_ACT;
-			else if(sras && !scas && !swe)
-			{
-				if(!sa10)
-					sym.m_stype = SDRAMSymbol::TYPE_WR;
-				else
-					sym.m_stype = SDRAMSymbol::TYPE_WRA;
-			}
-			else if(sras && !scas && swe)
-			{
-				if(!sa10)
-					sym.m_stype = SDRAMSymbol::TYPE_RD;
-				else
-					sym.m_stype = SDRAMSymbol::TYPE_RDA;
-			}
+				break;
+
+			case 4:
+				sym.m_stype = sa10 ? SDRAMSymbol::TYPE_WRA : SDRAMSymbol::TYPE_WR;
+				break;
+
+			case 5:
+				sym.m_stype = sa10 ? SDRAMSymbol::TYPE_RDA : SDRAMSymbol::TYPE_RD;
+				break;
 
 			//Unknown
 			//TODO: self refresh entry/exit (we don't have CKE in the current test data source so can't use it)
-			else
-				LogDebug("[%zu] Unknown command (RAS=%d, CAS=%d, WE=%d, A12=%d, A10=%d)\n", i, sras, scas, swe, sa12, sa10);
-
-			//Create the symbol
-			cap->m_offsets.push_back(we.m_offsets[i]);
-			cap->m_durations.push_back(we.m_durations[i]);
-			cap->m_samples.push_back(sym);
+			default:
+				LogDebug("[%zu] Unknown command (RAS=%d, CAS=%d, WE=%d, A12=%d, A10=%d)\n",
+					i,
+					(int)((w >> 2) & 1),
+					(int)((w >> 1) & 1),
+					(int)(w & 1),
+					(w & a12bit) != 0,
+					sa10);
+				break;
 		}
+
+		//Create the symbol
+		cap->m_offsets.push_back(samples.m_offsets[i]);
+		cap->m_durations.push_back(samples.m_durations[i]);
+		cap->m_samples.push_back(sym);
 	}
 	SetData(cap, 0);
 	cap->MarkModifiedFromCpu();
@@ -328,7 +328,7 @@ void DPAuxChannelDecoder::Refresh()
 					//Decode packet content
 					if(!pack->m_data.empty())
 					{
-						if(pack->m_headers["Info"] != "")
+						if(pack->GetHeader("Info") != "")
 							pack->m_headers["Info"] += "\n";
 						pack->m_headers["Info"] += DecodeRegisterContent(request_addr, pack->m_data);
 					}
@@ -1906,24 +1906,24 @@ string DPAuxChannelDecoder::DecodeRegisterContent(uint32_t start_addr, const vec
 bool DPAuxChannelDecoder::CanMerge(Packet* first, Packet* cur, Packet* next)
 {
 	//Merge reads and writes with their completions
-	if( (first->m_headers["Type"] == "DP Read") && (next->m_headers["Type"] == "AUX_ACK") )
+	if( (first->GetHeader("Type") == "DP Read") && (next->GetHeader("Type") == "AUX_ACK") )
 		return true;
-	if( (first->m_headers["Type"] == "DP Write") &&
-		( (next->m_headers["Type"] == "AUX_ACK") || (next->m_headers["Type"] == "AUX_NACK") ) )
+	if( (first->GetHeader("Type") == "DP Write") &&
+		( (next->GetHeader("Type") == "AUX_ACK") || (next->GetHeader("Type") == "AUX_NACK") ) )
 	{
 		return true;
 	}
 
 	//Merge I2C reads and writes with ACKs
-	if( (first->m_headers["Type"].find("I2C Write") == 0) && (next->m_headers["Type"] == "I2C_ACK") )
+	if( (first->GetHeader("Type").find("I2C Write") == 0) && (next->GetHeader("Type") == "I2C_ACK") )
 		return true;
-	if( (first->m_headers["Type"].find("I2C Read") == 0) && (next->m_headers["Type"] == "I2C_ACK") )
+	if( (first->GetHeader("Type").find("I2C Read") == 0) && (next->GetHeader("Type") == "I2C_ACK") )
 		return true;
 
 	//Merge Read MOT with any subsequent Read MOT or ACK using the same address
-	if( (first->m_headers["Type"] == "I2C Read MOT") &&
-		( (next->m_headers["Type"] == "I2C Read MOT") || (next->m_headers["Type"] == "I2C_ACK") ) &&
-		(first->m_headers["Address"] == next->m_headers["Address"]) )
+	if( (first->GetHeader("Type") == "I2C Read MOT") &&
+		( (next->GetHeader("Type") == "I2C Read MOT") || (next->GetHeader("Type") == "I2C_ACK") ) &&
+		(first->GetHeader("Address") == next->GetHeader("Address")) )
 	{
 		//Do not merge anything new if the current packet has data
 		if( (cur != first) && (!cur->m_data.empty()) )
@@ -1941,14 +1941,14 @@ Packet* DPAuxChannelDecoder::CreateMergedHeader(Packet* pack, size_t i)
 	Packet* ret = new Packet;
 	ret->m_offset = pack->m_offset;
 	ret->m_len = pack->m_len;
-	ret->m_headers["Type"] = pack->m_headers["Type"];
-	ret->m_headers["Address"] = pack->m_headers["Address"];
-	ret->m_headers["Length"] = pack->m_headers["Length"];
-	ret->m_headers["Info"] = pack->m_headers["Info"];
+	ret->m_headers["Type"] = pack->GetHeader("Type");
+	ret->m_headers["Address"] = pack->GetHeader("Address");
+	ret->m_headers["Length"] = pack->GetHeader("Length");
+	ret->m_headers["Info"] = pack->GetHeader("Info");
 	ret->m_displayBackgroundColor = pack->m_displayBackgroundColor;
 
 	//Combine DP read with completion
-	if(pack->m_headers["Type"] == "DP Read")
+	if(pack->GetHeader("Type") == "DP Read")
 	{
 		//Add data from reply, if available
 		if(i+1 < m_packets.size())
@@ -1957,14 +1957,14 @@ Packet* DPAuxChannelDecoder::CreateMergedHeader(Packet* pack, size_t i)
 			ret->m_data = next->m_data;
 			ret->m_len = next->m_offset + next->m_len - pack->m_offset;
 
-			auto info = next->m_headers["Info"];
+			auto info = next->GetHeader("Info");
 			if(!info.empty())
 				ret->m_headers["Info"] += "\n" + info;
 		}
 	}
 
 	//Combine DP write with completion
-	if(pack->m_headers["Type"] == "DP Write")
+	if(pack->GetHeader("Type") == "DP Write")
 	{
 		ret->m_data = pack->m_data;
 
@@ -1977,12 +1977,12 @@ Packet* DPAuxChannelDecoder::CreateMergedHeader(Packet* pack, size_t i)
 	}
 
 	//Combine I2C read or write with ACK
-	if( (pack->m_headers["Type"].find("I2C Write") == 0) || (pack->m_headers["Type"].find("I2C Read") == 0) )
+	if( (pack->GetHeader("Type").find("I2C Write") == 0) || (pack->GetHeader("Type").find("I2C Read") == 0) )
 	{
 		ret->m_data = pack->m_data;
 
 		//If not a MOT, stop after one
-		if(pack->m_headers["Type"].find("MOT") == string::npos)
+		if(pack->GetHeader("Type").find("MOT") == string::npos)
 		{
 			if(i+1 < m_packets.size())
 			{
@@ -1999,7 +1999,7 @@ Packet* DPAuxChannelDecoder::CreateMergedHeader(Packet* pack, size_t i)
 		else
 		{
 			//Remove the MOT flag from the top level packet
-			if(pack->m_headers["Type"] == "I2C Write MOT")
+			if(pack->GetHeader("Type") == "I2C Write MOT")
 				ret->m_headers["Type"] = "I2C Write";
 			else
 				ret->m_headers["Type"] = "I2C Read";
@@ -2008,9 +2008,9 @@ Packet* DPAuxChannelDecoder::CreateMergedHeader(Packet* pack, size_t i)
 			{
 				//Not the same type or ACK? Stop
 				auto next = m_packets[i+1];
-				if( (pack->m_headers["Type"] != next->m_headers["Type"]) && (next->m_headers["Type"] != "I2C_ACK") )
+				if( (pack->GetHeader("Type") != next->GetHeader("Type")) && (next->GetHeader("Type") != "I2C_ACK") )
 					break;
-				if(pack->m_headers["Address"] != next->m_headers["Address"])
+				if(pack->GetHeader("Address") != next->GetHeader("Address"))
 					break;
 
 				ret->m_len = next->m_offset + next->m_len - pack->m_offset;
@@ -44,9 +44,17 @@ using namespace std;
 
 DSIFrameDecoder::DSIFrameDecoder(const string& color)
 	: PacketDecoder(color, CAT_SERIAL)
+	, m_outfilename("Output File")
 {
 	AddProtocolStream("data");
 	CreateInput("DSI");
+
+	//Saved as PNG if the extension is .png, raw RGB888 otherwise.
+	//If there's more than one frame, the frame number is added before the extension.
+	m_parameters[m_outfilename] = FilterParameter(FilterParameter::TYPE_FILENAME, Unit(Unit::UNIT_COUNTS));
+	m_parameters[m_outfilename].m_fileFilterMask = "*.png";
+	m_parameters[m_outfilename].m_fileFilterName = "PNG images (*.png)";
+	m_parameters[m_outfilename].m_fileIsOutput = true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -71,7 +79,12 @@ string DSIFrameDecoder::GetProtocolName()
 vector<string> DSIFrameDecoder::GetHeaders()
 {
 	vector<string> ret;
-	ret.push_back("Width");
+	ret.push_back("Frame");
+	ret.push_back("Line");
+	ret.push_back("Format");
+	ret.push_back("Size");
+	ret.push_back("Period");
+	ret.push_back("ECC");
 	ret.push_back("Checksum");
 	return ret;
 }
@@ -81,12 +94,136 @@ bool DSIFrameDecoder::GetShowImageColumn()
 	return true;
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Pixel unpacking
+
+/**
+	@brief Gets the number of bits per pixel for a DSI packed pixel data type
+
+	@return Bits per pixel, or 0 if the type isn't a pixel format we can unpack
+ */
+size_t DSIFrameDecoder::GetBitsPerPixel(uint8_t type)
+{
+	switch(type)
+	{
+		case DSIPacketDecoder::TYPE_PACKED_PIXEL_RGB565:
+		case DSIPacketDecoder::TYPE_PACKED_PIXEL_YCBCR422_16:
+			return 16;
+
+		case DSIPacketDecoder::TYPE_PACKED_PIXEL_RGB666:
+			return 18;
+
+		case DSIPacketDecoder::TYPE_LOOSE_PIXEL_RGB666:
+		case DSIPacketDecoder::TYPE_PACKED_PIXEL_RGB888:
+			return 24;
+
+		default:
+			return 0;
+	}
+}
+
+/**
+	@brief Gets the number of whole pixels in a packed pixel payload
+
+	@param type		DSI data type
+	@param bytes	Payload length in bytes
+ */
+size_t DSIFrameDecoder::GetPixelCount(uint8_t type, size_t bytes)
+{
+	//YCbCr 4:2:2 pixels come in pairs sharing one set of chroma samples
+	if(type == DSIPacketDecoder::TYPE_PACKED_PIXEL_YCBCR422_16)
+		return (bytes / 4) * 2;
+
+	auto bpp = GetBitsPerPixel(type);
+	if(bpp == 0)
+		return 0;
+	return (bytes * 8) / bpp;
+}
+
+/**
+	@brief Converts packed pixel payload data to RGB888
+
+	All formats send red (or the first chroma sample) first, and pack bits LSB first.
+
+	@param type		DSI data type (must be one GetBitsPerPixel() accepts)
+	@param in		Payload bytes
+	@param npixels	Number of pixels to convert (from GetPixelCount())
+	@param rgb		Output buffer, 3 bytes per pixel
+ */
+void DSIFrameDecoder::UnpackPixels(uint8_t type, const uint8_t* in, size_t npixels, uint8_t* rgb)
+{
+	auto expand5 = [](uint32_t v) { return static_cast<uint8_t>( (v << 3) | (v >> 2) ); };
+	auto expand6 = [](uint32_t v) { return static_cast<uint8_t>( (v << 2) | (v >> 4) ); };
+
+	switch(type)
+	{
+		case DSIPacketDecoder::TYPE_PACKED_PIXEL_RGB888:
+			memcpy(rgb, in, npixels * 3);
+			break;
+
+		//R[4:0], G[5:0], B[4:0] in a little endian 16-bit word
+		case DSIPacketDecoder::TYPE_PACKED_PIXEL_RGB565:
+			for(size_t i=0; i<npixels; i++)
+			{
+				uint32_t v = in[i*2] | (in[i*2 + 1] << 8);
+				rgb[i*3]		= expand5(v & 0x1f);
+				rgb[i*3 + 1]	= expand6( (v >> 5) & 0x3f);
+				rgb[i*3 + 2]	= expand5(v >> 11);
+			}
+			break;
+
+		//18 bits per pixel, four pixels in nine bytes
+		case DSIPacketDecoder::TYPE_PACKED_PIXEL_RGB666:
+			for(size_t i=0; i<npixels; i++)
+			{
+				size_t bit = i*18;
+				const uint8_t* p = in + bit/8;
+				uint32_t v = (p[0] | (p[1] << 8) | (p[2] << 16)) >> (bit % 8);
+				rgb[i*3]		= expand6(v & 0x3f);
+				rgb[i*3 + 1]	= expand6( (v >> 6) & 0x3f);
+				rgb[i*3 + 2]	= expand6( (v >> 12) & 0x3f);
+			}
+			break;
+
+		//One byte per component, with the value in the upper six bits
+		case DSIPacketDecoder::TYPE_LOOSE_PIXEL_RGB666:
+			for(size_t i=0; i<npixels*3; i++)
+				rgb[i] = expand6(in[i] >> 2);
+			break;
+
+		//Cb, Y0, Cr, Y1 for each pair of pixels. Convert with BT.601 limited range coefficients
+		case DSIPacketDecoder::TYPE_PACKED_PIXEL_YCBCR422_16:
+			for(size_t i=0; i+1<npixels; i+=2)
+			{
+				const uint8_t* p = in + i*2;
+				auto sat = [](int v) { return static_cast<uint8_t>(min(max(v, 0), 255)); };
+				int cb = p[0] - 128;
+				int cr = p[2] - 128;
+				for(size_t j=0; j<2; j++)
+				{
+					int y = 298 * (p[1 + j*2] - 16);
+					uint8_t* out = rgb + (i + j)*3;
+					out[0] = sat( (y + 409*cr + 128) >> 8);
+					out[1] = sat( (y - 100*cb - 208*cr + 128) >> 8);
+					out[2] = sat( (y + 516*cb + 128) >> 8);
+				}
+			}
+			break;
+
+		default:
+			memset(rgb, 0, npixels * 3);
+			break;
+	}
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Actual decoder logic
 
 void DSIFrameDecoder::Refresh()
 {
 	ClearPackets();
+	m_frames.clear();
+	m_framePackets.clear();
 
 	if(!VerifyAllInputsOK())
 	{
@@ -103,26 +240,66 @@ void DSIFrameDecoder::Refresh()
 	cap->m_startFemtoseconds = din->m_startFemtoseconds;
 	cap->PrepareForCpuAccess();
 
+	//First pass: walk the packet stream serially, tracking sync events and finding the payload of each pixel packet.
+	//The output samples and image rows for each line are allocated here but filled in later.
 	enum
 	{
 		STATE_IDLE,
-		STATE_ID,
-		STATE_EXTEND_DATA,
-
-		STATE_RGB888_START,
-		STATE_RGB888_RED,
-		STATE_RGB888_GREEN,
-		STATE_RGB888_BLUE
+		STATE_HEADER,
+		STATE_PIXELS
 	} state = STATE_IDLE;
 
-	VideoScanlinePacket* pack = NULL;
+	vector<Scanline> lines;
+	size_t frameFirstLine = 0;
+	bool inFrame = false;
+
+	int64_t timescale = din->m_timescale;
+	int64_t hdrStart = 0;
+	int64_t hsyncStart = -1;
+	uint8_t type = 0;
+	size_t typeIndex = 0;
+	size_t lineTypeIndex = 0;
+	bool eccOK = true;
+	Scanline line;
+
+	auto openFrame = [&](int64_t start, bool vsync)
+	{
+		DSIVideoFrame frame;
+		frame.m_start = start * timescale;
+		frame.m_startedWithVsync = vsync;
+		m_frames.push_back(frame);
+
+		auto pack = new Packet;
+		pack->m_offset = start * timescale;
+		pack->m_len = 0;
+		m_packets.push_back(pack);
+		m_framePackets.push_back(pack);
+
+		frameFirstLine = lines.size();
+		inFrame = true;
+	};
+
+	auto closeFrame = [&](int64_t end, bool vsync)
+	{
+		auto& frame = m_frames.back();
+		frame.m_end = end * timescale;
+		frame.m_endedWithVsync = vsync;
+		inFrame = false;
+
+		//Blanking only, nothing to show
+		if(frameFirstLine == lines.size())
+		{
+			delete m_framePackets.back();
+			m_packets.pop_back();
+			m_framePackets.pop_back();
+			m_frames.pop_back();
+			return;
+		}
+
+		FinishFrame(frame, lines, frameFirstLine, timescale);
+	};
 
-	//Decode the actual data
 	size_t len = din->m_offsets.size();
-	int64_t tstart = 0;
-	uint8_t red = 0;
-	uint8_t green = 0;
-	uint8_t blue = 0;
 	for(size_t i=0; i<len; i++)
 	{
 		auto s = din->m_samples[i];
@@ -132,155 +309,311 @@ void DSIFrameDecoder::Refresh()
 		size_t nout = cap->m_offsets.size();
 		size_t last = nout - 1;
 
-		switch(state)
+		switch(s.m_stype)
 		{
-			//When we get a VC ID, that's the start of a new packet.
-			case STATE_IDLE:
-				break;
-
-			//Look at the packet type and figure out what to do with it
-			case STATE_ID:
-				if(s.m_stype == DSISymbol::TYPE_IDENTIFIER)
+			//Start of a new packet
+			case DSISymbol::TYPE_VC:
+				if(state == STATE_PIXELS)
 				{
-					//Ignore the rest of the packet by default
-					state = STATE_IDLE;
-
-					switch(s.m_data)
-					{
-						case DSIPacketDecoder::TYPE_VSYNC_START:
-							cap->m_offsets.push_back(tstart);
-							cap->m_durations.push_back(end - tstart);
-							cap->m_samples.push_back(DSIFrameSymbol(DSIFrameSymbol::TYPE_VSYNC));
-							break;
-
-						case DSIPacketDecoder::TYPE_HSYNC_START:
-							cap->m_offsets.push_back(tstart);
-							cap->m_durations.push_back(end - tstart);
-							cap->m_samples.push_back(DSIFrameSymbol(DSIFrameSymbol::TYPE_HSYNC));
-							break;
-
-						//Extend H/V sync packets
-						case DSIPacketDecoder::TYPE_HSYNC_END:
-							if( (nout > 0) && (cap->m_samples[last].m_type == DSIFrameSymbol::TYPE_HSYNC) )
-								state = STATE_EXTEND_DATA;
-							break;
-						case DSIPacketDecoder::TYPE_VSYNC_END:
-							if( (nout > 0) && (cap->m_samples[last].m_type == DSIFrameSymbol::TYPE_VSYNC) )
-								state = STATE_EXTEND_DATA;
-							break;
-
-						//Ignore most other types
-
-						//RGB is start of a video frame
-						//TODO: support other video formats
-						case DSIPacketDecoder::TYPE_PACKED_PIXEL_RGB888:
-							state = STATE_RGB888_START;
-							break;
-
-						default:
-							break;
-					}
+					if(!inFrame)
+						openFrame(line.m_start, false);
+					m_frames.back().m_truncatedLines ++;
 				}
-				else
-					state = STATE_IDLE;
+				hdrStart = off;
+				type = 0;
+				state = STATE_HEADER;
 				break;
 
-			//Extend the current sample to the end of this packet header
-			case STATE_EXTEND_DATA:
-				if(s.m_stype == DSISymbol::TYPE_DATA)
-				{}
-				else if( (s.m_stype == DSISymbol::TYPE_ECC_OK) || (s.m_stype == DSISymbol::TYPE_ECC_BAD) )
+			case DSISymbol::TYPE_IDENTIFIER:
+				if(state == STATE_HEADER)
 				{
-					cap->m_durations[last] = end - cap->m_offsets[last];
-					state = STATE_IDLE;
+					type = s.m_data & 0x3f;
+					typeIndex = i;
 				}
-				else
-					state = STATE_IDLE;
 				break;
 
-			//Decode video
-			case STATE_RGB888_START:
-				//Create packet
-				pack = new VideoScanlinePacket;
-				pack->m_offset = off * cap->m_timescale;
-				pack->m_headers["Checksum"] = "Not checked";
+			//ECC is the last byte of the header. Act on the packet type now that we've seen all of it
+			case DSISymbol::TYPE_ECC_OK:
+			case DSISymbol::TYPE_ECC_BAD:
+				if(state != STATE_HEADER)
+					break;
+				state = STATE_IDLE;
 
-			//fall through
-			case STATE_RGB888_RED:
-				if(s.m_stype == DSISymbol::TYPE_DATA)
+				eccOK = (s.m_stype == DSISymbol::TYPE_ECC_OK);
+				if(!eccOK)
 				{
-					tstart = off;
-					red = s.m_data;
-					state = STATE_RGB888_GREEN;
+					if(!inFrame)
+						openFrame(hdrStart, false);
+					m_frames.back().m_eccErrors ++;
 				}
-				else if(s.m_stype == DSISymbol::TYPE_CHECKSUM_OK)
-					pack->m_headers["Checksum"] = "OK";
-				else if(s.m_stype == DSISymbol::TYPE_CHECKSUM_BAD)
-					pack->m_headers["Checksum"] = "Error";
 
+				switch(type)
+				{
+					case DSIPacketDecoder::TYPE_VSYNC_START:
+						if(inFrame)
+							closeFrame(hdrStart, true);
+						openFrame(hdrStart, true);
+
+						cap->m_offsets.push_back(hdrStart);
+						cap->m_durations.push_back(end - hdrStart);
+						cap->m_samples.push_back(DSIFrameSymbol(DSIFrameSymbol::TYPE_VSYNC));
+						hsyncStart = -1;
+						break;
+
+					case DSIPacketDecoder::TYPE_HSYNC_START:
+						cap->m_offsets.push_back(hdrStart);
+						cap->m_durations.push_back(end - hdrStart);
+						cap->m_samples.push_back(DSIFrameSymbol(DSIFrameSymbol::TYPE_HSYNC));
+						hsyncStart = hdrStart;
+						break;
+
+					//Extend H/V sync symbols to the end of the matching sync end packet
+					case DSIPacketDecoder::TYPE_HSYNC_END:
+						if( (nout > 0) && (cap->m_samples[last].m_type == DSIFrameSymbol::TYPE_HSYNC) )
+							cap->m_durations[last] = end - cap->m_offsets[last];
+						break;
+					case DSIPacketDecoder::TYPE_VSYNC_END:
+						if( (nout > 0) && (cap->m_samples[last].m_type == DSIFrameSymbol::TYPE_VSYNC) )
+							cap->m_durations[last] = end - cap->m_offsets[last];
+						break;
+
+					case DSIPacketDecoder::TYPE_PACKED_PIXEL_RGB565:
+					case DSIPacketDecoder::TYPE_PACKED_PIXEL_RGB666:
+					case DSIPacketDecoder::TYPE_LOOSE_PIXEL_RGB666:
+					case DSIPacketDecoder::TYPE_PACKED_PIXEL_RGB888:
+					case DSIPacketDecoder::TYPE_LOOSE_PIXEL_YCBCR422_20:
+					case DSIPacketDecoder::TYPE_PACKED_PIXEL_YCBCR422_24:
+					case DSIPacketDecoder::TYPE_PACKED_PIXEL_YCBCR422_16:
+					case DSIPacketDecoder::TYPE_PACKED_PIXEL_RGB101010:
+					case DSIPacketDecoder::TYPE_PACKED_PIXEL_RGB121212:
+					case DSIPacketDecoder::TYPE_PACKED_PIXEL_YCBCR420_12:
+						state = STATE_PIXELS;
+						line.m_type = type;
+						line.m_start = (hsyncStart >= 0) ? hsyncStart : hdrStart;
+						line.m_firstByte = i + 1;
+						lineTypeIndex = typeIndex;
+						line.m_numBytes = 0;
+						hsyncStart = -1;
+						break;
+
+					//Ignore anything else
+					default:
+						break;
+				}
 				break;
 
-			case STATE_RGB888_GREEN:
-				if(s.m_stype == DSISymbol::TYPE_DATA)
+			//Payload bytes must be contiguous
+			case DSISymbol::TYPE_DATA:
+				if(state == STATE_PIXELS)
 				{
-					green = s.m_data;
-					state = STATE_RGB888_BLUE;
+					if(i == line.m_firstByte + line.m_numBytes)
+						line.m_numBytes ++;
 				}
 				break;
 
-			case STATE_RGB888_BLUE:
-				if(s.m_stype == DSISymbol::TYPE_DATA)
+			//End of a pixel packet
+			case DSISymbol::TYPE_CHECKSUM_OK:
+			case DSISymbol::TYPE_CHECKSUM_BAD:
+				if(state != STATE_PIXELS)
+					break;
+				state = STATE_IDLE;
+
 				{
-					blue = s.m_data;
+					if(!inFrame)
+						openFrame(line.m_start, false);
+					auto& frame = m_frames.back();
 
-					pack->m_data.push_back(red);
-					pack->m_data.push_back(green);
-					pack->m_data.push_back(blue);
-					pack->m_len = (end * cap->m_timescale) - pack->m_offset;
+					bool checksumOK = (s.m_stype == DSISymbol::TYPE_CHECKSUM_OK);
+					if(!checksumOK)
+						frame.m_checksumErrors ++;
 
-					pack->m_headers["Width"] = to_string(pack->m_data.size() / 3);
+					line.m_numPixels = GetPixelCount(line.m_type, line.m_numBytes);
+					if(line.m_numPixels == 0)
+					{
+						if(GetBitsPerPixel(line.m_type) == 0)
+							frame.m_unsupportedLines ++;
+						break;
+					}
 
-					cap->m_offsets.push_back(tstart);
-					cap->m_durations.push_back(end - tstart);
-					cap->m_samples.push_back(DSIFrameSymbol(
-						DSIFrameSymbol::TYPE_VIDEO, red, green, blue));
+					line.m_frame = m_frames.size() - 1;
+					line.m_row = lines.size() - frameFirstLine;
+					line.m_firstSample = cap->m_offsets.size();
+					cap->Resize(line.m_firstSample + line.m_numPixels);
+
+					auto pack = new VideoScanlinePacket;
+					pack->m_offset = hdrStart * timescale;
+					pack->m_len = (end - hdrStart) * timescale;
+					pack->m_data.resize(line.m_numPixels * 3);
+					pack->m_headers["Frame"] = to_string(line.m_frame);
+					pack->m_headers["Line"] = to_string(line.m_row);
+					pack->m_headers["Format"] = din->GetText(lineTypeIndex);
+					pack->m_headers["Size"] = to_string(line.m_numPixels);
+					pack->m_headers["ECC"] = eccOK ? "OK" : "Error";
+					pack->m_headers["Checksum"] = checksumOK ? "OK" : "Error";
+					if(!eccOK || !checksumOK)
+						pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_ERROR];
+					m_packets.push_back(pack);
 
-					state = STATE_RGB888_RED;
+					line.m_packet = pack;
+					lines.push_back(line);
 				}
 				break;
-		}
 
-		//Always start a new packet when we see a VC ID
-		if(s.m_stype == DSISymbol::TYPE_VC)
-		{
-			tstart = off;
-			state = STATE_ID;
+			//Protocol error: whatever packet we were in is lost
+			case DSISymbol::TYPE_ERROR:
+				if(state == STATE_PIXELS)
+				{
+					if(!inFrame)
+						openFrame(line.m_start, false);
+					m_frames.back().m_truncatedLines ++;
+				}
+				state = STATE_IDLE;
+				break;
 
-			//End the current packet
-			if(pack)
-			{
-				if(pack->m_data.size() != 0)
-					m_packets.push_back(pack);
-				else
-					delete pack;
-				pack = NULL;
-			}
+			default:
+				break;
 		}
 	}
 
-	//End the current packet
-	if(pack)
+	if(inFrame)
 	{
-		if(pack->m_data.size() != 0)
-			m_packets.push_back(pack);
-		else
-			delete pack;
-		pack = NULL;
+		if(state == STATE_PIXELS)
+			m_frames.back().m_truncatedLines ++;
+		closeFrame(len ? (din->m_offsets[len-1] + din->m_durations[len-1]) : 0, false);
 	}
 
+	//Second pass: unpack every line into its frame, its packet, and the output waveform
+	ThreadPool::GetDefault().ParallelFor(0, lines.size(), [&](size_t i)
+	{
+		auto& l = lines[i];
+		auto row = m_frames[l.m_frame].GetRow(l.m_row);
+
+		vector<uint8_t> bytes(l.m_numBytes);
+		for(size_t j=0; j<l.m_numBytes; j++)
+			bytes[j] = din->m_samples[l.m_firstByte + j].m_data;
+		UnpackPixels(l.m_type, bytes.data(), l.m_numPixels, row);
+		memcpy(l.m_packet->m_data.data(), row, l.m_numPixels * 3);
+
+		//Each pixel spans the payload bytes holding any of its bits
+		size_t bpp = GetBitsPerPixel(l.m_type);
+		for(size_t k=0; k<l.m_numPixels; k++)
+		{
+			size_t first = l.m_firstByte + (k * bpp) / 8;
+			size_t last = l.m_firstByte + ((k+1) * bpp - 1) / 8;
+			size_t n = l.m_firstSample + k;
+
+			cap->m_offsets[n] = din->m_offsets[first];
+			cap->m_durations[n] = din->m_offsets[last] + din->m_durations[last] - din->m_offsets[first];
+			cap->m_samples[n] = DSIFrameSymbol(DSIFrameSymbol::TYPE_VIDEO, row[k*3], row[k*3 + 1], row[k*3 + 2]);
+		}
+	});
+
 	SetData(cap, 0);
 
 	cap->MarkModifiedFromCpu();
+
+	ExportFrames();
+}
+
+/**
+	@brief Sizes a frame once all of its lines are known, and calculates its statistics
+
+	@param frame		The frame
+	@param lines		All lines found so far
+	@param firstLine	Index of the frame's first line
+	@param timescale	Input timebase
+ */
+void DSIFrameDecoder::FinishFrame(
+	DSIVideoFrame& frame,
+	const vector<Scanline>& lines,
+	size_t firstLine,
+	int64_t timescale)
+{
+	size_t height = lines.size() - firstLine;
+	size_t width = 0;
+	for(size_t i=firstLine; i<lines.size(); i++)
+		width = max(width, lines[i].m_numPixels);
+	frame.Resize(width, height);
+
+	for(size_t i=firstLine; i<lines.size(); i++)
+	{
+		if(lines[i].m_numPixels < width)
+			frame.m_shortLines ++;
+	}
+
+	if(frame.IsComplete())
+		frame.m_framePeriod = frame.m_end - frame.m_start;
+	frame.m_format = lines[firstLine].m_packet->GetHeader("Format");
+
+	//Line timing
+	Unit fs(Unit::UNIT_FS);
+	if(height > 1)
+	{
+		frame.m_minLinePeriod = INT64_MAX;
+		frame.m_maxLinePeriod = 0;
+		for(size_t i=firstLine+1; i<lines.size(); i++)
+		{
+			int64_t period = (lines[i].m_start - lines[i-1].m_start) * timescale;
+			frame.m_minLinePeriod = min(frame.m_minLinePeriod, period);
+			frame.m_maxLinePeriod = max(frame.m_maxLinePeriod, period);
+			lines[i].m_packet->m_headers["Period"] = fs.PrettyPrint(period);
+		}
+		frame.m_meanLinePeriod =
+			(lines[lines.size()-1].m_start - lines[firstLine].m_start) * timescale / static_cast<int64_t>(height - 1);
+	}
+
+	//Summary row
+	auto pack = m_framePackets.back();
+	size_t errors = frame.m_eccErrors + frame.m_checksumErrors + frame.m_truncatedLines;
+	pack->m_len = frame.m_end - frame.m_start;
+	pack->m_headers["Frame"] = to_string(m_frames.size() - 1);
+	pack->m_headers["Format"] = frame.m_format;
+	pack->m_headers["Size"] = to_string(width) + "x" + to_string(height);
+	pack->m_headers["Period"] = frame.IsComplete() ? fs.PrettyPrint(frame.m_framePeriod) : "Incomplete";
+	pack->m_headers["ECC"] = frame.m_eccErrors ? (to_string(frame.m_eccErrors) + " errors") : "OK";
+	pack->m_headers["Checksum"] = frame.m_checksumErrors ? (to_string(frame.m_checksumErrors) + " errors") : "OK";
+	if(errors)
+		pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_ERROR];
+	else
+		pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_STATUS];
+}
+
+/**
+	@brief Saves every decoded frame to the output file, if one is set
+ */
+void DSIFrameDecoder::ExportFrames()
+{
+	auto fname = m_parameters[m_outfilename].GetFileName();
+	if(fname.empty() || m_frames.empty())
+		return;
+
+	//Split off the extension so we can number the frames
+	string base = fname;
+	string ext;
+	auto dot = fname.rfind('.');
+	auto slash = fname.find_last_of("/\\");
+	if( (dot != string::npos) && ( (slash == string::npos) || (dot > slash) ) )
+	{
+		base = fname.substr(0, dot);
+		ext = fname.substr(dot);
+	}
+	bool png = (ext == ".png") || (ext == ".PNG");
+
+	for(size_t i=0; i<m_frames.size(); i++)
+	{
+		string path = fname;
+		if(m_frames.size() > 1)
+		{
+			char tmp[32];
+			snprintf(tmp, sizeof(tmp), "_%04zu", i);
+			path = base + tmp + ext;
+		}
+
+		if(png)
+			m_frames[i].ExportPNG(path);
+		else
+			m_frames[i].ExportRaw(path);
+	}
 }
 
 string DSIFrameWaveform::GetColor(size_t i)
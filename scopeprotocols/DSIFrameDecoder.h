@@ -37,6 +37,7 @@
 #define DSIFrameDecoder_h
 
 #include "DVIDecoder.h"
+#include "VideoFrame.h"
 
 class DSIFrameSymbol
 {
@@ -79,6 +80,76 @@ public:
 	virtual std::string GetColor(size_t) override;
 };
 
+/**
+	@brief A video frame reassembled from DSI packed pixel packets, with integrity and timing statistics
+
+	All times are in femtoseconds from the start of the waveform.
+ */
+class DSIVideoFrame : public VideoFrame
+{
+public:
+	DSIVideoFrame()
+	 : m_start(0)
+	 , m_end(0)
+	 , m_startedWithVsync(false)
+	 , m_endedWithVsync(false)
+	 , m_framePeriod(0)
+	 , m_minLinePeriod(0)
+	 , m_maxLinePeriod(0)
+	 , m_meanLinePeriod(0)
+	 , m_eccErrors(0)
+	 , m_checksumErrors(0)
+	 , m_truncatedLines(0)
+	 , m_unsupportedLines(0)
+	 , m_shortLines(0)
+	{}
+
+	///@brief True if the capture contains the VSYNC at both the start and end of the frame
+	bool IsComplete() const
+	{ return m_startedWithVsync && m_endedWithVsync; }
+
+	///@brief Start of the frame (VSYNC, or first line if the capture began mid-frame)
+	int64_t m_start;
+
+	///@brief End of the frame (next VSYNC, or end of the last line)
+	int64_t m_end;
+
+	bool m_startedWithVsync;
+	bool m_endedWithVsync;
+
+	///@brief VSYNC to VSYNC time, or 0 if the frame is incomplete
+	int64_t m_framePeriod;
+
+	///@brief Statistics of the time between the starts of consecutive active lines, or 0 if fewer than two lines
+	int64_t m_minLinePeriod;
+	int64_t m_maxLinePeriod;
+	int64_t m_meanLinePeriod;
+
+	///@brief Pixel format of the first line
+	std::string m_format;
+
+	///@brief Number of packet headers in the frame with a bad ECC
+	size_t m_eccErrors;
+
+	///@brief Number of pixel packets in the frame with a bad checksum
+	size_t m_checksumErrors;
+
+	///@brief Number of pixel packets cut short by a protocol error
+	size_t m_truncatedLines;
+
+	///@brief Number of pixel packets in a format we can't unpack
+	size_t m_unsupportedLines;
+
+	///@brief Number of lines narrower than the frame (padded with black)
+	size_t m_shortLines;
+};
+
+/**
+	@brief Reassembles MIPI DSI video mode packets into frames
+
+	Frames are delimited by VSYNC Start packets, and each packed pixel packet becomes one line. Lines are unpacked in
+	parallel. Supported pixel formats are RGB565, RGB666 (packed and loosely packed), RGB888, and 16-bit YCbCr 4:2:2.
+ */
 class DSIFrameDecoder : public PacketDecoder
 {
 public:
@@ -94,9 +165,52 @@ public:
 
 	virtual bool ValidateChannel(size_t i, StreamDescriptor stream) override;
 
+	///@brief Frames decoded by the most recent refresh
+	const std::vector<DSIVideoFrame>& GetFrames() const
+	{ return m_frames; }
+
+	static size_t GetBitsPerPixel(uint8_t type);
+	static size_t GetPixelCount(uint8_t type, size_t bytes);
+	static void UnpackPixels(uint8_t type, const uint8_t* in, size_t npixels, uint8_t* rgb);
+
 	PROTOCOL_DECODER_INITPROC(DSIFrameDecoder)
 
 protected:
+
+	///@brief A packed pixel packet found by the first pass over the input, to be unpacked as one line of a frame
+	struct Scanline
+	{
+		///@brief DSI data type
+		uint8_t m_type;
+
+		///@brief Index of the frame in m_frames, and row within it
+		size_t m_frame;
+		size_t m_row;
+
+		///@brief Start of the line (HSYNC if one was seen, otherwise the packet header), in input timebase units
+		int64_t m_start;
+
+		///@brief Index of the first payload byte in the input waveform, and number of payload bytes
+		size_t m_firstByte;
+		size_t m_numBytes;
+
+		///@brief Index of the first pixel in the output waveform, and number of pixels
+		size_t m_firstSample;
+		size_t m_numPixels;
+
+		///@brief Packet table entry for the line
+		VideoScanlinePacket* m_packet;
+	};
+
+	void FinishFrame(DSIVideoFrame& frame, const std::vector<Scanline>& lines, size_t firstLine, int64_t timescale);
+	void ExportFrames();
+
+	std::string m_outfilename;
+
+	std::vector<DSIVideoFrame> m_frames;
+
+	///@brief Summary row in the packet table for each frame
+	std::vector<Packet*> m_framePackets;
 };
 
 #endif
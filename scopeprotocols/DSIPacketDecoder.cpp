@@ -158,6 +158,12 @@ void DSIPacketDecoder::Refresh()
 						case TYPE_PACKED_PIXEL_RGB666:
 						case TYPE_LOOSE_PIXEL_RGB666:
 						case TYPE_PACKED_PIXEL_RGB888:
+						case TYPE_LOOSE_PIXEL_YCBCR422_20:
+						case TYPE_PACKED_PIXEL_YCBCR422_24:
+						case TYPE_PACKED_PIXEL_YCBCR422_16:
+						case TYPE_PACKED_PIXEL_RGB101010:
+						case TYPE_PACKED_PIXEL_RGB121212:
+						case TYPE_PACKED_PIXEL_YCBCR420_12:
 							state = STATE_LONG_LEN_LO;
 							cap->m_offsets.push_back(off + halfdur);
 							cap->m_durations.push_back(dur - halfdur);
@@ -238,6 +244,12 @@ void DSIPacketDecoder::Refresh()
 						case TYPE_PACKED_PIXEL_RGB666:
 						case TYPE_LOOSE_PIXEL_RGB666:
 						case TYPE_PACKED_PIXEL_RGB888:
+						case TYPE_LOOSE_PIXEL_YCBCR422_20:
+						case TYPE_PACKED_PIXEL_YCBCR422_24:
+						case TYPE_PACKED_PIXEL_YCBCR422_16:
+						case TYPE_PACKED_PIXEL_RGB101010:
+						case TYPE_PACKED_PIXEL_RGB121212:
+						case TYPE_PACKED_PIXEL_YCBCR420_12:
 						case TYPE_GENERIC_SHORT_WRITE_0PARAM:
 						case TYPE_GENERIC_SHORT_WRITE_1PARAM:
 						case TYPE_GENERIC_SHORT_WRITE_2PARAM:
@@ -317,15 +329,16 @@ void DSIPacketDecoder::Refresh()
 					cap->m_offsets.push_back(off);
 					cap->m_durations.push_back(dur);
 
-					uint8_t ecc_in[3] =
+					//ECC covers the data identifier and the two bytes after it
+					//(word count for long packets, payload for short packets)
+					uint8_t ecc = ComputeECC((current_vc << 6) | current_type, current_len & 0xff, current_len >> 8);
+					if(ecc == (s.m_data & 0x3f))
+						cap->m_samples.push_back(DSISymbol(DSISymbol::TYPE_ECC_OK, s.m_data));
+					else
 					{
-						static_cast<uint8_t>((current_vc << 6) | current_type),
-						static_cast<uint8_t>(current_len & 0xff),
-						static_cast<uint8_t>(current_len >> 8)
-					};
-					//TODO: compute ecc value and check
-
-					cap->m_samples.push_back(DSISymbol(DSISymbol::TYPE_ECC_OK, s.m_data));
+						cap->m_samples.push_back(DSISymbol(DSISymbol::TYPE_ECC_BAD, s.m_data));
+						pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_ERROR];
+					}
 
 					//If the packet had no content, jump right to the checksum
 					expected_checksum = 0xffff;
@@ -430,6 +443,7 @@ void DSIPacketDecoder::Refresh()
 					cap->m_samples.push_back(DSISymbol(DSISymbol::TYPE_DATA, s.m_data));
 
 					pack->m_data.push_back(s.m_data);
+					current_len = s.m_data;
 
 					state = STATE_SHORT_DATA_1;
 				}
@@ -450,6 +464,7 @@ void DSIPacketDecoder::Refresh()
 					cap->m_samples.push_back(DSISymbol(DSISymbol::TYPE_DATA, s.m_data));
 
 					pack->m_data.push_back(s.m_data);
+					current_len |= (s.m_data << 8);
 
 					state = STATE_SHORT_ECC;
 				}
@@ -469,15 +484,16 @@ void DSIPacketDecoder::Refresh()
 					cap->m_offsets.push_back(off);
 					cap->m_durations.push_back(dur);
 
-					uint8_t ecc_in[3] =
+					//ECC covers the data identifier and the two bytes after it
+					//(word count for long packets, payload for short packets)
+					uint8_t ecc = ComputeECC((current_vc << 6) | current_type, current_len & 0xff, current_len >> 8);
+					if(ecc == (s.m_data & 0x3f))
+						cap->m_samples.push_back(DSISymbol(DSISymbol::TYPE_ECC_OK, s.m_data));
+					else
 					{
-						static_cast<uint8_t>((current_vc << 6) | current_type),
-						static_cast<uint8_t>(current_len & 0xff),
-						static_cast<uint8_t>(current_len >> 8)
-					};
-					//TODO: compute ecc value and check
-
-					cap->m_samples.push_back(DSISymbol(DSISymbol::TYPE_ECC_OK, s.m_data));
+						cap->m_samples.push_back(DSISymbol(DSISymbol::TYPE_ECC_BAD, s.m_data));
+						pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_ERROR];
+					}
 
 					//Done
 					state = STATE_HEADER;
@@ -581,6 +597,12 @@ string DSIWaveform::GetText(size_t i)
 				case DSIPacketDecoder::TYPE_PACKED_PIXEL_RGB666:	return "RGB666";
 				case DSIPacketDecoder::TYPE_LOOSE_PIXEL_RGB666:		return "RGB666 Loose";
 				case DSIPacketDecoder::TYPE_PACKED_PIXEL_RGB888:	return "RGB888";
+				case DSIPacketDecoder::TYPE_LOOSE_PIXEL_YCBCR422_20:	return "YCbCr422 20b Loose";
+				case DSIPacketDecoder::TYPE_PACKED_PIXEL_YCBCR422_24:	return "YCbCr422 24b";
+				case DSIPacketDecoder::TYPE_PACKED_PIXEL_YCBCR422_16:	return "YCbCr422 16b";
+				case DSIPacketDecoder::TYPE_PACKED_PIXEL_RGB101010:		return "RGB101010";
+				case DSIPacketDecoder::TYPE_PACKED_PIXEL_RGB121212:		return "RGB121212";
+				case DSIPacketDecoder::TYPE_PACKED_PIXEL_YCBCR420_12:	return "YCbCr420 12b";
 
 				default:
 					snprintf(tmp, sizeof(tmp), "RSVD %02x", s.m_data & 0x3f);
@@ -612,6 +634,36 @@ string DSIWaveform::GetText(size_t i)
 	}
 }
 
+/**
+	@brief Calculates the 6-bit Hamming code protecting a packet header
+
+	@param id	Data identifier (virtual channel and type)
+	@param b0	First byte after the identifier (word count LSB, or first short packet data byte)
+	@param b1	Second byte after the identifier (word count MSB, or second short packet data byte)
+ */
+uint8_t DSIPacketDecoder::ComputeECC(uint8_t id, uint8_t b0, uint8_t b1)
+{
+	//Bits of the 24-bit header which are covered by each parity bit
+	static const uint32_t masks[6] =
+	{
+		0xf12cb7,
+		0xf2555b,
+		0x749a6d,
+		0xb8e38e,
+		0xdf03f0,
+		0xeffc00
+	};
+
+	uint32_t header = id | (b0 << 8) | (b1 << 16);
+	uint8_t ecc = 0;
+	for(int i=0; i<6; i++)
+	{
+		if(__builtin_parity(header & masks[i]))
+			ecc |= (1 << i);
+	}
+	return ecc;
+}
+
 uint16_t DSIPacketDecoder::UpdateCRC(uint16_t crc, uint8_t data)
 {
 	//CRC16 with polynomial x^16 + x^12 + x^5 + x^0 (CRC-16-CCITT)
@@ -636,24 +688,39 @@ vector<string> DSIPacketDecoder::GetHeaders()
 	return ret;
 }
 
+/**
+	@brief Checks if a packet type (as shown in the "Type" column) carries video pixel data
+ */
+bool DSIPacketDecoder::IsPixelStreamType(const string& type)
+{
+	return
+		(type == "RGB888") ||
+		(type == "RGB666") ||
+		(type == "RGB666 Loose") ||
+		(type == "RGB565") ||
+		(type == "YCbCr422 20b Loose") ||
+		(type == "YCbCr422 24b") ||
+		(type == "YCbCr422 16b") ||
+		(type == "RGB101010") ||
+		(type == "RGB121212") ||
+		(type == "YCbCr420 12b");
+}
+
 bool DSIPacketDecoder::CanMerge(Packet* first, Packet* /*cur*/, Packet* next)
 {
 	//If packets are from different VCs we can't merge them
-	if(first->m_headers["VC"] != next->m_headers["VC"])
+	if(first->GetHeader("VC") != next->GetHeader("VC"))
 		return false;
 
 	//Merge consecutive null packets
-	if( (first->m_headers["Type"] == "Null") && (next->m_headers["Type"] == "Null") )
+	if( (first->GetHeader("Type") == "Null") && (next->GetHeader("Type") == "Null") )
 		return true;
 
 	//Can merge EoTX or null after a video data packet
-	if( (first->m_headers["Type"] == "RGB888") ||
-		(first->m_headers["Type"] == "RGB666") ||
-		(first->m_headers["Type"] == "RGB666 Loose") ||
-		(first->m_headers["Type"] == "RGB565"))
+	if(IsPixelStreamType(first->GetHeader("Type")))
 	{
-		if(	(next->m_headers["Type"] == "End of TX") ||
-			(next->m_headers["Type"] == "Null") )
+		if(	(next->GetHeader("Type") == "End of TX") ||
+			(next->GetHeader("Type") == "Null") )
 		{
 			return true;
 		}
@@ -661,20 +728,20 @@ bool DSIPacketDecoder::CanMerge(Packet* first, Packet* /*cur*/, Packet* next)
 
 	//Merge H/VSYNC start and end.
 	//Also allow merging null/EoTX after them
-	if( (first->m_headers["Type"] == "HSYNC Start") )
+	if( (first->GetHeader("Type") == "HSYNC Start") )
 	{
-		if( (next->m_headers["Type"] == "HSYNC End") ||
-			(next->m_headers["Type"] == "End of TX") ||
-			(next->m_headers["Type"] == "Null") )
+		if( (next->GetHeader("Type") == "HSYNC End") ||
+			(next->GetHeader("Type") == "End of TX") ||
+			(next->GetHeader("Type") == "Null") )
 		{
 			return true;
 		}
 	}
-	if( (first->m_headers["Type"] == "VSYNC Start") )
+	if( (first->GetHeader("Type") == "VSYNC Start") )
 	{
-		if( (next->m_headers["Type"] == "VSYNC End") ||
-			(next->m_headers["Type"] == "End of TX") ||
-			(next->m_headers["Type"] == "Null") )
+		if( (next->GetHeader("Type") == "VSYNC End") ||
+			(next->GetHeader("Type") == "End of TX") ||
+			(next->GetHeader("Type") == "Null") )
 		{
 			return true;
 		}
@@ -689,31 +756,28 @@ Packet* DSIPacketDecoder::CreateMergedHeader(Packet* pack, size_t /*i*/)
 	Packet* ret = new Packet;
 	ret->m_offset = pack->m_offset;
 	ret->m_len = pack->m_len;
-	ret->m_headers["VC"] = pack->m_headers["VC"];
+	ret->m_headers["VC"] = pack->GetHeader("VC");
 
-	if( (pack->m_headers["Type"] == "RGB888") ||
-		(pack->m_headers["Type"] == "RGB666") ||
-		(pack->m_headers["Type"] == "RGB666 Loose") ||
-		(pack->m_headers["Type"] == "RGB565"))
+	if(IsPixelStreamType(pack->GetHeader("Type")))
 	{
-		ret->m_headers["Type"] = pack->m_headers["Type"];
-		ret->m_headers["Length"] = pack->m_headers["Length"];
+		ret->m_headers["Type"] = pack->GetHeader("Type");
+		ret->m_headers["Length"] = pack->GetHeader("Length");
 		ret->m_data = pack->m_data;
 		ret->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_DATA_WRITE];
 	}
 
-	if(pack->m_headers["Type"] == "VSYNC Start")
+	if(pack->GetHeader("Type") == "VSYNC Start")
 	{
 		ret->m_headers["Type"] = "VSYNC";
 		ret->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_COMMAND];
 	}
-	if(pack->m_headers["Type"] == "HSYNC Start")
+	if(pack->GetHeader("Type") == "HSYNC Start")
 	{
 		ret->m_headers["Type"] = "HSYNC";
 		ret->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_COMMAND];
 	}
 
-	else if(pack->m_headers["Type"] == "Null")
+	else if(pack->GetHeader("Type") == "Null")
 	{
 		ret->m_headers["Type"] = "Padding";
 		ret->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_DEFAULT];
@@ -126,11 +126,20 @@ public:
 		TYPE_PACKED_PIXEL_RGB565		= 0x0e,
 		TYPE_PACKED_PIXEL_RGB666		= 0x1e,
 		TYPE_LOOSE_PIXEL_RGB666			= 0x2e,
-		TYPE_PACKED_PIXEL_RGB888		= 0x3e
+		TYPE_PACKED_PIXEL_RGB888		= 0x3e,
+		TYPE_LOOSE_PIXEL_YCBCR422_20	= 0x0c,
+		TYPE_PACKED_PIXEL_YCBCR422_24	= 0x1c,
+		TYPE_PACKED_PIXEL_YCBCR422_16	= 0x2c,
+		TYPE_PACKED_PIXEL_RGB101010		= 0x0d,
+		TYPE_PACKED_PIXEL_RGB121212		= 0x1d,
+		TYPE_PACKED_PIXEL_YCBCR420_12	= 0x3d
 	};
 
+	static uint8_t ComputeECC(uint8_t id, uint8_t b0, uint8_t b1);
+	static uint16_t UpdateCRC(uint16_t crc, uint8_t data);
+	static bool IsPixelStreamType(const std::string& type);
+
 protected:
-	uint16_t UpdateCRC(uint16_t crc, uint8_t data);
 
 public:
 	PROTOCOL_DECODER_INITPROC(DSIPacketDecoder)
@@ -50,6 +50,7 @@ VideoScanlinePacket::~VideoScanlinePacket()
 
 DVIDecoder::DVIDecoder(const string& color)
 	: PacketDecoder(color, CAT_SERIAL)
+	, m_stats{}
 {
 	//Set up channels
 	CreateInput("D0 (blue)");
@@ -81,6 +82,7 @@ vector<string> DVIDecoder::GetHeaders()
 	vector<string> ret;
 	ret.push_back("Type");
 	ret.push_back("Width");
+	ret.push_back("Height");
 	return ret;
 }
 
@@ -89,12 +91,64 @@ bool DVIDecoder::GetShowImageColumn()
 	return true;
 }
 
+/**
+	@brief Gets a human readable name for an HDMI data island packet type (HDMI 1.4 spec table 5-8 and CEA-861)
+ */
+string DVIDecoder::GetDataIslandPacketName(uint8_t type)
+{
+	switch(type)
+	{
+		case 0x00:	return "Null";
+		case 0x01:	return "Audio Clock Regen";
+		case 0x02:	return "Audio Sample";
+		case 0x03:	return "General Control";
+		case 0x04:	return "ACP";
+		case 0x05:	return "ISRC1";
+		case 0x06:	return "ISRC2";
+		case 0x07:	return "One Bit Audio";
+		case 0x08:	return "DST Audio";
+		case 0x09:	return "HBR Audio";
+		case 0x0a:	return "Gamut Metadata";
+		case 0x81:	return "Vendor InfoFrame";
+		case 0x82:	return "AVI InfoFrame";
+		case 0x83:	return "SPD InfoFrame";
+		case 0x84:	return "Audio InfoFrame";
+		case 0x85:	return "MPEG InfoFrame";
+		default:
+			if(type & 0x80)
+				return "InfoFrame";
+			return "Unknown";
+	}
+}
+
+/**
+	@brief Calculates the BCH ECC byte for a data island packet header or subpacket (HDMI 1.4 spec 5.2.3.5)
+
+	Generator polynomial is 1 + x^6 + x^7 + x^8, bits are processed LSB first.
+ */
+uint8_t DVIDecoder::ComputeBCH(const uint8_t* data, size_t len)
+{
+	uint8_t ecc = 0;
+	for(size_t i=0; i<len; i++)
+	{
+		for(int j=0; j<8; j++)
+		{
+			bool feedback = ( (data[i] >> j) ^ ecc) & 1;
+			ecc >>= 1;
+			if(feedback)
+				ecc ^= 0x83;
+		}
+	}
+	return ecc;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Actual decoder logic
 
 void DVIDecoder::Refresh()
 {
 	ClearPackets();
+	m_stats = TimingStatistics{};
 
 	if(!VerifyAllInputsOK())
 	{
@@ -127,6 +181,64 @@ void DVIDecoder::Refresh()
 	VideoScanlinePacket* current_packet = NULL;
 	int current_pixels = 0;
 
+	//Data island packet being assembled (HDMI 1.4 spec 5.2.3.4)
+	bool in_island = false;
+	size_t island_pos = 0;
+	int64_t island_start = 0;
+	bool island_symbol_error = false;
+	uint8_t header[4] = {0};
+	uint8_t subpackets[4][8] = {{0}};
+
+	//Sync state and timing measurement, in pixel clocks (one TMDS character each)
+	bool hsync = false;
+	bool vsync = false;
+	bool last_hsync = false;
+	bool last_vsync = false;
+	bool have_hsync = false;
+	bool have_vsync = false;
+	size_t hsync_rise = 0;
+	int64_t hsync_rise_time = 0;
+	int64_t vsync_rise_time = 0;
+	size_t lines_in_frame = 0;
+	size_t active_lines_in_frame = 0;
+
+	//Find the nearest control-to-non-control transition in another lane, to compensate for lane-to-lane skew
+	auto align = [](TMDSWaveform* lane, size_t& index)
+	{
+		size_t size = lane->m_samples.size();
+		for(ssize_t delta=0; delta <= 50; delta ++)
+		{
+			for(ssize_t sign = 1; sign >= -1; sign -= 2)
+			{
+				ssize_t n = index + delta*sign;
+				if( (n < 1) || (n >= (ssize_t)size) )
+					continue;
+				if(lane->m_samples[n-1].m_type != TMDSSymbol::TMDS_TYPE_CONTROL)
+					continue;
+				if(lane->m_samples[n].m_type == TMDSSymbol::TMDS_TYPE_CONTROL)
+					continue;
+
+				index = n;
+				return;
+			}
+		}
+	};
+
+	//Add a symbol, or extend the previous one if it's identical
+	auto emit = [&](const DVISymbol& sym, bool merge)
+	{
+		size_t n = cap->m_samples.size();
+		int64_t end = dblue->m_offsets[iblue] + dblue->m_durations[iblue];
+		if(merge && (n > 0) && (cap->m_samples[n-1] == sym) )
+			cap->m_durations[n-1] = end - cap->m_offsets[n-1];
+		else
+		{
+			cap->m_offsets.push_back(dblue->m_offsets[iblue]);
+			cap->m_durations.push_back(dblue->m_durations[iblue]);
+			cap->m_samples.push_back(sym);
+		}
+	};
+
 	//Decode the actual data
 	size_t bsize = dblue->m_offsets.size();
 	size_t wgsize = dgreen->m_offsets.size();
@@ -135,113 +247,199 @@ void DVIDecoder::Refresh()
 	{
 		auto sblue = dblue->m_samples[iblue];
 
+		//If the LAST sample was a control symbol, re-synchronize the three lanes
+		//to compensate for lane-to-lane clock skew.
+		//Should only be needed at the start of the capture, but can't hurt to re-do it in case of some
+		//weird clock domain crossing issues in the transmitter causing idle insertion/removal.
+		if( (last_type == TMDSSymbol::TMDS_TYPE_CONTROL) && (sblue.m_type != TMDSSymbol::TMDS_TYPE_CONTROL) )
+		{
+			align(dgreen, igreen);
+			align(dred, ired);
+		}
+		auto sgreen = dgreen->m_samples[igreen];
+		auto sred = dred->m_samples[ired];
+
+		//Close out the scanline when video ends
+		if( (sblue.m_type != TMDSSymbol::TMDS_TYPE_DATA) && (current_packet != NULL) )
+		{
+			current_packet->m_len = dblue->m_offsets[iblue] - current_packet->m_offset;
+			current_packet->m_headers["Width"] = to_string(current_pixels);
+			m_packets.push_back(current_packet);
+
+			m_stats.m_activeWidth = current_pixels;
+			active_lines_in_frame ++;
+
+			current_pixels = 0;
+			current_packet = NULL;
+		}
+
 		//Control code in master channel? Decode it
 		if(sblue.m_type == TMDSSymbol::TMDS_TYPE_CONTROL)
 		{
-			//If the last sample was data, save the packet for the scanline or data island
-			if( (last_type == TMDSSymbol::TMDS_TYPE_DATA) && (current_packet != NULL) )
-			{
-				current_packet->m_len = dblue->m_offsets[iblue] + dblue->m_durations[iblue] - current_packet->m_offset;
-				char tmp[32];
-				snprintf(tmp, sizeof(tmp), "%d", current_pixels);
-				current_packet->m_headers["Width"] = tmp;
-				m_packets.push_back(current_packet);
-
-				current_pixels = 0;
-				current_packet = NULL;
-			}
+			//Any partial data island packet is lost
+			in_island = false;
+			island_pos = 0;
 
 			//Extract synchronization signals from blue channel
 			//Red/green have status signals that aren't used in DVI.
-			bool hsync = (sblue.m_data & 1) ? true : false;
-			bool vsync = (sblue.m_data & 2) ? true : false;
+			hsync = (sblue.m_data & 1) ? true : false;
+			vsync = (sblue.m_data & 2) ? true : false;
 
 			//If this symbol matches the previous one, just extend it
 			//rather than creating a new symbol
-			size_t last = cap->m_durations.size()-1;
-			if( (cap->m_samples.size() > 0) && (dblue->m_samples[iblue-1] == sblue) )
-				cap->m_durations[last] = dblue->m_offsets[iblue] + dblue->m_durations[iblue] - cap->m_offsets[last];
+			if( (iblue > 0) && (cap->m_samples.size() > 0) && (dblue->m_samples[iblue-1] == sblue) )
+				emit(cap->m_samples[cap->m_samples.size()-1], true);
 
 			else if(vsync)
 			{
-				auto pack = new Packet;
-				pack->m_offset = dblue->m_offsets[iblue];
-				pack->m_headers["Type"] = "VSYNC";
-				m_packets.push_back(pack);
+				//One packet per frame, reporting the size of the frame that just ended
+				if(!last_vsync)
+				{
+					auto pack = new Packet;
+					pack->m_offset = dblue->m_offsets[iblue];
+					pack->m_headers["Type"] = "VSYNC";
+					if(have_vsync)
+					{
+						pack->m_headers["Width"] = to_string(m_stats.m_activeWidth);
+						pack->m_headers["Height"] = to_string(active_lines_in_frame);
+					}
+					m_packets.push_back(pack);
+				}
 
-				cap->m_offsets.push_back(dblue->m_offsets[iblue]);
-				cap->m_durations.push_back(dblue->m_durations[iblue]);
-				cap->m_samples.push_back(DVISymbol(DVISymbol::DVI_TYPE_VSYNC));
+				emit(DVISymbol(DVISymbol::DVI_TYPE_VSYNC), false);
 			}
 
 			else if(hsync)
+				emit(DVISymbol(DVISymbol::DVI_TYPE_HSYNC), false);
+
+			else
+				emit(DVISymbol(DVISymbol::DVI_TYPE_PREAMBLE), false);
+		}
+
+		//Guard band on the master channel, or trailing data island guard band on the other lanes
+		else if( (sblue.m_type == TMDSSymbol::TMDS_TYPE_GUARD) ||
+			(in_island && (island_pos == 0) &&
+				( (sgreen.m_type == TMDSSymbol::TMDS_TYPE_GUARD) || (sred.m_type == TMDSSymbol::TMDS_TYPE_GUARD) ) ) )
+		{
+			bool island =
+				( (sblue.m_type == TMDSSymbol::TMDS_TYPE_GUARD) && sblue.m_data) ||
+				( (sred.m_type == TMDSSymbol::TMDS_TYPE_GUARD) && sred.m_data) ||
+				in_island;
+
+			//Lane 0 carries HSYNC/VSYNC in the guard band too
+			if(sblue.m_type == TMDSSymbol::TMDS_TYPE_TERC4)
 			{
-				cap->m_offsets.push_back(dblue->m_offsets[iblue]);
-				cap->m_durations.push_back(dblue->m_durations[iblue]);
-				cap->m_samples.push_back(DVISymbol(DVISymbol::DVI_TYPE_HSYNC));
+				hsync = (sblue.m_data & 1) ? true : false;
+				vsync = (sblue.m_data & 2) ? true : false;
 			}
 
-			else
+			emit(DVISymbol(DVISymbol::DVI_TYPE_GUARD, island), true);
+
+			if(island)
 			{
-				cap->m_offsets.push_back(dblue->m_offsets[iblue]);
-				cap->m_durations.push_back(dblue->m_durations[iblue]);
-				cap->m_samples.push_back(DVISymbol(DVISymbol::DVI_TYPE_PREAMBLE));
+				in_island = true;
+				island_pos = 0;
 			}
 		}
 
-		//Data? Decode it
-		else if(sblue.m_type == TMDSSymbol::TMDS_TYPE_DATA)
+		//Data island packet (HDMI 1.4 spec 5.2.3.4)
+		else if(in_island && (sblue.m_type == TMDSSymbol::TMDS_TYPE_TERC4) )
 		{
-			//If the LAST sample was a control symbol, re-synchronize the three lanes
-			//to compensate for lane-to-lane clock skew.
-			//Should only be needed at the start of the capture, but can't hurt to re-do it in case of some
-			//weird clock domain crossing issues in the transmitter causing idle insertion/removal.
-			if(last_type == TMDSSymbol::TMDS_TYPE_CONTROL)
+			hsync = (sblue.m_data & 1) ? true : false;
+			vsync = (sblue.m_data & 2) ? true : false;
+
+			//Bit 3 of lane 0 is low only in the first symbol of each packet. Use it to resync if we lost our place.
+			bool first = !(sblue.m_data & 8);
+			if(first && (island_pos != 0) )
+				island_pos = 0;
+
+			if(island_pos == 0)
+			{
+				island_start = dblue->m_offsets[iblue];
+				island_symbol_error = false;
+				memset(header, 0, sizeof(header));
+				memset(subpackets, 0, sizeof(subpackets));
+			}
+
+			if( (sgreen.m_type != TMDSSymbol::TMDS_TYPE_TERC4) || (sred.m_type != TMDSSymbol::TMDS_TYPE_TERC4) )
+				island_symbol_error = true;
+
+			//Lane 0 bit 2 is the header, lanes 1 and 2 carry the even and odd bits of the four subpackets
+			size_t i = island_pos;
+			if(sblue.m_data & 4)
+				header[i / 8] |= (1 << (i % 8));
+			for(size_t k=0; k<4; k++)
 			{
-				//Align green
-				for(ssize_t delta=-50; delta <= 50; delta ++)
+				size_t even = 2*i;
+				size_t odd = 2*i + 1;
+				if( (sgreen.m_data >> k) & 1)
+					subpackets[k][even / 8] |= (1 << (even % 8));
+				if( (sred.m_data >> k) & 1)
+					subpackets[k][odd / 8] |= (1 << (odd % 8));
+			}
+
+			island_pos ++;
+			if(island_pos == 32)
+			{
+				island_pos = 0;
+
+				//Check the ECC on the header and each subpacket
+				bool ok = !island_symbol_error && (ComputeBCH(header, 3) == header[3]);
+				for(size_t k=0; k<4; k++)
+				{
+					if(ComputeBCH(subpackets[k], 7) != subpackets[k][7])
+						ok = false;
+				}
+
+				auto pack = new Packet;
+				pack->m_offset = island_start;
+				pack->m_len = dblue->m_offsets[iblue] + dblue->m_durations[iblue] - island_start;
+				pack->m_headers["Type"] = GetDataIslandPacketName(header[0]);
+				for(size_t k=0; k<3; k++)
+					pack->m_data.push_back(header[k]);
+				for(size_t k=0; k<4; k++)
 				{
-					size_t ngreen = delta + igreen;
-					if(ngreen < 1)
-						continue;
-					if(ngreen >= wgsize)
-						continue;
-					if(dgreen->m_samples[ngreen-1].m_type != TMDSSymbol::TMDS_TYPE_CONTROL)
-						continue;
-					if(dgreen->m_samples[ngreen].m_type != TMDSSymbol::TMDS_TYPE_DATA)
-						continue;
-
-					igreen += delta;
-					break;
+					for(size_t j=0; j<7; j++)
+						pack->m_data.push_back(subpackets[k][j]);
 				}
 
-				//Align red
-				for(ssize_t delta= -50; delta <= 50; delta ++)
+				//InfoFrames have a checksum in PB0 covering the header and payload
+				if(header[0] & 0x80)
 				{
-					size_t nred = delta + ired;
-					if(nred < 1)
-						continue;
-					if(nred >= rsize)
-						continue;
-					if(dred->m_samples[nred-1].m_type != TMDSSymbol::TMDS_TYPE_CONTROL)
-						continue;
-					if(dred->m_samples[nred].m_type != TMDSSymbol::TMDS_TYPE_DATA)
-						continue;
-
-					ired += delta;
-					break;
+					size_t len = min(header[2] & 0x1f, 27);
+					uint8_t sum = 0;
+					for(size_t k=0; k < len + 4; k++)
+						sum += pack->m_data[k];
+					if(sum != 0)
+						ok = false;
 				}
 
-				//Start a new packet
+				pack->m_displayBackgroundColor = ok ?
+					m_backgroundColors[PROTO_COLOR_STATUS] : m_backgroundColors[PROTO_COLOR_ERROR];
+				m_packets.push_back(pack);
+
+				m_stats.m_dataIslandPackets ++;
+				if(!ok)
+					m_stats.m_dataIslandErrors ++;
+
+				cap->m_offsets.push_back(island_start);
+				cap->m_durations.push_back(pack->m_len);
+				cap->m_samples.push_back(DVISymbol(DVISymbol::DVI_TYPE_DATA_ISLAND, header[0], !ok));
+			}
+		}
+
+		//Data? Decode it
+		else if(sblue.m_type == TMDSSymbol::TMDS_TYPE_DATA)
+		{
+			//Start a new packet at the start of active video
+			if(last_type != TMDSSymbol::TMDS_TYPE_DATA)
+			{
 				current_packet = new VideoScanlinePacket;
 				current_packet->m_offset = dblue->m_offsets[iblue];
 				current_packet->m_headers["Type"] = "Video";
 				current_pixels = 0;
 			}
 
-			auto sgreen = dgreen->m_samples[igreen];
-			auto sred = dred->m_samples[ired];
-
 			cap->m_offsets.push_back(dblue->m_offsets[iblue]);
 			cap->m_durations.push_back(dblue->m_durations[iblue]);
 			cap->m_samples.push_back(DVISymbol(DVISymbol::DVI_TYPE_VIDEO,
@@ -260,6 +458,50 @@ void DVIDecoder::Refresh()
 			}
 		}
 
+		else
+			emit(DVISymbol(DVISymbol::DVI_TYPE_ERROR), false);
+
+		//Line timing from HSYNC edges
+		int64_t now = dblue->m_offsets[iblue];
+		if(hsync && !last_hsync)
+		{
+			if(have_hsync)
+			{
+				m_stats.m_totalWidth = iblue - hsync_rise;
+				m_stats.m_linePeriod = now - hsync_rise_time;
+			}
+			lines_in_frame ++;
+			have_hsync = true;
+			hsync_rise = iblue;
+			hsync_rise_time = now;
+		}
+		else if(!hsync && last_hsync && have_hsync)
+		{
+			//Measure the shorter phase so negative polarity sync reports the pulse width too
+			size_t width = iblue - hsync_rise;
+			if( (m_stats.m_totalWidth > 0) && (width > m_stats.m_totalWidth/2) && (width < m_stats.m_totalWidth) )
+				width = m_stats.m_totalWidth - width;
+			m_stats.m_hsyncWidth = width;
+		}
+
+		//Frame timing from VSYNC edges
+		if(vsync && !last_vsync)
+		{
+			if(have_vsync)
+			{
+				m_stats.m_totalLines = lines_in_frame;
+				m_stats.m_activeLines = active_lines_in_frame;
+				m_stats.m_framePeriod = now - vsync_rise_time;
+				m_stats.m_frames ++;
+			}
+			have_vsync = true;
+			vsync_rise_time = now;
+			lines_in_frame = 0;
+			active_lines_in_frame = 0;
+		}
+		last_hsync = hsync;
+		last_vsync = vsync;
+
 		//Save the previous type of sample
 		last_type = sblue.m_type;
 
@@ -289,6 +531,15 @@ std::string DVIWaveform::GetColor(size_t i)
 		case DVISymbol::DVI_TYPE_VSYNC:
 			return StandardColors::colors[StandardColors::COLOR_CONTROL];
 
+		case DVISymbol::DVI_TYPE_GUARD:
+			return StandardColors::colors[StandardColors::COLOR_PREAMBLE];
+
+		case DVISymbol::DVI_TYPE_DATA_ISLAND:
+			if(s.m_green)
+				return StandardColors::colors[StandardColors::COLOR_ERROR];
+			else
+				return StandardColors::colors[StandardColors::COLOR_DATA];
+
 		case DVISymbol::DVI_TYPE_VIDEO:
 			{
 				char buf[10];
@@ -317,6 +568,12 @@ string DVIWaveform::GetText(size_t i)
 		case DVISymbol::DVI_TYPE_VSYNC:
 			return "VSYNC";
 
+		case DVISymbol::DVI_TYPE_GUARD:
+			return "GB";
+
+		case DVISymbol::DVI_TYPE_DATA_ISLAND:
+			return DVIDecoder::GetDataIslandPacketName(s.m_red);
+
 		case DVISymbol::DVI_TYPE_VIDEO:
 			snprintf(tmp, sizeof(tmp), "#%02x%02x%02x", s.m_red, s.m_green, s.m_blue);
 			break;
@@ -47,7 +47,9 @@ public:
 		DVI_TYPE_HSYNC,
 		DVI_TYPE_VSYNC,
 		DVI_TYPE_VIDEO,
-		DVI_TYPE_ERROR
+		DVI_TYPE_ERROR,
+		DVI_TYPE_GUARD,
+		DVI_TYPE_DATA_ISLAND	//HDMI data island packet: red is the packet type (HB0), green is nonzero on ECC error
 	};
 
 	//default for STL
@@ -101,9 +103,51 @@ public:
 
 	virtual bool ValidateChannel(size_t i, StreamDescriptor stream) override;
 
+	///@brief Video timing measured from the sync signals and active video
+	struct TimingStatistics
+	{
+		///@brief Active pixels in the most recent video line
+		size_t m_activeWidth;
+
+		///@brief Pixel clocks from one HSYNC to the next
+		size_t m_totalWidth;
+
+		///@brief Pixel clocks with HSYNC asserted (polarity independent)
+		size_t m_hsyncWidth;
+
+		///@brief Lines of active video in the most recent complete frame
+		size_t m_activeLines;
+
+		///@brief HSYNC pulses from one VSYNC to the next
+		size_t m_totalLines;
+
+		///@brief HSYNC period, in fs
+		int64_t m_linePeriod;
+
+		///@brief VSYNC period, in fs
+		int64_t m_framePeriod;
+
+		///@brief Number of complete frames seen
+		size_t m_frames;
+
+		///@brief Number of HDMI data island packets seen
+		size_t m_dataIslandPackets;
+
+		///@brief Number of data island packets with ECC or checksum errors
+		size_t m_dataIslandErrors;
+	};
+
+	///@brief Gets timing statistics from the most recent decode
+	const TimingStatistics& GetTimingStatistics() const
+	{ return m_stats; }
+
+	static std::string GetDataIslandPacketName(uint8_t type);
+	static uint8_t ComputeBCH(const uint8_t* data, size_t len);
+
 	PROTOCOL_DECODER_INITPROC(DVIDecoder)
 
 protected:
+	TimingStatistics m_stats;
 };
 
 #endif
@@ -92,7 +92,7 @@ void DownsampleFilter::Refresh()
 
 	//Set up output waveform and get configuration
 	int64_t factor = m_parameters[m_factorname].GetIntVal();
-	if (factor == 0)
+	if(factor <= 0)
 	{
 		// Occurs momentarily while editing the value sometimes in glscopeclient
 		return;
@@ -108,52 +108,19 @@ void DownsampleFilter::Refresh()
 	//Default path with antialiasing filter
 	if(m_parameters[m_aaname].GetBoolVal())
 	{
-		//Cut off all frequencies shorter than our decimation factor
-		float cutoff_period = factor;
-		float sigma = cutoff_period / sqrt(2 * log(2));
-		int kernel_radius = ceil(3*sigma);
-
-		//Generate the actual Gaussian kernel
-		int kernel_size = kernel_radius*2 + 1;
-		vector<float> kernel;
-		kernel.resize(kernel_size);
-		float alpha = 1.0f / (sigma * sqrt(2*M_PI));
-		for(int x=0; x < kernel_size; x++)
-		{
-			int delta = (x - kernel_radius);
-			kernel[x] = alpha * exp(-delta*delta/(2*sigma));
-		}
-		float sum = 0;
-		for(auto k : kernel)
-			sum += k;
-		for(int i=0; i<kernel_size; i++)
-			kernel[i] /= sum;
-
-		//Do the actual downsampling.
-		for(size_t i=0; i<outlen; i++)
-		{
-			//Do the convolution
-			float conv = 0;
-			ssize_t base = i*factor;
-			for(ssize_t delta = -kernel_radius; delta <= kernel_radius; delta ++)
-			{
-				ssize_t pos = base + delta;
-				if( (pos < 0) || (pos >= (ssize_t)len) )
-					continue;
-
-				conv += din->m_samples[pos] * kernel[delta + kernel_radius];
-			}
-
-			//Do the actual decimation
-			cap->m_samples[i] 	= conv;
-		}
+		//Multistage CIC / half-band decimation, designs are cached so this is cheap if the factor is unchanged
+		m_decimator.SetFactor(factor);
+		m_decimator.Process(din->m_samples.GetCpuPointer(), cap->m_samples.GetCpuPointer(), len);
+		cap->m_triggerPhase += m_decimator.GetDelay() * din->m_timescale;
 	}
 
 	//Optimized path with no AA if the input is known to not contain any higher frequency content
 	else
 	{
-		for(size_t i=0; i<outlen; i++)
+		ThreadPool::GetDefault().ParallelFor(0, outlen, [&](size_t i)
+		{
 			cap->m_samples[i]	= din->m_samples[i*factor];
+		}, outlen > 100000);
 	}
 
 	//Copy our time scales from the input
@@ -35,6 +35,8 @@
 #ifndef DownsampleFilter_h
 #define DownsampleFilter_h
 
+#include "../scopehal/Decimator.h"
+
 /**
 	@brief Downsample - low-pass filter and decimate a signal
  */
@@ -54,6 +56,9 @@ public:
 protected:
 	std::string m_factorname;
 	std::string m_aaname;
+
+	///@brief Anti-aliasing decimation chain
+	Decimator m_decimator;
 };
 
 #endif
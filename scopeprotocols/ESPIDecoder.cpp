@@ -995,7 +995,7 @@ void ESPIDecoder::Refresh()
 					if(count == 0)
 					{
 						//Remove trailing newline
-						pack->m_headers["Info"] = Trim(pack->m_headers["Info"]);
+						pack->m_headers["Info"] = Trim(pack->GetHeader("Info"));
 
 						if(current_cmd == ESPISymbol::COMMAND_PUT_VWIRE)
 							txn_state = TXN_STATE_COMMAND_CRC8;
@@ -2088,75 +2088,75 @@ string ESPIWaveform::GetText(size_t i)
 bool ESPIDecoder::CanMerge(Packet* first, Packet* /*cur*/, Packet* next)
 {
 	//Merge a "Get Status" with subsequent "Get Flash Non-Posted"
-	if( (first->m_headers["Command"] == "Get Status") &&
-		(first->m_headers["Status"].find("FLASH_NP_AVAIL") != string::npos) &&
-		(next->m_headers["Command"] == "Get Flash Non-Posted") )
+	if( (first->GetHeader("Command") == "Get Status") &&
+		(first->GetHeader("Status").find("FLASH_NP_AVAIL") != string::npos) &&
+		(next->GetHeader("Command") == "Get Flash Non-Posted") )
 	{
 		return true;
 	}
 
 	//Merge a "Get Status" with subsequent "Put Flash Completion"
 	//TODO: Only if the tags match!
-	if( (first->m_headers["Command"] == "Get Status") &&
-		(first->m_headers["Status"].find("FLASH_NP_AVAIL") != string::npos) &&
-		(next->m_headers["Command"] == "Put Flash Completion") )
+	if( (first->GetHeader("Command") == "Get Status") &&
+		(first->GetHeader("Status").find("FLASH_NP_AVAIL") != string::npos) &&
+		(next->GetHeader("Command") == "Put Flash Completion") )
 	{
 		return true;
 	}
 
 	//Merge a "Get Status" with subsequent "Get OOB" or "Put OOB"
 	//TODO: Only if the tags match!
-	if( (first->m_headers["Command"] == "Get Status") &&
-		(first->m_headers["Status"].find("OOB_AVAIL") != string::npos) &&
-		(next->m_headers["Command"] == "Get OOB") )
+	if( (first->GetHeader("Command") == "Get Status") &&
+		(first->GetHeader("Status").find("OOB_AVAIL") != string::npos) &&
+		(next->GetHeader("Command") == "Get OOB") )
 	{
 		return true;
 	}
-	if( (first->m_headers["Command"] == "Get Status") &&
-		(first->m_headers["Status"].find("OOB_AVAIL") != string::npos) &&
-		(next->m_headers["Command"] == "Put OOB") )
+	if( (first->GetHeader("Command") == "Get Status") &&
+		(first->GetHeader("Status").find("OOB_AVAIL") != string::npos) &&
+		(next->GetHeader("Command") == "Put OOB") )
 	{
 		return true;
 	}
 
 	//Merge a "Get Status" with subsequent "Get Virtual Wire"
-	if( (first->m_headers["Command"] == "Get Status") &&
-		(first->m_headers["Status"].find("VWIRE_AVAIL") != string::npos) &&
-		(next->m_headers["Command"] == "Get Virtual Wire") )
+	if( (first->GetHeader("Command") == "Get Status") &&
+		(first->GetHeader("Status").find("VWIRE_AVAIL") != string::npos) &&
+		(next->GetHeader("Command") == "Get Virtual Wire") )
 	{
 		return true;
 	}
 
 	//Merge a "Put I/O Write" with subsequent "Get Status" and "Get Posted Completion"
-	if( (first->m_headers["Command"] == "Put I/O Write") &&
-		(next->m_headers["Command"] == "Get Status") &&
-		(next->m_headers["Status"].find("PC_AVAIL") != string::npos) )
+	if( (first->GetHeader("Command") == "Put I/O Write") &&
+		(next->GetHeader("Command") == "Get Status") &&
+		(next->GetHeader("Status").find("PC_AVAIL") != string::npos) )
 	{
 		return true;
 	}
-	if( (first->m_headers["Command"] == "Put I/O Write") &&
-		(next->m_headers["Command"] == "Get Posted Completion") )
+	if( (first->GetHeader("Command") == "Put I/O Write") &&
+		(next->GetHeader("Command") == "Get Posted Completion") )
 	{
 		return true;
 	}
 
 	//Merge a "Put I/O Read" with subsequent "Get Status" and "Get Posted Completion"
-	if( (first->m_headers["Command"] == "Put I/O Read") &&
-		(next->m_headers["Command"] == "Get Status") &&
-		(next->m_headers["Status"].find("PC_AVAIL") != string::npos) )
+	if( (first->GetHeader("Command") == "Put I/O Read") &&
+		(next->GetHeader("Command") == "Get Status") &&
+		(next->GetHeader("Status").find("PC_AVAIL") != string::npos) )
 	{
 		return true;
 	}
-	if( (first->m_headers["Command"] == "Put I/O Read") &&
-		(next->m_headers["Command"] == "Get Posted Completion") )
+	if( (first->GetHeader("Command") == "Put I/O Read") &&
+		(next->GetHeader("Command") == "Get Posted Completion") )
 	{
 		return true;
 	}
 
 	//Merge consecutive status register polls
-	if( (first->m_headers["Command"] == "Get Configuration") &&
-		(next->m_headers["Command"] == "Get Configuration") &&
-		(first->m_headers["Address"] == next->m_headers["Address"]) )
+	if( (first->GetHeader("Command") == "Get Configuration") &&
+		(next->GetHeader("Command") == "Get Configuration") &&
+		(first->GetHeader("Address") == next->GetHeader("Address")) )
 	{
 		return true;
 	}
@@ -2173,31 +2173,31 @@ Packet* ESPIDecoder::CreateMergedHeader(Packet* pack, size_t i)
 	Packet* first = m_packets[i];
 
 	//Fetching commands requested by the peripheral
-	if(first->m_headers["Command"] == "Get Status")
+	if(first->GetHeader("Command") == "Get Status")
 	{
 		//Look up the second packet in the string
 		if(i+1 < m_packets.size())
 		{
 			Packet* second = m_packets[i+1];
 
-			ret->m_headers["Address"] = second->m_headers["Address"];
-			ret->m_headers["Len"] = second->m_headers["Len"];
-			ret->m_headers["Tag"] = second->m_headers["Tag"];
+			ret->m_headers["Address"] = second->GetHeader("Address");
+			ret->m_headers["Len"] = second->GetHeader("Len");
+			ret->m_headers["Tag"] = second->GetHeader("Tag");
 
 			//Flash transaction?
-			if(second->m_headers["Command"] == "Get Flash Non-Posted")
+			if(second->GetHeader("Command") == "Get Flash Non-Posted")
 			{
-				if(second->m_headers["Info"] == "Read")
+				if(second->GetHeader("Info") == "Read")
 				{
 					ret->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_DATA_READ];
 					ret->m_headers["Command"] = "Flash Read";
 				}
-				else if(second->m_headers["Info"] == "Write")
+				else if(second->GetHeader("Info") == "Write")
 				{
 					ret->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_DATA_WRITE];
 					ret->m_headers["Command"] = "Flash Write";
 				}
-				else if(second->m_headers["Info"] == "Erase")
+				else if(second->GetHeader("Info") == "Erase")
 				{
 					ret->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_DATA_WRITE];
 					ret->m_headers["Command"] = "Flash Erase";
@@ -2208,9 +2208,9 @@ Packet* ESPIDecoder::CreateMergedHeader(Packet* pack, size_t i)
 				for(size_t j=i+2; j<m_packets.size(); j++)
 				{
 					Packet* p = m_packets[j];
-					if(p->m_headers["Command"] != "Put Flash Completion")
+					if(p->GetHeader("Command") != "Put Flash Completion")
 						break;
-					if(p->m_headers["Tag"] != second->m_headers["Tag"])
+					if(p->GetHeader("Tag") != second->GetHeader("Tag"))
 						break;
 
 					for(auto b : p->m_data)
@@ -2221,29 +2221,29 @@ Packet* ESPIDecoder::CreateMergedHeader(Packet* pack, size_t i)
 			}
 
 			//SMBus transaction?
-			else if(second->m_headers["Command"] == "Get OOB")
+			else if(second->GetHeader("Command") == "Get OOB")
 			{
 				ret->m_headers["Command"] = "SMBus Access";
 				ret->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_DATA_WRITE];
 			}
 
 			//Virtual Wire transaction?
-			else if(second->m_headers["Command"] == "Get Virtual Wire")
+			else if(second->GetHeader("Command") == "Get Virtual Wire")
 			{
 				ret->m_headers["Command"] = "Get Virtual Wire";
-				ret->m_headers["Info"] = second->m_headers["Info"];
+				ret->m_headers["Info"] = second->GetHeader("Info");
 				ret->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_DATA_READ];
 			}
 		}
 	}
 
 	//Split transactions
-	else if(first->m_headers["Command"] == "Put I/O Write")
+	else if(first->GetHeader("Command") == "Put I/O Write")
 	{
 		ret->m_headers["Command"] = "I/O Write";
 		ret->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_DATA_WRITE];
-		ret->m_headers["Address"] = first->m_headers["Address"];
-		ret->m_headers["Len"] = first->m_headers["Len"];
+		ret->m_headers["Address"] = first->GetHeader("Address");
+		ret->m_headers["Len"] = first->GetHeader("Len");
 
 		//Get data from the write packet
 		for(auto b : first->m_data)
@@ -2254,9 +2254,9 @@ Packet* ESPIDecoder::CreateMergedHeader(Packet* pack, size_t i)
 		{
 			Packet* p = m_packets[j];
 
-			if(p->m_headers["Command"] == "Get Posted Completion")
-				ret->m_headers["Response"] = p->m_headers["Response"];
-			else if(p->m_headers["Command"] == "Get Status")
+			if(p->GetHeader("Command") == "Get Posted Completion")
+				ret->m_headers["Response"] = p->GetHeader("Response");
+			else if(p->GetHeader("Command") == "Get Status")
 			{}
 			else
 				break;
@@ -2264,21 +2264,21 @@ Packet* ESPIDecoder::CreateMergedHeader(Packet* pack, size_t i)
 			ret->m_len = p->m_offset + p->m_len - ret->m_offset;
 		}
 	}
-	else if(first->m_headers["Command"] == "Put I/O Read")
+	else if(first->GetHeader("Command") == "Put I/O Read")
 	{
 		ret->m_headers["Command"] = "I/O Read";
 		ret->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_DATA_READ];
-		ret->m_headers["Address"] = first->m_headers["Address"];
-		ret->m_headers["Len"] = first->m_headers["Len"];
+		ret->m_headers["Address"] = first->GetHeader("Address");
+		ret->m_headers["Len"] = first->GetHeader("Len");
 
 		//Get status and data from completions
 		for(size_t j=i+1; j<m_packets.size(); j++)
 		{
 			Packet* p = m_packets[j];
 
-			if(p->m_headers["Command"] == "Get Posted Completion")
-				ret->m_headers["Response"] = p->m_headers["Response"];
-			else if(p->m_headers["Command"] == "Get Status")
+			if(p->GetHeader("Command") == "Get Posted Completion")
+				ret->m_headers["Response"] = p->GetHeader("Response");
+			else if(p->GetHeader("Command") == "Get Status")
 			{}
 			else
 				break;
@@ -2291,11 +2291,11 @@ Packet* ESPIDecoder::CreateMergedHeader(Packet* pack, size_t i)
 	}
 
 	//Status register polling
-	else if(first->m_headers["Command"] == "Get Configuration")
+	else if(first->GetHeader("Command") == "Get Configuration")
 	{
 		ret->m_headers["Command"] = "Poll Configuration";
 		ret->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_CONTROL];
-		ret->m_headers["Address"] = first->m_headers["Address"];
+		ret->m_headers["Address"] = first->GetHeader("Address");
 
 		//Get status and data from completions
 		size_t ilast = i;
@@ -2303,8 +2303,8 @@ Packet* ESPIDecoder::CreateMergedHeader(Packet* pack, size_t i)
 		{
 			Packet* p = m_packets[j];
 
-			if( (p->m_headers["Command"] == "Get Configuration") &&
-				(p->m_headers["Address"] == first->m_headers["Address"]) )
+			if( (p->GetHeader("Command") == "Get Configuration") &&
+				(p->GetHeader("Address") == first->GetHeader("Address")) )
 			{
 				ilast = j;
 			}
@@ -2314,8 +2314,8 @@ Packet* ESPIDecoder::CreateMergedHeader(Packet* pack, size_t i)
 
 		Packet* last = m_packets[ilast];
 		ret->m_headers["Len"] = to_string(ilast - i);
-		ret->m_headers["Info"] = last->m_headers["Info"];
-		ret->m_headers["Response"] = last->m_headers["Response"];
+		ret->m_headers["Info"] = last->GetHeader("Info");
+		ret->m_headers["Response"] = last->GetHeader("Response");
 		for(auto b : last->m_data)
 			ret->m_data.push_back(b);
 		ret->m_len = last->m_offset + last->m_len - last->m_offset;
@@ -39,6 +39,7 @@ EnhancedResolutionFilter::EnhancedResolutionFilter(const string& color)
 	: FIRFilter(color)
 	, m_cutoffFreqName("Cutoff Frequency")
 	, m_bitsName("Bits")
+	, m_decimateName("Decimate Output")
 {
 	m_parameters[m_filterTypeName].MarkHidden();
 	m_parameters[m_filterLengthName].MarkHidden();
@@ -61,6 +62,9 @@ EnhancedResolutionFilter::EnhancedResolutionFilter(const string& color)
 
 	m_parameters[m_cutoffFreqName].MarkReadOnly();
 
+	m_parameters[m_decimateName] = FilterParameter(FilterParameter::TYPE_BOOL, Unit(Unit::UNIT_COUNTS));
+	m_parameters[m_decimateName].SetBoolVal(false);
+
 	m_parameters[m_filterTypeName].SetIntVal(FILTER_TYPE_LOWPASS);
 
 	OnBitsChanged();
@@ -116,7 +120,38 @@ void EnhancedResolutionFilter::SetDefaultName()
 void EnhancedResolutionFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueHandle> queue)
 {
 	UpdateCutoff();
-	FIRFilter::Refresh(cmdBuf, queue);
+
+	if(!m_parameters[m_decimateName].GetBoolVal())
+	{
+		FIRFilter::Refresh(cmdBuf, queue);
+		return;
+	}
+
+	//Decimating mode: the cutoff for each half bit is exactly one more half-band stage, so decimate by 2^(n+1)
+	//instead of running the full rate FIR
+	if(!VerifyAllInputsOKAndUniformAnalog())
+	{
+		SetData(NULL, 0);
+		return;
+	}
+
+	auto din = dynamic_cast<UniformAnalogWaveform*>(GetInputWaveform(0));
+	size_t len = din->size();
+	size_t factor = 2 << m_parameters[m_bitsName].GetIntVal();
+	m_decimator.SetFactor(factor);
+
+	m_xAxisUnit = m_inputs[0].m_channel->GetXAxisUnits();
+	SetYAxisUnits(m_inputs[0].GetYAxisUnits(), 0);
+	auto cap = SetupEmptyUniformAnalogOutputWaveform(din, 0);
+	cap->Resize(m_decimator.GetOutputLength(len));
+
+	din->PrepareForCpuAccess();
+	cap->PrepareForCpuAccess();
+	m_decimator.Process(din->m_samples.GetCpuPointer(), cap->m_samples.GetCpuPointer(), len);
+	cap->MarkModifiedFromCpu();
+
+	cap->m_timescale = din->m_timescale * factor;
+	cap->m_triggerPhase += m_decimator.GetDelay() * din->m_timescale;
 }
 
 void EnhancedResolutionFilter::OnBitsChanged()
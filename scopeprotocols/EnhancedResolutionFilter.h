@@ -36,6 +36,7 @@
 #define EnhancedResolutionFilter_h
 
 #include "FIRFilter.h"
+#include "../scopehal/Decimator.h"
 
 class EnhancedResolutionFilter : public FIRFilter
 {
@@ -64,6 +65,10 @@ protected:
 
 	std::string m_cutoffFreqName;
 	std::string m_bitsName;
+	std::string m_decimateName;
+
+	///@brief Half-band decimation chain used when decimating the output
+	Decimator m_decimator;
 
 	void UpdateCutoff();
 };
@@ -259,7 +259,7 @@ void EthernetAutonegotiationPageDecoder::Refresh()
 
 						auto pack = new Packet;
 						pack->m_headers["Type"] = "Message";
-						lastType = pack->m_headers["Type"];
+						lastType = pack->GetHeader("Type");
 						pack->m_headers["Ack"] = (code & ACK) ? "1" : "0";
 						pack->m_headers["Info"] = cap->GetText(cap->m_samples.size()-1);
 						pack->m_headers["T"] = (code & TOGGLE) ? "1" : "0";
@@ -270,7 +270,7 @@ void EthernetAutonegotiationPageDecoder::Refresh()
 						pack->m_offset = tnow * din->m_timescale + din->m_triggerPhase;
 						pack->m_len = din->m_durations[i] * din->m_timescale;
 						pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_CONTROL];
-						lastType = pack->m_headers["Type"];
+						lastType = pack->GetHeader("Type");
 						m_packets.push_back(pack);
 
 						messageCount = 0;
@@ -325,7 +325,7 @@ void EthernetAutonegotiationPageDecoder::Refresh()
 
 						auto pack = new Packet;
 						pack->m_headers["Type"] = "Unformatted";
-						lastType = pack->m_headers["Type"];
+						lastType = pack->GetHeader("Type");
 						pack->m_headers["Ack"] = (code & ACK) ? "1" : "0";
 						pack->m_headers["Info"] = cap->GetText(cap->m_samples.size()-1);
 						pack->m_headers["T"] = (code & TOGGLE) ? "1" : "0";
@@ -398,7 +398,7 @@ void EthernetAutonegotiationPageDecoder::Refresh()
 					pack->m_offset = tnow * din->m_timescale + din->m_triggerPhase;
 					pack->m_len = din->m_durations[i] * din->m_timescale;
 					pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_DATA_READ];
-					lastType = pack->m_headers["Type"];
+					lastType = pack->GetHeader("Type");
 					m_packets.push_back(pack);
 				}
 
@@ -639,19 +639,19 @@ vector<string> EthernetAutonegotiationPageDecoder::GetHeaders()
 bool EthernetAutonegotiationPageDecoder::CanMerge(Packet* first, Packet* /*cur*/, Packet* next)
 {
 	//Merge base page with subsequent base pages (and their acks)
-	if( (first->m_headers["Type"] == "Base") && (next->m_headers["Type"] == "Base") )
+	if( (first->GetHeader("Type") == "Base") && (next->GetHeader("Type") == "Base") )
 		return true;
 
 	//Merge message page with subsequent ACKs and unformatted pages
-	if(first->m_headers["Type"] == "Message")
+	if(first->GetHeader("Type") == "Message")
 	{
-		if( (next->m_headers["Type"] == "Message") &&
-			( (next->m_headers["Info"] == "ACK") || (next->m_headers["Info"] == first->m_headers["Info"]) ) )
+		if( (next->GetHeader("Type") == "Message") &&
+			( (next->GetHeader("Info") == "ACK") || (next->GetHeader("Info") == first->GetHeader("Info")) ) )
 		{
 			return true;
 		}
 
-		if(next->m_headers["Type"] == "Unformatted")
+		if(next->GetHeader("Type") == "Unformatted")
 			return true;
 	}
 
@@ -665,9 +665,10 @@ Packet* EthernetAutonegotiationPageDecoder::CreateMergedHeader(Packet* pack, siz
 	ret->m_offset = pack->m_offset;
 	ret->m_len = pack->m_len;
 	ret->m_headers = pack->m_headers;
+	ret->m_typedHeaders = pack->m_typedHeaders;
 	ret->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_DATA_READ];
 
-	if(pack->m_headers["Type"] == "Base")
+	if(pack->GetHeader("Type") == "Base")
 	{
 		//Extend lengths
 		for(; i<m_packets.size(); i++)
@@ -679,12 +680,12 @@ Packet* EthernetAutonegotiationPageDecoder::CreateMergedHeader(Packet* pack, siz
 		}
 	}
 
-	if(pack->m_headers["Type"] == "Message")
+	if(pack->GetHeader("Type") == "Message")
 	{
-		ret->m_headers["Type"] = pack->m_headers["Info"];
+		ret->m_headers["Type"] = pack->GetHeader("Info");
 		ret->m_headers["Info"] = "";
 
-		string lastT = pack->m_headers["T"];
+		string lastT = pack->GetHeader("T");
 
 		//Check subsequent packets for unformatted pages that might be interesting
 		for(; i<m_packets.size(); i++)
@@ -694,10 +695,10 @@ Packet* EthernetAutonegotiationPageDecoder::CreateMergedHeader(Packet* pack, siz
 			if(CanMerge(pack, nullptr, p))
 			{
 				//Only care if it's a new toggle
-				auto curT = p->m_headers["T"];
-				if( (curT != lastT) && (p->m_headers["Type"] == "Unformatted") )
+				auto curT = p->GetHeader("T");
+				if( (curT != lastT) && (p->GetHeader("Type") == "Unformatted") )
 				{
-					ret->m_headers["Info"] += p->m_headers["Info"] + " ";
+					ret->m_headers["Info"] += p->GetHeader("Info") + " ";
 					lastT = curT;
 				}
 
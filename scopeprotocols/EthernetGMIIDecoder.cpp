@@ -102,13 +102,14 @@ void EthernetGMIIDecoder::Refresh()
 	auto en = GetInputWaveform(2);
 	auto er = GetInputWaveform(3);
 
-	//Sample everything on the clock edges
-	SparseDigitalWaveform den;
-	SparseDigitalWaveform der;
-	SparseDigitalBusWaveform ddata;
-	SampleOnRisingEdgesBase(en, clk, den);
-	SampleOnRisingEdgesBase(er, clk, der);
-	SampleOnRisingEdgesBase(data, clk, ddata);
+	//Sample everything on the clock edges: EN in bit 0, ER in bit 1, data in bits 9:2
+	SparseWaveform<uint64_t> samples;
+	if(!SampleMultipleOnEdges({en, er, data}, clk, samples, CLOCK_EDGE_RISING))
+	{
+		SetData(NULL, 0);
+		return;
+	}
+	const uint64_t enbit = 0x1;
 
 	//Create the output capture
 	auto cap = new EthernetWaveform;
@@ -117,12 +118,10 @@ void EthernetGMIIDecoder::Refresh()
 	cap->m_startFemtoseconds = data->m_startFemtoseconds;
 	cap->PrepareForCpuAccess();
 
-	size_t len = den.size();
-	len = min(len, der.size());
-	len = min(len, ddata.size());
+	size_t len = samples.size();
 	for(size_t i=0; i < len; i++)
 	{
-		if(!den.m_samples[i])
+		if(!(samples.m_samples[i] & enbit))
 			continue;
 
 		//Set of recovered bytes and timestamps
@@ -131,19 +130,11 @@ void EthernetGMIIDecoder::Refresh()
 		vector<uint64_t> ends;
 
 		//TODO: handle error signal (ignored for now)
-		while( (i < len) && (den.m_samples[i]) )
+		while( (i < len) && (samples.m_samples[i] & enbit) )
 		{
-			//Convert bits to bytes
-			uint8_t dval = 0;
-			for(size_t j=0; j<8; j++)
-			{
-				if(ddata.m_samples[i][j])
-					dval |= (1 << j);
-			}
-
-			bytes.push_back(dval);
-			starts.push_back(ddata.m_offsets[i]);
-			ends.push_back(ddata.m_offsets[i] + ddata.m_durations[i]);
+			bytes.push_back((samples.m_samples[i] >> 2) & 0xff);
+			starts.push_back(samples.m_offsets[i]);
+			ends.push_back(samples.m_offsets[i] + samples.m_durations[i]);
 			i++;
 		}
 
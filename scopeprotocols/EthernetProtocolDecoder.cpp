@@ -178,16 +178,7 @@ void EthernetProtocolDecoder::BytesToFrames(
 					cap->m_durations.push_back( (ends[i] - start) / cap->m_timescale );
 					cap->m_samples.push_back(segment);
 
-					//Format the content for display
-					char tmp[64];
-					snprintf(tmp, sizeof(tmp), "%02x:%02x:%02x:%02x:%02x:%02x",
-						segment.m_data[0],
-						segment.m_data[1],
-						segment.m_data[2],
-						segment.m_data[3],
-						segment.m_data[4],
-						segment.m_data[5]);
-					pack->m_headers["Dest MAC"] = tmp;
+					pack->SetHeaderBytes("Dest MAC", &segment.m_data[0], 6);
 
 					//Reset for next block of the frame
 					segment.m_type = EthernetFrameSegment::TYPE_SRC_MAC;
@@ -214,16 +205,7 @@ void EthernetProtocolDecoder::BytesToFrames(
 					cap->m_durations.push_back( (ends[i] - start) / cap->m_timescale);
 					cap->m_samples.push_back(segment);
 
-					//Format the content for display
-					char tmp[64];
-					snprintf(tmp, sizeof(tmp),"%02x:%02x:%02x:%02x:%02x:%02x",
-						segment.m_data[0],
-						segment.m_data[1],
-						segment.m_data[2],
-						segment.m_data[3],
-						segment.m_data[4],
-						segment.m_data[5]);
-					pack->m_headers["Src MAC"] = tmp;
+					pack->SetHeaderBytes("Src MAC", &segment.m_data[0], 6);
 
 					//Reset for next block of the frame
 					segment.m_type = EthernetFrameSegment::TYPE_ETHERTYPE;
@@ -263,7 +245,7 @@ void EthernetProtocolDecoder::BytesToFrames(
 					if(ethertype < 1500)
 					{
 						//Default to unknown LLC
-						pack->m_headers["Ethertype"] = "LLC";
+						pack->SetHeader("Ethertype", "LLC");
 						pack->m_displayBackgroundColor = "#33a02c";
 						pack->m_displayForegroundColor = "#000000";
 
@@ -272,7 +254,7 @@ void EthernetProtocolDecoder::BytesToFrames(
 						{
 							if(bytes[i+1] == 0x42)
 							{
-								pack->m_headers["Ethertype"] = "STP";
+								pack->SetHeader("Ethertype", "STP");
 								pack->m_displayBackgroundColor = "#fdbf6f";
 								pack->m_displayForegroundColor = "#000000";
 							}
@@ -280,45 +262,41 @@ void EthernetProtocolDecoder::BytesToFrames(
 					}
 					else
 					{
-						char tmp[64];
 						switch(ethertype)
 						{
 							case 0x0800:
-								pack->m_headers["Ethertype"] = "IPv4";
+								pack->SetHeader("Ethertype", "IPv4");
 								pack->m_displayBackgroundColor = "#a6cee3";
 								pack->m_displayForegroundColor = "#000000";
 								break;
 
 							case 0x0806:
-								pack->m_headers["Ethertype"] = "ARP";
+								pack->SetHeader("Ethertype", "ARP");
 								pack->m_displayBackgroundColor = "#ffff99";
 								pack->m_displayForegroundColor = "#000000";
 								break;
 
 							//TODO: decoder inner ethertype too?
 							case 0x8100:
-								pack->m_headers["Ethertype"] = "802.1q";
+								pack->SetHeader("Ethertype", "802.1q");
 								pack->m_displayBackgroundColor = "#b2df8a";
 								pack->m_displayForegroundColor = "#000000";
 								break;
 
 							case 0x86DD:
-								pack->m_headers["Ethertype"] = "IPv6";
+								pack->SetHeader("Ethertype", "IPv6");
 								pack->m_displayBackgroundColor = "#1f78b4";
 								pack->m_displayForegroundColor = "#ffffff";
 								break;
 
 							case 0x88cc:
-								pack->m_headers["Ethertype"] = "LLDP";
+								pack->SetHeader("Ethertype", "LLDP");
 								pack->m_displayBackgroundColor = "#5e4fa2";
 								pack->m_displayForegroundColor = "#ffffff";
 								break;
 
 							default:
-								snprintf(tmp, sizeof(tmp), "%02x%02x",
-								segment.m_data[0],
-								segment.m_data[1]);
-								pack->m_headers["Ethertype"] = tmp;
+								pack->SetHeaderHex("Ethertype", ethertype, 4);
 								pack->m_displayBackgroundColor = "#fb9a99";
 								pack->m_displayForegroundColor = "#000000";
 								break;
@@ -360,10 +338,7 @@ void EthernetProtocolDecoder::BytesToFrames(
 					segment.m_type = EthernetFrameSegment::TYPE_ETHERTYPE;
 					segment.m_data.clear();
 
-					//Format the content for display
-					char tmp[64];
-					snprintf(tmp, sizeof(tmp),"%d", tag & 0xfff);
-					pack->m_headers["VLAN"] = tmp;
+					pack->SetHeaderDecimal("VLAN", tag & 0xfff);
 				}
 
 				break;
@@ -445,7 +420,7 @@ void EthernetProtocolDecoder::BytesToFrames(
 	delete pack;
 }
 
-std::string EthernetWaveform::GetColor(size_t i)
+uint16_t EthernetWaveform::GetColorIndex(size_t i)
 {
 	switch(m_samples[i].m_type)
 	{
@@ -453,22 +428,22 @@ std::string EthernetWaveform::GetColor(size_t i)
 		case EthernetFrameSegment::TYPE_INBAND_STATUS:
 		case EthernetFrameSegment::TYPE_PREAMBLE:
 		case EthernetFrameSegment::TYPE_SFD:
-			return StandardColors::colors[StandardColors::COLOR_PREAMBLE];
+			return ProtocolPalette::GetStandardColor(StandardColors::COLOR_PREAMBLE);
 
 		//MAC addresses (src or dest)
 		case EthernetFrameSegment::TYPE_DST_MAC:
 		case EthernetFrameSegment::TYPE_SRC_MAC:
-			return StandardColors::colors[StandardColors::COLOR_ADDRESS];
+			return ProtocolPalette::GetStandardColor(StandardColors::COLOR_ADDRESS);
 
 		//Control codes
 		case EthernetFrameSegment::TYPE_ETHERTYPE:
 		case EthernetFrameSegment::TYPE_VLAN_TAG:
-			return StandardColors::colors[StandardColors::COLOR_CONTROL];
+			return ProtocolPalette::GetStandardColor(StandardColors::COLOR_CONTROL);
 
 		case EthernetFrameSegment::TYPE_FCS_GOOD:
-			return StandardColors::colors[StandardColors::COLOR_CHECKSUM_OK];
+			return ProtocolPalette::GetStandardColor(StandardColors::COLOR_CHECKSUM_OK);
 		case EthernetFrameSegment::TYPE_FCS_BAD:
-			return StandardColors::colors[StandardColors::COLOR_CHECKSUM_BAD];
+			return ProtocolPalette::GetStandardColor(StandardColors::COLOR_CHECKSUM_BAD);
 
 		//Signal has entirely disappeared, or fault condition reported
 		case EthernetFrameSegment::TYPE_NO_CARRIER:
@@ -476,37 +451,44 @@ std::string EthernetWaveform::GetColor(size_t i)
 		case EthernetFrameSegment::TYPE_REMOTE_FAULT:
 		case EthernetFrameSegment::TYPE_LOCAL_FAULT:
 		case EthernetFrameSegment::TYPE_LINK_INTERRUPTION:
-			return StandardColors::colors[StandardColors::COLOR_ERROR];
+			return ProtocolPalette::GetStandardColor(StandardColors::COLOR_ERROR);
 
 		//Payload
 		default:
-			return StandardColors::colors[StandardColors::COLOR_DATA];
+			return ProtocolPalette::GetStandardColor(StandardColors::COLOR_DATA);
 	}
 }
 
-string EthernetWaveform::GetText(size_t i)
+void EthernetWaveform::FormatText(size_t i, string& out)
 {
 	char tmp[128];
 
-	auto sample = m_samples[i];
+	auto& sample = m_samples[i];
 	switch(sample.m_type)
 	{
 		case EthernetFrameSegment::TYPE_TX_ERROR:
-			return "ERROR";
+			out = "ERROR";
+			return;
 
 		case EthernetFrameSegment::TYPE_PREAMBLE:
-			return "PREAMBLE";
+			out = "PREAMBLE";
+			return;
 
 		case EthernetFrameSegment::TYPE_SFD:
-			return "SFD";
+			out = "SFD";
+			return;
 
 		case EthernetFrameSegment::TYPE_NO_CARRIER:
-			return "NO CARRIER";
+			out = "NO CARRIER";
+			return;
 
 		case EthernetFrameSegment::TYPE_DST_MAC:
 			{
 				if(sample.m_data.size() != 6)
-					return "[invalid dest MAC length]";
+				{
+					out = "[invalid dest MAC length]";
+					return;
+				}
 
 				snprintf(tmp, sizeof(tmp), "To %02x:%02x:%02x:%02x:%02x:%02x",
 					sample.m_data[0],
@@ -515,13 +497,17 @@ string EthernetWaveform::GetText(size_t i)
 					sample.m_data[3],
 					sample.m_data[4],
 					sample.m_data[5]);
-				return tmp;
+				out = tmp;
+				return;
 			}
 
 		case EthernetFrameSegment::TYPE_SRC_MAC:
 			{
 				if(sample.m_data.size() != 6)
-					return "[invalid src MAC length]";
+				{
+					out = "[invalid src MAC length]";
+					return;
+				}
 
 				snprintf(tmp, sizeof(tmp), "From %02x:%02x:%02x:%02x:%02x:%02x",
 					sample.m_data[0],
@@ -530,7 +516,8 @@ string EthernetWaveform::GetText(size_t i)
 					sample.m_data[3],
 					sample.m_data[4],
 					sample.m_data[5]);
-				return tmp;
+				out = tmp;
+				return;
 			}
 
 		case EthernetFrameSegment::TYPE_VLAN_TAG:
@@ -539,10 +526,10 @@ string EthernetWaveform::GetText(size_t i)
 
 				snprintf(tmp, sizeof(tmp), "VLAN %d, PCP %d",
 					tag & 0xfff, tag >> 13);
-				string sret = tmp;
+				out = tmp;
 				if(tag & 0x1000)
-					sret += ", DE";
-				return sret;
+					out += ", DE";
+				return;
 			}
 			break;
 
@@ -550,9 +537,12 @@ string EthernetWaveform::GetText(size_t i)
 		case EthernetFrameSegment::TYPE_ETHERTYPE:
 			{
 				if(sample.m_data.size() != 2)
-					return "[invalid Ethertype length]";
+				{
+					out = "[invalid Ethertype length]";
+					return;
+				}
 
-				string type = "Type: ";
+				out = "Type: ";
 
 				uint16_t ethertype = (sample.m_data[0] << 8) | sample.m_data[1];
 
@@ -564,12 +554,12 @@ string EthernetWaveform::GetText(size_t i)
 					{
 						auto& next = m_samples[i+1];
 						if(next.m_data[0] == 0x42)
-							type += "STP";
+							out += "STP";
 						else
-							type += "LLC";
+							out += "LLC";
 					}
 					else
-						type += "LLC";
+						out += "LLC";
 				}
 
 				else
@@ -577,48 +567,48 @@ string EthernetWaveform::GetText(size_t i)
 					switch(ethertype)
 					{
 						case 0x0800:
-							type += "IPv4";
+							out += "IPv4";
 							break;
 
 						case 0x0806:
-							type += "ARP";
+							out += "ARP";
 							break;
 
 						case 0x8100:
-							type += "802.1q";
+							out += "802.1q";
 							break;
 
 						case 0x86dd:
-							type += "IPv6";
+							out += "IPv6";
 							break;
 
 						case 0x88cc:
-							type += "LLDP";
+							out += "LLDP";
 							break;
 
 						case 0x88f7:
-							type += "PTP";
+							out += "PTP";
 							break;
 
 						default:
 							snprintf(tmp, sizeof(tmp), "0x%04x", ethertype);
-							type += tmp;
+							out += tmp;
 							break;
 					}
 				}
 
-				return type;
+				return;
 			}
 
 		case EthernetFrameSegment::TYPE_PAYLOAD:
 			{
-				string ret;
+				out.clear();
 				for(auto b : sample.m_data)
 				{
 					snprintf(tmp, sizeof(tmp), "%02x ", b);
-					ret += tmp;
+					out += tmp;
 				}
-				return ret;
+				return;
 			}
 
 		case EthernetFrameSegment::TYPE_INBAND_STATUS:
@@ -640,33 +630,53 @@ string EthernetWaveform::GetText(size_t i)
 					duplex ? "full" : "half",
 					speed
 					);
-				return tmp;
+				out = tmp;
+				return;
 			}
 
 		case EthernetFrameSegment::TYPE_FCS_GOOD:
 		case EthernetFrameSegment::TYPE_FCS_BAD:
 			{
 				if(sample.m_data.size() != 4)
-					return "[invalid FCS length]";
+				{
+					out = "[invalid FCS length]";
+					return;
+				}
 
 				snprintf(tmp, sizeof(tmp), "CRC: %02x%02x%02x%02x",
 					sample.m_data[0],
 					sample.m_data[1],
 					sample.m_data[2],
 					sample.m_data[3]);
-				return tmp;
+				out = tmp;
+				return;
 			}
 
 		case EthernetFrameSegment::TYPE_LOCAL_FAULT:
-			return "Local Fault";
+			out = "Local Fault";
+			return;
 		case EthernetFrameSegment::TYPE_REMOTE_FAULT:
-			return "Remote Fault";
+			out = "Remote Fault";
+			return;
 		case EthernetFrameSegment::TYPE_LINK_INTERRUPTION:
-			return "Link Interruption";
+			out = "Link Interruption";
+			return;
 
 		default:
 			break;
 	}
 
-	return "";
+	out.clear();
+}
+
+string EthernetWaveform::GetText(size_t i)
+{
+	string ret;
+	FormatText(i, ret);
+	return ret;
+}
+
+std::string EthernetWaveform::GetColor(size_t i)
+{
+	return ProtocolPalette::GetString(GetColorIndex(i));
 }
@@ -99,18 +99,21 @@ void EthernetRGMIIDecoder::Refresh()
 	auto clk = GetInputWaveform(1);
 	auto ctl = GetInputWaveform(2);
 
-	//Sample everything on the clock edges
-	SparseDigitalWaveform dctl;
-	SparseDigitalBusWaveform ddata;
-	SampleOnAnyEdgesBase(ctl, clk, dctl);
-	SampleOnAnyEdgesBase(data, clk, ddata);
-
-	dctl.PrepareForCpuAccess();
-	ddata.PrepareForCpuAccess();
+	//Sample everything on the clock edges: CTL in bit 0, data nibble in bits 4:1
+	SparseWaveform<uint64_t> samples;
+	if(!SampleMultipleOnEdges({ctl, data}, clk, samples, CLOCK_EDGE_ANY))
+	{
+		SetData(NULL, 0);
+		return;
+	}
+	auto& offsets = samples.m_offsets;
+	auto& durations = samples.m_durations;
+	auto ctlbit = [&](size_t n) { return (samples.m_samples[n] & 1) != 0; };
+	auto nibble = [&](size_t n) { return (uint8_t)((samples.m_samples[n] >> 1) & 0xf); };
 
 	//Need a reasonable number of samples or there's no point in decoding.
 	//Cut off the last few samples because we might be either DDR or SDR and need to seek past our current position.
-	size_t len = min(dctl.size(), ddata.size());
+	size_t len = samples.size();
 	if(len < 100)
 	{
 		SetData(NULL, 0);
@@ -129,15 +132,10 @@ void EthernetRGMIIDecoder::Refresh()
 	for(size_t i=2; i < len; i++)
 	{
 		//Not sending a frame. Decode in-band status
-		if(!dctl.m_samples[i])
+		if(!ctlbit(i))
 		{
 			//Extract in-band status
-			uint8_t status = 0;
-			for(size_t j=0; j<4; j++)
-			{
-				if(ddata.m_samples[i][j])
-					status |= (1 << j);
-			}
+			uint8_t status = nibble(i);
 
 			//Same status? Merge samples
 			bool extend = false;
@@ -154,11 +152,11 @@ void EthernetRGMIIDecoder::Refresh()
 
 			//Decode
 			if(extend)
-				cap->m_durations[last] = ddata.m_offsets[i] + ddata.m_durations[i] - cap->m_offsets[last];
+				cap->m_durations[last] = offsets[i] + durations[i] - cap->m_offsets[last];
 			else
 			{
-				cap->m_offsets.push_back(ddata.m_offsets[i]);
-				cap->m_durations.push_back(ddata.m_durations[i]);
+				cap->m_offsets.push_back(offsets[i]);
+				cap->m_durations.push_back(durations[i]);
 				cap->m_samples.push_back(EthernetFrameSegment(EthernetFrameSegment::TYPE_INBAND_STATUS, status));
 			}
 
@@ -169,7 +167,7 @@ void EthernetRGMIIDecoder::Refresh()
 		//Figure out the clock period.
 		//Need to do this cycle-by-cycle in case the link speed changes during a deep capture
 		//TODO: alert if clock isn't close to one of the three legal frequencies
-		int64_t clkperiod = dctl.m_offsets[i] - dctl.m_offsets[i-2];
+		int64_t clkperiod = offsets[i] - offsets[i-2];
 		bool ddr = false;			//Default to 2.5/25 MHz SDR.
 		if(clkperiod < 10000000)	//Faster than 100 MHz? assume it's 125 MHz DDR.
 			ddr = true;
@@ -180,48 +178,26 @@ void EthernetRGMIIDecoder::Refresh()
 		vector<uint64_t> ends;
 
 		//TODO: handle error signal (ignored for now)
-		while( (i < len) && (dctl.m_samples[i]) )
+		while( (i < len) && ctlbit(i) )
 		{
 			//Start time
-			starts.push_back(ddata.m_offsets[i]);
+			starts.push_back(offsets[i]);
 
 			if(ddr)
 			{
-				//Convert bits to bytes
-				uint8_t dval = 0;
-				for(size_t j=0; j<8; j++)
-				{
-					if(j < 4)
-					{
-						if(ddata.m_samples[i][j])
-							dval |= (1 << j);
-					}
-					else if(ddata.m_samples[i+1][j-4])
-						dval |= (1 << j);
-				}
-				bytes.push_back(dval);
+				//Low nibble on this edge, high nibble on the next
+				bytes.push_back(nibble(i) | (nibble(i+1) << 4));
 
-				ends.push_back(ddata.m_offsets[i+1] + ddata.m_durations[i+1]);
+				ends.push_back(offsets[i+1] + durations[i+1]);
 				i += 2;
 			}
 
 			else
 			{
-				//Convert bits to bytes
-				uint8_t dval = 0;
-				for(size_t j=0; j<8; j++)
-				{
-					if(j < 4)
-					{
-						if(ddata.m_samples[i][j])
-							dval |= (1 << j);
-					}
-					else if(ddata.m_samples[i+2][j-4])
-						dval |= (1 << j);
-				}
-				bytes.push_back(dval);
+				//Low nibble on this rising edge, high nibble on the next
+				bytes.push_back(nibble(i) | (nibble(i+2) << 4));
 
-				ends.push_back(ddata.m_offsets[i+3] + ddata.m_durations[i+3]);
+				ends.push_back(offsets[i+3] + durations[i+3]);
 				i += 4;
 			}
 		}
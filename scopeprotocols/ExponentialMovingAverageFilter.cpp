@@ -118,10 +118,11 @@ void ExponentialMovingAverageFilter::Refresh(vk::raii::CommandBuffer& /*cmdBuf*/
 	//Sparse path
 	if(sdin)
 	{
-		//No data? Just copy
-		if(!scap)
+		//No data (or acquisition setup changed)? Just copy
+		if(!scap || (scap->size() != len) )
 		{
-			scap = new SparseAnalogWaveform;
+			if(!scap)
+				scap = new SparseAnalogWaveform;
 			scap->Resize(din->size());
 			cap = scap;
 
@@ -134,8 +135,10 @@ void ExponentialMovingAverageFilter::Refresh(vk::raii::CommandBuffer& /*cmdBuf*/
 			auto pin = sdin->m_samples.GetCpuPointer();
 			auto pout = scap->m_samples.GetCpuPointer();
 
-			for(size_t i=0; i<len; i++)
+			ThreadPool::GetDefault().ParallelFor(0, len, [&](size_t i)
+			{
 				pout[i] = pout[i]*decay + pin[i]*(1-decay);
+			}, len > 100000);
 		}
 
 		//Either way we want to reuse the timestamps
@@ -145,10 +148,11 @@ void ExponentialMovingAverageFilter::Refresh(vk::raii::CommandBuffer& /*cmdBuf*/
 	//Uniform path
 	else
 	{
-		//No data? Just copy
-		if(!ucap)
+		//No data (or acquisition setup changed)? Just copy
+		if(!ucap || (ucap->size() != len) )
 		{
-			ucap = new UniformAnalogWaveform;
+			if(!ucap)
+				ucap = new UniformAnalogWaveform;
 			ucap->Resize(din->size());
 			cap = ucap;
 
@@ -161,8 +165,10 @@ void ExponentialMovingAverageFilter::Refresh(vk::raii::CommandBuffer& /*cmdBuf*/
 			auto pin = udin->m_samples.GetCpuPointer();
 			auto pout = ucap->m_samples.GetCpuPointer();
 
-			for(size_t i=0; i<len; i++)
+			ThreadPool::GetDefault().ParallelFor(0, len, [&](size_t i)
+			{
 				pout[i] = pout[i]*decay + pin[i]*(1-decay);
+			}, len > 100000);
 		}
 	}
 
@@ -166,9 +166,10 @@ void FSKDecoder::Refresh()
 	//Optimized inner loop if no hysteresis
 	if(hys == 0)
 	{
-		#pragma omp parallel for
-		for(size_t i=0; i<len; i++)
+		ThreadPool::GetDefault().ParallelFor(0, len, [&](size_t i)
+		{
 			cap->m_samples[i] = din->m_samples[i] > midpoint;
+		});
 	}
 	else
 	{
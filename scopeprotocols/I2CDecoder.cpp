@@ -119,7 +119,7 @@ void I2CDecoder::InnerLoop(T* sda, U* scl, I2CWaveform* cap)
 				if(pack)
 				{
 					pack->m_len = timestamp - pack->m_offset;
-					pack->m_headers["Len"] = to_string(pack->m_data.size());
+					pack->SetHeaderDecimal("Len", pack->m_data.size());
 					m_packets.push_back(pack);
 					pack = nullptr;
 				}
@@ -136,7 +136,7 @@ void I2CDecoder::InnerLoop(T* sda, U* scl, I2CWaveform* cap)
 			if(pack)
 			{
 				pack->m_data.clear();
-				pack->m_headers.clear();
+				pack->ClearHeaders();
 			}
 			else
 				pack = new Packet;
@@ -177,7 +177,7 @@ void I2CDecoder::InnerLoop(T* sda, U* scl, I2CWaveform* cap)
 			if(pack)
 			{
 				pack->m_len = timestamp - pack->m_offset;
-				pack->m_headers["Len"] = to_string(pack->m_data.size());
+				pack->SetHeaderDecimal("Len", pack->m_data.size());
 				m_packets.push_back(pack);
 				pack = nullptr;
 			}
@@ -214,15 +214,15 @@ void I2CDecoder::InnerLoop(T* sda, U* scl, I2CWaveform* cap)
 
 						if(pack)
 						{
-							pack->m_headers["Address"] = to_string_hex(current_byte & 0xfe);
+							pack->SetHeaderHex("Address", current_byte & 0xfe, 0);
 							if(current_byte & 1)
 							{
-								pack->m_headers["Op"] = "Read";
+								pack->SetHeader("Op", "Read");
 								pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_DATA_READ];
 							}
 							else
 							{
-								pack->m_headers["Op"] = "Write";
+								pack->SetHeader("Op", "Write");
 								pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_DATA_WRITE];
 							}
 						}
@@ -324,65 +324,73 @@ void I2CDecoder::Refresh()
 	cap->MarkModifiedFromCpu();
 }
 
-std::string I2CWaveform::GetColor(size_t i)
+uint16_t I2CWaveform::GetColorIndex(size_t i)
 {
 	const I2CSymbol& s = m_samples[i];
 
 	switch(s.m_stype)
 	{
 		case I2CSymbol::TYPE_ERROR:
-			return StandardColors::colors[StandardColors::COLOR_ERROR];
+			return ProtocolPalette::GetStandardColor(StandardColors::COLOR_ERROR);
 		case I2CSymbol::TYPE_ADDRESS:
-			return StandardColors::colors[StandardColors::COLOR_ADDRESS];
+			return ProtocolPalette::GetStandardColor(StandardColors::COLOR_ADDRESS);
 		case I2CSymbol::TYPE_DATA:
-			return StandardColors::colors[StandardColors::COLOR_DATA];
+			return ProtocolPalette::GetStandardColor(StandardColors::COLOR_DATA);
 
 		case I2CSymbol::TYPE_ACK:
 			if(s.m_data)
-				return StandardColors::colors[StandardColors::COLOR_IDLE];
+				return ProtocolPalette::GetStandardColor(StandardColors::COLOR_IDLE);
 			else
-				return StandardColors::colors[StandardColors::COLOR_CHECKSUM_OK];
+				return ProtocolPalette::GetStandardColor(StandardColors::COLOR_CHECKSUM_OK);
 
 		default:
-			return StandardColors::colors[StandardColors::COLOR_CONTROL];
+			return ProtocolPalette::GetStandardColor(StandardColors::COLOR_CONTROL);
 	}
 }
 
-string I2CWaveform::GetText(size_t i)
+void I2CWaveform::FormatText(size_t i, string& out)
 {
 	const I2CSymbol& s = m_samples[i];
 
 	char tmp[32];
 	switch(s.m_stype)
 	{
-		case I2CSymbol::TYPE_NONE:
-		case I2CSymbol::TYPE_ERROR:
-			snprintf(tmp, sizeof(tmp), "ERR");
-			break;
 		case I2CSymbol::TYPE_START:
-			snprintf(tmp, sizeof(tmp), "START");
+			out = "START";
 			break;
 		case I2CSymbol::TYPE_RESTART:
-			snprintf(tmp, sizeof(tmp), "RESTART");
+			out = "RESTART";
 			break;
 		case I2CSymbol::TYPE_STOP:
-			snprintf(tmp, sizeof(tmp), "STOP");
+			out = "STOP";
 			break;
 		case I2CSymbol::TYPE_ACK:
-			if(s.m_data)
-				snprintf(tmp, sizeof(tmp), "NAK");
-			else
-				snprintf(tmp, sizeof(tmp), "ACK");
+			out = s.m_data ? "NAK" : "ACK";
 			break;
 		case I2CSymbol::TYPE_ADDRESS:
-			if(s.m_data & 1)
-				snprintf(tmp, sizeof(tmp), "R:%02x", s.m_data & 0xfe);
-			else
-				snprintf(tmp, sizeof(tmp), "W:%02x", s.m_data & 0xfe);
+			snprintf(tmp, sizeof(tmp), "%c:%02x", (s.m_data & 1) ? 'R' : 'W', s.m_data & 0xfe);
+			out = tmp;
 			break;
 		case I2CSymbol::TYPE_DATA:
 			snprintf(tmp, sizeof(tmp), "%02x", s.m_data);
+			out = tmp;
+			break;
+		case I2CSymbol::TYPE_NONE:
+		case I2CSymbol::TYPE_ERROR:
+		default:
+			out = "ERR";
 			break;
 	}
-	return string(tmp);
+}
+
+string I2CWaveform::GetText(size_t i)
+{
+	string ret;
+	FormatText(i, ret);
+	return ret;
+}
+
+std::string I2CWaveform::GetColor(size_t i)
+{
+	return ProtocolPalette::GetString(GetColorIndex(i));
 }
@@ -76,6 +76,8 @@ public:
 	I2CWaveform () : SparseWaveform<I2CSymbol>() {};
 	virtual std::string GetText(size_t) override;
 	virtual std::string GetColor(size_t) override;
+	virtual void FormatText(size_t i, std::string& out) override;
+	virtual uint16_t GetColorIndex(size_t i) override;
 };
 
 class I2CDecoder : public PacketDecoder
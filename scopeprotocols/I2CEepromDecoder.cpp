@@ -194,7 +194,7 @@ void I2CEepromDecoder::Refresh()
 					if(pack)
 					{
 						pack->m_data.clear();
-						pack->m_headers.clear();
+						pack->ClearHeaders();
 					}
 					else
 						pack = new Packet;
@@ -587,7 +587,7 @@ string I2CEepromWaveform::GetText(size_t i)
 bool I2CEepromDecoder::CanMerge(Packet* first, Packet* /*cur*/, Packet* next)
 {
 	//Merge polling packets
-	if( (first->m_headers["Type"].find("Poll") == 0) && (next->m_headers["Type"].find("Poll") == 0 ) )
+	if( (first->GetHeader("Type").find("Poll") == 0) && (next->GetHeader("Type").find("Poll") == 0 ) )
 		return true;
 
 	return false;
@@ -595,7 +595,7 @@ bool I2CEepromDecoder::CanMerge(Packet* first, Packet* /*cur*/, Packet* next)
 
 Packet* I2CEepromDecoder::CreateMergedHeader(Packet* pack, size_t /*i*/)
 {
-	if(pack->m_headers["Type"].find("Poll")  == 0)
+	if(pack->GetHeader("Type").find("Poll")  == 0)
 	{
 		Packet* ret = new Packet;
 		ret->m_offset = pack->m_offset;
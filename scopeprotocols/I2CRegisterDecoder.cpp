@@ -144,7 +144,7 @@ void I2CRegisterDecoder::Refresh()
 					if(pack)
 					{
 						pack->m_data.clear();
-						pack->m_headers.clear();
+						pack->ClearHeaders();
 					}
 					else
 						pack = new Packet;
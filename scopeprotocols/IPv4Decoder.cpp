@@ -37,9 +37,8 @@ using namespace std;
 // Construction / destruction
 
 IPv4Decoder::IPv4Decoder(const string& color)
-	: Filter(color, CAT_SERIAL)
+	: PacketDecoder(color, CAT_SERIAL)
 {
-	AddProtocolStream("data");
 	CreateInput("eth");
 }
 
@@ -65,11 +64,27 @@ string IPv4Decoder::GetProtocolName()
 	return "IPv4";
 }
 
+vector<string> IPv4Decoder::GetHeaders()
+{
+	vector<string> ret;
+	ret.push_back("Source");
+	ret.push_back("Dest");
+	ret.push_back("Protocol");
+	ret.push_back("TTL");
+	ret.push_back("ID");
+	ret.push_back("Flags");
+	ret.push_back("Frag Offset");
+	ret.push_back("Length");
+	return ret;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Actual decoder logic
 
 void IPv4Decoder::Refresh()
 {
+	ClearPackets();
+
 	if(!VerifyAllInputsOK())
 	{
 		SetData(NULL, 0);
@@ -79,330 +94,215 @@ void IPv4Decoder::Refresh()
 	//Get the input data
 	auto din = dynamic_cast<EthernetWaveform*>(GetInputWaveform(0));
 	din->PrepareForCpuAccess();
-	size_t len = din->m_samples.size();
 
-	//Loop over the events and process stuff
 	auto cap = new IPv4Waveform;
 	cap->PrepareForCpuAccess();
 	cap->m_timescale = din->m_timescale;
+	cap->m_triggerPhase = din->m_triggerPhase;
 	cap->m_startTimestamp = din->m_startTimestamp;
 	cap->m_startFemtoseconds = din->m_startFemtoseconds;
 
-	int state = 0;
-	int header_len = 0;
-	for(size_t i=0; i<len; i++)
+	//Pull out each frame's payload as a byte array, then decode the header from that
+	ForEachEthernetPayload(din, [&](EthernetPayload& payload)
 	{
-		auto s = din->m_samples[i];
-		int64_t halfdur = din->m_durations[i]/2;
-
-		switch(state)
-		{
-			//Wait for SFD. Ignore any errors, preambles, etc before this
-			case 0:
-				if(s.m_type == EthernetFrameSegment::TYPE_SFD)
-					state = 1;
-				break;
-
-			//Next should be dest MAC. Ignore it
-			case 1:
-				if(s.m_type == EthernetFrameSegment::TYPE_DST_MAC)
-					state = 2;
-				else
-					state = 0;
-				break;
-
-			//Then source MAC
-			case 2:
-				if(s.m_type == EthernetFrameSegment::TYPE_SRC_MAC)
-					state = 3;
-				else
-					state = 0;
-				break;
-
-			//Next is ethertype. Could be 802.1q or IPv4.
-			case 3:
-				if(s.m_type == EthernetFrameSegment::TYPE_ETHERTYPE)
-				{
-					uint16_t ethertype = (s.m_data[0] << 8) | s.m_data[1];
-
-					//802.1q tag
-					if(ethertype == 0x8100)
-						state = 4;
-
-					//IPv4
-					else if(ethertype == 0x0800)
-						state = 5;
-
-					//Something else, discard the packet as uninteresting
-					else
-						state = 0;
-				}
-				else
-					state = 0;
-
-				break;
-
-			//802.1q frame? Expect a VLAN tag, then look for the real ethertyoe
-			case 4:
-				if(s.m_type == EthernetFrameSegment::TYPE_VLAN_TAG)
-					state = 3;
-				else
-					state = 0;
-				break;
+		if(payload.m_ethertype == 0x0800)
+			DecodeDatagram(payload, cap, din->m_timescale, din->m_triggerPhase);
+	});
 
-			//Should be IP version and header length
-			case 5:
-				if(s.m_type == EthernetFrameSegment::TYPE_PAYLOAD)
-				{
-					uint8_t data = s.m_data[0];
+	SetData(cap, 0);
+	cap->MarkModifiedFromCpu();
+}
 
-					//Expect 0x4-something for IP version
-					if( (data >> 4) == 4)
-					{
-						cap->m_offsets.push_back(din->m_offsets[i]);
-						cap->m_durations.push_back(halfdur);
-						cap->m_samples.push_back(IPv4Symbol(IPv4Symbol::TYPE_VERSION, 4));
-					}
-					else
-					{
-						state = 0;
-						break;
-					}
+/**
+	@brief Decodes a single IPv4 datagram from the payload of an Ethernet frame
+ */
+void IPv4Decoder::DecodeDatagram(const EthernetPayload& payload, IPv4Waveform* cap, int64_t timescale, int64_t phase)
+{
+	auto& b = payload.m_bytes;
+	auto& off = payload.m_offsets;
+	auto& dur = payload.m_durations;
 
-					//Header length
-					header_len = data & 0xf;
+	//Expect 0x4-something for IP version, and at least a minimum size header
+	if( (b.size() < 20) || ( (b[0] >> 4) != 4) )
+		return;
 
-					cap->m_offsets.push_back(din->m_offsets[i] + halfdur);
-					cap->m_durations.push_back(halfdur);
-					cap->m_samples.push_back(IPv4Symbol(IPv4Symbol::TYPE_HEADER_LEN, header_len));
+	//Adds a symbol spanning bytes [first, first+n)
+	auto add = [&](IPv4Symbol::SegmentType type, size_t first, size_t n)
+	{
+		IPv4Symbol sym;
+		sym.m_type = type;
+		sym.m_data.assign(b.begin() + first, b.begin() + first + n);
+		cap->m_offsets.push_back(off[first]);
+		cap->m_durations.push_back(off[first+n-1] + dur[first+n-1] - off[first]);
+		cap->m_samples.push_back(sym);
+	};
+
+	//Adds a symbol in the first or second half of byte i
+	auto addHalf = [&](IPv4Symbol::SegmentType type, size_t i, bool second, uint8_t value)
+	{
+		int64_t halfdur = dur[i] / 2;
+		cap->m_offsets.push_back(off[i] + (second ? halfdur : 0));
+		cap->m_durations.push_back(halfdur);
+		cap->m_samples.push_back(IPv4Symbol(type, value));
+	};
+
+	size_t header_len = (b[0] & 0xf) * 4;
+	addHalf(IPv4Symbol::TYPE_VERSION, 0, false, 4);
+	addHalf(IPv4Symbol::TYPE_HEADER_LEN, 0, true, b[0] & 0xf);
+	if( (header_len < 20) || (header_len > b.size()) )
+	{
+		add(IPv4Symbol::TYPE_ERROR, 1, b.size() - 1);
+		return;
+	}
 
-					state = 6;
-				}
-				else
-					state = 0;
+	//Total length tells us where the datagram ends (anything after that is Ethernet padding)
+	size_t total_len = (b[2] << 8) | b[3];
+	if(total_len < header_len)
+	{
+		add(IPv4Symbol::TYPE_ERROR, 1, b.size() - 1);
+		return;
+	}
+	size_t end = min(total_len, b.size());
+
+	InternetChecksum sum;
+	sum.Add(&b[0], header_len);
+	bool checksumOK = sum.IsValid();
+
+	add(IPv4Symbol::TYPE_DIFFSERV, 1, 1);
+	add(IPv4Symbol::TYPE_LENGTH, 2, 2);
+	add(IPv4Symbol::TYPE_ID, 4, 2);
+	addHalf(IPv4Symbol::TYPE_FLAGS, 6, false, b[6] >> 5);
+
+	//Frag offset runs from the second half of byte 6 to the end of byte 7
+	IPv4Symbol frag(IPv4Symbol::TYPE_FRAG_OFFSET, b[6] & 0x1f);
+	frag.m_data.push_back(b[7]);
+	cap->m_offsets.push_back(off[6] + dur[6]/2);
+	cap->m_durations.push_back(off[7] + dur[7] - (off[6] + dur[6]/2));
+	cap->m_samples.push_back(frag);
+
+	add(IPv4Symbol::TYPE_TTL, 8, 1);
+	add(IPv4Symbol::TYPE_PROTOCOL, 9, 1);
+	add(checksumOK ? IPv4Symbol::TYPE_HEADER_CHECKSUM : IPv4Symbol::TYPE_HEADER_CHECKSUM_BAD, 10, 2);
+	add(IPv4Symbol::TYPE_SOURCE_IP, 12, 4);
+	add(IPv4Symbol::TYPE_DEST_IP, 16, 4);
+	for(size_t i=20; i<header_len; i++)
+		add(IPv4Symbol::TYPE_OPTIONS, i, 1);
+	for(size_t i=header_len; i<end; i++)
+		add(IPv4Symbol::TYPE_DATA, i, 1);
+
+	//Packet decode
+	auto pack = new Packet;
+	pack->m_offset = off[0] * timescale + phase;
+	pack->m_len = (off[end-1] + dur[end-1] - off[0]) * timescale;
+	pack->SetHeader("Source", IPAddress::FromIPv4(&b[12]).ToString());
+	pack->SetHeader("Dest", IPAddress::FromIPv4(&b[16]).ToString());
+
+	auto name = GetIPProtocolName(b[9]);
+	if(name)
+		pack->SetHeader("Protocol", name);
+	else
+		pack->SetHeaderHex("Protocol", b[9], 2);
+
+	pack->SetHeaderDecimal("TTL", b[8]);
+	pack->SetHeaderHex("ID", (b[4] << 8) | b[5], 4);
+
+	bool df = (b[6] & 0x40);
+	bool mf = (b[6] & 0x20);
+	if(df && mf)
+		pack->SetHeader("Flags", "DF MF");
+	else if(df)
+		pack->SetHeader("Flags", "DF");
+	else if(mf)
+		pack->SetHeader("Flags", "MF");
+
+	size_t fragOffset = 8 * ( ( (b[6] & 0x1f) << 8) | b[7]);
+	if(mf || fragOffset)
+		pack->SetHeaderDecimal("Frag Offset", fragOffset);
+	pack->SetHeaderDecimal("Length", total_len);
+
+	pack->m_data.assign(b.begin() + header_len, b.begin() + end);
+
+	if(!checksumOK || (total_len > b.size()) )
+		pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_ERROR];
+	else if(mf || fragOffset)
+		pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_STATUS];
+	else
+		pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_DATA_READ];
+	m_packets.push_back(pack);
+}
 
-				break;
+/**
+	@brief Pulls every datagram (or fragment) back out of the decoded symbols
+ */
+void IPv4Waveform::GetDatagrams(vector<IPDatagram>& out)
+{
+	IPDatagram* cur = nullptr;
+	for(size_t i=0; i<m_samples.size(); i++)
+	{
+		auto& s = m_samples[i];
+		if(s.m_type == IPv4Symbol::TYPE_VERSION)
+		{
+			out.emplace_back();
+			cur = &out.back();
+			cur->m_version = 4;
+			continue;
+		}
+		if(!cur)
+			continue;
 
-			//Diffserv code point and ECN
-			case 6:
-				if(s.m_type == EthernetFrameSegment::TYPE_PAYLOAD)
-				{
-					cap->m_offsets.push_back(din->m_offsets[i]);
-					cap->m_durations.push_back(din->m_durations[i]);
-					cap->m_samples.push_back(IPv4Symbol(IPv4Symbol::TYPE_DIFFSERV, s.m_data[0]));
-					state = 7;
-				}
-				else
-					state = 0;
+		switch(s.m_type)
+		{
+			case IPv4Symbol::TYPE_ID:
+				cur->m_id = (s.m_data[0] << 8) | s.m_data[1];
 				break;
 
-			//Total length
-			case 7:
-				if(s.m_type == EthernetFrameSegment::TYPE_PAYLOAD)
-				{
-					cap->m_offsets.push_back(din->m_offsets[i]);
-					cap->m_durations.push_back(din->m_durations[i]);
-					cap->m_samples.push_back(IPv4Symbol(IPv4Symbol::TYPE_LENGTH, s.m_data[0]));
-					state = 8;
-				}
-				else
-					state = 0;
-				break;
-			case 8:
-				if(s.m_type == EthernetFrameSegment::TYPE_PAYLOAD)
-				{
-					//Append to the previous sample
-					size_t n = cap->m_offsets.size() - 1;
-					cap->m_durations[n] = din->m_offsets[i] + din->m_durations[i] - cap->m_offsets[n];
-					cap->m_samples[n].m_data.push_back(s.m_data[0]);
-					state = 9;
-				}
-				else
-					state = 0;
+			case IPv4Symbol::TYPE_FLAGS:
+				cur->m_moreFragments = (s.m_data[0] & 1);
 				break;
 
-			//Identification
-			case 9:
-				if(s.m_type == EthernetFrameSegment::TYPE_PAYLOAD)
-				{
-					cap->m_offsets.push_back(din->m_offsets[i]);
-					cap->m_durations.push_back(din->m_durations[i]);
-					cap->m_samples.push_back(IPv4Symbol(IPv4Symbol::TYPE_ID, s.m_data[0]));
-					state = 10;
-				}
-				else
-					state = 0;
-				break;
-			case 10:
-				if(s.m_type == EthernetFrameSegment::TYPE_PAYLOAD)
-				{
-					//Append to the previous sample
-					size_t n = cap->m_offsets.size() - 1;
-					cap->m_durations[n] = din->m_offsets[i] + din->m_durations[i] - cap->m_offsets[n];
-					cap->m_samples[n].m_data.push_back(s.m_data[0]);
-					state = 11;
-				}
-				else
-					state = 0;
+			case IPv4Symbol::TYPE_FRAG_OFFSET:
+				cur->m_fragmentOffset = 8 * ( (s.m_data[0] << 8) | s.m_data[1]);
 				break;
 
-			//Flags, frag offset
-			case 11:
-				if(s.m_type == EthernetFrameSegment::TYPE_PAYLOAD)
-				{
-					//Flags
-					cap->m_offsets.push_back(din->m_offsets[i]);
-					cap->m_durations.push_back(halfdur);
-					cap->m_samples.push_back(IPv4Symbol(IPv4Symbol::TYPE_FLAGS, s.m_data[0] >> 5));
-
-					//Frag offset, high 5 bits
-					cap->m_offsets.push_back(din->m_offsets[i] + halfdur);
-					cap->m_durations.push_back(halfdur);
-					cap->m_samples.push_back(IPv4Symbol(IPv4Symbol::TYPE_FRAG_OFFSET, s.m_data[0] & 0x1f));
-					state = 12;
-				}
-				else
-					state = 0;
-				break;
-			case 12:
-				if(s.m_type == EthernetFrameSegment::TYPE_PAYLOAD)
-				{
-					//Append to the previous sample
-					size_t n = cap->m_offsets.size() - 1;
-					cap->m_durations[n] = din->m_offsets[i] + din->m_durations[i] - cap->m_offsets[n];
-					cap->m_samples[n].m_data.push_back(s.m_data[0]);
-					state = 13;
-				}
-				else
-					state = 0;
+			case IPv4Symbol::TYPE_PROTOCOL:
+				cur->m_protocol = s.m_data[0];
 				break;
 
-			//TTL
-			case 13:
-				if(s.m_type == EthernetFrameSegment::TYPE_PAYLOAD)
-				{
-					cap->m_offsets.push_back(din->m_offsets[i]);
-					cap->m_durations.push_back(din->m_durations[i]);
-					cap->m_samples.push_back(IPv4Symbol(IPv4Symbol::TYPE_TTL, s.m_data[0]));
-					state = 14;
-				}
-				else
-					state = 0;
+			case IPv4Symbol::TYPE_HEADER_CHECKSUM_BAD:
+				cur->m_headerChecksumOK = false;
 				break;
 
-			//Protocol
-			case 14:
-				if(s.m_type == EthernetFrameSegment::TYPE_PAYLOAD)
-				{
-					cap->m_offsets.push_back(din->m_offsets[i]);
-					cap->m_durations.push_back(din->m_durations[i]);
-					cap->m_samples.push_back(IPv4Symbol(IPv4Symbol::TYPE_PROTOCOL, s.m_data[0]));
-					state = 15;
-				}
-				else
-					state = 0;
+			case IPv4Symbol::TYPE_SOURCE_IP:
+				cur->m_src = IPAddress::FromIPv4(&s.m_data[0]);
 				break;
 
-			//Header checksum
-			case 15:
-				if(s.m_type == EthernetFrameSegment::TYPE_PAYLOAD)
-				{
-					cap->m_offsets.push_back(din->m_offsets[i]);
-					cap->m_durations.push_back(din->m_durations[i]);
-					cap->m_samples.push_back(IPv4Symbol(IPv4Symbol::TYPE_HEADER_CHECKSUM, s.m_data[0]));
-					state = 16;
-				}
-				else
-					state = 0;
-				break;
-			case 16:
-				if(s.m_type == EthernetFrameSegment::TYPE_PAYLOAD)
-				{
-					//Append to the previous sample
-					size_t n = cap->m_offsets.size() - 1;
-					cap->m_durations[n] = din->m_offsets[i] + din->m_durations[i] - cap->m_offsets[n];
-					cap->m_samples[n].m_data.push_back(s.m_data[0]);
-					state = 17;
-				}
-				else
-					state = 0;
+			case IPv4Symbol::TYPE_DEST_IP:
+				cur->m_dst = IPAddress::FromIPv4(&s.m_data[0]);
 				break;
 
-			//Src IP
-			case 17:
-				if(s.m_type == EthernetFrameSegment::TYPE_PAYLOAD)
-				{
-					cap->m_offsets.push_back(din->m_offsets[i]);
-					cap->m_durations.push_back(din->m_durations[i]);
-					cap->m_samples.push_back(IPv4Symbol(IPv4Symbol::TYPE_SOURCE_IP, s.m_data[0]));
-					state = 18;
-				}
-				else
-					state = 0;
-				break;
-			case 18:
-			case 19:
-			case 20:
-				if(s.m_type == EthernetFrameSegment::TYPE_PAYLOAD)
+			case IPv4Symbol::TYPE_DATA:
 				{
-					//Append to the previous sample
-					size_t n = cap->m_offsets.size() - 1;
-					cap->m_durations[n] = din->m_offsets[i] + din->m_durations[i] - cap->m_offsets[n];
-					cap->m_samples[n].m_data.push_back(s.m_data[0]);
-					state++;
+					size_t n = s.m_data.size();
+					int64_t dur = m_durations[i] / n;
+					for(size_t j=0; j<n; j++)
+					{
+						cur->m_payload.push_back(s.m_data[j]);
+						cur->m_offsets.push_back(m_offsets[i] + j*dur);
+						cur->m_durations.push_back(dur);
+					}
 				}
-				else
-					state = 0;
 				break;
 
-			//Dst IP
-			case 21:
-				if(s.m_type == EthernetFrameSegment::TYPE_PAYLOAD)
-				{
-					cap->m_offsets.push_back(din->m_offsets[i]);
-					cap->m_durations.push_back(din->m_durations[i]);
-					cap->m_samples.push_back(IPv4Symbol(IPv4Symbol::TYPE_DEST_IP, s.m_data[0]));
-					state = 22;
-				}
-				else
-					state = 0;
+			//Malformed, throw it away
+			case IPv4Symbol::TYPE_ERROR:
+				out.pop_back();
+				cur = nullptr;
 				break;
-			case 22:
-			case 23:
-			case 24:
-				if(s.m_type == EthernetFrameSegment::TYPE_PAYLOAD)
-				{
-					//Append to the previous sample
-					size_t n = cap->m_offsets.size() - 1;
-					cap->m_durations[n] = din->m_offsets[i] + din->m_durations[i] - cap->m_offsets[n];
-					cap->m_samples[n].m_data.push_back(s.m_data[0]);
-					state++;
-				}
-				else
-					state = 0;
-				break;
-
-			//TODO: support header options
-			case 25:
-				if(s.m_type == EthernetFrameSegment::TYPE_PAYLOAD)
-				{
-					cap->m_offsets.push_back(din->m_offsets[i]);
-					cap->m_durations.push_back(din->m_durations[i]);
-					cap->m_samples.push_back(IPv4Symbol(IPv4Symbol::TYPE_DATA, s.m_data[0]));
-				}
 
-				//terminate the packet on FCS or error
-				else
-					state = 0;
+			default:
 				break;
-
 		}
 	}
-
-	//TODO: packet decode too
-
-	SetData(cap, 0);
-	cap->MarkModifiedFromCpu();
 }
 
 std::string IPv4Waveform::GetColor(size_t i)
@@ -423,10 +323,12 @@ std::string IPv4Waveform::GetColor(size_t i)
 		case IPv4Symbol::TYPE_OPTIONS:
 			return StandardColors::colors[StandardColors::COLOR_CONTROL];
 
-		//TODO: properly verify checksum
 		case IPv4Symbol::TYPE_HEADER_CHECKSUM:
 			return StandardColors::colors[StandardColors::COLOR_CHECKSUM_OK];
 
+		case IPv4Symbol::TYPE_HEADER_CHECKSUM_BAD:
+			return StandardColors::colors[StandardColors::COLOR_CHECKSUM_BAD];
+
 		case IPv4Symbol::TYPE_SOURCE_IP:
 		case IPv4Symbol::TYPE_DEST_IP:
 			return StandardColors::colors[StandardColors::COLOR_ADDRESS];
@@ -516,34 +418,16 @@ string IPv4Waveform::GetText(size_t i)
 			return string(tmp);
 
 		case IPv4Symbol::TYPE_PROTOCOL:
-			switch(sample.m_data[0])
 			{
-				case 0x01:
-					return "ICMP";
-				case 0x02:
-					return "IGMP";
-				case 0x06:
-					return "TCP";
-				case 0x11:
-					return "UDP";
-				case 0x2f:
-					return "GRE";
-				case 0x58:
-					return "EIGRP";
-				case 0x59:
-					return "OSPF";
-				case 0x73:
-					return "L2TP";
-				case 0x85:
-					return "FCoIP";
-
-				default:
-					snprintf(tmp, sizeof(tmp), "Protocol: 0x%02x", sample.m_data[0]);
-					return string(tmp);
+				auto name = GetIPProtocolName(sample.m_data[0]);
+				if(name)
+					return name;
+				snprintf(tmp, sizeof(tmp), "Protocol: 0x%02x", sample.m_data[0]);
+				return string(tmp);
 			}
-			break;
 
 		case IPv4Symbol::TYPE_HEADER_CHECKSUM:
+		case IPv4Symbol::TYPE_HEADER_CHECKSUM_BAD:
 			snprintf(tmp, sizeof(tmp), "Checksum: 0x%04x", (sample.m_data[0] << 8) | sample.m_data[1]);
 			return string(tmp);
 
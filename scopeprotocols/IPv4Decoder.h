@@ -35,6 +35,9 @@
 #ifndef IPv4Decoder_h
 #define IPv4Decoder_h
 
+#include "../scopehal/PacketDecoder.h"
+#include "InternetProtocol.h"
+
 class IPv4Symbol
 {
 public:
@@ -51,7 +54,8 @@ public:
 		TYPE_FRAG_OFFSET,
 		TYPE_TTL,
 		TYPE_PROTOCOL,
-		TYPE_HEADER_CHECKSUM,
+		TYPE_HEADER_CHECKSUM,		//header checksum, verified good
+		TYPE_HEADER_CHECKSUM_BAD,
 		TYPE_SOURCE_IP,
 		TYPE_DEST_IP,
 		TYPE_OPTIONS,
@@ -73,15 +77,19 @@ public:
 	}
 };
 
-class IPv4Waveform : public SparseWaveform<IPv4Symbol>
+class IPv4Waveform
+	: public SparseWaveform<IPv4Symbol>
+	, public IPDatagramSource
 {
 public:
 	IPv4Waveform () : SparseWaveform<IPv4Symbol>() {};
 	virtual std::string GetText(size_t) override;
 	virtual std::string GetColor(size_t) override;
+
+	virtual void GetDatagrams(std::vector<IPDatagram>& out) override;
 };
 
-class IPv4Decoder : public Filter
+class IPv4Decoder : public PacketDecoder
 {
 public:
 	IPv4Decoder(const std::string& color);
@@ -90,9 +98,13 @@ public:
 
 	static std::string GetProtocolName();
 
+	virtual std::vector<std::string> GetHeaders() override;
 	virtual bool ValidateChannel(size_t i, StreamDescriptor stream) override;
 
 	PROTOCOL_DECODER_INITPROC(IPv4Decoder)
+
+protected:
+	void DecodeDatagram(const EthernetPayload& payload, IPv4Waveform* cap, int64_t timescale, int64_t phase);
 };
 
 #endif
@@ -0,0 +1,453 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of IPv6Decoder
+ */
+
+#include "../scopehal/scopehal.h"
+#include "IPv6Decoder.h"
+#include "EthernetProtocolDecoder.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+IPv6Decoder::IPv6Decoder(const string& color)
+	: PacketDecoder(color, CAT_SERIAL)
+{
+	CreateInput("eth");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Factory methods
+
+bool IPv6Decoder::ValidateChannel(size_t i, StreamDescriptor stream)
+{
+	if(stream.m_channel == NULL)
+		return false;
+
+	if( (i == 0) && (dynamic_cast<EthernetWaveform*>(stream.m_channel->GetData(0)) != NULL) )
+		return true;
+
+	return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Accessors
+
+string IPv6Decoder::GetProtocolName()
+{
+	return "IPv6";
+}
+
+vector<string> IPv6Decoder::GetHeaders()
+{
+	vector<string> ret;
+	ret.push_back("Source");
+	ret.push_back("Dest");
+	ret.push_back("Protocol");
+	ret.push_back("Hop Limit");
+	ret.push_back("Flow Label");
+	ret.push_back("ID");
+	ret.push_back("Frag Offset");
+	ret.push_back("Length");
+	return ret;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Actual decoder logic
+
+void IPv6Decoder::Refresh()
+{
+	ClearPackets();
+
+	if(!VerifyAllInputsOK())
+	{
+		SetData(NULL, 0);
+		return;
+	}
+
+	//Get the input data
+	auto din = dynamic_cast<EthernetWaveform*>(GetInputWaveform(0));
+	din->PrepareForCpuAccess();
+
+	auto cap = new IPv6Waveform;
+	cap->PrepareForCpuAccess();
+	cap->m_timescale = din->m_timescale;
+	cap->m_triggerPhase = din->m_triggerPhase;
+	cap->m_startTimestamp = din->m_startTimestamp;
+	cap->m_startFemtoseconds = din->m_startFemtoseconds;
+
+	ForEachEthernetPayload(din, [&](EthernetPayload& payload)
+	{
+		if(payload.m_ethertype == 0x86dd)
+			DecodeDatagram(payload, cap, din->m_timescale, din->m_triggerPhase);
+	});
+
+	SetData(cap, 0);
+	cap->MarkModifiedFromCpu();
+}
+
+/**
+	@brief Decodes a single IPv6 datagram, including any extension headers, from the payload of an Ethernet frame
+ */
+void IPv6Decoder::DecodeDatagram(const EthernetPayload& payload, IPv6Waveform* cap, int64_t timescale, int64_t phase)
+{
+	auto& b = payload.m_bytes;
+	auto& off = payload.m_offsets;
+	auto& dur = payload.m_durations;
+
+	if( (b.size() < 40) || ( (b[0] >> 4) != 6) )
+		return;
+
+	//Adds a symbol spanning bytes [first, first+n)
+	auto add = [&](IPv6Symbol::SegmentType type, size_t first, size_t n)
+	{
+		IPv6Symbol sym;
+		sym.m_type = type;
+		sym.m_data.assign(b.begin() + first, b.begin() + first + n);
+		cap->m_offsets.push_back(off[first]);
+		cap->m_durations.push_back(off[first+n-1] + dur[first+n-1] - off[first]);
+		cap->m_samples.push_back(sym);
+	};
+
+	//Fixed header. Traffic class and flow label aren't byte aligned
+	cap->m_offsets.push_back(off[0]);
+	cap->m_durations.push_back(dur[0] / 2);
+	cap->m_samples.push_back(IPv6Symbol(IPv6Symbol::TYPE_VERSION, 6));
+
+	cap->m_offsets.push_back(off[0] + dur[0]/2);
+	cap->m_durations.push_back(off[1] + dur[1]/2 - (off[0] + dur[0]/2));
+	cap->m_samples.push_back(IPv6Symbol(IPv6Symbol::TYPE_TRAFFIC_CLASS, (b[0] << 4) | (b[1] >> 4)));
+
+	uint32_t flowLabel = ( (b[1] & 0xf) << 16) | (b[2] << 8) | b[3];
+	IPv6Symbol flow(IPv6Symbol::TYPE_FLOW_LABEL, b[1] & 0xf);
+	flow.m_data.push_back(b[2]);
+	flow.m_data.push_back(b[3]);
+	cap->m_offsets.push_back(off[1] + dur[1]/2);
+	cap->m_durations.push_back(off[3] + dur[3] - (off[1] + dur[1]/2));
+	cap->m_samples.push_back(flow);
+
+	add(IPv6Symbol::TYPE_LENGTH, 4, 2);
+	add(IPv6Symbol::TYPE_NEXT_HEADER, 6, 1);
+	add(IPv6Symbol::TYPE_HOP_LIMIT, 7, 1);
+	add(IPv6Symbol::TYPE_SOURCE_IP, 8, 16);
+	add(IPv6Symbol::TYPE_DEST_IP, 24, 16);
+
+	//Payload length tells us where the datagram ends (anything after that is Ethernet padding)
+	size_t payload_len = (b[4] << 8) | b[5];
+	size_t end = min(40 + payload_len, b.size());
+	bool error = (40 + payload_len > b.size());
+
+	//Walk the extension header chain
+	size_t pos = 40;
+	uint8_t next = b[6];
+	bool fragment = false;
+	uint32_t fragOffset = 0;
+	uint32_t id = 0;
+	bool mf = false;
+	while(true)
+	{
+		IPv6Symbol::SegmentType type;
+		switch(next)
+		{
+			case 0:
+				type = IPv6Symbol::TYPE_HOP_BY_HOP;
+				break;
+
+			case 43:
+				type = IPv6Symbol::TYPE_ROUTING;
+				break;
+
+			case 44:
+				type = IPv6Symbol::TYPE_FRAGMENT;
+				break;
+
+			case 60:
+				type = IPv6Symbol::TYPE_DEST_OPTIONS;
+				break;
+
+			//AH, mobility, HIP, shim6
+			case 51:
+			case 135:
+			case 139:
+			case 140:
+				type = IPv6Symbol::TYPE_EXT_HEADER;
+				break;
+
+			default:
+				type = IPv6Symbol::TYPE_DATA;
+				break;
+		}
+		if(type == IPv6Symbol::TYPE_DATA)
+			break;
+
+		//Fragment header is fixed size, AH counts in 32-bit words, everything else in 64-bit words
+		size_t hlen = 8;
+		if( (pos + 2 <= end) && (type != IPv6Symbol::TYPE_FRAGMENT) )
+		{
+			if(next == 51)
+				hlen = (b[pos+1] + 2) * 4;
+			else
+				hlen = (b[pos+1] + 1) * 8;
+		}
+		if(pos + hlen > end)
+		{
+			if(pos < end)
+				add(IPv6Symbol::TYPE_ERROR, pos, end - pos);
+			error = true;
+			pos = end;
+			break;
+		}
+
+		add(type, pos, hlen);
+		if(type == IPv6Symbol::TYPE_FRAGMENT)
+		{
+			fragment = true;
+			fragOffset = ( (b[pos+2] << 8) | b[pos+3]) & 0xfff8;
+			mf = (b[pos+3] & 1);
+			id = (b[pos+4] << 24) | (b[pos+5] << 16) | (b[pos+6] << 8) | b[pos+7];
+		}
+
+		next = b[pos];
+		pos += hlen;
+	}
+
+	for(size_t i=pos; i<end; i++)
+		add(IPv6Symbol::TYPE_DATA, i, 1);
+
+	//Packet decode
+	auto pack = new Packet;
+	pack->m_offset = off[0] * timescale + phase;
+	pack->m_len = (off[end-1] + dur[end-1] - off[0]) * timescale;
+	pack->SetHeader("Source", IPAddress::FromIPv6(&b[8]).ToString());
+	pack->SetHeader("Dest", IPAddress::FromIPv6(&b[24]).ToString());
+
+	auto name = GetIPProtocolName(next);
+	if(name)
+		pack->SetHeader("Protocol", name);
+	else
+		pack->SetHeaderHex("Protocol", next, 2);
+
+	pack->SetHeaderDecimal("Hop Limit", b[7]);
+	pack->SetHeaderHex("Flow Label", flowLabel, 5);
+	if(fragment)
+	{
+		pack->SetHeaderHex("ID", id, 8);
+		pack->SetHeaderDecimal("Frag Offset", fragOffset);
+	}
+	pack->SetHeaderDecimal("Length", payload_len);
+
+	pack->m_data.assign(b.begin() + pos, b.begin() + end);
+
+	if(error)
+		pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_ERROR];
+	else if(fragment && (mf || fragOffset) )
+		pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_STATUS];
+	else
+		pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_DATA_READ];
+	m_packets.push_back(pack);
+}
+
+/**
+	@brief Pulls every datagram (or fragment) back out of the decoded symbols
+ */
+void IPv6Waveform::GetDatagrams(vector<IPDatagram>& out)
+{
+	IPDatagram* cur = nullptr;
+	for(size_t i=0; i<m_samples.size(); i++)
+	{
+		auto& s = m_samples[i];
+		if(s.m_type == IPv6Symbol::TYPE_VERSION)
+		{
+			out.emplace_back();
+			cur = &out.back();
+			cur->m_version = 6;
+			continue;
+		}
+		if(!cur)
+			continue;
+
+		switch(s.m_type)
+		{
+			case IPv6Symbol::TYPE_SOURCE_IP:
+				cur->m_src = IPAddress::FromIPv6(&s.m_data[0]);
+				break;
+
+			case IPv6Symbol::TYPE_DEST_IP:
+				cur->m_dst = IPAddress::FromIPv6(&s.m_data[0]);
+				break;
+
+			//The protocol is whatever the last header in the chain says comes next
+			case IPv6Symbol::TYPE_NEXT_HEADER:
+			case IPv6Symbol::TYPE_HOP_BY_HOP:
+			case IPv6Symbol::TYPE_ROUTING:
+			case IPv6Symbol::TYPE_DEST_OPTIONS:
+			case IPv6Symbol::TYPE_EXT_HEADER:
+				cur->m_protocol = s.m_data[0];
+				break;
+
+			case IPv6Symbol::TYPE_FRAGMENT:
+				cur->m_protocol = s.m_data[0];
+				cur->m_fragmentOffset = ( (s.m_data[2] << 8) | s.m_data[3]) & 0xfff8;
+				cur->m_moreFragments = (s.m_data[3] & 1);
+				cur->m_id = (s.m_data[4] << 24) | (s.m_data[5] << 16) | (s.m_data[6] << 8) | s.m_data[7];
+				break;
+
+			case IPv6Symbol::TYPE_DATA:
+				{
+					size_t n = s.m_data.size();
+					int64_t dur = m_durations[i] / n;
+					for(size_t j=0; j<n; j++)
+					{
+						cur->m_payload.push_back(s.m_data[j]);
+						cur->m_offsets.push_back(m_offsets[i] + j*dur);
+						cur->m_durations.push_back(dur);
+					}
+				}
+				break;
+
+			//Malformed, throw it away
+			case IPv6Symbol::TYPE_ERROR:
+				out.pop_back();
+				cur = nullptr;
+				break;
+
+			default:
+				break;
+		}
+	}
+}
+
+std::string IPv6Waveform::GetColor(size_t i)
+{
+	switch(m_samples[i].m_type)
+	{
+		case IPv6Symbol::TYPE_VERSION:
+			return StandardColors::colors[StandardColors::COLOR_PREAMBLE];
+
+		case IPv6Symbol::TYPE_TRAFFIC_CLASS:
+		case IPv6Symbol::TYPE_FLOW_LABEL:
+		case IPv6Symbol::TYPE_LENGTH:
+		case IPv6Symbol::TYPE_NEXT_HEADER:
+		case IPv6Symbol::TYPE_HOP_LIMIT:
+		case IPv6Symbol::TYPE_HOP_BY_HOP:
+		case IPv6Symbol::TYPE_ROUTING:
+		case IPv6Symbol::TYPE_FRAGMENT:
+		case IPv6Symbol::TYPE_DEST_OPTIONS:
+		case IPv6Symbol::TYPE_EXT_HEADER:
+			return StandardColors::colors[StandardColors::COLOR_CONTROL];
+
+		case IPv6Symbol::TYPE_SOURCE_IP:
+		case IPv6Symbol::TYPE_DEST_IP:
+			return StandardColors::colors[StandardColors::COLOR_ADDRESS];
+
+		case IPv6Symbol::TYPE_DATA:
+			return StandardColors::colors[StandardColors::COLOR_DATA];
+
+		case IPv6Symbol::TYPE_ERROR:
+		default:
+			return StandardColors::colors[StandardColors::COLOR_ERROR];
+	}
+}
+
+string IPv6Waveform::GetText(size_t i)
+{
+	char tmp[128];
+	auto& sample = m_samples[i];
+
+	switch(sample.m_type)
+	{
+		case IPv6Symbol::TYPE_VERSION:
+			return "IPv6";
+
+		case IPv6Symbol::TYPE_TRAFFIC_CLASS:
+			snprintf(tmp, sizeof(tmp), "DSCP: %d ECN: %d", sample.m_data[0] >> 2, sample.m_data[0] & 3);
+			return string(tmp);
+
+		case IPv6Symbol::TYPE_FLOW_LABEL:
+			snprintf(tmp, sizeof(tmp), "Flow: %05x",
+				(sample.m_data[0] << 16) | (sample.m_data[1] << 8) | sample.m_data[2]);
+			return string(tmp);
+
+		case IPv6Symbol::TYPE_LENGTH:
+			snprintf(tmp, sizeof(tmp), "Len: %d", (sample.m_data[0] << 8) | sample.m_data[1]);
+			return string(tmp);
+
+		case IPv6Symbol::TYPE_NEXT_HEADER:
+			{
+				auto name = GetIPProtocolName(sample.m_data[0]);
+				if(name)
+					return name;
+				snprintf(tmp, sizeof(tmp), "Next: %d", sample.m_data[0]);
+				return string(tmp);
+			}
+
+		case IPv6Symbol::TYPE_HOP_LIMIT:
+			snprintf(tmp, sizeof(tmp), "Hops: %d", sample.m_data[0]);
+			return string(tmp);
+
+		case IPv6Symbol::TYPE_SOURCE_IP:
+			return string("From ") + IPAddress::FromIPv6(&sample.m_data[0]).ToString();
+
+		case IPv6Symbol::TYPE_DEST_IP:
+			return string("To ") + IPAddress::FromIPv6(&sample.m_data[0]).ToString();
+
+		case IPv6Symbol::TYPE_HOP_BY_HOP:
+			return "Hop-by-hop options";
+
+		case IPv6Symbol::TYPE_ROUTING:
+			return "Routing";
+
+		case IPv6Symbol::TYPE_FRAGMENT:
+			snprintf(tmp, sizeof(tmp), "Fragment: off %d%s",
+				( (sample.m_data[2] << 8) | sample.m_data[3]) & 0xfff8,
+				(sample.m_data[3] & 1) ? " MF" : "");
+			return string(tmp);
+
+		case IPv6Symbol::TYPE_DEST_OPTIONS:
+			return "Dest options";
+
+		case IPv6Symbol::TYPE_EXT_HEADER:
+			return "Extension header";
+
+		case IPv6Symbol::TYPE_DATA:
+			snprintf(tmp, sizeof(tmp), "%02x", sample.m_data[0]);
+			return string(tmp);
+
+		case IPv6Symbol::TYPE_ERROR:
+		default:
+			return "ERROR";
+	}
+}
@@ -0,0 +1,482 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of shared IPv4 / IPv6 helpers
+ */
+
+#include "../scopehal/scopehal.h"
+#include "InternetProtocol.h"
+#include "EthernetProtocolDecoder.h"
+
+#ifdef __x86_64__
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// InternetChecksum
+
+/*
+	The one's complement sum doesn't care about byte order (RFC 1071 section 2): we sum native endian words and
+	swap the folded result once at the end. It also doesn't care about word size, since 2^16 = 1 mod 0xffff, so
+	we can add 32-bit words into a 64-bit accumulator and fold all the carries back in at the end.
+ */
+
+/**
+	@brief Adds a block of data to the checksum
+
+	@param data	Data to add
+	@param len	Length of the data. Only the last block added may have an odd length.
+ */
+void InternetChecksum::Add(const uint8_t* data, size_t len)
+{
+	#ifdef __x86_64__
+	if(g_hasAvx2 && (len >= 64))
+		m_sum += SumAVX2(data, len);
+	else
+	#endif
+		m_sum += SumNative(data, len);
+}
+
+/**
+	@brief Adds a single 16-bit word (given in host byte order)
+ */
+void InternetChecksum::AddWord(uint16_t word)
+{
+	uint8_t bytes[2] = { static_cast<uint8_t>(word >> 8), static_cast<uint8_t>(word & 0xff) };
+	uint16_t w;
+	memcpy(&w, bytes, sizeof(w));
+	m_sum += w;
+}
+
+uint16_t InternetChecksum::GetSum() const
+{
+	uint64_t sum = m_sum;
+	while(sum >> 16)
+		sum = (sum & 0xffff) + (sum >> 16);
+
+	//Back to network byte order
+	uint16_t w = sum;
+	uint8_t bytes[2];
+	memcpy(bytes, &w, sizeof(w));
+	return (bytes[0] << 8) | bytes[1];
+}
+
+uint64_t InternetChecksum::SumNative(const uint8_t* data, size_t len)
+{
+	uint64_t sum = 0;
+	size_t i = 0;
+	for(; i+4 <= len; i += 4)
+	{
+		uint32_t w;
+		memcpy(&w, data + i, sizeof(w));
+		sum += w;
+	}
+	if(i+2 <= len)
+	{
+		uint16_t w;
+		memcpy(&w, data + i, sizeof(w));
+		sum += w;
+		i += 2;
+	}
+
+	//Odd trailing byte is padded with a zero after it
+	if(i < len)
+	{
+		uint8_t tail[2] = { data[i], 0 };
+		uint16_t w;
+		memcpy(&w, tail, sizeof(w));
+		sum += w;
+	}
+	return sum;
+}
+
+#ifdef __x86_64__
+__attribute__((target("avx2")))
+uint64_t InternetChecksum::SumAVX2(const uint8_t* data, size_t len)
+{
+	__m256i zero = _mm256_setzero_si256();
+	__m256i acc0 = zero;
+	__m256i acc1 = zero;
+
+	size_t end = len - (len % 32);
+	for(size_t i=0; i<end; i += 32)
+	{
+		__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+
+		//Zero extend 32-bit words to 64 bits so the accumulators can't overflow
+		acc0 = _mm256_add_epi64(acc0, _mm256_unpacklo_epi32(v, zero));
+		acc1 = _mm256_add_epi64(acc1, _mm256_unpackhi_epi32(v, zero));
+	}
+
+	uint64_t lanes[4];
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), _mm256_add_epi64(acc0, acc1));
+	return lanes[0] + lanes[1] + lanes[2] + lanes[3] + SumNative(data + end, len - end);
+}
+#endif
+
+/**
+	@brief Adds the TCP/UDP pseudo-header for either IPv4 (RFC 793) or IPv6 (RFC 8200 section 8.1)
+
+	@param sum		Checksum to add to
+	@param src		Source address
+	@param dst		Destination address
+	@param proto	Upper layer protocol number
+	@param len		Upper layer packet length (header plus payload)
+ */
+void AddPseudoHeader(InternetChecksum& sum, const IPAddress& src, const IPAddress& dst, uint8_t proto, uint32_t len)
+{
+	sum.Add(src.m_bytes, src.GetLength());
+	sum.Add(dst.m_bytes, dst.GetLength());
+	if(src.IsV6())
+		sum.AddWord(len >> 16);
+	sum.AddWord(len & 0xffff);
+	sum.AddWord(proto);
+}
+
+/**
+	@brief Gets the name of an IP protocol / IPv6 next header value
+
+	@return The name, or nullptr if it's not one we know
+ */
+const char* GetIPProtocolName(uint8_t proto)
+{
+	switch(proto)
+	{
+		case 0x01:
+			return "ICMP";
+		case 0x02:
+			return "IGMP";
+		case 0x06:
+			return "TCP";
+		case 0x11:
+			return "UDP";
+		case 0x29:
+			return "IPv6";
+		case 0x2f:
+			return "GRE";
+		case 0x32:
+			return "ESP";
+		case 0x33:
+			return "AH";
+		case 0x3a:
+			return "ICMPv6";
+		case 0x3b:
+			return "No next";
+		case 0x58:
+			return "EIGRP";
+		case 0x59:
+			return "OSPF";
+		case 0x73:
+			return "L2TP";
+		case 0x84:
+			return "SCTP";
+		case 0x85:
+			return "FCoIP";
+
+		default:
+			return nullptr;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// IPAddress
+
+IPAddress IPAddress::FromIPv4(const uint8_t* p)
+{
+	IPAddress ret;
+	memcpy(ret.m_bytes, p, 4);
+	return ret;
+}
+
+IPAddress IPAddress::FromIPv6(const uint8_t* p)
+{
+	IPAddress ret;
+	ret.m_v6 = true;
+	memcpy(ret.m_bytes, p, 16);
+	return ret;
+}
+
+/**
+	@brief Formats the address in dotted quad (IPv4) or RFC 5952 canonical (IPv6) form
+ */
+string IPAddress::ToString() const
+{
+	char tmp[64];
+	if(!m_v6)
+	{
+		snprintf(tmp, sizeof(tmp), "%d.%d.%d.%d", m_bytes[0], m_bytes[1], m_bytes[2], m_bytes[3]);
+		return tmp;
+	}
+
+	uint16_t groups[8];
+	for(int i=0; i<8; i++)
+		groups[i] = (m_bytes[i*2] << 8) | m_bytes[i*2 + 1];
+
+	//Find the longest run of two or more zero groups (the first one, if tied) to replace with "::"
+	int bestStart = -1;
+	int bestLen = 1;
+	for(int i=0; i<8; )
+	{
+		if(groups[i] != 0)
+		{
+			i++;
+			continue;
+		}
+
+		int j = i;
+		while( (j < 8) && (groups[j] == 0) )
+			j++;
+		if(j - i > bestLen)
+		{
+			bestStart = i;
+			bestLen = j - i;
+		}
+		i = j;
+	}
+
+	string ret;
+	for(int i=0; i<8; i++)
+	{
+		if(i == bestStart)
+		{
+			ret += "::";
+			i += bestLen - 1;
+			continue;
+		}
+
+		if( !ret.empty() && (ret.back() != ':') )
+			ret += ":";
+		snprintf(tmp, sizeof(tmp), "%x", groups[i]);
+		ret += tmp;
+	}
+	return ret;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// IPFragmentReassembler
+
+IPFragmentReassembler::IPFragmentReassembler(size_t maxPending)
+	: m_reassembled(0)
+	, m_dropped(0)
+	, m_maxPending(maxPending)
+	, m_serial(0)
+{
+}
+
+bool IPFragmentReassembler::Key::operator<(const Key& rhs) const
+{
+	if(m_src != rhs.m_src)
+		return m_src < rhs.m_src;
+	if(m_dst != rhs.m_dst)
+		return m_dst < rhs.m_dst;
+	if(m_id != rhs.m_id)
+		return m_id < rhs.m_id;
+	return m_protocol < rhs.m_protocol;
+}
+
+void IPFragmentReassembler::Clear()
+{
+	m_pending.clear();
+	m_reassembled = 0;
+	m_dropped = 0;
+}
+
+/**
+	@brief Adds a datagram, which may or may not be a fragment
+
+	@param datagram	The datagram. If it completes a set of fragments, it's replaced by the reassembled datagram.
+
+	@return True if datagram now holds a complete (unfragmented or reassembled) datagram.
+			False if it was a fragment and more are needed.
+ */
+bool IPFragmentReassembler::Add(IPDatagram& datagram)
+{
+	if(!datagram.IsFragment())
+		return true;
+
+	Key key;
+	key.m_src = datagram.m_src;
+	key.m_dst = datagram.m_dst;
+	key.m_id = datagram.m_id;
+	key.m_protocol = datagram.m_protocol;
+
+	auto it = m_pending.find(key);
+	if(it == m_pending.end())
+	{
+		it = m_pending.emplace(key, Pending()).first;
+		it->second.m_serial = m_serial ++;
+	}
+	auto& frags = it->second.m_fragments;
+	frags.push_back(std::move(datagram));
+
+	//Sort by offset. Stable, so data which arrived first wins where fragments overlap
+	stable_sort(frags.begin(), frags.end(),
+		[](const IPDatagram& a, const IPDatagram& b)
+		{ return a.m_fragmentOffset < b.m_fragmentOffset; });
+
+	//We're done once we've seen the last fragment and there are no holes before it
+	size_t covered = 0;
+	size_t total = 0;
+	bool complete = false;
+	for(auto& f : frags)
+	{
+		if(f.m_fragmentOffset > covered)
+			break;
+		covered = max(covered, f.m_fragmentOffset + f.m_payload.size());
+		if(!f.m_moreFragments)
+		{
+			total = f.m_fragmentOffset + f.m_payload.size();
+			complete = (covered >= total);
+			break;
+		}
+	}
+
+	if(!complete)
+	{
+		//Give up on the oldest incomplete datagram if we have too many
+		while(m_pending.size() > m_maxPending)
+		{
+			auto oldest = m_pending.begin();
+			for(auto jt = m_pending.begin(); jt != m_pending.end(); jt++)
+			{
+				if(jt->second.m_serial < oldest->second.m_serial)
+					oldest = jt;
+			}
+			m_pending.erase(oldest);
+			m_dropped ++;
+		}
+		return false;
+	}
+
+	//Headers come from the first fragment
+	auto& first = frags[0];
+	datagram.m_version = first.m_version;
+	datagram.m_src = first.m_src;
+	datagram.m_dst = first.m_dst;
+	datagram.m_protocol = first.m_protocol;
+	datagram.m_id = first.m_id;
+	datagram.m_fragmentOffset = 0;
+	datagram.m_moreFragments = false;
+	datagram.m_headerChecksumOK = true;
+	datagram.m_payload.resize(total);
+	datagram.m_offsets.resize(total);
+	datagram.m_durations.resize(total);
+
+	size_t filled = 0;
+	for(auto& f : frags)
+	{
+		datagram.m_headerChecksumOK &= f.m_headerChecksumOK;
+
+		size_t start = max(filled, static_cast<size_t>(f.m_fragmentOffset));
+		size_t end = min(total, f.m_fragmentOffset + f.m_payload.size());
+		for(size_t i=start; i<end; i++)
+		{
+			size_t j = i - f.m_fragmentOffset;
+			datagram.m_payload[i] = f.m_payload[j];
+			datagram.m_offsets[i] = f.m_offsets[j];
+			datagram.m_durations[i] = f.m_durations[j];
+		}
+		filled = max(filled, end);
+	}
+
+	m_pending.erase(it);
+	m_reassembled ++;
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Ethernet framing
+
+/**
+	@brief Calls fn once for the payload of every frame in an Ethernet waveform
+
+	802.1q tags are skipped over, so m_ethertype is always the innermost ethertype.
+ */
+void ForEachEthernetPayload(EthernetWaveform* wfm, const function<void(EthernetPayload&)>& fn)
+{
+	EthernetPayload payload;
+	payload.m_ethertype = 0;
+	bool inFrame = false;
+
+	size_t len = wfm->m_samples.size();
+	for(size_t i=0; i<len; i++)
+	{
+		auto& s = wfm->m_samples[i];
+		switch(s.m_type)
+		{
+			case EthernetFrameSegment::TYPE_SFD:
+				payload.clear();
+				payload.m_ethertype = 0;
+				inFrame = true;
+				break;
+
+			case EthernetFrameSegment::TYPE_DST_MAC:
+			case EthernetFrameSegment::TYPE_SRC_MAC:
+			case EthernetFrameSegment::TYPE_VLAN_TAG:
+				break;
+
+			case EthernetFrameSegment::TYPE_ETHERTYPE:
+				if(s.m_data.size() >= 2)
+					payload.m_ethertype = (s.m_data[0] << 8) | s.m_data[1];
+				break;
+
+			//Payload samples are normally one byte each, but split the time evenly if not
+			case EthernetFrameSegment::TYPE_PAYLOAD:
+				if(inFrame && !s.m_data.empty())
+				{
+					size_t n = s.m_data.size();
+					int64_t dur = wfm->m_durations[i] / n;
+					for(size_t j=0; j<n; j++)
+					{
+						payload.m_bytes.push_back(s.m_data[j]);
+						payload.m_offsets.push_back(wfm->m_offsets[i] + j*dur);
+						payload.m_durations.push_back(dur);
+					}
+				}
+				break;
+
+			//FCS, errors, or anything else ends the frame
+			default:
+				if(inFrame && !payload.m_bytes.empty())
+					fn(payload);
+				inFrame = false;
+				break;
+		}
+	}
+
+	//Capture ended mid frame (or the FCS was suppressed)
+	if(inFrame && !payload.m_bytes.empty())
+		fn(payload);
+}
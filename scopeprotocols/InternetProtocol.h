@@ -0,0 +1,246 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of shared IPv4 / IPv6 helpers: checksums, addresses, datagrams and fragment reassembly
+ */
+#ifndef InternetProtocol_h
+#define InternetProtocol_h
+
+class EthernetWaveform;
+
+/**
+	@brief One's complement checksum used by IPv4, ICMP, TCP and UDP (RFC 1071)
+
+	Data may be added in several pieces (e.g. pseudo-header then segment), but only the last piece may be an odd
+	number of bytes long.
+ */
+class InternetChecksum
+{
+public:
+	InternetChecksum()
+		: m_sum(0)
+	{}
+
+	void Add(const uint8_t* data, size_t len);
+	void AddWord(uint16_t word);
+
+	/**
+		@brief Returns the folded 16-bit sum (in host byte order)
+	 */
+	uint16_t GetSum() const;
+
+	///@brief Checks a sum computed over data which includes its own checksum field
+	bool IsValid() const
+	{ return GetSum() == 0xffff; }
+
+protected:
+	static uint64_t SumNative(const uint8_t* data, size_t len);
+#ifdef __x86_64__
+	static uint64_t SumAVX2(const uint8_t* data, size_t len);
+#endif
+
+	///@brief Running sum of the data loaded as native endian words, not yet folded
+	uint64_t m_sum;
+};
+
+/**
+	@brief An IPv4 or IPv6 address
+ */
+class IPAddress
+{
+public:
+	IPAddress()
+		: m_v6(false)
+	{ memset(m_bytes, 0, sizeof(m_bytes)); }
+
+	static IPAddress FromIPv4(const uint8_t* p);
+	static IPAddress FromIPv6(const uint8_t* p);
+
+	bool IsV6() const
+	{ return m_v6; }
+
+	size_t GetLength() const
+	{ return m_v6 ? 16 : 4; }
+
+	std::string ToString() const;
+
+	bool operator==(const IPAddress& rhs) const
+	{ return (m_v6 == rhs.m_v6) && (0 == memcmp(m_bytes, rhs.m_bytes, sizeof(m_bytes))); }
+
+	bool operator!=(const IPAddress& rhs) const
+	{ return !(*this == rhs); }
+
+	bool operator<(const IPAddress& rhs) const
+	{
+		if(m_v6 != rhs.m_v6)
+			return rhs.m_v6;
+		return memcmp(m_bytes, rhs.m_bytes, sizeof(m_bytes)) < 0;
+	}
+
+	///@brief Address bytes in network order (IPv4 uses the first four)
+	uint8_t m_bytes[16];
+
+	bool m_v6;
+};
+
+void AddPseudoHeader(InternetChecksum& sum, const IPAddress& src, const IPAddress& dst, uint8_t proto, uint32_t len);
+const char* GetIPProtocolName(uint8_t proto);
+
+/**
+	@brief A single IPv4 or IPv6 datagram (or fragment of one) pulled out of a decoded waveform
+
+	Each payload byte carries the timeline position it came from, so upper layer decoders can place their own
+	symbols on the same timeline even after fragment reassembly.
+ */
+class IPDatagram
+{
+public:
+	IPDatagram()
+		: m_version(4)
+		, m_protocol(0)
+		, m_headerChecksumOK(true)
+		, m_id(0)
+		, m_fragmentOffset(0)
+		, m_moreFragments(false)
+	{}
+
+	bool IsFragment() const
+	{ return (m_fragmentOffset != 0) || m_moreFragments; }
+
+	uint8_t m_version;
+	IPAddress m_src;
+	IPAddress m_dst;
+
+	///@brief Upper layer protocol (IPv4 protocol, or the last IPv6 next header)
+	uint8_t m_protocol;
+
+	///@brief IPv4 header checksum status (always true for IPv6, which has none)
+	bool m_headerChecksumOK;
+
+	///@brief Fragment identification (16 bits for IPv4, 32 for IPv6)
+	uint32_t m_id;
+
+	///@brief Offset of this fragment within the original datagram, in bytes
+	uint32_t m_fragmentOffset;
+
+	bool m_moreFragments;
+
+	std::vector<uint8_t> m_payload;
+
+	///@brief Start of each payload byte, in the source waveform's timebase
+	std::vector<int64_t> m_offsets;
+
+	///@brief Duration of each payload byte, in the source waveform's timebase
+	std::vector<int64_t> m_durations;
+};
+
+/**
+	@brief Interface for waveforms which carry IP datagrams
+ */
+class IPDatagramSource
+{
+public:
+	virtual ~IPDatagramSource()
+	{}
+
+	/**
+		@brief Appends every datagram (or fragment) in the waveform to out, in order
+	 */
+	virtual void GetDatagrams(std::vector<IPDatagram>& out) =0;
+};
+
+/**
+	@brief Reassembles fragmented IPv4 and IPv6 datagrams
+
+	Fragments are buffered until every byte of the original datagram has been seen. Overlapping fragments keep
+	the data which arrived first. If too many datagrams are incomplete at once, the oldest is dropped.
+ */
+class IPFragmentReassembler
+{
+public:
+	IPFragmentReassembler(size_t maxPending = 256);
+
+	bool Add(IPDatagram& datagram);
+	void Clear();
+
+	///@brief Number of datagrams rebuilt from fragments
+	uint64_t m_reassembled;
+
+	///@brief Number of incomplete datagrams given up on
+	uint64_t m_dropped;
+
+protected:
+	struct Key
+	{
+		IPAddress m_src;
+		IPAddress m_dst;
+		uint32_t m_id;
+		uint8_t m_protocol;
+
+		bool operator<(const Key& rhs) const;
+	};
+
+	struct Pending
+	{
+		std::vector<IPDatagram> m_fragments;
+		uint64_t m_serial;
+	};
+
+	std::map<Key, Pending> m_pending;
+
+	size_t m_maxPending;
+	uint64_t m_serial;
+};
+
+/**
+	@brief The payload of one Ethernet frame, with the timeline position of every byte
+ */
+class EthernetPayload
+{
+public:
+	uint16_t m_ethertype;
+	std::vector<uint8_t> m_bytes;
+	std::vector<int64_t> m_offsets;
+	std::vector<int64_t> m_durations;
+
+	void clear()
+	{
+		m_bytes.clear();
+		m_offsets.clear();
+		m_durations.clear();
+	}
+};
+
+void ForEachEthernetPayload(EthernetWaveform* wfm, const std::function<void(EthernetPayload&)>& fn);
+
+#endif
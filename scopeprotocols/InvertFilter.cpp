@@ -90,7 +90,23 @@ void InvertFilter::Refresh()
 	auto udin = dynamic_cast<UniformAnalogWaveform*>(din);
 	auto sdin = dynamic_cast<SparseAnalogWaveform*>(din);
 
-	if(sdin)
+	//Running in place (the filter graph gave us our input's waveform as our output)? Negate it directly
+	if(GetData(0) == din)
+	{
+		din->PrepareForCpuAccess();
+		float* a = nullptr;
+		if(sdin)
+			a = (float*)__builtin_assume_aligned(&sdin->m_samples[0], 16);
+		else if(udin)
+			a = (float*)__builtin_assume_aligned(&udin->m_samples[0], 16);
+		for(size_t i=0; a && (i<len); i++)
+			a[i] = -a[i];
+
+		din->m_revision ++;
+		din->MarkModifiedFromCpu();
+	}
+
+	else if(sdin)
 	{
 		//Negate each sample
 		auto cap = SetupSparseOutputWaveform(sdin, 0, 0, 0);
@@ -47,6 +47,9 @@ public:
 
 	virtual bool ValidateChannel(size_t i, StreamDescriptor stream) override;
 
+	virtual bool CanRefreshInPlace() override
+	{ return true; }
+
 	PROTOCOL_DECODER_INITPROC(InvertFilter)
 };
 
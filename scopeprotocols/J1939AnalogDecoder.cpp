@@ -157,9 +157,14 @@ void J1939AnalogDecoder::Refresh()
 	if(scalemode == SCALE_DIV)
 		scale = 1.0 / scale;
 
-	//TODO: support >8 byte packets
+	//Bit positions count from the LSB of the last byte, so they work the same for 8-byte frames
+	//and for longer messages reassembled by J1939TransportDecoder
 	int64_t framestart = 0;
-	uint64_t payload = 0;
+	vector<uint8_t> payload;
+	if(bitpos < 0)
+		bitpos = 0;
+	size_t firstbyte = bitpos / 8;
+	size_t bitshift = bitpos % 8;
 	for(size_t i=0; i<len; i++)
 	{
 		auto& s = din->m_samples[i];
@@ -174,7 +179,7 @@ void J1939AnalogDecoder::Refresh()
 					if(targetaddr == s.m_data)
 					{
 						framestart = din->m_offsets[i] * din->m_timescale;
-						payload = 0;
+						payload.clear();
 						state = STATE_DATA;
 					}
 
@@ -187,7 +192,7 @@ void J1939AnalogDecoder::Refresh()
 				if(s.m_stype == J1939PDUSymbol::TYPE_DATA)
 				{
 					//Grab the data byte
-					payload = (payload << 8) | s.m_data;
+					payload.push_back(s.m_data);
 
 					//Extend the previous sample to the start of this frame
 					size_t nlast = cap->m_offsets.size() - 1;
@@ -201,9 +206,18 @@ void J1939AnalogDecoder::Refresh()
 					cap->m_offsets.push_back(framestart);
 					cap->m_durations.push_back(0);
 
+					//Pull out the three bytes that can hold a 16-bit field
+					uint64_t bitval = 0;
+					for(size_t k=0; k<3; k++)
+					{
+						size_t nbyte = firstbyte + k;
+						if(nbyte < payload.size())
+							bitval |= static_cast<uint64_t>(payload[payload.size() - 1 - nbyte]) << (8*k);
+					}
+					bitval >>= bitshift;
+
 					//Cast appropriately
 					float v = 0;
-					auto bitval = payload >> bitpos;
 					switch(format)
 					{
 						case FORMAT_UINT16:
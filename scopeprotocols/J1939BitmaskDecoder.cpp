@@ -120,9 +120,9 @@ void J1939BitmaskDecoder::Refresh()
 	int64_t pattern = m_parameters[m_pattern].GetIntVal();
 	auto targetaddr = m_parameters[m_pgn].GetIntVal() ;
 
-	//TODO: support >8 byte packetds
+	//Messages longer than 8 bytes (reassembled by J1939TransportDecoder) are matched against their last 8 bytes
 	int64_t framestart = 0;
-	int64_t payload = 0;
+	uint64_t payload = 0;
 	for(size_t i=0; i<len; i++)
 	{
 		auto& s = din->m_samples[i];
@@ -164,7 +164,7 @@ void J1939BitmaskDecoder::Refresh()
 					cap->m_offsets.push_back(framestart);
 					cap->m_durations.push_back(0);
 
-					if( (payload & mask) == pattern )
+					if( (payload & mask) == static_cast<uint64_t>(pattern) )
 						cap->m_samples.push_back(true);
 					else
 						cap->m_samples.push_back(false);
@@ -147,7 +147,7 @@ void J1939PDUDecoder::Refresh()
 					auto sa = (s.m_data) & 0xff;
 
 					//PGN format (J1939-21 5.1.2)
-					auto pgn = (edp << 18) | (dp << 17) | (pf << 8);
+					auto pgn = (edp << 17) | (dp << 16) | (pf << 8);
 
 					//Crack headers into time domain format
 					int64_t delta = tend - tstart;
@@ -37,8 +37,12 @@ using namespace std;
 
 J1939TransportDecoder::J1939TransportDecoder(const string& color)
 	: PacketDecoder(color, CAT_BUS)
+	, m_timeoutName("Enforce Timeouts")
 {
 	CreateInput("j1939");
+
+	m_parameters[m_timeoutName] = FilterParameter(FilterParameter::TYPE_BOOL, Unit(Unit::UNIT_COUNTS));
+	m_parameters[m_timeoutName].SetBoolVal(true);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -61,7 +65,6 @@ vector<string> J1939TransportDecoder::GetHeaders()
 	ret.push_back("Type");
 	ret.push_back("Priority");
 	ret.push_back("PGN");
-	ret.push_back("PGN Name");
 	ret.push_back("EDP");
 	ret.push_back("DP");
 	ret.push_back("Format");
@@ -87,6 +90,7 @@ string J1939TransportDecoder::GetProtocolName()
 void J1939TransportDecoder::Refresh()
 {
 	ClearPackets();
+	m_reassembler.Clear();
 
 	if(!VerifyAllInputsOK())
 	{
@@ -95,12 +99,12 @@ void J1939TransportDecoder::Refresh()
 	}
 
 	auto din = dynamic_cast<J1939PDUWaveform*>(GetInputWaveform(0));
-	auto len = din->size();
 	if(!din)
 	{
 		SetData(nullptr, 0);
 		return;
 	}
+	din->PrepareForCpuAccess();
 
 	//Create the capture
 	auto cap = new J1939PDUWaveform;
@@ -111,197 +115,213 @@ void J1939TransportDecoder::Refresh()
 	cap->PrepareForCpuAccess();
 	SetData(cap, 0);
 
-	enum
-	{
-		STATE_IDLE,
-		STATE_PGN,
-		STATE_SOURCE,
-		STATE_DATA,
-		STATE_GARBAGE
-	} state = STATE_IDLE;
-
-	/*
-	//Filter the packet stream separately from the timeline stream
-	auto& srcPackets = dynamic_cast<PacketDecoder*>(GetInput(0).m_channel)->GetPackets();
-	for(auto p : srcPackets)
+	vector<J1939Frame> frames;
+	J1939TransportReassembler::GetFrames(din, frames);
+	m_reassembler.SetTimeoutsEnabled(m_parameters[m_timeoutName].GetBoolVal());
+
+	//Session packets are created when the session opens, so the packet list stays in time order,
+	//and filled in once we know how it ended
+	auto& sessions = m_reassembler.GetSessions();
+	auto& unexpected = m_reassembler.GetUnexpectedFrames();
+	vector<Packet*> sessionPackets;
+	for(auto& f : frames)
 	{
-		if(p->m_headers["Source"] == starget)
+		//Pass everything else through unchanged
+		if(!J1939TransportReassembler::IsTransportPGN(f.m_pgn))
 		{
-			auto np = new Packet;
-			*np = *p;
-			m_packets.push_back(np);
+			for(size_t i=0; i<f.m_sampleCount; i++)
+			{
+				size_t j = f.m_firstSample + i;
+				int64_t tstart = din->m_offsets[j] * din->m_timescale + din->m_triggerPhase;
+				cap->m_offsets.push_back(tstart);
+				cap->m_durations.push_back(din->m_durations[j] * din->m_timescale);
+				cap->m_samples.push_back(din->m_samples[j]);
+			}
+
+			AddFramePacket(f, false);
+			continue;
 		}
-	}
-	*/
-
-	//In-progress transport layer packets
-	[[maybe_unused]] Packet* workingPacketsBySourceAddress[256];
-	for(int i=0; i<256; i++)
-		workingPacketsBySourceAddress[i] = {nullptr};
-
-	//TODO: generate packet output for non-transport-coded packets
-
-	//Process the J1939 packet stream
-	size_t nstart = 0;
-	uint32_t currentPGN = 0;
-	uint8_t currentSrc = 0;
-	uint8_t currentDst = 0;
-	vector<uint8_t> currentPacketBytes;
-	int64_t currentPacketStart = 0;
-	for(size_t i=0; i<len; i++)
-	{
-		auto& s = din->m_samples[i];
-		int64_t tstart = din->m_offsets[i] * din->m_timescale + din->m_triggerPhase;
-		//int64_t tend = tstart + din->m_durations[i] * din->m_timescale;
 
-		switch(state)
+		size_t nsessions = sessions.size();
+		size_t nunexpected = unexpected.size();
+		auto done = m_reassembler.AddFrame(f);
+
+		for(size_t i=nsessions; i<sessions.size(); i++)
 		{
-			case STATE_IDLE:
-				break;
+			auto pack = new Packet;
+			pack->m_offset = sessions[i].m_start;
+			m_packets.push_back(pack);
+			sessionPackets.push_back(pack);
+		}
 
-			//Expect a PGN, if we get anything else drop the packet
-			case STATE_PGN:
-				if(s.m_stype == J1939PDUSymbol::TYPE_PGN)
-				{
-					currentPGN = s.m_data;
-
-					//Copy the sample to the output
-					cap->m_offsets.push_back(din->m_offsets[i]);
-					cap->m_durations.push_back(din->m_durations[i]);
-					cap->m_samples.push_back(din->m_samples[i]);
-
-					//Wait for the addresses
-					state = STATE_SOURCE;
-				}
-				else
-				{
-					cap->m_offsets.resize(nstart);
-					cap->m_durations.resize(nstart);
-					cap->m_samples.resize(nstart);
-					state = STATE_GARBAGE;
-				}
-				break;
+		if(unexpected.size() != nunexpected)
+			AddFramePacket(f, true);
+
+		if(done != J1939TransportReassembler::NO_SESSION)
+			AddMessage(cap, sessions[done], f);
+	}
+	m_reassembler.Flush();
+
+	for(size_t i=0; i<sessionPackets.size(); i++)
+		FillSessionPacket(sessionPackets[i], sessions[i]);
 
+	//Done updating
+	cap->MarkModifiedFromCpu();
+}
+
+/**
+	@brief Fills out the PGN and address headers of a packet
+ */
+void J1939TransportDecoder::SetPGNHeaders(Packet* pack, uint32_t pgn, uint8_t priority, uint8_t dest, uint8_t source)
+{
+	auto pf = (pgn >> 8) & 0xff;
+
+	pack->m_headers["Priority"] = to_string(priority);
+	pack->m_headers["PGN"] = to_string(pgn);
+	pack->m_headers["EDP"] = to_string((pgn >> 17) & 1);
+	pack->m_headers["DP"] = to_string((pgn >> 16) & 1);
+	pack->m_headers["Format"] = to_string(pf);
+	if(pf < 240)
+		pack->m_headers["Dest"] = to_string(dest);
+	else
+		pack->m_headers["Group ext"] = to_string(pgn & 0xff);
+	pack->m_headers["Source"] = to_string(source);
+}
+
+/**
+	@brief Adds a packet for a single frame: either a non-transport frame, or a transport frame outside any session
+ */
+void J1939TransportDecoder::AddFramePacket(const J1939Frame& frame, bool transport)
+{
+	auto pack = new Packet;
+	pack->m_offset = frame.m_start;
+	pack->m_len = frame.m_end - frame.m_start;
+	pack->m_data = frame.m_data;
+	m_packets.push_back(pack);
+
+	SetPGNHeaders(pack, frame.m_pgn, frame.m_priority, frame.m_dest, frame.m_source);
+	pack->m_headers["Length"] = to_string(frame.m_data.size());
+
+	if(transport)
+	{
+		switch(frame.m_pgn)
+		{
+			case J1939TransportReassembler::PGN_TP_CM:
+				pack->m_headers["Type"] = "TP.CM";
+				break;
 
-			case STATE_SOURCE:
-				if(s.m_stype == J1939PDUSymbol::TYPE_DEST)
-				{
-					//Copy the sample to the output
-					cap->m_offsets.push_back(din->m_offsets[i]);
-					cap->m_durations.push_back(din->m_durations[i]);
-					cap->m_samples.push_back(din->m_samples[i]);
-
-					//Still waiting for source address
-					currentDst = s.m_data;
-				}
-				else if(s.m_stype == J1939PDUSymbol::TYPE_SRC)
-				{
-					//Copy the sample to the output
-					cap->m_offsets.push_back(din->m_offsets[i]);
-					cap->m_durations.push_back(din->m_durations[i]);
-					cap->m_samples.push_back(din->m_samples[i]);
-
-					currentSrc = s.m_data;
-
-					//Process data
-					state = STATE_DATA;
-				}
-				else
-				{
-					cap->m_offsets.resize(nstart);
-					cap->m_durations.resize(nstart);
-					cap->m_samples.resize(nstart);
-					state = STATE_GARBAGE;
-				}
+			case J1939TransportReassembler::PGN_TP_DT:
+				pack->m_headers["Type"] = "TP.DT";
 				break;
 
-			case STATE_DATA:
-
-				if(s.m_stype == J1939PDUSymbol::TYPE_DATA)
-				{
-					//Copy the sample to the output
-					cap->m_offsets.push_back(din->m_offsets[i]);
-					cap->m_durations.push_back(din->m_durations[i]);
-					cap->m_samples.push_back(din->m_samples[i]);
-
-					//Save the byte
-					currentPacketBytes.push_back(s.m_data);
-
-					//Handle transport layer
-					if( (currentPGN == 60416) && (currentPacketBytes.size() == 8) )
-					{
-						//BAM TP.CM
-						if(currentPacketBytes[0] == 32)
-						{
-							//Start a new output packet
-							auto pack = new Packet;
-							pack->m_offset = currentPacketStart;
-							pack->m_len = 0;
-							m_packets.push_back(pack);
-
-							uint16_t plen = currentPacketBytes[1] | (currentPacketBytes[2] << 8);
-							uint32_t pgn =
-								currentPacketBytes[5] |
-								(currentPacketBytes[6] << 8) |
-								(currentPacketBytes[7] << 16);
-							pack->m_headers["Length"] = to_string(plen);
-							pack->m_headers["PGN"] = to_string(pgn);
-							pack->m_headers["Format"] = to_string(currentPacketBytes[6]);
-							if(currentPacketBytes[6] >= 240)
-								pack->m_headers["Group ext"] = to_string(currentPacketBytes[5]);
-							pack->m_headers["Source"] = to_string(currentSrc);
-							pack->m_headers["Dest"] = to_string(currentDst);	//should always be 0xff
-							workingPacketsBySourceAddress[currentSrc] = pack;
-
-							pack->m_headers["Type"] = "BAM TP";
-							pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_CONTROL];
-						}
-
-						//TODO: decode CM
-						else
-						{
-							LogWarning("Don't know how to decode PGN 60416 other than BAM TP.CM\n");
-						}
-					}
-
-					if(currentPGN == 60160)
-					{
-						//TODO: detect end-of-packet and synthesize time domain packet events
-						auto pack = workingPacketsBySourceAddress[currentSrc];
-						if(pack)
-						{
-							//for now assume sequence number is correct and packet arrived in order
-							if(currentPacketBytes.size() > 1)
-								pack->m_data.push_back(s.m_data);
-						}
-					}
-				}
+			case J1939TransportReassembler::PGN_ETP_CM:
+				pack->m_headers["Type"] = "ETP.CM";
 				break;
 
+			case J1939TransportReassembler::PGN_ETP_DT:
 			default:
+				pack->m_headers["Type"] = "ETP.DT";
 				break;
 		}
+		pack->m_headers["Info"] = "No matching session";
+		pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_ERROR];
+	}
+	else if(frame.IsPDU1())
+	{
+		pack->m_headers["Type"] = "PDU1";
+		pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_COMMAND];
+	}
+	else
+	{
+		pack->m_headers["Type"] = "PDU2";
+		pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_DATA_WRITE];
+	}
+}
 
-		//When we see a PRI start a new packet and save the info from it
-		if(s.m_stype == J1939PDUSymbol::TYPE_PRI)
-		{
-			//Copy the sample to the output
-			nstart = cap->m_samples.size();
-			cap->m_offsets.push_back(din->m_offsets[i]);
-			cap->m_durations.push_back(din->m_durations[i]);
-			cap->m_samples.push_back(din->m_samples[i]);
-
-			//Reset state
-			currentPacketBytes.clear();
-			currentPGN = 0;
-			currentPacketStart = tstart;
-
-			//Wait for the PGN
-			state = STATE_PGN;
-		}
+/**
+	@brief Fills out the packet for a transport session once it has ended
+ */
+void J1939TransportDecoder::FillSessionPacket(Packet* pack, const J1939TransportSession& session)
+{
+	pack->m_len = session.m_end - session.m_start;
+	pack->m_data = session.m_data;
+
+	pack->m_headers["Type"] = session.GetTypeName();
+	SetPGNHeaders(pack, session.m_pgn, session.m_priority, session.m_dest, session.m_source);
+	pack->m_headers["Length"] = to_string(session.m_size);
+
+	//Summarize any protocol problems after the status, but don't let a badly broken session flood the column
+	string info = session.GetStatusText();
+	if(session.m_retransmits)
+		info += string(", ") + to_string(session.m_retransmits) + " retransmitted";
+	for(size_t i=0; i<session.m_warnings.size() && i<3; i++)
+		info += string("; ") + session.m_warnings[i];
+	if(session.m_warnings.size() > 3)
+		info += string("; ") + to_string(session.m_warnings.size() - 3) + " more warnings";
+	pack->m_headers["Info"] = info;
+
+	switch(session.m_status)
+	{
+		case J1939TransportSession::STATUS_COMPLETE:
+			pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_DATA_READ];
+			break;
+
+		case J1939TransportSession::STATUS_ACTIVE:
+		case J1939TransportSession::STATUS_INCOMPLETE:
+			pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_CONTROL];
+			break;
+
+		default:
+			pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_ERROR];
+			break;
+	}
+}
+
+/**
+	@brief Synthesizes a frame carrying a reassembled message, over the time span of the frame that completed it
 
+	The ID fields are laid out the same way J1939PDUDecoder does, and the data bytes share the rest of the frame.
+ */
+void J1939TransportDecoder::AddMessage(J1939PDUWaveform* cap, const J1939TransportSession& session, const J1939Frame& frame)
+{
+	int64_t tstart = frame.m_start;
+	int64_t prilen = (frame.m_idEnd - tstart) / 10;
+
+	cap->m_offsets.push_back(tstart);
+	cap->m_durations.push_back(prilen);
+	cap->m_samples.push_back(J1939PDUSymbol(J1939PDUSymbol::TYPE_PRI, session.m_priority));
+
+	if( ((session.m_pgn >> 8) & 0xff) < 240)
+	{
+		cap->m_offsets.push_back(tstart + prilen);
+		cap->m_durations.push_back(3*prilen);
+		cap->m_samples.push_back(J1939PDUSymbol(J1939PDUSymbol::TYPE_PGN, session.m_pgn));
+
+		cap->m_offsets.push_back(tstart + 4*prilen);
+		cap->m_durations.push_back(2*prilen);
+		cap->m_samples.push_back(J1939PDUSymbol(J1939PDUSymbol::TYPE_DEST, session.m_dest));
+	}
+	else
+	{
+		cap->m_offsets.push_back(tstart + prilen);
+		cap->m_durations.push_back(5*prilen);
+		cap->m_samples.push_back(J1939PDUSymbol(J1939PDUSymbol::TYPE_PGN, session.m_pgn));
 	}
 
-	//Done updating
-	cap->MarkModifiedFromCpu();
+	cap->m_offsets.push_back(tstart + 6*prilen);
+	cap->m_durations.push_back(frame.m_idEnd - (tstart + 6*prilen));
+	cap->m_samples.push_back(J1939PDUSymbol(J1939PDUSymbol::TYPE_SRC, session.m_source));
+
+	//ETP messages can be far longer than there are femtoseconds in a frame, so scale in floating point
+	size_t len = session.m_data.size();
+	double span = frame.m_end - frame.m_idEnd;
+	int64_t last = frame.m_idEnd;
+	for(size_t i=0; i<len; i++)
+	{
+		int64_t end = frame.m_idEnd + static_cast<int64_t>(span * (i+1) / len);
+		cap->m_offsets.push_back(last);
+		cap->m_durations.push_back(end - last);
+		cap->m_samples.push_back(J1939PDUSymbol(J1939PDUSymbol::TYPE_DATA, session.m_data[i]));
+		last = end;
+	}
 }
@@ -35,8 +35,20 @@
 #ifndef J1939TransportDecoder_h
 #define J1939TransportDecoder_h
 
-#include "J1939PDUDecoder.h"
+#include "J1939TransportReassembler.h"
 
+/**
+	@brief Reassembles J1939 transport protocol (TP and ETP) messages
+
+	The output waveform contains every non-transport frame unchanged, plus one synthesized frame per successfully
+	transferred multi-packet message, carrying the original PGN and the complete payload. It can be fed to the same
+	filters as the output of J1939PDUDecoder. Since a message is only known to be complete at the end of its last
+	TP.DT (for BAM) or at its EoMA, the synthesized frame occupies the time span of that frame. The connection
+	management and data transfer frames themselves are not copied to the output.
+
+	Packet output has one packet per non-transport frame and one per session, including sessions that were aborted,
+	timed out, or were still in progress at the end of the capture.
+ */
 class J1939TransportDecoder : public PacketDecoder
 {
 public:
@@ -49,9 +61,21 @@ public:
 
 	virtual bool ValidateChannel(size_t i, StreamDescriptor stream) override;
 
+	///@brief Sessions from the last refresh
+	const J1939TransportReassembler& GetReassembler() const
+	{ return m_reassembler; }
+
 	PROTOCOL_DECODER_INITPROC(J1939TransportDecoder)
 
 protected:
+	void SetPGNHeaders(Packet* pack, uint32_t pgn, uint8_t priority, uint8_t dest, uint8_t source);
+	void AddFramePacket(const J1939Frame& frame, bool transport);
+	void FillSessionPacket(Packet* pack, const J1939TransportSession& session);
+	void AddMessage(J1939PDUWaveform* cap, const J1939TransportSession& session, const J1939Frame& frame);
+
+	std::string m_timeoutName;
+
+	J1939TransportReassembler m_reassembler;
 };
 
 #endif
@@ -0,0 +1,674 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of J1939TransportReassembler
+ */
+#include "../scopehal/scopehal.h"
+#include "J1939TransportReassembler.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// J1939TransportSession
+
+string J1939TransportSession::GetTypeName() const
+{
+	switch(m_protocol)
+	{
+		case PROTOCOL_BAM:
+			return "BAM TP";
+
+		case PROTOCOL_RTS_CTS:
+			return "RTS/CTS TP";
+
+		case PROTOCOL_ETP:
+		default:
+			return "ETP";
+	}
+}
+
+string J1939TransportSession::GetStatusText() const
+{
+	switch(m_status)
+	{
+		case STATUS_ACTIVE:
+			return "In progress";
+
+		case STATUS_COMPLETE:
+			return "Complete";
+
+		case STATUS_ABORTED:
+			if(!m_error.empty())
+				return m_error;
+			return string("Aborted by ") + (m_abortedByResponder ? "responder: " : "originator: ") +
+				J1939TransportReassembler::GetAbortReasonName(m_abortReason);
+
+		case STATUS_INCOMPLETE:
+			return string("Incomplete, ") + to_string(m_received) + " of " + to_string(m_packetCount) + " packets";
+
+		case STATUS_TIMEOUT:
+		case STATUS_ERROR:
+		default:
+			return m_error;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+J1939TransportReassembler::J1939TransportReassembler()
+	: m_peakActive(0)
+	, m_timeoutsEnabled(true)
+{
+}
+
+void J1939TransportReassembler::Clear()
+{
+	m_sessions.clear();
+	m_unexpected.clear();
+	m_active.clear();
+	m_peakActive = 0;
+	m_timers = decltype(m_timers)();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Helpers
+
+/**
+	@brief Splits a J1939 PDU waveform into frames
+
+	Frames missing their PGN or source address (truncated captures, bus errors) are skipped.
+ */
+void J1939TransportReassembler::GetFrames(J1939PDUWaveform* wfm, vector<J1939Frame>& frames)
+{
+	enum
+	{
+		STATE_IDLE,
+		STATE_PGN,
+		STATE_ADDRESS,
+		STATE_DATA
+	} state = STATE_IDLE;
+
+	J1939Frame frame;
+	size_t len = wfm->size();
+	for(size_t i=0; i<len; i++)
+	{
+		auto& s = wfm->m_samples[i];
+		int64_t tstart = wfm->m_offsets[i] * wfm->m_timescale + wfm->m_triggerPhase;
+		int64_t tend = tstart + wfm->m_durations[i] * wfm->m_timescale;
+
+		//A priority field always starts a new frame
+		if(s.m_stype == J1939PDUSymbol::TYPE_PRI)
+		{
+			if(state == STATE_DATA)
+				frames.push_back(frame);
+
+			frame = J1939Frame();
+			frame.m_start = tstart;
+			frame.m_priority = s.m_data;
+			frame.m_firstSample = i;
+			state = STATE_PGN;
+			continue;
+		}
+
+		switch(state)
+		{
+			case STATE_PGN:
+				if(s.m_stype == J1939PDUSymbol::TYPE_PGN)
+				{
+					frame.m_pgn = s.m_data;
+					state = STATE_ADDRESS;
+				}
+				else
+					state = STATE_IDLE;
+				break;
+
+			case STATE_ADDRESS:
+				if(s.m_stype == J1939PDUSymbol::TYPE_DEST)
+					frame.m_dest = s.m_data;
+				else if(s.m_stype == J1939PDUSymbol::TYPE_SRC)
+				{
+					frame.m_source = s.m_data;
+					frame.m_idEnd = tend;
+					frame.m_end = tend;
+					frame.m_sampleCount = i + 1 - frame.m_firstSample;
+					state = STATE_DATA;
+				}
+				else
+					state = STATE_IDLE;
+				break;
+
+			case STATE_DATA:
+				if(s.m_stype == J1939PDUSymbol::TYPE_DATA)
+				{
+					frame.m_data.push_back(s.m_data);
+					frame.m_end = tend;
+					frame.m_sampleCount = i + 1 - frame.m_firstSample;
+				}
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	if(state == STATE_DATA)
+		frames.push_back(frame);
+}
+
+/**
+	@brief Checks if a PGN belongs to the TP or ETP connection management or data transfer messages
+ */
+bool J1939TransportReassembler::IsTransportPGN(uint32_t pgn)
+{
+	return (pgn == PGN_TP_CM) || (pgn == PGN_TP_DT) || (pgn == PGN_ETP_CM) || (pgn == PGN_ETP_DT);
+}
+
+/**
+	@brief Gets the description of a connection abort reason (J1939-21 table 7)
+ */
+string J1939TransportReassembler::GetAbortReasonName(uint8_t reason)
+{
+	switch(reason)
+	{
+		case 1:		return "Already in one or more sessions";
+		case 2:		return "System resources needed for another task";
+		case 3:		return "Timeout";
+		case 4:		return "CTS received during data transfer";
+		case 5:		return "Maximum retransmit limit reached";
+		case 6:		return "Unexpected data transfer packet";
+		case 7:		return "Bad sequence number";
+		case 8:		return "Duplicate sequence number";
+		case 9:		return "Unexpected DPO packet";
+		case 10:	return "Unexpected DPO PGN";
+		case 11:	return "DPO packet count greater than CTS";
+		case 12:	return "Bad DPO offset";
+		case 14:	return "Unexpected CTS PGN";
+		case 15:	return "CTS requested packets exceed message size";
+		case 250:	return "Other";
+
+		default:
+			return string("Reserved (") + to_string(reason) + ")";
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Session bookkeeping
+
+/**
+	@brief Starts tracking a new session, replacing any existing one between the same pair of nodes
+ */
+size_t J1939TransportReassembler::OpenSession(const J1939TransportSession& session)
+{
+	uint32_t key = GetKey(session);
+	auto it = m_active.find(key);
+	if(it != m_active.end())
+		CloseSession(it->second, J1939TransportSession::STATUS_ABORTED, string("Replaced by a new ") + session.GetTypeName());
+
+	size_t index = m_sessions.size();
+	m_sessions.push_back(session);
+	m_active[key] = index;
+	m_peakActive = max(m_peakActive, m_active.size());
+	return index;
+}
+
+void J1939TransportReassembler::CloseSession(size_t index, J1939TransportSession::Status status, const string& why)
+{
+	auto& session = m_sessions[index];
+	session.m_status = status;
+	session.m_wait = J1939TransportSession::WAIT_NONE;
+	if(!why.empty())
+		session.m_error = why;
+	m_active.erase(GetKey(session));
+}
+
+void J1939TransportReassembler::CompleteSession(size_t index, size_t& completed)
+{
+	m_sessions[index].m_data.resize(m_sessions[index].m_size, 0xff);
+	CloseSession(index, J1939TransportSession::STATUS_COMPLETE);
+	completed = index;
+}
+
+/**
+	@brief Looks up the active session between two nodes, if it is carrying the expected PGN
+ */
+size_t J1939TransportReassembler::FindSession(bool extended, uint8_t originator, uint8_t responder, uint32_t pgn)
+{
+	auto it = m_active.find(GetKey(extended, originator, responder));
+	if(it == m_active.end())
+		return NO_SESSION;
+	if(m_sessions[it->second].m_pgn != pgn)
+		return NO_SESSION;
+	return it->second;
+}
+
+void J1939TransportReassembler::StartTimer(size_t index, J1939TransportSession::Wait wait, int64_t now, int64_t timeout)
+{
+	auto& session = m_sessions[index];
+	session.m_wait = wait;
+	session.m_timeout = timeout;
+	session.m_generation ++;
+
+	if(m_timeoutsEnabled)
+		m_timers.push(Timer{now + timeout, index, session.m_generation});
+}
+
+/**
+	@brief Times out every session whose timer expired before the given time
+
+	Timers are never removed from the queue when a session moves on, they're just ignored once their generation no
+	longer matches the session's.
+ */
+void J1939TransportReassembler::CheckTimeouts(int64_t now)
+{
+	while(!m_timers.empty() && (m_timers.top().m_deadline < now) )
+	{
+		auto t = m_timers.top();
+		m_timers.pop();
+
+		auto& session = m_sessions[t.m_session];
+		if( (session.m_status != J1939TransportSession::STATUS_ACTIVE) || (session.m_generation != t.m_generation) )
+			continue;
+
+		string what;
+		switch(session.m_wait)
+		{
+			case J1939TransportSession::WAIT_CTS:
+				what = "CTS or EoMA";
+				break;
+
+			case J1939TransportSession::WAIT_HOLD:
+				what = "CTS after hold";
+				break;
+
+			case J1939TransportSession::WAIT_DPO:
+				what = "DPO";
+				break;
+
+			case J1939TransportSession::WAIT_DT:
+			default:
+				what = "data";
+				break;
+		}
+
+		CloseSession(t.m_session, J1939TransportSession::STATUS_TIMEOUT,
+			string("Timed out waiting for ") + what + " (" + to_string(session.m_timeout / FS_PER_MS) + " ms)");
+	}
+}
+
+/**
+	@brief Saves the seven payload bytes of a data packet (1-based packet number)
+ */
+void J1939TransportReassembler::StoreData(J1939TransportSession& session, uint32_t packet, const J1939Frame& frame)
+{
+	if( (packet == 0) || (packet > session.m_packetCount) )
+		return;
+
+	//Grow the buffers as data arrives rather than trusting the size in the RTS up front
+	size_t end = packet * 7;
+	if(session.m_data.size() < end)
+		session.m_data.resize(end, 0xff);
+	if(session.m_packetValid.size() < packet)
+		session.m_packetValid.resize(packet, false);
+
+	for(size_t i=1; i<frame.m_data.size() && i<8; i++)
+		session.m_data[end - 8 + i] = frame.m_data[i];
+
+	if(session.m_packetValid[packet-1])
+		session.m_retransmits ++;
+	else
+	{
+		session.m_packetValid[packet-1] = true;
+		session.m_received ++;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Actual reassembly logic
+
+/**
+	@brief Processes one frame
+
+	Frames must be added in order of start time.
+
+	@return Index of the session the frame completed, or NO_SESSION
+ */
+size_t J1939TransportReassembler::AddFrame(const J1939Frame& frame)
+{
+	CheckTimeouts(frame.m_start);
+
+	bool ok = true;
+	size_t completed = NO_SESSION;
+	switch(frame.m_pgn)
+	{
+		case PGN_TP_CM:
+			ok = OnConnectionManagement(frame, false, completed);
+			break;
+
+		case PGN_ETP_CM:
+			ok = OnConnectionManagement(frame, true, completed);
+			break;
+
+		case PGN_TP_DT:
+			ok = OnData(frame, false, completed);
+			break;
+
+		case PGN_ETP_DT:
+			ok = OnData(frame, true, completed);
+			break;
+
+		//not a transport frame, nothing to do
+		default:
+			return NO_SESSION;
+	}
+
+	if(!ok)
+		m_unexpected.push_back(frame);
+	return completed;
+}
+
+/**
+	@brief Marks all sessions still in progress as incomplete, once the end of the capture is reached
+ */
+void J1939TransportReassembler::Flush()
+{
+	vector<size_t> active;
+	for(auto it : m_active)
+		active.push_back(it.second);
+	for(auto i : active)
+		CloseSession(i, J1939TransportSession::STATUS_INCOMPLETE);
+
+	m_timers = decltype(m_timers)();
+}
+
+/**
+	@brief Handles a TP.CM or ETP.CM frame
+
+	@return False if the frame was malformed or did not match any session
+ */
+bool J1939TransportReassembler::OnConnectionManagement(const J1939Frame& frame, bool extended, size_t& completed)
+{
+	auto& d = frame.m_data;
+	if(d.size() < 8)
+		return false;
+
+	uint8_t control = d[0];
+	uint32_t pgn = d[5] | (d[6] << 8) | (d[7] << 16);
+	uint8_t sa = frame.m_source;
+	uint8_t da = frame.m_dest;
+
+	//Control bytes for ETP are the TP ones plus 4, except for abort
+	if(extended && (control != 255) )
+	{
+		if( (control < 20) || (control > 23) )
+			return false;
+		control -= 4;
+	}
+
+	size_t index;
+	switch(control)
+	{
+		//RTS or BAM: start a new session
+		case 16:
+		case 32:
+			{
+				bool bam = (control == 32);
+				if(extended && bam)
+					return false;
+
+				//BAM is always sent to global, RTS never is
+				if(bam != (da == 0xff))
+					return false;
+
+				J1939TransportSession session;
+				session.m_protocol = bam ? J1939TransportSession::PROTOCOL_BAM :
+					extended ? J1939TransportSession::PROTOCOL_ETP : J1939TransportSession::PROTOCOL_RTS_CTS;
+				session.m_source = sa;
+				session.m_dest = da;
+				session.m_priority = frame.m_priority;
+				session.m_pgn = pgn;
+				session.m_start = frame.m_start;
+				session.m_end = frame.m_end;
+				session.m_nextPacket = 1;
+
+				if(extended)
+				{
+					session.m_size = d[1] | (d[2] << 8) | (d[3] << 16) | (d[4] << 24);
+					session.m_packetCount = (session.m_size + 6) / 7;
+					if(session.m_size <= 1785)
+						session.m_warnings.push_back("ETP used for a message that would fit in TP");
+				}
+				else
+				{
+					session.m_size = d[1] | (d[2] << 8);
+					session.m_packetCount = d[3];
+					if(!bam)
+						session.m_maxPerCts = d[4];
+
+					if( (session.m_size < 9) || (session.m_size > 1785) )
+						session.m_warnings.push_back(string("Invalid message size ") + to_string(session.m_size));
+					if(session.m_packetCount != (session.m_size + 6) / 7)
+					{
+						session.m_warnings.push_back(
+							string("Packet count ") + to_string(session.m_packetCount) + " does not match message size");
+					}
+				}
+
+				index = OpenSession(session);
+				if(bam)
+					StartTimer(index, J1939TransportSession::WAIT_DT, frame.m_end, TIMEOUT_T1);
+				else
+					StartTimer(index, J1939TransportSession::WAIT_CTS, frame.m_end, TIMEOUT_T3);
+			}
+			return true;
+
+		//CTS: sent by the responder to request the next batch of packets, or to hold the connection open
+		case 17:
+			{
+				index = FindSession(extended, da, sa, pgn);
+				if(index == NO_SESSION)
+					return false;
+				auto& session = m_sessions[index];
+				session.m_end = frame.m_end;
+				session.m_ctsCount ++;
+
+				if( (session.m_wait == J1939TransportSession::WAIT_DT) ||
+					(session.m_wait == J1939TransportSession::WAIT_DPO) )
+				{
+					session.m_warnings.push_back("CTS received during data transfer");
+				}
+
+				uint32_t count = d[1];
+				uint32_t next = extended ? (d[2] | (d[3] << 8) | (d[4] << 16)) : d[2];
+				if(count == 0)
+				{
+					StartTimer(index, J1939TransportSession::WAIT_HOLD, frame.m_end, TIMEOUT_T4);
+					return true;
+				}
+
+				if( (next == 0) || (next + count - 1 > session.m_packetCount) )
+					session.m_warnings.push_back("CTS requested packets beyond the end of the message");
+				if(!extended && (session.m_maxPerCts != 0xff) && (count > session.m_maxPerCts) )
+					session.m_warnings.push_back("CTS requested more packets than the RTS allowed");
+
+				session.m_windowStart = next;
+				session.m_windowEnd = next + count - 1;
+				session.m_nextPacket = next;
+				if(extended)
+					StartTimer(index, J1939TransportSession::WAIT_DPO, frame.m_end, TIMEOUT_T2);
+				else
+					StartTimer(index, J1939TransportSession::WAIT_DT, frame.m_end, TIMEOUT_T2);
+			}
+			return true;
+
+		//DPO (ETP only): sent by the originator to set the base packet number for the next run of ETP.DT
+		case 18:
+			{
+				if(!extended)
+					return false;
+				index = FindSession(extended, sa, da, pgn);
+				if(index == NO_SESSION)
+					return false;
+				auto& session = m_sessions[index];
+				session.m_end = frame.m_end;
+
+				uint32_t count = d[1];
+				uint32_t offset = d[2] | (d[3] << 8) | (d[4] << 16);
+				if(session.m_wait != J1939TransportSession::WAIT_DPO)
+					session.m_warnings.push_back("Unexpected DPO");
+				if(offset + 1 != session.m_windowStart)
+					session.m_warnings.push_back("Bad DPO offset");
+				if(offset + count > session.m_windowEnd)
+					session.m_warnings.push_back("DPO packet count greater than CTS");
+
+				session.m_dpoOffset = offset;
+				session.m_windowStart = offset + 1;
+				session.m_windowEnd = offset + count;
+				session.m_nextPacket = offset + 1;
+				StartTimer(index, J1939TransportSession::WAIT_DT, frame.m_end, TIMEOUT_T1);
+			}
+			return true;
+
+		//EoMA: responder acknowledges the whole message
+		case 19:
+			{
+				index = FindSession(extended, da, sa, pgn);
+				if(index == NO_SESSION)
+					return false;
+				auto& session = m_sessions[index];
+				session.m_end = frame.m_end;
+
+				if(session.HasAllData())
+					CompleteSession(index, completed);
+				else
+				{
+					CloseSession(index, J1939TransportSession::STATUS_ERROR,
+						string("EoMA after ") + to_string(session.m_received) + " of " +
+						to_string(session.m_packetCount) + " packets");
+				}
+			}
+			return true;
+
+		//Connection abort: may come from either end
+		case 255:
+			{
+				bool responder = false;
+				index = FindSession(extended, sa, da, pgn);
+				if(index == NO_SESSION)
+				{
+					index = FindSession(extended, da, sa, pgn);
+					responder = true;
+				}
+				if(index == NO_SESSION)
+					return false;
+
+				auto& session = m_sessions[index];
+				session.m_end = frame.m_end;
+				session.m_abortReason = d[1];
+				session.m_abortedByResponder = responder;
+				CloseSession(index, J1939TransportSession::STATUS_ABORTED);
+			}
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+/**
+	@brief Handles a TP.DT or ETP.DT frame
+
+	@return False if the frame did not match any session
+ */
+bool J1939TransportReassembler::OnData(const J1939Frame& frame, bool extended, size_t& completed)
+{
+	auto& d = frame.m_data;
+	if(d.empty())
+		return false;
+
+	auto it = m_active.find(GetKey(extended, frame.m_source, frame.m_dest));
+	if(it == m_active.end())
+		return false;
+	size_t index = it->second;
+	auto& session = m_sessions[index];
+	session.m_end = frame.m_end;
+
+	uint32_t seq = d[0];
+
+	//Broadcast: no way to ask for a retransmit, so any gap kills the message
+	if(session.m_protocol == J1939TransportSession::PROTOCOL_BAM)
+	{
+		if(seq != session.m_nextPacket)
+		{
+			CloseSession(index, J1939TransportSession::STATUS_ERROR,
+				string("Bad sequence number ") + to_string(seq) + ", expected " + to_string(session.m_nextPacket));
+			return true;
+		}
+
+		StoreData(session, seq, frame);
+		session.m_nextPacket ++;
+		if(session.HasAllData())
+			CompleteSession(index, completed);
+		else
+			StartTimer(index, J1939TransportSession::WAIT_DT, frame.m_end, TIMEOUT_T1);
+		return true;
+	}
+
+	//Connection mode: the responder decides what to do about errors (normally by aborting), so just note them.
+	//Without a DPO we can't tell which ETP packet this is.
+	if(session.m_wait != J1939TransportSession::WAIT_DT)
+	{
+		session.m_warnings.push_back("Unexpected data packet");
+		if(extended)
+			return true;
+	}
+
+	uint32_t packet = extended ? (session.m_dpoOffset + seq) : seq;
+	if(packet != session.m_nextPacket)
+	{
+		session.m_warnings.push_back(
+			string("Bad sequence number ") + to_string(packet) + ", expected " + to_string(session.m_nextPacket));
+	}
+	else if( (packet < session.m_windowStart) || (packet > session.m_windowEnd) )
+		session.m_warnings.push_back(string("Packet ") + to_string(packet) + " was not requested");
+
+	StoreData(session, packet, frame);
+	session.m_nextPacket = packet + 1;
+
+	//End of the window? Wait for the next CTS (or EoMA)
+	if(packet >= session.m_windowEnd)
+		StartTimer(index, J1939TransportSession::WAIT_CTS, frame.m_end, TIMEOUT_T3);
+	else
+		StartTimer(index, J1939TransportSession::WAIT_DT, frame.m_end, TIMEOUT_T1);
+	return true;
+}
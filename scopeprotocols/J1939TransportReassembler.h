@@ -0,0 +1,316 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of J1939TransportReassembler
+ */
+#ifndef J1939TransportReassembler_h
+#define J1939TransportReassembler_h
+
+#include "J1939PDUDecoder.h"
+#include <queue>
+#include <unordered_map>
+
+/**
+	@brief A single J1939 frame, as seen at the PDU layer
+ */
+class J1939Frame
+{
+public:
+	J1939Frame()
+		: m_start(0)
+		, m_idEnd(0)
+		, m_end(0)
+		, m_priority(0)
+		, m_pgn(0)
+		, m_dest(0xff)
+		, m_source(0)
+		, m_firstSample(0)
+		, m_sampleCount(0)
+	{}
+
+	///@brief True if the PDU format has a destination address field
+	bool IsPDU1() const
+	{ return ( (m_pgn >> 8) & 0xff ) < 240; }
+
+	///@brief Start of the frame, end of the CAN ID, and end of the last data byte, in fs
+	int64_t m_start;
+	int64_t m_idEnd;
+	int64_t m_end;
+
+	uint8_t m_priority;
+	uint32_t m_pgn;
+
+	///@brief Destination address (0xff for PDU2 frames, which are always broadcast)
+	uint8_t m_dest;
+	uint8_t m_source;
+
+	std::vector<uint8_t> m_data;
+
+	///@brief Location of the frame's symbols in the J1939PDUWaveform it was read from
+	size_t m_firstSample;
+	size_t m_sampleCount;
+};
+
+/**
+	@brief A multi-packet message carried by the J1939-21 transport protocol (TP) or extended transport protocol (ETP)
+ */
+class J1939TransportSession
+{
+public:
+	J1939TransportSession()
+		: m_protocol(PROTOCOL_BAM)
+		, m_status(STATUS_ACTIVE)
+		, m_source(0)
+		, m_dest(0xff)
+		, m_priority(0)
+		, m_pgn(0)
+		, m_size(0)
+		, m_packetCount(0)
+		, m_maxPerCts(0xff)
+		, m_start(0)
+		, m_end(0)
+		, m_received(0)
+		, m_ctsCount(0)
+		, m_retransmits(0)
+		, m_abortReason(0)
+		, m_abortedByResponder(false)
+		, m_wait(WAIT_NONE)
+		, m_windowStart(0)
+		, m_windowEnd(0)
+		, m_nextPacket(0)
+		, m_dpoOffset(0)
+		, m_timeout(0)
+		, m_generation(0)
+	{}
+
+	enum Protocol
+	{
+		PROTOCOL_BAM,		//TP broadcast announce message, no flow control
+		PROTOCOL_RTS_CTS,	//TP connection mode, up to 1785 bytes
+		PROTOCOL_ETP		//Extended TP connection mode, up to 117 MB
+	};
+
+	enum Status
+	{
+		STATUS_ACTIVE,		//still in progress
+		STATUS_COMPLETE,	//all data was received and (for connection mode) acknowledged
+		STATUS_ABORTED,		//either side sent a connection abort, or a new session replaced this one
+		STATUS_TIMEOUT,		//one of the J1939-21 timers expired
+		STATUS_ERROR,		//protocol violation the receiver cannot recover from
+		STATUS_INCOMPLETE	//capture ended before the session did
+	};
+
+	///@brief What the session is waiting for next
+	enum Wait
+	{
+		WAIT_NONE,
+		WAIT_CTS,			//originator waiting for CTS or EoMA (T3)
+		WAIT_HOLD,			//originator waiting for the next CTS after a hold (T4)
+		WAIT_DPO,			//ETP responder waiting for the DPO after a CTS (T2)
+		WAIT_DT				//waiting for the next data packet (T1, or T2 right after the CTS)
+	};
+
+	bool IsConnectionMode() const
+	{ return m_protocol != PROTOCOL_BAM; }
+
+	bool HasAllData() const
+	{ return (m_packetCount != 0) && (m_received == m_packetCount); }
+
+	std::string GetTypeName() const;
+	std::string GetStatusText() const;
+
+	Protocol m_protocol;
+	Status m_status;
+
+	///@brief Originator and responder addresses (responder is 0xff for BAM)
+	uint8_t m_source;
+	uint8_t m_dest;
+
+	///@brief Priority of the connection management frame that opened the session
+	uint8_t m_priority;
+
+	///@brief PGN of the message being carried
+	uint32_t m_pgn;
+
+	///@brief Message size in bytes, and the number of 7-byte data packets it takes
+	uint32_t m_size;
+	uint32_t m_packetCount;
+
+	///@brief Largest number of packets the originator will accept per CTS (TP only, 0xff for no limit)
+	uint8_t m_maxPerCts;
+
+	///@brief Start of the opening CM frame and end of the last frame belonging to the session, in fs
+	int64_t m_start;
+	int64_t m_end;
+
+	///@brief Reassembled payload (truncated to m_size once the message is complete)
+	std::vector<uint8_t> m_data;
+
+	///@brief Number of distinct data packets received so far
+	uint32_t m_received;
+
+	uint32_t m_ctsCount;
+
+	///@brief Number of data packets that were sent more than once
+	uint32_t m_retransmits;
+
+	///@brief Reason code from the connection abort, if there was one
+	uint8_t m_abortReason;
+	bool m_abortedByResponder;
+
+	///@brief Description of the timeout or protocol error that ended the session, plus any non-fatal warnings
+	std::string m_error;
+	std::vector<std::string> m_warnings;
+
+	Wait m_wait;
+
+	///@brief Packet numbers (1-based) requested by the current CTS, inclusive
+	uint32_t m_windowStart;
+	uint32_t m_windowEnd;
+
+	///@brief Packet number we expect to see next
+	uint32_t m_nextPacket;
+
+	///@brief Data packet offset from the last ETP DPO
+	uint32_t m_dpoOffset;
+
+	///@brief Which packets have been received so far
+	std::vector<bool> m_packetValid;
+
+	///@brief Length of the timer currently running, in fs
+	int64_t m_timeout;
+
+	///@brief Bumped every time the session's timer is restarted, so stale timers in the queue can be ignored
+	uint32_t m_generation;
+};
+
+/**
+	@brief Reassembles J1939 TP and ETP messages from a stream of frames
+
+	Sessions are keyed by protocol, originator and responder address, so any number of them can be in flight at once.
+	J1939-21 timeouts are checked lazily against the start time of each new frame, using a queue of deadlines sorted by
+	expiry time. This keeps the cost of a frame logarithmic in the number of open sessions rather than linear.
+ */
+class J1939TransportReassembler
+{
+public:
+	J1939TransportReassembler();
+
+	void Clear();
+
+	static void GetFrames(J1939PDUWaveform* wfm, std::vector<J1939Frame>& frames);
+	static bool IsTransportPGN(uint32_t pgn);
+	static std::string GetAbortReasonName(uint8_t reason);
+
+	size_t AddFrame(const J1939Frame& frame);
+	void Flush();
+
+	///@brief Enables or disables enforcement of the J1939-21 timeouts
+	void SetTimeoutsEnabled(bool enabled)
+	{ m_timeoutsEnabled = enabled; }
+
+	///@brief All sessions seen so far, in order of start time
+	const std::vector<J1939TransportSession>& GetSessions() const
+	{ return m_sessions; }
+
+	///@brief Number of sessions currently in flight
+	size_t GetActiveSessionCount() const
+	{ return m_active.size(); }
+
+	///@brief Largest number of sessions that were in flight at once
+	size_t GetPeakActiveSessionCount() const
+	{ return m_peakActive; }
+
+	///@brief Transport layer frames that did not belong to any session
+	const std::vector<J1939Frame>& GetUnexpectedFrames() const
+	{ return m_unexpected; }
+
+	///@brief Value returned by AddFrame() when the frame did not complete a session
+	static const size_t NO_SESSION = SIZE_MAX;
+
+	//PGNs used by the transport protocols
+	static const uint32_t PGN_TP_CM = 0xec00;
+	static const uint32_t PGN_TP_DT = 0xeb00;
+	static const uint32_t PGN_ETP_CM = 0xc800;
+	static const uint32_t PGN_ETP_DT = 0xc700;
+
+	//J1939-21 timeouts, in fs
+	static constexpr int64_t FS_PER_MS = 1000LL * 1000 * 1000 * 1000;
+	static constexpr int64_t TIMEOUT_T1 = 750 * FS_PER_MS;
+	static constexpr int64_t TIMEOUT_T2 = 1250 * FS_PER_MS;
+	static constexpr int64_t TIMEOUT_T3 = 1250 * FS_PER_MS;
+	static constexpr int64_t TIMEOUT_T4 = 1050 * FS_PER_MS;
+
+protected:
+	bool OnConnectionManagement(const J1939Frame& frame, bool extended, size_t& completed);
+	bool OnData(const J1939Frame& frame, bool extended, size_t& completed);
+
+	size_t OpenSession(const J1939TransportSession& session);
+	void CloseSession(size_t index, J1939TransportSession::Status status, const std::string& why = "");
+	void CompleteSession(size_t index, size_t& completed);
+	size_t FindSession(bool extended, uint8_t originator, uint8_t responder, uint32_t pgn);
+	void StartTimer(size_t index, J1939TransportSession::Wait wait, int64_t now, int64_t timeout);
+	void CheckTimeouts(int64_t now);
+	void StoreData(J1939TransportSession& session, uint32_t packet, const J1939Frame& frame);
+
+	///@brief Key for the session between an originator and responder
+	static uint32_t GetKey(bool extended, uint8_t originator, uint8_t responder)
+	{ return (extended ? 0x10000 : 0) | (originator << 8) | responder; }
+
+	static uint32_t GetKey(const J1939TransportSession& session)
+	{ return GetKey(session.m_protocol == J1939TransportSession::PROTOCOL_ETP, session.m_source, session.m_dest); }
+
+	///@brief A pending timeout
+	class Timer
+	{
+	public:
+		int64_t m_deadline;
+		size_t m_session;
+		uint32_t m_generation;
+
+		bool operator>(const Timer& rhs) const
+		{ return m_deadline > rhs.m_deadline; }
+	};
+
+	std::vector<J1939TransportSession> m_sessions;
+	std::vector<J1939Frame> m_unexpected;
+
+	///@brief Map of session keys to indexes in m_sessions, for sessions that are still active
+	std::unordered_map<uint32_t, size_t> m_active;
+	size_t m_peakActive;
+
+	std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer> > m_timers;
+	bool m_timeoutsEnabled;
+};
+
+#endif
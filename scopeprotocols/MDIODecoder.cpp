@@ -947,17 +947,17 @@ string MDIOWaveform::GetText(size_t i)
 bool MDIODecoder::CanMerge(Packet* first, Packet* /*cur*/, Packet* next)
 {
 	//If different PHYs, obviously can't merge
-	if(first->m_headers["PHY"] != next->m_headers["PHY"])
+	if(first->GetHeader("PHY") != next->GetHeader("PHY"))
 		return false;
 
 	//Start merging when we get an access to the MMD address register
-	if( (first->m_headers["Reg"] == "0d") && (first->m_headers["Info"].find("Register") != string::npos) )
+	if( (first->GetHeader("Reg") == "0d") && (first->GetHeader("Info").find("Register") != string::npos) )
 	{
 		//Only merge accesses to 0e or 0d-with-data
-		if(next->m_headers["Reg"] == "0e")
+		if(next->GetHeader("Reg") == "0e")
 			return true;
 
-		if( (next->m_headers["Reg"] == "0d") && (next->m_headers["Info"].find("Data") != string::npos) )
+		if( (next->GetHeader("Reg") == "0d") && (next->GetHeader("Info").find("Data") != string::npos) )
 			return true;
 	}
 
@@ -971,12 +971,12 @@ Packet* MDIODecoder::CreateMergedHeader(Packet* pack, size_t i)
 	ret->m_len = pack->m_len;
 
 	//Default to copying everything from the first packet
-	ret->m_headers["Clause"] = pack->m_headers["Clause"];
-	ret->m_headers["Op"] = pack->m_headers["Op"];
-	ret->m_headers["PHY"] = pack->m_headers["PHY"];
-	ret->m_headers["Reg"] = pack->m_headers["Reg"];
-	ret->m_headers["Value"] = pack->m_headers["Value"];
-	ret->m_headers["Info"] = pack->m_headers["Info"];
+	ret->m_headers["Clause"] = pack->GetHeader("Clause");
+	ret->m_headers["Op"] = pack->GetHeader("Op");
+	ret->m_headers["PHY"] = pack->GetHeader("PHY");
+	ret->m_headers["Reg"] = pack->GetHeader("Reg");
+	ret->m_headers["Value"] = pack->GetHeader("Value");
+	ret->m_headers["Info"] = pack->GetHeader("Info");
 	ret->m_displayBackgroundColor = pack->m_displayBackgroundColor;
 
 	int phytype = m_parameters[m_typename].GetIntVal();
@@ -990,15 +990,15 @@ Packet* MDIODecoder::CreateMergedHeader(Packet* pack, size_t i)
 	{
 		//Check type field
 		auto p = m_packets[j];
-		unsigned int pvalue = strtol(p->m_headers["Value"].c_str(), NULL, 16);
+		unsigned int pvalue = strtol(p->GetHeader("Value").c_str(), NULL, 16);
 
 		//Extend us
 		ret->m_len = (p->m_offset + p->m_len) - ret->m_offset;
 
 		//Decode address info
-		if(p->m_headers["Reg"] == "0d")
+		if(p->GetHeader("Reg") == "0d")
 		{
-			if(p->m_headers["Info"].find("Register") != string::npos)
+			if(p->GetHeader("Info").find("Register") != string::npos)
 				mmd_is_addr = true;
 			else
 				mmd_is_addr = false;
@@ -1006,7 +1006,7 @@ Packet* MDIODecoder::CreateMergedHeader(Packet* pack, size_t i)
 			mmd_device = pvalue & 0x1f;
 		}
 
-		if(p->m_headers["Reg"] == "0e")
+		if(p->GetHeader("Reg") == "0e")
 		{
 			if(mmd_is_addr)
 				mmd_reg_addr = pvalue;
@@ -1014,9 +1014,9 @@ Packet* MDIODecoder::CreateMergedHeader(Packet* pack, size_t i)
 			//Figure out top level op type on the final data transaction
 			else
 			{
-				ret->m_headers["Op"] = p->m_headers["Op"];
-				ret->m_headers["Reg"] = p->m_headers["Reg"];
-				ret->m_headers["Value"] = p->m_headers["Value"];
+				ret->m_headers["Op"] = p->GetHeader("Op");
+				ret->m_headers["Reg"] = p->GetHeader("Reg");
+				ret->m_headers["Value"] = p->GetHeader("Value");
 				ret->m_displayBackgroundColor = p->m_displayBackgroundColor;
 
 				mmd_value = pvalue;
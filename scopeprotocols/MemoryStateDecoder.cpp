@@ -0,0 +1,655 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+#include "../scopehal/scopehal.h"
+#include "MemoryStateDecoder.h"
+#include "SPIFlashDecoder.h"
+#include "I2CEepromDecoder.h"
+#include "SWDMemAPDecoder.h"
+#include "HyperRAMDecoder.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+MemoryStateDecoder::MemoryStateDecoder(const string& color)
+	: PacketDecoder(color, CAT_MEMORY)
+	, m_typename("Memory Type")
+	, m_pagesizename("Page Size")
+	, m_sectorsizename("Sector Size")
+	, m_blocksizename("Block Size")
+	, m_capacityname("Capacity")
+	, m_imagename("Initial Image")
+	, m_outfilename("Output Image")
+{
+	CreateInput("mem");
+
+	m_parameters[m_typename] = FilterParameter(FilterParameter::TYPE_ENUM, Unit(Unit::UNIT_COUNTS));
+	m_parameters[m_typename].AddEnumValue("Auto", MEMORY_AUTO);
+	m_parameters[m_typename].AddEnumValue("NOR Flash", MEMORY_NOR_FLASH);
+	m_parameters[m_typename].AddEnumValue("EEPROM", MEMORY_EEPROM);
+	m_parameters[m_typename].AddEnumValue("RAM", MEMORY_RAM);
+	m_parameters[m_typename].SetIntVal(MEMORY_AUTO);
+
+	//Writes wrap around within a page (flash page program, EEPROM page write)
+	m_parameters[m_pagesizename] = FilterParameter(FilterParameter::TYPE_INT, Unit(Unit::UNIT_BYTES));
+	m_parameters[m_pagesizename].SetIntVal(256);
+
+	//Granularity of the SPI flash sector (0x20) and block (0xd8) erase commands
+	m_parameters[m_sectorsizename] = FilterParameter(FilterParameter::TYPE_INT, Unit(Unit::UNIT_BYTES));
+	m_parameters[m_sectorsizename].SetIntVal(4096);
+
+	m_parameters[m_blocksizename] = FilterParameter(FilterParameter::TYPE_INT, Unit(Unit::UNIT_BYTES));
+	m_parameters[m_blocksizename].SetIntVal(65536);
+
+	//Size of the whole device, for chip erase and EEPROM address pointer rollover
+	m_parameters[m_capacityname] = FilterParameter(FilterParameter::TYPE_INT, Unit(Unit::UNIT_BYTES));
+	m_parameters[m_capacityname].SetIntVal(16 * 1024 * 1024);
+
+	//Known contents of the device at the start of the capture
+	m_parameters[m_imagename] = FilterParameter(FilterParameter::TYPE_FILENAME, Unit(Unit::UNIT_COUNTS));
+	m_parameters[m_imagename].m_fileFilterMask = "*.bin";
+	m_parameters[m_imagename].m_fileFilterName = "Binary files (*.bin)";
+	m_parameters[m_imagename].m_fileIsOutput = false;
+
+	//Contents at the end of the capture. Saved as Intel HEX if the extension is .hex, raw binary otherwise
+	m_parameters[m_outfilename] = FilterParameter(FilterParameter::TYPE_FILENAME, Unit(Unit::UNIT_COUNTS));
+	m_parameters[m_outfilename].m_fileFilterMask = "*.bin";
+	m_parameters[m_outfilename].m_fileFilterName = "Binary files (*.bin)";
+	m_parameters[m_outfilename].m_fileIsOutput = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Factory methods
+
+bool MemoryStateDecoder::ValidateChannel(size_t i, StreamDescriptor stream)
+{
+	if(stream.m_channel == NULL)
+		return false;
+	if(i != 0)
+		return false;
+
+	auto data = stream.GetData();
+	if(dynamic_cast<SPIFlashWaveform*>(data) != NULL)
+		return true;
+	if(dynamic_cast<I2CEepromWaveform*>(data) != NULL)
+		return true;
+	if(dynamic_cast<SWDMemAPWaveform*>(data) != NULL)
+		return true;
+	if(dynamic_cast<HyperRAMWaveform*>(data) != NULL)
+		return true;
+
+	return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Accessors
+
+vector<string> MemoryStateDecoder::GetHeaders()
+{
+	vector<string> ret;
+	ret.push_back("Op");
+	ret.push_back("Address");
+	ret.push_back("Len");
+	ret.push_back("Info");
+	return ret;
+}
+
+string MemoryStateDecoder::GetProtocolName()
+{
+	return "Memory State";
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Actual decoder logic
+
+void MemoryStateDecoder::Refresh()
+{
+	ClearPackets();
+	m_model.Clear();
+
+	if(!VerifyAllInputsOK())
+	{
+		SetData(NULL, 0);
+		return;
+	}
+
+	auto din = GetInputWaveform(0);
+	auto dspi = dynamic_cast<SPIFlashWaveform*>(din);
+	auto di2c = dynamic_cast<I2CEepromWaveform*>(din);
+	auto dswd = dynamic_cast<SWDMemAPWaveform*>(din);
+	auto dhram = dynamic_cast<HyperRAMWaveform*>(din);
+	if(!dspi && !di2c && !dswd && !dhram)
+	{
+		SetData(NULL, 0);
+		return;
+	}
+	din->PrepareForCpuAccess();
+
+	//Figure out what kind of memory we're looking at
+	auto type = static_cast<MemoryType>(m_parameters[m_typename].GetIntVal());
+	if(type == MEMORY_AUTO)
+	{
+		if(dspi)
+			type = MEMORY_NOR_FLASH;
+		else if(di2c)
+			type = MEMORY_EEPROM;
+		else
+			type = MEMORY_RAM;
+	}
+	uint64_t pagesize = max(m_parameters[m_pagesizename].GetIntVal(), (int64_t)1);
+	uint64_t capacity = max(m_parameters[m_capacityname].GetIntVal(), (int64_t)1);
+
+	//Pull the accesses out of the input
+	vector<Access> accesses;
+	if(dspi)
+		ExtractSPIFlash(dspi, accesses);
+	else if(di2c)
+		ExtractI2CEeprom(di2c, accesses, type);
+	else if(dswd)
+		ExtractSWDMemAP(dswd, accesses);
+	else
+		ExtractHyperRAM(dhram, accesses);
+
+	//Preload the initial image, if we have one
+	auto fname = m_parameters[m_imagename].GetFileName();
+	if(!fname.empty())
+	{
+		auto image = ReadFile(fname);
+		m_model.LoadImage(0, vector<uint8_t>(image.begin(), image.end()));
+	}
+
+	//Set up output
+	auto cap = new MemoryStateWaveform;
+	cap->m_timescale = din->m_timescale;
+	cap->m_startTimestamp = din->m_startTimestamp;
+	cap->m_startFemtoseconds = din->m_startFemtoseconds;
+	cap->m_triggerPhase = din->m_triggerPhase;
+	cap->PrepareForCpuAccess();
+
+	//Apply each access to the model.
+	//Timestamp of the operation is the end of the access, since that's when the device has all the data.
+	char tmp[128];
+	for(auto& a : accesses)
+	{
+		int64_t tend = a.m_end * din->m_timescale + din->m_triggerPhase;
+
+		size_t nop;
+		switch(a.m_type)
+		{
+			case MemoryOperation::OP_ERASE:
+				{
+					//Round out to the erase granularity. Length is the erase size, or zero for chip erase
+					uint64_t size = a.m_length ? a.m_length : capacity;
+					uint64_t base = a.m_length ? (a.m_address - (a.m_address % size)) : 0;
+					nop = m_model.Erase(tend, base, size);
+				}
+				break;
+
+			case MemoryOperation::OP_READ:
+				nop = m_model.Read(tend, a.m_address, a.m_data, a.m_wrap);
+				break;
+
+			case MemoryOperation::OP_WRITE:
+			case MemoryOperation::OP_PROGRAM:
+			default:
+				switch(type)
+				{
+					case MEMORY_NOR_FLASH:
+						nop = m_model.Program(tend, a.m_address, a.m_data, a.m_wrap ? a.m_wrap : pagesize);
+						break;
+
+					case MEMORY_EEPROM:
+						nop = m_model.Write(tend, a.m_address, a.m_data, a.m_wrap ? a.m_wrap : pagesize);
+						break;
+
+					case MEMORY_RAM:
+					default:
+						nop = m_model.Write(tend, a.m_address, a.m_data, a.m_wrap);
+						break;
+				}
+				break;
+		}
+
+		auto& op = m_model.GetOperations()[nop];
+		uint64_t errors = op.m_mismatches + op.m_conflicts;
+
+		cap->m_offsets.push_back(a.m_start);
+		cap->m_durations.push_back(a.m_end - a.m_start);
+		cap->m_samples.push_back(MemoryStateSymbol(op.m_type, op.m_address, op.m_length, errors));
+
+		auto pack = new Packet;
+		pack->m_offset = a.m_start * din->m_timescale + din->m_triggerPhase;
+		pack->m_len = (a.m_end - a.m_start) * din->m_timescale;
+		pack->m_data = a.m_data;
+
+		switch(op.m_type)
+		{
+			case MemoryOperation::OP_WRITE:
+				pack->m_headers["Op"] = "Write";
+				pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_DATA_WRITE];
+				break;
+
+			case MemoryOperation::OP_PROGRAM:
+				pack->m_headers["Op"] = "Program";
+				pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_DATA_WRITE];
+				if(op.m_conflicts)
+				{
+					snprintf(tmp, sizeof(tmp), "%" PRIu64 " bytes not erased", op.m_conflicts);
+					pack->m_headers["Info"] = tmp;
+				}
+				break;
+
+			case MemoryOperation::OP_ERASE:
+				pack->m_headers["Op"] = "Erase";
+				pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_COMMAND];
+				break;
+
+			case MemoryOperation::OP_READ:
+			default:
+				pack->m_headers["Op"] = "Read";
+				pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_DATA_READ];
+				if(op.m_mismatches)
+				{
+					snprintf(tmp, sizeof(tmp), "%" PRIu64 " bytes mismatched", op.m_mismatches);
+					pack->m_headers["Info"] = tmp;
+				}
+				else if(op.m_learned == op.m_length)
+					pack->m_headers["Info"] = "New";
+				else if(op.m_learned == 0)
+					pack->m_headers["Info"] = "Match";
+				else
+				{
+					snprintf(tmp, sizeof(tmp), "Match, %" PRIu64 " bytes new", op.m_learned);
+					pack->m_headers["Info"] = tmp;
+				}
+				break;
+		}
+		if(errors)
+			pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_ERROR];
+
+		snprintf(tmp, sizeof(tmp), "%08" PRIx64, op.m_address);
+		pack->m_headers["Address"] = tmp;
+		snprintf(tmp, sizeof(tmp), "%" PRIu64, op.m_length);
+		pack->m_headers["Len"] = tmp;
+
+		m_packets.push_back(pack);
+	}
+
+	SetData(cap, 0);
+	cap->MarkModifiedFromCpu();
+
+	//Save the final state if requested
+	fname = m_parameters[m_outfilename].GetFileName();
+	if(!fname.empty())
+	{
+		if( (fname.length() > 4) && (fname.substr(fname.length() - 4) == ".hex") )
+			m_model.ExportIntelHex(fname, INT64_MAX);
+		else
+			m_model.ExportBinary(fname, INT64_MAX, 0, capacity);
+	}
+}
+
+/**
+	@brief Extracts reads, page programs, and erases from a SPI flash decode
+
+	Erases are reported with the erase granularity as the length (0 for chip erase) and aligned by Refresh().
+ */
+void MemoryStateDecoder::ExtractSPIFlash(SPIFlashWaveform* din, vector<Access>& accesses)
+{
+	uint64_t sectorsize = max(m_parameters[m_sectorsizename].GetIntVal(), (int64_t)1);
+	uint64_t blocksize = max(m_parameters[m_blocksizename].GetIntVal(), (int64_t)1);
+
+	Access cur;
+	bool active = false;
+	bool have_addr = false;
+	for(size_t i=0; i<din->m_samples.size(); i++)
+	{
+		auto& s = din->m_samples[i];
+		int64_t end = din->m_offsets[i] + din->m_durations[i];
+
+		switch(s.m_type)
+		{
+			//A new command ends the previous one
+			case SPIFlashSymbol::TYPE_COMMAND:
+				if(active && !cur.m_data.empty())
+				{
+					cur.m_length = cur.m_data.size();
+					accesses.push_back(cur);
+				}
+				active = false;
+				have_addr = false;
+
+				cur.m_start = din->m_offsets[i];
+				cur.m_end = end;
+				cur.m_address = 0;
+				cur.m_length = 0;
+				cur.m_wrap = 0;
+				cur.m_data.clear();
+
+				switch(s.m_cmd)
+				{
+					case SPIFlashSymbol::CMD_READ:
+					case SPIFlashSymbol::CMD_FAST_READ:
+					case SPIFlashSymbol::CMD_READ_1_1_4:
+					case SPIFlashSymbol::CMD_READ_1_4_4:
+						cur.m_type = MemoryOperation::OP_READ;
+						active = true;
+						break;
+
+					case SPIFlashSymbol::CMD_PAGE_PROGRAM:
+					case SPIFlashSymbol::CMD_QUAD_PAGE_PROGRAM:
+						cur.m_type = MemoryOperation::OP_WRITE;
+						active = true;
+						break;
+
+					//Sector and block erases take effect once we have the address
+					case SPIFlashSymbol::CMD_SECTOR_ERASE:
+						cur.m_type = MemoryOperation::OP_ERASE;
+						cur.m_length = sectorsize;
+						active = true;
+						break;
+
+					case SPIFlashSymbol::CMD_BLOCK_ERASE:
+						cur.m_type = MemoryOperation::OP_ERASE;
+						cur.m_length = blocksize;
+						active = true;
+						break;
+
+					//Chip erase has no address
+					case SPIFlashSymbol::CMD_CHIP_ERASE:
+						cur.m_type = MemoryOperation::OP_ERASE;
+						accesses.push_back(cur);
+						break;
+
+					default:
+						break;
+				}
+				break;
+
+			case SPIFlashSymbol::TYPE_ADDRESS:
+				if(!active)
+					break;
+
+				cur.m_address = s.m_data;
+				cur.m_end = end;
+				have_addr = true;
+
+				if(cur.m_type == MemoryOperation::OP_ERASE)
+				{
+					accesses.push_back(cur);
+					active = false;
+				}
+				break;
+
+			case SPIFlashSymbol::TYPE_DATA:
+				if(active && have_addr)
+				{
+					cur.m_data.push_back(s.m_data);
+					cur.m_end = end;
+				}
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	if(active && !cur.m_data.empty())
+	{
+		cur.m_length = cur.m_data.size();
+		accesses.push_back(cur);
+	}
+}
+
+/**
+	@brief Extracts reads and writes from an I2C EEPROM decode
+
+	Tracks the device's address pointer so current-address reads (with no address phase) land in the right place.
+ */
+void MemoryStateDecoder::ExtractI2CEeprom(I2CEepromWaveform* din, vector<Access>& accesses, MemoryType type)
+{
+	uint64_t pagesize = max(m_parameters[m_pagesizename].GetIntVal(), (int64_t)1);
+	uint64_t capacity = max(m_parameters[m_capacityname].GetIntVal(), (int64_t)1);
+
+	uint64_t ptr = 0;
+	Access cur;
+	bool active = false;
+
+	auto flush = [&]()
+	{
+		if(!active || cur.m_data.empty())
+			return;
+		cur.m_length = cur.m_data.size();
+		accesses.push_back(cur);
+
+		//Pointer ends up one past the last byte accessed, rolling over within the page for page writes
+		MemoryOperation op;
+		op.m_address = cur.m_address;
+		if( (cur.m_type == MemoryOperation::OP_WRITE) && (type != MEMORY_RAM) )
+			op.m_wrap = pagesize;
+		ptr = op.GetAddress(cur.m_length) % capacity;
+	};
+
+	for(size_t i=0; i<din->m_samples.size(); i++)
+	{
+		auto& s = din->m_samples[i];
+		int64_t end = din->m_offsets[i] + din->m_durations[i];
+
+		switch(s.m_type)
+		{
+			case I2CEepromSymbol::TYPE_SELECT_READ:
+			case I2CEepromSymbol::TYPE_SELECT_WRITE:
+				flush();
+				active = true;
+				cur.m_start = din->m_offsets[i];
+				cur.m_end = end;
+				cur.m_type = (s.m_type == I2CEepromSymbol::TYPE_SELECT_READ) ?
+					MemoryOperation::OP_READ : MemoryOperation::OP_WRITE;
+				cur.m_address = ptr;
+				cur.m_wrap = 0;
+				cur.m_data.clear();
+				break;
+
+			//Polls don't touch the memory
+			case I2CEepromSymbol::TYPE_POLL_BUSY:
+			case I2CEepromSymbol::TYPE_POLL_OK:
+				flush();
+				active = false;
+				break;
+
+			case I2CEepromSymbol::TYPE_ADDRESS:
+				ptr = s.m_data % capacity;
+				cur.m_address = ptr;
+				cur.m_end = end;
+				break;
+
+			case I2CEepromSymbol::TYPE_DATA:
+				if(active)
+				{
+					cur.m_data.push_back(s.m_data);
+					cur.m_end = end;
+				}
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	flush();
+}
+
+/**
+	@brief Extracts reads and writes from a SWD MEM-AP decode (one 32-bit little endian word per access)
+ */
+void MemoryStateDecoder::ExtractSWDMemAP(SWDMemAPWaveform* din, vector<Access>& accesses)
+{
+	Access cur;
+	cur.m_length = 4;
+	cur.m_wrap = 0;
+	cur.m_data.resize(4);
+	for(size_t i=0; i<din->m_samples.size(); i++)
+	{
+		auto& s = din->m_samples[i];
+
+		cur.m_start = din->m_offsets[i];
+		cur.m_end = din->m_offsets[i] + din->m_durations[i];
+		cur.m_type = s.m_write ? MemoryOperation::OP_WRITE : MemoryOperation::OP_READ;
+		cur.m_address = s.m_addr;
+		for(int j=0; j<4; j++)
+			cur.m_data[j] = (s.m_data >> (j*8)) & 0xff;
+
+		accesses.push_back(cur);
+	}
+}
+
+/**
+	@brief Extracts memory space bursts from a HyperRAM decode
+
+	Register space accesses are ignored.
+ */
+void MemoryStateDecoder::ExtractHyperRAM(HyperRAMWaveform* din, vector<Access>& accesses)
+{
+	//Power-on default wrapped burst length from CR0
+	const uint64_t wrap_size = 32;
+
+	Access cur;
+	bool active = false;
+
+	auto flush = [&]()
+	{
+		if(active && !cur.m_data.empty())
+		{
+			cur.m_length = cur.m_data.size();
+			accesses.push_back(cur);
+		}
+		active = false;
+	};
+
+	for(size_t i=0; i<din->m_samples.size(); i++)
+	{
+		auto& s = din->m_samples[i];
+		int64_t end = din->m_offsets[i] + din->m_durations[i];
+
+		switch(s.m_stype)
+		{
+			case HyperRAMSymbol::TYPE_SELECT:
+				flush();
+				cur.m_start = din->m_offsets[i];
+				cur.m_data.clear();
+				break;
+
+			case HyperRAMSymbol::TYPE_CA:
+				{
+					auto ca = HyperRAMDecoder::DecodeCA(s.m_data);
+					active = !ca.register_space;
+
+					//CA address is in 16-bit words
+					cur.m_address = static_cast<uint64_t>(ca.address) * 2;
+					cur.m_type = ca.read ? MemoryOperation::OP_READ : MemoryOperation::OP_WRITE;
+					cur.m_wrap = ca.linear ? 0 : wrap_size;
+					cur.m_end = end;
+				}
+				break;
+
+			case HyperRAMSymbol::TYPE_DATA:
+				if(active)
+				{
+					cur.m_data.push_back(s.m_data);
+					cur.m_end = end;
+				}
+				break;
+
+			case HyperRAMSymbol::TYPE_DESELECT:
+				flush();
+				break;
+
+			//Don't trust anything in a burst with errors
+			case HyperRAMSymbol::TYPE_ERROR:
+				active = false;
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	flush();
+}
+
+std::string MemoryStateWaveform::GetColor(size_t i)
+{
+	const MemoryStateSymbol& s = m_samples[i];
+	if(s.m_errors)
+		return StandardColors::colors[StandardColors::COLOR_ERROR];
+	else if(s.m_type == MemoryOperation::OP_ERASE)
+		return StandardColors::colors[StandardColors::COLOR_CONTROL];
+	else
+		return StandardColors::colors[StandardColors::COLOR_DATA];
+}
+
+string MemoryStateWaveform::GetText(size_t i)
+{
+	char tmp[128] = "";
+	const MemoryStateSymbol& s = m_samples[i];
+
+	const char* op;
+	switch(s.m_type)
+	{
+		case MemoryOperation::OP_WRITE:
+			op = "Write";
+			break;
+
+		case MemoryOperation::OP_PROGRAM:
+			op = "Program";
+			break;
+
+		case MemoryOperation::OP_ERASE:
+			op = "Erase";
+			break;
+
+		case MemoryOperation::OP_READ:
+		default:
+			op = "Read";
+			break;
+	}
+
+	if(s.m_errors)
+	{
+		snprintf(tmp, sizeof(tmp), "%s %08" PRIx64 " +%" PRIu64 " (%" PRIu64 " errors)",
+			op, s.m_address, s.m_length, s.m_errors);
+	}
+	else
+		snprintf(tmp, sizeof(tmp), "%s %08" PRIx64 " +%" PRIu64, op, s.m_address, s.m_length);
+
+	return string(tmp);
+}
@@ -0,0 +1,155 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of MemoryStateDecoder
+ */
+#ifndef MemoryStateDecoder_h
+#define MemoryStateDecoder_h
+
+#include "../scopehal/PacketDecoder.h"
+#include "MemoryStateModel.h"
+
+class SPIFlashWaveform;
+class I2CEepromWaveform;
+class SWDMemAPWaveform;
+class HyperRAMWaveform;
+
+class MemoryStateSymbol
+{
+public:
+
+	MemoryStateSymbol()
+	{}
+
+	MemoryStateSymbol(MemoryOperation::Type type, uint64_t address, uint64_t length, uint64_t errors)
+	 : m_type(type)
+	 , m_address(address)
+	 , m_length(length)
+	 , m_errors(errors)
+	{}
+
+	MemoryOperation::Type m_type;
+	uint64_t m_address;
+	uint64_t m_length;
+
+	///@brief Number of mismatching bytes (reads) or bytes not erased before programming (program)
+	uint64_t m_errors;
+
+	bool operator== (const MemoryStateSymbol& s) const
+	{
+		return (m_type == s.m_type) && (m_address == s.m_address) && (m_length == s.m_length) && (m_errors == s.m_errors);
+	}
+};
+
+class MemoryStateWaveform : public SparseWaveform<MemoryStateSymbol>
+{
+public:
+	MemoryStateWaveform () : SparseWaveform<MemoryStateSymbol>() {};
+	virtual std::string GetText(size_t) override;
+	virtual std::string GetColor(size_t) override;
+};
+
+/**
+	@brief Reconstructs the contents of a memory device from the accesses decoded by a memory protocol decoder
+
+	Accepts the output of SPIFlashDecoder, I2CEepromDecoder, SWDMemAPDecoder, or HyperRAMDecoder. The accumulated
+	state is available through GetModel() for time-travel queries, and can be saved as an image.
+ */
+class MemoryStateDecoder : public PacketDecoder
+{
+public:
+	MemoryStateDecoder(const std::string& color);
+
+	virtual void Refresh() override;
+
+	static std::string GetProtocolName();
+
+	virtual std::vector<std::string> GetHeaders() override;
+
+	virtual bool ValidateChannel(size_t i, StreamDescriptor stream) override;
+
+	///@brief Memory contents as of the most recent refresh
+	const MemoryStateModel& GetModel() const
+	{ return m_model; }
+
+	enum MemoryType
+	{
+		MEMORY_AUTO,
+		MEMORY_NOR_FLASH,
+		MEMORY_EEPROM,
+		MEMORY_RAM
+	};
+
+	PROTOCOL_DECODER_INITPROC(MemoryStateDecoder)
+
+protected:
+
+	/**
+		@brief A single access extracted from the input, before memory-type specific semantics are applied
+
+		Writes are reported as OP_WRITE and turned into OP_PROGRAM for flash.
+	 */
+	class Access
+	{
+	public:
+		///@brief Start and end of the access, in input timebase units
+		int64_t m_start;
+		int64_t m_end;
+
+		MemoryOperation::Type m_type;
+		uint64_t m_address;
+		uint64_t m_length;
+
+		///@brief Wrap size imposed by the bus protocol (e.g. HyperRAM wrapped bursts), or 0 for default
+		uint64_t m_wrap;
+
+		std::vector<uint8_t> m_data;
+	};
+
+	void ExtractSPIFlash(SPIFlashWaveform* din, std::vector<Access>& accesses);
+	void ExtractI2CEeprom(I2CEepromWaveform* din, std::vector<Access>& accesses, MemoryType type);
+	void ExtractSWDMemAP(SWDMemAPWaveform* din, std::vector<Access>& accesses);
+	void ExtractHyperRAM(HyperRAMWaveform* din, std::vector<Access>& accesses);
+
+	std::string m_typename;
+	std::string m_pagesizename;
+	std::string m_sectorsizename;
+	std::string m_blocksizename;
+	std::string m_capacityname;
+	std::string m_imagename;
+	std::string m_outfilename;
+
+	MemoryStateModel m_model;
+};
+
+#endif
@@ -0,0 +1,561 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+#include "../scopehal/scopehal.h"
+#include "MemoryStateModel.h"
+
+using namespace std;
+
+/**
+	@brief Applies one byte of an operation
+
+	@param op		The operation
+	@param value	Current value of the byte, updated in place
+	@param known	True if the current value is known
+	@param datum	The operation's data for this byte (ignored for erases)
+ */
+static inline void ApplyByte(const MemoryOperation& op, uint8_t& value, bool known, uint8_t datum)
+{
+	switch(op.m_type)
+	{
+		case MemoryOperation::OP_ERASE:
+			value = op.m_fill;
+			break;
+
+		case MemoryOperation::OP_PROGRAM:
+			if(known)
+				value &= datum;
+			else
+				value = datum;
+			break;
+
+		case MemoryOperation::OP_WRITE:
+		case MemoryOperation::OP_READ:
+		default:
+			value = datum;
+			break;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+MemoryStateModel::MemoryStateModel()
+{
+	Clear();
+}
+
+/**
+	@brief Forgets everything, returning to a state where all bytes are unknown
+ */
+void MemoryStateModel::Clear()
+{
+	m_pages.clear();
+	m_ops.clear();
+	m_opData.clear();
+	m_mismatches.clear();
+	m_bytesSinceSnapshot = 0;
+
+	m_snapshots.clear();
+	m_snapshots.push_back(Snapshot());
+	m_snapshots[0].m_nextOp = 0;
+}
+
+/**
+	@brief Preloads known contents (e.g. the image a device was programmed with) before any operations are added
+ */
+void MemoryStateModel::LoadImage(uint64_t address, const vector<uint8_t>& data)
+{
+	if(!m_ops.empty())
+	{
+		LogWarning("MemoryStateModel::LoadImage: ignoring image since operations have already been added\n");
+		return;
+	}
+
+	for(size_t i=0; i<data.size(); )
+	{
+		uint64_t addr = address + i;
+		uint64_t off = addr % MemoryStatePage::PAGE_SIZE;
+		size_t len = min(data.size() - i, static_cast<size_t>(MemoryStatePage::PAGE_SIZE - off));
+
+		auto& page = GetWritablePage(m_pages, addr / MemoryStatePage::PAGE_SIZE);
+		memcpy(page.m_data + off, &data[i], len);
+		for(size_t j=0; j<len; j++)
+			page.m_known[off + j] = true;
+
+		i += len;
+	}
+
+	m_snapshots[0].m_pages = m_pages;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Adding operations
+
+/**
+	@brief Writes data, replacing the previous contents (RAM or EEPROM)
+
+	@param time		Timestamp of the operation, in fs
+	@param address	Starting address
+	@param data		Bytes written
+	@param wrap		If nonzero, addresses wrap around within aligned blocks of this size (e.g. an EEPROM page write)
+
+	@return Index of the operation
+ */
+size_t MemoryStateModel::Write(int64_t time, uint64_t address, const vector<uint8_t>& data, uint64_t wrap)
+{
+	MemoryOperation op;
+	op.m_time = time;
+	op.m_type = MemoryOperation::OP_WRITE;
+	op.m_address = address;
+	op.m_length = data.size();
+	op.m_wrap = wrap;
+	return AddOperation(op, &data);
+}
+
+/**
+	@brief Programs data into flash, which can only change bits from 1 to 0
+
+	@param time		Timestamp of the operation, in fs
+	@param address	Starting address
+	@param data		Bytes programmed
+	@param wrap		If nonzero, addresses wrap around within aligned blocks of this size (the flash page size)
+
+	@return Index of the operation
+ */
+size_t MemoryStateModel::Program(int64_t time, uint64_t address, const vector<uint8_t>& data, uint64_t wrap)
+{
+	MemoryOperation op;
+	op.m_time = time;
+	op.m_type = MemoryOperation::OP_PROGRAM;
+	op.m_address = address;
+	op.m_length = data.size();
+	op.m_wrap = wrap;
+	return AddOperation(op, &data);
+}
+
+/**
+	@brief Erases a range, setting every byte in it to the fill value
+
+	@return Index of the operation
+ */
+size_t MemoryStateModel::Erase(int64_t time, uint64_t address, uint64_t length, uint8_t fill)
+{
+	MemoryOperation op;
+	op.m_time = time;
+	op.m_type = MemoryOperation::OP_ERASE;
+	op.m_address = address;
+	op.m_length = length;
+	op.m_fill = fill;
+	return AddOperation(op, nullptr);
+}
+
+/**
+	@brief Records data read from the device
+
+	Any byte which doesn't match what we already knew is recorded as a mismatch. Either way, the value read becomes the
+	known value of the byte from then on.
+
+	@return Index of the operation
+ */
+size_t MemoryStateModel::Read(int64_t time, uint64_t address, const vector<uint8_t>& data, uint64_t wrap)
+{
+	MemoryOperation op;
+	op.m_time = time;
+	op.m_type = MemoryOperation::OP_READ;
+	op.m_address = address;
+	op.m_length = data.size();
+	op.m_wrap = wrap;
+	return AddOperation(op, &data);
+}
+
+size_t MemoryStateModel::AddOperation(MemoryOperation& op, const vector<uint8_t>* data)
+{
+	//Keep the log sorted so time queries can binary search it
+	if(!m_ops.empty() && (op.m_time < m_ops.back().m_time) )
+		op.m_time = m_ops.back().m_time;
+
+	op.m_dataOffset = m_opData.size();
+	if(data)
+	{
+		m_opData.insert(m_opData.end(), data->begin(), data->end());
+		m_bytesSinceSnapshot += data->size();
+	}
+
+	size_t index = m_ops.size();
+	Apply(op, index);
+	m_ops.push_back(op);
+
+	//Snapshot the page table if we've done enough work since the last one.
+	//This only copies page pointers, the pages themselves are copied on the next write.
+	if( (m_ops.size() - m_snapshots.back().m_nextOp >= SNAPSHOT_OPS) || (m_bytesSinceSnapshot >= SNAPSHOT_BYTES) )
+	{
+		Snapshot snap;
+		snap.m_nextOp = m_ops.size();
+		snap.m_pages = m_pages;
+		m_snapshots.push_back(std::move(snap));
+		m_bytesSinceSnapshot = 0;
+	}
+
+	return index;
+}
+
+/**
+	@brief Calls a function for each contiguous run of addresses touched by an operation which lies within [first, last)
+
+	Runs are reported in the order the operation touches them, so if a wrapped operation touches the same byte more
+	than once the last write wins as it would on the device.
+ */
+void MemoryStateModel::ForEachSegment(
+	const MemoryOperation& op,
+	uint64_t first,
+	uint64_t last,
+	const function<void(uint64_t address, uint64_t offset, uint64_t length)>& func)
+{
+	for(uint64_t i=0; i<op.m_length; )
+	{
+		uint64_t addr = op.GetAddress(i);
+
+		//Length of this run, up to the end of the operation or the wrap block
+		uint64_t len = op.m_length - i;
+		if(op.m_wrap)
+			len = min(len, op.m_wrap - (addr % op.m_wrap));
+
+		//Clip to the window of interest
+		uint64_t start = max(addr, first);
+		uint64_t end = min(addr + len, last);
+		if(start < end)
+			func(start, i + (start - addr), end - start);
+
+		i += len;
+	}
+}
+
+/**
+	@brief Gets a page for modification, allocating it or breaking sharing with snapshots as needed
+ */
+MemoryStatePage& MemoryStateModel::GetWritablePage(PageTable& pages, uint64_t index)
+{
+	auto& p = pages[index];
+	if(!p)
+		p = make_shared<MemoryStatePage>();
+	else if(p.use_count() > 1)
+		p = make_shared<MemoryStatePage>(*p);
+	return *p;
+}
+
+/**
+	@brief Applies a new operation to the live state, updating its statistics
+ */
+void MemoryStateModel::Apply(MemoryOperation& op, size_t index)
+{
+	const uint8_t* data = m_opData.data() + op.m_dataOffset;
+
+	ForEachSegment(op, 0, UINT64_MAX, [&](uint64_t address, uint64_t offset, uint64_t length)
+	{
+		for(uint64_t i=0; i<length; )
+		{
+			uint64_t addr = address + i;
+			uint64_t off = addr % MemoryStatePage::PAGE_SIZE;
+			uint64_t len = min(length - i, MemoryStatePage::PAGE_SIZE - off);
+			auto& page = GetWritablePage(m_pages, addr / MemoryStatePage::PAGE_SIZE);
+
+			for(uint64_t j=0; j<len; j++)
+			{
+				uint8_t& value = page.m_data[off + j];
+				bool known = page.m_known[off + j];
+				uint8_t datum = (op.m_type == MemoryOperation::OP_ERASE) ? 0 : data[offset + i + j];
+
+				if(op.m_type == MemoryOperation::OP_READ)
+				{
+					if(!known)
+						op.m_learned ++;
+					else if(value != datum)
+					{
+						op.m_mismatches ++;
+						if(m_mismatches.size() < MAX_MISMATCHES)
+						{
+							MemoryMismatch m;
+							m.m_time = op.m_time;
+							m.m_address = addr + j;
+							m.m_expected = value;
+							m.m_actual = datum;
+							m.m_operation = index;
+							m_mismatches.push_back(m);
+						}
+					}
+				}
+
+				//Programming a bit from 0 to 1 needs an erase first
+				else if( (op.m_type == MemoryOperation::OP_PROGRAM) && known && (datum & ~value) )
+					op.m_conflicts ++;
+
+				ApplyByte(op, value, known, datum);
+				page.m_known[off + j] = true;
+			}
+
+			i += len;
+		}
+	});
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Queries
+
+/**
+	@brief Reconstructs the state of [first, last) after every operation at or before the given time
+
+	Bytes outside the window may or may not be up to date.
+ */
+void MemoryStateModel::GetStateAt(int64_t time, PageTable& pages, uint64_t first, uint64_t last) const
+{
+	//Number of operations which happened at or before the requested time
+	auto it = upper_bound(m_ops.begin(), m_ops.end(), time,
+		[](int64_t t, const MemoryOperation& op) { return t < op.m_time; });
+	size_t end = it - m_ops.begin();
+
+	//Latest snapshot that doesn't include anything after that
+	auto sit = upper_bound(m_snapshots.begin(), m_snapshots.end(), end,
+		[](size_t n, const Snapshot& s) { return n < s.m_nextOp; });
+	const Snapshot& snap = *(sit - 1);
+
+	//Replay everything since then (pages are shared with the snapshot until we touch them)
+	pages = snap.m_pages;
+	for(size_t i=snap.m_nextOp; i<end; i++)
+	{
+		auto& op = m_ops[i];
+		const uint8_t* data = m_opData.data() + op.m_dataOffset;
+
+		ForEachSegment(op, first, last, [&](uint64_t address, uint64_t offset, uint64_t length)
+		{
+			for(uint64_t j=0; j<length; )
+			{
+				uint64_t addr = address + j;
+				uint64_t off = addr % MemoryStatePage::PAGE_SIZE;
+				uint64_t len = min(length - j, MemoryStatePage::PAGE_SIZE - off);
+				auto& page = GetWritablePage(pages, addr / MemoryStatePage::PAGE_SIZE);
+
+				for(uint64_t k=0; k<len; k++)
+				{
+					uint8_t datum = (op.m_type == MemoryOperation::OP_ERASE) ? 0 : data[offset + j + k];
+					ApplyByte(op, page.m_data[off + k], page.m_known[off + k], datum);
+					page.m_known[off + k] = true;
+				}
+
+				j += len;
+			}
+		});
+	}
+}
+
+/**
+	@brief Gets the contents of a range of memory as of a given time
+
+	@param time		Timestamp, in fs. Operations at exactly this time are included.
+	@param address	Starting address
+	@param length	Number of bytes
+	@param data		Contents of the range (0xff where unknown)
+	@param known	True for each byte whose value is known
+ */
+void MemoryStateModel::GetContents(
+	int64_t time,
+	uint64_t address,
+	size_t length,
+	vector<uint8_t>& data,
+	vector<bool>& known) const
+{
+	data.assign(length, 0xff);
+	known.assign(length, false);
+
+	PageTable pages;
+	GetStateAt(time, pages, address, address + length);
+
+	auto it = pages.lower_bound(address / MemoryStatePage::PAGE_SIZE);
+	for(; it != pages.end(); it++)
+	{
+		uint64_t base = it->first * MemoryStatePage::PAGE_SIZE;
+		if(base >= address + length)
+			break;
+
+		uint64_t start = max(base, address);
+		uint64_t end = min(base + MemoryStatePage::PAGE_SIZE, address + length);
+		for(uint64_t a=start; a<end; a++)
+		{
+			if(it->second->m_known[a - base])
+			{
+				data[a - address] = it->second->m_data[a - base];
+				known[a - address] = true;
+			}
+		}
+	}
+}
+
+/**
+	@brief Gets the list of [start, end) address ranges whose contents are known at a given time
+ */
+vector<pair<uint64_t, uint64_t> > MemoryStateModel::GetKnownRanges(int64_t time) const
+{
+	PageTable pages;
+	GetStateAt(time, pages, 0, UINT64_MAX);
+
+	vector<pair<uint64_t, uint64_t> > ret;
+	for(auto& it : pages)
+	{
+		uint64_t base = it.first * MemoryStatePage::PAGE_SIZE;
+		auto& known = it.second->m_known;
+		if(known.none())
+			continue;
+
+		for(size_t i=0; i<MemoryStatePage::PAGE_SIZE; i++)
+		{
+			if(!known[i])
+				continue;
+
+			//Extend the previous range if contiguous, otherwise start a new one
+			uint64_t addr = base + i;
+			if(!ret.empty() && (ret.back().second == addr))
+				ret.back().second = addr + 1;
+			else
+				ret.push_back(pair<uint64_t, uint64_t>(addr, addr + 1));
+		}
+	}
+
+	return ret;
+}
+
+size_t MemoryStateModel::GetPageCount() const
+{
+	set<const MemoryStatePage*> pages;
+	for(auto& it : m_pages)
+		pages.emplace(it.second.get());
+	for(auto& snap : m_snapshots)
+	{
+		for(auto& it : snap.m_pages)
+			pages.emplace(it.second.get());
+	}
+	return pages.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Export
+
+/**
+	@brief Writes a raw binary image of a range as of a given time, filling unknown bytes with a constant
+
+	@return True on success
+ */
+bool MemoryStateModel::ExportBinary(const string& path, int64_t time, uint64_t address, uint64_t length, uint8_t fill) const
+{
+	vector<uint8_t> data;
+	vector<bool> known;
+	GetContents(time, address, length, data, known);
+	for(size_t i=0; i<length; i++)
+	{
+		if(!known[i])
+			data[i] = fill;
+	}
+
+	FILE* fp = fopen(path.c_str(), "wb");
+	if(!fp)
+	{
+		LogError("MemoryStateModel: couldn't open %s for writing\n", path.c_str());
+		return false;
+	}
+	bool ok = (fwrite(data.data(), 1, data.size(), fp) == data.size());
+	fclose(fp);
+	return ok;
+}
+
+/**
+	@brief Writes an Intel HEX image of all known bytes as of a given time
+
+	Unknown bytes are left out of the file entirely, so sparse images stay small.
+
+	@return True on success
+ */
+bool MemoryStateModel::ExportIntelHex(const string& path, int64_t time) const
+{
+	auto ranges = GetKnownRanges(time);
+	if(!ranges.empty() && (ranges.back().second > 0x100000000ULL) )
+	{
+		LogError("MemoryStateModel: Intel HEX can't represent addresses above 4 GB\n");
+		return false;
+	}
+
+	FILE* fp = fopen(path.c_str(), "w");
+	if(!fp)
+	{
+		LogError("MemoryStateModel: couldn't open %s for writing\n", path.c_str());
+		return false;
+	}
+
+	auto record = [&](uint16_t addr, uint8_t type, const uint8_t* data, size_t len)
+	{
+		uint8_t sum = len + (addr >> 8) + (addr & 0xff) + type;
+		fprintf(fp, ":%02zX%04X%02X", len, addr, type);
+		for(size_t i=0; i<len; i++)
+		{
+			fprintf(fp, "%02X", data[i]);
+			sum += data[i];
+		}
+		fprintf(fp, "%02X\n", static_cast<uint8_t>(-sum));
+	};
+
+	uint32_t upper = 0;
+	vector<uint8_t> data;
+	vector<bool> known;
+	for(auto& r : ranges)
+	{
+		GetContents(time, r.first, r.second - r.first, data, known);
+
+		for(uint64_t addr = r.first; addr < r.second; )
+		{
+			//Extended linear address record when we cross into a new 64 kB segment
+			if( (addr >> 16) != upper)
+			{
+				upper = addr >> 16;
+				uint8_t ext[2] = { static_cast<uint8_t>(upper >> 8), static_cast<uint8_t>(upper) };
+				record(0, 4, ext, 2);
+			}
+
+			//Up to 16 bytes per record, not crossing a segment boundary
+			uint64_t len = min(r.second - addr, static_cast<uint64_t>(16));
+			len = min(len, 0x10000 - (addr & 0xffff));
+			record(addr & 0xffff, 0, &data[addr - r.first], len);
+			addr += len;
+		}
+	}
+
+	record(0, 1, nullptr, 0);
+
+	bool ok = !ferror(fp);
+	fclose(fp);
+	return ok;
+}
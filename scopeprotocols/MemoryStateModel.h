@@ -0,0 +1,236 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of MemoryStateModel
+ */
+#ifndef MemoryStateModel_h
+#define MemoryStateModel_h
+
+#include <bitset>
+#include <functional>
+
+/**
+	@brief One page of a sparse memory image, with a flag for each byte saying whether its value is known
+ */
+class MemoryStatePage
+{
+public:
+	MemoryStatePage()
+	{ memset(m_data, 0xff, sizeof(m_data)); }
+
+	static const size_t PAGE_SIZE = 4096;
+
+	uint8_t m_data[PAGE_SIZE];
+	std::bitset<PAGE_SIZE> m_known;
+};
+
+/**
+	@brief A single operation applied to the memory
+ */
+class MemoryOperation
+{
+public:
+	MemoryOperation()
+		: m_time(0)
+		, m_type(OP_WRITE)
+		, m_address(0)
+		, m_length(0)
+		, m_wrap(0)
+		, m_dataOffset(0)
+		, m_fill(0xff)
+		, m_mismatches(0)
+		, m_conflicts(0)
+		, m_learned(0)
+	{}
+
+	enum Type
+	{
+		OP_WRITE,		//new data replaces old (RAM, EEPROM)
+		OP_PROGRAM,		//new data is ANDed with old, since programming can only clear bits (NOR flash)
+		OP_ERASE,		//range is set to the fill value
+		OP_READ			//data read back from the device, checked against (and then replacing) what we knew
+	};
+
+	///@brief Address of the Nth byte of the operation, taking wrapping into account
+	uint64_t GetAddress(uint64_t i) const
+	{
+		if(m_wrap == 0)
+			return m_address + i;
+		uint64_t base = m_address - (m_address % m_wrap);
+		return base + ( (m_address % m_wrap) + i) % m_wrap;
+	}
+
+	///@brief Time the operation took effect, in fs
+	int64_t m_time;
+
+	Type m_type;
+	uint64_t m_address;
+	uint64_t m_length;
+
+	///@brief Size of the aligned block that addresses wrap within (page write / wrapped burst), or 0 for linear
+	uint64_t m_wrap;
+
+	///@brief Position of the operation's data in the model's data pool (unused for erase)
+	size_t m_dataOffset;
+
+	///@brief Value erased bytes are set to
+	uint8_t m_fill;
+
+	///@brief Number of bytes read back which disagreed with the known contents
+	uint64_t m_mismatches;
+
+	///@brief Number of bytes programmed which needed a 0 bit set to 1 (i.e. weren't erased first)
+	uint64_t m_conflicts;
+
+	///@brief Number of bytes whose value was unknown before this read
+	uint64_t m_learned;
+};
+
+/**
+	@brief A byte read back with a different value from the one we expected
+ */
+class MemoryMismatch
+{
+public:
+	int64_t m_time;
+	uint64_t m_address;
+	uint8_t m_expected;
+	uint8_t m_actual;
+
+	///@brief Index of the read operation
+	size_t m_operation;
+};
+
+/**
+	@brief Sparse model of the contents of a memory device over time, built up from the operations seen on its bus
+
+	Bytes start out unknown and become known when they are written, erased, read, or preloaded with LoadImage().
+	Reading a byte with a value that differs from what we knew is reported as a mismatch, and the value read wins.
+
+	Every operation is kept in a log. Every so often the page table is snapshotted: snapshots share pages with each
+	other and with the live state, and a page is only copied the first time it's modified after a snapshot. The state
+	at any time T is found by replaying the operations between the last snapshot before T and T itself, so the cost
+	of a query is bounded by the snapshot interval rather than the length of the capture.
+
+	Operations must be added in order of time.
+ */
+class MemoryStateModel
+{
+public:
+	MemoryStateModel();
+
+	void Clear();
+
+	void LoadImage(uint64_t address, const std::vector<uint8_t>& data);
+
+	size_t Write(int64_t time, uint64_t address, const std::vector<uint8_t>& data, uint64_t wrap = 0);
+	size_t Program(int64_t time, uint64_t address, const std::vector<uint8_t>& data, uint64_t wrap = 0);
+	size_t Erase(int64_t time, uint64_t address, uint64_t length, uint8_t fill = 0xff);
+	size_t Read(int64_t time, uint64_t address, const std::vector<uint8_t>& data, uint64_t wrap = 0);
+
+	void GetContents(
+		int64_t time,
+		uint64_t address,
+		size_t length,
+		std::vector<uint8_t>& data,
+		std::vector<bool>& known) const;
+
+	std::vector<std::pair<uint64_t, uint64_t> > GetKnownRanges(int64_t time) const;
+
+	bool ExportBinary(const std::string& path, int64_t time, uint64_t address, uint64_t length, uint8_t fill = 0xff) const;
+	bool ExportIntelHex(const std::string& path, int64_t time) const;
+
+	///@brief All operations so far, in order
+	const std::vector<MemoryOperation>& GetOperations() const
+	{ return m_ops; }
+
+	///@brief Data written or read by an operation
+	const uint8_t* GetOperationData(const MemoryOperation& op) const
+	{ return m_opData.data() + op.m_dataOffset; }
+
+	///@brief The first MAX_MISMATCHES mismatching bytes (per-operation totals are in MemoryOperation::m_mismatches)
+	const std::vector<MemoryMismatch>& GetMismatches() const
+	{ return m_mismatches; }
+
+	size_t GetSnapshotCount() const
+	{ return m_snapshots.size(); }
+
+	///@brief Number of distinct pages allocated across the live state and all snapshots
+	size_t GetPageCount() const;
+
+	static const size_t MAX_MISMATCHES = 65536;
+
+	///@brief Snapshot after this many operations...
+	static const size_t SNAPSHOT_OPS = 1024;
+
+	///@brief ...or this many bytes of operation data, whichever comes first
+	static const size_t SNAPSHOT_BYTES = 65536;
+
+protected:
+	typedef std::map<uint64_t, std::shared_ptr<MemoryStatePage> > PageTable;
+
+	class Snapshot
+	{
+	public:
+		///@brief Index of the first operation not included in the snapshot
+		size_t m_nextOp;
+
+		PageTable m_pages;
+	};
+
+	size_t AddOperation(MemoryOperation& op, const std::vector<uint8_t>* data);
+	void Apply(MemoryOperation& op, size_t index);
+	void GetStateAt(int64_t time, PageTable& pages, uint64_t first, uint64_t last) const;
+
+	static void ForEachSegment(
+		const MemoryOperation& op,
+		uint64_t first,
+		uint64_t last,
+		const std::function<void(uint64_t address, uint64_t offset, uint64_t length)>& func);
+
+	static MemoryStatePage& GetWritablePage(PageTable& pages, uint64_t index);
+
+	///@brief Live state, after all operations so far
+	PageTable m_pages;
+
+	///@brief Page table as of LoadImage(), then periodic copies
+	std::vector<Snapshot> m_snapshots;
+
+	std::vector<MemoryOperation> m_ops;
+	std::vector<uint8_t> m_opData;
+	std::vector<MemoryMismatch> m_mismatches;
+
+	size_t m_bytesSinceSnapshot;
+};
+
+#endif
@@ -124,6 +124,7 @@ void PCIeDataLinkDecoder::Refresh()
 
 	uint8_t dllp_type = 0;
 	uint8_t dllp_data[3] = {0};
+	uint16_t stp_token = 0;
 
 	Packet* pack = NULL;
 
@@ -150,7 +151,10 @@ void PCIeDataLinkDecoder::Refresh()
 				if(sym.m_type == PCIeLogicalSymbol::TYPE_START_DLLP)
 					state = STATE_DLLP_TYPE;
 				else if(sym.m_type == PCIeLogicalSymbol::TYPE_START_TLP)
+				{
+					stp_token = sym.m_data;
 					state = STATE_TLP_SEQUENCE_HI;
+				}
 
 				break;	//end STATE_IDLE
 
@@ -499,12 +503,21 @@ void PCIeDataLinkDecoder::Refresh()
 						pack->m_data.push_back(sym.m_data);
 					}
 
-					//In gen 3/4/5 mode, high 4 bits are frame header CRC
-					//TODO: verify it (this will require pushing length up from logical layer)
+					//In gen 3/4/5 mode, high 4 bits are frame header CRC over the length field of the STP token.
+					//The logical layer passes the token up with the start symbol (if it's zero, we're being fed
+					//by a gen 1/2 logical decoder and there's nothing to check).
+					//A TLP with a bad STP token is still decoded, but isn't passed up to the transport layer.
 					else
 					{
-						cap->m_samples.push_back(PCIeDataLinkSymbol(
-							PCIeDataLinkSymbol::TYPE_TLP_SEQUENCE, sym.m_data & 0xf));
+						auto type = PCIeDataLinkSymbol::TYPE_TLP_SEQUENCE;
+						if( (stp_token != 0) && !VerifyStpToken(stp_token, sym.m_data >> 4) )
+						{
+							type = PCIeDataLinkSymbol::TYPE_TLP_FRAMING_BAD;
+							pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_ERROR];
+							pack->m_headers["Type"] = "TLP (bad STP)";
+						}
+
+						cap->m_samples.push_back(PCIeDataLinkSymbol(type, sym.m_data & 0xf));
 
 						//Sequence number is covered by the LCRC so it's considered part of the TLP data
 						//(but we need to mask off the frame CRC)
@@ -657,6 +670,43 @@ uint16_t PCIeDataLinkDecoder::CalculateDllpCRC(uint8_t type, uint8_t* data)
 	return ~( (crc << 8) | ( (crc >> 8) & 0xff) );
 }
 
+/**
+	@brief Checks the frame CRC and frame parity of a gen 3/4/5 STP token
+
+	The FCRC is a 4-bit CRC (x^4 + x + 1) over the 11-bit length field, and FP is even parity over the length and
+	FCRC. See PCIe 3.0 base spec section 4.2.2.3.2.
+
+	@param token	First two bytes of the STP token, first byte in the high half
+	@param fcrc		FCRC field from the third byte of the token
+
+	@return True if both the FCRC and parity are correct
+ */
+bool PCIeDataLinkDecoder::VerifyStpToken(uint16_t token, uint8_t fcrc)
+{
+	uint16_t len = ((token >> 12) & 0xf) | ((token & 0x7f) << 4);
+	bool fp = (token >> 7) & 1;
+
+	bool l[11];
+	for(int i=0; i<11; i++)
+		l[i] = (len >> i) & 1;
+
+	uint8_t expected =
+		( (l[10] ^ l[7] ^ l[6] ^ l[4] ^ l[2] ^ l[1] ^ l[0]) << 0) |
+		( (l[10] ^ l[9] ^ l[7] ^ l[5] ^ l[4] ^ l[3] ^ l[2]) << 1) |
+		( (l[9] ^ l[8] ^ l[6] ^ l[4] ^ l[3] ^ l[2] ^ l[1]) << 2) |
+		( (l[8] ^ l[7] ^ l[5] ^ l[3] ^ l[2] ^ l[1] ^ l[0]) << 3);
+	if(fcrc != expected)
+		return false;
+
+	//Parity over length, FCRC and FP itself must be even
+	bool parity = fp;
+	for(int i=0; i<11; i++)
+		parity ^= l[i];
+	for(int i=0; i<4; i++)
+		parity ^= (fcrc >> i) & 1;
+	return !parity;
+}
+
 /**
 	@brief PCIe TLP CRC32
 
@@ -747,6 +797,10 @@ string PCIeDataLinkWaveform::GetText(size_t i)
 			snprintf(tmp, sizeof(tmp), "Seq: %d", s.m_data);
 			return tmp;
 
+		case PCIeDataLinkSymbol::TYPE_TLP_FRAMING_BAD:
+			snprintf(tmp, sizeof(tmp), "Bad STP, seq: %d", s.m_data);
+			return tmp;
+
 		case PCIeDataLinkSymbol::TYPE_DLLP_DATA:
 		case PCIeDataLinkSymbol::TYPE_TLP_DATA:
 			snprintf(tmp, sizeof(tmp), "%02x", s.m_data);
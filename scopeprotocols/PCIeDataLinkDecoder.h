@@ -59,6 +59,7 @@ public:
 		TYPE_TLP_CRC_OK,
 		TYPE_TLP_CRC_BAD,
 		TYPE_TLP_DATA,
+		TYPE_TLP_FRAMING_BAD,	//gen3 STP token failed frame CRC or parity check (data is sequence number)
 
 		TYPE_ERROR
 	} m_type;
@@ -138,6 +139,7 @@ public:
 protected:
 	uint16_t CalculateDllpCRC(uint8_t type, uint8_t* data);
 	uint32_t CalculateTlpCRC(Packet* pack);
+	static bool VerifyStpToken(uint16_t token, uint8_t fcrc);
 
 	std::string m_framingMode;
 };
@@ -544,7 +544,10 @@ string PCIeLogicalWaveform::GetText(size_t i)
 			return "Exit Electrical Idle";
 
 		case PCIeLogicalSymbol::TYPE_START_TLP:
-			return "TLP";
+			if(s.m_data == 0)
+				return "TLP";
+			snprintf(tmp, sizeof(tmp), "TLP (%d DW)", ((s.m_data >> 12) & 0xf) | ((s.m_data & 0x7f) << 4));
+			return tmp;
 
 		case PCIeLogicalSymbol::TYPE_START_DLLP:
 			return "DLLP";
@@ -59,12 +59,19 @@ public:
 		TYPE_PAD
 	} m_type;
 
-	uint8_t m_data;
+	/**
+		@brief Symbol payload
+
+		For TYPE_PAYLOAD_DATA this is a single byte. For TYPE_START_TLP in gen 3/4/5 mode it is the first two bytes
+		of the STP token (first byte in the high half), which carry the TLP length and frame parity and are needed by
+		the data link layer to check the frame CRC. It is zero for gen 1/2 TLPs, since they have no length field.
+	 */
+	uint16_t m_data;
 
 	PCIeLogicalSymbol()
 	{}
 
-	PCIeLogicalSymbol(SymbolType type, uint8_t data = 0)
+	PCIeLogicalSymbol(SymbolType type, uint16_t data = 0)
 		: m_type(type)
 		, m_data(data)
 	{}
@@ -304,7 +304,7 @@ void PCIeGen3LogicalDecoder::Refresh()
 										cap->m_offsets.push_back(off);
 										cap->m_durations.push_back(dur);
 										cap->m_samples.push_back(PCIeLogicalSymbol(
-											PCIeLogicalSymbol::TYPE_START_TLP));
+											PCIeLogicalSymbol::TYPE_START_TLP, sym.m_data[k]));
 									}
 
 									else
@@ -345,11 +345,29 @@ void PCIeGen3LogicalDecoder::Refresh()
 							////////////////////////////////////////////////////////////////////////////////////////////////
 							// STP token path
 
+							//Second word of an EDS token, or of an STP token for a TLP whose length is 1 mod 16.
+							//Both start with 1F, but an EDS continues with 80 which would be an impossibly short TLP.
+							case PACKET_STATE_EDS_1:
+								if(sym.m_data[k] == 0x80)
+								{
+									cap->m_durations[len-1] = end - cap->m_offsets[len-1];
+									packet_state = PACKET_STATE_EDS_2;
+									break;
+								}
+
+								cap->m_samples[len-1] = PCIeLogicalSymbol(PCIeLogicalSymbol::TYPE_START_TLP, 0x1f);
+								count = 0;
+								packet_len = 1;
+
+								//fall through
+
 							//Second half of TLP length
 							case PACKET_STATE_STP_1:
 
-								//Extend previous symbol
+								//Extend previous symbol and save the whole token, so the data link layer can check
+								//the frame parity and frame CRC (which is in the next byte, along with the sequence number)
 								cap->m_durations[len-1] = end - cap->m_offsets[len-1];
+								cap->m_samples[len-1].m_data = (cap->m_samples[len-1].m_data << 8) | sym.m_data[k];
 								packet_len |= ((sym.m_data[k] & 0x7f) << 4);
 
 								//packet length in header is dwords, convert to bytes
@@ -358,7 +376,6 @@ void PCIeGen3LogicalDecoder::Refresh()
 								//sequence number doesn't count
 								packet_len -= 2;
 
-								//TODO: check frame parity bit
 								packet_state = PACKET_STATE_TLP_DATA;
 								break;
 
@@ -396,19 +413,6 @@ void PCIeGen3LogicalDecoder::Refresh()
 							////////////////////////////////////////////////////////////////////////////////////////////////
 							// EDS token path
 
-							//Expect second word of EDS token
-							case PACKET_STATE_EDS_1:
-								if(sym.m_data[k] == 0x80)
-								{
-									cap->m_durations[len-1] = end - cap->m_offsets[len-1];
-									packet_state = PACKET_STATE_EDS_2;
-								}
-
-								//Malformed SDP token
-								else
-									error = true;
-								break;
-
 							//Expect third word of EDS token
 							case PACKET_STATE_EDS_2:
 								if(sym.m_data[k] == 0x90)
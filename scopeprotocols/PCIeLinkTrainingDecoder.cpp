@@ -477,7 +477,7 @@ void PCIeLinkTrainingDecoder::Refresh()
 bool PCIeLinkTrainingDecoder::CanMerge(Packet* first, Packet* /*cur*/, Packet* next)
 {
 	//If all headers are the same, it's mergeable
-	if(first->m_headers == next->m_headers)
+	if( (first->m_headers == next->m_headers) && (first->m_typedHeaders == next->m_typedHeaders) )
 		return true;
 
 	return false;
@@ -490,6 +490,7 @@ Packet* PCIeLinkTrainingDecoder::CreateMergedHeader(Packet* pack, size_t i)
 	ret->m_offset = pack->m_offset;
 	ret->m_len = pack->m_len;
 	ret->m_headers = pack->m_headers;
+	ret->m_typedHeaders = pack->m_typedHeaders;
 	ret->m_displayBackgroundColor = pack->m_displayBackgroundColor;
 
 	//Extend length
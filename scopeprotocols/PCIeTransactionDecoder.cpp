@@ -0,0 +1,321 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of PCIeTransactionDecoder
+ */
+
+#include "../scopehal/scopehal.h"
+#include "PCIeTransactionDecoder.h"
+
+#include <cinttypes>
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+PCIeTransactionDecoder::PCIeTransactionDecoder(const string& color)
+	: PacketDecoder(color, CAT_BUS)
+{
+	AddStream(Unit(Unit::UNIT_FS), "latency", Stream::STREAM_TYPE_ANALOG);
+	AddStream(Unit(Unit::UNIT_COUNTS), "outstanding", Stream::STREAM_TYPE_ANALOG);
+
+	CreateInput("downstream");
+	CreateInput("upstream");
+}
+
+PCIeTransactionDecoder::~PCIeTransactionDecoder()
+{
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Factory methods
+
+bool PCIeTransactionDecoder::ValidateChannel(size_t i, StreamDescriptor stream)
+{
+	if(stream.m_channel == NULL)
+		return false;
+
+	if( (i < 2) && (dynamic_cast<PCIeTransportWaveform*>(stream.m_channel->GetData(0)) != NULL) )
+		return true;
+
+	return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Accessors
+
+string PCIeTransactionDecoder::GetProtocolName()
+{
+	return "PCIe Transactions";
+}
+
+vector<string> PCIeTransactionDecoder::GetHeaders()
+{
+	vector<string> ret;
+	ret.push_back("Direction");
+	ret.push_back("Type");
+	ret.push_back("Requester");
+	ret.push_back("Tag");
+	ret.push_back("Completer");
+	ret.push_back("Addr");
+	ret.push_back("Length");
+	ret.push_back("Completions");
+	ret.push_back("Status");
+	ret.push_back("Latency");
+	ret.push_back("Duration");
+	return ret;
+}
+
+bool PCIeTransactionDecoder::GetShowDataColumn()
+{
+	return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Actual decoder logic
+
+void PCIeTransactionDecoder::Refresh()
+{
+	ClearPackets();
+	m_tracker.Clear();
+
+	if(!VerifyAllInputsOK())
+	{
+		for(size_t i=0; i<3; i++)
+			SetData(nullptr, i);
+		return;
+	}
+
+	PCIeTransportWaveform* inputs[2] =
+	{
+		dynamic_cast<PCIeTransportWaveform*>(GetInputWaveform(0)),
+		dynamic_cast<PCIeTransportWaveform*>(GetInputWaveform(1))
+	};
+
+	//Merge everything that happened on both directions of the link, in time order, and run it through the tracker
+	vector<PCIeLinkEvent> events;
+	int64_t tend = 0;
+	for(size_t i=0; i<2; i++)
+	{
+		auto in = inputs[i];
+		in->PrepareForCpuAccess();
+		PCIeTransactionTracker::GetEvents(in, i, events);
+
+		size_t len = in->m_samples.size();
+		if(len)
+			tend = max(tend, (in->m_offsets[len-1] + in->m_durations[len-1]) * in->m_timescale + in->m_triggerPhase);
+	}
+	stable_sort(events.begin(), events.end());
+	for(auto& e : events)
+		m_tracker.AddEvent(e);
+	m_tracker.Flush(tend);
+
+	//Create the outputs. Call SetData() early on so we can use GetText() in the packet decode
+	auto din = inputs[0];
+	auto cap = new PCIeTransactionWaveform;
+	cap->m_timescale = 1;
+	cap->m_startTimestamp = din->m_startTimestamp;
+	cap->m_startFemtoseconds = din->m_startFemtoseconds;
+	cap->m_triggerPhase = 0;
+	cap->PrepareForCpuAccess();
+	SetData(cap, 0);
+
+	auto latency = SetupEmptySparseAnalogOutputWaveform(din, 1);
+	latency->m_timescale = 1;
+	latency->m_triggerPhase = 0;
+	latency->PrepareForCpuAccess();
+
+	auto outstanding = SetupEmptySparseAnalogOutputWaveform(din, 2);
+	outstanding->m_timescale = 1;
+	outstanding->m_triggerPhase = 0;
+	outstanding->PrepareForCpuAccess();
+
+	Unit fs(Unit::UNIT_FS);
+	auto& transactions = m_tracker.GetTransactions();
+	for(size_t i=0; i<transactions.size(); i++)
+	{
+		auto& t = transactions[i];
+		int64_t start = t.m_request.m_start;
+		int64_t end = t.m_completions ? t.m_completionEnd : t.m_request.m_end;
+
+		//Transactions overlap in time, but symbols can't, so cut each one short at the start of the next.
+		//(If requests start at the same instant in both directions, the first symbol ends up zero length.)
+		int64_t symend = end;
+		if(i+1 < transactions.size())
+			symend = min(symend, transactions[i+1].m_request.m_start);
+		cap->m_offsets.push_back(start);
+		cap->m_durations.push_back(symend - start);
+		cap->m_samples.push_back(PCIeTransactionSymbol(t));
+
+		auto pack = new Packet;
+		pack->m_offset = start;
+		pack->m_len = end - start;
+		m_packets.push_back(pack);
+
+		pack->m_headers["Direction"] = GetInputName(t.m_direction);
+		pack->m_headers["Type"] = PCIeTransportDecoder::GetTypeName(t.m_request.m_type);
+		pack->m_headers["Requester"] = PCIeTransportDecoder::FormatID(t.m_request.m_requester);
+		pack->m_headers["Tag"] = to_string(t.m_request.m_tag);
+		if(t.m_completions)
+			pack->m_headers["Completer"] = PCIeTransportDecoder::FormatID(t.m_completer);
+
+		char tmp[32];
+		snprintf(tmp, sizeof(tmp), "%" PRIx64, t.m_request.m_address);
+		pack->m_headers["Addr"] = tmp;
+		pack->m_headers["Length"] = to_string(t.m_request.m_length * 4);
+		pack->m_headers["Completions"] = to_string(t.m_completions);
+
+		switch(t.m_request.m_type)
+		{
+			case PCIeTransportSymbol::TYPE_MEM_RD:
+			case PCIeTransportSymbol::TYPE_MEM_RD_LK:
+			case PCIeTransportSymbol::TYPE_IO_RD:
+			case PCIeTransportSymbol::TYPE_CFG_RD_0:
+			case PCIeTransportSymbol::TYPE_CFG_RD_1:
+				pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_DATA_READ];
+				break;
+
+			default:
+				pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_DATA_WRITE];
+				break;
+		}
+
+		switch(t.m_state)
+		{
+			case PCIeTransaction::STATE_COMPLETE:
+				pack->m_headers["Status"] = "SC";
+				break;
+
+			case PCIeTransaction::STATE_FAILED:
+				pack->m_headers["Status"] = cap->GetText(i);
+				pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_ERROR];
+				break;
+
+			case PCIeTransaction::STATE_TAG_REUSED:
+				pack->m_headers["Status"] = "Tag reused";
+				pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_ERROR];
+				break;
+
+			default:
+				pack->m_headers["Status"] = "No completion";
+				pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_ERROR];
+				break;
+		}
+
+		if(t.m_completions)
+		{
+			pack->m_headers["Latency"] = fs.PrettyPrint(t.GetLatency());
+			pack->m_headers["Duration"] = fs.PrettyPrint(t.GetDuration());
+		}
+
+		//Latency trend, one sample per successful transaction
+		if(t.m_state == PCIeTransaction::STATE_COMPLETE)
+		{
+			size_t n = latency->m_offsets.size();
+			if(n)
+				latency->m_durations[n-1] = start - latency->m_offsets[n-1];
+			latency->m_offsets.push_back(start);
+			latency->m_durations.push_back(1);
+			latency->m_samples.push_back(t.GetLatency());
+		}
+	}
+
+	//Outstanding request count, one sample per change
+	auto& history = m_tracker.GetOccupancyHistory();
+	for(size_t i=0; i<history.size(); i++)
+	{
+		int64_t next = (i+1 < history.size()) ? history[i+1].first : tend;
+		outstanding->m_offsets.push_back(history[i].first);
+		outstanding->m_durations.push_back(max(next - history[i].first, (int64_t)1));
+		outstanding->m_samples.push_back(history[i].second);
+	}
+
+	cap->MarkModifiedFromCpu();
+	latency->MarkModifiedFromCpu();
+	outstanding->MarkModifiedFromCpu();
+}
+
+std::string PCIeTransactionWaveform::GetColor(size_t i)
+{
+	auto& s = m_samples[i];
+
+	switch(s.m_state)
+	{
+		case PCIeTransaction::STATE_COMPLETE:
+			return StandardColors::colors[StandardColors::COLOR_DATA];
+
+		case PCIeTransaction::STATE_PENDING:
+		case PCIeTransaction::STATE_TIMED_OUT:
+		case PCIeTransaction::STATE_FAILED:
+		case PCIeTransaction::STATE_TAG_REUSED:
+		default:
+			return StandardColors::colors[StandardColors::COLOR_ERROR];
+	}
+}
+
+string PCIeTransactionWaveform::GetText(size_t i)
+{
+	auto& s = m_samples[i];
+
+	string ret = PCIeTransportDecoder::GetTypeName(s.m_type) + " " + PCIeTransportDecoder::FormatID(s.m_requester) +
+		" tag " + to_string(s.m_tag) + ": ";
+
+	switch(s.m_state)
+	{
+		case PCIeTransaction::STATE_COMPLETE:
+			return ret + Unit(Unit::UNIT_FS).PrettyPrint(s.m_latency);
+
+		case PCIeTransaction::STATE_FAILED:
+			switch(s.m_status)
+			{
+				case 1:
+					return ret + "UR";
+				case 2:
+					return ret + "CRS";
+				case 4:
+					return ret + "CA";
+				default:
+					return ret + "Invalid status";
+			}
+
+		case PCIeTransaction::STATE_TAG_REUSED:
+			return ret + "tag reused";
+
+		case PCIeTransaction::STATE_PENDING:
+		case PCIeTransaction::STATE_TIMED_OUT:
+		default:
+			return ret + "no completion";
+	}
+}
@@ -0,0 +1,113 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of PCIeTransactionDecoder
+ */
+#ifndef PCIeTransactionDecoder_h
+#define PCIeTransactionDecoder_h
+
+#include "../scopehal/PacketDecoder.h"
+#include "PCIeTransactionTracker.h"
+
+class PCIeTransactionSymbol
+{
+public:
+	PCIeTransactionSymbol()
+	{}
+
+	PCIeTransactionSymbol(const PCIeTransaction& t)
+		: m_type(t.m_request.m_type)
+		, m_requester(t.m_request.m_requester)
+		, m_tag(t.m_request.m_tag)
+		, m_status(t.m_status)
+		, m_state(t.m_state)
+		, m_latency(t.GetLatency())
+	{}
+
+	PCIeTransportSymbol::TlpType m_type;
+	uint16_t m_requester;
+	uint8_t m_tag;
+	uint8_t m_status;
+	PCIeTransaction::State m_state;
+
+	///@brief Request to first completion, in fs
+	int64_t m_latency;
+
+	bool operator==(const PCIeTransactionSymbol& s) const
+	{
+		return (m_type == s.m_type) && (m_requester == s.m_requester) && (m_tag == s.m_tag) &&
+			(m_status == s.m_status) && (m_state == s.m_state) && (m_latency == s.m_latency);
+	}
+};
+
+class PCIeTransactionWaveform : public SparseWaveform<PCIeTransactionSymbol>
+{
+public:
+	PCIeTransactionWaveform () : SparseWaveform<PCIeTransactionSymbol>() {};
+	virtual std::string GetText(size_t) override;
+	virtual std::string GetColor(size_t) override;
+};
+
+/**
+	@brief Matches PCIe requests to completions across both directions of a link
+
+	Outputs one symbol and packet per non-posted transaction, plus the latency of each transaction and the number of
+	requests outstanding over time as analog streams (feed the latency stream to a histogram filter for a latency
+	distribution). Flow control credit usage and other statistics are available from GetTracker().
+ */
+class PCIeTransactionDecoder : public PacketDecoder
+{
+public:
+	PCIeTransactionDecoder(const std::string& color);
+	virtual ~PCIeTransactionDecoder();
+
+	virtual void Refresh() override;
+
+	static std::string GetProtocolName();
+
+	virtual bool ValidateChannel(size_t i, StreamDescriptor stream) override;
+
+	virtual std::vector<std::string> GetHeaders() override;
+	virtual bool GetShowDataColumn() override;
+
+	///@brief Transactions and link statistics from the last refresh
+	const PCIeTransactionTracker& GetTracker() const
+	{ return m_tracker; }
+
+	PROTOCOL_DECODER_INITPROC(PCIeTransactionDecoder)
+
+protected:
+	PCIeTransactionTracker m_tracker;
+};
+
+#endif
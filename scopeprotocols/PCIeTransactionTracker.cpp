@@ -0,0 +1,578 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of PCIeTransactionTracker
+ */
+
+#include "../scopehal/scopehal.h"
+#include "PCIeDataLinkDecoder.h"
+#include "PCIeTransactionTracker.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// PCIeTLPInfo
+
+/**
+	@brief Checks if this TLP is a request which expects a completion
+ */
+bool PCIeTLPInfo::IsNonPosted() const
+{
+	switch(m_type)
+	{
+		case PCIeTransportSymbol::TYPE_MEM_RD:
+		case PCIeTransportSymbol::TYPE_MEM_RD_LK:
+		case PCIeTransportSymbol::TYPE_IO_RD:
+		case PCIeTransportSymbol::TYPE_IO_WR:
+		case PCIeTransportSymbol::TYPE_CFG_RD_0:
+		case PCIeTransportSymbol::TYPE_CFG_WR_0:
+		case PCIeTransportSymbol::TYPE_CFG_RD_1:
+		case PCIeTransportSymbol::TYPE_CFG_WR_1:
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+bool PCIeTLPInfo::IsCompletion() const
+{
+	switch(m_type)
+	{
+		case PCIeTransportSymbol::TYPE_COMPLETION:
+		case PCIeTransportSymbol::TYPE_COMPLETION_DATA:
+		case PCIeTransportSymbol::TYPE_COMPLETION_LOCKED_ERROR:
+		case PCIeTransportSymbol::TYPE_COMPLETION_LOCKED_DATA:
+			return true;
+
+		default:
+			return false;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// PCIeCreditCounter
+
+/**
+	@brief Sets the initial credit allocation from an InitFC DLLP
+
+	@param credits	Number of credits advertised, or zero for infinite
+	@param initfc	True if this came from link initialization, false if it's an UpdateFC used as a starting point
+ */
+void PCIeCreditCounter::Initialize(uint16_t credits, bool initfc)
+{
+	m_valid = true;
+	m_infinite = initfc && (credits == 0);
+	m_advertised = initfc ? credits : 0;
+	m_limit = credits;
+	m_released = 0;
+	m_consumed = 0;
+	m_minInUse = 0;
+	m_maxInUse = 0;
+}
+
+/**
+	@brief Processes a new credit limit from an UpdateFC DLLP
+
+	@param limit	The new limit
+	@param mask		Mask for the width of the limit field (8 bits for headers, 12 for data)
+ */
+void PCIeCreditCounter::Update(uint16_t limit, uint16_t mask)
+{
+	if(!m_valid)
+	{
+		Initialize(limit, false);
+		return;
+	}
+	if(m_infinite)
+		return;
+
+	m_released += (limit - m_limit) & mask;
+	m_limit = limit;
+	m_minInUse = min(m_minInUse, GetInUse());
+}
+
+/**
+	@brief Records credits used by a TLP
+
+	@return False if the TLP was sent without enough credits available
+ */
+bool PCIeCreditCounter::Consume(uint64_t credits)
+{
+	if(!m_valid || m_infinite || (credits == 0) )
+		return true;
+
+	m_consumed += credits;
+	auto inuse = GetInUse();
+	m_maxInUse = max(m_maxInUse, inuse);
+
+	if( (m_advertised != 0) && (inuse > m_advertised) )
+	{
+		m_overruns ++;
+		return false;
+	}
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// PCIeFlowControlState
+
+/**
+	@brief Figures out which kind of credits a TLP consumes
+ */
+PCIeFlowControlState::CreditClass PCIeFlowControlState::GetClass(PCIeTransportSymbol::TlpType type)
+{
+	switch(type)
+	{
+		case PCIeTransportSymbol::TYPE_MEM_WR:
+		case PCIeTransportSymbol::TYPE_MSG:
+		case PCIeTransportSymbol::TYPE_MSG_DATA:
+			return CLASS_POSTED;
+
+		case PCIeTransportSymbol::TYPE_COMPLETION:
+		case PCIeTransportSymbol::TYPE_COMPLETION_DATA:
+		case PCIeTransportSymbol::TYPE_COMPLETION_LOCKED_ERROR:
+		case PCIeTransportSymbol::TYPE_COMPLETION_LOCKED_DATA:
+			return CLASS_COMPLETION;
+
+		default:
+			return CLASS_NON_POSTED;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// PCIeLinkStatistics
+
+double PCIeLinkStatistics::GetMeanOutstanding() const
+{
+	double weighted = 0;
+	double total = 0;
+	for(size_t i=0; i<m_occupancyTime.size(); i++)
+	{
+		weighted += static_cast<double>(i) * m_occupancyTime[i];
+		total += m_occupancyTime[i];
+	}
+
+	if(total == 0)
+		return 0;
+	return weighted / total;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+PCIeTransactionTracker::PCIeTransactionTracker()
+	: m_started(false)
+{
+}
+
+/**
+	@brief Resets all state, ready to process a new capture
+ */
+void PCIeTransactionTracker::Clear()
+{
+	m_transactions.clear();
+	m_pending.clear();
+	m_latencyHistograms.clear();
+	m_occupancyHistory.clear();
+	for(auto& s : m_stats)
+		s = PCIeLinkStatistics();
+	m_started = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Input processing
+
+/**
+	@brief Pulls all of the TLPs and flow control updates out of one direction of a link
+
+	@param wfm			Transport layer waveform
+	@param direction	Index of the link direction the waveform came from
+	@param events		Events are appended here, in order
+ */
+void PCIeTransactionTracker::GetEvents(PCIeTransportWaveform* wfm, size_t direction, vector<PCIeLinkEvent>& events)
+{
+	PCIeLinkEvent ev;
+	ev.m_direction = direction;
+	bool intlp = false;
+
+	size_t len = wfm->m_samples.size();
+	for(size_t i=0; i<len; i++)
+	{
+		auto& s = wfm->m_samples[i];
+		int64_t start = wfm->m_offsets[i] * wfm->m_timescale + wfm->m_triggerPhase;
+		int64_t end = start + wfm->m_durations[i] * wfm->m_timescale;
+
+		switch(s.m_type)
+		{
+			//Start of a new TLP
+			case PCIeTransportSymbol::TYPE_TLP_TYPE:
+				if(intlp)
+					events.push_back(ev);
+
+				ev.m_isTLP = true;
+				ev.m_timestamp = start;
+				ev.m_tlp = PCIeTLPInfo();
+				ev.m_tlp.m_start = start;
+				ev.m_tlp.m_type = static_cast<PCIeTransportSymbol::TlpType>(s.m_data);
+				if(ev.m_tlp.m_type == PCIeTransportSymbol::TYPE_INVALID)
+					ev.m_tlp.m_error = true;
+				intlp = true;
+				break;
+
+			//Flow control updates take effect once the DLLP has been received
+			case PCIeTransportSymbol::TYPE_FLOW_CONTROL:
+				if(intlp)
+					events.push_back(ev);
+				intlp = false;
+
+				{
+					PCIeLinkEvent fc;
+					fc.m_direction = direction;
+					fc.m_timestamp = end;
+					fc.m_isTLP = false;
+					fc.m_flowControl = s;
+					events.push_back(fc);
+				}
+				continue;
+
+			case PCIeTransportSymbol::TYPE_FLAGS:
+				ev.m_tlp.m_poisoned = (s.m_data & PCIeTransportSymbol::FLAG_POISONED) != 0;
+				break;
+
+			case PCIeTransportSymbol::TYPE_LENGTH:
+				ev.m_tlp.m_length = s.m_data;
+				break;
+
+			case PCIeTransportSymbol::TYPE_LENGTH_BAD:
+				ev.m_tlp.m_length = s.m_data & 0xffffffff;
+				ev.m_tlp.m_error = true;
+				break;
+
+			case PCIeTransportSymbol::TYPE_REQUESTER_ID:
+				ev.m_tlp.m_requester = s.m_data;
+				break;
+
+			case PCIeTransportSymbol::TYPE_COMPLETER_ID:
+				ev.m_tlp.m_completer = s.m_data;
+				break;
+
+			case PCIeTransportSymbol::TYPE_TAG:
+				ev.m_tlp.m_tag = s.m_data;
+				break;
+
+			case PCIeTransportSymbol::TYPE_COMPLETION_STATUS:
+				ev.m_tlp.m_status = s.m_data;
+				break;
+
+			case PCIeTransportSymbol::TYPE_BYTE_COUNT:
+				ev.m_tlp.m_byteCount = s.m_data;
+				break;
+
+			case PCIeTransportSymbol::TYPE_ADDRESS_X32:
+			case PCIeTransportSymbol::TYPE_ADDRESS_X64:
+				ev.m_tlp.m_address = s.m_data;
+				break;
+
+			case PCIeTransportSymbol::TYPE_DATA:
+				ev.m_tlp.m_payloadBytes ++;
+				break;
+
+			case PCIeTransportSymbol::TYPE_ECRC_BAD:
+			case PCIeTransportSymbol::TYPE_ERROR:
+				ev.m_tlp.m_error = true;
+				break;
+
+			default:
+				break;
+		}
+
+		if(intlp)
+			ev.m_tlp.m_end = end;
+	}
+
+	if(intlp)
+		events.push_back(ev);
+}
+
+/**
+	@brief Processes one event. Events from both directions must be added in timestamp order.
+ */
+void PCIeTransactionTracker::AddEvent(const PCIeLinkEvent& event)
+{
+	if(!m_started)
+	{
+		for(auto& s : m_stats)
+			s.m_lastChange = event.m_timestamp;
+		m_started = true;
+	}
+
+	if(event.m_isTLP)
+		AddTLP(event.m_direction, event.m_tlp);
+	else
+		AddFlowControl(event.m_direction, event.m_flowControl);
+}
+
+/**
+	@brief Processes a flow control DLLP
+
+	Credits advertised by DLLPs in one direction govern the TLPs sent in the other.
+ */
+void PCIeTransactionTracker::AddFlowControl(size_t direction, const PCIeTransportSymbol& fc)
+{
+	//Only VC0 is tracked
+	if(fc.GetFlowControlVC() != 0)
+		return;
+
+	auto& credits = m_stats[1 - direction].m_credits;
+
+	PCIeFlowControlState::CreditClass cls;
+	bool init = false;
+	switch(fc.GetFlowControlType())
+	{
+		case PCIeDataLinkSymbol::DLLP_TYPE_INITFC1_P:
+		case PCIeDataLinkSymbol::DLLP_TYPE_INITFC2_P:
+			init = true;
+			//fall through
+		case PCIeDataLinkSymbol::DLLP_TYPE_UPDATEFC_P:
+			cls = PCIeFlowControlState::CLASS_POSTED;
+			break;
+
+		case PCIeDataLinkSymbol::DLLP_TYPE_INITFC1_NP:
+		case PCIeDataLinkSymbol::DLLP_TYPE_INITFC2_NP:
+			init = true;
+			//fall through
+		case PCIeDataLinkSymbol::DLLP_TYPE_UPDATEFC_NP:
+			cls = PCIeFlowControlState::CLASS_NON_POSTED;
+			break;
+
+		case PCIeDataLinkSymbol::DLLP_TYPE_INITFC1_CPL:
+		case PCIeDataLinkSymbol::DLLP_TYPE_INITFC2_CPL:
+			init = true;
+			//fall through
+		case PCIeDataLinkSymbol::DLLP_TYPE_UPDATEFC_CPL:
+			cls = PCIeFlowControlState::CLASS_COMPLETION;
+			break;
+
+		default:
+			return;
+	}
+
+	auto& hdr = credits.m_header[cls];
+	auto& data = credits.m_data[cls];
+
+	//InitFC is repeated during link initialization, so only the first one of a sequence counts
+	if(init)
+	{
+		if( (hdr.m_advertised == 0) && !hdr.m_infinite)
+			hdr.Initialize(fc.GetFlowControlHeaderCredits(), true);
+		if( (data.m_advertised == 0) && !data.m_infinite)
+			data.Initialize(fc.GetFlowControlDataCredits(), true);
+	}
+	else
+	{
+		hdr.Update(fc.GetFlowControlHeaderCredits(), 0xff);
+		data.Update(fc.GetFlowControlDataCredits(), 0xfff);
+	}
+}
+
+/**
+	@brief Charges a TLP against the credits of the link direction it was sent on
+ */
+void PCIeTransactionTracker::ConsumeCredits(size_t direction, const PCIeTLPInfo& tlp)
+{
+	auto& credits = m_stats[direction].m_credits;
+	auto cls = PCIeFlowControlState::GetClass(tlp.m_type);
+
+	//One header credit per TLP, one data credit per 4 dwords of payload
+	credits.m_header[cls].Consume(1);
+	credits.m_data[cls].Consume( (tlp.m_payloadBytes + 15) / 16);
+}
+
+/**
+	@brief Processes a single TLP
+ */
+void PCIeTransactionTracker::AddTLP(size_t direction, const PCIeTLPInfo& tlp)
+{
+	auto& stats = m_stats[direction];
+	stats.m_tlps ++;
+
+	//The receiver would drop a malformed TLP, so it can't start or finish a transaction
+	if(tlp.m_error)
+	{
+		stats.m_badTlps ++;
+		return;
+	}
+
+	ConsumeCredits(direction, tlp);
+
+	if(tlp.IsNonPosted())
+	{
+		stats.m_requests ++;
+
+		auto key = GetKey(direction, tlp.m_requester, tlp.m_tag);
+		auto it = m_pending.find(key);
+		if(it != m_pending.end())
+		{
+			//Same request sent again (e.g. replayed by the data link layer)? Ignore it
+			auto& old = m_transactions[it->second].m_request;
+			if( (old.m_type == tlp.m_type) && (old.m_address == tlp.m_address) && (old.m_length == tlp.m_length) )
+			{
+				stats.m_duplicateRequests ++;
+				return;
+			}
+
+			//Nope, the requester reused a tag that was still in use
+			Retire(it->second, PCIeTransaction::STATE_TAG_REUSED, tlp.m_start);
+		}
+
+		PCIeTransaction t;
+		t.m_direction = direction;
+		t.m_request = tlp;
+		m_pending[key] = m_transactions.size();
+		m_transactions.push_back(t);
+
+		SetOutstanding(direction, stats.m_outstanding + 1, tlp.m_start);
+	}
+
+	else if(tlp.IsCompletion())
+	{
+		//Completions go back the opposite way to the request
+		auto it = m_pending.find(GetKey(1 - direction, tlp.m_requester, tlp.m_tag));
+		if(it == m_pending.end())
+		{
+			stats.m_unexpectedCompletions ++;
+			return;
+		}
+
+		auto& t = m_transactions[it->second];
+		if(t.m_completions == 0)
+		{
+			t.m_completionStart = tlp.m_start;
+			t.m_completer = tlp.m_completer;
+		}
+		t.m_completions ++;
+		t.m_completionEnd = tlp.m_end;
+		t.m_status = tlp.m_status;
+
+		//Unsuccessful completions terminate the request.
+		//Retire at the start of the completion, since events are processed in order of start time.
+		if(tlp.m_status != 0)
+			Retire(it->second, PCIeTransaction::STATE_FAILED, tlp.m_start);
+
+		//So do completions without data (for writes)
+		else if(tlp.m_payloadBytes == 0)
+			Retire(it->second, PCIeTransaction::STATE_COMPLETE, tlp.m_start);
+
+		//Byte count is what's left to send including this completion (0 means 4096).
+		//The payload starts at the dword containing the lower address, so skip any bytes before it.
+		else
+		{
+			uint32_t remaining = tlp.m_byteCount ? tlp.m_byteCount : 4096;
+			uint32_t skip = tlp.m_address & 3;
+			uint32_t valid = (tlp.m_payloadBytes > skip) ? (tlp.m_payloadBytes - skip) : 0;
+
+			t.m_completedBytes += min(remaining, valid);
+			if(remaining <= valid)
+				Retire(it->second, PCIeTransaction::STATE_COMPLETE, tlp.m_start);
+		}
+	}
+}
+
+/**
+	@brief Marks an outstanding transaction as done and updates statistics
+ */
+void PCIeTransactionTracker::Retire(size_t index, PCIeTransaction::State state, int64_t timestamp)
+{
+	auto& t = m_transactions[index];
+	t.m_state = state;
+
+	m_pending.erase(GetKey(t.m_direction, t.m_request.m_requester, t.m_request.m_tag));
+	SetOutstanding(t.m_direction, m_stats[t.m_direction].m_outstanding - 1, timestamp);
+
+	if(state == PCIeTransaction::STATE_COMPLETE)
+	{
+		int64_t ns = t.GetLatency() / 1000000;
+		size_t bin = 0;
+		while( (bin < 63) && (ns >> (bin+1)) )
+			bin ++;
+
+		auto& hist = m_latencyHistograms[t.m_request.m_type];
+		if(hist.size() <= bin)
+			hist.resize(bin+1, 0);
+		hist[bin] ++;
+	}
+}
+
+/**
+	@brief Changes the number of requests outstanding in one direction, and updates occupancy statistics
+ */
+void PCIeTransactionTracker::SetOutstanding(size_t direction, size_t count, int64_t timestamp)
+{
+	auto& stats = m_stats[direction];
+
+	if(stats.m_occupancyTime.size() <= stats.m_outstanding)
+		stats.m_occupancyTime.resize(stats.m_outstanding + 1, 0);
+	stats.m_occupancyTime[stats.m_outstanding] += timestamp - stats.m_lastChange;
+	stats.m_lastChange = timestamp;
+
+	stats.m_outstanding = count;
+	stats.m_maxOutstanding = max(stats.m_maxOutstanding, count);
+
+	m_occupancyHistory.push_back(pair<int64_t, size_t>(timestamp, m_stats[0].m_outstanding + m_stats[1].m_outstanding));
+}
+
+/**
+	@brief Finishes processing at the end of a capture
+
+	Any request still waiting for a completion is marked as timed out.
+
+	@param timestamp	End of the capture, in fs
+ */
+void PCIeTransactionTracker::Flush(int64_t timestamp)
+{
+	if(!m_started)
+		return;
+
+	for(auto& stats : m_stats)
+	{
+		if(stats.m_occupancyTime.size() <= stats.m_outstanding)
+			stats.m_occupancyTime.resize(stats.m_outstanding + 1, 0);
+		stats.m_occupancyTime[stats.m_outstanding] += timestamp - stats.m_lastChange;
+		stats.m_lastChange = timestamp;
+	}
+
+	for(auto it : m_pending)
+		m_transactions[it.second].m_state = PCIeTransaction::STATE_TIMED_OUT;
+	m_pending.clear();
+}
@@ -0,0 +1,349 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of PCIeTransactionTracker
+ */
+#ifndef PCIeTransactionTracker_h
+#define PCIeTransactionTracker_h
+
+#include "PCIeTransportDecoder.h"
+
+/**
+	@brief Summary of a single TLP, as seen at the transport layer
+ */
+class PCIeTLPInfo
+{
+public:
+	PCIeTLPInfo()
+		: m_start(0)
+		, m_end(0)
+		, m_type(PCIeTransportSymbol::TYPE_INVALID)
+		, m_requester(0)
+		, m_completer(0)
+		, m_tag(0)
+		, m_length(0)
+		, m_payloadBytes(0)
+		, m_status(0)
+		, m_byteCount(0)
+		, m_address(0)
+		, m_poisoned(false)
+		, m_error(false)
+	{}
+
+	bool IsNonPosted() const;
+	bool IsCompletion() const;
+
+	///@brief Start and end of the TLP, in fs
+	int64_t m_start;
+	int64_t m_end;
+
+	PCIeTransportSymbol::TlpType m_type;
+	uint16_t m_requester;
+	uint16_t m_completer;
+	uint8_t m_tag;
+
+	///@brief Length field in dwords (for reads, the amount of data requested)
+	uint32_t m_length;
+
+	///@brief Actual payload size, not including any ECRC
+	uint32_t m_payloadBytes;
+
+	uint8_t m_status;
+	uint16_t m_byteCount;
+
+	///@brief Request address, or low 7 bits of the address for completions
+	uint64_t m_address;
+
+	bool m_poisoned;
+
+	///@brief True if the TLP was malformed or failed its ECRC, and would be dropped by the receiver
+	bool m_error;
+};
+
+/**
+	@brief Something that happened on one direction of a link: either a TLP or a flow control update
+ */
+class PCIeLinkEvent
+{
+public:
+	///@brief Index of the link direction this event was seen on (0 or 1)
+	size_t m_direction;
+
+	int64_t m_timestamp;
+
+	bool m_isTLP;
+	PCIeTLPInfo m_tlp;
+
+	///@brief Flow control DLLP fields, if m_isTLP is false
+	PCIeTransportSymbol m_flowControl;
+
+	bool operator<(const PCIeLinkEvent& rhs) const
+	{ return m_timestamp < rhs.m_timestamp; }
+};
+
+/**
+	@brief A non-posted request and the completion(s) it was answered with
+ */
+class PCIeTransaction
+{
+public:
+	PCIeTransaction()
+		: m_direction(0)
+		, m_completions(0)
+		, m_completedBytes(0)
+		, m_completionStart(0)
+		, m_completionEnd(0)
+		, m_completer(0)
+		, m_status(0)
+		, m_state(STATE_PENDING)
+	{}
+
+	enum State
+	{
+		STATE_PENDING,		//still waiting for completion
+		STATE_COMPLETE,		//completed successfully
+		STATE_FAILED,		//completed with non-successful status
+		STATE_TAG_REUSED,	//a different request was sent with the same tag before this one completed
+		STATE_TIMED_OUT		//no completion before the end of the capture
+	};
+
+	///@brief Time from start of the request to start of the first completion, in fs
+	int64_t GetLatency() const
+	{ return m_completionStart - m_request.m_start; }
+
+	///@brief Time from start of the request to end of the last completion, in fs
+	int64_t GetDuration() const
+	{ return m_completionEnd - m_request.m_start; }
+
+	///@brief Direction the request was sent in (completions come back the other way)
+	size_t m_direction;
+
+	PCIeTLPInfo m_request;
+
+	size_t m_completions;
+	uint32_t m_completedBytes;
+	int64_t m_completionStart;
+	int64_t m_completionEnd;
+	uint16_t m_completer;
+	uint8_t m_status;
+
+	State m_state;
+};
+
+/**
+	@brief Flow control credit accounting for one class of traffic (posted, non-posted, or completion)
+
+	Credit counters are unwrapped to 64 bits. If link initialization was captured, m_advertised holds the receiver's
+	initial allocation. Otherwise the first UpdateFC is used as the starting point, on the assumption that nothing was
+	outstanding at the time, so the peak usage figures are a lower bound.
+ */
+class PCIeCreditCounter
+{
+public:
+	PCIeCreditCounter()
+		: m_valid(false)
+		, m_infinite(false)
+		, m_advertised(0)
+		, m_limit(0)
+		, m_released(0)
+		, m_consumed(0)
+		, m_minInUse(0)
+		, m_maxInUse(0)
+		, m_overruns(0)
+	{}
+
+	void Initialize(uint16_t credits, bool initfc);
+	void Update(uint16_t limit, uint16_t mask);
+	bool Consume(uint64_t credits);
+
+	///@brief Credits consumed by the transmitter and not yet returned by the receiver
+	int64_t GetInUse() const
+	{ return static_cast<int64_t>(m_consumed - m_released); }
+
+	///@brief Largest number of credits seen in use at once
+	int64_t GetPeakInUse() const
+	{ return m_maxInUse - m_minInUse; }
+
+	///@brief True once we know enough to track credits (an InitFC or UpdateFC was seen)
+	bool m_valid;
+
+	///@brief True if the receiver advertised infinite credits
+	bool m_infinite;
+
+	///@brief Initial allocation from InitFC, or zero if link initialization wasn't captured
+	uint16_t m_advertised;
+
+	///@brief Most recent credit limit (not unwrapped)
+	uint16_t m_limit;
+
+	uint64_t m_released;
+	uint64_t m_consumed;
+
+	int64_t m_minInUse;
+	int64_t m_maxInUse;
+
+	///@brief Number of TLPs sent without enough credits available
+	uint64_t m_overruns;
+};
+
+/**
+	@brief Flow control state for TLPs sent in one direction of a link, tracked from the DLLPs sent in the other
+ */
+class PCIeFlowControlState
+{
+public:
+	enum CreditClass
+	{
+		CLASS_POSTED,
+		CLASS_NON_POSTED,
+		CLASS_COMPLETION,
+
+		CLASS_COUNT
+	};
+
+	static CreditClass GetClass(PCIeTransportSymbol::TlpType type);
+
+	PCIeCreditCounter m_header[CLASS_COUNT];
+	PCIeCreditCounter m_data[CLASS_COUNT];
+};
+
+/**
+	@brief Statistics for one direction of a link
+ */
+class PCIeLinkStatistics
+{
+public:
+	PCIeLinkStatistics()
+		: m_tlps(0)
+		, m_badTlps(0)
+		, m_requests(0)
+		, m_duplicateRequests(0)
+		, m_unexpectedCompletions(0)
+		, m_outstanding(0)
+		, m_maxOutstanding(0)
+		, m_lastChange(0)
+	{}
+
+	///@brief Mean number of outstanding requests, weighted by time
+	double GetMeanOutstanding() const;
+
+	uint64_t m_tlps;
+	uint64_t m_badTlps;
+
+	///@brief Non-posted requests sent in this direction
+	uint64_t m_requests;
+
+	///@brief Requests which were identical to one already outstanding (e.g. replays), and were ignored
+	uint64_t m_duplicateRequests;
+
+	///@brief Completions sent in this direction which didn't match any outstanding request
+	uint64_t m_unexpectedCompletions;
+
+	///@brief Number of requests sent in this direction which are waiting for a completion
+	size_t m_outstanding;
+	size_t m_maxOutstanding;
+
+	///@brief Total time spent with each number of requests outstanding, in fs, indexed by count
+	std::vector<int64_t> m_occupancyTime;
+	int64_t m_lastChange;
+
+	///@brief Credits for TLPs sent in this direction
+	PCIeFlowControlState m_credits;
+};
+
+/**
+	@brief Matches PCIe non-posted requests to their completions and keeps per-link statistics
+
+	Events from both directions of the link are fed in timestamp order. Requests are matched to completions
+	travelling the other way by requester ID and tag. A read may be answered by several completions, and is done once
+	the byte count of a completion says there is nothing left to send.
+
+	Only VC0 flow control credits are tracked, and all traffic classes are assumed to map to VC0.
+ */
+class PCIeTransactionTracker
+{
+public:
+	PCIeTransactionTracker();
+
+	void AddEvent(const PCIeLinkEvent& event);
+	void Flush(int64_t timestamp);
+	void Clear();
+
+	static void GetEvents(PCIeTransportWaveform* wfm, size_t direction, std::vector<PCIeLinkEvent>& events);
+
+	///@brief Every non-posted request seen, in order of transmission
+	const std::vector<PCIeTransaction>& GetTransactions() const
+	{ return m_transactions; }
+
+	const PCIeLinkStatistics& GetStatistics(size_t direction) const
+	{ return m_stats[direction]; }
+
+	/**
+		@brief Histogram of request-to-first-completion latency for successful transactions of one request type
+
+		Bin i counts latencies of at least 2^i ns but less than 2^(i+1) ns (bin 0 also holds anything under 1 ns).
+	 */
+	const std::vector<uint64_t>& GetLatencyHistogram(PCIeTransportSymbol::TlpType type)
+	{ return m_latencyHistograms[type]; }
+
+	/**
+		@brief Number of requests outstanding in both directions after each change, as (timestamp, count) pairs
+	 */
+	const std::vector<std::pair<int64_t, size_t> >& GetOccupancyHistory() const
+	{ return m_occupancyHistory; }
+
+protected:
+	void AddTLP(size_t direction, const PCIeTLPInfo& tlp);
+	void AddFlowControl(size_t direction, const PCIeTransportSymbol& fc);
+	void ConsumeCredits(size_t direction, const PCIeTLPInfo& tlp);
+	void SetOutstanding(size_t direction, size_t count, int64_t timestamp);
+	void Retire(size_t index, PCIeTransaction::State state, int64_t timestamp);
+
+	static uint32_t GetKey(size_t direction, uint16_t requester, uint8_t tag)
+	{ return (direction << 24) | (requester << 8) | tag; }
+
+	std::vector<PCIeTransaction> m_transactions;
+
+	///@brief Index into m_transactions of each outstanding request, by direction/requester/tag
+	std::map<uint32_t, size_t> m_pending;
+
+	PCIeLinkStatistics m_stats[2];
+
+	std::map<PCIeTransportSymbol::TlpType, std::vector<uint64_t> > m_latencyHistograms;
+	std::vector<std::pair<int64_t, size_t> > m_occupancyHistory;
+
+	///@brief True once the first event has been seen
+	bool m_started;
+};
+
+#endif
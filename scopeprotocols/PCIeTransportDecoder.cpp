@@ -121,6 +121,9 @@ void PCIeTransportDecoder::Refresh()
 		STATE_COMPLETION_6,
 		STATE_COMPLETION_7,
 
+		STATE_MESSAGE_CODE,
+		STATE_MESSAGE_HEADER,
+
 		STATE_DATA,
 
 	} state = STATE_IDLE;
@@ -152,6 +155,16 @@ void PCIeTransportDecoder::Refresh()
 	size_t nbyte				= 0;
 	uint8_t completion_status	= 0;
 	uint16_t byte_count			= 0;
+	uint8_t msg_routing			= 0;
+	size_t length_index			= 0;
+
+	//Raw TLP contents (header, payload, and digest) for length and ECRC checks
+	vector<uint8_t> tlp_bytes;
+
+	//Fields of the flow control DLLP currently being passed through, if any
+	bool fc_valid				= false;
+	int64_t fc_start			= 0;
+	uint32_t fc_fields			= 0;
 
 	char tmp[32];
 
@@ -176,6 +189,9 @@ void PCIeTransportDecoder::Refresh()
 		int64_t end = off + dur;
 		size_t ilast = cap->m_samples.size() - 1;
 
+		if( (state != STATE_IDLE) && (sym.m_type == PCIeDataLinkSymbol::TYPE_TLP_DATA) )
+			tlp_bytes.push_back(sym.m_data);
+
 		switch(state)
 		{
 			////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -183,17 +199,71 @@ void PCIeTransportDecoder::Refresh()
 
 			case STATE_IDLE:
 
-				//Ignore everything but start of a TLP
-				if(sym.m_type == PCIeDataLinkSymbol::TYPE_TLP_SEQUENCE)
+				switch(sym.m_type)
 				{
-					//Create the packet
-					pack = new Packet;
-					m_packets.push_back(pack);
-					pack->m_offset = off * cap->m_timescale;
-					pack->m_len = 0;
-					pack->m_headers["Seq"] = to_string(sym.m_data);
-
-					state = STATE_HEADER_0;
+					//Start of a TLP
+					case PCIeDataLinkSymbol::TYPE_TLP_SEQUENCE:
+
+						//Create the packet
+						pack = new Packet;
+						m_packets.push_back(pack);
+						pack->m_offset = off * cap->m_timescale;
+						pack->m_len = 0;
+						pack->m_headers["Seq"] = to_string(sym.m_data);
+
+						tlp_bytes.clear();
+						state = STATE_HEADER_0;
+						break;
+
+					//Flow control DLLPs carry transaction layer credit information, so pass them through.
+					//Everything else at the data link layer is of no interest to us.
+					case PCIeDataLinkSymbol::TYPE_DLLP_TYPE:
+						switch(sym.m_data)
+						{
+							case PCIeDataLinkSymbol::DLLP_TYPE_INITFC1_P:
+							case PCIeDataLinkSymbol::DLLP_TYPE_INITFC1_NP:
+							case PCIeDataLinkSymbol::DLLP_TYPE_INITFC1_CPL:
+							case PCIeDataLinkSymbol::DLLP_TYPE_INITFC2_P:
+							case PCIeDataLinkSymbol::DLLP_TYPE_INITFC2_NP:
+							case PCIeDataLinkSymbol::DLLP_TYPE_INITFC2_CPL:
+							case PCIeDataLinkSymbol::DLLP_TYPE_UPDATEFC_P:
+							case PCIeDataLinkSymbol::DLLP_TYPE_UPDATEFC_NP:
+							case PCIeDataLinkSymbol::DLLP_TYPE_UPDATEFC_CPL:
+								fc_valid = true;
+								fc_start = off;
+								fc_fields = sym.m_data << 24;
+								break;
+
+							default:
+								fc_valid = false;
+						}
+						break;
+
+					case PCIeDataLinkSymbol::TYPE_DLLP_VC:
+						fc_fields |= (sym.m_data & 0xf) << 20;
+						break;
+
+					case PCIeDataLinkSymbol::TYPE_DLLP_HEADER_CREDITS:
+						fc_fields |= (sym.m_data & 0xff) << 12;
+						break;
+
+					case PCIeDataLinkSymbol::TYPE_DLLP_DATA_CREDITS:
+						fc_fields |= (sym.m_data & 0xfff);
+						break;
+
+					case PCIeDataLinkSymbol::TYPE_DLLP_CRC_OK:
+						if(fc_valid)
+						{
+							cap->m_offsets.push_back(fc_start);
+							cap->m_durations.push_back(end - fc_start);
+							cap->m_samples.push_back(PCIeTransportSymbol(PCIeTransportSymbol::TYPE_FLOW_CONTROL, fc_fields));
+						}
+						fc_valid = false;
+						break;
+
+					default:
+						fc_valid = false;
+						break;
 				}
 
 				break;	//end STATE_IDLE
@@ -289,6 +359,28 @@ void PCIeTransportDecoder::Refresh()
 
 						//Type 0x1b is deprecated
 
+						//Messages are always 4 words, low 3 bits of type are routing
+						case 0x10:
+						case 0x11:
+						case 0x12:
+						case 0x13:
+						case 0x14:
+						case 0x15:
+						case 0x16:
+						case 0x17:
+							msg_routing = sym.m_data & 7;
+							if(tlp_format == TLP_FORMAT_4W_NODATA)
+							{
+								type = PCIeTransportSymbol::TYPE_MSG;
+								pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_COMMAND];
+							}
+							else if(tlp_format == TLP_FORMAT_4W_DATA)
+							{
+								type = PCIeTransportSymbol::TYPE_MSG_DATA;
+								pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_COMMAND];
+							}
+							break;
+
 						case 10:
 							if(tlp_format == TLP_FORMAT_3W_NODATA)
 							{
@@ -316,8 +408,6 @@ void PCIeTransportDecoder::Refresh()
 							break;
 					}
 
-					//TODO: support Msg / MSgD
-
 					//Add the type symbol
 					cap->m_offsets.push_back(off);
 					cap->m_durations.push_back(dur);
@@ -423,17 +513,31 @@ void PCIeTransportDecoder::Refresh()
 					if(packet_len == 0)
 						packet_len = 1024;
 
+					//Reads have no payload, but the length field is the amount of data requested
+					size_t length_field = packet_len;
+					bool is_read =
+						(type == PCIeTransportSymbol::TYPE_MEM_RD) ||
+						(type == PCIeTransportSymbol::TYPE_MEM_RD_LK) ||
+						(type == PCIeTransportSymbol::TYPE_IO_RD) ||
+						(type == PCIeTransportSymbol::TYPE_CFG_RD_0) ||
+						(type == PCIeTransportSymbol::TYPE_CFG_RD_1);
+
 					//If the message has no payload, force length to zero for payload size counting
-					//(according to spec, actual value is reserved)
+					//(according to spec, actual value is reserved for anything but reads)
 					if(!has_data)
+					{
 						packet_len = 0;
-					else
-						pack->m_headers["Length"] = to_string(packet_len * 4);
+						if(!is_read)
+							length_field = 0;
+					}
+					if(length_field)
+						pack->m_headers["Length"] = to_string(length_field * 4);
 
 					//Add the length symbol
+					length_index = cap->m_samples.size();
 					cap->m_offsets.push_back(off);
 					cap->m_durations.push_back(dur);
-					cap->m_samples.push_back(PCIeTransportSymbol(PCIeTransportSymbol::TYPE_LENGTH, packet_len));
+					cap->m_samples.push_back(PCIeTransportSymbol(PCIeTransportSymbol::TYPE_LENGTH, length_field));
 
 					//What happens next depends on the TLP format
 
@@ -452,6 +556,12 @@ void PCIeTransportDecoder::Refresh()
 							state = STATE_MEMORY_0;
 							break;
 
+						//Messages have the same requester ID and tag, then the message code
+						case PCIeTransportSymbol::TYPE_MSG:
+						case PCIeTransportSymbol::TYPE_MSG_DATA:
+							state = STATE_MEMORY_0;
+							break;
+
 						case PCIeTransportSymbol::TYPE_COMPLETION:
 						case PCIeTransportSymbol::TYPE_COMPLETION_DATA:
 						case PCIeTransportSymbol::TYPE_COMPLETION_LOCKED_ERROR:
@@ -532,7 +642,10 @@ void PCIeTransportDecoder::Refresh()
 
 					pack->m_headers["Tag"] = to_string(tag);
 
-					state = STATE_BYTE_ENABLES;
+					if( (type == PCIeTransportSymbol::TYPE_MSG) || (type == PCIeTransportSymbol::TYPE_MSG_DATA) )
+						state = STATE_MESSAGE_CODE;
+					else
+						state = STATE_BYTE_ENABLES;
 				}
 				break;	//end STATE_MEMORY_3
 
@@ -569,7 +682,7 @@ void PCIeTransportDecoder::Refresh()
 					}
 
 					pack->m_headers["First"] = first;
-					pack->m_headers["Last"] = first;
+					pack->m_headers["Last"] = last;
 
 					state = STATE_ADDRESS_0;
 					nbyte = 0;
@@ -875,6 +988,84 @@ void PCIeTransportDecoder::Refresh()
 				}
 				break;	//end STATE_COMPLETION_7
 
+			////////////////////////////////////////////////////////////////////////////////////////////////////////////
+			// Messages (PCIe 2.0 base spec section 2.2.8)
+
+			case STATE_MESSAGE_CODE:
+				if(sym.m_type != PCIeDataLinkSymbol::TYPE_TLP_DATA)
+				{
+					cap->m_offsets.push_back(off);
+					cap->m_durations.push_back(dur);
+					cap->m_samples.push_back(PCIeTransportSymbol(PCIeTransportSymbol::TYPE_ERROR));
+					pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_ERROR];
+					state = STATE_IDLE;
+				}
+				else
+				{
+					cap->m_offsets.push_back(off);
+					cap->m_durations.push_back(dur);
+					cap->m_samples.push_back(PCIeTransportSymbol(PCIeTransportSymbol::TYPE_MESSAGE_CODE, sym.m_data));
+
+					pack->m_headers["Type"] = string("Msg ") + GetMessageName(sym.m_data);
+					pack->m_headers["Addr"] = GetRoutingName(msg_routing);
+
+					//Address routed messages have a 64-bit address, everything else has message specific fields
+					nbyte = 0;
+					mem_addr = 0;
+					if(msg_routing == PCIeTransportSymbol::ROUTE_BY_ADDRESS)
+						state = STATE_ADDRESS_0;
+					else
+						state = STATE_MESSAGE_HEADER;
+				}
+				break;	//end STATE_MESSAGE_CODE
+
+			//Bytes 8-15 of the header. ID routed messages have the target ID in the first two bytes.
+			case STATE_MESSAGE_HEADER:
+				if(sym.m_type != PCIeDataLinkSymbol::TYPE_TLP_DATA)
+				{
+					cap->m_offsets.push_back(off);
+					cap->m_durations.push_back(dur);
+					cap->m_samples.push_back(PCIeTransportSymbol(PCIeTransportSymbol::TYPE_ERROR));
+					pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_ERROR];
+					state = STATE_IDLE;
+				}
+				else
+				{
+					bool by_id = (msg_routing == PCIeTransportSymbol::ROUTE_BY_ID);
+					mem_addr = (mem_addr << 8) | sym.m_data;
+
+					if( (nbyte == 0) && by_id)
+					{
+						cap->m_offsets.push_back(off);
+						cap->m_durations.push_back(dur);
+						cap->m_samples.push_back(PCIeTransportSymbol(PCIeTransportSymbol::TYPE_TARGET_ID));
+					}
+					else if( (nbyte == 1) && by_id)
+					{
+						cap->m_durations[ilast] = end - cap->m_offsets[ilast];
+						cap->m_samples[ilast].m_data = mem_addr;
+						pack->m_headers["Addr"] = string("To ") + FormatID(mem_addr);
+						mem_addr = 0;
+					}
+					else if(nbyte == (by_id ? 2 : 0) )
+					{
+						cap->m_offsets.push_back(off);
+						cap->m_durations.push_back(dur);
+						cap->m_samples.push_back(PCIeTransportSymbol(PCIeTransportSymbol::TYPE_MESSAGE_HEADER));
+					}
+
+					nbyte ++;
+					if(nbyte == 8)
+					{
+						cap->m_durations[ilast] = end - cap->m_offsets[ilast];
+						cap->m_samples[ilast].m_data = mem_addr;
+
+						nbyte = 0;
+						state = STATE_DATA;
+					}
+				}
+				break;	//end STATE_MESSAGE_HEADER
+
 			////////////////////////////////////////////////////////////////////////////////////////////////////////////
 			// TLP payload data
 
@@ -885,8 +1076,49 @@ void PCIeTransportDecoder::Refresh()
 
 				if(sym.m_type == PCIeDataLinkSymbol::TYPE_TLP_CRC_OK)
 				{
-					//TODO: verify length wasn't truncated
-					//TODO: verify TLP end to end CRC if present
+					size_t header_len = format_4word ? 16 : 12;
+
+					//If there's a digest, the last four data bytes are the ECRC rather than payload.
+					//Merge them into a single symbol and check it.
+					if(digest_present && (tlp_bytes.size() >= header_len + 4) )
+					{
+						int64_t ecrc_end = cap->m_offsets[ilast] + cap->m_durations[ilast];
+						for(int j=0; j<3; j++)
+						{
+							cap->m_offsets.pop_back();
+							cap->m_durations.pop_back();
+							cap->m_samples.pop_back();
+						}
+						ilast = cap->m_samples.size() - 1;
+						cap->m_durations[ilast] = ecrc_end - cap->m_offsets[ilast];
+
+						size_t base = tlp_bytes.size() - 4;
+						uint32_t ecrc_expected = 0;
+						for(size_t j=0; j<4; j++)
+							ecrc_expected = (ecrc_expected << 8) | tlp_bytes[base + j];
+						cap->m_samples[ilast].m_data = ecrc_expected;
+
+						if(ecrc_expected == CalculateEcrc(tlp_bytes, base))
+							cap->m_samples[ilast].m_type = PCIeTransportSymbol::TYPE_ECRC_OK;
+						else
+						{
+							cap->m_samples[ilast].m_type = PCIeTransportSymbol::TYPE_ECRC_BAD;
+							pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_ERROR];
+						}
+
+						pack->m_data.resize(pack->m_data.size() - 4);
+					}
+
+					//Make sure the payload is the size the header says it should be
+					size_t expected_len = header_len + packet_len*4 + (digest_present ? 4 : 0);
+					if(tlp_bytes.size() != expected_len)
+					{
+						auto& lsym = cap->m_samples[length_index];
+						lsym.m_type = PCIeTransportSymbol::TYPE_LENGTH_BAD;
+						lsym.m_data = (lsym.m_data & 0xffffffff) | (static_cast<uint64_t>(pack->m_data.size()) << 32);
+						pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_ERROR];
+					}
+
 					state = STATE_IDLE;
 				}
 
@@ -899,7 +1131,6 @@ void PCIeTransportDecoder::Refresh()
 					state = STATE_IDLE;
 				}
 
-				//TODO: complain if we have more data than we should have
 				else
 				{
 					cap->m_offsets.push_back(off);
@@ -930,8 +1161,16 @@ std::string PCIeTransportWaveform::GetColor(size_t i)
 		case PCIeTransportSymbol::TYPE_FIRST_BYTE_ENABLE:
 		case PCIeTransportSymbol::TYPE_LAST_BYTE_ENABLE:
 		case PCIeTransportSymbol::TYPE_COMPLETION_STATUS:
+		case PCIeTransportSymbol::TYPE_MESSAGE_CODE:
+		case PCIeTransportSymbol::TYPE_FLOW_CONTROL:
 			return StandardColors::colors[StandardColors::COLOR_CONTROL];
 
+		case PCIeTransportSymbol::TYPE_ECRC_OK:
+			return StandardColors::colors[StandardColors::COLOR_CHECKSUM_OK];
+
+		case PCIeTransportSymbol::TYPE_ECRC_BAD:
+			return StandardColors::colors[StandardColors::COLOR_CHECKSUM_BAD];
+
 		case PCIeTransportSymbol::TYPE_FLAGS:
 			if(s.m_data & PCIeTransportSymbol::FLAG_POISONED)
 				return StandardColors::colors[StandardColors::COLOR_ERROR];
@@ -940,11 +1179,13 @@ std::string PCIeTransportWaveform::GetColor(size_t i)
 
 		case PCIeTransportSymbol::TYPE_REQUESTER_ID:
 		case PCIeTransportSymbol::TYPE_COMPLETER_ID:
+		case PCIeTransportSymbol::TYPE_TARGET_ID:
 		case PCIeTransportSymbol::TYPE_ADDRESS_X32:
 		case PCIeTransportSymbol::TYPE_ADDRESS_X64:
 			return StandardColors::colors[StandardColors::COLOR_ADDRESS];
 
 		case PCIeTransportSymbol::TYPE_DATA:
+		case PCIeTransportSymbol::TYPE_MESSAGE_HEADER:
 			return StandardColors::colors[StandardColors::COLOR_DATA];
 
 		case PCIeTransportSymbol::TYPE_ERROR:
@@ -962,34 +1203,7 @@ string PCIeTransportWaveform::GetText(size_t i)
 	switch(s.m_type)
 	{
 		case PCIeTransportSymbol::TYPE_TLP_TYPE:
-			switch(s.m_data)
-			{
-				case PCIeTransportSymbol::TYPE_MEM_RD:			return "Mem read";
-				case PCIeTransportSymbol::TYPE_MEM_RD_LK:		return "Mem read locked";
-				case PCIeTransportSymbol::TYPE_MEM_WR:			return "Mem write";
-				case PCIeTransportSymbol::TYPE_IO_RD:			return "IO read";
-				case PCIeTransportSymbol::TYPE_IO_WR:			return "IO write";
-				case PCIeTransportSymbol::TYPE_CFG_RD_0:		return "Cfg read 0";
-				case PCIeTransportSymbol::TYPE_CFG_WR_0:		return "Cfg write 0";
-				case PCIeTransportSymbol::TYPE_CFG_RD_1:		return "Cfg read 1";
-				case PCIeTransportSymbol::TYPE_CFG_WR_1:		return "Cfg write 1";
-
-				case PCIeTransportSymbol::TYPE_MSG:
-				case PCIeTransportSymbol::TYPE_MSG_DATA:
-					return "Message";
-
-				case PCIeTransportSymbol::TYPE_COMPLETION:
-				case PCIeTransportSymbol::TYPE_COMPLETION_DATA:
-					return "Completion";
-
-				case PCIeTransportSymbol::TYPE_COMPLETION_LOCKED_ERROR:
-				case PCIeTransportSymbol::TYPE_COMPLETION_LOCKED_DATA:
-					return "Completion locked";
-
-				case PCIeTransportSymbol::TYPE_INVALID:
-				default:
-					return "ERROR";
-			}
+			return PCIeTransportDecoder::GetTypeName(static_cast<PCIeTransportSymbol::TlpType>(s.m_data));
 
 		case PCIeTransportSymbol::TYPE_TRAFFIC_CLASS:
 			return string("TC: ") + to_string(s.m_data);
@@ -1000,6 +1214,42 @@ string PCIeTransportWaveform::GetText(size_t i)
 		case PCIeTransportSymbol::TYPE_COMPLETER_ID:
 			return string("Completer: ") + PCIeTransportDecoder::FormatID(s.m_data);
 
+		case PCIeTransportSymbol::TYPE_TARGET_ID:
+			return string("Target: ") + PCIeTransportDecoder::FormatID(s.m_data);
+
+		case PCIeTransportSymbol::TYPE_MESSAGE_CODE:
+			return PCIeTransportDecoder::GetMessageName(s.m_data);
+
+		case PCIeTransportSymbol::TYPE_MESSAGE_HEADER:
+			snprintf(tmp, sizeof(tmp), "Header: %" PRIx64, s.m_data);
+			return tmp;
+
+		case PCIeTransportSymbol::TYPE_ECRC_OK:
+		case PCIeTransportSymbol::TYPE_ECRC_BAD:
+			snprintf(tmp, sizeof(tmp), "ECRC: %08" PRIx64, s.m_data);
+			return tmp;
+
+		case PCIeTransportSymbol::TYPE_FLOW_CONTROL:
+			{
+				string ret;
+				switch(s.GetFlowControlType())
+				{
+					case PCIeDataLinkSymbol::DLLP_TYPE_INITFC1_P:		ret = "InitFC1-P";		break;
+					case PCIeDataLinkSymbol::DLLP_TYPE_INITFC1_NP:		ret = "InitFC1-NP";		break;
+					case PCIeDataLinkSymbol::DLLP_TYPE_INITFC1_CPL:		ret = "InitFC1-CPL";	break;
+					case PCIeDataLinkSymbol::DLLP_TYPE_INITFC2_P:		ret = "InitFC2-P";		break;
+					case PCIeDataLinkSymbol::DLLP_TYPE_INITFC2_NP:		ret = "InitFC2-NP";		break;
+					case PCIeDataLinkSymbol::DLLP_TYPE_INITFC2_CPL:		ret = "InitFC2-CPL";	break;
+					case PCIeDataLinkSymbol::DLLP_TYPE_UPDATEFC_P:		ret = "UpdateFC-P";		break;
+					case PCIeDataLinkSymbol::DLLP_TYPE_UPDATEFC_NP:		ret = "UpdateFC-NP";	break;
+					case PCIeDataLinkSymbol::DLLP_TYPE_UPDATEFC_CPL:	ret = "UpdateFC-CPL";	break;
+					default:											ret = "FC";				break;
+				}
+				snprintf(tmp, sizeof(tmp), " VC%d: %d hdr, %d data",
+					s.GetFlowControlVC(), s.GetFlowControlHeaderCredits(), s.GetFlowControlDataCredits());
+				return ret + tmp;
+			}
+
 		case PCIeTransportSymbol::TYPE_ADDRESS_X32:
 			snprintf(tmp, sizeof(tmp), "Address: %08" PRIx64, s.m_data);
 			return tmp;
@@ -1035,6 +1285,10 @@ string PCIeTransportWaveform::GetText(size_t i)
 		case PCIeTransportSymbol::TYPE_LENGTH:
 			return string("Len: ") + to_string(s.m_data * 4);
 
+		case PCIeTransportSymbol::TYPE_LENGTH_BAD:
+			snprintf(tmp, sizeof(tmp), "Len: %" PRIu64 " (got %" PRIu64 ")", (s.m_data & 0xffffffff) * 4, s.m_data >> 32);
+			return tmp;
+
 		case PCIeTransportSymbol::TYPE_BYTE_COUNT:
 			return string("Bytes: ") + to_string(s.m_data);
 
@@ -1114,3 +1368,122 @@ string PCIeTransportDecoder::FormatID(uint16_t id)
 		id & 0x7);
 	return tmp;
 }
+
+/**
+	@brief Gets the human readable name of a TLP type
+ */
+string PCIeTransportDecoder::GetTypeName(PCIeTransportSymbol::TlpType type)
+{
+	switch(type)
+	{
+		case PCIeTransportSymbol::TYPE_MEM_RD:			return "Mem read";
+		case PCIeTransportSymbol::TYPE_MEM_RD_LK:		return "Mem read locked";
+		case PCIeTransportSymbol::TYPE_MEM_WR:			return "Mem write";
+		case PCIeTransportSymbol::TYPE_IO_RD:			return "IO read";
+		case PCIeTransportSymbol::TYPE_IO_WR:			return "IO write";
+		case PCIeTransportSymbol::TYPE_CFG_RD_0:		return "Cfg read 0";
+		case PCIeTransportSymbol::TYPE_CFG_WR_0:		return "Cfg write 0";
+		case PCIeTransportSymbol::TYPE_CFG_RD_1:		return "Cfg read 1";
+		case PCIeTransportSymbol::TYPE_CFG_WR_1:		return "Cfg write 1";
+
+		case PCIeTransportSymbol::TYPE_MSG:
+		case PCIeTransportSymbol::TYPE_MSG_DATA:
+			return "Message";
+
+		case PCIeTransportSymbol::TYPE_COMPLETION:
+		case PCIeTransportSymbol::TYPE_COMPLETION_DATA:
+			return "Completion";
+
+		case PCIeTransportSymbol::TYPE_COMPLETION_LOCKED_ERROR:
+		case PCIeTransportSymbol::TYPE_COMPLETION_LOCKED_DATA:
+			return "Completion locked";
+
+		case PCIeTransportSymbol::TYPE_INVALID:
+		default:
+			return "ERROR";
+	}
+}
+
+/**
+	@brief Gets the name of a message code (PCIe 2.0 base spec table F-1)
+ */
+string PCIeTransportDecoder::GetMessageName(uint8_t code)
+{
+	switch(code)
+	{
+		case 0x00:	return "Unlock";
+		case 0x10:	return "LTR";
+		case 0x12:	return "OBFF";
+		case 0x14:	return "PM_Active_State_Nak";
+		case 0x18:	return "PM_PME";
+		case 0x19:	return "PME_Turn_Off";
+		case 0x1b:	return "PME_TO_Ack";
+		case 0x20:	return "Assert_INTA";
+		case 0x21:	return "Assert_INTB";
+		case 0x22:	return "Assert_INTC";
+		case 0x23:	return "Assert_INTD";
+		case 0x24:	return "Deassert_INTA";
+		case 0x25:	return "Deassert_INTB";
+		case 0x26:	return "Deassert_INTC";
+		case 0x27:	return "Deassert_INTD";
+		case 0x30:	return "ERR_COR";
+		case 0x31:	return "ERR_NONFATAL";
+		case 0x33:	return "ERR_FATAL";
+		case 0x50:	return "Set_Slot_Power_Limit";
+		case 0x52:	return "PTM Request";
+		case 0x53:	return "PTM Response";
+		case 0x7e:	return "Vendor_Defined Type 0";
+		case 0x7f:	return "Vendor_Defined Type 1";
+
+		//Obsolete hot plug signaling messages, ignored by receivers
+		case 0x40:
+		case 0x41:
+		case 0x43:
+		case 0x44:
+		case 0x45:
+		case 0x47:
+		case 0x48:
+			return "Ignored";
+
+		default:
+			{
+				char tmp[32];
+				snprintf(tmp, sizeof(tmp), "Reserved %02x", code);
+				return tmp;
+			}
+	}
+}
+
+/**
+	@brief Gets a short description of a message routing subfield
+ */
+string PCIeTransportDecoder::GetRoutingName(uint8_t routing)
+{
+	switch(routing)
+	{
+		case PCIeTransportSymbol::ROUTE_TO_RC:			return "To RC";
+		case PCIeTransportSymbol::ROUTE_BY_ADDRESS:		return "By address";
+		case PCIeTransportSymbol::ROUTE_BY_ID:			return "By ID";
+		case PCIeTransportSymbol::ROUTE_BROADCAST:		return "Broadcast";
+		case PCIeTransportSymbol::ROUTE_LOCAL:			return "Local";
+		case PCIeTransportSymbol::ROUTE_GATHERED_TO_RC:	return "Gathered to RC";
+		default:										return "Reserved";
+	}
+}
+
+/**
+	@brief PCIe end-to-end CRC
+
+	Same algorithm as the LCRC, but calculated over the TLP header and payload only. The type bit 0 and EP bit are
+	variant (they may be changed by switches in flight) so are treated as always set (PCIe 2.0 base spec 2.7.1).
+
+	@param tlp	Raw TLP header and payload
+	@param len	Number of bytes of tlp to checksum (i.e. excluding the ECRC itself)
+ */
+uint32_t PCIeTransportDecoder::CalculateEcrc(const vector<uint8_t>& tlp, size_t len)
+{
+	vector<uint8_t> tmp(tlp.begin(), tlp.begin() + len);
+	tmp[0] |= 0x01;
+	tmp[2] |= PCIeTransportSymbol::FLAG_POISONED;
+	return CRC32(tmp);
+}
@@ -59,6 +59,13 @@ public:
 		TYPE_COMPLETER_ID,
 		TYPE_COMPLETION_STATUS,
 		TYPE_BYTE_COUNT,
+		TYPE_LENGTH_BAD,		//Payload size doesn't match length field (low 32 bits: length field, high: actual bytes)
+		TYPE_ECRC_OK,
+		TYPE_ECRC_BAD,
+		TYPE_MESSAGE_CODE,
+		TYPE_TARGET_ID,
+		TYPE_MESSAGE_HEADER,	//Message specific header bytes not otherwise decoded
+		TYPE_FLOW_CONTROL,		//Flow control DLLP passed through from the data link layer (see GetFlowControlType())
 		TYPE_ERROR
 	} m_type;
 
@@ -84,6 +91,35 @@ public:
 		TYPE_INVALID
 	};
 
+	//Message routing subfield (PCIe 2.0 base spec table 2-11)
+	enum MessageRouting
+	{
+		ROUTE_TO_RC				= 0,
+		ROUTE_BY_ADDRESS		= 1,
+		ROUTE_BY_ID				= 2,
+		ROUTE_BROADCAST			= 3,
+		ROUTE_LOCAL				= 4,
+		ROUTE_GATHERED_TO_RC	= 5
+	};
+
+	/**
+		@brief Layout of m_data for TYPE_FLOW_CONTROL
+
+		DLLP type (one of PCIeDataLinkSymbol::DLLPType) in bits 31:24, VC in 23:20, header credits in 19:12 and data
+		credits in 11:0.
+	 */
+	uint8_t GetFlowControlType() const
+	{ return m_data >> 24; }
+
+	uint8_t GetFlowControlVC() const
+	{ return (m_data >> 20) & 0xf; }
+
+	uint8_t GetFlowControlHeaderCredits() const
+	{ return (m_data >> 12) & 0xff; }
+
+	uint16_t GetFlowControlDataCredits() const
+	{ return m_data & 0xfff; }
+
 	//TLP flags
 	enum TlpFlags
 	{
@@ -138,6 +174,12 @@ public:
 	PROTOCOL_DECODER_INITPROC(PCIeTransportDecoder)
 
 	static std::string FormatID(uint16_t id);
+	static std::string GetTypeName(PCIeTransportSymbol::TlpType type);
+	static std::string GetMessageName(uint8_t code);
+	static std::string GetRoutingName(uint8_t routing);
+
+protected:
+	static uint32_t CalculateEcrc(const std::vector<uint8_t>& tlp, size_t len);
 };
 
 #endif
@@ -113,12 +113,11 @@ void ParallelBus::Refresh()
 	cap->PrepareForCpuAccess();
 	cap->Resize(len);
 	cap->CopyTimestamps(inputs[0]);
-	#pragma omp parallel for
-	for(size_t i=0; i<len; i++)
+	ThreadPool::GetDefault().ParallelFor(0, len, [&](size_t i)
 	{
 		for(int j=0; j<width; j++)
 			cap->m_samples[i].push_back(inputs[j]->m_samples[i]);
-	}
+	});
 	SetData(cap, 0);
 
 	//Copy our time scales from the input
@@ -46,10 +46,18 @@ using namespace std;
 
 PcapngExportFilter::PcapngExportFilter(const string& color)
 	: ExportFilter(color)
+	, m_sectionSize("Max Section Size")
 {
 	m_parameters[m_fname].m_fileFilterMask = "*.pcapng";
 	m_parameters[m_fname].m_fileFilterName = "PcapNG files (*.pcapng)";
 
+	//Zero means everything goes in one section
+	m_parameters[m_sectionSize] = FilterParameter(FilterParameter::TYPE_INT, Unit(Unit::UNIT_BYTES));
+	m_parameters[m_sectionSize].SetIntVal(0);
+
+	//Nanosecond resolution
+	m_ethernetInterface = m_writer.AddInterface(1, "eth0", 9);
+
 	CreateInput("packets");
 }
 
@@ -91,7 +99,9 @@ void PcapngExportFilter::Export()
 	if(!VerifyAllInputsOK())
 		return;
 
-	//If file is not open, open it and write a section header block if necessary
+	m_writer.SetMaxSectionSize(m_parameters[m_sectionSize].GetIntVal());
+
+	//If file is not open, open it and start a new section
 	if(!m_fp)
 	{
 		LogTrace("File wasn't open, opening it\n");
@@ -111,107 +121,9 @@ void PcapngExportFilter::Export()
 			return;
 		}
 
-		//See if file is empty. If so, write header
-		fseek(m_fp, 0, SEEK_END);
-		if(ftell(m_fp) == 0)
-		{
-			LogTrace("File was empty, writing SHB\n");
-
-			////////////////////////////////////////////////////////////////////////////////////////////////////////////
-			// Write the SHB
-
-			//Block type
-			uint32_t blocktype = 0x0a0d0d0a;
-			if(!fwrite(&blocktype, sizeof(blocktype), 1, m_fp))
-				LogError("file write failure\n");
-
-			//Length of the SHB itself
-			uint32_t shblen = 28;
-			if(!fwrite(&shblen, sizeof(shblen), 1, m_fp))
-				LogError("file write failure\n");
-
-			//Byte order magic
-			uint32_t bom = 0x1a2b3c4d;
-			if(!fwrite(&bom, sizeof(bom), 1, m_fp))
-				LogError("file write failure\n");
-
-			//File format version (1.0)
-			uint16_t major = 1;
-			uint16_t minor = 0;
-			if(!fwrite(&major, sizeof(major), 1, m_fp))
-				LogError("file write failure\n");
-			if(!fwrite(&minor, sizeof(minor), 1, m_fp))
-				LogError("file write failure\n");
-
-			//Section length (unspecified since we append live as data comes in and don't know a priori)
-			int64_t seclen = -1;
-			if(!fwrite(&seclen, sizeof(seclen), 1, m_fp))
-				LogError("file write failure\n");
-
-			//Block total length again
-			if(!fwrite(&shblen, sizeof(shblen), 1, m_fp))
-				LogError("file write failure\n");
-
-			////////////////////////////////////////////////////////////////////////////////////////////////////////////
-			// Write the IDB
-
-			//Block type
-			blocktype = 0x1;
-			if(!fwrite(&blocktype, sizeof(blocktype), 1, m_fp))
-				LogError("file write failure\n");
-
-			//Length of the IDB itself
-			uint32_t idblen = 40;
-			if(!fwrite(&idblen, sizeof(idblen), 1, m_fp))
-				LogError("file write failure\n");
-
-			//Link type
-			uint16_t linktype = 1;
-			if(!fwrite(&linktype, sizeof(linktype), 1, m_fp))
-				LogError("file write failure\n");
-
-			//Padding
-			uint16_t pad = 0;
-			if(!fwrite(&pad, sizeof(pad), 1, m_fp))
-				LogError("file write failure\n");
-
-			//Snapshot length
-			uint32_t snaplen = 0;
-			if(!fwrite(&snaplen, sizeof(snaplen), 1, m_fp))
-				LogError("file write failure\n");
-
-			//Option if_name (total 8 bytes)
-			uint16_t optid = 2;
-			if(!fwrite(&optid, sizeof(optid), 1, m_fp))
-				LogError("file write failure\n");
-			uint16_t optlen = 4;
-			if(!fwrite(&optlen, sizeof(optlen), 1, m_fp))
-				LogError("file write failure\n");
-			const char* ifname = "eth0";
-			if(!fwrite(ifname, strlen(ifname), 1, m_fp))
-				LogError("file write failure\n");
-
-			//Option it_tsresol (total 8 bytes)
-			optid = 9;
-			optlen = 1;
-			if(!fwrite(&optid, sizeof(optid), 1, m_fp))
-				LogError("file write failure\n");
-			if(!fwrite(&optlen, sizeof(optlen), 1, m_fp))
-				LogError("file write failure\n");
-			uint8_t tsresol[4] = {9, 0, 0, 0};	//nanosecond resolution
-			if(!fwrite(tsresol, sizeof(tsresol), 1, m_fp))
-				LogError("file write failure\n");
-
-			//Option endofopt (total 4 bytes)
-			if(!fwrite(&pad, sizeof(pad), 1, m_fp))
-				LogError("file write failure\n");
-			if(!fwrite(&pad, sizeof(pad), 1, m_fp))
-				LogError("file write failure\n");
-
-			//Write the IDB length again
-			if(!fwrite(&idblen, sizeof(idblen), 1, m_fp))
-				LogError("file write failure\n");
-		}
+		//Always start with our own SHB and IDB, even when appending.
+		//Anything already in the file stays in its own section, so we don't depend on its interface layout.
+		m_writer.BeginSection(m_fp);
 	}
 
 	auto stream = GetInput(0);
@@ -219,7 +131,8 @@ void PcapngExportFilter::Export()
 	if(wfm)
 		ExportEthernet(wfm);
 
-	fflush(m_fp);
+	//One write and flush for the whole waveform
+	m_writer.Flush();
 }
 
 /**
@@ -227,7 +140,7 @@ void PcapngExportFilter::Export()
  */
 void PcapngExportFilter::ExportEthernet(EthernetWaveform* wfm)
 {
-	vector<uint8_t> bytes;
+	m_frame.clear();
 	int64_t offset = 0;
 	for(size_t i=0; i<wfm->m_samples.size(); i++)
 	{
@@ -236,7 +149,7 @@ void PcapngExportFilter::ExportEthernet(EthernetWaveform* wfm)
 		{
 			//Start a new frame, clear out anything else
 			case EthernetFrameSegment::TYPE_SFD:
-				bytes.clear();
+				m_frame.clear();
 				offset = wfm->m_offsets[i] * wfm->m_timescale + wfm->m_triggerPhase;
 				break;
 
@@ -246,21 +159,23 @@ void PcapngExportFilter::ExportEthernet(EthernetWaveform* wfm)
 			case EthernetFrameSegment::TYPE_ETHERTYPE:
 			case EthernetFrameSegment::TYPE_VLAN_TAG:
 			case EthernetFrameSegment::TYPE_PAYLOAD:
-				{
-					for(size_t j=0; j<samp.m_data.size(); j++)
-						bytes.push_back(samp.m_data[j]);
-				}
+				m_frame.insert(m_frame.end(), samp.m_data.begin(), samp.m_data.end());
 				break;
 
 			//Good checksum, save the packet to the file
 			case EthernetFrameSegment::TYPE_FCS_GOOD:
-				ExportPacket(bytes, wfm->m_startTimestamp, wfm->m_startFemtoseconds + offset);
-				bytes.clear();
+				m_writer.WritePacket(
+					m_ethernetInterface,
+					wfm->m_startTimestamp,
+					wfm->m_startFemtoseconds + offset,
+					m_frame.data(),
+					m_frame.size());
+				m_frame.clear();
 				break;
 
 			//bad checksum, drop the packet
 			case EthernetFrameSegment::TYPE_FCS_BAD:
-				bytes.clear();
+				m_frame.clear();
 				break;
 
 			//ignore anything else
@@ -269,62 +184,3 @@ void PcapngExportFilter::ExportEthernet(EthernetWaveform* wfm)
 		}
 	}
 }
-
-void PcapngExportFilter::ExportPacket(vector<uint8_t>& packet, time_t timestamp, int64_t fs)
-{
-	//Canonicalize the timestamp to a single 64-bit nanosecond resolution quantity
-	int64_t ns = (1e9 * timestamp) + (fs * 1e-6);
-
-	//Block type
-	uint32_t blocktype = 6;
-	if(!fwrite(&blocktype, sizeof(blocktype), 1, m_fp))
-		LogError("file write failure\n");
-
-	//Block length (padded up to next 32 bit boundary)
-	uint32_t blocklen = 36 + packet.size();
-	uint32_t paddinglen = 4 - (blocklen % 4);
-	if(paddinglen == 4)
-		paddinglen = 0;
-	if(!fwrite(&blocklen, sizeof(blocklen), 1, m_fp))
-		LogError("file write failure\n");
-
-	//Interface ID
-	uint32_t iface = 0;
-	if(!fwrite(&iface, sizeof(iface), 1, m_fp))
-		LogError("file write failure\n");
-
-	//Timestamp
-	uint32_t tshi = (ns >> 32);
-	uint32_t tslo = (ns & 0xffffffff);
-	if(!fwrite(&tshi, sizeof(tshi), 1, m_fp))
-		LogError("file write failure\n");
-	if(!fwrite(&tslo, sizeof(tslo), 1, m_fp))
-		LogError("file write failure\n");
-
-	//Packet length repeated twice (original + captured, both always equal for us)
-	uint32_t packetlen = packet.size();
-	if(!fwrite(&packetlen, sizeof(packetlen), 1, m_fp))
-		LogError("file write failure\n");
-	if(!fwrite(&packetlen, sizeof(packetlen), 1, m_fp))
-		LogError("file write failure\n");
-
-	//Packet data
-	if(!fwrite(&packet[0], packet.size(), 1, m_fp))
-		LogError("file write failure\n");
-
-	//Pad out to 32 bit boundary
-	uint8_t padbuf[4] = {0};
-	if(!fwrite(&padbuf[0], paddinglen, 1, m_fp))
-		LogError("file write failure\n");
-
-	//Option endofopt (total 4 bytes)
-	uint16_t pad = 0;
-	if(!fwrite(&pad, sizeof(pad), 1, m_fp))
-		LogError("file write failure\n");
-	if(!fwrite(&pad, sizeof(pad), 1, m_fp))
-		LogError("file write failure\n");
-
-	//Repeat block length
-	if(!fwrite(&blocklen, sizeof(blocklen), 1, m_fp))
-		LogError("file write failure\n");
-}
@@ -38,6 +38,7 @@
 
 #include "ExportFilter.h"
 #include "EthernetProtocolDecoder.h"
+#include "PcapngFile.h"
 
 class PcapngExportFilter : public ExportFilter
 {
@@ -54,7 +55,17 @@ protected:
 	virtual void Export() override;
 
 	void ExportEthernet(EthernetWaveform* wfm);
-	void ExportPacket(std::vector<uint8_t>& packet, time_t timestamp, int64_t fs);
+
+	std::string m_sectionSize;
+
+	///@brief Buffered block writer
+	PcapngWriter m_writer;
+
+	///@brief Interface ID for Ethernet frames
+	size_t m_ethernetInterface;
+
+	///@brief Scratch buffer for the frame being assembled
+	std::vector<uint8_t> m_frame;
 };
 
 #endif
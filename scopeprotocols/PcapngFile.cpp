@@ -0,0 +1,849 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of PcapngFile and PcapngWriter
+ */
+
+#include "../scopehal/scopehal.h"
+#include "PcapngFile.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+static const uint32_t PCAPNG_BOM = 0x1a2b3c4d;
+
+///@brief Powers of ten up to 10^19 (the largest that fits in a uint64_t)
+static const uint64_t g_pow10[20] =
+{
+	1ULL,
+	10ULL,
+	100ULL,
+	1000ULL,
+	10000ULL,
+	100000ULL,
+	1000000ULL,
+	10000000ULL,
+	100000000ULL,
+	1000000000ULL,
+	10000000000ULL,
+	100000000000ULL,
+	1000000000000ULL,
+	10000000000000ULL,
+	100000000000000ULL,
+	1000000000000000ULL,
+	10000000000000000ULL,
+	100000000000000000ULL,
+	1000000000000000000ULL,
+	10000000000000000000ULL
+};
+
+static inline uint16_t ReadU16(const uint8_t* p, bool swap)
+{
+	uint16_t v;
+	memcpy(&v, p, sizeof(v));
+	return swap ? __builtin_bswap16(v) : v;
+}
+
+static inline uint32_t ReadU32(const uint8_t* p, bool swap)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return swap ? __builtin_bswap32(v) : v;
+}
+
+static inline uint64_t ReadU64(const uint8_t* p, bool swap)
+{
+	uint64_t v;
+	memcpy(&v, p, sizeof(v));
+	return swap ? __builtin_bswap64(v) : v;
+}
+
+/**
+	@brief Calls fn(code, data, len) for every option in [p, end), stopping at opt_endofopt
+ */
+template<class F>
+static void ForEachOption(const uint8_t* p, const uint8_t* end, bool swap, F fn)
+{
+	//Compare lengths rather than pointers, so a corrupt length can't form a pointer past the end of the buffer
+	while(end - p >= 4)
+	{
+		uint16_t code = ReadU16(p, swap);
+		uint16_t len = ReadU16(p + 2, swap);
+		p += 4;
+		if( (code == 0) || (len > end - p) )
+			break;
+
+		fn(code, p, len);
+
+		//Options are padded to a 32-bit boundary
+		size_t padded = (len + 3) & ~3;
+		if(padded > static_cast<size_t>(end - p))
+			break;
+		p += padded;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+PcapngFile::PcapngFile()
+	: m_isOpen(false)
+	, m_data(nullptr)
+	, m_size(0)
+#ifdef _WIN32
+	, m_file(INVALID_HANDLE_VALUE)
+	, m_mapping(nullptr)
+#else
+	, m_fd(-1)
+#endif
+	, m_scanOffset(0)
+{
+}
+
+PcapngFile::~PcapngFile()
+{
+	Close();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// File mapping
+
+/**
+	@brief Opens and indexes a file
+
+	@return True on success, false if the file could not be opened or is not a PcapNG file
+ */
+bool PcapngFile::Open(const string& fname)
+{
+	Close();
+	m_fname = fname;
+
+#ifdef _WIN32
+	m_file = CreateFileA(
+		fname.c_str(),
+		GENERIC_READ,
+		FILE_SHARE_READ | FILE_SHARE_WRITE,
+		nullptr,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL,
+		nullptr);
+	if(m_file == INVALID_HANDLE_VALUE)
+	{
+		LogError("Couldn't open PcapNG file \"%s\"\n", fname.c_str());
+		return false;
+	}
+#else
+	m_fd = open(fname.c_str(), O_RDONLY);
+	if(m_fd < 0)
+	{
+		LogError("Couldn't open PcapNG file \"%s\"\n", fname.c_str());
+		return false;
+	}
+#endif
+
+	m_isOpen = true;
+	if(!Rescan())
+	{
+		Close();
+		return false;
+	}
+
+	if(m_sections.empty())
+	{
+		LogError("\"%s\" does not start with a PcapNG section header\n", fname.c_str());
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+/**
+	@brief Closes the file and discards the index
+ */
+void PcapngFile::Close()
+{
+	Unmap();
+
+#ifdef _WIN32
+	if(m_file != INVALID_HANDLE_VALUE)
+		CloseHandle(m_file);
+	m_file = INVALID_HANDLE_VALUE;
+#else
+	if(m_fd >= 0)
+		close(m_fd);
+	m_fd = -1;
+#endif
+
+	m_isOpen = false;
+	m_scanOffset = 0;
+	m_blocks.clear();
+	m_sections.clear();
+	m_interfaces.clear();
+	m_packets.clear();
+}
+
+/**
+	@brief Maps the current contents of the file, replacing any existing (shorter) mapping
+ */
+bool PcapngFile::Map()
+{
+#ifdef _WIN32
+	LARGE_INTEGER size;
+	if(!GetFileSizeEx(m_file, &size))
+		return false;
+	uint64_t newsize = size.QuadPart;
+#else
+	struct stat st;
+	if(0 != fstat(m_fd, &st))
+		return false;
+	uint64_t newsize = st.st_size;
+#endif
+
+	//Nothing new, keep the existing mapping
+	if( (newsize == m_size) && ( (m_data != nullptr) || (newsize == 0) ) )
+		return true;
+
+	Unmap();
+	if(newsize == 0)
+		return true;
+
+#ifdef _WIN32
+	m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if(!m_mapping)
+	{
+		LogError("Failed to map PcapNG file \"%s\"\n", m_fname.c_str());
+		return false;
+	}
+	auto ptr = MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+	if(!ptr)
+	{
+		LogError("Failed to map PcapNG file \"%s\"\n", m_fname.c_str());
+		CloseHandle(m_mapping);
+		m_mapping = nullptr;
+		return false;
+	}
+#else
+	auto ptr = mmap(nullptr, newsize, PROT_READ, MAP_PRIVATE, m_fd, 0);
+	if(ptr == MAP_FAILED)
+	{
+		LogError("Failed to map PcapNG file \"%s\"\n", m_fname.c_str());
+		perror("mmap failed: ");
+		return false;
+	}
+
+	//Blocks are mostly touched front to back, so ask for aggressive readahead
+	madvise(ptr, newsize, MADV_SEQUENTIAL);
+#endif
+
+	m_data = reinterpret_cast<const uint8_t*>(ptr);
+	m_size = newsize;
+	return true;
+}
+
+void PcapngFile::Unmap()
+{
+	if(m_data)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(m_data);
+		CloseHandle(m_mapping);
+		m_mapping = nullptr;
+#else
+		munmap(const_cast<uint8_t*>(m_data), m_size);
+#endif
+	}
+
+	m_data = nullptr;
+	m_size = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Indexing
+
+/**
+	@brief Indexes any complete blocks which have been added to the file since the last scan
+
+	Any PacketView obtained before the call is invalidated, since the file may be remapped.
+
+	@return False if the file is corrupted or could not be mapped
+ */
+bool PcapngFile::Rescan()
+{
+	if(!m_isOpen)
+		return false;
+	if(!Map())
+		return false;
+
+	while(m_scanOffset + 12 <= m_size)
+	{
+		auto p = m_data + m_scanOffset;
+
+		//The SHB type is a palindrome, so we can recognize it before knowing the byte order
+		uint32_t type;
+		memcpy(&type, p, sizeof(type));
+		bool swap;
+		if(type == BLOCK_SHB)
+		{
+			if(m_scanOffset + 16 > m_size)
+				break;
+
+			uint32_t bom;
+			memcpy(&bom, p + 8, sizeof(bom));
+			if(bom == PCAPNG_BOM)
+				swap = false;
+			else if(bom == __builtin_bswap32(PCAPNG_BOM))
+				swap = true;
+			else
+			{
+				LogError("Invalid byte order magic %08x at offset %" PRIu64 "\n", bom, m_scanOffset);
+				return false;
+			}
+		}
+		else if(m_sections.empty())
+		{
+			LogError("Expected a PcapNG section header block, got block type %08x\n", type);
+			return false;
+		}
+		else
+		{
+			swap = m_sections.back().m_swap;
+			if(swap)
+				type = __builtin_bswap32(type);
+		}
+
+		uint32_t len = ReadU32(p + 4, swap);
+		if( (len < 12) || (len & 3) )
+		{
+			LogError("Invalid block length %u at offset %" PRIu64 "\n", len, m_scanOffset);
+			return false;
+		}
+
+		//Block is still being written, pick it up next time
+		if(m_scanOffset + len > m_size)
+			break;
+
+		if(ReadU32(p + len - 4, swap) != len)
+		{
+			LogError("Trailing block length mismatch at offset %" PRIu64 "\n", m_scanOffset);
+			return false;
+		}
+
+		auto body = p + 8;
+		auto end = p + len - 4;
+		if(type == BLOCK_SHB)
+		{
+			if(!ParseSHB(body, end, swap))
+				return false;
+		}
+
+		Block b;
+		b.m_offset = m_scanOffset;
+		b.m_type = type;
+		b.m_length = len;
+		b.m_section = m_sections.size() - 1;
+
+		switch(type)
+		{
+			case BLOCK_IDB:
+				if(!ParseIDB(body, end, swap))
+					return false;
+				break;
+
+			case BLOCK_PB:
+			case BLOCK_SPB:
+			case BLOCK_EPB:
+				m_packets.push_back(m_blocks.size());
+				break;
+
+			default:
+				break;
+		}
+
+		m_blocks.push_back(b);
+		m_scanOffset += len;
+	}
+
+	return true;
+}
+
+/**
+	@brief Starts a new section
+ */
+bool PcapngFile::ParseSHB(const uint8_t* body, const uint8_t* end, bool swap)
+{
+	if(end - body < 16)
+	{
+		LogError("Truncated section header block\n");
+		return false;
+	}
+
+	Section s;
+	s.m_offset = m_scanOffset;
+	s.m_swap = swap;
+	s.m_majorVersion = ReadU16(body + 4, swap);
+	s.m_minorVersion = ReadU16(body + 6, swap);
+	s.m_firstInterface = m_interfaces.size();
+	s.m_interfaceCount = 0;
+
+	LogTrace("Section %zu: PcapNG %d.%d, %s endian\n",
+		m_sections.size(), s.m_majorVersion, s.m_minorVersion, swap ? "big" : "little");
+	LogIndenter li;
+
+	if(s.m_majorVersion != 1)
+	{
+		LogError("Unsupported PcapNG major version %d\n", s.m_majorVersion);
+		return false;
+	}
+
+	//Skip BOM, versions, and section length
+	ForEachOption(body + 16, end, swap, [](uint16_t code, const uint8_t* data, uint16_t len)
+	{
+		string str(reinterpret_cast<const char*>(data), len);
+		switch(code)
+		{
+			case 2:
+				LogTrace("shb_hardware = %s\n", str.c_str());
+				break;
+
+			case 3:
+				LogTrace("shb_os = %s\n", str.c_str());
+				break;
+
+			case 4:
+				LogTrace("shb_userappl = %s\n", str.c_str());
+				break;
+
+			default:
+				break;
+		}
+	});
+
+	m_sections.push_back(s);
+	return true;
+}
+
+/**
+	@brief Adds an interface to the current section
+ */
+bool PcapngFile::ParseIDB(const uint8_t* body, const uint8_t* end, bool swap)
+{
+	if(end - body < 8)
+	{
+		LogError("Truncated interface description block\n");
+		return false;
+	}
+
+	Interface iface;
+	iface.m_linkType = ReadU16(body, swap);
+	iface.m_snapLen = ReadU32(body + 4, swap);
+	iface.m_tsresol = 6;
+	iface.m_tsoffset = 0;
+	iface.m_section = m_sections.size() - 1;
+
+	LogTrace("Interface %zu: link type %d, snap length %u\n", m_interfaces.size(), iface.m_linkType, iface.m_snapLen);
+	LogIndenter li;
+
+	ForEachOption(body + 8, end, swap, [&](uint16_t code, const uint8_t* data, uint16_t len)
+	{
+		switch(code)
+		{
+			//if_name
+			case 2:
+				iface.m_name.assign(reinterpret_cast<const char*>(data), len);
+				LogTrace("if_name = %s\n", iface.m_name.c_str());
+				break;
+
+			//if_description
+			case 3:
+				iface.m_description.assign(reinterpret_cast<const char*>(data), len);
+				LogTrace("if_description = %s\n", iface.m_description.c_str());
+				break;
+
+			//if_tsresol
+			case 9:
+				if(len >= 1)
+					iface.m_tsresol = data[0];
+				LogTrace("if_tsresol = %u\n", iface.m_tsresol);
+				break;
+
+			//if_tsoffset
+			case 14:
+				if(len >= 8)
+					iface.m_tsoffset = static_cast<int64_t>(ReadU64(data, swap));
+				LogTrace("if_tsoffset = %" PRId64 "\n", iface.m_tsoffset);
+				break;
+
+			default:
+				break;
+		}
+	});
+
+	//Reject resolutions we can't represent rather than producing garbage timestamps
+	if( !(iface.m_tsresol & 0x80) && (iface.m_tsresol > 19) )
+	{
+		LogError("Unsupported timestamp resolution 10^-%d\n", iface.m_tsresol);
+		return false;
+	}
+
+	m_sections.back().m_interfaceCount ++;
+	m_interfaces.push_back(iface);
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Packet access
+
+/**
+	@brief Gets a view of the i'th packet block in the file
+
+	Safe to call from multiple threads at once, as long as Rescan() is not running.
+
+	@return False if the block is malformed
+ */
+bool PcapngFile::GetPacket(size_t i, PacketView& view) const
+{
+	auto& b = m_blocks[m_packets[i]];
+	auto& section = m_sections[b.m_section];
+	bool swap = section.m_swap;
+
+	auto p = m_data + b.m_offset + 8;
+	auto end = m_data + b.m_offset + b.m_length - 4;
+
+	uint32_t localIface = 0;
+	switch(b.m_type)
+	{
+		case BLOCK_EPB:
+			if(end - p < 20)
+				return false;
+			localIface = ReadU32(p, swap);
+			view.m_hasTimestamp = true;
+			view.m_ticks = (static_cast<uint64_t>(ReadU32(p + 4, swap)) << 32) | ReadU32(p + 8, swap);
+			view.m_capturedLength = ReadU32(p + 12, swap);
+			view.m_originalLength = ReadU32(p + 16, swap);
+			view.m_data = p + 20;
+			break;
+
+		case BLOCK_PB:
+			if(end - p < 20)
+				return false;
+			localIface = ReadU16(p, swap);
+			view.m_hasTimestamp = true;
+			view.m_ticks = (static_cast<uint64_t>(ReadU32(p + 4, swap)) << 32) | ReadU32(p + 8, swap);
+			view.m_capturedLength = ReadU32(p + 12, swap);
+			view.m_originalLength = ReadU32(p + 16, swap);
+			view.m_data = p + 20;
+			break;
+
+		//Simple packet blocks have no timestamp and no captured length, the body fills the rest of the block
+		case BLOCK_SPB:
+			if(end - p < 4)
+				return false;
+			view.m_hasTimestamp = false;
+			view.m_ticks = 0;
+			view.m_originalLength = ReadU32(p, swap);
+			view.m_data = p + 4;
+			view.m_capturedLength = min(view.m_originalLength, static_cast<uint32_t>(end - view.m_data));
+			break;
+
+		default:
+			return false;
+	}
+
+	if(localIface >= section.m_interfaceCount)
+		return false;
+	if(view.m_capturedLength > static_cast<size_t>(end - view.m_data))
+		return false;
+
+	view.m_interface = section.m_firstInterface + localIface;
+	return true;
+}
+
+/**
+	@brief Converts a timestamp in interface ticks to seconds and femtoseconds since the epoch
+ */
+void PcapngFile::Interface::TicksToTime(uint64_t ticks, time_t& sec, int64_t& fs) const
+{
+	uint8_t exp = m_tsresol & 0x7f;
+
+	//Negative power of two. Scale the fractional part in 128-bit math so the result is exactly rounded
+	if(m_tsresol & 0x80)
+	{
+		if(exp == 0)
+		{
+			sec = ticks;
+			fs = 0;
+		}
+		else
+		{
+			unsigned __int128 frac = ticks;
+			if(exp < 64)
+			{
+				sec = ticks >> exp;
+				frac &= (1ULL << exp) - 1;
+			}
+			else
+				sec = 0;
+
+			unsigned __int128 one = 1;
+			fs = ( (frac * g_pow10[15]) + (one << (exp - 1)) ) >> exp;
+		}
+	}
+
+	//Negative power of ten
+	else
+	{
+		uint64_t rem = ticks % g_pow10[exp];
+		sec = ticks / g_pow10[exp];
+		if(exp <= 15)
+			fs = rem * g_pow10[15 - exp];
+		else
+			fs = rem / g_pow10[exp - 15];
+	}
+
+	sec += m_tsoffset;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// PcapngWriter
+
+PcapngWriter::PcapngWriter(size_t bufferSize)
+	: m_fp(nullptr)
+	, m_bufferSize(bufferSize)
+	, m_sectionBytes(0)
+	, m_sectionHeaderBytes(0)
+	, m_maxSectionSize(0)
+{
+	m_buffer.reserve(m_bufferSize);
+}
+
+/**
+	@brief Declares an interface. Interfaces added after BeginSection() take effect at the next section.
+
+	@param linkType	LINKTYPE_* value
+	@param name		Interface name (if_name)
+	@param tsresol	Timestamp resolution as a negative power of ten, at most 15 (fs)
+
+	@return Interface ID to pass to WritePacket()
+ */
+size_t PcapngWriter::AddInterface(uint16_t linkType, const string& name, uint8_t tsresol)
+{
+	Interface iface;
+	iface.m_linkType = linkType;
+	iface.m_tsresol = min(tsresol, (uint8_t)15);
+	iface.m_name = name;
+	m_interfaces.push_back(iface);
+	return m_interfaces.size() - 1;
+}
+
+/**
+	@brief Starts writing to a file, beginning with a fresh section header
+
+	Any data buffered for a previous file is discarded, so Flush() that first.
+ */
+void PcapngWriter::BeginSection(FILE* fp)
+{
+	m_fp = fp;
+	m_buffer.clear();
+	WriteSectionHeader();
+}
+
+/**
+	@brief Appends raw bytes to a block being assembled
+ */
+static void AppendBytes(vector<uint8_t>& block, const void* data, size_t len)
+{
+	auto p = reinterpret_cast<const uint8_t*>(data);
+	block.insert(block.end(), p, p + len);
+}
+
+/**
+	@brief Appends a single option (padded to 32 bits) to a block being assembled
+ */
+static void AppendOption(vector<uint8_t>& block, uint16_t code, const void* data, uint16_t len)
+{
+	AppendBytes(block, &code, sizeof(code));
+	AppendBytes(block, &len, sizeof(len));
+	AppendBytes(block, data, len);
+	block.resize(block.size() + ((len + 3) & ~3) - len, 0);
+}
+
+/**
+	@brief Appends a SHB and one IDB per interface to the buffer
+ */
+void PcapngWriter::WriteSectionHeader()
+{
+	vector<uint8_t> hdr;
+
+	//Section header block, no options.
+	//Section length is unspecified since we append live as data comes in and don't know it a priori
+	uint32_t blocktype = PcapngFile::BLOCK_SHB;
+	uint32_t shblen = 28;
+	uint16_t major = 1;
+	uint16_t minor = 0;
+	int64_t seclen = -1;
+	AppendBytes(hdr, &blocktype, sizeof(blocktype));
+	AppendBytes(hdr, &shblen, sizeof(shblen));
+	AppendBytes(hdr, &PCAPNG_BOM, sizeof(PCAPNG_BOM));
+	AppendBytes(hdr, &major, sizeof(major));
+	AppendBytes(hdr, &minor, sizeof(minor));
+	AppendBytes(hdr, &seclen, sizeof(seclen));
+	AppendBytes(hdr, &shblen, sizeof(shblen));
+
+	//Interface description blocks
+	for(auto& iface : m_interfaces)
+	{
+		auto blockstart = hdr.size();
+
+		blocktype = PcapngFile::BLOCK_IDB;
+		uint32_t idblen = 0;
+		uint16_t reserved = 0;
+		uint32_t snaplen = 0;
+		AppendBytes(hdr, &blocktype, sizeof(blocktype));
+		AppendBytes(hdr, &idblen, sizeof(idblen));
+		AppendBytes(hdr, &iface.m_linkType, sizeof(iface.m_linkType));
+		AppendBytes(hdr, &reserved, sizeof(reserved));
+		AppendBytes(hdr, &snaplen, sizeof(snaplen));
+
+		AppendOption(hdr, 2, iface.m_name.c_str(), iface.m_name.length());
+		AppendOption(hdr, 9, &iface.m_tsresol, 1);
+		AppendOption(hdr, 0, nullptr, 0);
+
+		//Patch the length now that we know it
+		idblen = hdr.size() - blockstart + 4;
+		memcpy(&hdr[blockstart + 4], &idblen, sizeof(idblen));
+		AppendBytes(hdr, &idblen, sizeof(idblen));
+	}
+
+	Append(&hdr[0], hdr.size());
+	m_sectionHeaderBytes = hdr.size();
+	m_sectionBytes = m_sectionHeaderBytes;
+}
+
+/**
+	@brief Appends an enhanced packet block
+
+	@param iface	Interface ID from AddInterface()
+	@param sec		Timestamp (seconds since the epoch)
+	@param fs		Timestamp (femtoseconds past sec)
+	@param data		Packet contents
+	@param len		Length of the packet
+ */
+void PcapngWriter::WritePacket(size_t iface, time_t sec, int64_t fs, const uint8_t* data, size_t len)
+{
+	uint32_t paddedlen = (len + 3) & ~3;
+	uint32_t blocklen = 32 + paddedlen;
+
+	//Start a new section if this packet would push us past the limit
+	//(but never start a section that has no packets in it)
+	if( (m_maxSectionSize != 0) &&
+		(m_sectionBytes + blocklen > m_maxSectionSize) &&
+		(m_sectionBytes > m_sectionHeaderBytes) )
+	{
+		WriteSectionHeader();
+	}
+
+	//Canonicalize the timestamp to a single 64-bit quantity in the interface's resolution
+	auto exp = m_interfaces[iface].m_tsresol;
+	sec += fs / static_cast<int64_t>(g_pow10[15]);
+	fs %= static_cast<int64_t>(g_pow10[15]);
+	uint64_t ticks = sec * g_pow10[exp] + fs / g_pow10[15 - exp];
+
+	//Serialize the whole block in place
+	uint32_t header[7] =
+	{
+		PcapngFile::BLOCK_EPB,
+		blocklen,
+		static_cast<uint32_t>(iface),
+		static_cast<uint32_t>(ticks >> 32),
+		static_cast<uint32_t>(ticks & 0xffffffff),
+		static_cast<uint32_t>(len),
+		static_cast<uint32_t>(len)
+	};
+	Append(header, sizeof(header));
+	Append(data, len);
+
+	//Pad to a 32-bit boundary, then the trailing length (no options)
+	uint8_t trailer[8] = {0};
+	memcpy(trailer + (paddedlen - len), &blocklen, sizeof(blocklen));
+	Append(trailer, (paddedlen - len) + sizeof(blocklen));
+
+	m_sectionBytes += blocklen;
+}
+
+/**
+	@brief Appends bytes to the buffer, writing it out first if it's full
+ */
+void PcapngWriter::Append(const void* data, size_t len)
+{
+	if(len == 0)
+		return;
+
+	if( (m_buffer.size() + len > m_bufferSize) && !m_buffer.empty() )
+		WriteBuffer();
+
+	auto p = reinterpret_cast<const uint8_t*>(data);
+	m_buffer.insert(m_buffer.end(), p, p + len);
+}
+
+/**
+	@brief Writes out the buffer without flushing the stdio stream
+ */
+bool PcapngWriter::WriteBuffer()
+{
+	if(m_buffer.empty() || !m_fp)
+		return true;
+
+	bool ok = (m_buffer.size() == fwrite(&m_buffer[0], 1, m_buffer.size(), m_fp));
+	if(!ok)
+		LogError("file write failure\n");
+	m_buffer.clear();
+	return ok;
+}
+
+/**
+	@brief Writes all buffered blocks to the file and flushes it
+ */
+bool PcapngWriter::Flush()
+{
+	bool ok = WriteBuffer();
+	if(m_fp)
+		fflush(m_fp);
+	return ok;
+}
@@ -0,0 +1,253 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of PcapngFile and PcapngWriter
+ */
+#ifndef PcapngFile_h
+#define PcapngFile_h
+
+/**
+	@brief Zero-copy reader for PcapNG capture files
+
+	The file is memory mapped and walked once to build an index of every block. Packet blocks are then accessed
+	in place through PacketView, so decoders never copy packet bodies and can look at any packet by index (including
+	from several threads at once).
+
+	Multiple sections (in either byte order) and multiple interfaces per section are supported. Interface IDs in
+	packet blocks are section-relative; PacketView::m_interface is translated to a global index into the interface
+	table.
+
+	Rescan() picks up blocks appended to the file since the last scan (e.g. a capture still being written by
+	dumpcap) without re-reading anything already indexed. A trailing partial block is left for the next scan.
+ */
+class PcapngFile
+{
+public:
+	PcapngFile();
+	~PcapngFile();
+
+	PcapngFile(const PcapngFile&) =delete;
+	PcapngFile& operator=(const PcapngFile&) =delete;
+
+	bool Open(const std::string& fname);
+	void Close();
+	bool Rescan();
+
+	///@brief Block type codes
+	enum BlockType : uint32_t
+	{
+		BLOCK_IDB		= 0x00000001,	//Interface Description Block
+		BLOCK_PB		= 0x00000002,	//Packet Block (obsolete)
+		BLOCK_SPB		= 0x00000003,	//Simple Packet Block
+		BLOCK_NRB		= 0x00000004,	//Name Resolution Block
+		BLOCK_ISB		= 0x00000005,	//Interface Statistics Block
+		BLOCK_EPB		= 0x00000006,	//Enhanced Packet Block
+		BLOCK_SHB		= 0x0a0d0d0a	//Section Header Block
+	};
+
+	///@brief Location of a single block within the file
+	struct Block
+	{
+		uint64_t m_offset;
+		uint32_t m_type;
+		uint32_t m_length;
+		uint32_t m_section;
+	};
+
+	///@brief A section (SHB and everything up to the next SHB)
+	struct Section
+	{
+		uint64_t m_offset;
+		bool m_swap;
+		uint16_t m_majorVersion;
+		uint16_t m_minorVersion;
+		size_t m_firstInterface;
+		size_t m_interfaceCount;
+	};
+
+	///@brief A capture interface, as described by an IDB
+	class Interface
+	{
+	public:
+		void TicksToTime(uint64_t ticks, time_t& sec, int64_t& fs) const;
+
+		///@brief Link type (LINKTYPE_* value)
+		uint16_t m_linkType;
+
+		///@brief Maximum captured length of a packet, or zero for unlimited
+		uint32_t m_snapLen;
+
+		///@brief Timestamp resolution as stored in if_tsresol (MSB set for negative powers of two)
+		uint8_t m_tsresol;
+
+		///@brief Offset in seconds added to every timestamp (if_tsoffset)
+		int64_t m_tsoffset;
+
+		///@brief Section the interface belongs to
+		size_t m_section;
+
+		std::string m_name;
+		std::string m_description;
+	};
+
+	/**
+		@brief View of a single packet in the mapped file
+
+		m_data points into the mapping and is only valid until the next Rescan() or Close().
+	 */
+	struct PacketView
+	{
+		size_t m_interface;
+		bool m_hasTimestamp;
+		uint64_t m_ticks;
+		const uint8_t* m_data;
+		uint32_t m_capturedLength;
+		uint32_t m_originalLength;
+	};
+
+	bool GetPacket(size_t i, PacketView& view) const;
+
+	///@brief Number of packet blocks (EPB, SPB or PB) indexed so far
+	size_t GetPacketCount() const
+	{ return m_packets.size(); }
+
+	const std::vector<Block>& GetBlocks() const
+	{ return m_blocks; }
+
+	const std::vector<Section>& GetSections() const
+	{ return m_sections; }
+
+	const std::vector<Interface>& GetInterfaces() const
+	{ return m_interfaces; }
+
+	bool IsOpen() const
+	{ return m_isOpen; }
+
+	uint64_t GetFileSize() const
+	{ return m_size; }
+
+protected:
+	bool Map();
+	void Unmap();
+
+	bool ParseSHB(const uint8_t* body, const uint8_t* end, bool swap);
+	bool ParseIDB(const uint8_t* body, const uint8_t* end, bool swap);
+
+	///@brief Path of the open file
+	std::string m_fname;
+
+	///@brief True if a file is open (even if it's currently empty)
+	bool m_isOpen;
+
+	///@brief Start of the mapping
+	const uint8_t* m_data;
+
+	///@brief Number of bytes mapped
+	uint64_t m_size;
+
+#ifdef _WIN32
+	HANDLE m_file;
+	HANDLE m_mapping;
+#else
+	int m_fd;
+#endif
+
+	///@brief Offset of the first block not yet indexed
+	uint64_t m_scanOffset;
+
+	std::vector<Block> m_blocks;
+	std::vector<Section> m_sections;
+	std::vector<Interface> m_interfaces;
+
+	///@brief Indexes (into m_blocks) of every packet block
+	std::vector<size_t> m_packets;
+};
+
+/**
+	@brief Buffered PcapNG writer
+
+	Blocks are serialized into an in-memory buffer and written out with one fwrite() whenever the buffer fills up,
+	and on Flush(). The caller owns the FILE* and must Flush() before closing it.
+
+	If a maximum section size is set, a new SHB (followed by all IDBs again) is started once the current section
+	would grow past it. This keeps very long captures readable by tools which load a whole section at a time.
+ */
+class PcapngWriter
+{
+public:
+	PcapngWriter(size_t bufferSize = 4 * 1024 * 1024);
+
+	size_t AddInterface(uint16_t linkType, const std::string& name, uint8_t tsresol = 9);
+
+	///@brief Sets the section size (in bytes) above which a new section is started, or zero for no limit
+	void SetMaxSectionSize(uint64_t bytes)
+	{ m_maxSectionSize = bytes; }
+
+	void BeginSection(FILE* fp);
+	void WritePacket(size_t iface, time_t sec, int64_t fs, const uint8_t* data, size_t len);
+	bool Flush();
+
+protected:
+	void Append(const void* data, size_t len);
+	void WriteSectionHeader();
+	bool WriteBuffer();
+
+	///@brief A capture interface, re-announced at the start of every section
+	struct Interface
+	{
+		uint16_t m_linkType;
+		uint8_t m_tsresol;
+		std::string m_name;
+	};
+
+	std::vector<Interface> m_interfaces;
+
+	///@brief File being written (not owned)
+	FILE* m_fp;
+
+	///@brief Serialized blocks not yet written to m_fp
+	std::vector<uint8_t> m_buffer;
+
+	///@brief Size at which m_buffer is written out
+	size_t m_bufferSize;
+
+	///@brief Bytes in the current section so far, including buffered data
+	uint64_t m_sectionBytes;
+
+	///@brief Bytes of SHB + IDB at the start of the current section
+	uint64_t m_sectionHeaderBytes;
+
+	uint64_t m_maxSectionSize;
+};
+
+#endif
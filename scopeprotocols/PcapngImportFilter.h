@@ -35,6 +35,8 @@
 #ifndef PcapngImportFilter_h
 #define PcapngImportFilter_h
 
+#include "PcapngFile.h"
+
 class PcapngImportFilter : public PacketDecoder
 {
 public:
@@ -55,13 +57,27 @@ protected:
 
 	void OnFileNameChanged();
 
-	bool ValidateSHB(FILE* fp);
-	bool ReadIDB(FILE* fp);
-	std::string ReadFixedLengthString(uint16_t len, FILE* fp);
+	void LoadPackets();
+
+	///@brief A CAN frame extracted from a packet block, before it's placed on the timeline
+	struct CANFrame
+	{
+		bool m_valid;
+		bool m_hasTimestamp;
+		time_t m_sec;
+		int64_t m_fs;
+		size_t m_interface;
+		uint32_t m_id;
+		uint8_t m_len;
+		bool m_ext;
+		bool m_rtr;
+		bool m_err;
+		bool m_fd;
+		uint8_t m_data[8];
+	};
 
-	bool LoadLinuxCooked(FILE* fp);
-	bool LoadCANLinuxCooked(FILE* fp);
-	bool LoadSocketCAN(FILE* fp);
+	bool ParseSocketCAN(const PcapngFile::PacketView& view, CANFrame& frame);
+	bool ParseCANLinuxCooked(const PcapngFile::PacketView& view, CANFrame& frame);
 
 	enum LinkType
 	{
@@ -71,9 +87,30 @@ protected:
 		LINK_TYPE_LINUX_COOKED,
 		LINK_TYPE_SOCKETCAN,
 		LINK_TYPE_UNKNOWN
-	} m_linkType;
+	};
+
+	static LinkType GetLinkType(uint16_t linktype);
+
+	///@brief The memory mapped input file
+	PcapngFile m_file;
+
+	///@brief Index of the first packet block which has not yet been decoded
+	size_t m_nextPacket;
+
+	///@brief Number of interfaces we've already reported the link type of
+	size_t m_interfacesSeen;
+
+	///@brief Absolute time of the first packet (all offsets are relative to this)
+	bool m_haveBaseTimestamp;
+	time_t m_baseSec;
+	int64_t m_baseFs;
+
+	///@brief End of the most recently decoded frame, used to fix up timestamp jitter
+	int64_t m_lastFrameEnd;
 
-	int64_t m_timestampScale;
+	///@brief Timestamp of the most recent packet block (used for blocks without one)
+	time_t m_lastSec;
+	int64_t m_lastFs;
 };
 
 #endif
@@ -38,12 +38,24 @@ using namespace std;
 RISFilter::RISFilter(const string& color)
 	: Filter(color, CAT_MATH)
 	, m_upsampleFactor(m_parameters["Upsample Factor"])
+	, m_minTriggers(m_parameters["Min Triggers"])
+	, m_triggerCount(0)
+	, m_origin(0)
+	, m_binSize(0)
+	, m_cachedTimescale(0)
+	, m_cachedLength(0)
+	, m_cachedUpsampleFactor(0)
+	, m_lastInputID(0)
+	, m_lastInputRevision(0)
 {
 	AddStream(Unit(Unit::UNIT_VOLTS), "data", Stream::STREAM_TYPE_ANALOG);
 	CreateInput("din");
 
 	m_upsampleFactor = FilterParameter(FilterParameter::TYPE_INT, Unit(Unit::UNIT_COUNTS));
 	m_upsampleFactor.SetIntVal(16);
+
+	m_minTriggers = FilterParameter(FilterParameter::TYPE_INT, Unit(Unit::UNIT_COUNTS));
+	m_minTriggers.SetIntVal(64);
 }
 
 RISFilter::~RISFilter()
@@ -80,28 +92,43 @@ string RISFilter::GetProtocolName()
 
 void RISFilter::ClearSweeps()
 {
+	Reset();
 	SetData(nullptr, 0);
 }
 
+/**
+	@brief Discards all accumulated triggers
+ */
+void RISFilter::Reset()
+{
+	m_sum.clear();
+	m_count.clear();
+	m_triggerCount = 0;
+	m_cachedTimescale = 0;
+	m_cachedLength = 0;
+	m_cachedUpsampleFactor = 0;
+	m_lastInputID = 0;
+	m_lastInputRevision = 0;
+}
+
 void RISFilter::Refresh(vk::raii::CommandBuffer& /*cmdBuf*/, shared_ptr<QueueHandle> /*queue*/)
 {
-	/*
 	//Make sure we've got valid inputs
-	if(!VerifyAllInputsOK())
+	if(!VerifyAllInputsOKAndUniformAnalog())
 	{
 		SetData(nullptr, 0);
 		return;
 	}
 
-	//Get inputs
-	auto din = GetInputWaveform(0);
-	auto sdin = dynamic_cast<SparseAnalogWaveform*>(din);
-	auto udin = dynamic_cast<UniformAnalogWaveform*>(din);
+	auto din = dynamic_cast<UniformAnalogWaveform*>(GetInputWaveform(0));
 	size_t len = din->size();
-
-	//Convert half life to decay coefficient
-	float hl = m_parameters[m_halflife].GetIntVal();
-	float decay = 1 / pow(2, 1/hl);
+	int64_t factor = max(m_upsampleFactor.GetIntVal(), (int64_t)1);
+	int64_t timescale = din->m_timescale;
+	if( (len < 2) || (timescale < factor) )
+	{
+		SetData(nullptr, 0);
+		return;
+	}
 
 	din->PrepareForCpuAccess();
 
@@ -109,75 +136,123 @@ void RISFilter::Refresh(vk::raii::CommandBuffer& /*cmdBuf*/, shared_ptr<QueueHan
 	m_xAxisUnit = m_inputs[0].m_channel->GetXAxisUnits();
 	SetYAxisUnits(m_inputs[0].GetYAxisUnits(), 0);
 
-	//See if we already had valid output data
-	auto cap = GetData(0);
-	auto scap = dynamic_cast<SparseAnalogWaveform*>(cap);
-	auto ucap = dynamic_cast<UniformAnalogWaveform*>(cap);
-	if(cap)
-		cap->PrepareForCpuAccess();
+	//Start over if the acquisition setup changed
+	if( (timescale != m_cachedTimescale) || (len != m_cachedLength) || (factor != m_cachedUpsampleFactor) )
+	{
+		Reset();
+
+		m_cachedTimescale = timescale;
+		m_cachedLength = len;
+		m_cachedUpsampleFactor = factor;
+		m_binSize = timescale / factor;
+
+		//Trigger phases normally lie within one sample of each other, leave a sample of margin on each side
+		int64_t phase = din->m_triggerPhase;
+		int64_t base = (phase >= 0) ? (phase / timescale) : -((-phase + timescale - 1) / timescale);
+		m_origin = (base - 1) * timescale;
+
+		size_t nbins = (len + 2) * factor;
+		m_sum.assign(nbins, 0);
+		m_count.assign(nbins, 0);
+	}
 
-	//Sparse path
-	if(sdin)
+	//Bin the new samples. Input samples are at least one bin apart, so every sample lands in a different bin and
+	//the loop has no write conflicts.
+	//If we're being refreshed for some other reason (e.g. a parameter change) and the input is the same trigger we
+	//already accumulated, don't count it again.
+	int64_t binsize = m_binSize;
+	int64_t nbins = m_sum.size();
+	float* sum = &m_sum[0];
+	uint32_t* count = &m_count[0];
+	if( (din->m_instanceID != m_lastInputID) || (din->m_revision != m_lastInputRevision) )
 	{
-		//No data? Just copy
-		if(!scap)
+		int64_t start = din->m_triggerPhase - m_origin + binsize/2;
+		const float* samples = din->m_samples.GetCpuPointer();
+
+		ThreadPool::GetDefault().ParallelFor(0, len, [&](size_t i)
 		{
-			scap = new SparseAnalogWaveform;
-			scap->Resize(din->size());
-			cap = scap;
+			int64_t t = start + (int64_t)i*timescale;
+			if(t < 0)
+				return;
+			int64_t bin = t / binsize;
+			if(bin >= nbins)
+				return;
+			sum[bin] += samples[i];
+			count[bin] ++;
+		}, len > 100000);
+		m_triggerCount ++;
+
+		m_lastInputID = din->m_instanceID;
+		m_lastInputRevision = din->m_revision;
+	}
 
-			scap->m_samples.CopyFrom(sdin->m_samples);
-		}
+	//Until we have enough triggers, only output the bins we have data for
+	if(m_triggerCount < (size_t)m_minTriggers.GetIntVal())
+	{
+		auto cap = SetupEmptySparseAnalogOutputWaveform(din, 0);
+		cap->m_timescale = binsize;
+		cap->m_triggerPhase = m_origin;
+		cap->PrepareForCpuAccess();
 
-		//Actual filter code path
-		else
+		for(int64_t i=0; i<nbins; i++)
 		{
-			auto pin = sdin->m_samples.GetCpuPointer();
-			auto pout = scap->m_samples.GetCpuPointer();
-
-			for(size_t i=0; i<len; i++)
-				pout[i] = pout[i]*decay + pin[i]*(1-decay);
+			if(!count[i])
+				continue;
+			cap->m_offsets.push_back(i);
+			cap->m_durations.push_back(1);
+			cap->m_samples.push_back(sum[i] / count[i]);
 		}
 
-		//Either way we want to reuse the timestamps
-		scap->CopyTimestamps(sdin);
+		//Extend each sample to the start of the next
+		size_t n = cap->m_offsets.size();
+		for(size_t i=0; i+1<n; i++)
+			cap->m_durations[i] = cap->m_offsets[i+1] - cap->m_offsets[i];
+
+		cap->MarkModifiedFromCpu();
+		return;
 	}
 
-	//Uniform path
-	else
+	//Find the span of populated bins (the margins are normally only partly covered)
+	int64_t first = 0;
+	while( (first < nbins) && !count[first] )
+		first ++;
+	int64_t last = nbins - 1;
+	while( (last > first) && !count[last] )
+		last --;
+	size_t outlen = last - first + 1;
+
+	auto cap = SetupEmptyUniformAnalogOutputWaveform(din, 0);
+	cap->m_timescale = binsize;
+	cap->m_triggerPhase = m_origin + first*binsize;
+	cap->Resize(outlen);
+	cap->PrepareForCpuAccess();
+	float* out = cap->m_samples.GetCpuPointer();
+
+	//Average each bin
+	ThreadPool::GetDefault().ParallelFor(0, outlen, [&](size_t i)
 	{
-		//No data? Just copy
-		if(!ucap)
-		{
-			ucap = new UniformAnalogWaveform;
-			ucap->Resize(din->size());
-			cap = ucap;
+		uint32_t n = count[first + i];
+		out[i] = n ? (sum[first + i] / n) : NAN;
+	}, outlen > 100000);
 
-			ucap->m_samples.CopyFrom(udin->m_samples);
-		}
+	//Linearly interpolate across any remaining gaps
+	size_t prev = 0;
+	for(size_t i=1; i<outlen; i++)
+	{
+		if(!count[first + i])
+			continue;
 
-		//Actual filter code path
-		else
+		if(i - prev > 1)
 		{
-			auto pin = udin->m_samples.GetCpuPointer();
-			auto pout = ucap->m_samples.GetCpuPointer();
-
-			for(size_t i=0; i<len; i++)
-				pout[i] = pout[i]*decay + pin[i]*(1-decay);
+			float a = out[prev];
+			float dv = (out[i] - a) / (i - prev);
+			for(size_t j=prev+1; j<i; j++)
+				out[j] = a + dv*(j - prev);
 		}
+		prev = i;
 	}
 
-	//Update timestamps
-	cap->m_startTimestamp 		= din->m_startTimestamp;
-	cap->m_startFemtoseconds	= din->m_startFemtoseconds;
-	cap->m_triggerPhase			= din->m_triggerPhase;
-	cap->m_timescale			= din->m_timescale;
-	cap->m_revision ++;
-
-	//Done
-	SetData(cap, 0);
 	cap->MarkModifiedFromCpu();
-	*/
 }
 
 Filter::DataLocation RISFilter::GetInputLocation()
@@ -37,6 +37,14 @@
 
 class QueueHandle;
 
+/**
+	@brief Random interleaved sampling (equivalent-time sampling) of a repetitive signal
+
+	Each trigger's samples are placed onto a grid Upsample Factor times finer than the input, according to the
+	trigger phase reported by the instrument. Samples landing in the same bin are averaged. Once enough triggers have
+	been accumulated, empty bins are filled by linear interpolation and a uniform waveform is output; until then the
+	output is a sparse waveform containing only the bins which have been hit.
+ */
 class RISFilter : public Filter
 {
 public:
@@ -54,8 +62,45 @@ public:
 
 	PROTOCOL_DECODER_INITPROC(RISFilter)
 
+	///@brief Returns the number of triggers accumulated since the last reset
+	size_t GetTriggerCount()
+	{ return m_triggerCount; }
+
 protected:
+	void Reset();
+
 	FilterParameter& m_upsampleFactor;
+	FilterParameter& m_minTriggers;
+
+	///@brief Sum of all samples landing in each bin of the fine grid
+	std::vector<float, AlignedAllocator<float, 64> > m_sum;
+
+	///@brief Number of samples landing in each bin of the fine grid
+	std::vector<uint32_t, AlignedAllocator<uint32_t, 64> > m_count;
+
+	///@brief Number of triggers accumulated
+	size_t m_triggerCount;
+
+	///@brief Timestamp (relative to the trigger) of bin 0 of the fine grid, in fs
+	int64_t m_origin;
+
+	///@brief Bin size of the fine grid, in fs
+	int64_t m_binSize;
+
+	///@brief Input timescale the accumulators were configured for
+	int64_t m_cachedTimescale;
+
+	///@brief Input length the accumulators were configured for
+	size_t m_cachedLength;
+
+	///@brief Upsample factor the accumulators were configured for
+	int64_t m_cachedUpsampleFactor;
+
+	///@brief Instance ID of the last input waveform accumulated
+	uint64_t m_lastInputID;
+
+	///@brief Revision of the last input waveform accumulated
+	uint64_t m_lastInputRevision;
 };
 
 #endif
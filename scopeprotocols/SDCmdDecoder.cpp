@@ -149,7 +149,7 @@ void SDCmdDecoder::Refresh()
 					if(pack)
 					{
 						pack->m_data.clear();
-						pack->m_headers.clear();
+						pack->ClearHeaders();
 					}
 					else
 						pack = new Packet;
@@ -1300,15 +1300,15 @@ vector<string> SDCmdDecoder::GetHeaders()
 
 bool SDCmdDecoder::CanMerge(Packet* first, Packet* cur, Packet* next)
 {
-	auto& firstcode = first->m_headers["Code"];
-	auto& curcode = cur->m_headers["Code"];
-	auto& nextcode = next->m_headers["Code"];
-	auto& firstinfo = first->m_headers["Info"];
-	//auto& curinfo = cur->m_headers["Info"];
-	auto& nextinfo = next->m_headers["Info"];
-	bool curcmd = cur->m_headers["Type"] == "Command";
+	auto firstcode = first->GetHeader("Code");
+	auto curcode = cur->GetHeader("Code");
+	auto nextcode = next->GetHeader("Code");
+	auto firstinfo = first->GetHeader("Info");
+	//auto curinfo = cur->GetHeader("Info");
+	auto nextinfo = next->GetHeader("Info");
+	bool curcmd = cur->GetHeader("Type") == "Command";
 	bool curreply = !curcmd;
-	bool nextcmd = next->m_headers["Type"] == "Command";
+	bool nextcmd = next->GetHeader("Type") == "Command";
 	bool nextreply = !nextcmd;
 
 	//Merge reply with the preceding command
@@ -1349,47 +1349,47 @@ bool SDCmdDecoder::CanMerge(Packet* first, Packet* cur, Packet* next)
 
 Packet* SDCmdDecoder::CreateMergedHeader(Packet* pack, size_t i)
 {
-	if(pack->m_headers["Type"] == "Command")
+	if(pack->GetHeader("Type") == "Command")
 	{
 		Packet* ret = new Packet;
 		ret->m_offset = pack->m_offset;
 		ret->m_len = pack->m_len;
 
 		//Default to copying everything
-		auto code = pack->m_headers["Code"];
+		auto code = pack->GetHeader("Code");
 		ret->m_headers["Type"] = "Command";
 		ret->m_headers["Code"] = code;
-		ret->m_headers["Command"] = pack->m_headers["Command"];
+		ret->m_headers["Command"] = pack->GetHeader("Command");
 		ret->m_displayBackgroundColor = pack->m_displayBackgroundColor;
-		ret->m_headers["Info"] = pack->m_headers["Info"];
+		ret->m_headers["Info"] = pack->GetHeader("Info");
 
 		//If the header is a CMD55 packet, check the actual ACMD and use that instead
 		if( (code== "CMD55") && (i+2 < m_packets.size()) )
 		{
 			Packet* next = m_packets[i+2];
 
-			ret->m_headers["Command"] = next->m_headers["Command"];
-			ret->m_headers["Code"] = next->m_headers["Code"];
+			ret->m_headers["Command"] = next->GetHeader("Command");
+			ret->m_headers["Code"] = next->GetHeader("Code");
 			ret->m_displayBackgroundColor = next->m_displayBackgroundColor;
-			ret->m_headers["Info"] = next->m_headers["Info"];
+			ret->m_headers["Info"] = next->GetHeader("Info");
 
 			//Summarize ACMD41 with reply data
-			if(next->m_headers["Code"] == "ACMD41")
+			if(next->GetHeader("Code") == "ACMD41")
 			{
 				//Keep on looking at replies until we see the final ACMD41
 				size_t last = i+2;
 				for(size_t j=i; j<m_packets.size(); j++)
 				{
-					if(m_packets[j]->m_headers["Type"] != "Reply")
+					if(m_packets[j]->GetHeader("Type") != "Reply")
 						continue;
-					else if(m_packets[j]->m_headers["Code"] == "CMD55")
+					else if(m_packets[j]->GetHeader("Code") == "CMD55")
 						continue;
-					else if(m_packets[j]->m_headers["Code"] == "ACMD41")
+					else if(m_packets[j]->GetHeader("Code") == "ACMD41")
 						last = j;
 					else
 						break;
 				}
-				ret->m_headers["Info"] += string(", got ") + m_packets[last]->m_headers["Info"];
+				ret->m_headers["Info"] += string(", got ") + m_packets[last]->GetHeader("Info");
 			}
 		}
 
@@ -1404,11 +1404,11 @@ Packet* SDCmdDecoder::CreateMergedHeader(Packet* pack, size_t i)
 		{
 			for(; i < m_packets.size(); i++)
 			{
-				if(m_packets[i]->m_headers["Code"] != code)
+				if(m_packets[i]->GetHeader("Code") != code)
 					break;
-				if(m_packets[i]->m_headers["Type"] != "Reply")
+				if(m_packets[i]->GetHeader("Type") != "Reply")
 					continue;
-				ret->m_headers["Info"] = m_packets[i]->m_headers["Info"];
+				ret->m_headers["Info"] = m_packets[i]->GetHeader("Info");
 			}
 		}
 
@@ -178,6 +178,7 @@ void SDDataDecoder::Refresh()
 						pack->m_offset = d0.m_offsets[i];
 						pack->m_len = 0;
 						pack->m_headers = cmd_packet->m_headers;
+						pack->m_typedHeaders = cmd_packet->m_typedHeaders;
 						pack->m_displayForegroundColor = cmd_packet->m_displayForegroundColor;
 						pack->m_displayBackgroundColor = cmd_packet->m_displayBackgroundColor;
 						m_packets.push_back(pack);
@@ -329,7 +330,7 @@ Packet* SDDataDecoder::FindCommandBusPacket(SDCmdDecoder* decode, int64_t timest
 	for(auto p : packets)
 	{
 		//If it's not a command, ignore it
-		if(p->m_headers["Type"] != "Command")
+		if(p->GetHeader("Type") != "Command")
 			continue;
 
 		//If it's after the timestamp, we're done
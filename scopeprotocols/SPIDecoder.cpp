@@ -277,39 +277,55 @@ void SPIDecoder::Refresh()
 	cap->MarkModifiedFromCpu();
 }
 
-std::string SPIWaveform::GetColor(size_t i)
+uint16_t SPIWaveform::GetColorIndex(size_t i)
 {
 	const SPISymbol& s = m_samples[i];
 	switch(s.m_stype)
 	{
 		case SPISymbol::TYPE_SELECT:
 		case SPISymbol::TYPE_DESELECT:
-			return StandardColors::colors[StandardColors::COLOR_CONTROL];
+			return ProtocolPalette::GetStandardColor(StandardColors::COLOR_CONTROL);
 
 		case SPISymbol::TYPE_DATA:
-			return StandardColors::colors[StandardColors::COLOR_DATA];
+			return ProtocolPalette::GetStandardColor(StandardColors::COLOR_DATA);
 
 		case SPISymbol::TYPE_ERROR:
 		default:
-			return StandardColors::colors[StandardColors::COLOR_ERROR];
+			return ProtocolPalette::GetStandardColor(StandardColors::COLOR_ERROR);
 	}
 }
 
-string SPIWaveform::GetText(size_t i)
+void SPIWaveform::FormatText(size_t i, string& out)
 {
 	const SPISymbol& s = m_samples[i];
 	char tmp[32];
 	switch(s.m_stype)
 	{
 		case SPISymbol::TYPE_SELECT:
-			return "SELECT";
+			out = "SELECT";
+			break;
 		case SPISymbol::TYPE_DESELECT:
-			return "DESELECT";
+			out = "DESELECT";
+			break;
 		case SPISymbol::TYPE_DATA:
 			snprintf(tmp, sizeof(tmp), "%02x", s.m_data);
-			return string(tmp);
+			out = tmp;
+			break;
 		case SPISymbol::TYPE_ERROR:
 		default:
-			return "ERROR";
+			out = "ERROR";
+			break;
 	}
 }
+
+string SPIWaveform::GetText(size_t i)
+{
+	string ret;
+	FormatText(i, ret);
+	return ret;
+}
+
+std::string SPIWaveform::GetColor(size_t i)
+{
+	return ProtocolPalette::GetString(GetColorIndex(i));
+}
@@ -70,6 +70,8 @@ public:
 	SPIWaveform () : SparseWaveform<SPISymbol>() {};
 	virtual std::string GetText(size_t) override;
 	virtual std::string GetColor(size_t) override;
+	virtual void FormatText(size_t i, std::string& out) override;
+	virtual uint16_t GetColorIndex(size_t i) override;
 };
 
 class SPIDecoder : public Filter
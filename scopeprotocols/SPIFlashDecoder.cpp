@@ -390,6 +390,17 @@ void SPIFlashDecoder::Refresh()
 							pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_STATUS];
 							break;
 
+						//Erase a sector (normally 4 Kbytes)
+						case 0x20:
+							current_cmd = SPIFlashSymbol::CMD_SECTOR_ERASE;
+							state = STATE_ADDRESS;
+							addr = 0;
+							addr_start = din->m_offsets[iin+1];
+							address_bytes_left = num_address_bytes;
+
+							pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_COMMAND];
+							break;
+
 						//Quad input page program
 						case 0x32:
 							current_cmd = SPIFlashSymbol::CMD_QUAD_PAGE_PROGRAM;
@@ -455,6 +466,14 @@ void SPIFlashDecoder::Refresh()
 							pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_DATA_READ];
 							break;
 
+						//Erase the entire array (0x60 and 0xc7 are equivalent)
+						case 0x60:
+						case 0xc7:
+							current_cmd = SPIFlashSymbol::CMD_CHIP_ERASE;
+							state = STATE_IDLE;
+							pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_COMMAND];
+							break;
+
 						case 0x66:
 							current_cmd = SPIFlashSymbol::CMD_ENABLE_RESET;
 							state = STATE_IDLE;
@@ -1125,8 +1144,14 @@ string SPIFlashWaveform::GetText(size_t i)
 					return "Write Enable";
 				case SPIFlashSymbol::CMD_BLOCK_ERASE:
 					return "Block Erase";
+				case SPIFlashSymbol::CMD_SECTOR_ERASE:
+					return "Sector Erase";
+				case SPIFlashSymbol::CMD_CHIP_ERASE:
+					return "Chip Erase";
 				case SPIFlashSymbol::CMD_PAGE_PROGRAM:
 					return "Page Program";
+				case SPIFlashSymbol::CMD_QUAD_PAGE_PROGRAM:
+					return "Quad Page Program";
 				case SPIFlashSymbol::CMD_ADDR_24BIT:
 					return "Select 24-Bit Address";
 				case SPIFlashSymbol::CMD_ADDR_32BIT:
@@ -1332,9 +1357,9 @@ string SPIFlashDecoder::GetPartID(SPIFlashWaveform* cap, const SPIFlashSymbol& s
 bool SPIFlashDecoder::CanMerge(Packet* first, Packet* /*cur*/, Packet* next)
 {
 	//Merge read-status packets
-	string firstHeader = first->m_headers["Op"];
-	string secondHeader = next->m_headers["Op"];
-	if( (first->m_headers["Op"].find("Read Status Register") == 0) && (firstHeader == secondHeader) )
+	string firstHeader = first->GetHeader("Op");
+	string secondHeader = next->GetHeader("Op");
+	if( (first->GetHeader("Op").find("Read Status Register") == 0) && (firstHeader == secondHeader) )
 		return true;
 
 	return false;
@@ -1342,7 +1367,7 @@ bool SPIFlashDecoder::CanMerge(Packet* first, Packet* /*cur*/, Packet* next)
 
 Packet* SPIFlashDecoder::CreateMergedHeader(Packet* pack, size_t /*i*/)
 {
-	if(pack->m_headers["Op"].find("Read Status Register") == 0)
+	if(pack->GetHeader("Op").find("Read Status Register") == 0)
 	{
 		Packet* ret = new Packet;
 		ret->m_offset = pack->m_offset;
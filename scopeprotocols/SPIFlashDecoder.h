@@ -80,6 +80,8 @@ public:
 		CMD_WRITE_ENABLE,
 		CMD_WRITE_DISABLE,
 		CMD_BLOCK_ERASE,
+		CMD_SECTOR_ERASE,
+		CMD_CHIP_ERASE,
 		CMD_PAGE_PROGRAM,
 		CMD_QUAD_PAGE_PROGRAM,
 		CMD_READ_SFDP,		//read serial flash discovery parameters
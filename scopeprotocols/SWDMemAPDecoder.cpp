@@ -147,7 +147,7 @@ void SWDMemAPDecoder::Refresh()
 					if(pack)
 					{
 						pack->m_data.clear();
-						pack->m_headers.clear();
+						pack->ClearHeaders();
 					}
 					else
 						pack = new Packet;
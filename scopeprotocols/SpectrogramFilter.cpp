@@ -100,6 +100,11 @@ SpectrogramFilter::SpectrogramFilter(const string& color)
 
 	m_parameters[m_rangeMinName] = FilterParameter(FilterParameter::TYPE_FLOAT, Unit(Unit::UNIT_DBM));
 	m_parameters[m_rangeMinName].SetFloatVal(-50);
+
+	m_window = GetParameterHandle<int64_t>(m_windowName);
+	m_fftLength = GetParameterHandle<int64_t>(m_fftLengthName);
+	m_rangeMin = GetParameterHandle<float>(m_rangeMinName);
+	m_rangeMax = GetParameterHandle<float>(m_rangeMaxName);
 }
 
 SpectrogramFilter::~SpectrogramFilter()
@@ -189,7 +194,7 @@ void SpectrogramFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<Queu
 	//Figure out how many FFTs to do
 	//For now, consecutive blocks and not a sliding window
 	size_t inlen = din->size();
-	size_t fftlen = m_parameters[m_fftLengthName].GetIntVal();
+	size_t fftlen = m_fftLength.Get();
 	size_t nblocks = floor(inlen * 1.0 / fftlen);
 
 	if( (fftlen != m_cachedFFTLength) || (nblocks != m_cachedFFTNumBlocks) )
@@ -242,7 +247,7 @@ void SpectrogramFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<Queu
 	SetData(cap, 0);
 
 	//We also need to adjust the scale by the coherent power gain of the window function
-	auto window = static_cast<FFTFilter::WindowFunction>(m_parameters[m_windowName].GetIntVal());
+	auto window = static_cast<FFTFilter::WindowFunction>(m_window.Get());
 	switch(window)
 	{
 		case FFTFilter::WINDOW_HAMMING:
@@ -308,8 +313,8 @@ void SpectrogramFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<Queu
 	m_rdoutbuf.resize(nblocks * (nouts * 2) );
 
 	//Cache a bunch of configuration
-	float minscale = m_parameters[m_rangeMinName].GetFloatVal();
-	float fullscale = m_parameters[m_rangeMaxName].GetFloatVal();
+	float minscale = m_rangeMin.Get();
+	float fullscale = m_rangeMax.Get();
 	float range = fullscale - minscale;
 
 	//Prepare to do all of our compute stuff in one dispatch call to reduce overhead
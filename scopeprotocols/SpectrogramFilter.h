@@ -108,6 +108,9 @@ public:
 	virtual void SetVoltageRange(float range, size_t stream) override;
 	virtual void SetOffset(float offset, size_t stream) override;
 
+	virtual bool CanSkipRefreshWhenUnchanged() override
+	{ return true; }
+
 	PROTOCOL_DECODER_INITPROC(SpectrogramFilter)
 
 protected:
@@ -127,6 +130,11 @@ protected:
 	std::string m_rangeMinName;
 	std::string m_rangeMaxName;
 
+	FilterParameterHandle<int64_t> m_window;
+	FilterParameterHandle<int64_t> m_fftLength;
+	FilterParameterHandle<float> m_rangeMin;
+	FilterParameterHandle<float> m_rangeMax;
+
 	std::unique_ptr<VulkanFFTPlan> m_vkPlan;
 
 	ComputePipeline m_blackmanHarrisComputePipeline;
@@ -39,9 +39,7 @@ SubtractFilter::SubtractFilter(const string& color)
 	: Filter(color, CAT_MATH)
 	, m_computePipeline("shaders/SubtractFilter.spv", 3, sizeof(SubtractFilterConstants))
 {
-	AddStream(Unit(Unit::UNIT_VOLTS), "data", Stream::STREAM_TYPE_ANALOG);
-	CreateInput("IN+");
-	CreateInput("IN-");
+	ApplyDescriptor(Describe());
 }
 
 SubtractFilter::~SubtractFilter()
@@ -73,6 +71,19 @@ string SubtractFilter::GetProtocolName()
 	return "Subtract";
 }
 
+/**
+	@brief Describes the filter's interface without constructing it. The constructor applies the same descriptor.
+ */
+FilterDescriptor SubtractFilter::Describe()
+{
+	FilterDescriptor desc(GetProtocolName(), CAT_MATH);
+	desc.AddInput("IN+");
+	desc.AddInput("IN-");
+	desc.AddOutput("data", Stream::STREAM_TYPE_ANALOG, Unit(Unit::UNIT_VOLTS));
+	desc.SetCapabilities(FilterDescriptor::CAP_CPU_INPUT | FilterDescriptor::CAP_GPU_INPUT);
+	return desc;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Actual decoder logic
 
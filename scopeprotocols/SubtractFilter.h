@@ -55,6 +55,7 @@ public:
 	virtual DataLocation GetInputLocation() override;
 
 	static std::string GetProtocolName();
+	static FilterDescriptor Describe();
 
 	virtual bool ValidateChannel(size_t i, StreamDescriptor stream) override;
 
@@ -29,7 +29,6 @@
 
 #include "../scopehal/scopehal.h"
 #include "TCPDecoder.h"
-#include "EthernetProtocolDecoder.h"
 
 using namespace std;
 
@@ -37,9 +36,8 @@ using namespace std;
 // Construction / destruction
 
 TCPDecoder::TCPDecoder(const string& color)
-	: Filter(color, CAT_SERIAL)
+	: PacketDecoder(color, CAT_SERIAL)
 {
-	AddProtocolStream("data");
 	CreateInput("ip");
 }
 
@@ -51,11 +49,10 @@ bool TCPDecoder::ValidateChannel(size_t i, StreamDescriptor stream)
 	if(stream.m_channel == NULL)
 		return false;
 
-	if( (i == 0) && (dynamic_cast<IPv4Waveform*>(stream.m_channel->GetData(0)) != NULL) )
+	//Accept anything carrying IP datagrams (IPv4 or IPv6)
+	if( (i == 0) && (dynamic_cast<IPDatagramSource*>(stream.m_channel->GetData(0)) != NULL) )
 		return true;
 
-	//TODO: support IPv6
-
 	return false;
 }
 
@@ -67,334 +64,281 @@ string TCPDecoder::GetProtocolName()
 	return "TCP";
 }
 
+vector<string> TCPDecoder::GetHeaders()
+{
+	vector<string> ret;
+	ret.push_back("Flow");
+	ret.push_back("Source");
+	ret.push_back("Dest");
+	ret.push_back("Flags");
+	ret.push_back("Seq");
+	ret.push_back("Ack");
+	ret.push_back("Len");
+	ret.push_back("Window");
+	ret.push_back("Info");
+	ret.push_back("RTT");
+	return ret;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Actual decoder logic
 
 void TCPDecoder::Refresh()
 {
+	ClearPackets();
+	m_fragments.Clear();
+	m_reassembler.Clear();
+
 	if(!VerifyAllInputsOK())
 	{
 		SetData(NULL, 0);
 		return;
 	}
 
-	//Get the input data (TODO: support IPv6 too)
-	auto din = dynamic_cast<IPv4Waveform*>(GetInputWaveform(0));
+	//Get the input data
+	auto din = GetInputWaveform(0);
+	auto src = dynamic_cast<IPDatagramSource*>(din);
 	din->PrepareForCpuAccess();
-	size_t len = din->m_samples.size();
 
-	//Loop over the events and process stuff
 	auto cap = new TCPWaveform;
 	cap->m_timescale = din->m_timescale;
 	cap->m_triggerPhase = din->m_triggerPhase;
 	cap->m_startTimestamp = din->m_startTimestamp;
 	cap->m_startFemtoseconds = din->m_startFemtoseconds;
 	cap->PrepareForCpuAccess();
-	SetData(cap, 0);
 
-	int state = 0;
-	int option_len = 0;
-	for(size_t i=0; i<len; i++)
+	//Pull out the datagrams, put fragmented ones back together, then decode one segment at a time
+	vector<IPDatagram> datagrams;
+	src->GetDatagrams(datagrams);
+	for(auto& d : datagrams)
 	{
-		auto s = din->m_samples[i];
-		size_t caplen = cap->m_samples.size();
-		int64_t off = din->m_offsets[i];
-		int64_t dur = din->m_durations[i];
-		int64_t end = off + dur;
-		int64_t halfdur = dur/2;
-
-		uint8_t bin = 0;
-		if(din->m_samples[i].m_data.size())
-			bin = din->m_samples[i].m_data[0];
-
-		switch(state)
+		if(d.m_protocol != 0x06)
+			continue;
+		if(!m_fragments.Add(d))
+			continue;
+		DecodeSegment(d, cap, din->m_timescale, din->m_triggerPhase);
+	}
+
+	//Whatever is still missing at the end of the capture isn't coming
+	m_reassembler.Flush();
+
+	//Reassembled datagrams are placed where their first fragment was, which may be before segments decoded in
+	//the meantime. Put everything back in timeline order if that happened.
+	if(!is_sorted(cap->m_offsets.begin(), cap->m_offsets.end()))
+	{
+		size_t len = cap->m_offsets.size();
+		vector<size_t> order(len);
+		for(size_t i=0; i<len; i++)
+			order[i] = i;
+		stable_sort(order.begin(), order.end(),
+			[&](size_t a, size_t b)
+			{ return cap->m_offsets[a] < cap->m_offsets[b]; });
+
+		vector<int64_t> offsets(len);
+		vector<int64_t> durations(len);
+		vector<TCPSymbol> samples(len);
+		for(size_t i=0; i<len; i++)
+		{
+			offsets[i] = cap->m_offsets[order[i]];
+			durations[i] = cap->m_durations[order[i]];
+			samples[i] = cap->m_samples[order[i]];
+		}
+		for(size_t i=0; i<len; i++)
 		{
-			//Wait for IP header version. Ignore any errors, preambles, etc before this
-			case 0:
-				break;
-
-			//If we see a protocol other than TCP, discard and go back to beginning
-			//TODO: add filtering to only show streams from/to specific hosts?
-			case 1:
-				if(s.m_type == IPv4Symbol::TYPE_PROTOCOL)
-				{
-					if(bin != 0x06)
-						state = 0;
-					else
-						state = 2;
-				}
-				break;
-
-			//Ignore all headers until we get to the start of the data field
-			case 2:
-				if(s.m_type == IPv4Symbol::TYPE_DATA)
-				{
-					state = 3;
-
-					cap->m_offsets.push_back(off);
-					cap->m_durations.push_back(0);
-					cap->m_samples.push_back(TCPSymbol(TCPSymbol::TYPE_SOURCE_PORT, bin));
-				}
-				break;
-
-			//Read second half of source port
-			case 3:
-				if(s.m_type == IPv4Symbol::TYPE_DATA)
-				{
-					cap->m_samples[caplen-1].m_data.push_back(bin);
-					cap->m_durations[caplen-1] = end - cap->m_offsets[caplen-1];
-					state = 4;
-				}
-				else
-					state = 0;
-				break;
-
-			//First half of dest port
-			case 4:
-				if(s.m_type == IPv4Symbol::TYPE_DATA)
-				{
-					state = 5;
-
-					cap->m_offsets.push_back(off);
-					cap->m_durations.push_back(0);
-					cap->m_samples.push_back(TCPSymbol(TCPSymbol::TYPE_DEST_PORT, bin));
-				}
-				else
-					state = 0;
-				break;
-
-			//Second half of dest port
-			case 5:
-				if(s.m_type == IPv4Symbol::TYPE_DATA)
-				{
-					cap->m_samples[caplen-1].m_data.push_back(bin);
-					cap->m_durations[caplen-1] = end - cap->m_offsets[caplen-1];
-					state = 6;
-				}
-				else
-					state = 0;
-				break;
-
-			//First byte of sequence number
-			case 6:
-				if(s.m_type == IPv4Symbol::TYPE_DATA)
-				{
-					state = 7;
-
-					cap->m_offsets.push_back(off);
-					cap->m_durations.push_back(0);
-					cap->m_samples.push_back(TCPSymbol(TCPSymbol::TYPE_SEQ, bin));
-				}
-				else
-					state = 0;
-				break;
-
-			//Remainder of sequence number
-			case 7:
-				if(s.m_type == IPv4Symbol::TYPE_DATA)
-				{
-					cap->m_samples[caplen-1].m_data.push_back(bin);
-
-					if(cap->m_samples[caplen-1].m_data.size() == 4)
-					{
-						cap->m_durations[caplen-1] = end - cap->m_offsets[caplen-1];
-						state = 8;
-					}
-				}
-				else
-					state = 0;
-				break;
-
-			//First byte of ACK number
-			case 8:
-				if(s.m_type == IPv4Symbol::TYPE_DATA)
-				{
-					state = 9;
-
-					cap->m_offsets.push_back(off);
-					cap->m_durations.push_back(0);
-					cap->m_samples.push_back(TCPSymbol(TCPSymbol::TYPE_ACK, bin));
-				}
-				else
-					state = 0;
-				break;
-
-			//Remainder of sequence number
-			case 9:
-				if(s.m_type == IPv4Symbol::TYPE_DATA)
-				{
-					cap->m_samples[caplen-1].m_data.push_back(bin);
-
-					if(cap->m_samples[caplen-1].m_data.size() == 4)
-					{
-						cap->m_durations[caplen-1] = end - cap->m_offsets[caplen-1];
-						state = 10;
-					}
-				}
-				else
-					state = 0;
-				break;
-
-			//Data offset
-			case 10:
-				if(s.m_type == IPv4Symbol::TYPE_DATA)
-				{
-					state = 11;
-
-					cap->m_offsets.push_back(off);
-					cap->m_durations.push_back(halfdur);
-					cap->m_samples.push_back(TCPSymbol(TCPSymbol::TYPE_DATA_OFFSET, bin >> 4));
-
-					option_len = ( (bin >> 4) * 4) - 20;
-
-					//Also push the NS bit of the flags
-					cap->m_offsets.push_back(off + halfdur);
-					cap->m_durations.push_back(0);
-					cap->m_samples.push_back(TCPSymbol(TCPSymbol::TYPE_FLAGS, bin & 0xf));
-				}
-				else
-					state = 0;
-				break;
-
-			//Rest of flags
-			case 11:
-				if(s.m_type == IPv4Symbol::TYPE_DATA)
-				{
-					cap->m_samples[caplen-1].m_data.push_back(bin);
-					cap->m_durations[caplen-1] = end - cap->m_offsets[caplen-1];
-					state = 12;
-				}
-				else
-					state = 0;
-				break;
-
-			//First half of window size
-			case 12:
-				if(s.m_type == IPv4Symbol::TYPE_DATA)
-				{
-					state = 13;
-
-					cap->m_offsets.push_back(off);
-					cap->m_durations.push_back(0);
-					cap->m_samples.push_back(TCPSymbol(TCPSymbol::TYPE_WINDOW, bin));
-				}
-				else
-					state = 0;
-				break;
-
-			//Second half of window size
-			case 13:
-				if(s.m_type == IPv4Symbol::TYPE_DATA)
-				{
-					cap->m_samples[caplen-1].m_data.push_back(bin);
-					cap->m_durations[caplen-1] = end - cap->m_offsets[caplen-1];
-					state = 14;
-				}
-				else
-					state = 0;
-				break;
-
-			//First half of checksum
-			case 14:
-				if(s.m_type == IPv4Symbol::TYPE_DATA)
-				{
-					state = 15;
-
-					cap->m_offsets.push_back(off);
-					cap->m_durations.push_back(0);
-					cap->m_samples.push_back(TCPSymbol(TCPSymbol::TYPE_CHECKSUM, bin));
-				}
-				else
-					state = 0;
-				break;
-
-			//Second half of checksum
-			case 15:
-				if(s.m_type == IPv4Symbol::TYPE_DATA)
-				{
-					cap->m_samples[caplen-1].m_data.push_back(bin);
-					cap->m_durations[caplen-1] = end - cap->m_offsets[caplen-1];
-					state = 16;
-				}
-				else
-					state = 0;
-				break;
-
-			//First half of urgent pointer
-			case 16:
-				if(s.m_type == IPv4Symbol::TYPE_DATA)
-				{
-					state = 17;
-
-					cap->m_offsets.push_back(off);
-					cap->m_durations.push_back(0);
-					cap->m_samples.push_back(TCPSymbol(TCPSymbol::TYPE_URGENT, bin));
-				}
-				else
-					state = 0;
-				break;
-
-			//Second half of urgent pointer
-			case 17:
-				if(s.m_type == IPv4Symbol::TYPE_DATA)
-				{
-					cap->m_samples[caplen-1].m_data.push_back(bin);
-					cap->m_durations[caplen-1] = end - cap->m_offsets[caplen-1];
-					state = 18;
-				}
-				else
-					state = 0;
-				break;
-
-			//First byte of options or data
-			case 18:
-				if(s.m_type == IPv4Symbol::TYPE_DATA)
-				{
-					//No more options left? It's our first data byte
-					if(option_len == 0)
-					{
-						cap->m_offsets.push_back(din->m_offsets[i]);
-						cap->m_durations.push_back(din->m_durations[i]);
-						cap->m_samples.push_back(TCPSymbol(TCPSymbol::TYPE_DATA, bin));
-
-						state = 19;
-					}
-
-					//Nope, it's an option byte
-					else
-					{
-						cap->m_offsets.push_back(din->m_offsets[i]);
-						cap->m_durations.push_back(din->m_durations[i]);
-						cap->m_samples.push_back(TCPSymbol(TCPSymbol::TYPE_OPTIONS, bin));
-
-						option_len --;
-					}
-				}
-				else
-					state = 0;
-				break;
-
-			case 19:
-				if(s.m_type == IPv4Symbol::TYPE_DATA)
-				{
-					cap->m_offsets.push_back(din->m_offsets[i]);
-					cap->m_durations.push_back(din->m_durations[i]);
-					cap->m_samples.push_back(TCPSymbol(TCPSymbol::TYPE_DATA, bin));
-				}
-				else
-					state = 0;
-				break;
+			cap->m_offsets[i] = offsets[i];
+			cap->m_durations[i] = durations[i];
+			cap->m_samples[i] = samples[i];
 		}
 
-		//Reset when we see a new IP header starting
-		if(s.m_type == IPv4Symbol::TYPE_VERSION)
-			state = 1;
+		stable_sort(m_packets.begin(), m_packets.end(),
+			[](const Packet* a, const Packet* b)
+			{ return a->m_offset < b->m_offset; });
 	}
 
-	//TODO: packet decode too
+	SetData(cap, 0);
 	cap->MarkModifiedFromCpu();
 }
 
+/**
+	@brief Decodes a single TCP segment and feeds it to the stream reassembler
+ */
+void TCPDecoder::DecodeSegment(const IPDatagram& datagram, TCPWaveform* cap, int64_t timescale, int64_t phase)
+{
+	auto& b = datagram.m_payload;
+	auto& off = datagram.m_offsets;
+	auto& dur = datagram.m_durations;
+	if(b.empty())
+		return;
+
+	//Adds a symbol spanning bytes [first, first+n)
+	auto add = [&](TCPSymbol::SegmentType type, size_t first, size_t n)
+	{
+		TCPSymbol sym;
+		sym.m_type = type;
+		sym.m_data.assign(b.begin() + first, b.begin() + first + n);
+		cap->m_offsets.push_back(off[first]);
+		cap->m_durations.push_back(max<int64_t>(0, off[first+n-1] + dur[first+n-1] - off[first]));
+		cap->m_samples.push_back(sym);
+	};
+
+	size_t header_len = 0;
+	if(b.size() >= 20)
+		header_len = (b[12] >> 4) * 4;
+	if( (header_len < 20) || (header_len > b.size()) )
+	{
+		add(TCPSymbol::TYPE_ERROR, 0, b.size());
+		return;
+	}
+
+	//Checksum covers the pseudo-header, TCP header and payload
+	InternetChecksum sum;
+	AddPseudoHeader(sum, datagram.m_src, datagram.m_dst, 0x06, b.size());
+	sum.Add(&b[0], b.size());
+	bool checksumOK = sum.IsValid();
+
+	add(TCPSymbol::TYPE_SOURCE_PORT, 0, 2);
+	add(TCPSymbol::TYPE_DEST_PORT, 2, 2);
+	add(TCPSymbol::TYPE_SEQ, 4, 4);
+	add(TCPSymbol::TYPE_ACK, 8, 4);
+
+	//Data offset is the first half of byte 12, flags (including NS) run from there to the end of byte 13
+	int64_t halfdur = dur[12] / 2;
+	cap->m_offsets.push_back(off[12]);
+	cap->m_durations.push_back(halfdur);
+	cap->m_samples.push_back(TCPSymbol(TCPSymbol::TYPE_DATA_OFFSET, b[12] >> 4));
+
+	TCPSymbol flags(TCPSymbol::TYPE_FLAGS, b[12] & 0xf);
+	flags.m_data.push_back(b[13]);
+	cap->m_offsets.push_back(off[12] + halfdur);
+	cap->m_durations.push_back(max<int64_t>(0, off[13] + dur[13] - (off[12] + halfdur)));
+	cap->m_samples.push_back(flags);
+
+	add(TCPSymbol::TYPE_WINDOW, 14, 2);
+	add(checksumOK ? TCPSymbol::TYPE_CHECKSUM : TCPSymbol::TYPE_CHECKSUM_BAD, 16, 2);
+	add(TCPSymbol::TYPE_URGENT, 18, 2);
+	for(size_t i=20; i<header_len; i++)
+		add(TCPSymbol::TYPE_OPTIONS, i, 1);
+	for(size_t i=header_len; i<b.size(); i++)
+		add(TCPSymbol::TYPE_DATA, i, 1);
+
+	//Feed good segments to the reassembler
+	TCPSegment seg;
+	seg.m_key.m_src = datagram.m_src;
+	seg.m_key.m_dst = datagram.m_dst;
+	seg.m_key.m_srcPort = (b[0] << 8) | b[1];
+	seg.m_key.m_dstPort = (b[2] << 8) | b[3];
+	seg.m_timestamp = off[0] * timescale + phase;
+	seg.m_seq = (b[4] << 24) | (b[5] << 16) | (b[6] << 8) | b[7];
+	seg.m_ack = (b[8] << 24) | (b[9] << 16) | (b[10] << 8) | b[11];
+	seg.m_flags = b[13];
+	seg.m_window = (b[14] << 8) | b[15];
+	seg.m_data = &b[header_len];
+	seg.m_len = b.size() - header_len;
+
+	TCPSegmentInfo info;
+	bool valid = checksumOK && datagram.m_headerChecksumOK;
+	if(valid)
+		info = m_reassembler.AddSegment(seg);
+
+	//Packet decode
+	size_t last = b.size() - 1;
+	auto pack = new Packet;
+	pack->m_offset = seg.m_timestamp;
+	pack->m_len = max<int64_t>(0, off[last] + dur[last] - off[0]) * timescale;
+
+	char tmp[128];
+	if(datagram.m_src.IsV6())
+		snprintf(tmp, sizeof(tmp), "[%s]:%d", datagram.m_src.ToString().c_str(), seg.m_key.m_srcPort);
+	else
+		snprintf(tmp, sizeof(tmp), "%s:%d", datagram.m_src.ToString().c_str(), seg.m_key.m_srcPort);
+	pack->SetHeader("Source", tmp);
+	if(datagram.m_dst.IsV6())
+		snprintf(tmp, sizeof(tmp), "[%s]:%d", datagram.m_dst.ToString().c_str(), seg.m_key.m_dstPort);
+	else
+		snprintf(tmp, sizeof(tmp), "%s:%d", datagram.m_dst.ToString().c_str(), seg.m_key.m_dstPort);
+	pack->SetHeader("Dest", tmp);
+
+	string sflags;
+	static const char* flagNames[] = { "FIN", "SYN", "RST", "PSH", "ACK", "URG", "ECE", "CWR" };
+	for(int i=0; i<8; i++)
+	{
+		if(seg.m_flags & (1 << i))
+		{
+			if(!sflags.empty())
+				sflags += " ";
+			sflags += flagNames[i];
+		}
+	}
+	pack->SetHeader("Flags", sflags);
+	pack->SetHeaderDecimal("Len", seg.m_len);
+	pack->SetHeaderDecimal("Window", seg.m_window);
+
+	//Sequence numbers are shown relative to the start of the connection, if we know which one it's in
+	if(info.m_connection)
+	{
+		pack->SetHeaderDecimal("Flow", info.m_connection->m_index);
+		pack->SetHeaderDecimal("Seq", info.m_relSeq);
+		if(seg.m_flags & TCPSegment::FLAG_ACK)
+			pack->SetHeaderDecimal("Ack", info.m_relAck);
+	}
+	else
+	{
+		pack->SetHeaderHex("Seq", seg.m_seq, 8);
+		if(seg.m_flags & TCPSegment::FLAG_ACK)
+			pack->SetHeaderHex("Ack", seg.m_ack, 8);
+	}
+
+	string sinfo;
+	if(!valid)
+		sinfo = "Bad checksum";
+	else
+	{
+		static const pair<uint32_t, const char*> statusNames[] =
+		{
+			{ TCPStreamReassembler::SEG_NEW_CONNECTION,	"New connection" },
+			{ TCPStreamReassembler::SEG_RETRANSMISSION,	"Retransmission" },
+			{ TCPStreamReassembler::SEG_OUT_OF_ORDER,	"Out of order" },
+			{ TCPStreamReassembler::SEG_PREVIOUS_LOST,	"Previous segment lost" },
+			{ TCPStreamReassembler::SEG_DUP_ACK,		"Dup ACK" },
+			{ TCPStreamReassembler::SEG_KEEPALIVE,		"Keepalive" },
+			{ TCPStreamReassembler::SEG_ZERO_WINDOW,	"Zero window" }
+		};
+		for(auto& it : statusNames)
+		{
+			if(info.m_status & it.first)
+			{
+				if(!sinfo.empty())
+					sinfo += ", ";
+				sinfo += it.second;
+			}
+		}
+	}
+	if(!sinfo.empty())
+		pack->SetHeader("Info", sinfo);
+
+	//RTT is different for every packet so don't bother interning it
+	if(info.m_rtt > 0)
+		pack->m_headers["RTT"] = Unit(Unit::UNIT_FS).PrettyPrint(info.m_rtt);
+
+	pack->m_data.assign(b.begin() + header_len, b.end());
+
+	if(!valid || (seg.m_flags & TCPSegment::FLAG_RST) )
+		pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_ERROR];
+	else if(info.m_status & (TCPStreamReassembler::SEG_RETRANSMISSION | TCPStreamReassembler::SEG_OUT_OF_ORDER |
+		TCPStreamReassembler::SEG_PREVIOUS_LOST | TCPStreamReassembler::SEG_DUP_ACK |
+		TCPStreamReassembler::SEG_ZERO_WINDOW) )
+	{
+		pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_STATUS];
+	}
+	else if(seg.m_flags & (TCPSegment::FLAG_SYN | TCPSegment::FLAG_FIN) )
+		pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_CONTROL];
+	else if(info.m_direction == 0)
+		pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_DATA_WRITE];
+	else
+		pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_DATA_READ];
+	m_packets.push_back(pack);
+}
+
 std::string TCPWaveform::GetColor(size_t i)
 {
 	switch(m_samples[i].m_type)
@@ -408,10 +352,12 @@ std::string TCPWaveform::GetColor(size_t i)
 		case TCPSymbol::TYPE_OPTIONS:
 			return StandardColors::colors[StandardColors::COLOR_CONTROL];
 
-		//TODO: properly verify checksum
 		case TCPSymbol::TYPE_CHECKSUM:
 			return StandardColors::colors[StandardColors::COLOR_CHECKSUM_OK];
 
+		case TCPSymbol::TYPE_CHECKSUM_BAD:
+			return StandardColors::colors[StandardColors::COLOR_CHECKSUM_BAD];
+
 		case TCPSymbol::TYPE_SOURCE_PORT:
 		case TCPSymbol::TYPE_DEST_PORT:
 			return StandardColors::colors[StandardColors::COLOR_ADDRESS];
@@ -475,6 +421,7 @@ string TCPWaveform::GetText(size_t i)
 			return string(tmp);
 
 		case TCPSymbol::TYPE_CHECKSUM:
+		case TCPSymbol::TYPE_CHECKSUM_BAD:
 			snprintf(tmp, sizeof(tmp), "Checksum: %x", (sample.m_data[0] << 8) | sample.m_data[1]);
 			return string(tmp);
 
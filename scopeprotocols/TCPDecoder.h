@@ -35,7 +35,8 @@
 #ifndef TCPDecoder_h
 #define TCPDecoder_h
 
-#include "IPv4Decoder.h"
+#include "../scopehal/PacketDecoder.h"
+#include "TCPStreamReassembler.h"
 
 class TCPSymbol
 {
@@ -51,7 +52,8 @@ public:
 		TYPE_DATA_OFFSET,
 		TYPE_FLAGS,
 		TYPE_WINDOW,
-		TYPE_CHECKSUM,
+		TYPE_CHECKSUM,		//checksum, verified good
+		TYPE_CHECKSUM_BAD,
 		TYPE_URGENT,
 		TYPE_OPTIONS,
 		TYPE_DATA
@@ -80,7 +82,7 @@ public:
 	virtual std::string GetColor(size_t) override;
 };
 
-class TCPDecoder : public Filter
+class TCPDecoder : public PacketDecoder
 {
 public:
 	TCPDecoder(const std::string& color);
@@ -89,9 +91,20 @@ public:
 
 	static std::string GetProtocolName();
 
+	virtual std::vector<std::string> GetHeaders() override;
 	virtual bool ValidateChannel(size_t i, StreamDescriptor stream) override;
 
+	///@brief Reassembled streams and per-connection statistics from the last refresh
+	const TCPStreamReassembler& GetReassembler() const
+	{ return m_reassembler; }
+
 	PROTOCOL_DECODER_INITPROC(TCPDecoder)
+
+protected:
+	void DecodeSegment(const IPDatagram& datagram, TCPWaveform* cap, int64_t timescale, int64_t phase);
+
+	IPFragmentReassembler m_fragments;
+	TCPStreamReassembler m_reassembler;
 };
 
 #endif
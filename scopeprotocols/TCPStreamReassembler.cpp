@@ -0,0 +1,486 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of TCPStreamReassembler
+ */
+
+#include "../scopehal/scopehal.h"
+#include "TCPStreamReassembler.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// TCPFlowKey
+
+TCPFlowKey TCPFlowKey::Reverse() const
+{
+	TCPFlowKey ret;
+	ret.m_src = m_dst;
+	ret.m_dst = m_src;
+	ret.m_srcPort = m_dstPort;
+	ret.m_dstPort = m_srcPort;
+	return ret;
+}
+
+bool TCPFlowKey::operator<(const TCPFlowKey& rhs) const
+{
+	if(m_src != rhs.m_src)
+		return m_src < rhs.m_src;
+	if(m_dst != rhs.m_dst)
+		return m_dst < rhs.m_dst;
+	if(m_srcPort != rhs.m_srcPort)
+		return m_srcPort < rhs.m_srcPort;
+	return m_dstPort < rhs.m_dstPort;
+}
+
+string TCPFlowKey::ToString() const
+{
+	char tmp[128];
+	if(m_src.IsV6())
+	{
+		snprintf(tmp, sizeof(tmp), "[%s]:%d -> [%s]:%d",
+			m_src.ToString().c_str(), m_srcPort, m_dst.ToString().c_str(), m_dstPort);
+	}
+	else
+	{
+		snprintf(tmp, sizeof(tmp), "%s:%d -> %s:%d",
+			m_src.ToString().c_str(), m_srcPort, m_dst.ToString().c_str(), m_dstPort);
+	}
+	return tmp;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// TCPStream
+
+TCPStream::TCPStream()
+	: m_haveIsn(false)
+	, m_isn(0)
+	, m_nextSeq(0)
+	, m_highestSeq(0)
+	, m_finSeen(false)
+	, m_finSeq(0)
+	, m_pendingBytes(0)
+	, m_haveAck(false)
+	, m_lastAck(0)
+	, m_lastWindow(0)
+	, m_segments(0)
+	, m_payloadBytes(0)
+	, m_retransmissions(0)
+	, m_outOfOrder(0)
+	, m_lostSegments(0)
+	, m_dupAcks(0)
+	, m_keepAlives(0)
+	, m_zeroWindows(0)
+	, m_rttSamples(0)
+	, m_rttMin(0)
+	, m_rttMax(0)
+	, m_rttSum(0)
+	, m_srtt(0)
+	, m_firstTimestamp(0)
+	, m_lastTimestamp(0)
+{
+}
+
+/**
+	@brief Converts a 32-bit sequence number from the wire to a 64-bit relative one
+
+	We pick whichever 4 GB epoch puts the result closest to the highest sequence number seen so far.
+ */
+uint64_t TCPStream::Unwrap(uint32_t seq) const
+{
+	const uint64_t epoch = 0x100000000ULL;
+
+	uint32_t rel = seq - m_isn;
+	uint64_t ret = (m_highestSeq & ~(epoch - 1)) | rel;
+	if( (ret > m_highestSeq) && (ret - m_highestSeq > epoch/2) && (ret >= epoch) )
+		ret -= epoch;
+	else if( (ret < m_highestSeq) && (m_highestSeq - ret > epoch/2) )
+		ret += epoch;
+	return ret;
+}
+
+double TCPStream::GetThroughput() const
+{
+	if(m_lastTimestamp <= m_firstTimestamp)
+		return 0;
+	return m_payloadBytes * FS_PER_SECOND / (m_lastTimestamp - m_firstTimestamp);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+TCPStreamReassembler::TCPStreamReassembler(size_t maxPendingBytes)
+	: m_maxPendingBytes(maxPendingBytes)
+{
+}
+
+void TCPStreamReassembler::Clear()
+{
+	m_active.clear();
+	m_connections.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Reassembly
+
+/**
+	@brief Processes the next segment of the capture
+
+	@return Where the segment belongs and how it was classified
+ */
+TCPSegmentInfo TCPStreamReassembler::AddSegment(const TCPSegment& seg)
+{
+	TCPSegmentInfo info;
+
+	bool syn = (seg.m_flags & TCPSegment::FLAG_SYN);
+	bool fin = (seg.m_flags & TCPSegment::FLAG_FIN);
+	bool rst = (seg.m_flags & TCPSegment::FLAG_RST);
+	bool ack = (seg.m_flags & TCPSegment::FLAG_ACK);
+
+	//Find the connection, which may have been opened from either end
+	auto rkey = seg.m_key.Reverse();
+	TCPConnection* conn = nullptr;
+	int dir = 0;
+	auto it = m_active.find(seg.m_key);
+	if(it != m_active.end())
+		conn = it->second;
+	else
+	{
+		it = m_active.find(rkey);
+		if(it != m_active.end())
+		{
+			conn = it->second;
+			dir = 1;
+		}
+	}
+
+	//A new SYN on a closed connection, or with a different ISN, means the ports have been reused
+	if(conn && syn && !ack)
+	{
+		auto& s = conn->m_streams[dir];
+		if(conn->IsClosed() || (s.m_haveIsn && (s.m_isn != seg.m_seq)) )
+			conn = nullptr;
+	}
+	if(!conn)
+	{
+		m_active.erase(seg.m_key);
+		m_active.erase(rkey);
+
+		m_connections.push_back(make_unique<TCPConnection>());
+		conn = m_connections.back().get();
+		conn->m_key = seg.m_key;
+		conn->m_index = m_connections.size() - 1;
+		m_active[seg.m_key] = conn;
+		dir = 0;
+
+		info.m_status |= SEG_NEW_CONNECTION;
+	}
+	info.m_connection = conn;
+	info.m_direction = dir;
+
+	auto& s = conn->m_streams[dir];
+	auto& r = conn->m_streams[1 - dir];
+
+	if(s.m_segments == 0)
+		s.m_firstTimestamp = seg.m_timestamp;
+	s.m_lastTimestamp = seg.m_timestamp;
+	s.m_segments ++;
+	s.m_payloadBytes += seg.m_len;
+
+	if(rst)
+		conn->m_reset = true;
+
+	//If we missed the SYN, pretend the first byte we saw was the first byte of the stream
+	if(!s.m_haveIsn)
+	{
+		s.m_haveIsn = true;
+		s.m_isn = syn ? seg.m_seq : (seg.m_seq - 1);
+		s.m_nextSeq = 1;
+		s.m_highestSeq = 1;
+	}
+	else if(syn && (s.m_segments > 1) && (seg.m_seq == s.m_isn))
+	{
+		info.m_status |= SEG_RETRANSMISSION;
+		s.m_retransmissions ++;
+	}
+
+	//Sequence space covered by this segment (the SYN itself is relative sequence 0)
+	uint64_t rel = s.Unwrap(seg.m_seq);
+	info.m_relSeq = rel;
+	uint64_t start = syn ? (rel + 1) : rel;
+	uint64_t end = start + seg.m_len + (fin ? 1 : 0);
+
+	//Keepalives are sent with the sequence number one byte before what the peer expects
+	bool keepalive = !syn && !fin && !rst && (seg.m_len <= 1) && (rel + 1 == s.m_nextSeq);
+	if(keepalive)
+	{
+		info.m_status |= SEG_KEEPALIVE;
+		s.m_keepAlives ++;
+	}
+
+	else if(end > start)
+	{
+		//Anything before the next expected byte has been seen already
+		if(start < s.m_nextSeq)
+		{
+			info.m_status |= SEG_RETRANSMISSION;
+			s.m_retransmissions ++;
+		}
+
+		//Skipped ahead of anything we've seen, so we never saw the segment before it
+		else if(start > s.m_highestSeq)
+		{
+			info.m_status |= SEG_PREVIOUS_LOST;
+			s.m_lostSegments ++;
+		}
+
+		//Filling in a hole. If we already have this data buffered, it's a retransmission
+		else if(start < s.m_highestSeq)
+		{
+			bool buffered = false;
+			auto jt = s.m_pending.upper_bound(start);
+			if(jt != s.m_pending.begin())
+			{
+				jt--;
+				buffered = (jt->first + jt->second.size() >= start + seg.m_len);
+			}
+
+			if(buffered && seg.m_len)
+			{
+				info.m_status |= SEG_RETRANSMISSION;
+				s.m_retransmissions ++;
+			}
+			else
+			{
+				info.m_status |= SEG_OUT_OF_ORDER;
+				s.m_outOfOrder ++;
+			}
+		}
+
+		//Keep track of what's in flight so we can measure RTT when it's acked
+		if(info.m_status & SEG_RETRANSMISSION)
+		{
+			for(auto jt = s.m_inflight.upper_bound(start); jt != s.m_inflight.end(); jt++)
+			{
+				if(jt->second.m_start >= end)
+					break;
+				jt->second.m_retransmitted = true;
+			}
+		}
+		else
+		{
+			TCPStream::InFlight f;
+			f.m_start = start;
+			f.m_timestamp = seg.m_timestamp;
+			f.m_retransmitted = false;
+			s.m_inflight[end] = f;
+
+			//Don't grow forever if the acks weren't captured
+			if(s.m_inflight.size() > 65536)
+				s.m_inflight.erase(s.m_inflight.begin());
+		}
+
+		s.m_highestSeq = max(s.m_highestSeq, end);
+	}
+
+	//Payload
+	if(seg.m_len && !keepalive)
+		AddData(s, start, seg.m_data, seg.m_len);
+	if(fin && !s.m_finSeen)
+	{
+		s.m_finSeen = true;
+		s.m_finSeq = start + seg.m_len;
+	}
+	Drain(s, false);
+
+	//Acknowledgement and window, which describe the data flowing the other way
+	if(ack && r.m_haveIsn)
+	{
+		uint64_t ackRel = r.Unwrap(seg.m_ack);
+		info.m_relAck = ackRel;
+
+		if(!syn && !fin && !rst && (seg.m_len == 0) && s.m_haveAck &&
+			(ackRel == s.m_lastAck) && (seg.m_window == s.m_lastWindow) && (r.m_highestSeq > ackRel) )
+		{
+			info.m_status |= SEG_DUP_ACK;
+			s.m_dupAcks ++;
+		}
+
+		info.m_rtt = ProcessAck(r, ackRel, seg.m_timestamp);
+
+		s.m_haveAck = true;
+		s.m_lastAck = ackRel;
+		s.m_lastWindow = seg.m_window;
+	}
+	if( (seg.m_window == 0) && !syn && !fin && !rst)
+	{
+		info.m_status |= SEG_ZERO_WINDOW;
+		s.m_zeroWindows ++;
+	}
+
+	return info;
+}
+
+/**
+	@brief Retires acknowledged data from a stream's in-flight list, taking an RTT sample if possible
+
+	@return The RTT sample, or zero if none was taken
+ */
+int64_t TCPStreamReassembler::ProcessAck(TCPStream& stream, uint64_t ack, int64_t timestamp)
+{
+	auto end = stream.m_inflight.upper_bound(ack);
+	if(end == stream.m_inflight.begin())
+		return 0;
+
+	//Sample the most recent segment this ack covers
+	int64_t rtt = 0;
+	auto& last = prev(end)->second;
+	if(!last.m_retransmitted)
+	{
+		rtt = timestamp - last.m_timestamp;
+
+		if( (stream.m_rttSamples == 0) || (rtt < stream.m_rttMin) )
+			stream.m_rttMin = rtt;
+		if( (stream.m_rttSamples == 0) || (rtt > stream.m_rttMax) )
+			stream.m_rttMax = rtt;
+
+		//Smoothed RTT per RFC 6298 (alpha = 1/8)
+		if(stream.m_rttSamples == 0)
+			stream.m_srtt = rtt;
+		else
+			stream.m_srtt += (rtt - stream.m_srtt) / 8;
+
+		stream.m_rttSum += rtt;
+		stream.m_rttSamples ++;
+	}
+
+	stream.m_inflight.erase(stream.m_inflight.begin(), end);
+	return rtt;
+}
+
+/**
+	@brief Buffers payload data until everything before it has arrived
+ */
+void TCPStreamReassembler::AddData(TCPStream& stream, uint64_t seq, const uint8_t* data, size_t len)
+{
+	//Trim off anything we've already reassembled
+	uint64_t end = seq + len;
+	if(end <= stream.m_nextSeq)
+		return;
+	if(seq < stream.m_nextSeq)
+	{
+		data += stream.m_nextSeq - seq;
+		len = end - stream.m_nextSeq;
+		seq = stream.m_nextSeq;
+	}
+
+	//If we already have data starting here, the first copy wins and we only keep anything past its end
+	auto it = stream.m_pending.find(seq);
+	if(it != stream.m_pending.end())
+	{
+		auto& buf = it->second;
+		if(buf.size() < len)
+		{
+			stream.m_pendingBytes += len - buf.size();
+			buf.insert(buf.end(), data + buf.size(), data + len);
+		}
+		return;
+	}
+
+	stream.m_pending[seq].assign(data, data + len);
+	stream.m_pendingBytes += len;
+}
+
+/**
+	@brief Moves buffered data into the reassembled stream, for as long as there's no hole in front of it
+
+	@param stream	The stream to drain
+	@param force	If true, give up on any holes, recording them as gaps
+ */
+void TCPStreamReassembler::Drain(TCPStream& stream, bool force)
+{
+	while(!stream.m_pending.empty())
+	{
+		auto it = stream.m_pending.begin();
+		if(it->first > stream.m_nextSeq)
+		{
+			//Wait for the hole to be filled, unless we've buffered so much it's probably never coming
+			if(!force && (stream.m_pendingBytes <= m_maxPendingBytes) )
+				break;
+
+			TCPStream::Gap gap;
+			gap.m_position = stream.m_data.size();
+			gap.m_len = it->first - stream.m_nextSeq;
+			stream.m_gaps.push_back(gap);
+			stream.m_nextSeq = it->first;
+		}
+
+		//Segments may overlap, so only take what's past the end of the stream so far
+		auto& buf = it->second;
+		uint64_t end = it->first + buf.size();
+		if(end > stream.m_nextSeq)
+		{
+			stream.m_data.insert(stream.m_data.end(), buf.begin() + (stream.m_nextSeq - it->first), buf.end());
+			stream.m_nextSeq = end;
+		}
+		stream.m_pendingBytes -= buf.size();
+		stream.m_pending.erase(it);
+	}
+
+	//The FIN takes up one sequence number once everything before it has arrived
+	if(stream.m_finSeen)
+	{
+		if(force && (stream.m_nextSeq < stream.m_finSeq) )
+		{
+			TCPStream::Gap gap;
+			gap.m_position = stream.m_data.size();
+			gap.m_len = stream.m_finSeq - stream.m_nextSeq;
+			stream.m_gaps.push_back(gap);
+			stream.m_nextSeq = stream.m_finSeq;
+		}
+		if(stream.m_nextSeq == stream.m_finSeq)
+			stream.m_nextSeq ++;
+	}
+}
+
+/**
+	@brief Gives up waiting for any missing data (call at the end of a capture)
+ */
+void TCPStreamReassembler::Flush()
+{
+	for(auto& c : m_connections)
+	{
+		Drain(c->m_streams[0], true);
+		Drain(c->m_streams[1], true);
+	}
+}
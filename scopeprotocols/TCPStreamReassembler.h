@@ -0,0 +1,293 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of TCPStreamReassembler
+ */
+#ifndef TCPStreamReassembler_h
+#define TCPStreamReassembler_h
+
+#include "InternetProtocol.h"
+
+/**
+	@brief Identifies one direction of a TCP connection
+ */
+class TCPFlowKey
+{
+public:
+	TCPFlowKey()
+		: m_srcPort(0)
+		, m_dstPort(0)
+	{}
+
+	TCPFlowKey Reverse() const;
+	std::string ToString() const;
+
+	bool operator<(const TCPFlowKey& rhs) const;
+
+	bool operator==(const TCPFlowKey& rhs) const
+	{
+		return (m_src == rhs.m_src) && (m_dst == rhs.m_dst) &&
+			(m_srcPort == rhs.m_srcPort) && (m_dstPort == rhs.m_dstPort);
+	}
+
+	IPAddress m_src;
+	IPAddress m_dst;
+	uint16_t m_srcPort;
+	uint16_t m_dstPort;
+};
+
+/**
+	@brief A single TCP segment, as seen on the wire
+ */
+class TCPSegment
+{
+public:
+	TCPFlowKey m_key;
+
+	///@brief Time the segment was captured, in fs
+	int64_t m_timestamp;
+
+	uint32_t m_seq;
+	uint32_t m_ack;
+	uint8_t m_flags;
+	uint16_t m_window;
+
+	const uint8_t* m_data;
+	size_t m_len;
+
+	enum Flags
+	{
+		FLAG_FIN = 0x01,
+		FLAG_SYN = 0x02,
+		FLAG_RST = 0x04,
+		FLAG_PSH = 0x08,
+		FLAG_ACK = 0x10,
+		FLAG_URG = 0x20
+	};
+};
+
+/**
+	@brief One direction of a TCP connection: the reassembled byte stream plus statistics
+
+	Sequence numbers are tracked as 64-bit values relative to the initial sequence number (so the SYN is 0 and the
+	first data byte is 1), which makes them immune to wraparound. If the SYN wasn't captured, the first segment seen
+	is treated as starting at relative sequence number 1.
+ */
+class TCPStream
+{
+public:
+	TCPStream();
+
+	uint64_t Unwrap(uint32_t seq) const;
+
+	///@brief Payload bytes per second over the life of the stream, including retransmissions
+	double GetThroughput() const;
+
+	///@brief Mean of all RTT samples, in fs (zero if there are none)
+	int64_t GetMeanRTT() const
+	{ return m_rttSamples ? (m_rttSum / m_rttSamples) : 0; }
+
+	/**
+		@brief A range of the stream which was never captured
+	 */
+	struct Gap
+	{
+		///@brief Position in m_data where the missing bytes belong
+		size_t m_position;
+
+		///@brief Number of missing bytes
+		uint64_t m_len;
+	};
+
+	/**
+		@brief A segment which has been sent but not yet acknowledged, used for RTT estimation
+	 */
+	struct InFlight
+	{
+		uint64_t m_start;
+		int64_t m_timestamp;
+
+		///@brief Karn's algorithm: never take RTT samples from retransmitted data
+		bool m_retransmitted;
+	};
+
+	bool m_haveIsn;
+	uint32_t m_isn;
+
+	///@brief Next in-order relative sequence number we expect to see
+	uint64_t m_nextSeq;
+
+	///@brief Highest relative sequence number sent so far, plus one
+	uint64_t m_highestSeq;
+
+	bool m_finSeen;
+	uint64_t m_finSeq;
+
+	///@brief Reassembled stream contents, in order, with missing ranges recorded in m_gaps
+	std::vector<uint8_t> m_data;
+	std::vector<Gap> m_gaps;
+
+	///@brief Data received out of order, keyed by relative sequence number
+	std::map<uint64_t, std::vector<uint8_t> > m_pending;
+	size_t m_pendingBytes;
+
+	///@brief Unacknowledged segments, keyed by relative sequence number of their last byte plus one
+	std::map<uint64_t, InFlight> m_inflight;
+
+	bool m_haveAck;
+	uint64_t m_lastAck;
+	uint16_t m_lastWindow;
+
+	//Statistics
+	uint64_t m_segments;
+	uint64_t m_payloadBytes;
+	uint64_t m_retransmissions;
+	uint64_t m_outOfOrder;
+	uint64_t m_lostSegments;
+	uint64_t m_dupAcks;
+	uint64_t m_keepAlives;
+	uint64_t m_zeroWindows;
+
+	//RTT of data sent in this direction, in fs
+	uint64_t m_rttSamples;
+	int64_t m_rttMin;
+	int64_t m_rttMax;
+	int64_t m_rttSum;
+	int64_t m_srtt;
+
+	int64_t m_firstTimestamp;
+	int64_t m_lastTimestamp;
+};
+
+/**
+	@brief Both directions of a TCP connection
+ */
+class TCPConnection
+{
+public:
+	TCPConnection()
+		: m_index(0)
+		, m_reset(false)
+	{}
+
+	///@brief Direction of the first segment seen (normally client to server)
+	TCPFlowKey m_key;
+
+	///@brief Sequential ID for display
+	size_t m_index;
+
+	///@brief Streams for m_key's direction [0] and the reverse direction [1]
+	TCPStream m_streams[2];
+
+	bool m_reset;
+
+	bool IsClosed() const
+	{ return m_reset || (m_streams[0].m_finSeen && m_streams[1].m_finSeen); }
+};
+
+/**
+	@brief Result of adding a single segment to a TCPStreamReassembler
+ */
+class TCPSegmentInfo
+{
+public:
+	TCPSegmentInfo()
+		: m_status(0)
+		, m_connection(nullptr)
+		, m_direction(0)
+		, m_relSeq(0)
+		, m_relAck(0)
+		, m_rtt(0)
+	{}
+
+	///@brief Bitmask of TCPStreamReassembler::SegmentStatus
+	uint32_t m_status;
+
+	TCPConnection* m_connection;
+
+	///@brief Index into m_connection->m_streams of the stream this segment was sent on
+	int m_direction;
+
+	uint64_t m_relSeq;
+	uint64_t m_relAck;
+
+	///@brief Round trip time of the data this segment acknowledges, in fs, or zero if it didn't produce a sample
+	int64_t m_rtt;
+};
+
+/**
+	@brief Turns TCP segments into ordered byte streams, one connection at a time
+
+	Segments are fed in capture order. Out-of-order data is buffered until the hole before it is filled, and
+	retransmitted data is discarded (the copy which arrived first wins). If a hole is never filled, either because
+	too much data is buffered behind it or because Flush() is called at the end of the capture, the missing range is
+	recorded as a gap and reassembly continues after it.
+ */
+class TCPStreamReassembler
+{
+public:
+	TCPStreamReassembler(size_t maxPendingBytes = 16 * 1024 * 1024);
+
+	TCPSegmentInfo AddSegment(const TCPSegment& seg);
+	void Flush();
+	void Clear();
+
+	const std::vector<std::unique_ptr<TCPConnection> >& GetConnections() const
+	{ return m_connections; }
+
+	enum SegmentStatus
+	{
+		SEG_RETRANSMISSION	= 0x01,
+		SEG_OUT_OF_ORDER	= 0x02,
+		SEG_PREVIOUS_LOST	= 0x04,
+		SEG_DUP_ACK			= 0x08,
+		SEG_KEEPALIVE		= 0x10,
+		SEG_ZERO_WINDOW		= 0x20,
+		SEG_NEW_CONNECTION	= 0x40
+	};
+
+protected:
+	void AddData(TCPStream& stream, uint64_t seq, const uint8_t* data, size_t len);
+	void Drain(TCPStream& stream, bool force);
+	int64_t ProcessAck(TCPStream& stream, uint64_t ack, int64_t timestamp);
+
+	///@brief Every connection seen, in order of first appearance
+	std::vector<std::unique_ptr<TCPConnection> > m_connections;
+
+	///@brief Most recent connection for each flow (keyed by the direction of its first segment)
+	std::map<TCPFlowKey, TCPConnection*> m_active;
+
+	size_t m_maxPendingBytes;
+};
+
+#endif
@@ -35,6 +35,7 @@
 
 #include "../scopehal/scopehal.h"
 #include "TMDSDecoder.h"
+#include <array>
 
 using namespace std;
 
@@ -72,6 +73,77 @@ string TMDSDecoder::GetProtocolName()
 	return "8b/10b (TMDS)";
 }
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Symbol tables
+
+/*
+	All 10-bit codes below are written q9...q0 as in the HDMI 1.4 spec. TMDS sends q0 first, so once the serial bits
+	are packed LSB first a symbol can be compared against these directly.
+ */
+
+//Control period codes (HDMI 1.4 spec section 5.4.2), indexed by {C1, C0}
+static const uint16_t g_controlCodes[4] = { 0x354, 0x0ab, 0x154, 0x2ab };
+
+//Video leading guard band (5.2.2.1), indexed by lane
+static const uint16_t g_videoGuard[3] = { 0x2cc, 0x133, 0x2cc };
+
+//Data island guard band on lanes 1 and 2 (5.2.3.3). Lane 0 sends TERC4 0b11xx instead.
+static const uint16_t g_islandGuard = 0x133;
+
+//TERC4 codes (5.4.3)
+static const uint16_t g_terc4Codes[16] =
+{
+	0x29c, 0x263, 0x2e4, 0x2e2, 0x171, 0x11e, 0x18e, 0x13c,
+	0x2cc, 0x139, 0x19c, 0x2c6, 0x28e, 0x271, 0x163, 0x2c3
+};
+
+///@brief Number of TERC4 symbols in one data island packet
+static const size_t g_islandPacketLength = 32;
+
+/**
+	@brief Decodes a TERC4 symbol
+
+	@return The 4-bit value, or 0xff if the code is not a valid TERC4 symbol
+ */
+static uint8_t DecodeTERC4(uint16_t code)
+{
+	static const auto table = []
+	{
+		array<uint8_t, 1024> t;
+		t.fill(0xff);
+		for(uint8_t i=0; i<16; i++)
+			t[g_terc4Codes[i]] = i;
+		return t;
+	}();
+	return table[code & 0x3ff];
+}
+
+///@brief Returns the index of the control code matching a symbol, or -1 if none
+static int MatchControlCode(uint16_t code)
+{
+	for(int j=0; j<4; j++)
+	{
+		if(code == g_controlCodes[j])
+			return j;
+	}
+	return -1;
+}
+
+/**
+	@brief Extracts the 10-bit symbol starting at bit position i of an LSB-first packed bitstream
+
+	The bitstream must have one word of padding past the last valid bit.
+ */
+static inline uint16_t ExtractSymbol(const vector<uint64_t>& bits, size_t i)
+{
+	size_t word = i >> 6;
+	size_t bit = i & 63;
+	uint64_t v = bits[word] >> bit;
+	if(bit > 54)
+		v |= bits[word+1] << (64 - bit);
+	return v & 0x3ff;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Actual decoder logic
 
@@ -89,6 +161,16 @@ void TMDSDecoder::Refresh()
 	din->PrepareForCpuAccess();
 	clkin->PrepareForCpuAccess();
 
+	//Record the value of the data stream at each clock edge
+	SparseDigitalWaveform sampdata;
+	SampleOnAnyEdgesBase(din, clkin, sampdata);
+	size_t nbits = sampdata.m_samples.size();
+	if(nbits < 32)
+	{
+		SetData(NULL, 0);
+		return;
+	}
+
 	//Create the capture
 	auto cap = new TMDSWaveform;
 	cap->m_timescale = 1;
@@ -96,155 +178,156 @@ void TMDSDecoder::Refresh()
 	cap->m_startFemtoseconds = din->m_startFemtoseconds;
 	cap->PrepareForCpuAccess();
 
-	//Record the value of the data stream at each clock edge
-	SparseDigitalWaveform sampdata;
-	SampleOnAnyEdgesBase(din, clkin, sampdata);
+	//Pack the sampled bits LSB first so symbols can be pulled out with a couple of shifts
+	vector<uint64_t> bits((nbits + 63) / 64 + 1, 0);
+	for(size_t i=0; i<nbits; i++)
+	{
+		if(sampdata.m_samples[i])
+			bits[i >> 6] |= (1ULL << (i & 63));
+	}
 
 	/*
 		Look for preamble data. We need this to synchronize. (HDMI 1.4 spec section 5.4.2)
 
-		TMDS sends the LSB first.
-		Since element 0 of a C++ array is leftmost, this table has bit ordering mirrored from the spec.
+		Slide a 10-bit window over the stream and count control codes at each phase. The phase with the most
+		matches is the symbol alignment.
 	 */
-	static const bool control_codes[4][10] =
+	size_t num_preambles[10] = {0};
+	uint16_t window = ExtractSymbol(bits, 0);
+	for(size_t i=0; i+10 <= nbits; i++)
 	{
-		{ 0, 0, 1, 0, 1, 0, 1, 0, 1, 1 },
-		{ 1, 1, 0, 1, 0, 1, 0, 1, 0, 0 },
-		{ 0, 0, 1, 0, 1, 0, 1, 0, 1, 0 },
-		{ 1, 1, 0, 1, 0, 1, 0, 1, 0, 1 }
-	};
+		if(MatchControlCode(window) >= 0)
+			num_preambles[i % 10] ++;
 
-	size_t max_preambles = 0;
+		//Shift in the next bit
+		if(i + 10 < nbits)
+			window = (window >> 1) | (sampdata.m_samples[i+10] << 9);
+	}
 	size_t max_offset = 0;
-	for(size_t offset=0; offset < 10; offset ++)
+	for(size_t offset=1; offset < 10; offset ++)
 	{
-		size_t num_preambles[4] = {0};
-		for(size_t i=0; i<sampdata.m_samples.size() - 20; i += 10)
-		{
-			//Look for control code "j" at phase "offset", position "i" within the data stream
-			for(size_t j=0; j<4; j++)
-			{
-				bool match = true;
-				for(size_t k=0; k<10; k++)
-				{
-					if(sampdata.m_samples[i+offset+k] != control_codes[j][k])
-						match = false;
-				}
-				if(match)
-				{
-					num_preambles[j] ++;
-					break;
-				}
-			}
-		}
-
-		for(size_t j=0; j<4; j++)
-		{
-			if(num_preambles[j] > max_preambles)
-			{
-				max_preambles = num_preambles[j];
-				max_offset = offset;
-			}
-		}
+		if(num_preambles[offset] > num_preambles[max_offset])
+			max_offset = offset;
 	}
 
 	int lane = m_parameters[m_lanename].GetIntVal();
-
-	//HDMI Video guard band (HDMI 1.4 spec 5.2.2.1)
-	static const bool video_guard[3][10] =
-	{
-		{ 0, 0, 1, 1, 0, 0, 1, 1, 0, 1 },
-		{ 1, 1, 0, 0, 1, 1, 0, 0, 1, 0 },		//also used for data guard band, 5.2.3.3
-		{ 0, 0, 1, 1, 0, 0, 1, 1, 0, 1 },
-	};
-
-	//TODO: TERC4 (5.4.3)
+	if( (lane < 0) || (lane > 2) )
+		lane = 0;
 
 	enum
 	{
-		TYPE_DATA,
-		TYPE_PREAMBLE,
-		TYPE_GUARD
-	} last_symbol_type = TYPE_DATA;
+		MODE_VIDEO,
+		MODE_PREAMBLE,
+		MODE_GUARD,
+		MODE_ISLAND
+	} mode = MODE_VIDEO;
 
 	//Decode the actual data
-	size_t sampmax = sampdata.m_samples.size()-11;
-	for(size_t i=max_offset; i<sampmax; i+= 10)
+	size_t nguard = 0;
+	for(size_t i=max_offset; i+10 < nbits; i+= 10)
 	{
-		bool match = true;
+		uint16_t code = ExtractSymbol(bits, i);
+		int64_t off = sampdata.m_offsets[i];
+		int64_t dur = sampdata.m_offsets[i+10] - off;
 
 		//Check for control codes at any point in the sequence
-		for(size_t j=0; j<4; j++)
+		int ctl = MatchControlCode(code);
+		if(ctl >= 0)
 		{
-			match = true;
-			for(size_t k=0; k<10; k++)
-			{
-				if(sampdata.m_samples[i+k] != control_codes[j][k])
-					match = false;
-			}
+			cap->m_offsets.push_back(off);
+			cap->m_durations.push_back(dur);
+			cap->m_samples.push_back(TMDSSymbol(TMDSSymbol::TMDS_TYPE_CONTROL, ctl));
 
-			if(match)
-			{
-				cap->m_offsets.push_back(sampdata.m_offsets[i]);
-				cap->m_durations.push_back(sampdata.m_offsets[i+10] - sampdata.m_offsets[i]);
-				cap->m_samples.push_back(TMDSSymbol(TMDSSymbol::TMDS_TYPE_CONTROL, j));
-
-				last_symbol_type = TYPE_PREAMBLE;
-				break;
-			}
+			mode = MODE_PREAMBLE;
+			nguard = 0;
+			continue;
 		}
 
-		if(match)
-			continue;
+		uint8_t terc4 = DecodeTERC4(code);
 
-		//Check for HDMI video/control leading guard band
-		if( (last_symbol_type == TYPE_PREAMBLE) || (last_symbol_type == TYPE_GUARD) )
+		/*
+			Leading guard band (two symbols) after a preamble tells us whether a video or data island period follows.
+			Lane 0 sends TERC4 0b11xx (HSYNC/VSYNC in the low bits) before data islands. Lane 1 sends the same pattern
+			for both, so look ahead for a full packet worth of TERC4 symbols to tell them apart.
+		 */
+		if( (mode == MODE_PREAMBLE) || ( (mode == MODE_GUARD) && (nguard < 2) ) )
 		{
-			match = true;
-			for(size_t k=0; k<10; k++)
+			bool video = (code == g_videoGuard[lane]);
+			bool island = false;
+			if(lane == 0)
+				island = (terc4 != 0xff) && ( (terc4 & 0xc) == 0xc);
+			else if(lane == 2)
+				island = (code == g_islandGuard);
+			else if(video)
 			{
-				if(sampdata.m_samples[i+k] != video_guard[lane][k])
-					match = false;
+				size_t first = i + 10*(2 - nguard);
+				island = true;
+				for(size_t k=0; k<g_islandPacketLength; k++)
+				{
+					size_t pos = first + 10*k;
+					if( (pos + 10 >= nbits) || (DecodeTERC4(ExtractSymbol(bits, pos)) == 0xff) )
+					{
+						island = false;
+						break;
+					}
+				}
+				video = !island;
 			}
 
-			if(match)
+			if(video || island)
 			{
-				cap->m_offsets.push_back(sampdata.m_offsets[i]);
-				cap->m_durations.push_back(sampdata.m_offsets[i+10] - sampdata.m_offsets[i]);
-				cap->m_samples.push_back(TMDSSymbol(TMDSSymbol::TMDS_TYPE_GUARD, 0));
-				//last_symbol_type = TYPE_GUARD;
-				break;
+				cap->m_offsets.push_back(off);
+				cap->m_durations.push_back(dur);
+				cap->m_samples.push_back(TMDSSymbol(TMDSSymbol::TMDS_TYPE_GUARD, island));
+
+				mode = MODE_GUARD;
+				nguard ++;
+				if(nguard == 2)
+					mode = island ? MODE_ISLAND : MODE_VIDEO;
+				continue;
 			}
+
+			//No guard band (DVI, or HDMI without guard bands): video data follows the preamble directly
+			mode = MODE_VIDEO;
 		}
 
-		if(match)
+		//Data islands carry TERC4 until the trailing guard band
+		if(mode == MODE_ISLAND)
+		{
+			if( (lane != 0) && (code == g_islandGuard) )
+			{
+				cap->m_offsets.push_back(off);
+				cap->m_durations.push_back(dur);
+				cap->m_samples.push_back(TMDSSymbol(TMDSSymbol::TMDS_TYPE_GUARD, 1));
+			}
+			else if(terc4 == 0xff)
+			{
+				cap->m_offsets.push_back(off);
+				cap->m_durations.push_back(dur);
+				cap->m_samples.push_back(TMDSSymbol(TMDSSymbol::TMDS_TYPE_ERROR, 0));
+			}
+			else
+			{
+				cap->m_offsets.push_back(off);
+				cap->m_durations.push_back(dur);
+				cap->m_samples.push_back(TMDSSymbol(TMDSSymbol::TMDS_TYPE_TERC4, terc4));
+			}
 			continue;
+		}
 
-		//Whatever is left is assumed to be video data
-		bool d9 = sampdata.m_samples[i+9];
-		bool d8 = sampdata.m_samples[i+8];
-
-		uint8_t d = sampdata.m_samples[i+0] |
-					(sampdata.m_samples[i+1] << 1) |
-					(sampdata.m_samples[i+2] << 2) |
-					(sampdata.m_samples[i+3] << 3) |
-					(sampdata.m_samples[i+4] << 4) |
-					(sampdata.m_samples[i+5] << 5) |
-					(sampdata.m_samples[i+6] << 6) |
-					(sampdata.m_samples[i+7] << 7);
-
-		if(d9)
+		//Whatever is left is assumed to be video data (HDMI 1.4 spec 5.4.4.2)
+		uint8_t d = code & 0xff;
+		if(code & 0x200)
 			d ^= 0xff;
 
-		if(d8)
+		if(code & 0x100)
 			d ^= (d << 1);
 		else
 			d ^= (d << 1) ^ 0xfe;
 
-		cap->m_offsets.push_back(sampdata.m_offsets[i]);
-		cap->m_durations.push_back(sampdata.m_offsets[i+10] - sampdata.m_offsets[i]);
+		cap->m_offsets.push_back(off);
+		cap->m_durations.push_back(dur);
 		cap->m_samples.push_back(TMDSSymbol(TMDSSymbol::TMDS_TYPE_DATA, d));
-		last_symbol_type = TYPE_DATA;
 	}
 
 	SetData(cap, 0);
@@ -264,6 +347,7 @@ std::string TMDSWaveform::GetColor(size_t i)
 			return StandardColors::colors[StandardColors::COLOR_PREAMBLE];
 
 		case TMDSSymbol::TMDS_TYPE_DATA:
+		case TMDSSymbol::TMDS_TYPE_TERC4:
 			return StandardColors::colors[StandardColors::COLOR_DATA];
 
 		case TMDSSymbol::TMDS_TYPE_ERROR:
@@ -284,7 +368,14 @@ string TMDSWaveform::GetText(size_t i)
 			break;
 
 		case TMDSSymbol::TMDS_TYPE_GUARD:
-			return "GB";
+			if(s.m_data)
+				return "DGB";
+			else
+				return "GB";
+
+		case TMDSSymbol::TMDS_TYPE_TERC4:
+			snprintf(tmp, sizeof(tmp), "T%x", s.m_data);
+			break;
 
 		case TMDSSymbol::TMDS_TYPE_DATA:
 			snprintf(tmp, sizeof(tmp), "%02x", s.m_data);
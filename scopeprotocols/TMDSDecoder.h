@@ -42,9 +42,10 @@ public:
 	enum TMDSType
 	{
 		TMDS_TYPE_CONTROL,
-		TMDS_TYPE_GUARD,
+		TMDS_TYPE_GUARD,		//data is 0 for a video guard band, 1 for a data island guard band
 		TMDS_TYPE_ERROR,
-		TMDS_TYPE_DATA
+		TMDS_TYPE_DATA,
+		TMDS_TYPE_TERC4			//data is the decoded 4-bit value
 	};
 
 	//default constructor for STL
@@ -38,16 +38,9 @@ using namespace std;
 ThresholdFilter::ThresholdFilter(const string& color)
 	: Filter(color, CAT_MATH)
 {
-	AddDigitalStream("data");
-	CreateInput("din");
-
+	ApplyDescriptor(Describe());
 	m_threshname = "Threshold";
-	m_parameters[m_threshname] = FilterParameter(FilterParameter::TYPE_FLOAT, Unit(Unit::UNIT_VOLTS));
-	m_parameters[m_threshname].SetFloatVal(0);
-
 	m_hysname = "Hysteresis";
-	m_parameters[m_hysname] = FilterParameter(FilterParameter::TYPE_FLOAT, Unit(Unit::UNIT_VOLTS));
-	m_parameters[m_hysname].SetFloatVal(0);
 
 	if(g_hasShaderInt8)
 	{
@@ -80,6 +73,27 @@ string ThresholdFilter::GetProtocolName()
 	return "Threshold";
 }
 
+/**
+	@brief Describes the filter's interface without constructing it. The constructor applies the same descriptor.
+ */
+FilterDescriptor ThresholdFilter::Describe()
+{
+	FilterDescriptor desc(GetProtocolName(), CAT_MATH);
+	desc.AddInput("din");
+	desc.AddOutput("data", Stream::STREAM_TYPE_DIGITAL, Unit(Unit::UNIT_COUNTS));
+
+	FilterParameter thresh(FilterParameter::TYPE_FLOAT, Unit(Unit::UNIT_VOLTS));
+	thresh.SetFloatVal(0);
+	desc.AddParameter("Threshold", thresh);
+
+	FilterParameter hys(FilterParameter::TYPE_FLOAT, Unit(Unit::UNIT_VOLTS));
+	hys.SetFloatVal(0);
+	desc.AddParameter("Hysteresis", hys);
+
+	desc.SetCapabilities(FilterDescriptor::CAP_CPU_INPUT | FilterDescriptor::CAP_GPU_INPUT);
+	return desc;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Actual decoder logic
 
@@ -118,9 +132,10 @@ void ThresholdFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, std::shared_ptr<Q
 		//Optimized inner loop if no hysteresis
 		if(hys == 0)
 		{
-			#pragma omp parallel for
-			for(size_t i=0; i<len; i++)
+			ThreadPool::GetDefault().ParallelFor(0, len, [&](size_t i)
+			{
 				cap->m_samples[i] = sdin->m_samples[i] > midpoint;
+			});
 		}
 		else
 		{
@@ -176,9 +191,10 @@ void ThresholdFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, std::shared_ptr<Q
 				din->PrepareForCpuAccess();
 				cap->PrepareForCpuAccess();
 
-				#pragma omp parallel for
-				for(size_t i=0; i<len; i++)
+				ThreadPool::GetDefault().ParallelFor(0, len, [&](size_t i)
+				{
 					cap->m_samples[i] = udin->m_samples[i] > midpoint;
+				});
 
 				cap->MarkModifiedFromCpu();
 			}
@@ -115,91 +115,99 @@ void TimeOutsideLevelMeasurement::Refresh()
 
 	if (uadin)
 	{
-		#pragma omp parallel
-		#pragma omp single nowait
+		TaskGroup group;
+		if (processhigh == true)
 		{
-			if (processhigh == true)
+			group.Run([&]()
 			{
-				#pragma omp task
+				size_t i = 0;
+				int64_t temp1 = 0;
+				int64_t temp2 = 0;
+
+				while (i < length)
 				{
-					size_t i = 0;
-					int64_t temp1 = 0;
-					int64_t temp2 = 0;
+					//Find index of the sample with value greater than the high threshold
+					if ((uadin->m_samples[i] > highlevel) && (temp1 == 0))
+					{
+						temp1 = i;
+					}
 
-					while (i < length)
+					//Find index of the next sample with value less than or equal to the high threshold
+					//Subtract temp1 from it to get the duration of high time
+					//Sum all such durations to get the time above high threshold
+					if ((((uadin->m_samples[i] <= highlevel) && (temp2 == 0)) || (i == (length - 1))) && (temp1 != 0))
 					{
-						//Find index of the sample with value greater than the high threshold
-						if ((uadin->m_samples[i] > highlevel) && (temp1 == 0))
-						{
-							temp1 = i;
-						}
-
-						//Find index of the next sample with value less than or equal to the high threshold
-						//Subtract temp1 from it to get the duration of high time
-						//Sum all such durations to get the time above high threshold
-						if ((((uadin->m_samples[i] <= highlevel) && (temp2 == 0)) || (i == (length - 1))) && (temp1 != 0))
-						{
-							temp2 = i;
-							hightime += (temp2 - temp1);
-							temp2 = 0;
-							temp1 = 0;
-						}
-
-						i++;
+						temp2 = i;
+						hightime += (temp2 - temp1);
+						temp2 = 0;
+						temp1 = 0;
 					}
+
+					i++;
 				}
-			}
+			});
+		}
 
-			if (processlow == true)
+		if (processlow == true)
+		{
+			group.Run([&]()
 			{
-				#pragma omp task
+				size_t i = 0;
+				int64_t temp1 = 0;
+				int64_t temp2 = 0;
+
+				while (i < length)
 				{
-					size_t i = 0;
-					int64_t temp1 = 0;
-					int64_t temp2 = 0;
+					//Find index of the sample with value less than the low threshold
+					if ((uadin->m_samples[i] < lowlevel) && (temp1 == 0))
+					{
+						temp1 = i;
+					}
 
-					while (i < length)
+					//Find index of the next sample with value greater than or equal to the low threshold
+					//Subtract temp1 from it to get the duration of low time
+					//Sum all such durations to get the time below low threshold
+					if ((((uadin->m_samples[i] >= lowlevel) && (temp2 == 0)) || (i == (length - 1))) && (temp1 != 0))
 					{
-						//Find index of the sample with value less than the low threshold
-						if ((uadin->m_samples[i] < lowlevel) && (temp1 == 0))
-						{
-							temp1 = i;
-						}
-
-						//Find index of the next sample with value greater than or equal to the low threshold
-						//Subtract temp1 from it to get the duration of low time
-						//Sum all such durations to get the time below low threshold
-						if ((((uadin->m_samples[i] >= lowlevel) && (temp2 == 0)) || (i == (length - 1))) && (temp1 != 0))
-						{
-							temp2 = i;
-							lowtime += (temp2 - temp1);
-							temp2 = 0;
-							temp1 = 0;
-						}
-
-						i++;
+						temp2 = i;
+						lowtime += (temp2 - temp1);
+						temp2 = 0;
+						temp1 = 0;
 					}
+
+					i++;
 				}
-			}
+			});
 		}
+		group.Wait();
 	}
 	else if (sadin)
 	{
-		#pragma omp parallel for
-		for(size_t i = 0; i < length; i++)
+		atomic<int64_t> sparsehigh(0);
+		atomic<int64_t> sparselow(0);
+		ThreadPool::GetDefault().ParallelForRange(0, length, [&](size_t begin, size_t end)
 		{
-			//Simply sum durations of all samples with value greater than the high threshold
-			if ((processhigh == true) && (sadin->m_samples[i] > highlevel))
+			int64_t chunkhigh = 0;
+			int64_t chunklow = 0;
+			for(size_t i = begin; i < end; i++)
 			{
-				hightime += sadin->m_durations[i];
-			}
+				//Simply sum durations of all samples with value greater than the high threshold
+				if ((processhigh == true) && (sadin->m_samples[i] > highlevel))
+				{
+					chunkhigh += sadin->m_durations[i];
+				}
 
-			//Simply sum durations of all samples with value less than the low threshold
-			if ((processlow == true) && (sadin->m_samples[i] < lowlevel))
-			{
-				lowtime += sadin->m_durations[i];
+				//Simply sum durations of all samples with value less than the low threshold
+				if ((processlow == true) && (sadin->m_samples[i] < lowlevel))
+				{
+					chunklow += sadin->m_durations[i];
+				}
 			}
-		}
+			sparsehigh += chunkhigh;
+			sparselow += chunklow;
+		});
+		hightime = sparsehigh;
+		lowtime = sparselow;
 	}
 
 	//Calculate total time
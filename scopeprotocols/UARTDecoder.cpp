@@ -210,9 +210,7 @@ void UARTDecoder::Refresh()
 void UARTDecoder::FinishPacket(Packet* pack)
 {
 	//length header
-	char tmp[128];
-	snprintf(tmp, sizeof(tmp), "%zu", pack->m_data.size());
-	pack->m_headers["Length"] = tmp;
+	pack->SetHeaderDecimal("Length", pack->m_data.size());
 
 	//ascii packet contents
 	string s;
@@ -233,19 +231,37 @@ std::string ByteWaveform::GetColor(size_t /*i*/)
 	return m_color;
 }
 
-string ByteWaveform::GetText(size_t i)
+uint16_t ByteWaveform::GetColorIndex(size_t /*i*/)
+{
+	//Every sample is the same color, so only go to the palette when it changes
+	if(m_colorName != m_color)
+	{
+		m_colorName = m_color;
+		m_colorIndex = ProtocolPalette::Intern(m_color);
+	}
+	return m_colorIndex;
+}
+
+void ByteWaveform::FormatText(size_t i, string& out)
 {
 	char c = m_samples[i];
 	char sbuf[16] = {0};
 	if(isprint(c))
 		sbuf[0] = c;
 	else if(c == '\r')		//special case common non-printable chars
-		return "\\r";
+		strcpy(sbuf, "\\r");
 	else if(c == '\n')
-		return "\\n";
+		strcpy(sbuf, "\\n");
 	else if(c == '\b')
-		return "\\b";
+		strcpy(sbuf, "\\b");
 	else
 		snprintf(sbuf, sizeof(sbuf), "\\x%02x", 0xFF & c);
-	return sbuf;
+	out = sbuf;
+}
+
+string ByteWaveform::GetText(size_t i)
+{
+	string ret;
+	FormatText(i, ret);
+	return ret;
 }
@@ -41,12 +41,18 @@
 class ByteWaveform : public SparseWaveform<char>
 {
 public:
-	ByteWaveform (const std::string& color) : SparseWaveform<char>(), m_color(color) {};
+	ByteWaveform (const std::string& color) : SparseWaveform<char>(), m_color(color), m_colorIndex(0) {};
 	virtual std::string GetText(size_t) override;
 	virtual std::string GetColor(size_t) override;
+	virtual void FormatText(size_t i, std::string& out) override;
+	virtual uint16_t GetColorIndex(size_t i) override;
 
 private:
 	const std::string& m_color;
+
+	///@brief The last value of m_color we looked up in the palette, and its index
+	std::string m_colorName;
+	uint16_t m_colorIndex;
 };
 
 class UARTDecoder : public PacketDecoder
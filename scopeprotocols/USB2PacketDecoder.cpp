@@ -114,7 +114,8 @@ void USB2PacketDecoder::Refresh()
 		STATE_TOKEN_1,
 		STATE_SOF_0,
 		STATE_SOF_1,
-		STATE_DATA
+		STATE_DATA,
+		STATE_PRE_ERR
 	} state = STATE_IDLE;
 
 	//Decode stuff
@@ -190,10 +191,10 @@ void USB2PacketDecoder::Refresh()
 						state = STATE_END;
 						break;
 
-					//TODO: handle low bandwidth PRE stuff
-					//for now assume USB 2.0 ERR
+					//Same PID is ERR (a handshake) at high speed, or PRE at full speed.
+					//PRE has no EOP, the low speed packet it's a preamble for follows straight after.
 					case USB2PacketSymbol::PID_PRE_ERR:
-						state = STATE_END;
+						state = STATE_PRE_ERR;
 						break;
 
 					case USB2PacketSymbol::PID_IN:
@@ -229,6 +230,18 @@ void USB2PacketDecoder::Refresh()
 				}
 				break;
 
+			//SYNC means this was a PRE and we have a new packet, EOP means it was ERR
+			case STATE_PRE_ERR:
+				if(sin.m_type == USB2PCSSymbol::TYPE_SYNC)
+					state = STATE_PID;
+				else if(sin.m_type != USB2PCSSymbol::TYPE_EOP)
+				{
+					cap->m_offsets.push_back(din->m_offsets[i]);
+					cap->m_durations.push_back(din->m_durations[i]);
+					cap->m_samples.push_back(USB2PacketSymbol(USB2PacketSymbol::TYPE_ERROR, 0));
+				}
+				break;
+
 			//Tokens cross byte boundaries YAY!
 			case STATE_TOKEN_0:
 
@@ -465,16 +478,16 @@ void USB2PacketDecoder::DecodeSof(USB2PacketWaveform* cap, size_t istart, size_t
 	//Make the packet
 	Packet* pack = new Packet;
 	pack->m_offset = cap->m_offsets[istart] * cap->m_timescale;
-	pack->m_headers["Type"] = "SOF";
+	pack->SetHeader("Type", "SOF");
 	char tmp[128];
 	snprintf(tmp, sizeof(tmp), "Sequence = %u", snframe.m_data);
 	pack->m_headers["Details"] = tmp;
 	pack->m_len = ((cap->m_offsets[icrc] + cap->m_durations[icrc]) * cap->m_timescale) - pack->m_offset;
 	m_packets.push_back(pack);
 
-	pack->m_headers["Device"] = "--";
-	pack->m_headers["Endpoint"] = "--";
-	pack->m_headers["Length"] = "2";
+	pack->SetHeader("Device", "--");
+	pack->SetHeader("Endpoint", "--");
+	pack->SetHeaderDecimal("Length", 2);
 }
 
 void USB2PacketDecoder::DecodeSetup(USB2PacketWaveform* cap, size_t istart, size_t& i)
@@ -566,14 +579,12 @@ void USB2PacketDecoder::DecodeSetup(USB2PacketWaveform* cap, size_t istart, size
 	//Make the packet
 	Packet* pack = new Packet;
 	pack->m_offset = cap->m_offsets[istart] * cap->m_timescale;
-	pack->m_headers["Type"] = "SETUP";
+	pack->SetHeader("Type", "SETUP");
 	pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_CONTROL];
 	char tmp[256];
-	snprintf(tmp, sizeof(tmp), "%d", saddr.m_data);
-	pack->m_headers["Device"] = tmp;
-	snprintf(tmp, sizeof(tmp), "%d", sendp.m_data);
-	pack->m_headers["Endpoint"] = tmp;
-	pack->m_headers["Length"] = "8";	//constant
+	pack->SetHeaderDecimal("Device", saddr.m_data);
+	pack->SetHeaderDecimal("Endpoint", sendp.m_data);
+	pack->SetHeaderDecimal("Length", 8);	//constant
 
 	//Decode setup details
 	uint8_t bmRequestType = data[0];
@@ -674,8 +685,6 @@ void USB2PacketDecoder::DecodeData(USB2PacketWaveform* cap, size_t istart, size_
 		return;
 	}
 
-	char tmp[256];
-
 	//Look for the DATA packet after the IN/OUT
 	auto sdatpid = cap->m_samples[i];
 	if(sdatpid.m_type != USB2PacketSymbol::TYPE_PID)
@@ -699,19 +708,17 @@ void USB2PacketDecoder::DecodeData(USB2PacketWaveform* cap, size_t istart, size_
 		pack->m_offset = cap->m_offsets[istart] * cap->m_timescale;
 		if( (cap->m_samples[istart].m_data & 0xf) == USB2PacketSymbol::PID_IN)
 		{
-			pack->m_headers["Type"] = "IN";
+			pack->SetHeader("Type", "IN");
 			pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_DATA_READ];
 		}
 		else
 		{
-			pack->m_headers["Type"] = "OUT";
+			pack->SetHeader("Type", "OUT");
 			pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_DATA_WRITE];
 		}
-		snprintf(tmp, sizeof(tmp), "%d", saddr.m_data);
-		pack->m_headers["Device"] = tmp;
-		snprintf(tmp, sizeof(tmp), "%d", sendp.m_data);
-		pack->m_headers["Endpoint"] = tmp;
-		pack->m_headers["Details"] = "NAK";
+		pack->SetHeaderDecimal("Device", saddr.m_data);
+		pack->SetHeaderDecimal("Endpoint", sendp.m_data);
+		pack->SetHeader("Details", "NAK");
 		m_packets.push_back(pack);
 
 		pack->m_len = ((cap->m_offsets[i] + cap->m_durations[i]) * cap->m_timescale) - pack->m_offset;
@@ -728,7 +735,7 @@ void USB2PacketDecoder::DecodeData(USB2PacketWaveform* cap, size_t istart, size_
 		//DEBUG
 		Packet* pack = new Packet;
 		pack->m_offset = cap->m_offsets[istart] * cap->m_timescale;
-		pack->m_headers["Details"] = "ERROR";
+		pack->SetHeader("Details", "ERROR");
 		pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_ERROR];
 		m_packets.push_back(pack);
 		return;
@@ -739,18 +746,16 @@ void USB2PacketDecoder::DecodeData(USB2PacketWaveform* cap, size_t istart, size_
 	pack->m_offset = cap->m_offsets[istart] * cap->m_timescale;
 	if( (cap->m_samples[istart].m_data & 0xf) == USB2PacketSymbol::PID_IN)
 	{
-		pack->m_headers["Type"] = "IN";
+		pack->SetHeader("Type", "IN");
 		pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_DATA_READ];
 	}
 	else
 	{
-		pack->m_headers["Type"] = "OUT";
+		pack->SetHeader("Type", "OUT");
 		pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_DATA_WRITE];
 	}
-	snprintf(tmp, sizeof(tmp), "%d", saddr.m_data);
-	pack->m_headers["Device"] = tmp;
-	snprintf(tmp, sizeof(tmp), "%d", sendp.m_data);
-	pack->m_headers["Endpoint"] = tmp;
+	pack->SetHeaderDecimal("Device", saddr.m_data);
+	pack->SetHeaderDecimal("Endpoint", sendp.m_data);
 
 	//Read the data
 	while(i < cap->m_samples.size())
@@ -806,15 +811,14 @@ void USB2PacketDecoder::DecodeData(USB2PacketWaveform* cap, size_t istart, size_
 	i++;
 
 	//Format the data
-	pack->m_headers["Details"] = ack;
+	pack->SetHeader("Details", ack);
 
-	snprintf(tmp, sizeof(tmp), "%zu", pack->m_data.size());
-	pack->m_headers["Length"] = tmp;
+	pack->SetHeaderDecimal("Length", pack->m_data.size());
 
 	m_packets.push_back(pack);
 }
 
-std::string USB2PacketWaveform::GetColor(size_t i)
+uint16_t USB2PacketWaveform::GetColorIndex(size_t i)
 {
 	auto sample = m_samples[i];
 	switch(sample.m_type)
@@ -822,38 +826,38 @@ std::string USB2PacketWaveform::GetColor(size_t i)
 		case USB2PacketSymbol::TYPE_PID:
 			if( (sample.m_data == USB2PacketSymbol::PID_RESERVED) ||
 				(sample.m_data == USB2PacketSymbol::PID_STALL) )
-				return StandardColors::colors[StandardColors::COLOR_ERROR];
+				return ProtocolPalette::GetStandardColor(StandardColors::COLOR_ERROR);
 			else
-				return StandardColors::colors[StandardColors::COLOR_PREAMBLE];
+				return ProtocolPalette::GetStandardColor(StandardColors::COLOR_PREAMBLE);
 
 		case USB2PacketSymbol::TYPE_ADDR:
-			return StandardColors::colors[StandardColors::COLOR_ADDRESS];
+			return ProtocolPalette::GetStandardColor(StandardColors::COLOR_ADDRESS);
 
 		case USB2PacketSymbol::TYPE_ENDP:
-			return StandardColors::colors[StandardColors::COLOR_ADDRESS];
+			return ProtocolPalette::GetStandardColor(StandardColors::COLOR_ADDRESS);
 
 		case USB2PacketSymbol::TYPE_NFRAME:
-			return StandardColors::colors[StandardColors::COLOR_DATA];
+			return ProtocolPalette::GetStandardColor(StandardColors::COLOR_DATA);
 
 		case USB2PacketSymbol::TYPE_CRC5_GOOD:
 		case USB2PacketSymbol::TYPE_CRC16_GOOD:
-			return StandardColors::colors[StandardColors::COLOR_CHECKSUM_OK];
+			return ProtocolPalette::GetStandardColor(StandardColors::COLOR_CHECKSUM_OK);
 
 		case USB2PacketSymbol::TYPE_CRC5_BAD:
 		case USB2PacketSymbol::TYPE_CRC16_BAD:
-			return StandardColors::colors[StandardColors::COLOR_CHECKSUM_BAD];
+			return ProtocolPalette::GetStandardColor(StandardColors::COLOR_CHECKSUM_BAD);
 
 		case USB2PacketSymbol::TYPE_DATA:
-			return StandardColors::colors[StandardColors::COLOR_DATA];
+			return ProtocolPalette::GetStandardColor(StandardColors::COLOR_DATA);
 
 		//invalid state, should never happen
 		case USB2PacketSymbol::TYPE_ERROR:
 		default:
-			return StandardColors::colors[StandardColors::COLOR_ERROR];
+			return ProtocolPalette::GetStandardColor(StandardColors::COLOR_ERROR);
 	}
 }
 
-string USB2PacketWaveform::GetText(size_t i)
+void USB2PacketWaveform::FormatText(size_t i, string& out)
 {
 	char tmp[32];
 
@@ -865,67 +869,104 @@ string USB2PacketWaveform::GetText(size_t i)
 			switch(sample.m_data & 0x0f)
 			{
 				case USB2PacketSymbol::PID_RESERVED:
-					return "RESERVED";
+					out = "RESERVED";
+					return;
 				case USB2PacketSymbol::PID_OUT:
-					return "OUT";
+					out = "OUT";
+					return;
 				case USB2PacketSymbol::PID_ACK:
-					return "ACK";
+					out = "ACK";
+					return;
 				case USB2PacketSymbol::PID_DATA0:
-					return "DATA0";
+					out = "DATA0";
+					return;
 				case USB2PacketSymbol::PID_PING:
-					return "PING";
+					out = "PING";
+					return;
 				case USB2PacketSymbol::PID_SOF:
-					return "SOF";
+					out = "SOF";
+					return;
 				case USB2PacketSymbol::PID_NYET:
-					return "NYET";
+					out = "NYET";
+					return;
 				case USB2PacketSymbol::PID_DATA2:
-					return "DATA2";
+					out = "DATA2";
+					return;
 				case USB2PacketSymbol::PID_SPLIT:
-					return "SPLIT";
+					out = "SPLIT";
+					return;
 				case USB2PacketSymbol::PID_IN:
-					return "IN";
+					out = "IN";
+					return;
 				case USB2PacketSymbol::PID_NAK:
-					return "NAK";
+					out = "NAK";
+					return;
 				case USB2PacketSymbol::PID_DATA1:
-					return "DATA1";
+					out = "DATA1";
+					return;
 				case USB2PacketSymbol::PID_PRE_ERR:
-					return "PRE/ERR";
+					out = "PRE/ERR";
+					return;
 				case USB2PacketSymbol::PID_SETUP:
-					return "SETUP";
+					out = "SETUP";
+					return;
 				case USB2PacketSymbol::PID_STALL:
-					return "STALL";
+					out = "STALL";
+					return;
 				case USB2PacketSymbol::PID_MDATA:
-					return "MDATA";
+					out = "MDATA";
+					return;
 
 				default:
-					return "INVALID PID";
+					out = "INVALID PID";
+					return;
 			}
 			break;
 		}
 		case USB2PacketSymbol::TYPE_ADDR:
-			return string("Dev ") + to_string(sample.m_data);
+			snprintf(tmp, sizeof(tmp), "Dev %u", sample.m_data);
+			out = tmp;
+			return;
 		case USB2PacketSymbol::TYPE_NFRAME:
-			return string("Frame ") + to_string(sample.m_data);
+			snprintf(tmp, sizeof(tmp), "Frame %u", sample.m_data);
+			out = tmp;
+			return;
 		case USB2PacketSymbol::TYPE_ENDP:
-			return string("EP ") + to_string(sample.m_data);
+			snprintf(tmp, sizeof(tmp), "EP %u", sample.m_data);
+			out = tmp;
+			return;
 
 		case USB2PacketSymbol::TYPE_CRC5_GOOD:
 		case USB2PacketSymbol::TYPE_CRC5_BAD:
 			snprintf(tmp, sizeof(tmp), "CRC %02x", sample.m_data);
-			return string(tmp);
+			out = tmp;
+			return;
 
 		case USB2PacketSymbol::TYPE_CRC16_GOOD:
 		case USB2PacketSymbol::TYPE_CRC16_BAD:
 			snprintf(tmp, sizeof(tmp), "CRC %04x", sample.m_data);
-			return string(tmp);
+			out = tmp;
+			return;
 
 		case USB2PacketSymbol::TYPE_DATA:
 			snprintf(tmp, sizeof(tmp), "%02x", sample.m_data);
-			return string(tmp);
+			out = tmp;
+			return;
 		case USB2PacketSymbol::TYPE_ERROR:
 		default:
-			return "ERROR";
+			out = "ERROR";
+			return;
 	}
+}
 
-	return "";
+string USB2PacketWaveform::GetText(size_t i)
+{
+	string ret;
+	FormatText(i, ret);
+	return ret;
+}
+
+std::string USB2PacketWaveform::GetColor(size_t i)
+{
+	return ProtocolPalette::GetString(GetColorIndex(i));
 }
@@ -0,0 +1,342 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of USB2TransferDecoder
+ */
+
+#include "../scopehal/scopehal.h"
+#include "USB2TransferDecoder.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+USB2TransferDecoder::USB2TransferDecoder(const string& color)
+	: PacketDecoder(color, CAT_SERIAL)
+{
+	CreateInput("packets");
+}
+
+USB2TransferDecoder::~USB2TransferDecoder()
+{
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Factory methods
+
+bool USB2TransferDecoder::ValidateChannel(size_t i, StreamDescriptor stream)
+{
+	if(stream.m_channel == NULL)
+		return false;
+
+	if( (i == 0) && (dynamic_cast<USB2PacketDecoder*>(stream.m_channel) != NULL) )
+		return true;
+
+	return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Accessors
+
+string USB2TransferDecoder::GetProtocolName()
+{
+	return "USB 1.x/2.0 Transfer";
+}
+
+vector<string> USB2TransferDecoder::GetHeaders()
+{
+	vector<string> ret;
+	ret.push_back("Type");
+	ret.push_back("Device");
+	ret.push_back("Endpoint");
+	ret.push_back("Status");
+	ret.push_back("Length");
+	ret.push_back("Transactions");
+	ret.push_back("NAKs");
+	ret.push_back("Details");
+	return ret;
+}
+
+bool USB2TransferDecoder::GetShowDataColumn()
+{
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Actual decoder logic
+
+void USB2TransferDecoder::Refresh()
+{
+	ClearPackets();
+	m_tracker.Clear();
+
+	if(!VerifyAllInputsOK())
+	{
+		SetData(NULL, 0);
+		return;
+	}
+
+	auto din = dynamic_cast<USB2PacketWaveform*>(GetInputWaveform(0));
+	din->PrepareForCpuAccess();
+
+	//Run everything through the tracker
+	vector<USB2Packet> packets;
+	USB2TransferTracker::GetPackets(din, packets);
+	for(auto& p : packets)
+		m_tracker.AddPacket(p);
+	m_tracker.Flush();
+
+	//One symbol per transaction
+	auto cap = new USB2TransferWaveform;
+	cap->m_timescale = 1;
+	cap->m_startTimestamp = din->m_startTimestamp;
+	cap->m_startFemtoseconds = din->m_startFemtoseconds;
+	cap->m_triggerPhase = 0;
+	cap->PrepareForCpuAccess();
+
+	auto& transactions = m_tracker.GetTransactions();
+	for(auto& t : transactions)
+	{
+		cap->m_offsets.push_back(t.m_start);
+		cap->m_durations.push_back(t.m_end - t.m_start);
+		cap->m_samples.push_back(USB2TransactionSymbol(t));
+	}
+	SetData(cap, 0);
+
+	//One packet per transfer. These are completed out of order, so sort them by start time.
+	auto& transfers = m_tracker.GetTransfers();
+	vector<size_t> order;
+	for(size_t i=0; i<transfers.size(); i++)
+		order.push_back(i);
+	stable_sort(order.begin(), order.end(),
+		[&transfers](size_t a, size_t b) { return transfers[a].m_start < transfers[b].m_start; });
+
+	const char* types[5] = { "Control", "Isochronous", "Bulk", "Interrupt", "Data" };
+	for(auto i : order)
+	{
+		auto& xfer = transfers[i];
+
+		auto pack = new Packet;
+		pack->m_offset = xfer.m_start;
+		pack->m_len = xfer.m_end - xfer.m_start;
+		pack->m_data = xfer.m_data;
+		m_packets.push_back(pack);
+
+		pack->SetHeader("Type", types[xfer.m_type]);
+		pack->SetHeaderDecimal("Device", xfer.m_addr);
+		if(xfer.m_type == USB2Transfer::TYPE_CONTROL)
+			pack->SetHeaderDecimal("Endpoint", xfer.m_endpoint);
+		else
+			pack->SetHeader("Endpoint", to_string(xfer.m_endpoint & 0x0f) + ((xfer.m_endpoint & 0x80) ? " IN" : " OUT"));
+		pack->SetHeaderDecimal("Length", xfer.m_data.size());
+		pack->SetHeaderDecimal("Transactions", xfer.m_transactions);
+		pack->SetHeaderDecimal("NAKs", xfer.m_naks);
+
+		if(xfer.m_type == USB2Transfer::TYPE_CONTROL)
+			pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_CONTROL];
+		else if(xfer.m_endpoint & 0x80)
+			pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_DATA_READ];
+		else
+			pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_DATA_WRITE];
+
+		switch(xfer.m_status)
+		{
+			case USB2Transfer::STATUS_COMPLETE:
+				pack->SetHeader("Status", "OK");
+				break;
+
+			case USB2Transfer::STATUS_STALLED:
+				pack->SetHeader("Status", "STALL");
+				pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_ERROR];
+				break;
+
+			case USB2Transfer::STATUS_ABORTED:
+				pack->SetHeader("Status", "Aborted");
+				pack->m_displayBackgroundColor = m_backgroundColors[PROTO_COLOR_ERROR];
+				break;
+
+			case USB2Transfer::STATUS_INCOMPLETE:
+			default:
+				pack->SetHeader("Status", "Incomplete");
+				break;
+		}
+
+		pack->m_headers["Details"] = GetDetails(xfer);
+	}
+
+	cap->MarkModifiedFromCpu();
+}
+
+/**
+	@brief Describes the request made by a control transfer, and any descriptors or status it returned
+ */
+string USB2TransferDecoder::GetDetails(const USB2Transfer& xfer)
+{
+	string ret;
+	if(xfer.m_hasSetup)
+	{
+		auto& setup = xfer.m_setup;
+		ret = USB2TransferTracker::FormatRequest(setup);
+
+		if( (setup.GetType() == USB2SetupPacket::TYPE_STANDARD) && setup.IsDeviceToHost() && !xfer.m_data.empty())
+		{
+			char tmp[32];
+			switch(setup.m_request)
+			{
+				case USB2SetupPacket::REQ_GET_DESCRIPTOR:
+					ret += ": " + USB2TransferTracker::FormatDescriptors(xfer.m_data, setup.m_value == 0x0300);
+					break;
+
+				case USB2SetupPacket::REQ_GET_STATUS:
+					if(xfer.m_data.size() >= 2)
+					{
+						snprintf(tmp, sizeof(tmp), ": %04x", (xfer.m_data[1] << 8) | xfer.m_data[0]);
+						ret += tmp;
+					}
+					break;
+
+				case USB2SetupPacket::REQ_GET_CONFIGURATION:
+				case USB2SetupPacket::REQ_GET_INTERFACE:
+					ret += ": " + to_string(xfer.m_data[0]);
+					break;
+
+				default:
+					break;
+			}
+		}
+	}
+
+	if(xfer.m_retries)
+	{
+		if(!ret.empty())
+			ret += ", ";
+		ret += to_string(xfer.m_retries) + ((xfer.m_retries == 1) ? " retry" : " retries");
+	}
+
+	return ret;
+}
+
+std::string USB2TransferWaveform::GetColor(size_t i)
+{
+	auto& s = m_samples[i];
+
+	switch(s.m_handshake)
+	{
+		case USB2Transaction::HANDSHAKE_ACK:
+		case USB2Transaction::HANDSHAKE_NYET:
+			if(s.m_token == USB2PacketSymbol::PID_SETUP)
+				return StandardColors::colors[StandardColors::COLOR_CONTROL];
+			return StandardColors::colors[StandardColors::COLOR_DATA];
+
+		case USB2Transaction::HANDSHAKE_NAK:
+			return StandardColors::colors[StandardColors::COLOR_IDLE];
+
+		//Isochronous data doesn't get a handshake, anything else should have
+		case USB2Transaction::HANDSHAKE_NONE:
+			if(s.m_hasData)
+				return StandardColors::colors[StandardColors::COLOR_DATA];
+			return StandardColors::colors[StandardColors::COLOR_ERROR];
+
+		case USB2Transaction::HANDSHAKE_STALL:
+		case USB2Transaction::HANDSHAKE_ERROR:
+		default:
+			return StandardColors::colors[StandardColors::COLOR_ERROR];
+	}
+}
+
+string USB2TransferWaveform::GetText(size_t i)
+{
+	auto& s = m_samples[i];
+
+	string ret;
+	switch(s.m_token)
+	{
+		case USB2PacketSymbol::PID_IN:
+			ret = "IN";
+			break;
+
+		case USB2PacketSymbol::PID_OUT:
+			ret = "OUT";
+			break;
+
+		case USB2PacketSymbol::PID_SETUP:
+			ret = "SETUP";
+			break;
+
+		case USB2PacketSymbol::PID_PING:
+		default:
+			ret = "PING";
+			break;
+	}
+
+	char tmp[64];
+	snprintf(tmp, sizeof(tmp), " %u.%u", s.m_addr, s.m_endp);
+	ret += tmp;
+	if(s.m_hasData)
+		ret += " " + to_string(s.m_length) + ( (s.m_length == 1) ? " byte" : " bytes");
+
+	switch(s.m_handshake)
+	{
+		case USB2Transaction::HANDSHAKE_ACK:
+			ret += " ACK";
+			break;
+
+		case USB2Transaction::HANDSHAKE_NAK:
+			ret += " NAK";
+			break;
+
+		case USB2Transaction::HANDSHAKE_STALL:
+			ret += " STALL";
+			break;
+
+		case USB2Transaction::HANDSHAKE_NYET:
+			ret += " NYET";
+			break;
+
+		case USB2Transaction::HANDSHAKE_NONE:
+			if(!s.m_hasData)
+				ret += " no response";
+			break;
+
+		case USB2Transaction::HANDSHAKE_ERROR:
+		default:
+			ret += " error";
+			break;
+	}
+
+	if(s.m_retry)
+		ret += " (retry)";
+
+	return ret;
+}
@@ -0,0 +1,116 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of USB2TransferDecoder
+ */
+#ifndef USB2TransferDecoder_h
+#define USB2TransferDecoder_h
+
+#include "../scopehal/PacketDecoder.h"
+#include "USB2TransferTracker.h"
+
+/**
+	@brief A single transaction
+ */
+class USB2TransactionSymbol
+{
+public:
+	USB2TransactionSymbol()
+	{}
+
+	USB2TransactionSymbol(const USB2Transaction& t)
+		: m_token(t.m_token)
+		, m_addr(t.m_addr)
+		, m_endp(t.m_endp)
+		, m_hasData(t.m_hasData)
+		, m_length(t.m_data.size())
+		, m_handshake(t.m_handshake)
+		, m_retry(t.m_retry)
+	{}
+
+	USB2PacketSymbol::Pids m_token;
+	uint8_t m_addr;
+	uint8_t m_endp;
+	bool m_hasData;
+	uint16_t m_length;
+	USB2Transaction::Handshake m_handshake;
+	bool m_retry;
+
+	bool operator==(const USB2TransactionSymbol& s) const
+	{
+		return (m_token == s.m_token) && (m_addr == s.m_addr) && (m_endp == s.m_endp) && (m_hasData == s.m_hasData) &&
+			(m_length == s.m_length) && (m_handshake == s.m_handshake) && (m_retry == s.m_retry);
+	}
+};
+
+class USB2TransferWaveform : public SparseWaveform<USB2TransactionSymbol>
+{
+public:
+	USB2TransferWaveform () : SparseWaveform<USB2TransactionSymbol>() {};
+	virtual std::string GetText(size_t) override;
+	virtual std::string GetColor(size_t) override;
+};
+
+/**
+	@brief Groups USB 1.x/2.0 packets into transactions and transfers
+
+	Outputs one symbol per transaction, and one packet per control, bulk, interrupt or isochronous transfer. Standard
+	requests and the descriptors they return are decoded. Per-endpoint statistics are available from GetTracker().
+ */
+class USB2TransferDecoder : public PacketDecoder
+{
+public:
+	USB2TransferDecoder(const std::string& color);
+	virtual ~USB2TransferDecoder();
+
+	virtual void Refresh() override;
+
+	static std::string GetProtocolName();
+
+	virtual bool ValidateChannel(size_t i, StreamDescriptor stream) override;
+
+	virtual std::vector<std::string> GetHeaders() override;
+	virtual bool GetShowDataColumn() override;
+
+	///@brief Transactions, transfers and endpoint statistics from the last refresh
+	const USB2TransferTracker& GetTracker() const
+	{ return m_tracker; }
+
+	PROTOCOL_DECODER_INITPROC(USB2TransferDecoder)
+
+protected:
+	std::string GetDetails(const USB2Transfer& xfer);
+
+	USB2TransferTracker m_tracker;
+};
+
+#endif
@@ -0,0 +1,1084 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of USB2TransferTracker
+ */
+
+#include "../scopehal/scopehal.h"
+#include "USB2TransferTracker.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// USB2SetupPacket
+
+/**
+	@brief Parses a setup packet from the payload of a SETUP transaction (must be 8 bytes)
+ */
+USB2SetupPacket::USB2SetupPacket(const vector<uint8_t>& data)
+	: m_requestType(data[0])
+	, m_request(data[1])
+	, m_value( (data[3] << 8) | data[2])
+	, m_index( (data[5] << 8) | data[4])
+	, m_length( (data[7] << 8) | data[6])
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// USB2EndpointStatistics
+
+/**
+	@brief Average payload throughput in bytes per second, from the first to the last transaction
+ */
+double USB2EndpointStatistics::GetThroughput() const
+{
+	int64_t span = m_lastActivity - m_firstActivity;
+	if(span <= 0)
+		return 0;
+	return m_bytes * FS_PER_SECOND / span;
+}
+
+/**
+	@brief Fraction of the time from the first to the last transaction that the bus was busy with this endpoint
+ */
+double USB2EndpointStatistics::GetBusUtilization() const
+{
+	int64_t span = m_lastActivity - m_firstActivity;
+	if(span <= 0)
+		return 0;
+	return static_cast<double>(m_busTime) / span;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Construction / destruction
+
+USB2TransferTracker::USB2TransferTracker()
+	: m_inTransaction(false)
+{
+}
+
+/**
+	@brief Resets all state, ready to process a new capture
+ */
+void USB2TransferTracker::Clear()
+{
+	m_transactions.clear();
+	m_transfers.clear();
+	m_stats.clear();
+	m_pipes.clear();
+	m_devices.clear();
+	m_inTransaction = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Input processing
+
+/**
+	@brief Splits the output of a USB2PacketDecoder into packets
+
+	@param wfm		Packet layer waveform
+	@param packets	Packets are appended here, in order
+ */
+void USB2TransferTracker::GetPackets(USB2PacketWaveform* wfm, vector<USB2Packet>& packets)
+{
+	USB2Packet pack;
+	bool inpacket = false;
+	bool complete = false;
+
+	size_t len = wfm->m_samples.size();
+	for(size_t i=0; i<len; i++)
+	{
+		auto& s = wfm->m_samples[i];
+		int64_t start = wfm->m_offsets[i] * wfm->m_timescale + wfm->m_triggerPhase;
+		int64_t end = start + wfm->m_durations[i] * wfm->m_timescale;
+
+		switch(s.m_type)
+		{
+			//Start of a new packet
+			case USB2PacketSymbol::TYPE_PID:
+				if(inpacket)
+				{
+					pack.m_error |= !complete;
+					packets.push_back(pack);
+				}
+
+				pack = USB2Packet();
+				pack.m_start = start;
+				pack.m_pid = static_cast<USB2PacketSymbol::Pids>(s.m_data & 0xf);
+				inpacket = true;
+
+				//Handshakes and prefixes are just a PID, everything else ends with a CRC
+				switch(pack.m_pid)
+				{
+					case USB2PacketSymbol::PID_ACK:
+					case USB2PacketSymbol::PID_NAK:
+					case USB2PacketSymbol::PID_STALL:
+					case USB2PacketSymbol::PID_NYET:
+					case USB2PacketSymbol::PID_PRE_ERR:
+						complete = true;
+						break;
+
+					default:
+						complete = false;
+						break;
+				}
+				break;
+
+			case USB2PacketSymbol::TYPE_ADDR:
+				pack.m_addr = s.m_data;
+				break;
+
+			case USB2PacketSymbol::TYPE_ENDP:
+				pack.m_endp = s.m_data;
+				break;
+
+			case USB2PacketSymbol::TYPE_NFRAME:
+				pack.m_frame = s.m_data;
+				break;
+
+			case USB2PacketSymbol::TYPE_DATA:
+				pack.m_data.push_back(s.m_data);
+				break;
+
+			case USB2PacketSymbol::TYPE_CRC5_GOOD:
+			case USB2PacketSymbol::TYPE_CRC16_GOOD:
+				complete = true;
+				break;
+
+			case USB2PacketSymbol::TYPE_CRC5_BAD:
+			case USB2PacketSymbol::TYPE_CRC16_BAD:
+				pack.m_crcOk = false;
+				complete = true;
+				break;
+
+			//Garbage ends the current packet
+			case USB2PacketSymbol::TYPE_ERROR:
+			default:
+				if(inpacket)
+				{
+					pack.m_end = end;
+					pack.m_error = true;
+					packets.push_back(pack);
+				}
+				inpacket = false;
+				continue;
+		}
+
+		pack.m_end = end;
+	}
+
+	if(inpacket)
+	{
+		pack.m_error |= !complete;
+		packets.push_back(pack);
+	}
+}
+
+/**
+	@brief Processes one packet. Packets must be added in order.
+ */
+void USB2TransferTracker::AddPacket(const USB2Packet& packet)
+{
+	bool bad = packet.m_error || !packet.m_crcOk;
+
+	switch(packet.m_pid)
+	{
+		//Tokens start a new transaction
+		case USB2PacketSymbol::PID_IN:
+		case USB2PacketSymbol::PID_OUT:
+		case USB2PacketSymbol::PID_SETUP:
+		case USB2PacketSymbol::PID_PING:
+			EndTransaction();
+
+			m_current = USB2Transaction();
+			m_current.m_start = packet.m_start;
+			m_current.m_end = packet.m_end;
+			m_current.m_token = packet.m_pid;
+			m_current.m_addr = packet.m_addr;
+			m_current.m_endp = packet.m_endp;
+			m_inTransaction = true;
+
+			//Devices ignore corrupted tokens, so nothing else will happen
+			if(bad)
+			{
+				m_current.m_handshake = USB2Transaction::HANDSHAKE_ERROR;
+				EndTransaction();
+			}
+			break;
+
+		case USB2PacketSymbol::PID_DATA0:
+		case USB2PacketSymbol::PID_DATA1:
+		case USB2PacketSymbol::PID_DATA2:
+		case USB2PacketSymbol::PID_MDATA:
+			if(!m_inTransaction || m_current.m_hasData || (m_current.m_token == USB2PacketSymbol::PID_PING) )
+				break;
+
+			m_current.m_hasData = true;
+			m_current.m_dataPid = packet.m_pid;
+			m_current.m_data = packet.m_data;
+			m_current.m_end = packet.m_end;
+
+			//Corrupted data doesn't get a handshake
+			if(bad)
+			{
+				m_current.m_dataError = true;
+				m_current.m_handshake = USB2Transaction::HANDSHAKE_ERROR;
+				EndTransaction();
+			}
+			break;
+
+		case USB2PacketSymbol::PID_ACK:
+		case USB2PacketSymbol::PID_NAK:
+		case USB2PacketSymbol::PID_STALL:
+		case USB2PacketSymbol::PID_NYET:
+			if(!m_inTransaction)
+				break;
+
+			switch(packet.m_pid)
+			{
+				case USB2PacketSymbol::PID_ACK:
+					m_current.m_handshake = USB2Transaction::HANDSHAKE_ACK;
+					break;
+
+				case USB2PacketSymbol::PID_NAK:
+					m_current.m_handshake = USB2Transaction::HANDSHAKE_NAK;
+					break;
+
+				case USB2PacketSymbol::PID_STALL:
+					m_current.m_handshake = USB2Transaction::HANDSHAKE_STALL;
+					break;
+
+				default:
+					m_current.m_handshake = USB2Transaction::HANDSHAKE_NYET;
+					break;
+			}
+			m_current.m_end = packet.m_end;
+			EndTransaction();
+			break;
+
+		//Start of frame can't be part of a transaction
+		case USB2PacketSymbol::PID_SOF:
+			EndTransaction();
+			break;
+
+		//SPLIT and PRE are prefixes to the following token, and don't affect the transaction itself.
+		//(ERR is only used by split transactions, which we don't follow through the hub)
+		case USB2PacketSymbol::PID_SPLIT:
+		case USB2PacketSymbol::PID_PRE_ERR:
+		default:
+			break;
+	}
+}
+
+/**
+	@brief Finishes processing at the end of a capture
+ */
+void USB2TransferTracker::Flush()
+{
+	EndTransaction();
+
+	for(auto& it : m_pipes)
+	{
+		if(it.second.m_active)
+			EndTransfer(it.second, USB2Transfer::STATUS_INCOMPLETE);
+	}
+}
+
+/**
+	@brief Completes the transaction in progress, if there is one
+ */
+void USB2TransferTracker::EndTransaction()
+{
+	if(!m_inTransaction)
+		return;
+	m_inTransaction = false;
+
+	AddTransaction(m_current);
+	m_transactions.push_back(m_current);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Transfer reassembly
+
+/**
+	@brief Updates endpoint statistics with a completed transaction and adds it to the transfer on its pipe
+ */
+void USB2TransferTracker::AddTransaction(USB2Transaction& t)
+{
+	//Figure out what kind of endpoint this is.
+	//Endpoint zero is always control, anything else we have to get from the configuration descriptor.
+	bool control = (t.m_endp == 0) || (t.m_token == USB2PacketSymbol::PID_SETUP);
+	uint8_t endpoint = t.m_endp | (t.IsIn() ? 0x80 : 0);
+	USB2EndpointInfo info(USB2Transfer::TYPE_CONTROL);
+
+	auto dit = m_devices.find(t.m_addr);
+	if(dit != m_devices.end())
+	{
+		auto& endpoints = dit->second.m_endpoints;
+		auto eit = endpoints.find(control ? t.m_endp : endpoint);
+		if(eit != endpoints.end())
+			info = eit->second;
+		else if(!control)
+			info = USB2EndpointInfo();
+	}
+	else if(!control)
+		info = USB2EndpointInfo();
+
+	//Control endpoints are bidirectional, so both directions share one pipe
+	if(info.m_type == USB2Transfer::TYPE_CONTROL)
+	{
+		control = true;
+		endpoint = t.m_endp;
+	}
+
+	auto key = GetKey(t.m_addr, endpoint);
+	auto& stats = m_stats[key];
+	if(stats.m_transactions == 0)
+		stats.m_firstActivity = t.m_start;
+	stats.m_lastActivity = t.m_end;
+	stats.m_busTime += t.m_end - t.m_start;
+	stats.m_transactions ++;
+	stats.m_type = info.m_type;
+
+	switch(t.m_handshake)
+	{
+		case USB2Transaction::HANDSHAKE_ACK:
+			stats.m_acks ++;
+			break;
+
+		case USB2Transaction::HANDSHAKE_NAK:
+			stats.m_naks ++;
+			break;
+
+		case USB2Transaction::HANDSHAKE_STALL:
+			stats.m_stalls ++;
+			break;
+
+		case USB2Transaction::HANDSHAKE_NYET:
+			stats.m_nyets ++;
+			break;
+
+		//Isochronous transfers never have a handshake
+		case USB2Transaction::HANDSHAKE_NONE:
+			if(info.m_type != USB2Transfer::TYPE_ISOCHRONOUS)
+				stats.m_timeouts ++;
+			break;
+
+		case USB2Transaction::HANDSHAKE_ERROR:
+		default:
+			stats.m_errors ++;
+			break;
+	}
+
+	auto& pipe = m_pipes[key];
+	if(control)
+		AddControlTransaction(pipe, t);
+	else
+		AddDataTransaction(pipe, t, info);
+
+	if(t.m_retry)
+		stats.m_retries ++;
+	else if(t.IsAccepted())
+		stats.m_bytes += t.m_data.size();
+	else if( (info.m_type == USB2Transfer::TYPE_ISOCHRONOUS) && t.m_hasData && !t.m_dataError)
+		stats.m_bytes += t.m_data.size();
+}
+
+/**
+	@brief Checks the data toggle of a transaction which was accepted by the receiver
+
+	If the receiver's handshake was lost, the sender will retransmit the same data with the same toggle, and the
+	receiver will acknowledge it again but throw it away.
+
+	@return True if this transaction is a retransmission
+ */
+bool USB2TransferTracker::CheckToggle(Pipe& pipe, USB2Transaction& t)
+{
+	//High speed isochronous PIDs don't toggle
+	int toggle;
+	if(t.m_dataPid == USB2PacketSymbol::PID_DATA0)
+		toggle = 0;
+	else if(t.m_dataPid == USB2PacketSymbol::PID_DATA1)
+		toggle = 1;
+	else
+		return false;
+
+	if( (pipe.m_toggle >= 0) && (toggle != pipe.m_toggle) )
+	{
+		t.m_retry = true;
+		return true;
+	}
+
+	pipe.m_toggle = toggle ^ 1;
+	return false;
+}
+
+/**
+	@brief Adds a transaction to a control pipe
+
+	A control transfer is a SETUP, an optional data stage of one or more transactions in the direction given by the
+	setup packet, and a zero length status stage in the opposite direction.
+ */
+void USB2TransferTracker::AddControlTransaction(Pipe& pipe, USB2Transaction& t)
+{
+	auto& xfer = pipe.m_transfer;
+
+	if(t.m_token == USB2PacketSymbol::PID_SETUP)
+	{
+		//Host will try again if the device didn't accept it
+		if( (t.m_handshake != USB2Transaction::HANDSHAKE_ACK) || (t.m_data.size() != 8) )
+			return;
+
+		//Resending the SETUP we just saw means the device's ACK got lost
+		USB2SetupPacket setup(t.m_data);
+		if(pipe.m_active && (xfer.m_transactions == 1) && (setup == xfer.m_setup) )
+		{
+			t.m_retry = true;
+			xfer.m_retries ++;
+			xfer.m_transactions ++;
+			xfer.m_end = t.m_end;
+			return;
+		}
+
+		//A new SETUP always aborts whatever was going on before
+		if(pipe.m_active)
+			EndTransfer(pipe, USB2Transfer::STATUS_ABORTED);
+
+		xfer = USB2Transfer();
+		xfer.m_start = t.m_start;
+		xfer.m_end = t.m_end;
+		xfer.m_type = USB2Transfer::TYPE_CONTROL;
+		xfer.m_addr = t.m_addr;
+		xfer.m_endpoint = t.m_endp;
+		xfer.m_hasSetup = true;
+		xfer.m_setup = setup;
+		xfer.m_transactions = 1;
+		pipe.m_active = true;
+
+		//Data and status stages both start with DATA1
+		pipe.m_toggle = 1;
+		pipe.m_statusStage = (setup.m_length == 0);
+		return;
+	}
+
+	//Ignore anything we see before the first SETUP (capture may have started part way through a transfer)
+	if(!pipe.m_active)
+		return;
+
+	xfer.m_transactions ++;
+	xfer.m_end = t.m_end;
+
+	switch(t.m_handshake)
+	{
+		case USB2Transaction::HANDSHAKE_NAK:
+			xfer.m_naks ++;
+			return;
+
+		case USB2Transaction::HANDSHAKE_STALL:
+			EndTransfer(pipe, USB2Transfer::STATUS_STALLED);
+			return;
+
+		default:
+			break;
+	}
+
+	if( (t.m_token == USB2PacketSymbol::PID_PING) || !t.IsAccepted() )
+		return;
+
+	//Data stage
+	bool datadir = (xfer.m_setup.IsDeviceToHost() == t.IsIn());
+	if(datadir)
+	{
+		if(pipe.m_statusStage)
+			return;
+
+		if(CheckToggle(pipe, t))
+			xfer.m_retries ++;
+		else
+			xfer.m_data.insert(xfer.m_data.end(), t.m_data.begin(), t.m_data.end());
+	}
+
+	//Status stage
+	else
+		EndTransfer(pipe, USB2Transfer::STATUS_COMPLETE);
+}
+
+/**
+	@brief Adds a transaction to a bulk, interrupt or isochronous pipe
+
+	Bulk and interrupt transfers end with a packet shorter than the max packet size of the endpoint (possibly zero
+	length). If we didn't see the endpoint descriptor, the largest packet seen so far is used instead, so transfers
+	made up entirely of full size packets can't be split up correctly.
+ */
+void USB2TransferTracker::AddDataTransaction(Pipe& pipe, USB2Transaction& t, const USB2EndpointInfo& info)
+{
+	auto& xfer = pipe.m_transfer;
+
+	//Every isochronous transaction is a transfer of its own
+	if(info.m_type == USB2Transfer::TYPE_ISOCHRONOUS)
+	{
+		if(!t.m_hasData || t.m_dataError)
+			return;
+	}
+
+	else
+	{
+		switch(t.m_handshake)
+		{
+			//NAKs don't start a transfer (interrupt endpoints NAK every poll when they have nothing to say)
+			case USB2Transaction::HANDSHAKE_NAK:
+				if(pipe.m_active)
+				{
+					xfer.m_naks ++;
+					xfer.m_transactions ++;
+					xfer.m_end = t.m_end;
+				}
+				return;
+
+			case USB2Transaction::HANDSHAKE_STALL:
+				break;
+
+			default:
+				if(t.m_token == USB2PacketSymbol::PID_PING)
+					return;
+
+				if(!t.IsAccepted())
+				{
+					if(pipe.m_active)
+					{
+						xfer.m_transactions ++;
+						xfer.m_end = t.m_end;
+					}
+					return;
+				}
+
+				//Retransmission of the last packet of a transfer that already ended
+				if(CheckToggle(pipe, t) && !pipe.m_active)
+					return;
+				break;
+		}
+	}
+
+	if(!pipe.m_active)
+	{
+		xfer = USB2Transfer();
+		xfer.m_start = t.m_start;
+		xfer.m_type = info.m_type;
+		xfer.m_addr = t.m_addr;
+		xfer.m_endpoint = t.m_endp | (t.IsIn() ? 0x80 : 0);
+		pipe.m_active = true;
+	}
+	xfer.m_transactions ++;
+	xfer.m_end = t.m_end;
+
+	if(t.m_handshake == USB2Transaction::HANDSHAKE_STALL)
+	{
+		EndTransfer(pipe, USB2Transfer::STATUS_STALLED);
+		return;
+	}
+	if(t.m_retry)
+	{
+		xfer.m_retries ++;
+		return;
+	}
+
+	xfer.m_data.insert(xfer.m_data.end(), t.m_data.begin(), t.m_data.end());
+
+	size_t size = t.m_data.size();
+	pipe.m_largestPacket = max(pipe.m_largestPacket, size);
+	size_t maxPacket = info.m_maxPacketSize ? info.m_maxPacketSize : pipe.m_largestPacket;
+	if( (info.m_type == USB2Transfer::TYPE_ISOCHRONOUS) || (size < maxPacket) || (size == 0) )
+		EndTransfer(pipe, USB2Transfer::STATUS_COMPLETE);
+}
+
+/**
+	@brief Finishes the transfer in progress on a pipe
+ */
+void USB2TransferTracker::EndTransfer(Pipe& pipe, USB2Transfer::Status status)
+{
+	pipe.m_active = false;
+	pipe.m_transfer.m_status = status;
+	m_transfers.push_back(pipe.m_transfer);
+	m_stats[GetKey(pipe.m_transfer.m_addr, pipe.m_transfer.m_endpoint)].m_transfers ++;
+
+	if( (status == USB2Transfer::STATUS_COMPLETE) && (pipe.m_transfer.m_type == USB2Transfer::TYPE_CONTROL) )
+		OnControlComplete(pipe.m_transfer);
+}
+
+/**
+	@brief Updates our model of the device after a successful standard request
+ */
+void USB2TransferTracker::OnControlComplete(const USB2Transfer& xfer)
+{
+	auto& setup = xfer.m_setup;
+	if(setup.GetType() != USB2SetupPacket::TYPE_STANDARD)
+		return;
+
+	switch(setup.m_request)
+	{
+		//Device moves to the new address once the status stage is done
+		case USB2SetupPacket::REQ_SET_ADDRESS:
+			{
+				uint8_t addr = setup.m_value & 0x7f;
+				if(addr == xfer.m_addr)
+					break;
+
+				auto it = m_devices.find(xfer.m_addr);
+				if(it != m_devices.end())
+				{
+					m_devices[addr] = it->second;
+					m_devices.erase(xfer.m_addr);
+				}
+				else
+					m_devices.erase(addr);
+
+				ResetToggles(addr, -1);
+			}
+			break;
+
+		case USB2SetupPacket::REQ_GET_DESCRIPTOR:
+			switch(setup.m_value >> 8)
+			{
+				//Max packet size for endpoint zero
+				case 1:
+					if(xfer.m_data.size() >= 8)
+						m_devices[xfer.m_addr].m_endpoints[0] = USB2EndpointInfo(USB2Transfer::TYPE_CONTROL, xfer.m_data[7]);
+					break;
+
+				case 2:
+					ParseConfiguration(m_devices[xfer.m_addr], xfer.m_data);
+					break;
+
+				default:
+					break;
+			}
+			break;
+
+		//These all reset the data toggle of the affected endpoints to DATA0
+		case USB2SetupPacket::REQ_SET_CONFIGURATION:
+		case USB2SetupPacket::REQ_SET_INTERFACE:
+			ResetToggles(xfer.m_addr, 0);
+			break;
+
+		case USB2SetupPacket::REQ_CLEAR_FEATURE:
+			if( (setup.GetRecipient() == USB2SetupPacket::RECIPIENT_ENDPOINT) && (setup.m_value == 0) )
+			{
+				auto it = m_pipes.find(GetKey(xfer.m_addr, setup.m_index & 0x8f));
+				if(it != m_pipes.end())
+					it->second.m_toggle = 0;
+			}
+			break;
+
+		default:
+			break;
+	}
+}
+
+/**
+	@brief Sets the data toggle for all non-control endpoints of a device
+
+	@param addr		Device address
+	@param toggle	New toggle value, or -1 for unknown
+ */
+void USB2TransferTracker::ResetToggles(uint8_t addr, int toggle)
+{
+	for(auto it = m_pipes.lower_bound(GetKey(addr, 0)); it != m_pipes.end(); it++)
+	{
+		if( (it->first >> 8) != addr)
+			break;
+		if( (it->first & 0x7f) != 0)
+			it->second.m_toggle = toggle;
+	}
+}
+
+/**
+	@brief Pulls endpoint types and max packet sizes out of a configuration descriptor
+ */
+void USB2TransferTracker::ParseConfiguration(DeviceInfo& dev, const vector<uint8_t>& data)
+{
+	for(size_t i=0; i+2 <= data.size(); )
+	{
+		size_t len = data[i];
+		if( (len < 2) || (i + len > data.size()) )
+			break;
+
+		//Endpoint descriptor. Bits 12:11 of the size are extra transactions per microframe, not part of the size.
+		if( (data[i+1] == 5) && (len >= 7) )
+		{
+			auto type = static_cast<USB2Transfer::TransferType>(data[i+3] & 3);
+			uint16_t size = ( (data[i+5] << 8) | data[i+4]) & 0x7ff;
+			dev.m_endpoints[data[i+2] & 0x8f] = USB2EndpointInfo(type, size);
+		}
+
+		i += len;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Formatting
+
+string USB2TransferTracker::GetRequestName(uint8_t request)
+{
+	switch(request)
+	{
+		case USB2SetupPacket::REQ_GET_STATUS:
+			return "GET_STATUS";
+		case USB2SetupPacket::REQ_CLEAR_FEATURE:
+			return "CLEAR_FEATURE";
+		case USB2SetupPacket::REQ_SET_FEATURE:
+			return "SET_FEATURE";
+		case USB2SetupPacket::REQ_SET_ADDRESS:
+			return "SET_ADDRESS";
+		case USB2SetupPacket::REQ_GET_DESCRIPTOR:
+			return "GET_DESCRIPTOR";
+		case USB2SetupPacket::REQ_SET_DESCRIPTOR:
+			return "SET_DESCRIPTOR";
+		case USB2SetupPacket::REQ_GET_CONFIGURATION:
+			return "GET_CONFIGURATION";
+		case USB2SetupPacket::REQ_SET_CONFIGURATION:
+			return "SET_CONFIGURATION";
+		case USB2SetupPacket::REQ_GET_INTERFACE:
+			return "GET_INTERFACE";
+		case USB2SetupPacket::REQ_SET_INTERFACE:
+			return "SET_INTERFACE";
+		case USB2SetupPacket::REQ_SYNCH_FRAME:
+			return "SYNCH_FRAME";
+
+		default:
+			{
+				char tmp[32];
+				snprintf(tmp, sizeof(tmp), "Request %02x", request);
+				return tmp;
+			}
+	}
+}
+
+string USB2TransferTracker::GetDescriptorName(uint8_t type)
+{
+	switch(type)
+	{
+		case 0x01:
+			return "Device";
+		case 0x02:
+			return "Configuration";
+		case 0x03:
+			return "String";
+		case 0x04:
+			return "Interface";
+		case 0x05:
+			return "Endpoint";
+		case 0x06:
+			return "Device Qualifier";
+		case 0x07:
+			return "Other Speed Configuration";
+		case 0x08:
+			return "Interface Power";
+		case 0x09:
+			return "OTG";
+		case 0x0a:
+			return "Debug";
+		case 0x0b:
+			return "Interface Association";
+		case 0x0f:
+			return "BOS";
+		case 0x21:
+			return "HID";
+		case 0x22:
+			return "HID Report";
+		case 0x24:
+			return "Class Interface";
+		case 0x25:
+			return "Class Endpoint";
+
+		default:
+			{
+				char tmp[32];
+				snprintf(tmp, sizeof(tmp), "Descriptor %02x", type);
+				return tmp;
+			}
+	}
+}
+
+/**
+	@brief Describes a setup packet in human readable form
+ */
+string USB2TransferTracker::FormatRequest(const USB2SetupPacket& setup)
+{
+	const char* recipients[4] = { "device", "interface", "endpoint", "other" };
+	const char* recipient = (setup.GetRecipient() < 4) ? recipients[setup.GetRecipient()] : "reserved";
+
+	char tmp[128];
+	if(setup.GetType() != USB2SetupPacket::TYPE_STANDARD)
+	{
+		const char* types[4] = { "Standard", "Class", "Vendor", "Reserved" };
+		snprintf(tmp, sizeof(tmp), "%s request %02x to %s, wValue %04x wIndex %04x wLength %u",
+			types[setup.GetType()], setup.m_request, recipient, setup.m_value, setup.m_index, setup.m_length);
+		return tmp;
+	}
+
+	string name = GetRequestName(setup.m_request);
+	switch(setup.m_request)
+	{
+		case USB2SetupPacket::REQ_GET_STATUS:
+			if(setup.GetRecipient() == USB2SetupPacket::RECIPIENT_DEVICE)
+				snprintf(tmp, sizeof(tmp), "%s device", name.c_str());
+			else
+				snprintf(tmp, sizeof(tmp), "%s %s %02x", name.c_str(), recipient, setup.m_index);
+			break;
+
+		case USB2SetupPacket::REQ_CLEAR_FEATURE:
+		case USB2SetupPacket::REQ_SET_FEATURE:
+			if( (setup.GetRecipient() == USB2SetupPacket::RECIPIENT_ENDPOINT) && (setup.m_value == 0) )
+				snprintf(tmp, sizeof(tmp), "%s ENDPOINT_HALT %02x", name.c_str(), setup.m_index);
+			else if( (setup.GetRecipient() == USB2SetupPacket::RECIPIENT_DEVICE) && (setup.m_value == 1) )
+				snprintf(tmp, sizeof(tmp), "%s DEVICE_REMOTE_WAKEUP", name.c_str());
+			else if( (setup.GetRecipient() == USB2SetupPacket::RECIPIENT_DEVICE) && (setup.m_value == 2) )
+				snprintf(tmp, sizeof(tmp), "%s TEST_MODE %u", name.c_str(), setup.m_index >> 8);
+			else
+				snprintf(tmp, sizeof(tmp), "%s %u to %s %u", name.c_str(), setup.m_value, recipient, setup.m_index);
+			break;
+
+		case USB2SetupPacket::REQ_SET_ADDRESS:
+		case USB2SetupPacket::REQ_SET_CONFIGURATION:
+			snprintf(tmp, sizeof(tmp), "%s %u", name.c_str(), setup.m_value);
+			break;
+
+		//Strings are indexed by language too
+		case USB2SetupPacket::REQ_GET_DESCRIPTOR:
+		case USB2SetupPacket::REQ_SET_DESCRIPTOR:
+			if( (setup.m_value >> 8) == 3)
+			{
+				snprintf(tmp, sizeof(tmp), "%s String %u (lang %04x), len %u",
+					name.c_str(), setup.m_value & 0xff, setup.m_index, setup.m_length);
+			}
+			else
+			{
+				snprintf(tmp, sizeof(tmp), "%s %s %u, len %u",
+					name.c_str(), GetDescriptorName(setup.m_value >> 8).c_str(), setup.m_value & 0xff, setup.m_length);
+			}
+			break;
+
+		case USB2SetupPacket::REQ_GET_INTERFACE:
+			snprintf(tmp, sizeof(tmp), "%s %u", name.c_str(), setup.m_index);
+			break;
+
+		case USB2SetupPacket::REQ_SET_INTERFACE:
+			snprintf(tmp, sizeof(tmp), "%s %u alt %u", name.c_str(), setup.m_index, setup.m_value);
+			break;
+
+		case USB2SetupPacket::REQ_SYNCH_FRAME:
+			snprintf(tmp, sizeof(tmp), "%s %02x", name.c_str(), setup.m_index);
+			break;
+
+		case USB2SetupPacket::REQ_GET_CONFIGURATION:
+		default:
+			return name;
+	}
+
+	return tmp;
+}
+
+/**
+	@brief Gets the length of the fixed part of a standard descriptor
+ */
+static size_t GetMinimumLength(uint8_t type)
+{
+	switch(type)
+	{
+		case 0x01:
+			return 18;
+		case 0x02:
+		case 0x04:
+		case 0x07:
+			return 9;
+		case 0x05:
+			return 7;
+		case 0x06:
+			return 10;
+		case 0x0b:
+			return 8;
+		case 0x21:
+			return 6;
+
+		default:
+			return 2;
+	}
+}
+
+/**
+	@brief Describes a block of descriptors (as returned by GET_DESCRIPTOR) in human readable form
+
+	@param data			The descriptors
+	@param stringZero	True if this is string descriptor zero, which holds a list of language IDs instead of text
+ */
+string USB2TransferTracker::FormatDescriptors(const vector<uint8_t>& data, bool stringZero)
+{
+	const char* types[4] = { "Control", "Isochronous", "Bulk", "Interrupt" };
+
+	string ret;
+	char tmp[256];
+	for(size_t i=0; i+2 <= data.size(); )
+	{
+		size_t len = data[i];
+		uint8_t type = data[i+1];
+		if(len < 2)
+			break;
+
+		if(!ret.empty())
+			ret += "; ";
+
+		//Partial descriptor (host asked for fewer bytes than the descriptor has)
+		size_t avail = data.size() - i;
+		if(avail < len)
+		{
+			//Hosts commonly read the first 8 bytes of the device descriptor to get the max packet size
+			if( (type == 1) && (avail >= 8) )
+			{
+				snprintf(tmp, sizeof(tmp), "Device (%zu of %zu bytes): USB %x.%02x, EP0 %u bytes",
+					avail, len, data[i+3], data[i+2], data[i+7]);
+			}
+			else
+				snprintf(tmp, sizeof(tmp), "%s (%zu of %zu bytes)", GetDescriptorName(type).c_str(), avail, len);
+			ret += tmp;
+			break;
+		}
+
+		//Descriptor too short for its type
+		if(len < GetMinimumLength(type))
+		{
+			snprintf(tmp, sizeof(tmp), "%s, %zu bytes (malformed)", GetDescriptorName(type).c_str(), len);
+			ret += tmp;
+			i += len;
+			continue;
+		}
+
+		auto p = &data[i];
+		switch(type)
+		{
+			case 0x01:
+				snprintf(tmp, sizeof(tmp),
+					"Device: USB %x.%02x, class %02x/%02x/%02x, EP0 %u bytes, VID %04x PID %04x, rev %x.%02x, %u config%s",
+					p[3], p[2], p[4], p[5], p[6], p[7],
+					(p[9] << 8) | p[8], (p[11] << 8) | p[10],
+					p[13], p[12], p[17], (p[17] == 1) ? "" : "s");
+				break;
+
+			case 0x02:
+			case 0x07:
+				snprintf(tmp, sizeof(tmp), "%s %u: %u interface%s, %u mA%s%s, %u bytes total",
+					GetDescriptorName(type).c_str(), p[5], p[4], (p[4] == 1) ? "" : "s", p[8] * 2,
+					(p[7] & 0x40) ? ", self powered" : "",
+					(p[7] & 0x20) ? ", remote wakeup" : "",
+					(p[3] << 8) | p[2]);
+				break;
+
+			case 0x03:
+				if(stringZero)
+				{
+					ret += "Languages:";
+					for(size_t j=2; j+1 < len; j += 2)
+					{
+						snprintf(tmp, sizeof(tmp), " %04x", (p[j+1] << 8) | p[j]);
+						ret += tmp;
+					}
+					i += len;
+					continue;
+				}
+
+				//Convert UTF-16 to UTF-8. Anything outside the basic multilingual plane is replaced with '?'.
+				ret += "String: \"";
+				for(size_t j=2; j+1 < len; j += 2)
+				{
+					uint16_t c = (p[j+1] << 8) | p[j];
+					if(c < 0x80)
+						ret += static_cast<char>(c);
+					else if(c < 0x800)
+					{
+						ret += static_cast<char>(0xc0 | (c >> 6));
+						ret += static_cast<char>(0x80 | (c & 0x3f));
+					}
+					else if( (c >= 0xd800) && (c < 0xe000) )
+						ret += '?';
+					else
+					{
+						ret += static_cast<char>(0xe0 | (c >> 12));
+						ret += static_cast<char>(0x80 | ( (c >> 6) & 0x3f));
+						ret += static_cast<char>(0x80 | (c & 0x3f));
+					}
+				}
+				ret += "\"";
+				i += len;
+				continue;
+
+			case 0x04:
+				snprintf(tmp, sizeof(tmp), "Interface %u alt %u: %u endpoint%s, class %02x/%02x/%02x",
+					p[2], p[3], p[4], (p[4] == 1) ? "" : "s", p[5], p[6], p[7]);
+				break;
+
+			case 0x05:
+				{
+					uint16_t size = (p[5] << 8) | p[4];
+					int n = snprintf(tmp, sizeof(tmp), "Endpoint %02x %s %s, %u bytes",
+						p[2], (p[2] & 0x80) ? "IN" : "OUT", types[p[3] & 3], size & 0x7ff);
+					if(size >> 11)
+						n += snprintf(tmp + n, sizeof(tmp) - n, " x%u", (size >> 11) + 1);
+					if(p[3] & 1)
+						snprintf(tmp + n, sizeof(tmp) - n, ", interval %u", p[6]);
+				}
+				break;
+
+			case 0x06:
+				snprintf(tmp, sizeof(tmp), "Device Qualifier: USB %x.%02x, class %02x/%02x/%02x, EP0 %u bytes, %u config%s",
+					p[3], p[2], p[4], p[5], p[6], p[7], p[8], (p[8] == 1) ? "" : "s");
+				break;
+
+			case 0x0b:
+				snprintf(tmp, sizeof(tmp), "Interface Association: interfaces %u-%u, class %02x/%02x/%02x",
+					p[2], p[2] + p[3] - 1, p[4], p[5], p[6]);
+				break;
+
+			case 0x21:
+				snprintf(tmp, sizeof(tmp), "HID %x.%02x, country %u, %u descriptor%s",
+					p[3], p[2], p[4], p[5], (p[5] == 1) ? "" : "s");
+				break;
+
+			default:
+				snprintf(tmp, sizeof(tmp), "%s, %zu bytes", GetDescriptorName(type).c_str(), len);
+				break;
+		}
+
+		ret += tmp;
+		i += len;
+	}
+
+	return ret;
+}
@@ -0,0 +1,423 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of USB2TransferTracker
+ */
+#ifndef USB2TransferTracker_h
+#define USB2TransferTracker_h
+
+#include "USB2PacketDecoder.h"
+
+/**
+	@brief A single packet, as seen at the packet layer
+ */
+class USB2Packet
+{
+public:
+	USB2Packet()
+		: m_start(0)
+		, m_end(0)
+		, m_pid(USB2PacketSymbol::PID_RESERVED)
+		, m_addr(0)
+		, m_endp(0)
+		, m_frame(0)
+		, m_crcOk(true)
+		, m_error(false)
+	{}
+
+	///@brief Start and end of the packet, in fs
+	int64_t m_start;
+	int64_t m_end;
+
+	USB2PacketSymbol::Pids m_pid;
+
+	///@brief Device address and endpoint number (tokens only)
+	uint8_t m_addr;
+	uint8_t m_endp;
+
+	///@brief Frame number (SOF only)
+	uint16_t m_frame;
+
+	///@brief Payload (data packets only)
+	std::vector<uint8_t> m_data;
+
+	bool m_crcOk;
+
+	///@brief True if the packet was truncated or otherwise malformed
+	bool m_error;
+};
+
+/**
+	@brief The 8-byte payload of a SETUP transaction
+ */
+class USB2SetupPacket
+{
+public:
+	USB2SetupPacket()
+		: m_requestType(0)
+		, m_request(0)
+		, m_value(0)
+		, m_index(0)
+		, m_length(0)
+	{}
+
+	USB2SetupPacket(const std::vector<uint8_t>& data);
+
+	enum RequestType
+	{
+		TYPE_STANDARD	= 0,
+		TYPE_CLASS		= 1,
+		TYPE_VENDOR		= 2,
+		TYPE_RESERVED	= 3
+	};
+
+	enum Recipient
+	{
+		RECIPIENT_DEVICE	= 0,
+		RECIPIENT_INTERFACE	= 1,
+		RECIPIENT_ENDPOINT	= 2,
+		RECIPIENT_OTHER		= 3
+	};
+
+	enum StandardRequest
+	{
+		REQ_GET_STATUS			= 0x00,
+		REQ_CLEAR_FEATURE		= 0x01,
+		REQ_SET_FEATURE			= 0x03,
+		REQ_SET_ADDRESS			= 0x05,
+		REQ_GET_DESCRIPTOR		= 0x06,
+		REQ_SET_DESCRIPTOR		= 0x07,
+		REQ_GET_CONFIGURATION	= 0x08,
+		REQ_SET_CONFIGURATION	= 0x09,
+		REQ_GET_INTERFACE		= 0x0a,
+		REQ_SET_INTERFACE		= 0x0b,
+		REQ_SYNCH_FRAME			= 0x0c
+	};
+
+	bool IsDeviceToHost() const
+	{ return (m_requestType & 0x80) != 0; }
+
+	RequestType GetType() const
+	{ return static_cast<RequestType>( (m_requestType >> 5) & 3); }
+
+	uint8_t GetRecipient() const
+	{ return m_requestType & 0x1f; }
+
+	bool operator==(const USB2SetupPacket& rhs) const
+	{
+		return (m_requestType == rhs.m_requestType) && (m_request == rhs.m_request) && (m_value == rhs.m_value) &&
+			(m_index == rhs.m_index) && (m_length == rhs.m_length);
+	}
+
+	uint8_t m_requestType;
+	uint8_t m_request;
+	uint16_t m_value;
+	uint16_t m_index;
+	uint16_t m_length;
+};
+
+/**
+	@brief A token, its data packet (if any) and the handshake that ended it
+ */
+class USB2Transaction
+{
+public:
+	USB2Transaction()
+		: m_start(0)
+		, m_end(0)
+		, m_token(USB2PacketSymbol::PID_RESERVED)
+		, m_addr(0)
+		, m_endp(0)
+		, m_hasData(false)
+		, m_dataPid(USB2PacketSymbol::PID_DATA0)
+		, m_dataError(false)
+		, m_handshake(HANDSHAKE_NONE)
+		, m_retry(false)
+	{}
+
+	enum Handshake
+	{
+		HANDSHAKE_ACK,
+		HANDSHAKE_NAK,
+		HANDSHAKE_STALL,
+		HANDSHAKE_NYET,
+		HANDSHAKE_NONE,		//no handshake: isochronous, or the receiver didn't answer
+		HANDSHAKE_ERROR		//token or data packet was corrupted
+	};
+
+	bool IsIn() const
+	{ return m_token == USB2PacketSymbol::PID_IN; }
+
+	///@brief True if the transaction moved data that the receiver accepted
+	bool IsAccepted() const
+	{ return m_hasData && (m_handshake == HANDSHAKE_ACK || m_handshake == HANDSHAKE_NYET); }
+
+	///@brief Start and end of the transaction, in fs
+	int64_t m_start;
+	int64_t m_end;
+
+	///@brief The token PID (IN, OUT, SETUP or PING)
+	USB2PacketSymbol::Pids m_token;
+
+	uint8_t m_addr;
+	uint8_t m_endp;
+
+	bool m_hasData;
+	USB2PacketSymbol::Pids m_dataPid;
+	bool m_dataError;
+	std::vector<uint8_t> m_data;
+
+	Handshake m_handshake;
+
+	///@brief True if the data toggle showed this to be a retransmission of data that was already accepted
+	bool m_retry;
+};
+
+/**
+	@brief A control transfer, or a run of bulk/interrupt transactions ending in a short packet
+ */
+class USB2Transfer
+{
+public:
+	USB2Transfer()
+		: m_start(0)
+		, m_end(0)
+		, m_type(TYPE_UNKNOWN)
+		, m_addr(0)
+		, m_endpoint(0)
+		, m_hasSetup(false)
+		, m_transactions(0)
+		, m_naks(0)
+		, m_retries(0)
+		, m_status(STATUS_INCOMPLETE)
+	{}
+
+	///@brief Transfer types, numbered as in the endpoint descriptor bmAttributes field
+	enum TransferType
+	{
+		TYPE_CONTROL		= 0,
+		TYPE_ISOCHRONOUS	= 1,
+		TYPE_BULK			= 2,
+		TYPE_INTERRUPT		= 3,
+		TYPE_UNKNOWN		= 4		//bulk or interrupt, but we haven't seen the endpoint descriptor
+	};
+
+	enum Status
+	{
+		STATUS_COMPLETE,
+		STATUS_STALLED,
+		STATUS_ABORTED,		//control transfer interrupted by a new SETUP
+		STATUS_INCOMPLETE	//still in progress at the end of the capture
+	};
+
+	///@brief Start and end of the transfer, in fs
+	int64_t m_start;
+	int64_t m_end;
+
+	TransferType m_type;
+	uint8_t m_addr;
+
+	///@brief Endpoint address (endpoint number, plus 0x80 for IN). Control transfers are always OUT.
+	uint8_t m_endpoint;
+
+	bool m_hasSetup;
+	USB2SetupPacket m_setup;
+
+	///@brief Payload (data stage, for control transfers)
+	std::vector<uint8_t> m_data;
+
+	size_t m_transactions;
+	size_t m_naks;
+	size_t m_retries;
+	Status m_status;
+};
+
+/**
+	@brief What we've learned about an endpoint from the descriptors
+ */
+class USB2EndpointInfo
+{
+public:
+	USB2EndpointInfo(USB2Transfer::TransferType type = USB2Transfer::TYPE_UNKNOWN, uint16_t maxPacket = 0)
+		: m_type(type)
+		, m_maxPacketSize(maxPacket)
+	{}
+
+	USB2Transfer::TransferType m_type;
+
+	///@brief Max packet size, or zero if unknown
+	uint16_t m_maxPacketSize;
+};
+
+/**
+	@brief Traffic statistics for one endpoint
+ */
+class USB2EndpointStatistics
+{
+public:
+	USB2EndpointStatistics()
+		: m_type(USB2Transfer::TYPE_UNKNOWN)
+		, m_transactions(0)
+		, m_acks(0)
+		, m_naks(0)
+		, m_stalls(0)
+		, m_nyets(0)
+		, m_timeouts(0)
+		, m_errors(0)
+		, m_retries(0)
+		, m_transfers(0)
+		, m_bytes(0)
+		, m_busTime(0)
+		, m_firstActivity(0)
+		, m_lastActivity(0)
+	{}
+
+	double GetThroughput() const;
+	double GetBusUtilization() const;
+
+	USB2Transfer::TransferType m_type;
+
+	uint64_t m_transactions;
+	uint64_t m_acks;
+	uint64_t m_naks;
+	uint64_t m_stalls;
+	uint64_t m_nyets;
+	uint64_t m_timeouts;
+	uint64_t m_errors;
+	uint64_t m_retries;
+	uint64_t m_transfers;
+
+	///@brief Payload bytes accepted, not counting retries
+	uint64_t m_bytes;
+
+	///@brief Total time spent on transactions to this endpoint (including NAKs), in fs
+	int64_t m_busTime;
+
+	///@brief Start of the first and end of the last transaction, in fs
+	int64_t m_firstActivity;
+	int64_t m_lastActivity;
+};
+
+/**
+	@brief Groups USB 1.x/2.0 packets into transactions and transfers, and keeps per-endpoint statistics
+
+	Devices are followed through enumeration: SET_ADDRESS moves a device to its new address, and the device and
+	configuration descriptors supply the type and max packet size of each endpoint.
+ */
+class USB2TransferTracker
+{
+public:
+	USB2TransferTracker();
+
+	void Clear();
+
+	static void GetPackets(USB2PacketWaveform* wfm, std::vector<USB2Packet>& packets);
+
+	void AddPacket(const USB2Packet& packet);
+	void Flush();
+
+	const std::vector<USB2Transaction>& GetTransactions() const
+	{ return m_transactions; }
+
+	const std::vector<USB2Transfer>& GetTransfers() const
+	{ return m_transfers; }
+
+	///@brief Statistics for each endpoint, indexed by GetKey()
+	const std::map<uint16_t, USB2EndpointStatistics>& GetStatistics() const
+	{ return m_stats; }
+
+	static uint16_t GetKey(uint8_t addr, uint8_t endpoint)
+	{ return (addr << 8) | endpoint; }
+
+	static std::string GetRequestName(uint8_t request);
+	static std::string GetDescriptorName(uint8_t type);
+	static std::string FormatRequest(const USB2SetupPacket& setup);
+	static std::string FormatDescriptors(const std::vector<uint8_t>& data, bool stringZero = false);
+
+protected:
+
+	/**
+		@brief State of one pipe (endpoint and direction) between transactions
+	 */
+	class Pipe
+	{
+	public:
+		Pipe()
+			: m_active(false)
+			, m_toggle(-1)
+			, m_largestPacket(0)
+			, m_statusStage(false)
+		{}
+
+		///@brief True if m_transfer has started
+		bool m_active;
+		USB2Transfer m_transfer;
+
+		///@brief Expected data toggle of the next packet (0 or 1), or -1 if unknown
+		int m_toggle;
+
+		///@brief Largest packet seen so far, used as the max packet size if we didn't see the descriptor
+		size_t m_largestPacket;
+
+		///@brief True if a control transfer has moved on to the status stage
+		bool m_statusStage;
+	};
+
+	class DeviceInfo
+	{
+	public:
+		///@brief Endpoints from the configuration descriptor, indexed by endpoint address
+		std::map<uint8_t, USB2EndpointInfo> m_endpoints;
+	};
+
+	void EndTransaction();
+	void AddTransaction(USB2Transaction& t);
+	void AddControlTransaction(Pipe& pipe, USB2Transaction& t);
+	void AddDataTransaction(Pipe& pipe, USB2Transaction& t, const USB2EndpointInfo& info);
+	bool CheckToggle(Pipe& pipe, USB2Transaction& t);
+	void EndTransfer(Pipe& pipe, USB2Transfer::Status status);
+	void OnControlComplete(const USB2Transfer& transfer);
+	void ParseConfiguration(DeviceInfo& dev, const std::vector<uint8_t>& data);
+	void ResetToggles(uint8_t addr, int toggle);
+
+	std::vector<USB2Transaction> m_transactions;
+	std::vector<USB2Transfer> m_transfers;
+	std::map<uint16_t, USB2EndpointStatistics> m_stats;
+	std::map<uint16_t, Pipe> m_pipes;
+	std::map<uint8_t, DeviceInfo> m_devices;
+
+	///@brief True if m_current holds a transaction that hasn't been ended yet
+	bool m_inTransaction;
+	USB2Transaction m_current;
+};
+
+#endif
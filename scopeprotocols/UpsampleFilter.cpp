@@ -66,12 +66,8 @@ UpsampleFilter::UpsampleFilter(const string& color)
 	: Filter(color, CAT_MATH)
 	, m_computePipeline("shaders/UpsampleFilter.spv", 3, sizeof(UpsampleFilterArgs))
 {
-	AddStream(Unit(Unit::UNIT_VOLTS), "data", Stream::STREAM_TYPE_ANALOG);
-	CreateInput("din");
-
+	ApplyDescriptor(Describe());
 	m_factorname = "Upsample factor";
-	m_parameters[m_factorname] = FilterParameter(FilterParameter::TYPE_INT, Unit(Unit::UNIT_SAMPLEDEPTH));
-	m_parameters[m_factorname].SetIntVal(10);
 
 	//Use pinned memory for filter kernel
 	m_filter.SetCpuAccessHint(AcceleratorBuffer<float>::HINT_LIKELY);
@@ -100,6 +96,23 @@ string UpsampleFilter::GetProtocolName()
 	return "Upsample";
 }
 
+/**
+	@brief Describes the filter's interface without constructing it. The constructor applies the same descriptor.
+ */
+FilterDescriptor UpsampleFilter::Describe()
+{
+	FilterDescriptor desc(GetProtocolName(), CAT_MATH);
+	desc.AddInput("din");
+	desc.AddOutput("data", Stream::STREAM_TYPE_ANALOG, Unit(Unit::UNIT_VOLTS));
+
+	FilterParameter factor(FilterParameter::TYPE_INT, Unit(Unit::UNIT_SAMPLEDEPTH));
+	factor.SetIntVal(10);
+	desc.AddParameter("Upsample factor", factor);
+
+	desc.SetCapabilities(FilterDescriptor::CAP_CPU_INPUT | FilterDescriptor::CAP_GPU_INPUT);
+	return desc;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Actual decoder logic
 
@@ -178,8 +191,7 @@ void UpsampleFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueHa
 
 		//Logically, we upsample by inserting zeroes, then convolve with the sinc filter.
 		//Optimization: don't actually waste time multiplying by zero
-		#pragma omp parallel for
-		for(size_t i=0; i < imax; i++)
+		ThreadPool::GetDefault().ParallelFor(0, imax, [&](size_t i)
 		{
 			size_t offset = i * upsample_factor;
 			for(size_t j=0; j<upsample_factor; j++)
@@ -198,7 +210,7 @@ void UpsampleFilter::Refresh(vk::raii::CommandBuffer& cmdBuf, shared_ptr<QueueHa
 
 				cap->m_samples[offset + j] = f;
 			}
-		}
+		});
 
 		cap->MarkModifiedFromCpu();
 	}
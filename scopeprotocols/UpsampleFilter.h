@@ -53,6 +53,7 @@ public:
 	virtual DataLocation GetInputLocation() override;
 
 	static std::string GetProtocolName();
+	static FilterDescriptor Describe();
 
 	virtual bool ValidateChannel(size_t i, StreamDescriptor stream) override;
 
@@ -37,12 +37,18 @@ using namespace std;
 
 VCDImportFilter::VCDImportFilter(const string& color)
 	: ImportFilter(color)
+	, m_realunit("Real Variable Unit")
 {
 	m_fpname = "VCD File";
 	m_parameters[m_fpname] = FilterParameter(FilterParameter::TYPE_FILENAME, Unit(Unit::UNIT_COUNTS));
 	m_parameters[m_fpname].m_fileFilterMask = "*.vcd";
 	m_parameters[m_fpname].m_fileFilterName = "Value Change Dump files (*.vcd)";
 	m_parameters[m_fpname].signal_changed().connect(sigc::mem_fun(*this, &VCDImportFilter::OnFileNameChanged));
+
+	//VCD has no notion of units, so let the user pick one for analog (real) variables
+	m_parameters[m_realunit] = FilterParameter::UnitSelector();
+	m_parameters[m_realunit].SetIntVal(Unit::UNIT_VOLTS);
+	m_parameters[m_realunit].signal_changed().connect(sigc::mem_fun(*this, &VCDImportFilter::OnFileNameChanged));
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -75,6 +81,7 @@ void VCDImportFilter::OnFileNameChanged()
 	}
 
 	ClearStreams();
+	Unit realUnit(static_cast<Unit::UnitType>(m_parameters[m_realunit].GetIntVal()));
 
 	enum
 	{
@@ -247,15 +254,21 @@ void VCDImportFilter::OnFileNameChanged()
 					if(waveforms.find(symbol) != waveforms.end())
 						continue;
 
-					//Create the stream
-					AddDigitalStream(sscope + name);
-
-					//Create the waveform
+					//Create the stream and waveform
 					WaveformBase* wfm;
-					if(width == 1)
-						wfm = new SparseDigitalWaveform;
+					if(!strcmp(vtype, "real"))
+					{
+						AddStream(realUnit, sscope + name, Stream::STREAM_TYPE_ANALOG);
+						wfm = new SparseAnalogWaveform;
+					}
 					else
-						wfm = new SparseDigitalBusWaveform;
+					{
+						AddDigitalStream(sscope + name);
+						if(width == 1)
+							wfm = new SparseDigitalWaveform;
+						else
+							wfm = new SparseDigitalBusWaveform;
+					}
 					wfm->PrepareForCpuAccess();
 
 					wfm->m_timescale = timescale;
@@ -315,6 +328,32 @@ void VCDImportFilter::OnFileNameChanged()
 							LogError("Symbol \"%s\" is not a valid digital bus waveform\n", symbol.c_str());
 					}
 
+					//Real: first char is 'r', then data, space, symbol name
+					else if(s[0] == 'r')
+					{
+						auto ispace = s.find(' ');
+						auto symbol = s.substr(ispace + 1);
+						auto wfm = dynamic_cast<SparseAnalogWaveform*>(waveforms[symbol]);
+						if(wfm)
+						{
+							//Extend the previous sample, if there is one
+							auto len = wfm->size();
+							if(len)
+							{
+								auto last = len-1;
+								wfm->m_durations[last] = current_time - wfm->m_offsets[last];
+							}
+
+							//Add the new sample
+							wfm->m_offsets.push_back(current_time);
+							wfm->m_durations.push_back(1);
+							wfm->m_samples.push_back(strtof(s.c_str() + 1, nullptr));
+							wfm->MarkModifiedFromCpu();
+						}
+						else
+							LogError("Symbol \"%s\" is not a valid analog waveform\n", symbol.c_str());
+					}
+
 					//Scalar: first char is boolean value, rest is symbol name
 					else
 					{
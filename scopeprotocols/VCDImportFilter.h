@@ -46,6 +46,9 @@ public:
 
 protected:
 	void OnFileNameChanged();
+
+	///@brief Name of the parameter selecting the Y axis unit of real variables
+	std::string m_realunit;
 };
 
 #endif
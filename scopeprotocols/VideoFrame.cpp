@@ -0,0 +1,170 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Implementation of VideoFrame
+ */
+
+#include "../scopehal/scopehal.h"
+#include "VideoFrame.h"
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Export
+
+/**
+	@brief Writes the frame as headerless RGB888 data, row major
+
+	@return True on success
+ */
+bool VideoFrame::ExportRaw(const string& path) const
+{
+	FILE* fp = fopen(path.c_str(), "wb");
+	if(!fp)
+	{
+		LogError("VideoFrame: couldn't open %s for writing\n", path.c_str());
+		return false;
+	}
+	bool ok = (fwrite(m_pixels.data(), 1, m_pixels.size(), fp) == m_pixels.size());
+	fclose(fp);
+	return ok;
+}
+
+/**
+	@brief Writes the frame as an 8-bit RGB PNG
+
+	The image data is stored without compression so we don't need zlib. Files are large, but any PNG reader can
+	open them.
+
+	@return True on success
+ */
+bool VideoFrame::ExportPNG(const string& path) const
+{
+	if( (m_width == 0) || (m_height == 0) )
+	{
+		LogError("VideoFrame: can't write an empty image to %s\n", path.c_str());
+		return false;
+	}
+
+	auto put32 = [](vector<uint8_t>& buf, uint32_t v)
+	{
+		buf.push_back(v >> 24);
+		buf.push_back(v >> 16);
+		buf.push_back(v >> 8);
+		buf.push_back(v);
+	};
+
+	vector<uint8_t> file = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+
+	auto chunk = [&](const char* type, const vector<uint8_t>& data)
+	{
+		put32(file, data.size());
+		size_t start = file.size();
+		file.insert(file.end(), type, type + 4);
+		file.insert(file.end(), data.begin(), data.end());
+
+		//CRC32() returns the standard CRC with its bytes swapped (Ethernet FCS order), so writing it little endian
+		//gives the big endian value PNG expects
+		uint32_t crc = CRC32(file.data(), start, file.size() - 1);
+		file.push_back(crc);
+		file.push_back(crc >> 8);
+		file.push_back(crc >> 16);
+		file.push_back(crc >> 24);
+	};
+
+	//Header: 8 bits per channel, truecolor, no interlacing
+	vector<uint8_t> ihdr;
+	put32(ihdr, m_width);
+	put32(ihdr, m_height);
+	ihdr.push_back(8);
+	ihdr.push_back(2);
+	ihdr.push_back(0);
+	ihdr.push_back(0);
+	ihdr.push_back(0);
+	chunk("IHDR", ihdr);
+
+	//Scanlines, each preceded by filter type 0 (none)
+	size_t rowlen = m_width * 3;
+	vector<uint8_t> raw;
+	raw.reserve((rowlen + 1) * m_height);
+	for(size_t y=0; y<m_height; y++)
+	{
+		raw.push_back(0);
+		raw.insert(raw.end(), m_pixels.begin() + y*rowlen, m_pixels.begin() + (y+1)*rowlen);
+	}
+
+	//Wrap in a zlib stream made of stored deflate blocks
+	vector<uint8_t> idat = { 0x78, 0x01 };
+	idat.reserve(raw.size() + (raw.size() / 65535 + 1) * 5 + 6);
+	for(size_t off=0; off < raw.size(); )
+	{
+		size_t len = min(raw.size() - off, (size_t)65535);
+		bool last = (off + len == raw.size());
+		idat.push_back(last ? 1 : 0);
+		idat.push_back(len & 0xff);
+		idat.push_back(len >> 8);
+		idat.push_back(~len & 0xff);
+		idat.push_back((~len >> 8) & 0xff);
+		idat.insert(idat.end(), raw.begin() + off, raw.begin() + off + len);
+		off += len;
+	}
+
+	//Adler-32 of the uncompressed data (5552 bytes is the most we can sum before b can overflow)
+	uint32_t a = 1;
+	uint32_t b = 0;
+	for(size_t off=0; off < raw.size(); off += 5552)
+	{
+		size_t end = min(raw.size(), off + 5552);
+		for(size_t i=off; i<end; i++)
+		{
+			a += raw[i];
+			b += a;
+		}
+		a %= 65521;
+		b %= 65521;
+	}
+	put32(idat, (b << 16) | a);
+	chunk("IDAT", idat);
+
+	chunk("IEND", {});
+
+	FILE* fp = fopen(path.c_str(), "wb");
+	if(!fp)
+	{
+		LogError("VideoFrame: couldn't open %s for writing\n", path.c_str());
+		return false;
+	}
+	bool ok = (fwrite(file.data(), 1, file.size(), fp) == file.size());
+	fclose(fp);
+	return ok;
+}
@@ -0,0 +1,92 @@
+/***********************************************************************************************************************
+*                                                                                                                      *
+* libscopeprotocols                                                                                                    *
+*                                                                                                                      *
+* Copyright (c) 2012-2024 Andrew D. Zonenberg and contributors                                                         *
+* All rights reserved.                                                                                                 *
+*                                                                                                                      *
+* Redistribution and use in source and binary forms, with or without modification, are permitted provided that the     *
+* following conditions are met:                                                                                        *
+*                                                                                                                      *
+*    * Redistributions of source code must retain the above copyright notice, this list of conditions, and the         *
+*      following disclaimer.                                                                                           *
+*                                                                                                                      *
+*    * Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the       *
+*      following disclaimer in the documentation and/or other materials provided with the distribution.                *
+*                                                                                                                      *
+*    * Neither the name of the author nor the names of any contributors may be used to endorse or promote products     *
+*      derived from this software without specific prior written permission.                                           *
+*                                                                                                                      *
+* THIS SOFTWARE IS PROVIDED BY THE AUTHORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED   *
+* TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL *
+* THE AUTHORS BE HELD LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES        *
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR       *
+* BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT *
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE       *
+* POSSIBILITY OF SUCH DAMAGE.                                                                                          *
+*                                                                                                                      *
+***********************************************************************************************************************/
+
+
+/**
+	@file
+	@author Andrew D. Zonenberg
+	@brief Declaration of VideoFrame
+ */
+#ifndef VideoFrame_h
+#define VideoFrame_h
+
+/**
+	@brief An RGB888 image reassembled from a video protocol decode
+ */
+class VideoFrame
+{
+public:
+	VideoFrame(size_t width = 0, size_t height = 0)
+	{ Resize(width, height); }
+
+	/**
+		@brief Changes the size of the frame, clearing it to black
+
+		@param width	Width in pixels
+		@param height	Height in pixels
+	 */
+	void Resize(size_t width, size_t height)
+	{
+		m_width = width;
+		m_height = height;
+		m_pixels.assign(width * height * 3, 0);
+	}
+
+	///@brief Width of the frame in pixels
+	size_t GetWidth() const
+	{ return m_width; }
+
+	///@brief Height of the frame in pixels
+	size_t GetHeight() const
+	{ return m_height; }
+
+	///@brief Gets a pointer to the first pixel of a row, as packed R, G, B bytes
+	uint8_t* GetRow(size_t y)
+	{ return &m_pixels[y * m_width * 3]; }
+
+	///@brief Gets a pointer to the first pixel of a row, as packed R, G, B bytes
+	const uint8_t* GetRow(size_t y) const
+	{ return &m_pixels[y * m_width * 3]; }
+
+	bool ExportRaw(const std::string& path) const;
+	bool ExportPNG(const std::string& path) const;
+
+protected:
+
+	///@brief Width in pixels
+	size_t m_width;
+
+	///@brief Height in pixels
+	size_t m_height;
+
+	///@brief Pixel data, row major, 3 bytes per pixel
+	std::vector<uint8_t> m_pixels;
+};
+
+#endif
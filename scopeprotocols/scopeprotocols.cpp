@@ -42,7 +42,8 @@ void ScopeProtocolStaticInit()
 {
 	AddDecoderClass(ACCoupleFilter);
 	AddDecoderClass(ACRMSMeasurement);
-	AddDecoderClass(AddFilter);
+	AddDecoderClass(AdaptiveEqualizerFilter);
+	AddDecoderClassWithDescriptor(AddFilter);
 	AddDecoderClass(ADL5205Decoder);
 	AddDecoderClass(AreaMeasurement);
 	AddDecoderClass(AutocorrelationFilter);
@@ -136,6 +137,7 @@ void ScopeProtocolStaticInit()
 	AddDecoderClass(IBM8b10bDecoder);
 	AddDecoderClass(InvertFilter);
 	AddDecoderClass(IPv4Decoder);
+	AddDecoderClass(IPv6Decoder);
 	AddDecoderClass(IQDemuxFilter);
 	AddDecoderClass(IQSquelchFilter);
 	AddDecoderClass(J1939AnalogDecoder);
@@ -151,6 +153,7 @@ void ScopeProtocolStaticInit()
 	AddDecoderClass(MaximumFilter);
 	AddDecoderClass(MDIODecoder);
 	AddDecoderClass(MemoryFilter);
+	AddDecoderClass(MemoryStateDecoder);
 	AddDecoderClass(MilStd1553Decoder);
 	AddDecoderClass(MinimumFilter);
 	AddDecoderClass(MovingAverageFilter);
@@ -169,6 +172,7 @@ void ScopeProtocolStaticInit()
 	AddDecoderClass(PCIeGen2LogicalDecoder);
 	AddDecoderClass(PCIeGen3LogicalDecoder);
 	AddDecoderClass(PCIeLinkTrainingDecoder);
+	AddDecoderClass(PCIeTransactionDecoder);
 	AddDecoderClass(PCIeTransportDecoder);
 	AddDecoderClass(PeakHoldFilter);
 	AddDecoderClass(PeaksFilter);
@@ -203,7 +207,7 @@ void ScopeProtocolStaticInit()
 	AddDecoderClass(SPIFlashDecoder);
 	AddDecoderClass(SquelchFilter);
 	AddDecoderClass(StepGeneratorFilter);
-	AddDecoderClass(SubtractFilter);
+	AddDecoderClassWithDescriptor(SubtractFilter);
 	AddDecoderClass(SWDDecoder);
 	AddDecoderClass(SWDMemAPDecoder);
 	AddDecoderClass(TachometerFilter);
@@ -211,7 +215,7 @@ void ScopeProtocolStaticInit()
 	AddDecoderClass(TCPDecoder);
 	AddDecoderClass(TDRFilter);
 	AddDecoderClass(ThermalDiodeFilter);
-	AddDecoderClass(ThresholdFilter);
+	AddDecoderClassWithDescriptor(ThresholdFilter);
 	AddDecoderClass(TIEMeasurement);
 	AddDecoderClass(TimeOutsideLevelMeasurement);
 	AddDecoderClass(TMDSDecoder);
@@ -226,11 +230,12 @@ void ScopeProtocolStaticInit()
 	AddDecoderClass(UartClockRecoveryFilter);
 	AddDecoderClass(UndershootMeasurement);
 	AddDecoderClass(UnwrappedPhaseFilter);
-	AddDecoderClass(UpsampleFilter);
+	AddDecoderClassWithDescriptor(UpsampleFilter);
 	AddDecoderClass(USB2ActivityDecoder);
 	AddDecoderClass(USB2PacketDecoder);
 	AddDecoderClass(USB2PCSDecoder);
 	AddDecoderClass(USB2PMADecoder);
+	AddDecoderClass(USB2TransferDecoder);
 	AddDecoderClass(VCDImportFilter);
 	AddDecoderClass(VectorFrequencyFilter);
 	AddDecoderClass(VectorPhaseFilter);
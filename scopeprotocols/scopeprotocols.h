@@ -40,6 +40,7 @@
 #include "../scopehal/Filter.h"
 
 #include "ACCoupleFilter.h"
+#include "AdaptiveEqualizerFilter.h"
 #include "AddFilter.h"
 #include "ACRMSMeasurement.h"
 #include "ADL5205Decoder.h"
@@ -136,6 +137,7 @@
 #include "IBISDriverFilter.h"
 #include "InvertFilter.h"
 #include "IPv4Decoder.h"
+#include "IPv6Decoder.h"
 #include "IQDemuxFilter.h"
 #include "IQSquelchFilter.h"
 #include "ISIMeasurement.h"
@@ -151,6 +153,7 @@
 #include "MaximumFilter.h"
 #include "MDIODecoder.h"
 #include "MemoryFilter.h"
+#include "MemoryStateDecoder.h"
 #include "MilStd1553Decoder.h"
 #include "MinimumFilter.h"
 #include "MovingAverageFilter.h"
@@ -169,6 +172,7 @@
 #include "PCIeGen2LogicalDecoder.h"
 #include "PCIeGen3LogicalDecoder.h"
 #include "PCIeLinkTrainingDecoder.h"
+#include "PCIeTransactionDecoder.h"
 #include "PCIeTransportDecoder.h"
 #include "PeakHoldFilter.h"
 #include "PeaksFilter.h"
@@ -231,6 +235,7 @@
 #include "USB2PacketDecoder.h"
 #include "USB2PCSDecoder.h"
 #include "USB2PMADecoder.h"
+#include "USB2TransferDecoder.h"
 #include "VCDImportFilter.h"
 #include "VectorFrequencyFilter.h"
 #include "VectorPhaseFilter.h"